@@ -59,7 +59,24 @@ run_func_on_args(
   void* data, // this data will be passed to callback_fn
   FileProcessingCallback callback_fn)
 {
-  int i, res, overall_res = 0, files_count;
+  return 
+    run_queued_func_on_args(argc, argv, common_data, p_cs, data, 
+                            callback_fn, NULL);
+}
+
+int
+run_queued_func_on_args(
+  int argc, 
+  const char * argv[], 
+  st_controlling_data* common_data,
+  st_conversion_settings* p_cs,
+  void* data, // this data will be passed to callback_fn and wait_fn
+  FileProcessingCallback callback_fn,
+  QueuedFilesWaitCallback wait_fn)
+{
+  int i, res, wait_res, overall_res = 0, files_count;
+  unsigned long n_failed;
+  unsigned long n_dropped;
   wchar_t* wargv;
   size_t wargv_sz;
   st_progress_data* p_progress_data;
@@ -107,6 +124,12 @@ run_func_on_args(
           p_cs,
           data, // pass callback data
           callback_fn); // pass callback function
+
+      if (wait_fn != NULL)
+      {
+        wait_res = wait_fn(data, &n_failed, &n_dropped);
+        res = wait_res != 0 ? wait_res : res;
+      }
       
       ++p_progress_data->n_seqs_processed;
       if (res != 0 && res != ERRCODE_STOP_SEARCH)
@@ -147,6 +170,17 @@ run_func_on_args(
             data,
             callback_fn);
 
+        if (wait_fn != NULL)
+        {
+          wait_res = wait_fn(data, &n_failed, &n_dropped);
+          res = wait_res != 0 ? wait_res : res;
+
+          // queued files are counted as successful ones
+          p_progress_data->n_files_processed -= n_dropped;
+          p_progress_data->n_files_ok -= n_failed + n_dropped;
+          p_progress_data->n_files_failed += n_failed;
+        }
+
         if (res != 0 && res != ERRCODE_STOP_SEARCH)
         {
           overall_res = res;
@@ -156,6 +190,12 @@ run_func_on_args(
       {
         res = 
           callback_fn(wargv, data);
+
+        if (wait_fn != NULL)
+        {
+          wait_res = wait_fn(data, &n_failed, &n_dropped);
+          res = wait_res != 0 ? wait_res : res;
+        }
       
         ++p_progress_data->n_files_processed;
         if (res != 0 && res != ERRCODE_STOP_SEARCH)
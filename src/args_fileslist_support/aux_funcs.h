@@ -55,6 +55,34 @@ run_func_on_args(
   void* data, // this data will be passed to callback_fn
   FileProcessingCallback callback_fn);
 
+/*
+ * Callback, which waits for processing of files queued by 
+ * FileProcessingCallback for the current argument, e.g. by parallel jobs.
+ * Returns result of the argument: result of the first failed file in the 
+ * order of queuing, 0 if all files are processed successfully.
+ * Receives number of failed files and number of files dropped after 
+ * the first failed one, as if processing had stopped there.
+ */
+typedef int (*QueuedFilesWaitCallback)(
+  void* data,
+  unsigned long* p_n_failed,
+  unsigned long* p_n_dropped);
+
+/*
+ * The same as run_func_on_args(), for callback_fn, which only queues files
+ * and returns 0. wait_fn is called after each argument, its results are 
+ * counted into common_data as if callback_fn had processed the files.
+ */
+int
+run_queued_func_on_args(
+  int argc,
+  const char * argv[],
+  st_controlling_data* common_data,
+  st_conversion_settings* p_cs,
+  void* data, // this data will be passed to callback_fn and wait_fn
+  FileProcessingCallback callback_fn,
+  QueuedFilesWaitCallback wait_fn);
+
 /*
  * FileProcessingCallback function.
  * See definition of this callback in "os_file_handlers.h"
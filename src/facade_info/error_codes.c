@@ -100,6 +100,9 @@ mhl_error_code_description(int error_code)
 
     case ERRCODE_MHL_CHECK_NO_MHL_ENTRY:
       return "File is not listed in MHL file.";
+
+    case ERRCODE_MHL_INDEX_OUTDATED:
+      return "MHL index file is missing or doesn't match the MHL file.";
  
     default:
       return "The code is not used, probably reserved for future.";
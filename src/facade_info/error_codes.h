@@ -52,8 +52,9 @@
 #define ERRCODE_GAP_IN_SEQUENCE 23
 #define ERRCODE_MHL_CHECK_NO_MHL_ENTRY 24
 #define ERRCODE_INITXXHASH_ERROR 25
+#define ERRCODE_MHL_INDEX_OUTDATED 26
 
-#define TOTAL_CODES_NUM 25
+#define TOTAL_CODES_NUM 26
 
 const char* mhl_error_code_description(int error_code);
 
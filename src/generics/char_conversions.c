@@ -40,6 +40,7 @@
 
 #include <generics/std_funcs_os_anonymizer.h>
 #include <generics/char_conversions.h>
+#include <generics/perf_stats.h>
 
 #ifdef WIN
 //
@@ -58,8 +59,8 @@ char* mhlosi_setlocale()
  *    In case of success: 0
  *    In case of errors : non zero value indicating the error
  */
-int
-convert_from_locale_to_wchar(
+static int
+aux_convert_from_locale_to_wchar(
   const char* src, 
   size_t src_sz, 
   wchar_t** wdst, 
@@ -108,7 +109,7 @@ convert_from_locale_to_wchar(
 }
 
 static
-int convert_from_wchar_to_locale(
+int aux_convert_from_wchar_to_locale(
   const wchar_t* wsrc, 
   size_t wsrc_sz, 
   char** dst, 
@@ -166,8 +167,8 @@ char* mhlosi_setlocale()
   return setlocale(LC_CTYPE, "");  
 }
 
-int
-convert_from_locale_to_wchar(
+static int
+aux_convert_from_locale_to_wchar(
   const char* p_src, 
   size_t src_sz, 
   wchar_t** wdst, 
@@ -229,8 +230,8 @@ convert_from_locale_to_wchar(
   return 0;
 }
 
-int
-convert_from_wchar_to_locale(
+static int
+aux_convert_from_wchar_to_locale(
   const wchar_t* p_wsrc, 
   size_t wsrc_sz, 
   char** dst, 
@@ -359,6 +360,9 @@ init_st_conversion_settings(st_conversion_settings* p_cs)
   
   p_cs->iconv_utf8_to_wchar = (iconv_t) -1;
   p_cs->iconv_wchar_to_utf8 = (iconv_t) -1;
+#ifdef MAC_OS_X  
+  p_cs->iconv_utf8d_to_utf8c = (iconv_t) -1;
+#endif
   
   p_cs->iconv_utf8_to_wchar = iconv_open(WCHAR_ENCODING, UTF8_ENCODING);  
   if (p_cs->iconv_utf8_to_wchar == (iconv_t) -1)
@@ -373,8 +377,6 @@ init_st_conversion_settings(st_conversion_settings* p_cs)
   }
 
 #ifdef MAC_OS_X  
-  p_cs->iconv_utf8d_to_utf8c = (iconv_t) -1;
-  
   p_cs->iconv_utf8d_to_utf8c = iconv_open(UTF8_ENCODING, UTF8_MAC);  
   if (p_cs->iconv_utf8d_to_utf8c == (iconv_t) -1)
   {
@@ -397,13 +399,13 @@ void free_st_conversion_settings(st_conversion_settings* p_cs)
     iconv_close(p_cs->iconv_utf8_to_wchar);
   }
 
-  if (p_cs->iconv_wchar_to_utf8 == (iconv_t) -1)
+  if (p_cs->iconv_wchar_to_utf8 != (iconv_t) -1)
   {
     iconv_close(p_cs->iconv_wchar_to_utf8);
   }
   
 #ifdef MAC_OS_X
-  if (p_cs->iconv_utf8d_to_utf8c == (iconv_t) -1)
+  if (p_cs->iconv_utf8d_to_utf8c != (iconv_t) -1)
   {
     iconv_close(p_cs->iconv_utf8d_to_utf8c);
   }
@@ -445,8 +447,8 @@ aux_convert_from_wchar_to_uint32_t(
 }
 */
 
-int
-convert_from_utf8_to_wchar(
+static int
+aux_convert_from_utf8_to_wchar(
   const char* p_src, 
   size_t src_sz, 
   wchar_t** p_wdst, 
@@ -502,8 +504,8 @@ convert_from_utf8_to_wchar(
   return 0;
 }
 
-int 
-convert_from_wchar_to_utf8(
+static int
+aux_convert_from_wchar_to_utf8(
   const wchar_t* p_wsrc, 
   size_t wsrc_sz,
   char** p_u8_dst,
@@ -612,6 +614,80 @@ convert_from_wchar_to_utf8(
   return 0;
 }
 
+//
+// Conversions, counted in statistics
+//
+
+int
+convert_from_locale_to_wchar(
+  const char* p_src, 
+  size_t src_sz, 
+  wchar_t** wdst, 
+  size_t* wdst_sz,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  res = aux_convert_from_locale_to_wchar(p_src, src_sz, wdst, wdst_sz, p_cs);
+  perf_stats_end(PP_CONVERSION, beg_us, src_sz);
+  return res;
+}
+
+int
+convert_from_wchar_to_locale(
+  const wchar_t* p_wsrc, 
+  size_t wsrc_sz, 
+  char** dst, 
+  size_t* dst_sz,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  res = aux_convert_from_wchar_to_locale(p_wsrc, wsrc_sz, dst, dst_sz, p_cs);
+  perf_stats_end(PP_CONVERSION, beg_us, wsrc_sz * sizeof(wchar_t));
+  return res;
+}
+
+int
+convert_from_utf8_to_wchar(
+  const char* p_src, 
+  size_t src_sz, 
+  wchar_t** p_wdst, 
+  size_t* wdst_sz,
+  st_conversion_settings* p_convs)
+{
+  int res;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  res = aux_convert_from_utf8_to_wchar(p_src, src_sz, p_wdst, wdst_sz, p_convs);
+  perf_stats_end(PP_CONVERSION, beg_us, src_sz);
+  return res;
+}
+
+int 
+convert_from_wchar_to_utf8(
+  const wchar_t* p_wsrc, 
+  size_t wsrc_sz,
+  char** p_u8_dst,
+  size_t* p_u8_dst_sz,
+  st_conversion_settings* p_convs)
+{
+  int res;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  res = 
+    aux_convert_from_wchar_to_utf8(p_wsrc, wsrc_sz, p_u8_dst, p_u8_dst_sz, 
+                                   p_convs);
+  perf_stats_end(PP_CONVERSION, beg_us, wsrc_sz * sizeof(wchar_t));
+  return res;
+}
+
 int 
 convert_from_locale_to_utf8(
   const char* src, 
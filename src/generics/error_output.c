@@ -0,0 +1,128 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: error_output.c
+ * 
+ * Output of error messages to stderr or to the output of the thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include <generics/os_threads.h>
+#include <generics/error_output.h>
+
+#define ERROR_MSG_BUFF_SZ 1024
+
+static mhlosi_once_flag g_output_once = MHLOSI_ONCE_INIT;
+static mhlosi_tls_key g_output_key;
+static unsigned char g_is_output_key_created = 0;
+
+static void
+aux_create_output_key(void)
+{
+  g_is_output_key_created = mhlosi_tls_create(&g_output_key) == 0;
+}
+
+st_error_output* set_thread_error_output(st_error_output* p_output)
+{
+  st_error_output* p_prev;
+
+  mhlosi_once(&g_output_once, aux_create_output_key);
+  if (!g_is_output_key_created)
+  {
+    return NULL;
+  }
+
+  p_prev = (st_error_output*) mhlosi_tls_get(g_output_key);
+  mhlosi_tls_set(g_output_key, p_output);
+  return p_prev;
+}
+
+st_error_output* get_thread_error_output(void)
+{
+  mhlosi_once(&g_output_once, aux_create_output_key);
+  if (!g_is_output_key_created)
+  {
+    return NULL;
+  }
+
+  return (st_error_output*) mhlosi_tls_get(g_output_key);
+}
+
+void error_printf(const char* format, ...)
+{
+  va_list args;
+  st_error_output* p_output;
+  char buff[ERROR_MSG_BUFF_SZ];
+  char* msg = buff;
+  int msg_len;
+
+  p_output = get_thread_error_output();
+  if (p_output == NULL)
+  {
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    return;
+  }
+
+  if (p_output->handler == NULL)
+  {
+    return;
+  }
+
+  va_start(args, format);
+  msg_len = vsnprintf(buff, sizeof(buff), format, args);
+  va_end(args);
+  if (msg_len < 0)
+  {
+    return;
+  }
+
+  // long message is formatted once more into the heap
+  if ((size_t) msg_len >= sizeof(buff))
+  {
+    msg = (char*) malloc((size_t) msg_len + 1);
+    if (msg == NULL)
+    {
+      msg = buff;
+    }
+    else
+    {
+      va_start(args, format);
+      vsnprintf(msg, (size_t) msg_len + 1, format, args);
+      va_end(args);
+    }
+  }
+
+  p_output->handler(msg, p_output->data);
+  if (msg != buff)
+  {
+    free(msg);
+  }
+}
@@ -0,0 +1,63 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: error_output.h
+ * 
+ * Output of error messages. Messages are printed to stderr, unless the 
+ * calling thread has set its own output, e.g. when the code is used as 
+ * a library and must not write to stderr.
+ */
+
+#ifndef _MHL_TOOLS_GENERICS_ERROR_OUTPUT_H_
+#define _MHL_TOOLS_GENERICS_ERROR_OUTPUT_H_
+
+/* Receives text of error message, as it would be printed to stderr.
+ */
+typedef void (*ErrorOutputHandler)(const char* msg, void* data);
+
+typedef struct _st_error_output
+{
+  ErrorOutputHandler handler; // NULL in order to drop messages
+  void* data;
+} st_error_output;
+
+/* Sets output of error messages of the calling thread. The output must 
+ * stay valid while it is set.
+ * @param p_output - NULL in order to print messages to stderr
+ * @return Previous output of the thread, NULL for stderr
+ */
+st_error_output* set_thread_error_output(st_error_output* p_output);
+
+/* @return Output of error messages of the calling thread, NULL for stderr
+ */
+st_error_output* get_thread_error_output(void);
+
+/* Prints formatted error message like fprintf(stderr, ...), or passes 
+ * it to the output of the calling thread.
+ */
+void error_printf(const char* format, ...);
+
+#endif //_MHL_TOOLS_GENERICS_ERROR_OUTPUT_H_
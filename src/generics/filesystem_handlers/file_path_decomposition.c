@@ -35,6 +35,7 @@
 #include <facade_info/error_codes.h>
 #include <generics/filesystem_handlers/public_interface.h>
 #include <generics/std_funcs_os_anonymizer.h>
+#include <generics/error_output.h>
 #include <generics/filesystem_handlers/file_path_decomposition.h>
 
 #ifdef WIN
@@ -532,13 +533,13 @@ fs_wpath_to_wstring(st_fs_wpath* p_rel_wpath, wchar_t** p_file_rel_wpath)
   
   if (p_file_rel_wpath == NULL)
   {
-    //fprintf(stderr, "Buffer for filename is not empty.\n");
+    //error_printf("Buffer for filename is not empty.\n");
     return ERRCODE_INTERNAL_ERROR;
   }
   
   if (p_rel_wpath->items_cnt == 0)
   {
-    //fprintf(stderr, "Empty relative path to file.\n");
+    //error_printf("Empty relative path to file.\n");
     return ERRCODE_INTERNAL_ERROR;
   }
   
@@ -565,7 +566,7 @@ fs_wpath_to_wstring(st_fs_wpath* p_rel_wpath, wchar_t** p_file_rel_wpath)
   *p_file_rel_wpath = (wchar_t*)calloc(wbuf_len, sizeof(wchar_t));
   if (*p_file_rel_wpath == NULL)
   {
-    //fprintf(stderr, "Out of memory.\n");
+    //error_printf("Out of memory.\n");
     return ERRCODE_OUT_OF_MEM;
   }
   
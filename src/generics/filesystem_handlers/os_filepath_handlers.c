@@ -41,6 +41,7 @@
 #include <unistd.h>
 #include <pwd.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <wctype.h> 
 #endif
 
@@ -55,8 +56,10 @@
 #include <facade_info/error_codes.h>
 #include <generics/filesystem_handlers/public_interface.h>
 #include <generics/std_funcs_os_anonymizer.h>
+#include <generics/error_output.h>
 #include <generics/char_conversions.h>
 #include <generics/memory_management.h>
+#include <generics/perf_stats.h>
 #include <generics/filesystem_handlers/file_path_decomposition.h>
 
 #define MAX_WD_ITERS 10
@@ -152,6 +155,70 @@ get_wworkdir(st_conversion_settings* pcs)
     return 0;
 }
 
+int get_user_cache_wdir(wchar_t** p_cache_wdir, st_conversion_settings* pcs)
+{
+  int res;
+  wchar_t* base_wdir;
+#ifdef WIN
+  const wchar_t* env_wstr;
+#else
+  const char* env_str;
+  const wchar_t* sub_wdir;
+#endif
+
+  if (p_cache_wdir == 0 || pcs == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+  *p_cache_wdir = 0;
+
+#ifdef WIN
+  env_wstr = _wgetenv(L"LOCALAPPDATA");
+  if (env_wstr == 0 || env_wstr[0] == L'\0')
+  {
+    return ERRCODE_NO_SUCH_FILE;
+  }
+
+  *p_cache_wdir = mhlosi_wstrdup(env_wstr);
+  return *p_cache_wdir == 0 ? ERRCODE_OUT_OF_MEM : 0;
+#else
+#ifdef MAC_OS_X
+  env_str = getenv("HOME");
+  sub_wdir = L"Library/Caches";
+#else
+  // XDG base directory specification, relative paths are ignored
+  env_str = getenv("XDG_CACHE_HOME");
+  sub_wdir = 0;
+  if (env_str == 0 || env_str[0] != '/')
+  {
+    env_str = getenv("HOME");
+    sub_wdir = L".cache";
+  }
+#endif
+  if (env_str == 0 || env_str[0] != '/')
+  {
+    return ERRCODE_NO_SUCH_FILE;
+  }
+
+  base_wdir = 
+    strdup_and_convert_composed_from_locale_to_wchar(env_str, pcs, &res);
+  if (base_wdir == 0)
+  {
+    return res != 0 ? res : ERRCODE_OUT_OF_MEM;
+  }
+
+  if (sub_wdir == 0)
+  {
+    *p_cache_wdir = base_wdir;
+    return 0;
+  }
+
+  res = concat_wpath_parts(base_wdir, sub_wdir, p_cache_wdir);
+  free(base_wdir);
+  return res;
+#endif
+}
+
 void make_wpath_uniform(wchar_t* wpath)
 {
   if (wpath == 0 || *wpath == L'\0')
@@ -477,6 +544,32 @@ concat_wpath_parts(
 }
 
 #ifdef WIN
+/* FindFirstFileW() and FindNextFileW(), counted in statistics.
+ */
+static HANDLE
+aux_find_first_wfile(const wchar_t* wpath, WIN32_FIND_DATAW* p_wffd)
+{
+  HANDLE h_find;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  h_find = FindFirstFileW(wpath, p_wffd);
+  perf_stats_end(PP_WALK, beg_us, 0);
+  return h_find;
+}
+
+static BOOL
+aux_find_next_wfile(HANDLE h_find, WIN32_FIND_DATAW* p_wffd)
+{
+  BOOL res;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  res = FindNextFileW(h_find, p_wffd);
+  perf_stats_end(PP_WALK, beg_us, 0);
+  return res;
+}
+
 /* 
  * @return If entry type bit flag is matched to entry 
  *         type from dirent structure, result is 1.
@@ -561,7 +654,7 @@ search_entries_in_wdir(
   corrected_wpath_to_wdir[wpath_to_dir_sz + 1] = '\0';
   
   //
-  h_find = FindFirstFileW(corrected_wpath_to_wdir, &wffd);
+  h_find = aux_find_first_wfile(corrected_wpath_to_wdir, &wffd);
   if (h_find == INVALID_HANDLE_VALUE) 
   {
     free(corrected_wpath_to_wdir);
@@ -583,7 +676,7 @@ search_entries_in_wdir(
       }
     }
     
-    if (FindNextFileW(h_find, &wffd) == 0)
+    if (aux_find_next_wfile(h_find, &wffd) == 0)
     {
       break;
     }
@@ -594,6 +687,84 @@ search_entries_in_wdir(
   return 0;  
 }
 
+int 
+list_entries_in_wdir(
+  const wchar_t* wpath_to_dir, 
+  st_conversion_settings* p_cs,
+  void* data, // this data will be passed to entryproc_callback
+  DirEntryProcessingCallback entryproc_callback)
+{
+  int res;
+  WIN32_FIND_DATAW wffd;
+  wchar_t* corrected_wpath_to_wdir = 0;
+  size_t wpath_to_dir_sz;
+  HANDLE h_find = INVALID_HANDLE_VALUE;
+  DIR_ENTRY_TYPE_FLAGS entry_type;
+  
+  if (wpath_to_dir == 0 || wpath_to_dir[0] == L'\0' || 
+      entryproc_callback == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+  
+  // Append "\*" to the path_to_dir
+  wpath_to_dir_sz = wcslen(wpath_to_dir);
+  corrected_wpath_to_wdir = 
+  (wchar_t*) calloc(wpath_to_dir_sz + 3, sizeof(wchar_t));
+  
+  if (corrected_wpath_to_wdir == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  
+  wmemcpy(corrected_wpath_to_wdir, wpath_to_dir, wpath_to_dir_sz);
+  if (corrected_wpath_to_wdir[wpath_to_dir_sz - 1] != L'\\')
+  {
+    corrected_wpath_to_wdir[wpath_to_dir_sz++] = L'\\';
+  }
+  corrected_wpath_to_wdir[wpath_to_dir_sz] = '*';
+  corrected_wpath_to_wdir[wpath_to_dir_sz + 1] = '\0';
+  
+  h_find = aux_find_first_wfile(corrected_wpath_to_wdir, &wffd);
+  free(corrected_wpath_to_wdir);
+  if (h_find == INVALID_HANDLE_VALUE) 
+  {
+    return ERRCODE_NO_SUCH_FILE;
+  } 
+  
+  do
+  {
+    if (wcscmp(wffd.cFileName, L".") == 0 || 
+        wcscmp(wffd.cFileName, L"..") == 0)
+    {
+      continue;
+    }
+    
+    if (wffd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+    {
+      entry_type = DETF_LNK;
+    }
+    else if (wffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+    {
+      entry_type = DETF_DIR;
+    }
+    else
+    {
+      entry_type = DETF_FILE;
+    }
+    
+    res = entryproc_callback(wffd.cFileName, entry_type, data);      
+    if (res != 0)
+    {
+      FindClose(h_find);
+      return res == ERRCODE_STOP_SEARCH ? 0 : res;
+    }
+  } while (aux_find_next_wfile(h_find, &wffd) != 0);
+  
+  FindClose(h_find);
+  return 0;  
+}
+
 static
 int aux_process_entries_recurs(
   const wchar_t* wpath_to_dir,
@@ -653,7 +824,7 @@ int aux_process_entries_recurs(
   corrected_wpath_to_wdir[wpath_to_dir_sz + 1] = '\0';
 
   //
-  h_find = FindFirstFileW(corrected_wpath_to_wdir, &wffd);
+  h_find = aux_find_first_wfile(corrected_wpath_to_wdir, &wffd);
   if (h_find == INVALID_HANDLE_VALUE)
   {
     free(corrected_wpath_to_wdir);
@@ -724,7 +895,7 @@ int aux_process_entries_recurs(
       free(entry_wpath);
     }
 
-    if (FindNextFileW(h_find, &wffd) == 0)
+    if (aux_find_next_wfile(h_find, &wffd) == 0)
     {
       break;
     }
@@ -736,6 +907,32 @@ int aux_process_entries_recurs(
 }
 
 #else
+/* opendir() and readdir(), counted in statistics.
+ */
+static DIR*
+aux_opendir(const char* path)
+{
+  DIR* dirp;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  dirp = opendir(path);
+  perf_stats_end(PP_WALK, beg_us, 0);
+  return dirp;
+}
+
+static struct dirent*
+aux_readdir(DIR* dirp)
+{
+  struct dirent* dent;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  dent = readdir(dirp);
+  perf_stats_end(PP_WALK, beg_us, 0);
+  return dent;
+}
+
 /* 
  * @return If entry type bit flag is matched to entry 
  *         type from dirent structure, result is 1.
@@ -858,7 +1055,7 @@ search_entries_in_wdir(
     return res;
   }
   
-  dirp = opendir(locpath_to_dir);
+  dirp = aux_opendir(locpath_to_dir);
   if (dirp == 0)
   {
     if (tmp_cs_inited)
@@ -871,7 +1068,7 @@ search_entries_in_wdir(
     return ERRCODE_IO_ERROR;
   }
   
-  while ((dent = readdir(dirp)) != NULL)
+  while ((dent = aux_readdir(dirp)) != NULL)
   {
     if (aux_match_entry_types(entry_types, dent) == 0)
     {
@@ -936,6 +1133,129 @@ search_entries_in_wdir(
   return 0;  
 }
 
+static DIR_ENTRY_TYPE_FLAGS
+aux_get_entry_type(DIR* dirp, struct dirent* dent)
+{
+  struct stat st;
+  
+  switch (dent->d_type)
+  {
+    case DT_REG:
+      return DETF_FILE;
+    case DT_DIR:
+      return DETF_DIR;
+    case DT_BLK:
+      return DETF_BLK;
+    case DT_CHR:
+      return DETF_CHR;
+    case DT_FIFO:
+      return DETF_FIFO;
+    case DT_LNK:
+      return DETF_LNK;
+    case DT_SOCK:
+      return DETF_SOCK;
+    default:
+      break;
+  }
+  
+  // some file systems don't fill d_type
+  if (fstatat(dirfd(dirp), dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+  {
+    return DETF_UNK;
+  }
+  
+  if (S_ISREG(st.st_mode))
+  {
+    return DETF_FILE;
+  }
+  else if (S_ISDIR(st.st_mode))
+  {
+    return DETF_DIR;
+  }
+  else if (S_ISLNK(st.st_mode))
+  {
+    return DETF_LNK;
+  }
+  
+  return DETF_UNK;
+}
+
+int 
+list_entries_in_wdir(
+  const wchar_t* wpath_to_dir, 
+  st_conversion_settings* p_cs,
+  void* data, // this data will be passed to entryproc_callback
+  DirEntryProcessingCallback entryproc_callback)
+{
+  int res;
+  DIR* dirp;
+  struct dirent* dent;
+  char* locpath_to_dir = 0;
+  size_t locpath_to_dir_sz = 0;
+  wchar_t* entry_wname = 0;
+  size_t entry_wname_sz = 0;
+  
+  if (wpath_to_dir == 0 || wpath_to_dir[0] == L'\0' || 
+      p_cs == 0 || entryproc_callback == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+  
+  res = 
+    convert_from_wchar_to_utf8(
+      wpath_to_dir,
+      wcslen(wpath_to_dir),
+      &locpath_to_dir,
+      &locpath_to_dir_sz,
+      p_cs);
+  
+  if (res != 0)
+  {
+    return res;
+  }
+  
+  dirp = aux_opendir(locpath_to_dir);
+  free(locpath_to_dir);
+  if (dirp == 0)
+  {
+    return ERRCODE_IO_ERROR;
+  }
+  
+  while ((dent = aux_readdir(dirp)) != NULL)
+  {
+    if (strcmp(dent->d_name, ".") == 0 || strcmp(dent->d_name, "..") == 0)
+    {
+      continue;
+    }
+    
+    res = 
+      convert_composed_from_locale_to_wchar(
+        dent->d_name,
+        strlen(dent->d_name),
+        &entry_wname,
+        &entry_wname_sz,
+        p_cs);
+    
+    if (res != 0)
+    {
+      closedir(dirp);
+      return res;
+    }
+    
+    res = entryproc_callback(entry_wname, aux_get_entry_type(dirp, dent), 
+                             data);
+    free(entry_wname);
+    if (res != 0)
+    {
+      closedir(dirp);
+      return res == ERRCODE_STOP_SEARCH ? 0 : res;
+    }
+  }
+  
+  closedir(dirp);
+  return 0;  
+}
+
 static
 int aux_process_entries_recurs(
   const wchar_t* wpath_to_dir,
@@ -978,25 +1298,24 @@ int aux_process_entries_recurs(
     return res;
   }
 
-  dirp = opendir(locpath_to_dir);
+  dirp = aux_opendir(locpath_to_dir);
   if (dirp == 0)
   {
     free(locpath_to_dir);
     return ERRCODE_IO_ERROR;
   }
 
-  while ((dent = readdir(dirp)) != NULL)
+  while ((dent = aux_readdir(dirp)) != NULL)
   {
     if (aux_match_entry_types(entry_types | DETF_DIR, dent) == 0)
     {
-      fprintf(
-        stderr,
+      error_printf(
         "Warning: the path is not a valid directory or file:\n%s/%s\n"
         "         ",
         locpath_to_dir, dent->d_name);
 
       aux_print_ent_type(dent);
-      fprintf(stderr, " Ignoring...\n\n");
+      error_printf(" Ignoring...\n\n");
 
       continue;
     }
@@ -37,6 +37,7 @@
 #include <fcntl.h> 
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
 #include <stdio.h>
 
 #include <generics/os_check.h>
@@ -44,13 +45,19 @@
 #include <sys/types.h> 
 #include <io.h> 
 #include <share.h> 
+#include <direct.h> 
+#include <sys/utime.h> 
 #else
 #include <unistd.h>
+#include <sys/mman.h>
+#include <utime.h>
 #endif 
 
 #include <facade_info/error_codes.h>
 #include <generics/std_funcs_os_anonymizer.h>
+#include <generics/error_output.h>
 #include <generics/char_conversions.h>
+#include <generics/perf_stats.h>
 #include <generics/filesystem_handlers/public_interface.h>
 
 #ifndef WIN
@@ -105,6 +112,7 @@ int get_wfile_stat_data(
   const wchar_t* wpath, st_mhlosi_stat* stat_data)
 {
   int res;
+  unsigned long long beg_us;
 
 #if defined MAC_OS_X || defined LINUX
   char* locencfn = 0;
@@ -118,7 +126,9 @@ int get_wfile_stat_data(
   memset(stat_data, 0, sizeof(*stat_data) / sizeof(char));
 
 #ifdef WIN
+  beg_us = perf_stats_begin();
   res = _wstati64(wpath, &stat_data->st_data);
+  perf_stats_end(PP_STAT, beg_us, 0);
 #else
 
   locencfn = wfilename_to_locale_filename(wpath);
@@ -127,11 +137,13 @@ int get_wfile_stat_data(
     return ERRCODE_CHARS_CONVERSION_ERROR;
   }
 
+  beg_us = perf_stats_begin();
 #ifdef MAC_OS_X
   res = lstat(locencfn, &stat_data->st_data);
 #else
   res = lstat64(locencfn, &stat_data->st_data);
 #endif
+  perf_stats_end(PP_STAT, beg_us, 0);
   free(locencfn);
 #endif
 
@@ -277,36 +289,36 @@ void print_ent_type(DIR_ENTRY_TYPE_FLAGS ent_type)
   switch(ent_type)
   {
     case DETF_FILE:
-          fprintf(stderr, "This is a regular file.");
+          error_printf("This is a regular file.");
           break;
 
     case DETF_DIR:
-          fprintf(stderr, "This is a directory.");
+          error_printf("This is a directory.");
           break;
 
     case DETF_BLK:
-          fprintf(stderr, "This is a block device.");
+          error_printf("This is a block device.");
           break;
 
     case DETF_CHR:
-          fprintf(stderr, "This is a character device.");
+          error_printf("This is a character device.");
           break;
 
     case DETF_FIFO:
-          fprintf(stderr, "This is a named pipe (FIFO).");
+          error_printf("This is a named pipe (FIFO).");
           break;
 
     case DETF_LNK:
-          fprintf(stderr, "This is a symbolic link.");
+          error_printf("This is a symbolic link.");
           break;
 
     case DETF_SOCK:
-          fprintf(stderr, "This is a UNIX domain socket.");
+          error_printf("This is a UNIX domain socket.");
           break;
 
     case DETF_UNK:
     default:
-        fprintf(stderr, "The file type is unknown.");
+        error_printf("The file type is unknown.");
   }
 }
 
@@ -412,6 +424,31 @@ FILE* fwopen_for_hash_create(const wchar_t* wfn)
 #endif
 }
 
+FILE* fwopen_for_binary_create(const wchar_t* wfn)
+{
+#ifdef WIN
+  return _wfopen(wfn, L"wb");
+#else
+  FILE* wfd;
+  char* locencfn = 0;
+
+  if (wfn == 0 || wfn[0] == L'\0')
+  {
+    return 0;
+  }
+
+  locencfn = wfilename_to_locale_filename(wfn);
+  if (locencfn == NULL)
+  {
+    return 0;
+  }
+
+  wfd = fopen(locencfn, "wb");
+  free(locencfn);
+  return wfd;
+#endif
+}
+
 /* The same functiomnality as open from C stdlib
  *
  * On windows in order to open binary _wsopen_s should be used
@@ -451,6 +488,47 @@ int wopen_for_read(const wchar_t* wfn, int* p_fd)
 #endif
 }
 
+/* The same functionality as open from C stdlib with flags for
+ * creation of a new file for writing (existing file is truncated)
+ *
+ * On windows in order to open binary _wsopen_s should be used
+ */
+int wopen_for_create(const wchar_t* wfn, int* p_fd)
+{
+#ifdef WIN
+  errno_t err;
+#else 
+  char* locencfn = 0;
+#endif
+
+  if (p_fd == 0 || wfn == 0 || wfn[0] == L'\0')
+  {
+     return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+#ifdef WIN
+  err = _wsopen_s(p_fd, wfn, _O_BINARY | _O_WRONLY | _O_CREAT | _O_TRUNC, 
+                  _SH_DENYWR, _S_IREAD | _S_IWRITE);
+  return err != 0 ? ERRCODE_IO_ERROR : 0;
+#else
+  locencfn = wfilename_to_locale_filename(wfn);
+  if (locencfn == 0)
+  {
+    return ERRCODE_IO_ERROR;
+  }
+
+  *p_fd = open(locencfn, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  free(locencfn);
+  if (*p_fd == -1)
+  {
+    *p_fd = 0;
+    return ERRCODE_IO_ERROR;
+  }
+  
+  return 0;
+#endif
+}
+
 int mhlosi_close(int fd)
 {
 #ifdef WIN
@@ -460,4 +538,345 @@ int mhlosi_close(int fd)
 #endif
 }
 
+int mhlosi_write_all(int fd, const void* data, size_t data_sz)
+{
+  const char* p_data = (const char*) data;
+#ifdef WIN
+  int written;
+#else
+  ssize_t written;
+#endif
+
+  while (data_sz != 0)
+  {
+#ifdef WIN
+    written = _write(fd, p_data, 
+                     (unsigned int) (data_sz > INT_MAX ? INT_MAX : data_sz));
+#else
+    written = write(fd, p_data, data_sz);
+    if (written < 0 && errno == EINTR)
+    {
+      continue;
+    }
+#endif
+    if (written <= 0)
+    {
+      return ERRCODE_IO_ERROR;
+    }
+
+    p_data += written;
+    data_sz -= (size_t) written;
+  }
+
+  return 0;
+}
+
+int mhlosi_sync_and_drop_cache(int fd)
+{
+#ifdef WIN
+  return _commit(fd) != 0 ? ERRCODE_IO_ERROR : 0;
+#else
+  if (fsync(fd) != 0)
+  {
+    return ERRCODE_IO_ERROR;
+  }
+#if defined POSIX_FADV_DONTNEED
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#elif defined F_NOCACHE
+  fcntl(fd, F_NOCACHE, 1);
+#endif
+  return 0;
+#endif
+}
+
 
+
+/* Maps whole file into memory for reading. 
+ *
+ * On windows file content is read into allocated buffer instead.
+ */
+int wmap_file_for_read(
+  const wchar_t* wfn, 
+  const char** p_data, 
+  size_t* p_data_sz)
+{
+  int res;
+  int fd;
+  void* data;
+  unsigned long long fsz;
+#ifdef WIN
+  struct _stati64 st_data;
+  size_t read_sz;
+  int read_res;
+#else
+  struct stat st_data;
+#endif
+
+  if (p_data == 0 || p_data_sz == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  res = wopen_for_read(wfn, &fd);
+  if (res != 0)
+  {
+    return res;
+  }
+
+#ifdef WIN
+  res = _fstati64(fd, &st_data);
+#else
+  res = fstat(fd, &st_data);
+#endif
+  fsz = (unsigned long long) st_data.st_size;
+  if (res != 0 || fsz == 0 || fsz != (size_t) fsz)
+  {
+    // nothing to map, or file doesn't fit into address space
+    mhlosi_close(fd);
+    return ERRCODE_IO_ERROR;
+  }
+
+#ifdef WIN
+  data = malloc((size_t) fsz);
+  if (data == NULL)
+  {
+    _close(fd);
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  for (read_sz = 0; read_sz < fsz; read_sz += read_res)
+  {
+    read_res = _read(fd, (char*) data + read_sz, 
+                     (unsigned int) (fsz - read_sz > INT_MAX ? 
+                                       INT_MAX : fsz - read_sz));
+    if (read_res <= 0)
+    {
+      free(data);
+      _close(fd);
+      return ERRCODE_IO_ERROR;
+    }
+  }
+#else
+  data = mmap(NULL, (size_t) fsz, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED)
+  {
+    close(fd);
+    return ERRCODE_IO_ERROR;
+  }
+#ifdef MADV_SEQUENTIAL
+  // file is read once from the beginning to the end
+  madvise(data, (size_t) fsz, MADV_SEQUENTIAL);
+#endif
+#endif
+
+  // mapping stays valid after the file is closed
+  mhlosi_close(fd);
+
+  *p_data = (const char*) data;
+  *p_data_sz = (size_t) fsz;
+  return 0;
+}
+
+void unmap_file(const char* data, size_t data_sz)
+{
+  if (data == NULL)
+  {
+    return;
+  }
+
+#ifdef WIN
+  free((void*) data);
+#else
+  munmap((void*) data, data_sz);
+#endif
+}
+
+int wrename_file(const wchar_t* src_wfn, const wchar_t* dst_wfn)
+{
+#ifndef WIN
+  char* src_locencfn;
+  char* dst_locencfn;
+#endif
+  int res;
+
+  if (src_wfn == 0 || src_wfn[0] == L'\0' || 
+      dst_wfn == 0 || dst_wfn[0] == L'\0')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+#ifdef WIN
+  // _wrename doesn't replace existing files
+  _wremove(dst_wfn);
+  res = _wrename(src_wfn, dst_wfn);
+#else
+  src_locencfn = wfilename_to_locale_filename(src_wfn);
+  dst_locencfn = wfilename_to_locale_filename(dst_wfn);
+  if (src_locencfn == NULL || dst_locencfn == NULL)
+  {
+    free(src_locencfn);
+    free(dst_locencfn);
+    return ERRCODE_IO_ERROR;
+  }
+
+  res = rename(src_locencfn, dst_locencfn);
+  free(src_locencfn);
+  free(dst_locencfn);
+#endif
+
+  return res != 0 ? ERRCODE_IO_ERROR : 0;
+}
+
+int wremove_file(const wchar_t* wfn)
+{
+#ifndef WIN
+  char* locencfn;
+#endif
+  int res;
+
+  if (wfn == 0 || wfn[0] == L'\0')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+#ifdef WIN
+  res = _wremove(wfn);
+#else
+  locencfn = wfilename_to_locale_filename(wfn);
+  if (locencfn == NULL)
+  {
+    return ERRCODE_IO_ERROR;
+  }
+
+  res = remove(locencfn);
+  free(locencfn);
+#endif
+
+  if (res != 0)
+  {
+    return errno == ENOENT ? ERRCODE_NO_SUCH_FILE : ERRCODE_IO_ERROR;
+  }
+  return 0;
+}
+
+static int
+aux_make_dir(const wchar_t* wpath)
+{
+#ifndef WIN
+  char* locencfn;
+#endif
+  int res;
+
+#ifdef WIN
+  res = _wmkdir(wpath);
+#else
+  locencfn = wfilename_to_locale_filename(wpath);
+  if (locencfn == NULL)
+  {
+    return ERRCODE_CHARS_CONVERSION_ERROR;
+  }
+
+  res = mkdir(locencfn, 0777);
+  free(locencfn);
+#endif
+
+  if (res != 0 && !(errno == EEXIST && is_directory(wpath)))
+  {
+    return errno == ENOENT ? ERRCODE_NO_SUCH_FILE : ERRCODE_IO_ERROR;
+  }
+  return 0;
+}
+
+int wmake_dirs(const wchar_t* wpath)
+{
+  int res;
+  wchar_t* parent_wpath;
+  size_t i;
+
+  if (wpath == 0 || wpath[0] == L'\0')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (is_directory(wpath))
+  {
+    return 0;
+  }
+
+  res = aux_make_dir(wpath);
+  if (res != ERRCODE_NO_SUCH_FILE)
+  {
+    return res;
+  }
+
+  // some of parents are missing, create them first
+  parent_wpath = mhlosi_wstrdup(wpath);
+  if (parent_wpath == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  i = wcslen(parent_wpath);
+  while (i > 0 && parent_wpath[i - 1] == WPATH_SEPARATOR)
+  {
+    --i;
+  }
+  while (i > 0 && parent_wpath[i - 1] != WPATH_SEPARATOR)
+  {
+    --i;
+  }
+  while (i > 1 && parent_wpath[i - 1] == WPATH_SEPARATOR)
+  {
+    --i;
+  }
+
+  if (i == 0)
+  {
+    free(parent_wpath);
+    return ERRCODE_NO_SUCH_FILE;
+  }
+
+  parent_wpath[i] = L'\0';
+  res = wmake_dirs(parent_wpath);
+  free(parent_wpath);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  return aux_make_dir(wpath);
+}
+
+int wset_file_mtime(const wchar_t* wfn, time_t mtime)
+{
+#ifdef WIN
+  struct _utimbuf times;
+#else
+  struct utimbuf times;
+  char* locencfn;
+#endif
+  int res;
+
+  if (wfn == 0 || wfn[0] == L'\0')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  times.actime = mtime;
+  times.modtime = mtime;
+
+#ifdef WIN
+  res = _wutime(wfn, &times);
+#else
+  locencfn = wfilename_to_locale_filename(wfn);
+  if (locencfn == NULL)
+  {
+    return ERRCODE_CHARS_CONVERSION_ERROR;
+  }
+
+  res = utime(locencfn, &times);
+  free(locencfn);
+#endif
+
+  return res != 0 ? ERRCODE_IO_ERROR : 0;
+}
@@ -27,6 +27,7 @@
 
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <generics/os_check.h>
 #include <generics/char_conversions.h>
@@ -101,6 +102,17 @@ extract_relative_wpath(
 // Note! Caller is responsible for free returned pointer
 wchar_t* get_wworkdir(st_conversion_settings* pcs);
 
+/*
+ * Gets per-user cache folder of the platform: $XDG_CACHE_HOME or
+ * ~/.cache on Linux, ~/Library/Caches on Mac OS X, %LOCALAPPDATA% on
+ * Windows. The folder is not created.
+ *
+ * Note! Caller is responsible for free pointer, returned in p_cache_wdir.
+ *
+ * @return: Success: 0, Error: non zero value with error code
+ */
+int get_user_cache_wdir(wchar_t** p_cache_wdir, st_conversion_settings* pcs);
+
 /*
  * Note! Caller is responsible for free returned pointer,
  *       returned in merged_path param.
@@ -170,18 +182,87 @@ FILE* fwopen_for_hash_create(const wchar_t* wfilename);
  */
 FILE* fwopen_for_hash_check(const wchar_t* wfilename);
 
+/* The same functionality as fopen from C stdlib, opens binary file 
+ * for writing. The file is created if it doesn't exist, or truncated 
+ * otherwise.
+ */
+FILE* fwopen_for_binary_create(const wchar_t* wfilename);
+
 /* The same functionality as open from C stdlib
  *
  * On windows in order to open binary _wsopen_s should be used
  */
 int wopen_for_read(const wchar_t* wfn, int* p_fd);
 
+/* The same functionality as open from C stdlib, opens file for writing.
+ * The file is created if it doesn't exist, or truncated otherwise.
+ *
+ * On windows in order to open binary _wsopen_s should be used
+ */
+int wopen_for_create(const wchar_t* wfn, int* p_fd);
+
 /* The same functiomnality as close from C stdlib
  *
  * On windows in order to open binary _close should be used
  */
 int mhlosi_close(int fd);
 
+/* Writes all the data to file, repeating the write if it's partial.
+ *
+ * @return: Success: 0, Error: non zero value with error code
+ */
+int mhlosi_write_all(int fd, const void* data, size_t data_sz);
+
+/* Flushes written data of file to the storage and drops it from the 
+ * file system cache if the OS allows it, so the next read of the file
+ * gets the data from the storage.
+ *
+ * @return: Success: 0, Error: non zero value with error code
+ */
+int mhlosi_sync_and_drop_cache(int fd);
+
+/* Maps whole file into memory for reading.
+ * Empty files can not be mapped, error is returned for them.
+ * Mapped data must be released via unmap_file().
+ *
+ * @param p_data - receives pointer to the file content
+ * @param p_data_sz - receives size of the file content
+ * @return: Success: 0, Error: non zero value with error code
+ */
+int wmap_file_for_read(
+  const wchar_t* wfn, 
+  const char** p_data, 
+  size_t* p_data_sz);
+
+/* Releases file content mapped via wmap_file_for_read().
+ */
+void unmap_file(const char* data, size_t data_sz);
+
+/* Renames file. Existing destination file is replaced.
+ *
+ * @return: Success: 0, Error: non zero value with error code
+ */
+int wrename_file(const wchar_t* src_wfn, const wchar_t* dst_wfn);
+
+/* Removes file.
+ *
+ * @return: Success: 0, Error: non zero value with error code
+ */
+int wremove_file(const wchar_t* wfn);
+
+/* Creates directory, missing parent directories are created as well.
+ * Existing directory is not an error.
+ *
+ * @return: Success: 0, Error: non zero value with error code
+ */
+int wmake_dirs(const wchar_t* wpath);
+
+/* Sets modification time of file, access time is set to the same value.
+ *
+ * @return: Success: 0, Error: non zero value with error code
+ */
+int wset_file_mtime(const wchar_t* wfn, time_t mtime);
+
 /* Gets file size. 
  *
  * @return: Success: 0, Error: non zero value with error code
@@ -276,8 +357,40 @@ int search_entries_in_wdir(
   void* data, // this data will be passed to fileproc_callback
   FileProcessingCallback fileproc_callback);
 
+/*
+ * Callback, called for each entry of a directory listing.
+ * Return codes are the same as for FileProcessingCallback.
+ */
+typedef int (*DirEntryProcessingCallback)(
+  const wchar_t* entry_wname, 
+  DIR_ENTRY_TYPE_FLAGS entry_type,
+  void* data);
+
+/*
+ * Lists all entries of given dir, except of "." and "..", in one pass.
+ * Entry names are passed "as is" to callback function together with
+ * entry types. Symbolic links are reported as DETF_LNK, they are not 
+ * followed.
+ *
+ * @param wpath_to_dir - path to directory.
+ * @param p_cs - pointer to chars conversion settings
+ * @param data - pointer to data structure, which will be passed to callback
+ *               function
+ * @param entryproc_callback - callback function
+ *
+ * @return Success: 0 (empty directory is success). 
+ *         Failure: Non zero value with error code.
+ */
+int list_entries_in_wdir(
+  const wchar_t* wpath_to_dir, 
+  st_conversion_settings* p_cs,
+  void* data, // this data will be passed to entryproc_callback
+  DirEntryProcessingCallback entryproc_callback);
+
 #define MHL_FILE_PATTERN ".mhl"
 #define MHL_FILE_WPATTERN L".mhl"
+#define MHL_GZ_FILE_PATTERN ".mhl.gz"
+#define MHL_GZ_FILE_WPATTERN L".mhl.gz"
 
 unsigned char is_directory(const wchar_t* wpath);
 unsigned char is_regular_file(const wchar_t* wpath);
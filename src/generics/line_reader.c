@@ -0,0 +1,171 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: line_reader.c
+ * 
+ * Reading of text lines of any length from a stream.
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/line_reader.h>
+
+int init_line_reader(st_line_reader* p_reader, FILE* fl, size_t chunk_sz)
+{
+  memset((void*) p_reader, 0, sizeof(*p_reader) / sizeof(char));
+
+  p_reader->fl = fl;
+  p_reader->chunk_sz = chunk_sz ? chunk_sz : LINE_READER_DEFAULT_CHUNK_SZ;
+  p_reader->buf_sz = p_reader->chunk_sz + 1;
+  p_reader->buf = (char*) malloc(p_reader->buf_sz);
+  if (p_reader->buf == NULL)
+  {
+    p_reader->buf_sz = 0;
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  return 0;
+}
+
+void free_line_reader(st_line_reader* p_reader)
+{
+  free(p_reader->buf);
+  memset((void*) p_reader, 0, sizeof(*p_reader) / sizeof(char));
+}
+
+/* Moves not returned data to the beginning of the buffer and reads 
+ * the next chunk after it. The buffer grows if it's too small for 
+ * a chunk and the terminating '\0'.
+ */
+static
+int
+aux_read_chunk(st_line_reader* p_reader)
+{
+  size_t data_sz;
+  size_t new_buf_sz;
+  size_t read_sz;
+  char* new_buf;
+
+  data_sz = p_reader->data_end - p_reader->data_beg;
+  if (p_reader->data_beg != 0)
+  {
+    memmove(p_reader->buf, p_reader->buf + p_reader->data_beg, data_sz);
+    p_reader->data_beg = 0;
+    p_reader->data_end = data_sz;
+  }
+
+  if (p_reader->buf_sz - data_sz < p_reader->chunk_sz + 1)
+  {
+    new_buf_sz = p_reader->buf_sz * 2;
+    if (new_buf_sz < data_sz + p_reader->chunk_sz + 1)
+    {
+      new_buf_sz = data_sz + p_reader->chunk_sz + 1;
+    }
+
+    new_buf = (char*) realloc(p_reader->buf, new_buf_sz);
+    if (new_buf == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+    p_reader->buf = new_buf;
+    p_reader->buf_sz = new_buf_sz;
+  }
+
+  read_sz = fread(p_reader->buf + data_sz, 1, p_reader->chunk_sz, p_reader->fl);
+  p_reader->data_end += read_sz;
+  if (read_sz < p_reader->chunk_sz)
+  {
+    if (ferror(p_reader->fl))
+    {
+      return ERRCODE_IO_ERROR;
+    }
+    p_reader->is_eof = 1;
+  }
+
+  return 0;
+}
+
+int read_line(st_line_reader* p_reader, char** p_line, size_t* p_line_sz)
+{
+  int res;
+  char* line;
+  char* line_end;
+  size_t searched_sz = 0;
+  size_t line_sz;
+
+  *p_line = NULL;
+  *p_line_sz = 0;
+
+  for (;;)
+  {
+    line_end = 
+      (char*) memchr(p_reader->buf + p_reader->data_beg + searched_sz, '\n', 
+                     p_reader->data_end - p_reader->data_beg - searched_sz);
+    if (line_end != NULL || p_reader->is_eof)
+    {
+      break;
+    }
+
+    // the line continues in the next chunk
+    searched_sz = p_reader->data_end - p_reader->data_beg;
+    res = aux_read_chunk(p_reader);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  line = p_reader->buf + p_reader->data_beg;
+  if (line_end != NULL)
+  {
+    line_sz = line_end - line;
+    p_reader->data_beg += line_sz + 1;
+  }
+  else
+  {
+    // the last line without line end, or the end of stream
+    line_sz = p_reader->data_end - p_reader->data_beg;
+    if (line_sz == 0)
+    {
+      return 0;
+    }
+    p_reader->data_beg = p_reader->data_end;
+  }
+
+  if (line_sz != 0 && line[line_sz - 1] == '\r')
+  {
+    --line_sz;
+  }
+  // there is always place for '\0': after the line end or after the data
+  line[line_sz] = '\0';
+
+  ++p_reader->line_no;
+  *p_line = line;
+  *p_line_sz = line_sz;
+  return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: line_reader.h
+ * 
+ * Reading of text lines of any length from a stream. The stream is read 
+ * in big chunks, lines are returned in place from the reader's buffer.
+ * 
+ */
+#ifndef _MHL_TOOLS_GENERICS_LINE_READER_H_
+#define _MHL_TOOLS_GENERICS_LINE_READER_H_
+
+#include <stdio.h>
+
+#define LINE_READER_DEFAULT_CHUNK_SZ (256 * 1024)
+
+typedef struct _st_line_reader
+{
+  FILE* fl;
+  char* buf;
+  size_t buf_sz;
+  size_t chunk_sz;
+  size_t data_beg; // the first byte, which is not returned yet
+  size_t data_end;
+  unsigned char is_eof;
+  unsigned long line_no; // number of the last returned line
+} st_line_reader;
+
+/*
+ * Inits reader of the stream
+ * @param chunk_sz - size of chunks read at once, 0 for default size.
+ *                   The buffer grows for lines longer than a chunk.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int init_line_reader(st_line_reader* p_reader, FILE* fl, size_t chunk_sz);
+
+/*
+ * Releases buffer of the reader, the stream is not closed
+ */
+void free_line_reader(st_line_reader* p_reader);
+
+/*
+ * Reads the next line. Line ends ("\n" or "\r\n") are not included.
+ * The line is terminated by '\0' and stays valid until the next call; 
+ * it may be modified by the caller.
+ * @param p_line - receives the line, NULL at the end of the stream
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int read_line(st_line_reader* p_reader, char** p_line, size_t* p_line_sz);
+
+#endif //_MHL_TOOLS_GENERICS_LINE_READER_H_
@@ -57,3 +57,91 @@ int increase_allocated_memory(void** buffer, size_t* current_capacity,
   *current_capacity = new_capacity;
   return 0;
 }
+
+#define MEMORY_ARENA_DEFAULT_BLOCK_SZ (256 * 1024)
+#define MEMORY_ARENA_ALIGN(sz) \
+  (((sz) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+
+void
+init_memory_arena(st_memory_arena* p_arena, size_t block_sz)
+{
+  memset(p_arena, 0, sizeof(*p_arena));
+  p_arena->block_sz = 
+    block_sz != 0 ? block_sz : MEMORY_ARENA_DEFAULT_BLOCK_SZ;
+}
+
+void
+free_memory_arena(st_memory_arena* p_arena)
+{
+  st_memory_arena_block* block;
+
+  while (p_arena->blocks != NULL)
+  {
+    block = p_arena->blocks;
+    p_arena->blocks = block->next;
+    free(block);
+  }
+  p_arena->allocated_sz = 0;
+}
+
+void*
+memory_arena_alloc(st_memory_arena* p_arena, size_t sz)
+{
+  size_t header_sz;
+  size_t block_sz;
+  st_memory_arena_block* block;
+  char* data;
+
+  header_sz = MEMORY_ARENA_ALIGN(sizeof(st_memory_arena_block));
+  sz = MEMORY_ARENA_ALIGN(sz);
+  if (p_arena->block_sz == 0)
+  {
+    p_arena->block_sz = MEMORY_ARENA_DEFAULT_BLOCK_SZ;
+  }
+
+  block = p_arena->blocks;
+  if (block == NULL || block->sz - block->used_sz < sz)
+  {
+    block_sz = sz > p_arena->block_sz ? sz : p_arena->block_sz;
+    block = (st_memory_arena_block*) malloc(header_sz + block_sz);
+    if (block == NULL)
+    {
+      return NULL;
+    }
+
+    block->used_sz = 0;
+    block->sz = block_sz;
+    if (sz > p_arena->block_sz && p_arena->blocks != NULL)
+    {
+      // keep the current block for the next small objects
+      block->next = p_arena->blocks->next;
+      p_arena->blocks->next = block;
+    }
+    else
+    {
+      block->next = p_arena->blocks;
+      p_arena->blocks = block;
+    }
+    p_arena->allocated_sz += header_sz + block_sz;
+  }
+
+  data = (char*) block + header_sz + block->used_sz;
+  block->used_sz += sz;
+  return data;
+}
+
+char*
+memory_arena_strndup(st_memory_arena* p_arena, const char* src, size_t sz)
+{
+  char* dst;
+
+  dst = (char*) memory_arena_alloc(p_arena, sz + 1);
+  if (dst == NULL)
+  {
+    return NULL;
+  }
+
+  memcpy(dst, src, sz);
+  dst[sz] = '\0';
+  return dst;
+}
@@ -29,6 +29,8 @@
 #ifndef _MHL_TOOLS_GENERICS_MEMORY_MANAGEMENT_H_
 #define _MHL_TOOLS_GENERICS_MEMORY_MANAGEMENT_H_
 
+#include <stddef.h>
+
 /*
  * Increases the memory allocated for buffer
  * buffer is changed to point to increased memory, current_capacity is changed accordingly 
@@ -45,4 +47,51 @@ int
 increase_allocated_memory(void** buffer, size_t* current_capacity,
   size_t new_capacity, unsigned int item_size);
 
+//
+// Arena of memory for many small objects with the same lifetime.
+// Memory is taken from big blocks and is released all at once, 
+// pointers to allocated objects stay valid until the arena is freed.
+//
+typedef struct _st_memory_arena_block
+{
+  struct _st_memory_arena_block* next;
+  size_t used_sz;
+  size_t sz;
+} st_memory_arena_block;
+
+typedef struct _st_memory_arena
+{
+  st_memory_arena_block* blocks; // the current block is the first one
+  size_t block_sz;
+  size_t allocated_sz;
+} st_memory_arena;
+
+/*
+ * Inits empty arena
+ * @param block_sz - size of arena blocks, 0 for default size.
+ *                   Bigger objects get blocks of their own size.
+ */
+void
+init_memory_arena(st_memory_arena* p_arena, size_t block_sz);
+
+/*
+ * Releases all memory allocated in arena
+ */
+void
+free_memory_arena(st_memory_arena* p_arena);
+
+/*
+ * Allocates memory in arena, aligned to size of pointer.
+ * @return pointer to allocated memory, NULL if memory is out
+ */
+void*
+memory_arena_alloc(st_memory_arena* p_arena, size_t sz);
+
+/*
+ * Copies sz bytes into arena, and adds terminating '\0'
+ * @return pointer to the copy, NULL if memory is out
+ */
+char*
+memory_arena_strndup(st_memory_arena* p_arena, const char* src, size_t sz);
+
 #endif //_MHL_TOOLS_GENERICS_MEMORY_MANAGEMENT_H_
@@ -0,0 +1,428 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: os_threads.c
+ * 
+ * Threads, mutexes and condition variables with the same interface on 
+ * all supported OS.
+ *
+ */
+#include <stdlib.h>
+
+#include <generics/os_check.h>
+#ifndef WIN
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+#include <facade_info/error_codes.h>
+#include <generics/os_threads.h>
+
+typedef struct _st_thread_start
+{
+  MhlThreadFunc func;
+  void* arg;
+} st_thread_start;
+
+#ifdef WIN
+static DWORD WINAPI
+aux_thread_start(LPVOID param)
+{
+  st_thread_start start;
+  
+  start = *(st_thread_start*) param;
+  free(param);
+  
+  start.func(start.arg);
+  return 0;
+}
+
+int mhlosi_thread_create(mhlosi_thread* p_thread, MhlThreadFunc func, 
+                         void* arg)
+{
+  st_thread_start* p_start;
+  
+  p_start = (st_thread_start*) malloc(sizeof(st_thread_start));
+  if (p_start == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  
+  p_start->func = func;
+  p_start->arg = arg;
+  
+  *p_thread = CreateThread(NULL, 0, aux_thread_start, p_start, 0, NULL);
+  if (*p_thread == NULL)
+  {
+    free(p_start);
+    return ERRCODE_INTERNAL_ERROR;
+  }
+  
+  return 0;
+}
+
+void mhlosi_thread_join(mhlosi_thread thread)
+{
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+int mhlosi_mutex_init(mhlosi_mutex* p_mutex)
+{
+  InitializeCriticalSection(p_mutex);
+  return 0;
+}
+
+void mhlosi_mutex_destroy(mhlosi_mutex* p_mutex)
+{
+  DeleteCriticalSection(p_mutex);
+}
+
+void mhlosi_mutex_lock(mhlosi_mutex* p_mutex)
+{
+  EnterCriticalSection(p_mutex);
+}
+
+void mhlosi_mutex_unlock(mhlosi_mutex* p_mutex)
+{
+  LeaveCriticalSection(p_mutex);
+}
+
+int mhlosi_cond_init(mhlosi_cond* p_cond)
+{
+  InitializeConditionVariable(p_cond);
+  return 0;
+}
+
+void mhlosi_cond_destroy(mhlosi_cond* p_cond)
+{
+  // Windows condition variables don't need to be released
+}
+
+void mhlosi_cond_wait(mhlosi_cond* p_cond, mhlosi_mutex* p_mutex)
+{
+  SleepConditionVariableCS(p_cond, p_mutex, INFINITE);
+}
+
+int mhlosi_cond_timedwait(mhlosi_cond* p_cond, mhlosi_mutex* p_mutex, 
+                          unsigned long timeout_ms)
+{
+  return SleepConditionVariableCS(p_cond, p_mutex, timeout_ms) ? 0 : 1;
+}
+
+void mhlosi_cond_signal(mhlosi_cond* p_cond)
+{
+  WakeConditionVariable(p_cond);
+}
+
+void mhlosi_cond_broadcast(mhlosi_cond* p_cond)
+{
+  WakeAllConditionVariable(p_cond);
+}
+
+int mhlosi_tls_create(mhlosi_tls_key* p_key)
+{
+  *p_key = TlsAlloc();
+  return *p_key != TLS_OUT_OF_INDEXES ? 0 : ERRCODE_INTERNAL_ERROR;
+}
+
+void* mhlosi_tls_get(mhlosi_tls_key key)
+{
+  return TlsGetValue(key);
+}
+
+int mhlosi_tls_set(mhlosi_tls_key key, void* value)
+{
+  return TlsSetValue(key, value) ? 0 : ERRCODE_INTERNAL_ERROR;
+}
+
+// function of mhlosi_once() as a pointer to data
+typedef struct _st_once_start
+{
+  MhlOnceFunc func;
+} st_once_start;
+
+static BOOL CALLBACK
+aux_once_start(PINIT_ONCE p_once, PVOID param, PVOID* p_context)
+{
+  ((st_once_start*) param)->func();
+  return TRUE;
+}
+
+void mhlosi_once(mhlosi_once_flag* p_flag, MhlOnceFunc func)
+{
+  st_once_start start;
+
+  start.func = func;
+  InitOnceExecuteOnce(p_flag, aux_once_start, &start, NULL);
+}
+
+unsigned int mhlosi_cpu_count(void)
+{
+  SYSTEM_INFO si;
+  
+  GetSystemInfo(&si);
+  return si.dwNumberOfProcessors > 0 ? (unsigned int) si.dwNumberOfProcessors : 1;
+}
+
+unsigned long long mhlosi_time_ms(void)
+{
+  return GetTickCount64();
+}
+
+unsigned long long mhlosi_time_us(void)
+{
+  LARGE_INTEGER counter;
+  LARGE_INTEGER frequency;
+
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&frequency);
+  return (unsigned long long) 
+    (counter.QuadPart / frequency.QuadPart * 1000000 +
+     counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+}
+
+void mhlosi_atomic_add(volatile unsigned long long* p_counter, 
+                       unsigned long long value)
+{
+  InterlockedExchangeAdd64((volatile LONGLONG*) p_counter, (LONGLONG) value);
+}
+
+unsigned long long mhlosi_atomic_fetch_add(
+  volatile unsigned long long* p_counter, 
+  unsigned long long value)
+{
+  return (unsigned long long) 
+    InterlockedExchangeAdd64((volatile LONGLONG*) p_counter, (LONGLONG) value);
+}
+
+unsigned long long mhlosi_atomic_load(volatile unsigned long long* p_counter)
+{
+  return (unsigned long long) 
+    InterlockedCompareExchange64((volatile LONGLONG*) p_counter, 0, 0);
+}
+
+void mhlosi_atomic_max(volatile unsigned long long* p_counter, 
+                       unsigned long long value)
+{
+  LONGLONG cur;
+  LONGLONG prev;
+
+  cur = InterlockedCompareExchange64((volatile LONGLONG*) p_counter, 0, 0);
+  while ((unsigned long long) cur < value)
+  {
+    prev = 
+      InterlockedCompareExchange64((volatile LONGLONG*) p_counter, 
+                                   (LONGLONG) value, cur);
+    if (prev == cur)
+    {
+      break;
+    }
+    cur = prev;
+  }
+}
+
+#else // Linux, Mac OS X
+
+static void*
+aux_thread_start(void* param)
+{
+  st_thread_start start;
+  
+  start = *(st_thread_start*) param;
+  free(param);
+  
+  start.func(start.arg);
+  return NULL;
+}
+
+int mhlosi_thread_create(mhlosi_thread* p_thread, MhlThreadFunc func, 
+                         void* arg)
+{
+  st_thread_start* p_start;
+  
+  p_start = (st_thread_start*) malloc(sizeof(st_thread_start));
+  if (p_start == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  
+  p_start->func = func;
+  p_start->arg = arg;
+  
+  if (pthread_create(p_thread, NULL, aux_thread_start, p_start) != 0)
+  {
+    free(p_start);
+    return ERRCODE_INTERNAL_ERROR;
+  }
+  
+  return 0;
+}
+
+void mhlosi_thread_join(mhlosi_thread thread)
+{
+  pthread_join(thread, NULL);
+}
+
+int mhlosi_mutex_init(mhlosi_mutex* p_mutex)
+{
+  return pthread_mutex_init(p_mutex, NULL) == 0 ? 0 : ERRCODE_INTERNAL_ERROR;
+}
+
+void mhlosi_mutex_destroy(mhlosi_mutex* p_mutex)
+{
+  pthread_mutex_destroy(p_mutex);
+}
+
+void mhlosi_mutex_lock(mhlosi_mutex* p_mutex)
+{
+  pthread_mutex_lock(p_mutex);
+}
+
+void mhlosi_mutex_unlock(mhlosi_mutex* p_mutex)
+{
+  pthread_mutex_unlock(p_mutex);
+}
+
+int mhlosi_cond_init(mhlosi_cond* p_cond)
+{
+  return pthread_cond_init(p_cond, NULL) == 0 ? 0 : ERRCODE_INTERNAL_ERROR;
+}
+
+void mhlosi_cond_destroy(mhlosi_cond* p_cond)
+{
+  pthread_cond_destroy(p_cond);
+}
+
+void mhlosi_cond_wait(mhlosi_cond* p_cond, mhlosi_mutex* p_mutex)
+{
+  pthread_cond_wait(p_cond, p_mutex);
+}
+
+int mhlosi_cond_timedwait(mhlosi_cond* p_cond, mhlosi_mutex* p_mutex, 
+                          unsigned long timeout_ms)
+{
+  struct timeval now;
+  struct timespec abs_time;
+
+  gettimeofday(&now, NULL);
+  abs_time.tv_sec = now.tv_sec + timeout_ms / 1000;
+  abs_time.tv_nsec = now.tv_usec * 1000 + (timeout_ms % 1000) * 1000000;
+  if (abs_time.tv_nsec >= 1000000000)
+  {
+    ++abs_time.tv_sec;
+    abs_time.tv_nsec -= 1000000000;
+  }
+
+  return pthread_cond_timedwait(p_cond, p_mutex, &abs_time) == 0 ? 0 : 1;
+}
+
+void mhlosi_cond_signal(mhlosi_cond* p_cond)
+{
+  pthread_cond_signal(p_cond);
+}
+
+void mhlosi_cond_broadcast(mhlosi_cond* p_cond)
+{
+  pthread_cond_broadcast(p_cond);
+}
+
+int mhlosi_tls_create(mhlosi_tls_key* p_key)
+{
+  return pthread_key_create(p_key, NULL) == 0 ? 0 : ERRCODE_INTERNAL_ERROR;
+}
+
+void* mhlosi_tls_get(mhlosi_tls_key key)
+{
+  return pthread_getspecific(key);
+}
+
+int mhlosi_tls_set(mhlosi_tls_key key, void* value)
+{
+  return pthread_setspecific(key, value) == 0 ? 0 : ERRCODE_INTERNAL_ERROR;
+}
+
+void mhlosi_once(mhlosi_once_flag* p_flag, MhlOnceFunc func)
+{
+  pthread_once(p_flag, func);
+}
+
+unsigned int mhlosi_cpu_count(void)
+{
+  long n;
+  
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (unsigned int) n : 1;
+}
+
+unsigned long long mhlosi_time_ms(void)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (unsigned long long) now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+unsigned long long mhlosi_time_us(void)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (unsigned long long) now.tv_sec * 1000000 + now.tv_usec;
+}
+
+void mhlosi_atomic_add(volatile unsigned long long* p_counter, 
+                       unsigned long long value)
+{
+  __sync_fetch_and_add(p_counter, value);
+}
+
+unsigned long long mhlosi_atomic_fetch_add(
+  volatile unsigned long long* p_counter, 
+  unsigned long long value)
+{
+  return __sync_fetch_and_add(p_counter, value);
+}
+
+unsigned long long mhlosi_atomic_load(volatile unsigned long long* p_counter)
+{
+  return __sync_fetch_and_add(p_counter, 0);
+}
+
+void mhlosi_atomic_max(volatile unsigned long long* p_counter, 
+                       unsigned long long value)
+{
+  unsigned long long prev;
+
+  prev = *p_counter;
+  while (prev < value && 
+         !__sync_bool_compare_and_swap(p_counter, prev, value))
+  {
+    prev = *p_counter;
+  }
+}
+
+#endif //WIN
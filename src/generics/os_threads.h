@@ -0,0 +1,139 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: os_threads.h
+ * 
+ * Threads, mutexes and condition variables with the same interface on 
+ * all supported OS: POSIX threads on Mac OS X and Linux, native threads 
+ * on Windows.
+ * 
+ */
+#ifndef _MHL_TOOLS_GENERICS_OS_THREADS_H_
+#define _MHL_TOOLS_GENERICS_OS_THREADS_H_
+
+#include <generics/os_check.h>
+
+#ifdef WIN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef WIN
+typedef HANDLE mhlosi_thread;
+typedef CRITICAL_SECTION mhlosi_mutex;
+typedef CONDITION_VARIABLE mhlosi_cond;
+typedef DWORD mhlosi_tls_key;
+typedef INIT_ONCE mhlosi_once_flag;
+#define MHLOSI_ONCE_INIT INIT_ONCE_STATIC_INIT
+#else
+typedef pthread_t mhlosi_thread;
+typedef pthread_mutex_t mhlosi_mutex;
+typedef pthread_cond_t mhlosi_cond;
+typedef pthread_key_t mhlosi_tls_key;
+typedef pthread_once_t mhlosi_once_flag;
+#define MHLOSI_ONCE_INIT PTHREAD_ONCE_INIT
+#endif
+
+typedef void (*MhlThreadFunc)(void* arg);
+
+/* Starts a new thread, which runs func(arg).
+ * @return In case of success: 0.
+ *         In case of failure: ERRCODE_OUT_OF_MEM or ERRCODE_INTERNAL_ERROR.
+ */
+int mhlosi_thread_create(mhlosi_thread* p_thread, MhlThreadFunc func, 
+                         void* arg);
+
+/* Waits for the thread to finish and releases it.
+ */
+void mhlosi_thread_join(mhlosi_thread thread);
+
+int mhlosi_mutex_init(mhlosi_mutex* p_mutex);
+void mhlosi_mutex_destroy(mhlosi_mutex* p_mutex);
+void mhlosi_mutex_lock(mhlosi_mutex* p_mutex);
+void mhlosi_mutex_unlock(mhlosi_mutex* p_mutex);
+
+int mhlosi_cond_init(mhlosi_cond* p_cond);
+void mhlosi_cond_destroy(mhlosi_cond* p_cond);
+void mhlosi_cond_wait(mhlosi_cond* p_cond, mhlosi_mutex* p_mutex);
+/* Waits until the condition is signaled or the timeout expires.
+ * @return 0 if signaled, non zero value on timeout.
+ */
+int mhlosi_cond_timedwait(mhlosi_cond* p_cond, mhlosi_mutex* p_mutex, 
+                          unsigned long timeout_ms);
+void mhlosi_cond_signal(mhlosi_cond* p_cond);
+void mhlosi_cond_broadcast(mhlosi_cond* p_cond);
+
+/* Thread local pointers, NULL in each thread until it sets its value.
+ * @return In case of success: 0.
+ *         In case of failure: ERRCODE_INTERNAL_ERROR.
+ */
+int mhlosi_tls_create(mhlosi_tls_key* p_key);
+void* mhlosi_tls_get(mhlosi_tls_key key);
+int mhlosi_tls_set(mhlosi_tls_key key, void* value);
+
+typedef void (*MhlOnceFunc)(void);
+
+/* Calls func once for the flag, initialized with MHLOSI_ONCE_INIT, 
+ * other threads calling it with the same flag wait until it returns.
+ */
+void mhlosi_once(mhlosi_once_flag* p_flag, MhlOnceFunc func);
+
+/* @return Number of online processors, 1 if it can't be determined.
+ */
+unsigned int mhlosi_cpu_count(void);
+
+/* @return Time in milliseconds from some fixed point, for measuring 
+ *         of intervals.
+ */
+unsigned long long mhlosi_time_ms(void);
+
+/* @return Time in microseconds from some fixed point, for measuring 
+ *         of short intervals.
+ */
+unsigned long long mhlosi_time_us(void);
+
+/* Atomically adds value to the counter, which may be read from other
+ * threads by mhlosi_atomic_load().
+ */
+void mhlosi_atomic_add(volatile unsigned long long* p_counter, 
+                       unsigned long long value);
+
+/* Atomically adds value to the counter.
+ * @return Value of the counter before the addition.
+ */
+unsigned long long mhlosi_atomic_fetch_add(
+  volatile unsigned long long* p_counter, 
+  unsigned long long value);
+
+unsigned long long mhlosi_atomic_load(volatile unsigned long long* p_counter);
+
+/* Atomically sets the counter to the value, if the value is greater.
+ */
+void mhlosi_atomic_max(volatile unsigned long long* p_counter, 
+                       unsigned long long value);
+
+#endif //_MHL_TOOLS_GENERICS_OS_THREADS_H_
@@ -0,0 +1,440 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: perf_stats.c
+ *
+ * Timers and counters of the phases of processing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <generics/os_check.h>
+#ifdef MAC_OS_X
+#include <sys/resource.h>
+#endif
+
+#include <facade_info/error_codes.h>
+#include <generics/os_threads.h>
+#include <generics/perf_stats.h>
+
+// bucket N counts calls, which took from 2^(N-1) to 2^N - 1 microseconds,
+// bucket 0 counts calls, which took less than a microsecond
+#define PERF_HISTOGRAM_SZ 40
+
+// number of the most recent spans kept for each thread
+#define PERF_TRACE_EVENTS_NUM (1 << 16)
+
+typedef struct _st_perf_phase_stats
+{
+  volatile unsigned long long calls;
+  volatile unsigned long long time_us;
+  volatile unsigned long long sz;
+  volatile unsigned long long max_us;
+  volatile unsigned long long histogram[PERF_HISTOGRAM_SZ];
+} st_perf_phase_stats;
+
+typedef struct _st_perf_trace_event
+{
+  unsigned long long beg_us;
+  unsigned long long duration_us;
+  unsigned long long sz;
+  PERF_PHASE phase;
+} st_perf_trace_event;
+
+//
+// Spans of one thread, written only by this thread
+//
+typedef struct _st_perf_trace_buffer
+{
+  struct _st_perf_trace_buffer* next;
+  unsigned int tid;
+  unsigned long long events_num; // all recorded spans, kept or overwritten
+  st_perf_trace_event events[PERF_TRACE_EVENTS_NUM];
+} st_perf_trace_buffer;
+
+static const char* g_phase_names[PP_PHASES_NUM] = 
+{
+  "walk",
+  "stat",
+  "open",
+  "read",
+  "hash",
+  "conversion",
+  "xml_write"
+};
+
+static unsigned char g_is_enabled = 0;
+static unsigned long long g_start_us = 0;
+static st_perf_phase_stats g_phases[PP_PHASES_NUM];
+
+static unsigned char g_is_trace_enabled = 0;
+static unsigned long long g_trace_start_us = 0;
+static mhlosi_tls_key g_trace_key;
+static mhlosi_mutex g_trace_mutex;
+static st_perf_trace_buffer* g_trace_buffers = NULL;
+static unsigned int g_trace_buffers_num = 0;
+
+void perf_stats_enable(void)
+{
+  memset((void*) g_phases, 0, sizeof(g_phases));
+  g_start_us = mhlosi_time_us();
+  g_is_enabled = 1;
+}
+
+int perf_trace_enable(void)
+{
+  int res;
+
+  if (g_is_trace_enabled)
+  {
+    return 0;
+  }
+
+  res = mhlosi_tls_create(&g_trace_key);
+  if (res != 0)
+  {
+    return res;
+  }
+  res = mhlosi_mutex_init(&g_trace_mutex);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  g_trace_start_us = mhlosi_time_us();
+  g_is_trace_enabled = 1;
+  return 0;
+}
+
+unsigned long long perf_stats_begin(void)
+{
+  return g_is_enabled || g_is_trace_enabled ? mhlosi_time_us() : 0;
+}
+
+/* @return Ring buffer of the calling thread, it is created on the first 
+ *         call in the thread. NULL if there is not enough memory.
+ */
+static
+st_perf_trace_buffer*
+aux_get_trace_buffer(void)
+{
+  st_perf_trace_buffer* p_buffer;
+
+  p_buffer = (st_perf_trace_buffer*) mhlosi_tls_get(g_trace_key);
+  if (p_buffer != NULL)
+  {
+    return p_buffer;
+  }
+
+  p_buffer = (st_perf_trace_buffer*) malloc(sizeof(st_perf_trace_buffer));
+  if (p_buffer == NULL)
+  {
+    return NULL;
+  }
+  p_buffer->events_num = 0;
+
+  mhlosi_mutex_lock(&g_trace_mutex);
+  p_buffer->tid = ++g_trace_buffers_num;
+  p_buffer->next = g_trace_buffers;
+  g_trace_buffers = p_buffer;
+  mhlosi_mutex_unlock(&g_trace_mutex);
+
+  mhlosi_tls_set(g_trace_key, p_buffer);
+  return p_buffer;
+}
+
+static
+void
+aux_record_trace_event(PERF_PHASE phase, unsigned long long beg_us, 
+                       unsigned long long duration_us, 
+                       unsigned long long sz)
+{
+  st_perf_trace_buffer* p_buffer;
+  st_perf_trace_event* p_event;
+
+  p_buffer = aux_get_trace_buffer();
+  if (p_buffer == NULL)
+  {
+    return;
+  }
+
+  p_event = 
+    &p_buffer->events[p_buffer->events_num % PERF_TRACE_EVENTS_NUM];
+  p_event->beg_us = beg_us;
+  p_event->duration_us = duration_us;
+  p_event->sz = sz;
+  p_event->phase = phase;
+  ++p_buffer->events_num;
+}
+
+void perf_stats_end(PERF_PHASE phase, unsigned long long beg_us, 
+                    unsigned long long sz)
+{
+  st_perf_phase_stats* p_stats;
+  unsigned long long duration_us;
+  unsigned long long end_us;
+  unsigned int bucket;
+
+  if (beg_us == 0)
+  {
+    return;
+  }
+
+  end_us = mhlosi_time_us();
+  duration_us = end_us > beg_us ? end_us - beg_us : 0;
+  if (g_is_trace_enabled)
+  {
+    aux_record_trace_event(phase, beg_us, duration_us, sz);
+  }
+  if (!g_is_enabled)
+  {
+    return;
+  }
+
+  bucket = 0;
+  while (bucket < PERF_HISTOGRAM_SZ - 1 && (duration_us >> bucket) != 0)
+  {
+    ++bucket;
+  }
+
+  p_stats = &g_phases[phase];
+  mhlosi_atomic_add(&p_stats->calls, 1);
+  mhlosi_atomic_add(&p_stats->time_us, duration_us);
+  mhlosi_atomic_add(&p_stats->sz, sz);
+  mhlosi_atomic_add(&p_stats->histogram[bucket], 1);
+  mhlosi_atomic_max(&p_stats->max_us, duration_us);
+}
+
+/* @return Upper bound of latency of the bucket, which contains the 
+ *         percentile, but not more than the maximal latency.
+ */
+static
+unsigned long long
+aux_percentile_us(const st_perf_phase_stats* p_stats, unsigned int percent)
+{
+  unsigned long long rank;
+  unsigned long long count = 0;
+  unsigned long long upper_us;
+  unsigned int bucket;
+
+  if (p_stats->calls == 0)
+  {
+    return 0;
+  }
+
+  rank = (p_stats->calls * percent + 99) / 100;
+  for (bucket = 0; bucket < PERF_HISTOGRAM_SZ; ++bucket)
+  {
+    count += p_stats->histogram[bucket];
+    if (count >= rank)
+    {
+      break;
+    }
+  }
+
+  upper_us = bucket == 0 ? 0 : (1ULL << bucket) - 1;
+  return upper_us < p_stats->max_us ? upper_us : p_stats->max_us;
+}
+
+static
+void
+aux_write_histogram_json(FILE* file, const st_perf_phase_stats* p_stats)
+{
+  unsigned int bucket;
+  unsigned char is_first = 1;
+
+  fprintf(file, ",\n      \"histogram_us\": [");
+  for (bucket = 0; bucket < PERF_HISTOGRAM_SZ; ++bucket)
+  {
+    if (p_stats->histogram[bucket] == 0)
+    {
+      continue;
+    }
+    fprintf(file, "%s\n        {\"le\": %llu, \"count\": %llu}", 
+            is_first ? "" : ",",
+            bucket == 0 ? 0ULL : (1ULL << bucket) - 1,
+            p_stats->histogram[bucket]);
+    is_first = 0;
+  }
+  fprintf(file, "%s]", is_first ? "" : "\n      ");
+}
+
+/*
+ * @return Peak resident set size of the process in kilobytes,
+ *         0 if it is not known.
+ */
+static unsigned long long aux_peak_rss_kb(void)
+{
+#if defined(MAC_OS_X)
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+  {
+    return 0;
+  }
+  // bytes on Mac OS X
+  return (unsigned long long) usage.ru_maxrss / 1024;
+#elif defined(WIN)
+  return 0;
+#else
+  // ru_maxrss on Linux includes the image of the parent process 
+  // when it was bigger before exec(), VmHWM is of this image only
+  FILE* status;
+  char line[256];
+  unsigned long long rss_kb = 0;
+
+  status = fopen("/proc/self/status", "r");
+  if (status == NULL)
+  {
+    return 0;
+  }
+  while (fgets(line, sizeof(line), status) != NULL)
+  {
+    if (sscanf(line, "VmHWM: %llu", &rss_kb) == 1)
+    {
+      break;
+    }
+  }
+  fclose(status);
+  return rss_kb;
+#endif
+}
+
+int write_perf_stats_json(FILE* file, const char* tool_name)
+{
+  unsigned int phase;
+  const st_perf_phase_stats* p_stats;
+  double time_s;
+  unsigned long long rss_kb;
+
+  fprintf(file, "{\n  \"tool\": \"%s\",\n  \"wall_time_s\": %.6f,\n", 
+          tool_name, (mhlosi_time_us() - g_start_us) / 1e6);
+  rss_kb = aux_peak_rss_kb();
+  if (rss_kb != 0)
+  {
+    fprintf(file, "  \"peak_rss_kb\": %llu,\n", rss_kb);
+  }
+  fprintf(file, "  \"phases\": {");
+
+  for (phase = 0; phase < PP_PHASES_NUM; ++phase)
+  {
+    p_stats = &g_phases[phase];
+    time_s = p_stats->time_us / 1e6;
+    fprintf(file, 
+            "%s\n    \"%s\": {\n"
+            "      \"calls\": %llu,\n"
+            "      \"time_s\": %.6f,\n"
+            "      \"bytes\": %llu,\n"
+            "      \"mb_per_s\": %.1f,\n"
+            "      \"latency_us\": "
+            "{\"p50\": %llu, \"p99\": %llu, \"max\": %llu}",
+            phase == 0 ? "" : ",",
+            g_phase_names[phase],
+            p_stats->calls,
+            time_s,
+            p_stats->sz,
+            time_s > 0 ? p_stats->sz / time_s / (1024 * 1024) : 0.0,
+            aux_percentile_us(p_stats, 50),
+            aux_percentile_us(p_stats, 99),
+            p_stats->max_us);
+    if (phase == PP_OPEN || phase == PP_READ)
+    {
+      aux_write_histogram_json(file, p_stats);
+    }
+    fprintf(file, "\n    }");
+  }
+
+  fprintf(file, "\n  }\n}\n");
+  return ferror(file) ? ERRCODE_IO_ERROR : 0;
+}
+
+int write_perf_trace_json(FILE* file, const char* tool_name)
+{
+  const st_perf_trace_buffer* p_buffer;
+  const st_perf_trace_event* p_event;
+  unsigned long long first;
+  unsigned long long i;
+  unsigned long long dropped_num = 0;
+
+  fprintf(file, "{\"displayTimeUnit\": \"ms\",\n\"traceEvents\": [\n"
+          "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+          "\"tid\": 0, \"args\": {\"name\": \"%s\"}}", tool_name);
+
+  for (p_buffer = g_trace_buffers; p_buffer != NULL; p_buffer = p_buffer->next)
+  {
+    fprintf(file, 
+            ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+            p_buffer->tid, p_buffer->tid);
+
+    first = 0;
+    if (p_buffer->events_num > PERF_TRACE_EVENTS_NUM)
+    {
+      first = p_buffer->events_num - PERF_TRACE_EVENTS_NUM;
+      dropped_num += first;
+    }
+
+    for (i = first; i < p_buffer->events_num; ++i)
+    {
+      p_event = &p_buffer->events[i % PERF_TRACE_EVENTS_NUM];
+      fprintf(file, 
+              ",\n{\"name\": \"%s\", \"cat\": \"mhl\", \"ph\": \"X\", "
+              "\"ts\": %llu, \"dur\": %llu, \"pid\": 1, \"tid\": %u, "
+              "\"args\": {\"bytes\": %llu}}",
+              g_phase_names[p_event->phase],
+              p_event->beg_us > g_trace_start_us ? 
+                p_event->beg_us - g_trace_start_us : 0ULL,
+              p_event->duration_us,
+              p_buffer->tid,
+              p_event->sz);
+    }
+  }
+
+  fprintf(file, "\n],\n\"otherData\": {\"dropped_events\": %llu}}\n", 
+          dropped_num);
+  return ferror(file) ? ERRCODE_IO_ERROR : 0;
+}
+
+void free_perf_trace(void)
+{
+  st_perf_trace_buffer* p_buffer;
+
+  if (!g_is_trace_enabled)
+  {
+    return;
+  }
+
+  g_is_trace_enabled = 0;
+  while (g_trace_buffers != NULL)
+  {
+    p_buffer = g_trace_buffers;
+    g_trace_buffers = p_buffer->next;
+    free(p_buffer);
+  }
+  mhlosi_mutex_destroy(&g_trace_mutex);
+}
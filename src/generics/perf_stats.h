@@ -0,0 +1,95 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: perf_stats.h
+ *
+ * Timers and counters of the phases of processing: traversal of folders, 
+ * stat calls, opening and reading of files, hashing, character 
+ * conversion and writing of MHL files. Statistics are collected only 
+ * after perf_stats_enable() and may be updated from several threads.
+ * After perf_trace_enable() the same calls are recorded as spans of
+ * their threads for viewing in chrome://tracing or Perfetto.
+ */
+#ifndef _MHL_TOOLS_GENERICS_PERF_STATS_H_
+#define _MHL_TOOLS_GENERICS_PERF_STATS_H_
+
+#include <stdio.h>
+
+typedef enum _PERF_PHASE
+{
+  PP_WALK = 0,    // reading of folder entries
+  PP_STAT,
+  PP_OPEN,        // opening of files for reading
+  PP_READ,
+  PP_HASH,
+  PP_CONVERSION,  // character conversion
+  PP_XML_WRITE,   // writing of MHL files
+  PP_PHASES_NUM
+} PERF_PHASE;
+
+/* Starts collecting of statistics.
+ */
+void perf_stats_enable(void);
+
+/* Starts recording of spans. Each thread keeps its own ring buffer 
+ * of the most recent spans, so threads don't wait for each other.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int perf_trace_enable(void);
+
+/* @return Start time of the measured call, 0 if neither statistics
+ *         are collected nor spans are recorded.
+ */
+unsigned long long perf_stats_begin(void);
+
+/* Counts the call of the phase, which started at the time returned 
+ * by perf_stats_begin(). Nothing is done if the time is 0.
+ * @param sz - number of processed bytes
+ */
+void perf_stats_end(PERF_PHASE phase, unsigned long long beg_us, 
+                    unsigned long long sz);
+
+/* Writes collected statistics as JSON object: time, throughput and
+ * latency percentiles of each phase, latency histograms of opening 
+ * and reading of files.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int write_perf_stats_json(FILE* file, const char* tool_name);
+
+/* Writes recorded spans in Trace Event Format. Must be called when
+ * the threads, which recorded spans, are finished.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int write_perf_trace_json(FILE* file, const char* tool_name);
+
+/* Releases ring buffers of recorded spans.
+ */
+void free_perf_trace(void);
+
+#endif //_MHL_TOOLS_GENERICS_PERF_STATS_H_
@@ -0,0 +1,1155 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+/*
+ * @file: libmhl.c
+ *
+ * C API of the MHL tool, see libmhl.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <facade_info/error_codes.h>
+#include <facade_info/version.h>
+#include <generics/char_conversions.h>
+#include <generics/error_output.h>
+#include <generics/memory_management.h>
+#include <generics/std_funcs_os_anonymizer.h>
+#include <generics/filesystem_handlers/public_interface.h>
+#include <mhltools_common/hashing.h>
+#include <mhltools_common/logging.h>
+#include <parsemhl/mhl_file_handlers.h>
+#include <printmhl/mhl_creator.h>
+#include <printmhl/print_mhl.h>
+#include <libmhl/libmhl.h>
+
+#define LIBMHL_READ_BUFF_SZ (256 * 1024)
+#define LIBMHL_ENTRY_HASHES_BUFF_NUM 8
+
+struct _st_libmhl_context
+{
+  st_conversion_settings cs;
+
+  // error messages of calls with the context, dropped without callback
+  st_error_output error_output;
+
+  // user and host info for all MHL files of the context,
+  // login_name_str, full_name_str and host_name_str are used only
+  st_creator_data creator_data;
+  unsigned char is_creator_data_filled;
+};
+
+struct _st_libmhl_hasher
+{
+  st_hash_strings_state* p_state;
+};
+
+struct _st_libmhl_builder
+{
+  st_libmhl_context* p_ctx;
+  st_mhlcreate_data mhlcreate_data;
+  st_verbose_data v_data;
+  unsigned char is_written;
+};
+
+const char* libmhl_version(void)
+{
+  return VERSION;
+}
+
+const char* libmhl_error_description(int error_code)
+{
+  switch (error_code)
+  {
+    case LIBMHL_OK:
+      return "No error.";
+
+    case LIBMHL_ERR_WRONG_ARGUMENTS:
+      return "Wrong or incompatible arguments are passed.";
+
+    case LIBMHL_ERR_NO_SUCH_FILE:
+      return "File does not exist.";
+
+    case LIBMHL_ERR_NOT_FILE:
+      return "Path is not a file.";
+
+    case LIBMHL_ERR_IO:
+      return "IO error occured.";
+
+    case LIBMHL_ERR_OUT_OF_MEM:
+      return "Out of memory.";
+
+    case LIBMHL_ERR_CHARS_CONVERSION:
+      return "Error during conversion of character encodings.";
+
+    case LIBMHL_ERR_WRONG_FILE_LOCATION:
+      return "File is not in the folder of MHL file or its subfolders.";
+
+    case LIBMHL_ERR_MHL_FORMAT:
+      return "Wrong or unsupported MHL file format.";
+
+    case LIBMHL_ERR_SIZE_MISMATCH:
+      return "Real file size and the size contained "
+             "in MHL file entry are not equal.";
+
+    case LIBMHL_ERR_HASH_MISMATCH:
+      return "Calculated hash of file and "
+             "hash from MHL file entry are not equal.";
+
+    case LIBMHL_ERR_INTERNAL:
+      return "Internal error occured.";
+
+    default:
+      return "Unknown error.";
+  }
+}
+
+/* Maps error code of the tool into LIBMHL_ERR_* code of the API.
+ */
+static int
+aux_libmhl_error(int res)
+{
+  switch (res)
+  {
+    case 0:
+      return LIBMHL_OK;
+
+    case ERRCODE_WRONG_ARGUMENTS:
+      return LIBMHL_ERR_WRONG_ARGUMENTS;
+
+    case ERRCODE_NO_SUCH_FILE:
+    case ERRCODE_MHL_NOT_FOUND:
+      return LIBMHL_ERR_NO_SUCH_FILE;
+
+    case ERRCODE_NOT_FILE:
+      return LIBMHL_ERR_NOT_FILE;
+
+    case ERRCODE_IO_ERROR:
+      return LIBMHL_ERR_IO;
+
+    case ERRCODE_OUT_OF_MEM:
+      return LIBMHL_ERR_OUT_OF_MEM;
+
+    case ERRCODE_CHARS_CONVERSION_ERROR:
+      return LIBMHL_ERR_CHARS_CONVERSION;
+
+    case ERRCODE_WRONG_FILE_LOCATION:
+      return LIBMHL_ERR_WRONG_FILE_LOCATION;
+
+    case ERRCODE_WRONG_INPUT_FORMAT:
+    case ERRCODE_UNRECOGNIZED_TIME:
+    case ERRCODE_WRONG_MHL_FORMAT:
+    case ERRCODE_MHL_PARSE_ERROR_UNSUPPORTED_ENCODING:
+      return LIBMHL_ERR_MHL_FORMAT;
+
+    case ERRCODE_MHL_CHECK_FILE_SIZE_FAILED:
+      return LIBMHL_ERR_SIZE_MISMATCH;
+
+    case ERRCODE_MHL_CHECK_HASH_FAILED:
+      return LIBMHL_ERR_HASH_MISMATCH;
+
+    case ERRCODE_INTERNAL_ERROR:
+    case ERRCODE_OPENSSL_ERROR:
+    case ERRCODE_INITXXHASH_ERROR:
+    case ERRCODE_NOT_IMPLEMENTED:
+      return LIBMHL_ERR_INTERNAL;
+
+    default:
+      return LIBMHL_ERR_UNKNOWN;
+  }
+}
+
+/* @return Code returned by a callback in order to stop the call, 
+ *         otherwise LIBMHL_ERR_* code for error code of the tool
+ */
+static int
+aux_libmhl_result(int res, int callback_res)
+{
+  return callback_res != 0 ? callback_res : aux_libmhl_error(res);
+}
+
+static MHL_HASH_TYPE
+aux_mhl_hash_type(LIBMHL_HASH_TYPE hash_type)
+{
+  switch (hash_type)
+  {
+    case LIBMHL_HT_MD5:
+      return MHL_HT_MD5;
+
+    case LIBMHL_HT_SHA1:
+      return MHL_HT_SHA1;
+
+    case LIBMHL_HT_XXHASH:
+      return MHL_HT_XXHASH;
+
+    case LIBMHL_HT_XXHASH64:
+      return MHL_HT_XXHASH64;
+
+    case LIBMHL_HT_XXHASH64BE:
+      return MHL_HT_XXHASH64BE;
+
+    case LIBMHL_HT_NULL:
+      return MHL_HT_NULL;
+
+    default:
+      return MHL_HT_UNRECOGNIZED;
+  }
+}
+
+static LIBMHL_HASH_TYPE
+aux_libmhl_hash_type(MHL_HASH_TYPE hash_type)
+{
+  switch (hash_type)
+  {
+    case MHL_HT_MD5:
+      return LIBMHL_HT_MD5;
+
+    case MHL_HT_SHA1:
+      return LIBMHL_HT_SHA1;
+
+    case MHL_HT_XXHASH:
+      return LIBMHL_HT_XXHASH;
+
+    case MHL_HT_XXHASH64:
+      return LIBMHL_HT_XXHASH64;
+
+    case MHL_HT_XXHASH64BE:
+      return LIBMHL_HT_XXHASH64BE;
+
+    case MHL_HT_NULL:
+      return LIBMHL_HT_NULL;
+
+    default:
+      return LIBMHL_HT_UNRECOGNIZED;
+  }
+}
+
+/* Converts hash types of API call into hash types of the tool.
+ * @param p_mhl_hash_types - receives the types, release them via free()
+ */
+static int
+aux_make_mhl_hash_types(
+  const LIBMHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  MHL_HASH_TYPE** p_mhl_hash_types)
+{
+  size_t i;
+
+  *p_mhl_hash_types = NULL;
+  if (hash_types == NULL || hashes_num == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  *p_mhl_hash_types = 
+    (MHL_HASH_TYPE*) calloc(hashes_num, sizeof(MHL_HASH_TYPE));
+  if (*p_mhl_hash_types == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  for (i = 0; i < hashes_num; ++i)
+  {
+    (*p_mhl_hash_types)[i] = aux_mhl_hash_type(hash_types[i]);
+  }
+  return 0;
+}
+
+/* Converts UTF-8 path of API call into wide char path of the OS.
+ */
+static int
+aux_u8path_to_wpath(
+  st_libmhl_context* p_ctx,
+  const char* u8path,
+  wchar_t** p_wpath)
+{
+  int res;
+  size_t wpath_sz;
+
+  *p_wpath = NULL;
+  if (u8path == NULL || u8path[0] == '\0')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  res = convert_from_utf8_to_wchar(u8path, strlen(u8path), p_wpath, 
+                                   &wpath_sz, &p_ctx->cs);
+  if (res != 0)
+  {
+    free(*p_wpath);
+    *p_wpath = NULL;
+    return res;
+  }
+
+  make_wpath_os_specific(*p_wpath);
+  return 0;
+}
+
+/* Redirects error messages of the calling thread to the error callback
+ * of the context for the time of API call, nested calls of other 
+ * libraries and of the application keep their output.
+ * @return Previous output of the thread, pass it to aux_end_call()
+ */
+static st_error_output*
+aux_begin_call(st_libmhl_context* p_ctx)
+{
+  return set_thread_error_output(&p_ctx->error_output);
+}
+
+static void
+aux_end_call(st_error_output* p_prev_output)
+{
+  set_thread_error_output(p_prev_output);
+}
+
+//
+// Context
+//
+
+int libmhl_create_context(st_libmhl_context** pp_ctx)
+{
+  int res;
+  st_libmhl_context* p_ctx;
+
+  if (pp_ctx == NULL)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  *pp_ctx = NULL;
+  p_ctx = (st_libmhl_context*) calloc(1, sizeof(st_libmhl_context));
+  if (p_ctx == NULL)
+  {
+    return LIBMHL_ERR_OUT_OF_MEM;
+  }
+
+  res = init_st_conversion_settings(&p_ctx->cs);
+  if (res != 0)
+  {
+    free_st_conversion_settings(&p_ctx->cs);
+    free(p_ctx);
+    return aux_libmhl_error(res);
+  }
+
+  *pp_ctx = p_ctx;
+  return LIBMHL_OK;
+}
+
+void libmhl_free_context(st_libmhl_context* p_ctx)
+{
+  if (p_ctx == NULL)
+  {
+    return;
+  }
+
+  free_st_conversion_settings(&p_ctx->cs);
+  free(p_ctx->creator_data.login_name_str);
+  free(p_ctx->creator_data.full_name_str);
+  free(p_ctx->creator_data.host_name_str);
+  free(p_ctx);
+}
+
+void libmhl_set_error_callback(
+  st_libmhl_context* p_ctx,
+  LibmhlErrorCallback callback,
+  void* data)
+{
+  if (p_ctx == NULL)
+  {
+    return;
+  }
+
+  p_ctx->error_output.handler = callback;
+  p_ctx->error_output.data = data;
+}
+
+//
+// Hashing
+//
+
+void libmhl_free_hash_strs(char** hash_strs, size_t hashes_num)
+{
+  size_t i;
+
+  if (hash_strs == NULL)
+  {
+    return;
+  }
+
+  for (i = 0; i < hashes_num; ++i)
+  {
+    free(hash_strs[i]);
+    hash_strs[i] = NULL;
+  }
+}
+
+/* Reads file once and calculates hashes of all the types, reports 
+ * progress each LIBMHL_PROGRESS_STEP_SZ bytes.
+ * @param p_callback_res - receives not null code, returned by the progress
+ *                         callback in order to stop reading, or 0
+ */
+static int
+aux_hash_wfile(
+  const wchar_t* wpath,
+  const MHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  char** hash_strs,
+  unsigned long long* p_file_sz,
+  LibmhlProgressCallback progress,
+  void* progress_data,
+  int* p_callback_res)
+{
+  int res;
+  FILE* fd;
+  unsigned char* buff;
+  size_t bytes_read;
+  unsigned long long total_sz;
+  unsigned long long processed_sz;
+  unsigned long long reported_sz;
+  st_hash_strings_state* p_state;
+
+  *p_callback_res = 0;
+  if (!does_wpath_exist(wpath))
+  {
+    return ERRCODE_NO_SUCH_FILE;
+  }
+
+  res = get_wfile_size(wpath, &total_sz);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = create_hash_strings_state(hash_types, hashes_num, &p_state);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  buff = (unsigned char*) malloc(LIBMHL_READ_BUFF_SZ);
+  if (buff == NULL)
+  {
+    free_hash_strings_state(p_state);
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  fd = fwopen_for_hash_check(wpath);
+  if (fd == NULL)
+  {
+    free(buff);
+    free_hash_strings_state(p_state);
+    return ERRCODE_IO_ERROR;
+  }
+
+  processed_sz = 0;
+  reported_sz = 0;
+  if (progress != NULL)
+  {
+    res = progress(0, total_sz, progress_data);
+    *p_callback_res = res;
+  }
+
+  while (res == 0)
+  {
+    bytes_read = fread(buff, 1, LIBMHL_READ_BUFF_SZ, fd);
+    if (bytes_read == 0)
+    {
+      if (!feof(fd))
+      {
+        res = ERRCODE_IO_ERROR;
+      }
+      break;
+    }
+
+    res = update_hash_strings_state(p_state, buff, bytes_read);
+    processed_sz += bytes_read;
+
+    if (res == 0 && progress != NULL && 
+        processed_sz - reported_sz >= LIBMHL_PROGRESS_STEP_SZ)
+    {
+      reported_sz = processed_sz;
+      res = progress(processed_sz, total_sz, progress_data);
+      *p_callback_res = res;
+    }
+  }
+  fclose(fd);
+  free(buff);
+
+  if (res == 0 && progress != NULL && processed_sz != reported_sz)
+  {
+    res = progress(processed_sz, total_sz, progress_data);
+    *p_callback_res = res;
+  }
+
+  if (res == 0)
+  {
+    res = finish_hash_strings_state(p_state, hash_strs);
+  }
+  free_hash_strings_state(p_state);
+
+  if (res == 0 && p_file_sz != NULL)
+  {
+    *p_file_sz = processed_sz;
+  }
+  return res;
+}
+
+int libmhl_hash_file(
+  st_libmhl_context* p_ctx,
+  const char* u8path,
+  const LIBMHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  char** hash_strs,
+  unsigned long long* p_file_sz,
+  LibmhlProgressCallback progress,
+  void* progress_data)
+{
+  int res;
+  int callback_res = 0;
+  wchar_t* wpath = NULL;
+  MHL_HASH_TYPE* mhl_hash_types;
+  st_error_output* p_prev_output;
+
+  if (p_ctx == NULL || hash_strs == NULL)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  p_prev_output = aux_begin_call(p_ctx);
+  res = aux_make_mhl_hash_types(hash_types, hashes_num, &mhl_hash_types);
+  if (res == 0)
+  {
+    res = aux_u8path_to_wpath(p_ctx, u8path, &wpath);
+  }
+
+  if (res == 0)
+  {
+    res = aux_hash_wfile(wpath, mhl_hash_types, hashes_num, hash_strs, 
+                         p_file_sz, progress, progress_data, &callback_res);
+  }
+
+  free(wpath);
+  free(mhl_hash_types);
+  aux_end_call(p_prev_output);
+  return aux_libmhl_result(res, callback_res);
+}
+
+int libmhl_create_hasher(
+  const LIBMHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  st_libmhl_hasher** pp_hasher)
+{
+  int res;
+  st_libmhl_hasher* p_hasher;
+  MHL_HASH_TYPE* mhl_hash_types;
+
+  if (pp_hasher == NULL)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  *pp_hasher = NULL;
+  res = aux_make_mhl_hash_types(hash_types, hashes_num, &mhl_hash_types);
+  if (res != 0)
+  {
+    return aux_libmhl_error(res);
+  }
+
+  p_hasher = (st_libmhl_hasher*) calloc(1, sizeof(st_libmhl_hasher));
+  if (p_hasher == NULL)
+  {
+    free(mhl_hash_types);
+    return LIBMHL_ERR_OUT_OF_MEM;
+  }
+
+  res = create_hash_strings_state(mhl_hash_types, hashes_num, 
+                                  &p_hasher->p_state);
+  free(mhl_hash_types);
+  if (res != 0)
+  {
+    free(p_hasher);
+    return aux_libmhl_error(res);
+  }
+
+  *pp_hasher = p_hasher;
+  return LIBMHL_OK;
+}
+
+int libmhl_update_hasher(
+  st_libmhl_hasher* p_hasher,
+  const void* data,
+  size_t data_sz)
+{
+  if (p_hasher == NULL || p_hasher->p_state == NULL || 
+      (data == NULL && data_sz != 0))
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  return aux_libmhl_error(
+    update_hash_strings_state(p_hasher->p_state, 
+                              (const unsigned char*) data, data_sz));
+}
+
+int libmhl_finish_hasher(st_libmhl_hasher* p_hasher, char** hash_strs)
+{
+  int res;
+
+  if (p_hasher == NULL || p_hasher->p_state == NULL || hash_strs == NULL)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  res = finish_hash_strings_state(p_hasher->p_state, hash_strs);
+  free_hash_strings_state(p_hasher->p_state);
+  p_hasher->p_state = NULL;
+  return aux_libmhl_error(res);
+}
+
+void libmhl_free_hasher(st_libmhl_hasher* p_hasher)
+{
+  if (p_hasher == NULL)
+  {
+    return;
+  }
+
+  free_hash_strings_state(p_hasher->p_state);
+  free(p_hasher);
+}
+
+//
+// Building of MHL files
+//
+
+int libmhl_create_builder(
+  st_libmhl_context* p_ctx,
+  const char* u8_mhl_dir,
+  unsigned char is_gzip,
+  st_libmhl_builder** pp_builder)
+{
+  int res;
+  st_libmhl_builder* p_builder;
+  st_mhlcreate_data* p_data;
+  struct tm start_gmtm;
+  st_error_output* p_prev_output;
+
+  if (p_ctx == NULL || pp_builder == NULL)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  *pp_builder = NULL;
+  p_builder = (st_libmhl_builder*) calloc(1, sizeof(st_libmhl_builder));
+  if (p_builder == NULL)
+  {
+    return LIBMHL_ERR_OUT_OF_MEM;
+  }
+  p_builder->p_ctx = p_ctx;
+  p_data = &p_builder->mhlcreate_data;
+
+  p_prev_output = aux_begin_call(p_ctx);
+  res = init_mhlcreate_data(p_data, &p_builder->v_data);
+  if (res != 0)
+  {
+    aux_end_call(p_prev_output);
+    free(p_builder);
+    return aux_libmhl_error(res);
+  }
+
+  res = increase_allocated_memory(
+    (void**) &p_data->mhl_paths.mhl_files_data,
+    &p_data->mhl_paths.mhl_files_data_capacity,
+    1,
+    sizeof(st_mhl_file_data));
+  if (res == 0)
+  {
+    p_data->mhl_paths.mhl_files_data_cnt = 1;
+    p_data->mhl_paths.gzip_output = is_gzip ? 1 : 0;
+    res = aux_u8path_to_wpath(p_ctx, u8_mhl_dir, 
+                              &p_data->mhl_paths.mhl_files_data->mhl_wdirname);
+  }
+
+  if (res == 0)
+  {
+    res = get_xml_date(&p_data->creator_data.startdate_str, &start_gmtm);
+  }
+
+  if (res == 0)
+  {
+    res = date_to_log_str(&p_data->creator_data.startdate_log_str, 
+                          &start_gmtm);
+  }
+
+  if (res == 0)
+  {
+    res = preprocess_mhlcreate_data(p_data, &start_gmtm, &p_ctx->cs);
+  }
+
+  aux_end_call(p_prev_output);
+  if (res != 0)
+  {
+    libmhl_free_builder(p_builder);
+    return aux_libmhl_error(res);
+  }
+
+  *pp_builder = p_builder;
+  return LIBMHL_OK;
+}
+
+/* Checks hash types of a file for MHL file: supported and different 
+ * ones, as MHL file has one element per hash type.
+ */
+static int
+aux_check_builder_hash_types(
+  const MHL_HASH_TYPE* hash_types,
+  size_t hashes_num)
+{
+  size_t i;
+  size_t j;
+
+  for (i = 0; i < hashes_num; ++i)
+  {
+    switch (hash_types[i])
+    {
+      case MHL_HT_MD5:
+      case MHL_HT_SHA1:
+      case MHL_HT_XXHASH:
+      case MHL_HT_XXHASH64:
+      case MHL_HT_XXHASH64BE:
+        break;
+
+      default:
+        return ERRCODE_WRONG_ARGUMENTS;
+    }
+
+    for (j = 0; j < i; ++j)
+    {
+      if (hash_types[j] == hash_types[i])
+      {
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int libmhl_add_file_to_builder(
+  st_libmhl_builder* p_builder,
+  const char* u8path,
+  const LIBMHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  LibmhlProgressCallback progress,
+  void* progress_data)
+{
+  int res;
+  int callback_res = 0;
+  wchar_t* wpath = NULL;
+  char** hash_strs = NULL;
+  MHL_HASH_TYPE* mhl_hash_types;
+  st_error_output* p_prev_output;
+
+  if (p_builder == NULL || p_builder->is_written)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  p_prev_output = aux_begin_call(p_builder->p_ctx);
+  res = aux_make_mhl_hash_types(hash_types, hashes_num, &mhl_hash_types);
+  if (res == 0)
+  {
+    res = aux_check_builder_hash_types(mhl_hash_types, hashes_num);
+  }
+
+  if (res == 0)
+  {
+    hash_strs = (char**) calloc(hashes_num, sizeof(char*));
+    if (hash_strs == NULL)
+    {
+      res = ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  if (res == 0)
+  {
+    res = aux_u8path_to_wpath(p_builder->p_ctx, u8path, &wpath);
+  }
+
+  if (res == 0)
+  {
+    res = aux_hash_wfile(wpath, mhl_hash_types, hashes_num, hash_strs, NULL, 
+                         progress, progress_data, &callback_res);
+  }
+
+  if (res == 0)
+  {
+    res = add_file_hashes_to_mhlcreate_data(&p_builder->mhlcreate_data, 
+                                            wpath, mhl_hash_types, 
+                                            (const char* const*) hash_strs, 
+                                            hashes_num, &p_builder->p_ctx->cs);
+  }
+
+  libmhl_free_hash_strs(hash_strs, hashes_num);
+  free(hash_strs);
+  free(wpath);
+  free(mhl_hash_types);
+  aux_end_call(p_prev_output);
+  return aux_libmhl_result(res, callback_res);
+}
+
+int libmhl_add_entry_to_builder(
+  st_libmhl_builder* p_builder,
+  const char* u8path,
+  const LIBMHL_HASH_TYPE* hash_types,
+  const char* const* hash_strs,
+  size_t hashes_num)
+{
+  int res;
+  size_t i;
+  wchar_t* wpath = NULL;
+  MHL_HASH_TYPE* mhl_hash_types;
+  st_error_output* p_prev_output;
+
+  if (p_builder == NULL || p_builder->is_written || hash_strs == NULL)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  p_prev_output = aux_begin_call(p_builder->p_ctx);
+  res = aux_make_mhl_hash_types(hash_types, hashes_num, &mhl_hash_types);
+  if (res == 0)
+  {
+    res = aux_check_builder_hash_types(mhl_hash_types, hashes_num);
+  }
+
+  for (i = 0; res == 0 && i < hashes_num; ++i)
+  {
+    if (hash_strs[i] == NULL)
+    {
+      res = ERRCODE_WRONG_ARGUMENTS;
+    }
+  }
+
+  if (res == 0)
+  {
+    res = aux_u8path_to_wpath(p_builder->p_ctx, u8path, &wpath);
+  }
+
+  if (res == 0)
+  {
+    res = add_file_hashes_to_mhlcreate_data(&p_builder->mhlcreate_data, 
+                                            wpath, mhl_hash_types, hash_strs, 
+                                            hashes_num, &p_builder->p_ctx->cs);
+  }
+
+  free(wpath);
+  free(mhl_hash_types);
+  aux_end_call(p_prev_output);
+  return aux_libmhl_error(res);
+}
+
+/* Copies user and host info of the context into creator data of MHL 
+ * file, the info is looked up for the first MHL file of the context.
+ */
+static int
+aux_fill_creator_data(st_libmhl_builder* p_builder)
+{
+  int res;
+  st_libmhl_context* p_ctx = p_builder->p_ctx;
+  st_creator_data* p_creator_data = 
+    &p_builder->mhlcreate_data.creator_data;
+
+  if (!p_ctx->is_creator_data_filled)
+  {
+    res = fill_user_and_host_info(&p_ctx->creator_data, &p_builder->v_data, 
+                                  &p_ctx->cs);
+    if (res != 0)
+    {
+      return res;
+    }
+    p_ctx->is_creator_data_filled = 1;
+  }
+
+  if (p_ctx->creator_data.login_name_str != NULL)
+  {
+    p_creator_data->login_name_str = 
+      mhlosi_strdup(p_ctx->creator_data.login_name_str);
+    if (p_creator_data->login_name_str == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  if (p_ctx->creator_data.full_name_str != NULL)
+  {
+    p_creator_data->full_name_str = 
+      mhlosi_strdup(p_ctx->creator_data.full_name_str);
+    if (p_creator_data->full_name_str == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  if (p_ctx->creator_data.host_name_str != NULL)
+  {
+    p_creator_data->host_name_str = 
+      mhlosi_strdup(p_ctx->creator_data.host_name_str);
+    if (p_creator_data->host_name_str == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  return 0;
+}
+
+int libmhl_write_builder(st_libmhl_builder* p_builder, char** pp_u8_mhl_path)
+{
+  int res;
+  struct tm finish_gmtm;
+  st_mhlcreate_data* p_data;
+  const wchar_t* mhl_wpath;
+  size_t u8_mhl_path_sz;
+  st_error_output* p_prev_output;
+
+  if (pp_u8_mhl_path != NULL)
+  {
+    *pp_u8_mhl_path = NULL;
+  }
+
+  if (p_builder == NULL || p_builder->is_written)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  p_data = &p_builder->mhlcreate_data;
+  if (p_data->input_data.files_data_cnt == 0)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+  p_builder->is_written = 1;
+
+  p_prev_output = aux_begin_call(p_builder->p_ctx);
+  res = get_xml_date(&p_data->creator_data.finishdate_str, &finish_gmtm);
+  if (res == 0)
+  {
+    res = date_to_log_str(&p_data->creator_data.finishdate_log_str, 
+                          &finish_gmtm);
+  }
+
+  if (res == 0)
+  {
+    res = aux_fill_creator_data(p_builder);
+  }
+
+  if (res == 0)
+  {
+    res = create_mhl_files(p_data, &p_builder->p_ctx->cs);
+  }
+
+  if (res == 0 && pp_u8_mhl_path != NULL)
+  {
+    mhl_wpath = p_data->mhl_paths.mhl_files_data->mhl_wpath;
+    res = convert_from_wchar_to_utf8(mhl_wpath, wcslen(mhl_wpath), 
+                                     pp_u8_mhl_path, &u8_mhl_path_sz, 
+                                     &p_builder->p_ctx->cs);
+  }
+
+  aux_end_call(p_prev_output);
+  return aux_libmhl_error(res);
+}
+
+void libmhl_free_builder(st_libmhl_builder* p_builder)
+{
+  if (p_builder == NULL)
+  {
+    return;
+  }
+
+  finalize_mhlcreate_data(&p_builder->mhlcreate_data);
+  free(p_builder);
+}
+
+//
+// Parsing and verification
+//
+
+typedef struct _st_libmhl_parse_data
+{
+  LibmhlEntryCallback callback;
+  void* data;
+  // not null code, returned by the callback in order to stop parsing
+  int callback_res;
+} st_libmhl_parse_data;
+
+static int
+aux_pass_entry(const st_mhl_file_u8item* p_u8item, void* data)
+{
+  st_libmhl_parse_data* p_parse_data = (st_libmhl_parse_data*) data;
+  st_libmhl_entry entry;
+  st_libmhl_hash hashes_buf[LIBMHL_ENTRY_HASHES_BUFF_NUM];
+  st_libmhl_hash* hashes = hashes_buf;
+  unsigned int i;
+
+  if (p_u8item->hashes_num > LIBMHL_ENTRY_HASHES_BUFF_NUM)
+  {
+    hashes = (st_libmhl_hash*) malloc(p_u8item->hashes_num * 
+                                      sizeof(st_libmhl_hash));
+    if (hashes == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  for (i = 0; i < p_u8item->hashes_num; ++i)
+  {
+    hashes[i].hash_type = aux_libmhl_hash_type(p_u8item->hashes[i].hash_type);
+    hashes[i].u8str_hash_sum = p_u8item->hashes[i].u8str_hash_sum;
+  }
+
+  entry.abs_u8path = p_u8item->abs_u8path;
+  entry.hash_type = aux_libmhl_hash_type(p_u8item->hash_type);
+  entry.u8str_hash_sum = p_u8item->u8str_hash_sum;
+  entry.file_sz = p_u8item->file_sz;
+  entry.is_mhl_file = p_u8item->data_type == MHL_IT_MHL_FILE;
+  entry.hashes = hashes;
+  entry.hashes_num = p_u8item->hashes_num;
+
+  p_parse_data->callback_res = 
+    p_parse_data->callback(&entry, p_parse_data->data);
+
+  if (hashes != hashes_buf)
+  {
+    free(hashes);
+  }
+  return p_parse_data->callback_res;
+}
+
+int libmhl_parse_mhl_file(
+  st_libmhl_context* p_ctx,
+  const char* u8_mhl_path,
+  LibmhlEntryCallback callback,
+  void* data)
+{
+  int res;
+  wchar_t* mhl_wpath;
+  wchar_t* abs_mhl_wpath = NULL;
+  st_libmhl_parse_data parse_data;
+  st_error_output* p_prev_output;
+
+  if (p_ctx == NULL || callback == NULL)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  parse_data.callback = callback;
+  parse_data.data = data;
+  parse_data.callback_res = 0;
+
+  p_prev_output = aux_begin_call(p_ctx);
+  res = aux_u8path_to_wpath(p_ctx, u8_mhl_path, &mhl_wpath);
+  if (res == 0)
+  {
+    res = convert_to_absolute_normalized_wpath(mhl_wpath, &abs_mhl_wpath, 
+                                               &p_ctx->cs);
+    free(mhl_wpath);
+  }
+
+  if (res == 0)
+  {
+    res = stream_mhl_wfile(abs_mhl_wpath, aux_pass_entry, &parse_data, 
+                           &p_ctx->cs);
+  }
+
+  free(abs_mhl_wpath);
+  aux_end_call(p_prev_output);
+  return aux_libmhl_result(res, parse_data.callback_res);
+}
+
+int libmhl_verify_entry(
+  st_libmhl_context* p_ctx,
+  const st_libmhl_entry* p_entry,
+  LibmhlProgressCallback progress,
+  void* progress_data)
+{
+  int res;
+  int callback_res = 0;
+  wchar_t* wpath;
+  unsigned long long file_sz;
+  char* hash_str = NULL;
+  MHL_HASH_TYPE hash_type;
+  st_error_output* p_prev_output;
+
+  if (p_ctx == NULL || p_entry == NULL || p_entry->u8str_hash_sum == NULL)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  hash_type = aux_mhl_hash_type(p_entry->hash_type);
+  if (hash_type == MHL_HT_UNRECOGNIZED)
+  {
+    return LIBMHL_ERR_WRONG_ARGUMENTS;
+  }
+
+  p_prev_output = aux_begin_call(p_ctx);
+  res = aux_u8path_to_wpath(p_ctx, p_entry->abs_u8path, &wpath);
+  if (res == 0 && !does_wpath_exist(wpath))
+  {
+    res = ERRCODE_NO_SUCH_FILE;
+  }
+
+  if (res == 0)
+  {
+    res = get_wfile_size(wpath, &file_sz);
+  }
+
+  if (res == 0 && file_sz != p_entry->file_sz)
+  {
+    res = ERRCODE_MHL_CHECK_FILE_SIZE_FAILED;
+  }
+
+  // entries without hash are checked by size
+  if (res == 0 && hash_type != MHL_HT_NULL)
+  {
+    res = aux_hash_wfile(wpath, &hash_type, 1, &hash_str, &file_sz,
+                         progress, progress_data, &callback_res);
+  }
+
+  if (res == 0 && hash_str != NULL &&
+      (strlen(hash_str) != strlen(p_entry->u8str_hash_sum) ||
+       mhlosi_strcasecmp(hash_str, p_entry->u8str_hash_sum) != 0))
+  {
+    res = ERRCODE_MHL_CHECK_HASH_FAILED;
+  }
+
+  free(hash_str);
+  free(wpath);
+  aux_end_call(p_prev_output);
+  return aux_libmhl_result(res, callback_res);
+}
@@ -0,0 +1,306 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+/*
+ * @file: libmhl.h
+ *
+ * C API of the MHL tool for embedding: hashing of files and of data 
+ * streams, incremental building of MHL files, parsing of MHL files and 
+ * verification of their entries, without starting of 'mhl' processes.
+ *
+ * Paths are passed and returned in UTF-8, relative paths are relative
+ * to the current working directory. File names are passed to the OS in
+ * the locale encoding, as by the 'mhl' tool, so the application has to
+ * set LC_CTYPE, e.g. via setlocale(LC_CTYPE, ""). Functions return 
+ * LIBMHL_OK in case of success and LIBMHL_ERR_* codes otherwise, 
+ * libmhl_error_description() describes them. The library does not 
+ * write to stderr, details of errors are passed to the error callback 
+ * of the context, see libmhl_set_error_callback().
+ *
+ * Thread safety: a context and builders created with it must not be
+ * used by several threads at once, each thread needs its own context.
+ * Hashers do not depend on contexts, different hashers may be used in 
+ * parallel.
+ */
+
+#ifndef _MHL_TOOLS_LIBMHL_LIBMHL_H_
+#define _MHL_TOOLS_LIBMHL_LIBMHL_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Error codes
+#define LIBMHL_OK                      0
+#define LIBMHL_ERR_UNKNOWN             1
+#define LIBMHL_ERR_WRONG_ARGUMENTS     2
+#define LIBMHL_ERR_NO_SUCH_FILE        3
+#define LIBMHL_ERR_NOT_FILE            4
+#define LIBMHL_ERR_IO                  5
+#define LIBMHL_ERR_OUT_OF_MEM          6
+#define LIBMHL_ERR_CHARS_CONVERSION    7
+#define LIBMHL_ERR_WRONG_FILE_LOCATION 8
+#define LIBMHL_ERR_MHL_FORMAT          9
+#define LIBMHL_ERR_SIZE_MISMATCH       10
+#define LIBMHL_ERR_HASH_MISMATCH       11
+#define LIBMHL_ERR_INTERNAL            12
+// codes above it are not returned by the library, callbacks may use them
+#define LIBMHL_ERR_MAX                 LIBMHL_ERR_INTERNAL
+
+/* @return Description of LIBMHL_OK or LIBMHL_ERR_* code
+ */
+const char* libmhl_error_description(int error_code);
+
+typedef enum _LIBMHL_HASH_TYPE
+{
+  LIBMHL_HT_UNRECOGNIZED = 0,
+  LIBMHL_HT_MD5,
+  LIBMHL_HT_SHA1,
+  LIBMHL_HT_XXHASH,
+  LIBMHL_HT_XXHASH64,
+  LIBMHL_HT_XXHASH64BE,
+  LIBMHL_HT_NULL // entry of MHL file without hash
+} LIBMHL_HASH_TYPE;
+
+/* Callback, called while file is read: before the reading starts, each
+ * LIBMHL_PROGRESS_STEP_SZ bytes and when the whole file is read.
+ * @param processed_sz - bytes of the file read so far
+ * @param total_sz     - size of the file
+ * @return 0 in order to continue reading,
+ *         not null error code in order to stop it, the code is returned
+ *         unchanged by the API call, so it should be above LIBMHL_ERR_MAX.
+ */
+typedef int (*LibmhlProgressCallback)(
+  unsigned long long processed_sz,
+  unsigned long long total_sz,
+  void* data);
+
+#define LIBMHL_PROGRESS_STEP_SZ (4 * 1024 * 1024)
+
+/* @return Version of the library, the same as of the 'mhl' tool.
+ */
+const char* libmhl_version(void);
+
+//
+// Context: conversion settings, user and host info
+//
+
+typedef struct _st_libmhl_context st_libmhl_context;
+
+/* Creates context. Character conversions are set up once per context,
+ * user and host info for MHL files is looked up once when the first MHL 
+ * file is written.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int libmhl_create_context(st_libmhl_context** pp_ctx);
+
+void libmhl_free_context(st_libmhl_context* p_ctx);
+
+/* Callback, receives text of error message, e.g. "File PATH is not in
+ * the folder of any MHL file or its subfolders.\n". A message may be 
+ * passed by several calls.
+ */
+typedef void (*LibmhlErrorCallback)(const char* msg, void* data);
+
+/* Sets callback for details of errors of calls with the context and its
+ * builders, the callback is called by the thread of the call. Without 
+ * callback the details are dropped.
+ * @param callback - NULL in order to drop the details
+ */
+void libmhl_set_error_callback(
+  st_libmhl_context* p_ctx,
+  LibmhlErrorCallback callback,
+  void* data);
+
+//
+// Hashing
+//
+
+/* Calculates hashes of several types for file, the file is read once.
+ * LIBMHL_HT_NULL and LIBMHL_HT_UNRECOGNIZED are not supported.
+ *
+ * @param hash_strs - receives string representations of hash values, 
+ *                    in the order of hash_types. Release them via 
+ *                    libmhl_free_hash_strs().
+ * @param p_file_sz - receives number of read bytes, may be NULL
+ * @param progress  - may be NULL
+ * @return In case of success: 0,
+ *         error code returned by the progress callback,
+ *         in case of failure: non zero value with error code
+ */
+int libmhl_hash_file(
+  st_libmhl_context* p_ctx,
+  const char* u8path,
+  const LIBMHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  char** hash_strs,
+  unsigned long long* p_file_sz,
+  LibmhlProgressCallback progress,
+  void* progress_data);
+
+void libmhl_free_hash_strs(char** hash_strs, size_t hashes_num);
+
+/* Hashes of data, which is passed by parts, e.g. while it is received.
+ */
+typedef struct _st_libmhl_hasher st_libmhl_hasher;
+
+int libmhl_create_hasher(
+  const LIBMHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  st_libmhl_hasher** pp_hasher);
+
+int libmhl_update_hasher(
+  st_libmhl_hasher* p_hasher,
+  const void* data,
+  size_t data_sz);
+
+/* Finishes calculation, the hasher can't be updated after this call.
+ * @param hash_strs - receives string representations of hash values 
+ *                    in the order of types passed on creation of the 
+ *                    hasher. Release them via libmhl_free_hash_strs().
+ */
+int libmhl_finish_hasher(st_libmhl_hasher* p_hasher, char** hash_strs);
+
+void libmhl_free_hasher(st_libmhl_hasher* p_hasher);
+
+//
+// Building of MHL files
+//
+
+typedef struct _st_libmhl_builder st_libmhl_builder;
+
+/* Creates builder of MHL file in the given folder. Files added to the 
+ * builder must be in this folder or its subfolders.
+ * @param is_gzip - non zero for gzip-compressed MHL file
+ */
+int libmhl_create_builder(
+  st_libmhl_context* p_ctx,
+  const char* u8_mhl_dir,
+  unsigned char is_gzip,
+  st_libmhl_builder** pp_builder);
+
+/* Hashes file and adds it into the MHL file. All the hashes are written
+ * for the file, in the order of hash_types, the types must be different.
+ * @return In case of success: 0,
+ *         error code returned by the progress callback,
+ *         in case of failure: non zero value with error code
+ */
+int libmhl_add_file_to_builder(
+  st_libmhl_builder* p_builder,
+  const char* u8path,
+  const LIBMHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  LibmhlProgressCallback progress,
+  void* progress_data);
+
+/* Adds file with already known hashes into the MHL file, the file is
+ * not read, its size and dates are taken from the file system. Hashes
+ * are written as by libmhl_add_file_to_builder().
+ */
+int libmhl_add_entry_to_builder(
+  st_libmhl_builder* p_builder,
+  const char* u8path,
+  const LIBMHL_HASH_TYPE* hash_types,
+  const char* const* hash_strs,
+  size_t hashes_num);
+
+/* Writes MHL file with all the added files. The builder can only be
+ * freed after this call.
+ * @param pp_u8_mhl_path - receives path of the written MHL file, 
+ *                         release it via free(). May be NULL.
+ */
+int libmhl_write_builder(st_libmhl_builder* p_builder, char** pp_u8_mhl_path);
+
+void libmhl_free_builder(st_libmhl_builder* p_builder);
+
+//
+// Parsing and verification
+//
+
+// Digest of MHL entry
+typedef struct _st_libmhl_hash
+{
+  LIBMHL_HASH_TYPE hash_type;
+  const char* u8str_hash_sum; // empty for LIBMHL_HT_NULL hash type
+} st_libmhl_hash;
+
+// Entry of MHL file, all the pointers are valid only during the call
+// of LibmhlEntryCallback
+typedef struct _st_libmhl_entry
+{
+  const char* abs_u8path; // absolute normalized path
+  // primary digest: SHA1 if the entry has it, the last one otherwise
+  LIBMHL_HASH_TYPE hash_type;
+  const char* u8str_hash_sum; // empty for LIBMHL_HT_NULL hash type
+  unsigned long long file_sz;
+  unsigned char is_mhl_file; // entry of referenced MHL file
+  // all digests of the entry, including the primary one, in the order 
+  // of MHL file. Not used by libmhl_verify_entry().
+  const st_libmhl_hash* hashes;
+  size_t hashes_num;
+} st_libmhl_entry;
+
+/* Callback, called for each entry of MHL file.
+ * @return 0 in order to continue reading,
+ *         not null error code in order to stop it, as for 
+ *         LibmhlProgressCallback.
+ */
+typedef int (*LibmhlEntryCallback)(const st_libmhl_entry* p_entry, void* data);
+
+/* Reads MHL file and passes its entries to the callback in the order of
+ * the file, without collecting of them in memory.
+ * @return In case of success: 0,
+ *         error code returned by the callback,
+ *         in case of failure: non zero value with error code
+ */
+int libmhl_parse_mhl_file(
+  st_libmhl_context* p_ctx,
+  const char* u8_mhl_path,
+  LibmhlEntryCallback callback,
+  void* data);
+
+/* Checks file of MHL entry: its existence, size and hash.
+ * @return In case of success: 0,
+ *         LIBMHL_ERR_NO_SUCH_FILE if the file does not exist,
+ *         LIBMHL_ERR_SIZE_MISMATCH if size differs,
+ *         LIBMHL_ERR_HASH_MISMATCH if hash differs,
+ *         error code returned by the progress callback,
+ *         in case of failure: non zero value with error code
+ */
+int libmhl_verify_entry(
+  st_libmhl_context* p_ctx,
+  const st_libmhl_entry* p_entry,
+  LibmhlProgressCallback progress,
+  void* progress_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _MHL_TOOLS_LIBMHL_LIBMHL_H_
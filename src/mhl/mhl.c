@@ -27,18 +27,22 @@
 
 #include <facade_info/error_codes.h>
 #include <generics/char_conversions.h>
+#include <generics/perf_stats.h>
 #include <mhltools_common/usage_printing.h>
 #include <mhltools_common/logging.h>
+#include <parsemhl/mhl_file_handlers.h>
 #include <mhl_verify/mhl_verify.h>
 #include <mhl_file/mhl_file.h>
 #include <mhl_hash/mhl_hash.h>
 #include <mhl_seal/mhl_seal.h>
+#include <mhl_copy/mhl_copy.h>
 #include <mhl_help/mhl_help.h>
 
 typedef enum _en_main_mode
 {
   MD_NOT_SET = 0,
   MD_SEAL,
+  MD_COPY,
   MD_VERIFY,
   MD_HASH,
   MD_FILE,
@@ -49,6 +53,8 @@ typedef struct _st_subcommand
 {
   en_main_mode mode;
   unsigned char print_version; // 1 - to print, 0 - to skip
+  const char* stats_path; // NULL - no statistics, "-" - print to stderr
+  const char* trace_path; // NULL - no trace, "-" - print to stderr
   size_t next_idx;
 } st_subcommand;
 
@@ -80,10 +86,38 @@ int parse_main_params(int argc, const char* argv[],
   }
   else
   {
-    if (strcmp(argv[i], "--version") == 0)
+    for (; i < argc; ++i)
     {
-      subcommand->print_version = 1;
-      ++i;
+      if (strcmp(argv[i], "--version") == 0)
+      {
+        subcommand->print_version = 1;
+      }
+      else if (strcmp(argv[i], "--stats") == 0)
+      {
+        if (i + 1 == argc)
+        {
+          print_error(
+            "Arguments error: "
+            "There must be file name after the '--stats' option.\n");
+          return ERRCODE_WRONG_ARGUMENTS;
+        }
+        subcommand->stats_path = argv[++i];
+      }
+      else if (strcmp(argv[i], "--trace") == 0)
+      {
+        if (i + 1 == argc)
+        {
+          print_error(
+            "Arguments error: "
+            "There must be file name after the '--trace' option.\n");
+          return ERRCODE_WRONG_ARGUMENTS;
+        }
+        subcommand->trace_path = argv[++i];
+      }
+      else
+      {
+        break;
+      }
     }
     
     if (i < argc)
@@ -92,6 +126,10 @@ int parse_main_params(int argc, const char* argv[],
       {
         subcommand->mode = MD_SEAL;
       }
+      else if (strcmp(argv[i], "copy") == 0)
+      {
+        subcommand->mode = MD_COPY;
+      }
       else if (strcmp(argv[i], "verify") == 0)
       {
         subcommand->mode = MD_VERIFY;
@@ -121,10 +159,49 @@ int parse_main_params(int argc, const char* argv[],
   return res;
 }
 
+typedef int (*PerfJsonWriter)(FILE* file, const char* tool_name);
+
+/* Writes statistics or trace of the run into the file, "-" means stderr.
+ */
+static int 
+write_stats(const char* path, const char* command_name,
+            PerfJsonWriter writer, const char* description)
+{
+  FILE* fl;
+  int res;
+  char tool_name[32];
+
+  snprintf(tool_name, sizeof(tool_name), "mhl %s", command_name);
+  if (strcmp(path, "-") == 0)
+  {
+    return writer(stderr, tool_name);
+  }
+
+  fl = fopen(path, "w");
+  if (fl == NULL)
+  {
+    fprintf(stderr, "Error: Cannot open %s file '%s'.\n", description, path);
+    return ERRCODE_IO_ERROR;
+  }
+
+  res = writer(fl, tool_name);
+  if (fclose(fl) != 0 && res == 0)
+  {
+    res = ERRCODE_IO_ERROR;
+  }
+  if (res != 0)
+  {
+    fprintf(stderr, "Error: Cannot write %s file '%s'.\n", description,
+            path);
+  }
+  return res;
+}
+
 int main(int argc, const char * argv[])
 {
   st_subcommand subcommand;
   int res;
+  int stats_res;
 
 #ifndef WIN
   //setting line buffered mode for stdout to enable better parsing from Mac OS X GUI application
@@ -146,10 +223,30 @@ int main(int argc, const char * argv[])
     print_version();
   }
 
+  if (subcommand.stats_path != NULL)
+  {
+    perf_stats_enable();
+  }
+
+  if (subcommand.trace_path != NULL)
+  {
+    res = perf_trace_enable();
+    if (res != 0)
+    {
+      fprintf(stderr, "Error: Cannot start tracing: %s\n", 
+              mhl_error_code_description(res));
+      return res;
+    }
+  }
+
   if (subcommand.mode == MD_SEAL)
   {
     res = run_mhl_seal(argc - subcommand.next_idx, argv + subcommand.next_idx);
   }
+  else if (subcommand.mode == MD_COPY)
+  {
+    res = run_mhl_copy(argc - subcommand.next_idx, argv + subcommand.next_idx);
+  }
   else if (subcommand.mode == MD_VERIFY)
   {
     res = run_mhl_verify(argc - subcommand.next_idx, argv + subcommand.next_idx);
@@ -174,5 +271,29 @@ int main(int argc, const char * argv[])
     res = ERRCODE_UNKNOWN_MODE;
   }
 
+  if (subcommand.stats_path != NULL && subcommand.mode != MD_NOT_SET)
+  {
+    stats_res = 
+      write_stats(subcommand.stats_path, argv[subcommand.next_idx],
+                  write_perf_stats_json, "statistics");
+    if (res == 0)
+    {
+      res = stats_res;
+    }
+  }
+
+  if (subcommand.trace_path != NULL && subcommand.mode != MD_NOT_SET)
+  {
+    stats_res = 
+      write_stats(subcommand.trace_path, argv[subcommand.next_idx],
+                  write_perf_trace_json, "trace");
+    if (res == 0)
+    {
+      res = stats_res;
+    }
+  }
+  free_perf_trace();
+  cleanup_mhl_parser();
+
   return res;
 }
@@ -0,0 +1,436 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: copy_file.c
+ *
+ * One-read-pass copying of files to several destinations.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/os_threads.h>
+#include <generics/perf_stats.h>
+#include <generics/filesystem_handlers/public_interface.h>
+
+#include "copy_file.h"
+
+// data of a file is passed to writers through a ring of buffers, so 
+// reading of next buffer overlaps with writing of previous ones
+#define COPY_SLOTS_NUM 4
+#define COPY_SLOT_BUFF_SZ (4 * 1024 * 1024)
+
+typedef enum _COPY_SLOT_TYPE
+{
+  CST_OPEN = 0,  // open destination files of the next file
+  CST_DATA,      // write data
+  CST_CLOSE,     // close destination files
+  CST_QUIT       // stop writer threads
+} COPY_SLOT_TYPE;
+
+typedef struct _st_copy_slot
+{
+  COPY_SLOT_TYPE type;
+  unsigned char* data;
+  size_t data_sz;
+  size_t pending; // number of writers, which haven't processed the slot
+} st_copy_slot;
+
+typedef struct _st_copy_writer
+{
+  st_copy_engine* p_engine;
+  size_t dst_idx;
+  mhlosi_thread thread;
+
+  // state of current file, touched by writer thread only, 
+  // the reader looks at it after the file is closed
+  int fd;
+  unsigned char is_open;
+  int res;
+
+  unsigned long long next_seq; // sequence number of next slot to process
+} st_copy_writer;
+
+struct _st_copy_engine
+{
+  mhlosi_mutex mutex;
+  mhlosi_cond slot_ready;
+  mhlosi_cond slot_free;
+
+  st_copy_slot slots[COPY_SLOTS_NUM];
+  unsigned long long next_seq; // sequence number of next published slot
+
+  st_copy_writer* writers;
+  size_t dst_num;
+  size_t started_num;
+
+  // destination paths of current file, kept until the file is closed
+  wchar_t* const* dst_wfns;
+  unsigned char sync_on_close;
+};
+
+static void
+aux_process_slot(st_copy_writer* p_writer, const st_copy_slot* p_slot)
+{
+  st_copy_engine* p_engine = p_writer->p_engine;
+  const wchar_t* dst_wfn;
+  int res;
+
+  switch (p_slot->type)
+  {
+    case CST_OPEN:
+      dst_wfn = p_engine->dst_wfns[p_writer->dst_idx];
+      p_writer->is_open = 0;
+      p_writer->res = 0;
+      if (dst_wfn != NULL)
+      {
+        p_writer->res = wopen_for_create(dst_wfn, &p_writer->fd);
+        p_writer->is_open = p_writer->res == 0;
+      }
+      break;
+
+    case CST_DATA:
+      if (p_writer->is_open && p_writer->res == 0)
+      {
+        p_writer->res = 
+          mhlosi_write_all(p_writer->fd, p_slot->data, p_slot->data_sz);
+      }
+      break;
+
+    case CST_CLOSE:
+      if (p_writer->is_open)
+      {
+        if (p_engine->sync_on_close && p_writer->res == 0)
+        {
+          p_writer->res = mhlosi_sync_and_drop_cache(p_writer->fd);
+        }
+        res = mhlosi_close(p_writer->fd);
+        if (res != 0 && p_writer->res == 0)
+        {
+          p_writer->res = ERRCODE_IO_ERROR;
+        }
+        p_writer->is_open = 0;
+      }
+      break;
+
+    case CST_QUIT:
+    default:
+      break;
+  }
+}
+
+static void
+aux_writer_job(void* arg)
+{
+  st_copy_writer* p_writer = (st_copy_writer*) arg;
+  st_copy_engine* p_engine = p_writer->p_engine;
+  st_copy_slot* p_slot;
+  COPY_SLOT_TYPE slot_type;
+
+  mhlosi_mutex_lock(&p_engine->mutex);
+  do
+  {
+    while (p_writer->next_seq == p_engine->next_seq)
+    {
+      mhlosi_cond_wait(&p_engine->slot_ready, &p_engine->mutex);
+    }
+    p_slot = &p_engine->slots[p_writer->next_seq % COPY_SLOTS_NUM];
+    slot_type = p_slot->type;
+    mhlosi_mutex_unlock(&p_engine->mutex);
+
+    aux_process_slot(p_writer, p_slot);
+
+    mhlosi_mutex_lock(&p_engine->mutex);
+    ++p_writer->next_seq;
+    --p_slot->pending;
+    if (p_slot->pending == 0)
+    {
+      mhlosi_cond_broadcast(&p_engine->slot_free);
+    }
+  } while (slot_type != CST_QUIT);
+  mhlosi_mutex_unlock(&p_engine->mutex);
+}
+
+/* Waits until the next slot is processed by all writers.
+ */
+static st_copy_slot*
+aux_acquire_slot(st_copy_engine* p_engine)
+{
+  st_copy_slot* p_slot;
+
+  mhlosi_mutex_lock(&p_engine->mutex);
+  p_slot = &p_engine->slots[p_engine->next_seq % COPY_SLOTS_NUM];
+  while (p_slot->pending != 0)
+  {
+    mhlosi_cond_wait(&p_engine->slot_free, &p_engine->mutex);
+  }
+  mhlosi_mutex_unlock(&p_engine->mutex);
+
+  return p_slot;
+}
+
+static void
+aux_publish_slot(
+  st_copy_engine* p_engine, 
+  st_copy_slot* p_slot, 
+  COPY_SLOT_TYPE type)
+{
+  mhlosi_mutex_lock(&p_engine->mutex);
+  p_slot->type = type;
+  p_slot->pending = p_engine->started_num;
+  ++p_engine->next_seq;
+  mhlosi_cond_broadcast(&p_engine->slot_ready);
+  mhlosi_mutex_unlock(&p_engine->mutex);
+}
+
+/* Waits until all published slots are processed by all writers.
+ */
+static void
+aux_wait_writers(st_copy_engine* p_engine)
+{
+  size_t i;
+
+  mhlosi_mutex_lock(&p_engine->mutex);
+  for (i = 0; i < COPY_SLOTS_NUM; ++i)
+  {
+    while (p_engine->slots[i].pending != 0)
+    {
+      mhlosi_cond_wait(&p_engine->slot_free, &p_engine->mutex);
+    }
+  }
+  mhlosi_mutex_unlock(&p_engine->mutex);
+}
+
+int create_copy_engine(
+  size_t dst_num,
+  unsigned char sync_on_close,
+  st_copy_engine** pp_engine)
+{
+  int res;
+  size_t i;
+  st_copy_engine* p_engine;
+
+  if (dst_num == 0 || pp_engine == NULL)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  *pp_engine = NULL;
+  p_engine = (st_copy_engine*) calloc(1, sizeof(st_copy_engine));
+  if (p_engine == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  p_engine->dst_num = dst_num;
+  p_engine->sync_on_close = sync_on_close;
+
+  res = mhlosi_mutex_init(&p_engine->mutex);
+  if (res != 0)
+  {
+    free(p_engine);
+    return res;
+  }
+
+  res = mhlosi_cond_init(&p_engine->slot_ready);
+  if (res != 0)
+  {
+    mhlosi_mutex_destroy(&p_engine->mutex);
+    free(p_engine);
+    return res;
+  }
+
+  res = mhlosi_cond_init(&p_engine->slot_free);
+  if (res != 0)
+  {
+    mhlosi_cond_destroy(&p_engine->slot_ready);
+    mhlosi_mutex_destroy(&p_engine->mutex);
+    free(p_engine);
+    return res;
+  }
+
+  // from here the engine is released via free_copy_engine()
+  for (i = 0; i < COPY_SLOTS_NUM && res == 0; ++i)
+  {
+    p_engine->slots[i].data = (unsigned char*) malloc(COPY_SLOT_BUFF_SZ);
+    if (p_engine->slots[i].data == NULL)
+    {
+      res = ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  if (res == 0)
+  {
+    p_engine->writers = 
+      (st_copy_writer*) calloc(dst_num, sizeof(st_copy_writer));
+    if (p_engine->writers == NULL)
+    {
+      res = ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  for (i = 0; i < dst_num && res == 0; ++i)
+  {
+    p_engine->writers[i].p_engine = p_engine;
+    p_engine->writers[i].dst_idx = i;
+    res = 
+      mhlosi_thread_create(&p_engine->writers[i].thread, aux_writer_job,
+                           &p_engine->writers[i]);
+    if (res == 0)
+    {
+      ++p_engine->started_num;
+    }
+  }
+
+  if (res != 0)
+  {
+    free_copy_engine(p_engine);
+    return res;
+  }
+
+  *pp_engine = p_engine;
+  return 0;
+}
+
+void free_copy_engine(st_copy_engine* p_engine)
+{
+  size_t i;
+
+  if (p_engine == NULL)
+  {
+    return;
+  }
+
+  if (p_engine->started_num != 0)
+  {
+    aux_publish_slot(p_engine, aux_acquire_slot(p_engine), CST_QUIT);
+    for (i = 0; i < p_engine->started_num; ++i)
+    {
+      mhlosi_thread_join(p_engine->writers[i].thread);
+    }
+  }
+
+  for (i = 0; i < COPY_SLOTS_NUM; ++i)
+  {
+    free(p_engine->slots[i].data);
+  }
+
+  free(p_engine->writers);
+  mhlosi_cond_destroy(&p_engine->slot_free);
+  mhlosi_cond_destroy(&p_engine->slot_ready);
+  mhlosi_mutex_destroy(&p_engine->mutex);
+  free(p_engine);
+}
+
+int copy_file_to_destinations(
+  st_copy_engine* p_engine,
+  const wchar_t* src_wfn,
+  wchar_t* const* dst_wfns,
+  int* dst_results,
+  st_hash_strings_state* p_hash_state,
+  unsigned long long* p_copied_sz,
+  st_logging_data* logging_data)
+{
+  int res;
+  FILE* fd;
+  size_t i;
+  size_t bytes_read;
+  unsigned long long bytes_read_for_logging;
+  unsigned long long beg_us;
+  st_copy_slot* p_slot;
+
+  if (p_engine == NULL || src_wfn == NULL || dst_wfns == NULL || 
+      dst_results == NULL || p_copied_sz == NULL || logging_data == NULL)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  *p_copied_sz = 0;
+  beg_us = perf_stats_begin();
+  fd = fwopen_for_hash_check(src_wfn);
+  perf_stats_end(PP_OPEN, beg_us, 0);
+  if (fd == NULL)
+  {
+    return ERRCODE_NO_SUCH_FILE;
+  }
+
+  // the previous file is closed, so writers don't look at the paths now
+  p_engine->dst_wfns = dst_wfns;
+  aux_publish_slot(p_engine, aux_acquire_slot(p_engine), CST_OPEN);
+
+  res = 0;
+  bytes_read_for_logging = 0;
+  while (res == 0)
+  {
+    p_slot = aux_acquire_slot(p_engine);
+    beg_us = perf_stats_begin();
+    bytes_read = 
+      fread(p_slot->data, sizeof(unsigned char), COPY_SLOT_BUFF_SZ, fd);
+    perf_stats_end(PP_READ, beg_us, bytes_read);
+
+    if (bytes_read == 0)
+    {
+      if (!feof(fd))
+      {
+        res = ERRCODE_IO_ERROR;
+      }
+
+      // eof
+      break;
+    }
+
+    p_slot->data_sz = bytes_read;
+    aux_publish_slot(p_engine, p_slot, CST_DATA);
+
+    // writers only read the slot, so hashing runs in parallel to them
+    if (p_hash_state != NULL)
+    {
+      res = update_hash_strings_state(p_hash_state, p_slot->data, bytes_read);
+    }
+
+    *p_copied_sz += bytes_read;
+    bytes_read_for_logging += bytes_read;
+    report_processed_sz(logging_data, bytes_read, &bytes_read_for_logging);
+  }
+
+  fclose(fd);
+
+  aux_publish_slot(p_engine, aux_acquire_slot(p_engine), CST_CLOSE);
+  aux_wait_writers(p_engine);
+
+  for (i = 0; i < p_engine->dst_num; ++i)
+  {
+    if (dst_wfns[i] != NULL)
+    {
+      dst_results[i] = p_engine->writers[i].res;
+    }
+  }
+  p_engine->dst_wfns = NULL;
+
+  return res;
+}
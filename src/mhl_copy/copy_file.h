@@ -0,0 +1,80 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: copy_file.h
+ *
+ * Copying of a file to several destinations in one read pass: the file
+ * is read by the calling thread, each destination is written by its own
+ * thread, and the same data is passed to the hashes.
+ */
+
+#ifndef _MHL_TOOLS_MHL_COPY_COPY_FILE_H_
+#define _MHL_TOOLS_MHL_COPY_COPY_FILE_H_
+
+#include <stddef.h>
+#include <wchar.h>
+
+#include <mhltools_common/logging.h>
+#include <mhltools_common/hashing.h>
+
+typedef struct _st_copy_engine st_copy_engine;
+
+/* Creates copy engine and starts writer threads, one per destination.
+ * @param sync_on_close - flush destination files to the storage when 
+ *                        they are closed
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int create_copy_engine(
+  size_t dst_num,
+  unsigned char sync_on_close,
+  st_copy_engine** pp_engine);
+
+/* Stops writer threads and releases the engine.
+ */
+void free_copy_engine(st_copy_engine* p_engine);
+
+/* Copies file to all the destinations, data of the file is passed to 
+ * the hash state, if it is not NULL. Destination files are created or 
+ * truncated.
+ * @param dst_wfns - destination paths, NULL items are skipped
+ * @param dst_results - receives results of writing of each destination,
+ *                      not touched for skipped destinations
+ * @param p_copied_sz - receives number of bytes read from source file
+ * @return In case of success: 0, even if some destinations failed.
+ *         In case of failure to read the source: non zero value 
+ *         with error code.
+ */
+int copy_file_to_destinations(
+  st_copy_engine* p_engine,
+  const wchar_t* src_wfn,
+  wchar_t* const* dst_wfns,
+  int* dst_results,
+  st_hash_strings_state* p_hash_state,
+  unsigned long long* p_copied_sz,
+  st_logging_data* logging_data);
+
+#endif //_MHL_TOOLS_MHL_COPY_COPY_FILE_H_
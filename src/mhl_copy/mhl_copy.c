@@ -0,0 +1,1527 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: mhl_copy.c
+ *
+ * "mhl copy": copies files and folders to one or several destination 
+ * folders and seals each destination with its own MHL file. Each source 
+ * file is read only once, the same data is written to all destinations 
+ * and hashed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/memory_management.h>
+#include <generics/char_conversions.h>
+#include <generics/std_funcs_os_anonymizer.h>
+#include <generics/os_threads.h>
+#include <mhltools_common/logging.h>
+#include <mhltools_common/progress_reporter.h>
+#include <mhltools_common/usage_printing.h>
+
+#include <mhltools_common/controlling_data.h>
+#include <args_fileslist_support/aux_funcs.h>
+#include <mhltools_common/hashing.h>
+#include <mhltools_common/options.h>
+
+#include <printmhl/mhl_creator.h>
+
+#include <mhl_copy/copy_file.h>
+#include <mhl_copy/mhl_copy.h>
+
+#define COPY_MAX_HASHES 5
+
+typedef struct _st_copy_control_options
+{
+  // common options for all applications
+  st_controlling_data common;
+
+  unsigned char opt_md5;
+  unsigned char opt_sha1;
+  unsigned char opt_xxhash;
+  unsigned char opt_xxhash64;
+  unsigned char opt_xxhash64be;
+
+  // read copied files back and compare their hashes
+  unsigned char opt_verify;
+  unsigned char gzip_output;
+
+  // destination folders as passed in arguments
+  wchar_t** dst_wdirs;
+  size_t dst_wdirs_capacity;
+  unsigned int dst_wdirs_cnt;
+} st_copy_control_options;
+
+typedef struct _st_copy_destination
+{
+  // absolute normalized path of destination folder
+  wchar_t* root_wpath;
+  st_mhlcreate_data mhlcreate_data;
+} st_copy_destination;
+
+typedef struct _st_aux_copy_data
+{
+  st_copy_control_options* p_opts;
+  st_copy_destination* dsts;
+  size_t dst_num;
+  st_copy_engine* p_engine;
+
+  MHL_HASH_TYPE hash_types[COPY_MAX_HASHES];
+  size_t hashes_num;
+
+  // parent folder of current source argument, files are copied to the
+  // same paths relative to destination folders
+  const wchar_t* src_parent_wpath;
+  size_t src_parent_wpath_len;
+
+  // per destination data of current file
+  wchar_t** dst_wfns;
+  int* dst_results;
+
+  st_conversion_settings* p_cs;
+} st_aux_copy_data;
+
+typedef struct _st_aux_verify_copy_job
+{
+  st_copy_destination* p_dst;
+  unsigned long n_files_failed;
+  int res;
+} st_aux_verify_copy_job;
+
+static
+int init_st_copy_control_options(st_copy_control_options* p_opt)
+{
+  if (p_opt == 0)
+  {
+    return ERRCODE_UNKNOWN_ERROR;
+  }
+  
+  memset((void*) p_opt, 0, sizeof(*p_opt) / sizeof(char));
+
+  return 0;
+}
+
+static
+void free_st_copy_control_options(st_copy_control_options* p_opt)
+{
+  unsigned int i;
+
+  if (p_opt == 0)
+  {
+    return;
+  }
+
+  clean_log_str(&p_opt->common.logging_data.v_data);
+
+  for (i = 0; i < p_opt->dst_wdirs_cnt; ++i)
+  {
+    free(p_opt->dst_wdirs[i]);
+  }
+  free(p_opt->dst_wdirs);
+
+  memset((void*) p_opt, 0, sizeof(*p_opt) / sizeof(char));  
+  return;
+}
+
+/* @return 1 if wpath is the same as parent_wpath or is located inside of it
+ */
+static unsigned char
+aux_is_wpath_inside(const wchar_t* parent_wpath, const wchar_t* wpath)
+{
+  size_t len = wcslen(parent_wpath);
+
+  if (wcsncmp(parent_wpath, wpath, len) != 0)
+  {
+    return 0;
+  }
+
+  return wpath[len] == L'\0' || wpath[len] == WPATH_SEPARATOR || 
+         (len != 0 && parent_wpath[len - 1] == WPATH_SEPARATOR);
+}
+
+static void
+aux_remove_copied_files(st_aux_copy_data* p_data)
+{
+  size_t i;
+
+  for (i = 0; i < p_data->dst_num; ++i)
+  {
+    if (p_data->dst_wfns[i] != NULL)
+    {
+      wremove_file(p_data->dst_wfns[i]);
+    }
+  }
+}
+
+/* Prepares destination paths of file, destinations which can't get
+ * the file are reported and skipped.
+ */
+static void
+aux_prepare_destinations(st_aux_copy_data* p_data, const wchar_t* rel_wpath)
+{
+  int res;
+  size_t i;
+  wchar_t* dst_wdir;
+
+  for (i = 0; i < p_data->dst_num; ++i)
+  {
+    p_data->dst_results[i] = 0;
+    res = 
+      create_absolute_normalized_wpath(p_data->dsts[i].root_wpath, rel_wpath,
+                                       &p_data->dst_wfns[i]);
+    if (res != 0)
+    {
+      p_data->dst_wfns[i] = NULL;
+      p_data->dst_results[i] = res;
+      fprintf(stderr, "Error: Cannot make destination path for file '%ls' "
+              "in folder '%ls'.\n", rel_wpath, p_data->dsts[i].root_wpath);
+      continue;
+    }
+
+    if (does_wpath_exist(p_data->dst_wfns[i]))
+    {
+      fprintf(stderr, "Error: Destination file already exists: '%ls'.\n",
+              p_data->dst_wfns[i]);
+      res = ERRCODE_IO_ERROR;
+    }
+    else
+    {
+      res = extract_wdir_from_wpath(p_data->dst_wfns[i], &dst_wdir);
+      if (res == 0)
+      {
+        res = wmake_dirs(dst_wdir);
+        if (res != 0)
+        {
+          fprintf(stderr, "Error: Cannot create folder '%ls'.\n", dst_wdir);
+        }
+        free(dst_wdir);
+      }
+    }
+
+    if (res != 0)
+    {
+      free(p_data->dst_wfns[i]);
+      p_data->dst_wfns[i] = NULL;
+      p_data->dst_results[i] = res;
+    }
+  }
+}
+
+static int
+copy_and_fill_hash(const wchar_t* wfilename, void* data)
+{
+  int res;
+  int res1;
+  size_t i;
+  st_aux_copy_data* p_data;
+  st_verbose_data* p_v_data;
+  wchar_t* src_wpath = NULL;
+  const wchar_t* rel_wpath;
+  st_mhlosi_stat src_stat;
+  st_hash_strings_state* p_hash_state = NULL;
+  unsigned long long copied_sz = 0;
+  char* hash_strs[COPY_MAX_HASHES];
+  // by hash type, in the order of add_file_to_mhlcreate_data() arguments
+  const char* md5_hash_str = NULL;
+  const char* sha1_hash_str = NULL;
+  const char* xx_hash_str = NULL;
+  const char* xx64_hash_str = NULL;
+  const char* xx64be_hash_str = NULL;
+
+  if (wfilename == 0 || wfilename[0] == L'\0' || data == 0)
+  {
+    fprintf(
+      stderr, 
+      "copy_and_fill_hash: internal error - some data has been lost\n");
+
+    return ERRCODE_INTERNAL_ERROR;
+  }
+
+  p_data = (st_aux_copy_data*) data;
+  p_v_data = &p_data->p_opts->common.logging_data.v_data;
+
+  res = convert_to_absolute_normalized_wpath(wfilename, &src_wpath, 
+                                             p_data->p_cs);
+  if (res != 0)
+  {
+    fprintf(stderr, "Cannot make absolute path for file: '%ls'\n", 
+            wfilename);
+    return res;
+  }
+
+  if (!aux_is_wpath_inside(p_data->src_parent_wpath, src_wpath))
+  {
+    fprintf(stderr, "copy_and_fill_hash: internal error - file '%ls' is "
+            "outside of folder '%ls'\n", src_wpath, p_data->src_parent_wpath);
+    free(src_wpath);
+    return ERRCODE_INTERNAL_ERROR;
+  }
+
+  rel_wpath = src_wpath + p_data->src_parent_wpath_len;
+  while (*rel_wpath == WPATH_SEPARATOR)
+  {
+    ++rel_wpath;
+  }
+
+  if (p_v_data->verbose_level)
+  {
+    logit_item(p_v_data, "Copying '%ls'\n", src_wpath);
+  }
+
+  res = get_wfile_stat_data(src_wpath, &src_stat);
+  if (res != 0)
+  {
+    if (res == ERRCODE_NO_SUCH_FILE)
+    {
+      fprintf(stderr, "Error: File does not exist: '%ls'.\n", src_wpath);
+    }
+    else
+    {
+      fprintf(stderr, "Error: Cannot get file's data, stat() failed for file: " 
+              "%ls.\n", src_wpath);
+    }
+    free(src_wpath);
+    return res;
+  }
+
+  aux_prepare_destinations(p_data, rel_wpath);
+
+  res = create_hash_strings_state(p_data->hash_types, p_data->hashes_num, 
+                                  &p_hash_state);
+  if (res == 0)
+  {
+    res = 
+      copy_file_to_destinations(p_data->p_engine, src_wpath, 
+                                p_data->dst_wfns, p_data->dst_results,
+                                p_hash_state, &copied_sz, 
+                                &p_data->p_opts->common.logging_data);
+    if (res != 0)
+    {
+      fprintf(
+        stderr, 
+        "Cannot read the file: '%ls'\n"
+        "Description: %s\n",
+        src_wpath,
+        mhl_error_code_description(res));
+      aux_remove_copied_files(p_data);
+    }
+  }
+
+  if (res == 0)
+  {
+    res = finish_hash_strings_state(p_hash_state, hash_strs);
+  }
+  free_hash_strings_state(p_hash_state);
+
+  if (res != 0)
+  {
+    for (i = 0; i < p_data->dst_num; ++i)
+    {
+      free(p_data->dst_wfns[i]);
+      p_data->dst_wfns[i] = NULL;
+    }
+    free(src_wpath);
+    return res;
+  }
+
+  for (i = 0; i < p_data->hashes_num; ++i)
+  {
+    switch (p_data->hash_types[i])
+    {
+      case MHL_HT_MD5: md5_hash_str = hash_strs[i]; break;
+      case MHL_HT_SHA1: sha1_hash_str = hash_strs[i]; break;
+      case MHL_HT_XXHASH: xx_hash_str = hash_strs[i]; break;
+      case MHL_HT_XXHASH64: xx64_hash_str = hash_strs[i]; break;
+      case MHL_HT_XXHASH64BE: xx64be_hash_str = hash_strs[i]; break;
+      default: break;
+    }
+  }
+
+  for (i = 0; i < p_data->dst_num; ++i)
+  {
+    if (p_data->dst_wfns[i] == NULL)
+    {
+      // already reported
+      res = p_data->dst_results[i];
+      continue;
+    }
+
+    res1 = p_data->dst_results[i];
+    if (res1 != 0)
+    {
+      fprintf(
+        stderr, 
+        "Error: Cannot write the file: '%ls'\n"
+        "Description: %s\n",
+        p_data->dst_wfns[i],
+        mhl_error_code_description(res1));
+      wremove_file(p_data->dst_wfns[i]);
+    }
+    else
+    {
+      // the copy keeps modification date of the source
+      res1 = wset_file_mtime(p_data->dst_wfns[i], 
+                             src_stat.st_data.st_mtime);
+      if (res1 != 0)
+      {
+        fprintf(stderr, "Error: Cannot set modification date of the file: "
+                "'%ls'\n", p_data->dst_wfns[i]);
+      }
+    }
+
+    if (res1 == 0)
+    {
+      res1 = 
+        add_file_to_mhlcreate_data(&p_data->dsts[i].mhlcreate_data, 
+                                   p_data->dst_wfns[i], 
+                                   md5_hash_str, sha1_hash_str, xx_hash_str,
+                                   xx64_hash_str, xx64be_hash_str, 
+                                   p_data->p_cs);
+    }
+
+    if (res1 != 0)
+    {
+      res = res1;
+    }
+
+    free(p_data->dst_wfns[i]);
+    p_data->dst_wfns[i] = NULL;
+  }
+
+  for (i = 0; i < p_data->hashes_num; ++i)
+  {
+    free(hash_strs[i]);
+  }
+
+  if (p_v_data->verbose_level >= VL_VERY_VERBOSE)
+  {
+    printf("%ls: copied %llu bytes to %lu destination(s)\n",
+           src_wpath, copied_sz, (unsigned long) p_data->dst_num);
+  }
+
+  if (res == 0 && p_v_data->verbose_level)
+  {
+    logit_item(p_v_data, "Done '%ls'\n", src_wpath);
+  }
+
+  free(src_wpath);
+  return res;
+}
+
+/* Checks, that no destination is located inside of copied folders and
+ * that no file is copied onto itself.
+ */
+static
+int
+check_copy_sources(
+  int argc, 
+  const char * argv[], 
+  st_aux_copy_data* p_data)
+{
+  int i, res = 0;
+  size_t j;
+  wchar_t* wargv;
+  size_t wargv_sz;
+  wchar_t* src_wpath;
+  wchar_t* src_parent_wpath;
+
+  for (i = p_data->p_opts->common.files_argv_index; i < argc && res == 0; ++i)
+  {
+    res = 
+      convert_composed_from_locale_to_wchar(
+        argv[i], 
+        strlen(argv[i]), 
+        &wargv,
+        &wargv_sz,
+        p_data->p_cs);
+
+    if (res != 0)
+    {
+      fprintf(stderr, "Cannot convert file name %s, from locale to UTF32\n",
+              argv[i]);
+      return res;
+    }
+    
+    make_wpath_os_specific(wargv);
+
+    res = convert_to_absolute_normalized_wpath(wargv, &src_wpath, 
+                                               p_data->p_cs);
+    free(wargv);
+    if (res != 0)
+    {
+      fprintf(stderr, "Cannot make absolute path for: %s\n", argv[i]);
+      return res;
+    }
+
+    res = extract_wdir_from_wpath(src_wpath, &src_parent_wpath);
+    if (res != 0)
+    {
+      fprintf(stderr, "Cannot copy: %s\n", argv[i]);
+      free(src_wpath);
+      return res;
+    }
+
+    for (j = 0; j < p_data->dst_num && res == 0; ++j)
+    {
+      if (aux_is_wpath_inside(src_wpath, p_data->dsts[j].root_wpath) ||
+          does_wfilenames_equal(src_parent_wpath, p_data->dsts[j].root_wpath))
+      {
+        fprintf(stderr, "Arguments error: "
+                "Cannot copy '%ls' into '%ls'.\n",
+                src_wpath, p_data->dsts[j].root_wpath);
+        res = ERRCODE_WRONG_ARGUMENTS;
+      }
+    }
+
+    free(src_parent_wpath);
+    free(src_wpath);
+  }
+
+  return res;
+}
+
+typedef struct _st_aux_src_wdir_listing
+{
+  const wchar_t* wdir;
+  wchar_t** sub_wdirs;
+  size_t sub_wdirs_num;
+  size_t sub_wdirs_capacity;
+} st_aux_src_wdir_listing;
+
+static int
+aux_receive_src_dir_entry(
+  const wchar_t* entry_wname, 
+  DIR_ENTRY_TYPE_FLAGS entry_type,
+  void* data)
+{
+  int res;
+  wchar_t* entry_wpath;
+  wchar_t** new_wdirs;
+  size_t new_capacity;
+  st_aux_src_wdir_listing* p_listing = (st_aux_src_wdir_listing*) data;
+
+  if (entry_type != DETF_DIR)
+  {
+    return 0;
+  }
+
+  if (p_listing->sub_wdirs_num == p_listing->sub_wdirs_capacity)
+  {
+    new_capacity = 
+      p_listing->sub_wdirs_capacity ? p_listing->sub_wdirs_capacity * 2 : 16;
+    new_wdirs = 
+      (wchar_t**) realloc(p_listing->sub_wdirs, 
+                          new_capacity * sizeof(p_listing->sub_wdirs[0]));
+    if (new_wdirs == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+    p_listing->sub_wdirs = new_wdirs;
+    p_listing->sub_wdirs_capacity = new_capacity;
+  }
+
+  res = concat_wpath_parts(p_listing->wdir, entry_wname, &entry_wpath);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  p_listing->sub_wdirs[p_listing->sub_wdirs_num++] = entry_wpath;
+  return 0;
+}
+
+/* Creates the folder tree of a source folder in all destinations, so 
+ * that empty source folders are copied too. Files are copied later.
+ */
+static int
+aux_make_dst_wdirs_recurs(const wchar_t* src_wdir, st_aux_copy_data* p_data)
+{
+  int res = 0;
+  size_t i;
+  const wchar_t* rel_wpath;
+  wchar_t* dst_wdir;
+  st_aux_src_wdir_listing listing;
+
+  rel_wpath = src_wdir + p_data->src_parent_wpath_len;
+  while (*rel_wpath == WPATH_SEPARATOR)
+  {
+    ++rel_wpath;
+  }
+
+  for (i = 0; i < p_data->dst_num && res == 0; ++i)
+  {
+    res = 
+      create_absolute_normalized_wpath(p_data->dsts[i].root_wpath, rel_wpath,
+                                       &dst_wdir);
+    if (res != 0)
+    {
+      fprintf(stderr, "Error: Cannot make destination path for folder '%ls' "
+              "in folder '%ls'.\n", rel_wpath, p_data->dsts[i].root_wpath);
+      return res;
+    }
+
+    res = wmake_dirs(dst_wdir);
+    if (res != 0)
+    {
+      fprintf(stderr, "Error: Cannot create folder '%ls'.\n", dst_wdir);
+    }
+    free(dst_wdir);
+  }
+
+  if (res != 0)
+  {
+    return res;
+  }
+
+  memset(&listing, 0, sizeof(listing));
+  listing.wdir = src_wdir;
+  res = list_entries_in_wdir(src_wdir, p_data->p_cs, &listing, 
+                             aux_receive_src_dir_entry);
+  if (res != 0)
+  {
+    fprintf(stderr, "Error: Cannot read folder '%ls'.\n", src_wdir);
+  }
+
+  for (i = 0; i < listing.sub_wdirs_num; ++i)
+  {
+    if (res == 0)
+    {
+      res = aux_make_dst_wdirs_recurs(listing.sub_wdirs[i], p_data);
+    }
+    free(listing.sub_wdirs[i]);
+  }
+  free(listing.sub_wdirs);
+
+  return res;
+}
+
+/* Copies files and folders passed in arguments. Folders are copied 
+ * with their names into destination folders, like files are.
+ */
+static
+int
+process_copy_sources(
+  int argc, 
+  const char * argv[], 
+  st_aux_copy_data* p_data)
+{
+  int i, res, overall_res = 0;
+  wchar_t* wargv;
+  size_t wargv_sz;
+  wchar_t* src_wpath;
+  wchar_t* src_parent_wpath;
+  DIR_ENTRY_TYPE_FLAGS ent_type;
+  st_progress_data* p_progress_data;
+
+  p_progress_data = &p_data->p_opts->common.logging_data.progress_data;
+  p_progress_data->n_files_failed = 0;
+  p_progress_data->n_files_ok = 0;
+  p_progress_data->n_files_processed = 0;
+
+  for (i = p_data->p_opts->common.files_argv_index; 
+       i < argc && overall_res == 0; ++i)
+  {
+    res = 
+      convert_composed_from_locale_to_wchar(
+        argv[i], 
+        strlen(argv[i]), 
+        &wargv,
+        &wargv_sz,
+        p_data->p_cs);
+
+    if (res != 0)
+    {
+      fprintf(stderr, "Cannot convert file name %s, from locale to UTF32\n",
+              argv[i]);
+      return res;
+    }
+    
+    make_wpath_os_specific(wargv);
+
+    res = convert_to_absolute_normalized_wpath(wargv, &src_wpath, 
+                                               p_data->p_cs);
+    free(wargv);
+    if (res != 0)
+    {
+      fprintf(stderr, "Cannot make absolute path for: %s\n", argv[i]);
+      return res;
+    }
+
+    res = extract_wdir_from_wpath(src_wpath, &src_parent_wpath);
+    if (res != 0)
+    {
+      fprintf(stderr, "Cannot copy: %s\n", argv[i]);
+      free(src_wpath);
+      return res;
+    }
+
+    p_data->src_parent_wpath = src_parent_wpath;
+    p_data->src_parent_wpath_len = wcslen(src_parent_wpath);
+    res = get_file_type(src_wpath, &ent_type);
+
+    if (res != 0)
+    {
+      ++p_progress_data->n_files_processed;
+      ++p_progress_data->n_files_failed;
+      overall_res = res;
+    }
+    else if (ent_type == DETF_DIR)
+    { 
+      res = aux_make_dst_wdirs_recurs(src_wpath, p_data);
+      if (res != 0)
+      {
+        ++p_progress_data->n_files_processed;
+        ++p_progress_data->n_files_failed;
+        overall_res = res;
+      }
+      else
+      {
+        res =
+          process_files_recurs(
+            src_wpath,
+            p_data->p_cs,
+            1, // stop on error
+            &p_progress_data->n_files_processed,
+            &p_progress_data->n_files_failed,
+            &p_progress_data->n_files_ok,
+            (void*) p_data,
+            copy_and_fill_hash);
+
+        if (res != 0 && res != ERRCODE_STOP_SEARCH)
+        {
+          overall_res = res;
+        }
+      }
+    }
+    else if (ent_type == DETF_FILE) 
+    {
+      res = copy_and_fill_hash(src_wpath, (void*) p_data);
+    
+      ++p_progress_data->n_files_processed;
+      if (res != 0)
+      {
+        ++p_progress_data->n_files_failed;
+        overall_res = res;
+      }
+      else
+      {
+        ++p_progress_data->n_files_ok;
+      }
+    }
+    else 
+    {
+      fprintf(
+        stderr,
+        "Warning: the path is not a valid directory or file:\n%s\n"
+        "         ",
+        argv[i]);
+
+      print_ent_type(ent_type);
+      fprintf(stderr, " Ignoring...\n\n");
+    }
+
+    p_data->src_parent_wpath = NULL;
+    free(src_parent_wpath);
+    free(src_wpath);
+  }
+
+  return overall_res;
+}
+
+/* Reads copied files of destination back and compares their hashes 
+ * with hashes of the sources.
+ */
+static void
+aux_verify_copy_job(void* arg)
+{
+  st_aux_verify_copy_job* p_job = (st_aux_verify_copy_job*) arg;
+  st_files_data* p_files_data = &p_job->p_dst->mhlcreate_data.input_data;
+  st_file_data_ext* p_file_data;
+  st_logging_data logging_data;
+  unsigned int i;
+  int res;
+  size_t hashes_num;
+  MHL_HASH_TYPE hash_types[2];
+  char* hash_strs[2];
+  const char* expected_strs[2];
+  unsigned long long total_bytes;
+
+  // progress is not reported from parallel jobs
+  memset((void*) &logging_data, 0, sizeof(logging_data) / sizeof(char));
+
+  for (i = 0; i < p_files_data->files_data_cnt; ++i)
+  {
+    p_file_data = p_files_data->files_data_array + i;
+
+    hashes_num = 0;
+    hash_types[hashes_num] = p_file_data->major_hash.hash_type;
+    expected_strs[hashes_num++] = p_file_data->major_hash.hash_sum;
+    if (p_file_data->aux_hash.hash_sum != NULL)
+    {
+      hash_types[hashes_num] = p_file_data->aux_hash.hash_type;
+      expected_strs[hashes_num++] = p_file_data->aux_hash.hash_sum;
+    }
+
+    res = 
+      wcalculate_hash_strings(p_file_data->orig_wfilename, hash_types, 
+                              hash_strs, hashes_num, &total_bytes, 
+                              &logging_data);
+    if (res == 0)
+    {
+      if (total_bytes != p_file_data->file_sz)
+      {
+        res = ERRCODE_MHL_CHECK_FILE_SIZE_FAILED;
+      }
+      else if (strcmp(hash_strs[0], expected_strs[0]) != 0 ||
+               (hashes_num > 1 && strcmp(hash_strs[1], expected_strs[1]) != 0))
+      {
+        res = ERRCODE_MHL_CHECK_HASH_FAILED;
+      }
+
+      free(hash_strs[0]);
+      if (hashes_num > 1)
+      {
+        free(hash_strs[1]);
+      }
+    }
+
+    if (res != 0)
+    {
+      fprintf(
+        stderr, 
+        "Error: Verification of the copied file failed: '%ls'\n"
+        "Description: %s\n",
+        p_file_data->orig_wfilename,
+        mhl_error_code_description(res));
+
+      ++p_job->n_files_failed;
+      p_job->res = res;
+    }
+  }
+}
+
+/* Verifies all destinations in parallel, one job per destination, 
+ * the calling thread is one of the jobs.
+ */
+static int
+verify_copies(st_copy_destination* dsts, size_t dst_num, 
+              st_copy_control_options* p_opts)
+{
+  int res = 0;
+  size_t i;
+  size_t started_num = 0;
+  unsigned long n_files_failed = 0;
+  st_aux_verify_copy_job* jobs;
+  mhlosi_thread* threads;
+
+  jobs = 
+    (st_aux_verify_copy_job*) calloc(dst_num, sizeof(st_aux_verify_copy_job));
+  threads = (mhlosi_thread*) calloc(dst_num, sizeof(mhlosi_thread));
+  if (jobs == NULL || threads == NULL)
+  {
+    free(jobs);
+    free(threads);
+    fprintf(stderr, "Out of memory.\n");
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  if (p_opts->common.logging_data.v_data.verbose_level)
+  {
+    logit(&p_opts->common.logging_data.v_data, "Verifying copied files\n");
+  }
+
+  for (i = 0; i < dst_num; ++i)
+  {
+    jobs[i].p_dst = dsts + i;
+  }
+
+  for (i = 1; i < dst_num; ++i)
+  {
+    if (mhlosi_thread_create(&threads[i], aux_verify_copy_job, &jobs[i]) != 0)
+    {
+      break;
+    }
+    ++started_num;
+  }
+
+  aux_verify_copy_job(&jobs[0]);
+  // destinations without a thread are verified here one by one
+  for (i = started_num + 1; i < dst_num; ++i)
+  {
+    aux_verify_copy_job(&jobs[i]);
+  }
+
+  for (i = 1; i <= started_num; ++i)
+  {
+    mhlosi_thread_join(threads[i]);
+  }
+
+  for (i = 0; i < dst_num; ++i)
+  {
+    n_files_failed += jobs[i].n_files_failed;
+    if (jobs[i].res != 0)
+    {
+      res = jobs[i].res;
+    }
+  }
+
+  if (p_opts->common.logging_data.v_data.verbose_level)
+  {
+    logit(&p_opts->common.logging_data.v_data, 
+          "Verification of copied files is done, %lu failed\n", 
+          n_files_failed);
+  }
+
+  free(jobs);
+  free(threads);
+  return res;
+}
+
+static
+int parse_copy_params(int argc, const char* argv[],
+  st_copy_control_options* opts,
+  st_conversion_settings* p_cs)
+{
+  int i;
+  en_opts res;
+  size_t wstr_sz;
+  int res1;
+
+  if (argc < 2)
+  {
+    print_error(
+      "Arguments error: "
+      "Incorrect number of arguments.\n");
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  // traverse through arguments
+  i = 1;
+  do
+  {
+    res = recognise_option(argv[i]); 
+    switch (res)
+    {
+    case OPT_V:
+      if (opts->common.logging_data.v_data.verbose_level == VL_VERY_VERBOSE)
+      {
+        print_error(
+          "Arguments error: "
+          "Only one verbose option of '-v' or '-vv' "
+          "may be specified.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      opts->common.logging_data.v_data.verbose_level = VL_VERBOSE;
+      break;
+
+    case OPT_VV:
+      if (opts->common.logging_data.v_data.verbose_level == VL_VERBOSE)
+      {
+        print_error(
+          "Arguments error: "
+          "Only one verbose option of '-v' or '-vv' "
+          "may be specified.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      opts->common.logging_data.v_data.verbose_level = VL_VERY_VERBOSE;
+      break;
+
+    case OPT_Y:
+      opts->common.logging_data.v_data.machine_output = 1;
+      break;
+
+    case OPT_Z:
+      opts->gzip_output = 1;
+      break;
+
+    case OPT_VERIFY:
+      opts->opt_verify = 1;
+      break;
+
+    case OPT_T:
+      if ( i + 1 >= argc)
+      {
+        print_error(
+        "Arguments error: "
+        "'md5' and/or 'sha1' and/or 'xxhash' and/or 'xxhash64' and/or 'xxhash64be' hash-type argument must follow the '-t' "
+        "option.\n");
+
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+
+      ++i;
+      res = recognise_option(argv[i]);
+      // no break here, analyze hash type
+
+    case OPT_MD5:
+    case OPT_SHA1:
+    case OPT_XXHASH:
+    case OPT_XXHASH64:
+    case OPT_XXHASH64BE:
+      if (res == OPT_MD5)
+      {
+        opts->opt_md5 = 1;
+      }
+      else if (res == OPT_SHA1)
+      {
+        opts->opt_sha1 = 1;
+      }
+      else if (res == OPT_XXHASH)
+      {
+        opts->opt_xxhash = 1;
+      }
+      else if (res == OPT_XXHASH64)
+      {
+        opts->opt_xxhash64 = 1;
+      }
+      else if (res == OPT_XXHASH64BE)
+      {
+        opts->opt_xxhash64be = 1;
+      }
+      else
+      {
+        print_error(
+        "Arguments error: "
+        "'md5' and/or 'sha1' and/or 'xxhash' and/or 'xxhash64' and/or 'xxhash64be' hash-type argument must follow the '-t' "
+        "option.\n");
+
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      break;
+
+    case OPT_LOG_LIMIT:
+      if (i + 1 >= argc || 
+          parse_log_limit(argv[i + 1], 
+                          &opts->common.logging_data.v_data.log_mem_limit) != 0)
+      {
+        print_error(
+          "Arguments error: "
+          "A positive size in MB must follow the '--log-limit' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      ++i;
+      break;
+
+    case OPT_LOG_SUMMARY:
+      opts->common.logging_data.v_data.log_summary = 1;
+      break;
+
+    case OPT_D:
+      ++i;
+      if (i == argc)
+      {
+        print_error(
+          "Arguments error: "
+          "A directory name must follow the '-d' or '--destination' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+
+      if (opts->dst_wdirs_cnt == opts->dst_wdirs_capacity)
+      {
+        res1 = increase_allocated_memory(
+          (void**)&opts->dst_wdirs,
+          &opts->dst_wdirs_capacity,
+          opts->dst_wdirs_capacity ? opts->dst_wdirs_capacity * 2 : 2,
+          sizeof(wchar_t*));
+
+        if (res1 != 0)
+        {
+          fprintf(stderr, "Out of memory.\n");
+          return res1;
+        }
+      }
+
+      res1 = convert_composed_from_locale_to_wchar(
+        argv[i],
+        strlen(argv[i]),
+        &opts->dst_wdirs[opts->dst_wdirs_cnt],
+        &wstr_sz,
+        p_cs);
+
+      if (res1 != 0)
+      {
+        fprintf(stderr, "Failed to convert directory name from locale encoding into "
+          "wide char: %s.\n", argv[i]);
+        return res1;
+      }
+
+      make_wpath_os_specific(opts->dst_wdirs[opts->dst_wdirs_cnt]);
+      ++opts->dst_wdirs_cnt;
+      break;
+
+    case NOT_OPT:
+      opts->common.files_argv_index = i;
+      if (!opts->opt_md5 && !opts->opt_sha1 && !opts->opt_xxhash && !opts->opt_xxhash64 && !opts->opt_xxhash64be)
+      {
+         opts->opt_md5 = 1;
+      }
+      res = NULL_OPT;
+      break;
+
+    case NULL_OPT:
+    default:
+      print_error(
+        "Arguments error: "
+        "Incorrect parameters order or number\n");
+      return ERRCODE_WRONG_ARGUMENTS;
+    }
+    ++i;
+  } while (i < argc && (res != NULL_OPT));
+
+  if (opts->common.files_argv_index == 0)
+  {
+    print_error(
+      "Arguments error: "
+      "Files or folders to copy must be specified.\n");
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (opts->dst_wdirs_cnt == 0)
+  {
+    print_error(
+      "Arguments error: "
+      "At least one destination folder must be specified "
+      "with '-d' or '--destination' option.\n");
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  return 0; 
+}
+
+static void
+free_copy_destinations(st_copy_destination* dsts, size_t dst_num)
+{
+  size_t i;
+
+  if (dsts == NULL)
+  {
+    return;
+  }
+
+  for (i = 0; i < dst_num; ++i)
+  {
+    free(dsts[i].root_wpath);
+    finalize_mhlcreate_data(&dsts[i].mhlcreate_data);
+  }
+  free(dsts);
+}
+
+/* Prepares data of MHL files of destinations, each destination gets 
+ * its MHL file in its root folder.
+ */
+static int
+prepare_copy_destinations(
+  st_copy_control_options* opts,
+  const char* startdate_str,
+  const char* startdate_log_str,
+  const struct tm* start_gmtm,
+  st_copy_destination** p_dsts,
+  st_conversion_settings* p_cs)
+{
+  int res = 0;
+  unsigned int i;
+  unsigned int j;
+  st_copy_destination* dsts;
+  st_copy_destination* p_dst;
+  st_mhlcreate_data* p_mhlcreate_data;
+
+  dsts = 
+    (st_copy_destination*) calloc(opts->dst_wdirs_cnt, 
+                                  sizeof(st_copy_destination));
+  if (dsts == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  for (i = 0; i < opts->dst_wdirs_cnt && res == 0; ++i)
+  {
+    p_dst = dsts + i;
+    p_mhlcreate_data = &p_dst->mhlcreate_data;
+
+    res = init_mhlcreate_data(p_mhlcreate_data, 
+                              &opts->common.logging_data.v_data);
+    if (res != 0)
+    {
+      break;
+    }
+
+    res = convert_to_absolute_normalized_wpath(opts->dst_wdirs[i], 
+                                               &p_dst->root_wpath, p_cs);
+    if (res != 0)
+    {
+      p_dst->root_wpath = NULL;
+      fprintf(stderr, "Cannot make absolute path for: '%ls'\n", 
+              opts->dst_wdirs[i]);
+      break;
+    }
+
+    for (j = 0; j < i; ++j)
+    {
+      if (does_wfilenames_equal(dsts[j].root_wpath, p_dst->root_wpath))
+      {
+        fprintf(stderr, "Arguments error: "
+                "Destination folder '%ls' is specified more than once.\n",
+                p_dst->root_wpath);
+        res = ERRCODE_WRONG_ARGUMENTS;
+      }
+    }
+    if (res != 0)
+    {
+      break;
+    }
+
+    p_mhlcreate_data->creator_data.startdate_str = 
+      mhlosi_strdup(startdate_str);
+    p_mhlcreate_data->creator_data.startdate_log_str = 
+      mhlosi_strdup(startdate_log_str);
+
+    res = increase_allocated_memory(
+      (void**)&p_mhlcreate_data->mhl_paths.mhl_files_data,
+      &p_mhlcreate_data->mhl_paths.mhl_files_data_capacity,
+      1,
+      sizeof(st_mhl_file_data));
+
+    if (res != 0 || p_mhlcreate_data->creator_data.startdate_str == NULL ||
+        p_mhlcreate_data->creator_data.startdate_log_str == NULL)
+    {
+      fprintf(stderr, "Out of memory.\n");
+      res = ERRCODE_OUT_OF_MEM;
+      break;
+    }
+
+    p_mhlcreate_data->mhl_paths.gzip_output = opts->gzip_output;
+    p_mhlcreate_data->mhl_paths.mhl_files_data_cnt = 1;
+    p_mhlcreate_data->mhl_paths.mhl_files_data->mhl_wdirname = 
+      mhlosi_wstrdup(p_dst->root_wpath);
+    if (p_mhlcreate_data->mhl_paths.mhl_files_data->mhl_wdirname == NULL)
+    {
+      p_mhlcreate_data->mhl_paths.mhl_files_data_cnt = 0;
+      fprintf(stderr, "Out of memory.\n");
+      res = ERRCODE_OUT_OF_MEM;
+      break;
+    }
+
+    // the header of each destination goes only to its own MHL file
+    set_log_buffer_section(opts->common.logging_data.v_data.p_log, i + 1);
+    res = preprocess_mhlcreate_data(p_mhlcreate_data, start_gmtm, p_cs);
+  }
+  set_log_buffer_section(opts->common.logging_data.v_data.p_log, 0);
+
+  if (res != 0)
+  {
+    // all the items were inited by calloc at least
+    free_copy_destinations(dsts, opts->dst_wdirs_cnt);
+    return res;
+  }
+
+  *p_dsts = dsts;
+  return 0;
+}
+
+static int
+process_copy(
+  int argc, 
+  const char * argv[], 
+  st_copy_control_options* opts,
+  st_copy_destination* dsts,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  size_t i;
+  st_aux_copy_data copy_data;
+  st_progress_data* p_progress_data;
+
+  memset((void*) &copy_data, 0, sizeof(copy_data) / sizeof(char));
+  copy_data.p_opts = opts;
+  copy_data.dsts = dsts;
+  copy_data.dst_num = opts->dst_wdirs_cnt;
+  copy_data.p_cs = p_cs;
+
+  if (opts->opt_md5)
+  {
+    copy_data.hash_types[copy_data.hashes_num++] = MHL_HT_MD5;
+  }
+  if (opts->opt_sha1)
+  {
+    copy_data.hash_types[copy_data.hashes_num++] = MHL_HT_SHA1;
+  }
+  if (opts->opt_xxhash)
+  {
+    copy_data.hash_types[copy_data.hashes_num++] = MHL_HT_XXHASH;
+  }
+  if (opts->opt_xxhash64)
+  {
+    copy_data.hash_types[copy_data.hashes_num++] = MHL_HT_XXHASH64;
+  }
+  if (opts->opt_xxhash64be)
+  {
+    copy_data.hash_types[copy_data.hashes_num++] = MHL_HT_XXHASH64BE;
+  }
+
+  res = check_copy_sources(argc, argv, &copy_data);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  p_progress_data = &opts->common.logging_data.progress_data;
+  p_progress_data->total_sz = 0;
+
+  res = run_func_on_args(argc, argv, 
+    &opts->common,
+    p_cs, 
+    (void*) &p_progress_data->total_sz, // pass callback data
+    calculate_total_sz); // pass callback function
+
+  if (res != 0)
+  {
+    return res;
+  }
+
+  p_progress_data->n_files = p_progress_data->n_files_processed;
+  p_progress_data->n_seqs = 0;
+
+  for (i = 0; i < copy_data.dst_num; ++i)
+  {
+    res = wmake_dirs(dsts[i].root_wpath);
+    if (res != 0)
+    {
+      fprintf(stderr, "Error: Cannot create destination folder '%ls'.\n",
+              dsts[i].root_wpath);
+      return res;
+    }
+  }
+
+  copy_data.dst_wfns = (wchar_t**) calloc(copy_data.dst_num, sizeof(wchar_t*));
+  copy_data.dst_results = (int*) calloc(copy_data.dst_num, sizeof(int));
+  if (copy_data.dst_wfns == NULL || copy_data.dst_results == NULL)
+  {
+    free(copy_data.dst_wfns);
+    free(copy_data.dst_results);
+    fprintf(stderr, "Out of memory.\n");
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  res = create_copy_engine(copy_data.dst_num, opts->opt_verify, 
+                           &copy_data.p_engine);
+  if (res != 0)
+  {
+    free(copy_data.dst_wfns);
+    free(copy_data.dst_results);
+    return res;
+  }
+
+  // Print start message
+  if (opts->common.logging_data.v_data.verbose_level >= VL_VERBOSE)
+  {
+    print_start_message("Started copying", &opts->common.logging_data);
+  }
+
+  p_progress_data->processed_sz = 0;
+  p_progress_data->logged_sz = 0;
+
+  start_progress_reporter(&opts->common.logging_data);
+  res = process_copy_sources(argc, argv, &copy_data);
+  stop_progress_reporter(&opts->common.logging_data);
+
+  // Print finish message
+  if (opts->common.logging_data.v_data.verbose_level >= VL_VERBOSE)
+  {
+    print_finish_message("Finished copying", &opts->common.logging_data);
+  }
+
+  free_copy_engine(copy_data.p_engine);
+  free(copy_data.dst_wfns);
+  free(copy_data.dst_results);
+
+  if (res == 0 && opts->opt_verify)
+  {
+    res = verify_copies(dsts, copy_data.dst_num, opts);
+  }
+
+  return res;
+}
+
+int run_mhl_copy(int argc, const char* argv[])
+{
+  int res;
+  int res1;
+  unsigned int i;
+  st_copy_control_options copy_opts;
+  st_copy_destination* dsts = NULL;
+  st_conversion_settings css;
+  struct tm start_gmtm;
+  struct tm finish_gmtm;
+  char* startdate_str = NULL;
+  char* startdate_log_str = NULL;
+  char* finishdate_str = NULL;
+  char* finishdate_log_str = NULL;
+  st_mhlcreate_data* p_mhlcreate_data;
+
+  mhlosi_setlocale();
+  res = init_st_conversion_settings(&css);
+  if (res != 0)
+  {
+    fprintf(
+      stderr, 
+      "Cannot init conversion settings: %s\n", 
+      mhl_error_code_description(res));
+    
+    return res;
+  }
+
+  res = init_st_copy_control_options(&copy_opts);
+  if (res != 0)
+  {
+    fprintf(
+        stderr, 
+        "Initialisation error: %s\n", 
+        mhl_error_code_description(res));
+
+    free_st_conversion_settings(&css);
+    return res;
+  }
+
+  res = parse_copy_params(argc, argv, &copy_opts, &css);
+  if (res != 0)
+  {
+    free_st_copy_control_options(&copy_opts);
+    free_st_conversion_settings(&css);
+    mhlcopy_usage();
+    return res;
+  }
+
+  if (copy_opts.common.logging_data.v_data.verbose_level)
+  {
+    res = open_log_str(&copy_opts.common.logging_data.v_data);
+    if (res != 0)
+    {
+      free_st_copy_control_options(&copy_opts);
+      free_st_conversion_settings(&css);
+      return res;
+    }
+  }
+
+  res = get_xml_date(&startdate_str, &start_gmtm);
+  if (res == 0)
+  {
+    res = date_to_log_str(&startdate_log_str, &start_gmtm);
+  }
+  if (res != 0)
+  {
+    fprintf(stderr, "Getting or processing of startdate failed.\n");
+    free(startdate_str);
+    free_st_copy_control_options(&copy_opts);
+    free_st_conversion_settings(&css);
+    return res;
+  }
+
+  res = prepare_copy_destinations(&copy_opts, startdate_str, 
+                                  startdate_log_str, &start_gmtm, &dsts, 
+                                  &css);
+  free(startdate_str);
+  if (res != 0)
+  {
+    free(startdate_log_str);
+    free_st_copy_control_options(&copy_opts);
+    free_st_conversion_settings(&css);
+    return res;
+  }
+
+  if (copy_opts.common.logging_data.v_data.verbose_level)
+  {
+    logit(&copy_opts.common.logging_data.v_data, "-------------------\n");
+    logit(&copy_opts.common.logging_data.v_data, 
+          "Start date in UTC: %s.\n", startdate_log_str);
+    logit(&copy_opts.common.logging_data.v_data, "-------------------\n");
+    logit(&copy_opts.common.logging_data.v_data, 
+          "Copying files and calculating hash sums\n");
+  }
+  free(startdate_log_str);
+
+  res = process_copy(argc, argv, &copy_opts, dsts, &css);
+  if (res != 0)
+  {
+    fprintf(
+        stderr, 
+        "Error while copying files: %s\n", 
+        mhl_error_code_description(res));
+  }
+
+  // files copied before an error are sealed anyway, so the destinations
+  // can be verified and the copy completed later
+  res1 = get_xml_date(&finishdate_str, &finish_gmtm);
+  if (res1 == 0)
+  {
+    res1 = date_to_log_str(&finishdate_log_str, &finish_gmtm);
+  }
+  if (res1 != 0)
+  {
+    fprintf(stderr, "Getting or processing of finishdate failed.\n");
+  }
+
+  for (i = 0; i < copy_opts.dst_wdirs_cnt && res1 == 0; ++i)
+  {
+    p_mhlcreate_data = &dsts[i].mhlcreate_data;
+    if (p_mhlcreate_data->input_data.files_data_cnt == 0)
+    {
+      continue;
+    }
+
+    p_mhlcreate_data->creator_data.finishdate_str = 
+      mhlosi_strdup(finishdate_str);
+    p_mhlcreate_data->creator_data.finishdate_log_str = 
+      mhlosi_strdup(finishdate_log_str);
+    if (p_mhlcreate_data->creator_data.finishdate_str == NULL || 
+        p_mhlcreate_data->creator_data.finishdate_log_str == NULL)
+    {
+      fprintf(stderr, "Out of memory.\n");
+      res1 = ERRCODE_OUT_OF_MEM;
+      break;
+    }
+
+    set_log_buffer_section(copy_opts.common.logging_data.v_data.p_log, i + 1);
+    res1 = create_mhl_files(p_mhlcreate_data, &css);
+  }
+  set_log_buffer_section(copy_opts.common.logging_data.v_data.p_log, 0);
+
+  if (res == 0)
+  {
+    res = res1;
+  }
+
+  free(finishdate_str);
+  free(finishdate_log_str);
+  free_copy_destinations(dsts, copy_opts.dst_wdirs_cnt);
+  free_st_copy_control_options(&copy_opts);
+  free_st_conversion_settings(&css);
+  return res;
+}
@@ -39,6 +39,7 @@
 #include <generics/char_conversions.h>
 #include <generics/std_funcs_os_anonymizer.h>
 #include <generics/memory_management.h>
+#include <generics/line_reader.h>
 #include <generics/filesystem_handlers/public_interface.h>
 
 #include <mhltools_common/files_data.h>
@@ -121,6 +122,11 @@ int parse_printmhl_params(
       data->p_v_data->machine_output = 1;
       ++i;
     }
+    else if (strcmp(argv[i], "-z") == 0 || strcmp(argv[i], "--gzip") == 0)
+    {
+      data->mhl_paths.gzip_output = 1;
+      ++i;
+    }
     else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--stdin") == 0)
     {
       if ((mode_data->mode != MD_NOT_SET) && (mode_data->mode != MD_STDIN))
@@ -228,28 +234,211 @@ int parse_printmhl_params(
   return 0;
 }
 
+// Files hashed in the same second share the hash date string
+typedef struct _st_input_hashdate
+{
+  time_t hash_time;
+  char* hashdate_str; // allocated in the arena of files data
+} st_input_hashdate;
+
+static
 int
-process_input(st_input_parse_data* mode_data, st_mhlcreate_data* data, st_conversion_settings* p_cs)
+fill_input_hashdate(
+  st_file_data_ext* file_data,
+  st_input_hashdate* p_hashdate,
+  st_memory_arena* p_arena)
 {
-  char input_buf[BUFF_SZ];
-  unsigned int i = 0;
+  time_t cur_tm;
+  struct tm gm_date;
+  char date_str[MHL_DATE_LENGTH + 1];
+  int res;
+
+  cur_tm = time(NULL);
+  if (cur_tm < 0)
+  {
+    fprintf(stderr, "Unknown error, time() call failed. " 
+            "Errno=%d. Error:%s\n",
+            errno, strerror(errno));
+    return ERRCODE_UNKNOWN_ERROR;
+  }
+
+  if (p_hashdate->hashdate_str == NULL || cur_tm != p_hashdate->hash_time)
+  {
+    res = convert_time_to_gmtime(cur_tm, &gm_date);
+    if (res == 0)
+    {
+      res = format_xml_date(date_str, &gm_date);
+    }
+    if (res != 0)
+    {
+      fprintf(stderr, "Getting or processing of hashdate failed.\n");
+      return res;
+    }
+
+    p_hashdate->hashdate_str = 
+      memory_arena_strndup(p_arena, date_str, MHL_DATE_LENGTH);
+    if (p_hashdate->hashdate_str == NULL)
+    {
+      fprintf(stderr, "Out of memory.\n");
+      return ERRCODE_OUT_OF_MEM;
+    }
+    p_hashdate->hash_time = cur_tm;
+  }
+
+  file_data->hashdate_str = p_hashdate->hashdate_str;
+  return 0;
+}
+
+/* Formats time as date string in the arena
+ */
+static
+int
+aux_arena_date_str(time_t tm, char** p_date_str, st_memory_arena* p_arena)
+{
+  struct tm gm_date;
+  char date_str[MHL_DATE_LENGTH + 1];
   int res;
-  char* str_res;
-  FILE* input_fl;
-//  input_fl = fopen("C:\\projects\\mhlhash\\mhl-1203h\\bin\\Windows_7_x64\\Debug\\TEST\\opssl_output", "r");
- 
-  data->input_data.files_data_array = 
-    (st_file_data_ext*)calloc(INITIAL_FILES_CAPACITY, sizeof(st_file_data_ext));
 
-  if (data->input_data.files_data_array == NULL)
+  res = convert_time_to_gmtime(tm, &gm_date);
+  if (res == 0)
+  {
+    res = format_xml_date(date_str, &gm_date);
+  }
+  if (res != 0)
+  {
+    return res;
+  }
+
+  *p_date_str = memory_arena_strndup(p_arena, date_str, MHL_DATE_LENGTH);
+  if (*p_date_str == NULL)
   {
-    data->input_data.files_data_cnt = 0;
     fprintf(stderr, "Out of memory.\n");
     return ERRCODE_OUT_OF_MEM;
   }
 
-  data->input_data.files_data_capacity = 0;
-  data->input_data.files_data_cnt = 0;
+  return 0;
+}
+
+/* Gets size and dates of file, which are not given in the input
+ */
+static
+int
+fill_input_stat_data(
+  st_file_data_ext* file_data,
+  st_memory_arena* p_arena)
+{
+  st_mhlosi_stat wfl_stat;
+  int res;
+
+  res = get_wfile_stat_data(file_data->orig_wfilename, &wfl_stat);
+  if (res != 0)
+  {
+    if (res == ERRCODE_NO_SUCH_FILE)
+    {
+      fprintf(stderr, "Error: File does not exist: '%ls'.\n",
+              file_data->orig_wfilename);
+    }
+    else
+    {
+      fprintf(stderr, "Error: Cannot get file's data, stat() failed for file: " 
+              "%ls. Errno=%d. Error:%s\n",
+              file_data->orig_wfilename, errno, strerror(errno));
+    }
+    return res;
+  }
+
+  file_data->file_sz = wfl_stat.st_data.st_size;
+  res = aux_arena_date_str(wfl_stat.st_data.st_mtime, 
+                           &file_data->lastmodificationdate_str, p_arena);
+  if (res != 0)
+  {
+    if (res == ERRCODE_UNRECOGNIZED_TIME)
+    {
+      fprintf(stderr, "Processing of lastmodificationdate failed for file: %ls.\n",
+              file_data->orig_wfilename);
+    }
+    return res;
+  }
+
+#ifdef WIN
+  res = aux_arena_date_str(wfl_stat.st_data.st_ctime, 
+                           &file_data->creationdate_str, p_arena);
+  if (res != 0)
+  {
+    if (res == ERRCODE_UNRECOGNIZED_TIME)
+    {
+      fprintf(stderr, "Processing of creationdate failed for file: %ls.\n",
+              file_data->orig_wfilename);
+    }
+    return res;
+  }
+#endif
+
+  return 0;
+}
+
+/* Adds file from the line of input to data of MHL files.
+ * Files with size and mtime in the input are not accessed.
+ */
+static
+int
+process_input_line(
+  const char* line,
+  st_file_data_ext* file_data,
+  st_input_hashdate* p_hashdate,
+  st_mhlcreate_data* data, 
+  st_conversion_settings* p_cs)
+{
+  st_memory_arena* p_arena = &data->input_data.data_arena;
+  int res;
+
+  res = fill_data_from_input_in_arena(line, file_data, p_arena, p_cs);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = init_file_data_wpath(file_data, &(data->workdir_wpath));
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = fill_input_hashdate(file_data, p_hashdate, p_arena);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  if (file_data->lastmodificationdate_str == NULL)
+  {
+    res = fill_input_stat_data(file_data, p_arena);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  return 0;
+}
+
+int
+process_input(st_input_parse_data* mode_data, st_mhlcreate_data* data, st_conversion_settings* p_cs)
+{
+  unsigned int i = 0;
+  int res;
+  char* line;
+  size_t line_sz;
+  FILE* input_fl;
+  st_line_reader reader;
+  st_input_hashdate hashdate;
+  st_files_data* p_files_data = &data->input_data;
+
+  memset((void*) &hashdate, 0, sizeof(hashdate) / sizeof(char));
+
+  // strings of all files are kept till the MHL files are written
+  p_files_data->is_data_in_arena = 1;
+  init_memory_arena(&p_files_data->data_arena, 0);
 
   if (mode_data->mode == MD_FILEIN)
   {
@@ -266,91 +455,98 @@ process_input(st_input_parse_data* mode_data, st_mhlcreate_data* data, st_conver
     input_fl = stdin;
   }
 
-  while (!feof(input_fl))
+  res = init_line_reader(&reader, input_fl, 0);
+  if (res != 0)
   {
-    if (i == data->input_data.files_data_capacity)
+    fprintf(stderr, "Out of memory.\n");
+  }
+
+  while (res == 0)
+  {
+    res = read_line(&reader, &line, &line_sz);
+    if (res != 0)
+    {
+      fprintf(stderr, "Cannot read input: %s\n", 
+              mhl_error_code_description(res));
+      break;
+    }
+
+    if (line == NULL)
+    {
+      break;
+    }
+
+    if (i == p_files_data->files_data_capacity)
     {
       // increase allocated memory twice
       res = increase_allocated_memory(
-        (void**)&data->input_data.files_data_array,
-          &data->input_data.files_data_capacity,
-          data->input_data.files_data_capacity? data->input_data.files_data_capacity * 2 : INITIAL_FILES_CAPACITY,
+        (void**)&p_files_data->files_data_array,
+          &p_files_data->files_data_capacity,
+          p_files_data->files_data_capacity ? 
+            p_files_data->files_data_capacity * 2 : INITIAL_FILES_CAPACITY,
           sizeof(st_file_data_ext));
 
       if (res != 0)
       {
         fprintf(stderr, "Out of memory.\n");
-        return res;
-      }
-    }
-
-    input_buf[0] = '\0';
-
-    str_res = fgets(input_buf, sizeof(char)*BUFF_SZ, input_fl);
-    if (input_buf[0] == '\0' || str_res == NULL)
-    {
-      if (feof(input_fl))
-      {
         break;
       }
-      else 
-      {
-        print_error("Unrecognized data format: empty line is read.");
-        return ERRCODE_WRONG_INPUT_FORMAT;
-      }
     }
    
     if (data->p_v_data->verbose_level >= VL_VERY_VERBOSE)
     {
-      logit(data->p_v_data, "%s", input_buf);
+      logit_item(data->p_v_data, "%s\n", line);
     }
 
-    data->input_data.files_data_cnt += 1;
+    p_files_data->files_data_cnt += 1;
 
-    res = fill_data_from_input(input_buf, data->input_data.files_data_array+i, p_cs);
+    res = process_input_line(line, p_files_data->files_data_array + i, 
+                             &hashdate, data, p_cs);
     if (res != 0)
     {
-      return res;
+      fprintf(stderr, "Error in line %lu of input.\n", reader.line_no);
+      break;
     }
 
-    res = 
-      process_file(
-        data->input_data.files_data_array+i, 
-        &(data->workdir_wpath),
-        p_cs);
+    res = add_data_to_containing_folders(&(data->mhl_paths),
+      p_files_data->files_data_array + i, i);
 
-    if (res != 0)
+    if (res == ERRCODE_WRONG_FILE_LOCATION)
     {
-      return res;
+      fprintf(stderr, "The folders of MHL files are specified with '-o' or "
+              "'--output-folder' option.\n");
     }
 
-    res = add_data_to_containing_folders(&(data->mhl_paths),
-      data->input_data.files_data_array+i, i);
-
     if (res != 0)
     {
-       return res;
+      break;
     }
 
     if (data->p_v_data->verbose_level >= VL_VERY_VERBOSE)
     {
-      logit(data->p_v_data, "Done\n");
+      logit_item(data->p_v_data, "Done\n");
     }
 
     ++i;
   }
 
+  free_line_reader(&reader);
   if (mode_data->mode == MD_FILEIN)
   {
     fclose(input_fl);
   }
 
+  if (res != 0)
+  {
+    return res;
+  }
+
   if (i == 0)
   {
     print_error("Wrong input format: no hash sums were specified in stdin or input file");
     return ERRCODE_WRONG_INPUT_FORMAT;
   }
-  data->input_data.files_data_cnt = i;  
+  p_files_data->files_data_cnt = i;  
 
   return 0;
 }
@@ -397,6 +593,16 @@ int run_input_parse_mode(int argc, const char * argv[],
     finalize_mhlcreate_data(&data);
     return res;
   }
+
+  if (data.p_v_data->verbose_level)
+  {
+    res = open_log_str(data.p_v_data);
+    if (res != 0)
+    {
+      finalize_mhlcreate_data(&data);
+      return res;
+    }
+  }
   
   // This call shall be done after parameters parsing and before
   // any further work with mhlcreate_data
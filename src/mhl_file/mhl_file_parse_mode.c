@@ -23,24 +23,64 @@
  SOFTWARE.
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <facade_info/error_codes.h>
 #include <generics/char_conversions.h>
+#include <generics/filesystem_handlers/public_interface.h>
+#include <mhltools_common/files_data.h>
 #include <mhltools_common/logging.h>
+#include <mhltools_common/usage_printing.h>
+#include <parsemhl/mhl_file_handlers.h>
 
 #include <mhl_file/mhl_file_parse_mode.h>
 
-/*
-    else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--parse") == 0)
+#define PARSE_OUTPUT_BUFF_SZ (1024*1024)
+
+typedef struct _st_mhl_file_parse_data
+{
+  // MHL file name as it is given in arguments
+  const char* filename;
+  // records are separated with '\0' instead of newlines
+  unsigned char null_separated;
+} st_mhl_file_parse_data;
+
+//
+// Output of records in the "hash_syntax" format, it is buffered 
+// on its own, since it is written item by item
+//
+typedef struct _st_parse_output
+{
+  FILE* out;
+  char* buf;
+  size_t buf_sz;
+  char separator;
+  unsigned char write_failed;
+} st_parse_output;
+
+// returns in case of success: 0
+//         in case of failure: error code, and print error message to stderr
+static int
+parse_mhl_file_params(
+  int argc, 
+  const char* argv[],
+  st_mhl_file_parse_data* data)
+{
+  int i;
+
+  for (i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--parse") == 0)
     {
-      if ((data->mode != MD_NOT_SET) && (data->mode != MD_3_FILE_PARSE))
+      if (data->filename != NULL)
       {
         print_error(
           "Arguments error: "
-          "The '-p' option can be used only in parsing MHL file mode\n");
+          "Only one MHL file may be specified.\n");
         return ERRCODE_WRONG_ARGUMENTS;
       }
-      data->mode = MD_3_FILE_PARSE;
+
       ++i;
       if (i == argc)
       {
@@ -50,13 +90,233 @@
         return ERRCODE_WRONG_ARGUMENTS;
       }
       data->filename = argv[i];
-      ++i;
     }
-*/
+    else if (strcmp(argv[i], "-0") == 0 || strcmp(argv[i], "--null") == 0)
+    {
+      data->null_separated = 1;
+    }
+    else
+    {
+      print_error(
+        "Arguments error: "
+        "Incorrect mhlfile usage.\n");
+      return ERRCODE_WRONG_ARGUMENTS;
+    }
+  }
+
+  if (data->filename == NULL)
+  {
+    print_error(
+      "Arguments error: "
+      "A file name must follow the '-p' option.\n");
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  return 0;
+}
+
+/* @return Prefix of the record for given hash type, 
+ *         as it is recognized by fill_data_from_input()
+ */
+static const char*
+aux_hash_sign(MHL_HASH_TYPE hash_type)
+{
+  switch (hash_type)
+  {
+    case MHL_HT_MD5:
+      return MD5_HASH_SIGN;
+    case MHL_HT_SHA1:
+      return SHA1_HASH_SIGN;
+    case MHL_HT_XXHASH:
+      return XXHASH_HASH_SIGN;
+    case MHL_HT_XXHASH64:
+      return XXHASH64_HASH_SIGN;
+    case MHL_HT_XXHASH64BE:
+      return XXHASH64BE_HASH_SIGN;
+    default:
+      return NULL_HASH_SIGN;
+  }
+}
+
+static int
+aux_flush_output(st_parse_output* p_output)
+{
+  if (p_output->buf_sz != 0 && 
+      fwrite(p_output->buf, 1, p_output->buf_sz, p_output->out) != 
+        p_output->buf_sz)
+  {
+    p_output->write_failed = 1;
+    return ERRCODE_IO_ERROR;
+  }
+  
+  p_output->buf_sz = 0;
+  return 0;
+}
+
+static int
+aux_write_output(st_parse_output* p_output, const char* data, size_t data_sz)
+{
+  int res;
+
+  if (p_output->buf_sz + data_sz > PARSE_OUTPUT_BUFF_SZ)
+  {
+    res = aux_flush_output(p_output);
+    if (res != 0)
+    {
+      return res;
+    }
+
+    if (data_sz > PARSE_OUTPUT_BUFF_SZ)
+    {
+      if (fwrite(data, 1, data_sz, p_output->out) != data_sz)
+      {
+        p_output->write_failed = 1;
+        return ERRCODE_IO_ERROR;
+      }
+      return 0;
+    }
+  }
+
+  memcpy(p_output->buf + p_output->buf_sz, data, data_sz);
+  p_output->buf_sz += data_sz;
+  return 0;
+}
+
+/* Writes digest of the item as "HASH_TYPE(PATH)= HASH_VALUE" record.
+ */
+static int
+aux_output_hash(
+  const st_mhl_file_u8item* p_u8item, 
+  const st_mhl_file_u8hash* p_u8hash, 
+  st_parse_output* p_output)
+{
+  int res;
+  const char* sign;
+
+  sign = aux_hash_sign(p_u8hash->hash_type);
+
+  res = aux_write_output(p_output, sign, strlen(sign));
+  if (res == 0)
+  {
+    res = aux_write_output(p_output, "(", 1);
+  }
+  if (res == 0)
+  {
+    res = 
+      aux_write_output(p_output, p_u8item->abs_u8path, 
+                       p_u8item->abs_u8path_sz);
+  }
+  if (res == 0)
+  {
+    res = aux_write_output(p_output, ")= ", 3);
+  }
+  if (res == 0)
+  {
+    res = 
+      aux_write_output(p_output, p_u8hash->u8str_hash_sum, 
+                       p_u8hash->u8str_hash_sum_sz);
+  }
+  if (res == 0)
+  {
+    res = aux_write_output(p_output, &p_output->separator, 1);
+  }
+  
+  return res;
+}
+
+/* Writes one record for each digest of the item, in the order of MHL file.
+ */
+static int
+aux_output_item(const st_mhl_file_u8item* p_u8item, void* data)
+{
+  int res = 0;
+  unsigned int i;
+  st_parse_output* p_output = (st_parse_output*) data;
+
+  for (i = 0; i < p_u8item->hashes_num && res == 0; ++i)
+  {
+    res = aux_output_hash(p_u8item, &p_u8item->hashes[i], p_output);
+  }
+  
+  return res;
+}
 
 int run_mhl_file_parse_mode(int argc, const char* argv[],
   st_conversion_settings* p_cs)
 {
-  print_error("MHL file parsing mode is not implemented yet.\n");
-  return ERRCODE_NOT_IMPLEMENTED;
-}
\ No newline at end of file
+  int res;
+  int ires = 0;
+  wchar_t* mhl_wpath;
+  wchar_t* abs_mhl_wpath = NULL;
+  st_mhl_file_parse_data data;
+  st_parse_output output;
+
+  memset((void*) &data, 0, sizeof(data));
+  res = parse_mhl_file_params(argc, argv, &data);
+  if (res != 0)
+  {
+    mhlfile_usage();
+    return res;
+  }
+
+  mhl_wpath = 
+    strdup_and_convert_composed_from_locale_to_wchar(data.filename, p_cs, &ires);
+  if (mhl_wpath == NULL)
+  {
+    fprintf(stderr, "Failed to convert file name from locale encoding into "
+            "wide char: %s.\n", data.filename);
+    return ires == 0 ? ERRCODE_OUT_OF_MEM : ires;
+  }
+  make_wpath_os_specific(mhl_wpath);
+
+  res = convert_to_absolute_normalized_wpath(mhl_wpath, &abs_mhl_wpath, p_cs);
+  free(mhl_wpath);
+  if (res != 0)
+  {
+    fprintf(
+            stderr, 
+            "Cannot convert path to MHL file ('%s') to absolute path.\n"
+            "Description: %s\n",
+            data.filename,      
+            mhl_error_code_description(res));
+    return res;
+  }
+
+  output.out = stdout;
+  output.buf_sz = 0;
+  output.write_failed = 0;
+  output.separator = data.null_separated ? '\0' : '\n';
+  output.buf = (char*) malloc(PARSE_OUTPUT_BUFF_SZ);
+  if (output.buf == NULL)
+  {
+    free(abs_mhl_wpath);
+    fprintf(stderr, "Out of memory.\n");
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  res = stream_mhl_wfile(abs_mhl_wpath, aux_output_item, &output, p_cs);
+  if (res == 0)
+  {
+    res = aux_flush_output(&output);
+  }
+  if (res == 0 && fflush(output.out) != 0)
+  {
+    output.write_failed = 1;
+    res = ERRCODE_IO_ERROR;
+  }
+
+  if (output.write_failed)
+  {
+    fprintf(stderr, "Failed to write hash values of MHL file '%ls'.\n", 
+            abs_mhl_wpath);
+  }
+  else if (res != 0)
+  {
+    fprintf(stderr, "Failed to parse MHL file '%ls': %s\n", 
+            abs_mhl_wpath, mhl_error_code_description(res));
+  }
+
+  free(output.buf);
+  free(abs_mhl_wpath);
+  return res;
+}
@@ -23,11 +23,15 @@
  SOFTWARE.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <wchar.h>
 
 #include <facade_info/error_codes.h>
 #include <generics/char_conversions.h>
+#include <generics/os_threads.h>
 #include <mhltools_common/logging.h>
+#include <mhltools_common/progress_reporter.h>
 #include <mhltools_common/usage_printing.h>
 
 #include <mhltools_common/controlling_data.h>
@@ -37,6 +41,34 @@
 
 #include <mhl_hash/hash_calculate.h>
 
+#define HASH_KINDS_NUM 5
+#define HASH_QUEUE_SLOTS_PER_JOB 4
+#define MAX_HASH_JOBS 256
+
+typedef int (*HashStringCalculator)(
+  const wchar_t* wfname, 
+  char** hash_str,
+  size_t* hash_str_sz,
+  unsigned long long* total_bytes,
+  st_logging_data* log_data);
+
+typedef struct _st_aux_hash_kind
+{
+  const char* output_name; // e.g. "MD5" in "MD5(file)= hash"
+  const char* error_name;  // e.g. "MD5" in "Cannot calculate MD5 hash"
+  HashStringCalculator calculate;
+} st_aux_hash_kind;
+
+// in the order of output
+static const st_aux_hash_kind hash_kinds[HASH_KINDS_NUM] =
+{
+  { "MD5", "MD5", wcalculate_md5_hash_string },
+  { "SHA1", "SHA1", wcalculate_sha1_hash_string },
+  { "XXHash", "XX", wcalculate_xx_hash_string },
+  { "XXHash64", "XX64", wcalculate_xx64_hash_string },
+  { "XXHash64BE", "XX64BE", wcalculate_xx64be_hash_string }
+};
+
 typedef struct _st_calculate_options
 {
   // common options for all applications
@@ -48,8 +80,61 @@ typedef struct _st_calculate_options
   unsigned char opt_xxhash64;
     unsigned char opt_xxhash64be;
   unsigned char mhlformat_compatible;
+  unsigned int jobs; // number of parallel jobs, 0 or 1: files are hashed one by one
 } st_calculate_options;
 
+//
+// Hashes of one file, ready for output
+//
+typedef struct _st_aux_file_hashes
+{
+  int res;
+  char* filename; // in locale, NULL if the name can't be converted
+  char* hash_strs[HASH_KINDS_NUM];
+  unsigned long long total_bytes[HASH_KINDS_NUM];
+  int failed_kind; // index of hash kind, which failed, -1 if none
+} st_aux_file_hashes;
+
+//
+// Slot of the queue of files, which are hashed in parallel
+//
+typedef struct _st_aux_hash_slot
+{
+  wchar_t* wfilename;
+  unsigned char is_done;
+  st_aux_file_hashes hashes;
+} st_aux_hash_slot;
+
+//
+// Files are hashed by parallel jobs and printed in the order of queuing
+// by the calling thread, so that the output is the same as for files 
+// hashed one by one.
+//
+typedef struct _st_aux_hash_queue
+{
+  st_calculate_options* p_opts;
+  st_conversion_settings* p_cs;
+
+  st_aux_hash_slot* slots;
+  size_t slots_num;
+  // sequence numbers, slot of a number is number % slots_num
+  unsigned long long next_queued;
+  unsigned long long next_taken;
+  unsigned long long next_printed;
+
+  // result of the current argument, files after the failed one are dropped
+  int arg_res;
+  unsigned long n_failed;
+  unsigned long n_dropped;
+
+  unsigned long long unlogged_sz; // for machine readable progress
+
+  unsigned char is_stopped;
+  mhlosi_mutex mutex;
+  mhlosi_cond queued_cond;
+  mhlosi_cond done_cond;
+} st_aux_hash_queue;
+
 typedef struct _st_aux_calculate_and_print_hash_data
 {
   st_calculate_options* p_opts;
@@ -81,15 +166,138 @@ void free_st_calculate_options(st_calculate_options* p_opt)
   return;
 }
 
+static
+unsigned char
+is_hash_kind_selected(const st_calculate_options* p_opts, int kind)
+{
+  switch (kind)
+  {
+  case 0:
+    return p_opts->opt_md5;
+  case 1:
+    return p_opts->opt_sha1;
+  case 2:
+    return p_opts->opt_xxhash;
+  case 3:
+    return p_opts->opt_xxhash64;
+  case 4:
+    return p_opts->opt_xxhash64be;
+  }
+  return 0;
+}
+
+/* Calculates the selected hashes of the file, stops at the first failed one.
+ * The name of the file must be converted to locale before.
+ */
+static
+void
+calculate_file_hashes(
+  const wchar_t* wfilename,
+  const st_calculate_options* p_opts,
+  st_logging_data* p_logging_data,
+  st_aux_file_hashes* p_hashes)
+{
+  int kind;
+  size_t hash_str_sz;
+
+  for (kind = 0; kind < HASH_KINDS_NUM; ++kind)
+  {
+    if (!is_hash_kind_selected(p_opts, kind))
+    {
+      continue;
+    }
+
+    p_hashes->res = 
+      hash_kinds[kind].calculate(wfilename, &p_hashes->hash_strs[kind], 
+                                 &hash_str_sz, &p_hashes->total_bytes[kind],
+                                 p_logging_data);
+    if (p_hashes->res != 0)
+    {
+      p_hashes->hash_strs[kind] = NULL;
+      p_hashes->failed_kind = kind;
+      return;
+    }
+  }
+}
+
+/* Prints hashes of the file and the error, which stopped calculation.
+ * @return result of calculation of hashes
+ */
+static
+int
+print_file_hashes(
+  const st_aux_file_hashes* p_hashes,
+  const st_calculate_options* p_opts)
+{
+  int kind;
+
+  if (p_hashes->filename == NULL)
+  {
+    printf("Failed to convert a filename from multi-byte characters to locale\n");
+    return p_hashes->res;
+  }
+
+  for (kind = 0; kind < HASH_KINDS_NUM; ++kind)
+  {
+    if (kind == p_hashes->failed_kind)
+    {
+      fprintf(
+        stderr, 
+        "Cannot calculate %s hash for the file: '%s'\n"
+        "Description: %s\n",
+        hash_kinds[kind].error_name,
+        p_hashes->filename,
+        mhl_error_code_description(p_hashes->res));
+
+      return p_hashes->res;
+    }
+
+    if (p_hashes->hash_strs[kind] == NULL)
+    {
+      continue;
+    }
+
+    printf("%s(%s)= %s\n", hash_kinds[kind].output_name, 
+           p_hashes->filename, p_hashes->hash_strs[kind]);
+
+    if (p_opts->common.logging_data.v_data.verbose_level >= VL_VERY_VERBOSE)
+    {
+      printf("%s: read %llu bytes\n", p_hashes->filename, 
+             p_hashes->total_bytes[kind]);
+    }
+  }
+
+  return p_hashes->res;
+}
+
+static
+void
+init_file_hashes(st_aux_file_hashes* p_hashes)
+{
+  memset((void*) p_hashes, 0, sizeof(*p_hashes) / sizeof(char));
+  p_hashes->failed_kind = -1;
+}
+
+static
+void
+free_file_hashes(st_aux_file_hashes* p_hashes)
+{
+  int kind;
+
+  free(p_hashes->filename);
+  for (kind = 0; kind < HASH_KINDS_NUM; ++kind)
+  {
+    free(p_hashes->hash_strs[kind]);
+  }
+  init_file_hashes(p_hashes);
+}
+
 static int
 calculate_and_print_hash(const wchar_t* wfilename, void* data)
 {
   int res;
-  unsigned long long total_bytes = 0;
-  char* hash_str;
-  size_t hash_str_sz;
   st_aux_calculate_and_print_hash_data* p_data;
-  char* filename;
+  st_aux_file_hashes hashes;
   
   if (wfilename == 0 || wfilename[0] == L'\0' || data == 0)
   {
@@ -98,171 +306,334 @@ calculate_and_print_hash(const wchar_t* wfilename, void* data)
   
   p_data = (st_aux_calculate_and_print_hash_data*) data;
 
-  filename = strdup_and_convert_from_wchar_to_locale(wfilename,
-    p_data->p_cs, &res);
+  init_file_hashes(&hashes);
+  hashes.filename = strdup_and_convert_from_wchar_to_locale(wfilename,
+    p_data->p_cs, &hashes.res);
 
-  if (res != 0)
+  if (hashes.res != 0)
   {
-    printf("Failed to convert a filename from multi-byte characters to locale\n");
-    return res;
+    hashes.filename = NULL;
   }
-
-  if (p_data->p_opts->opt_md5)
+  else
   {
-    res = 
-      wcalculate_md5_hash_string(wfilename, &hash_str, &hash_str_sz,
-                                 &total_bytes, &p_data->p_opts->common.logging_data);
+    calculate_file_hashes(wfilename, p_data->p_opts, 
+                          &p_data->p_opts->common.logging_data, &hashes);
+  }
 
-    if (res != 0)
+  res = print_file_hashes(&hashes, p_data->p_opts);
+  free_file_hashes(&hashes);
+  return res;
+}
+
+/* Hashes queued files until the queue is stopped. Progress of the jobs
+ * is counted by the progress reporter if it runs, otherwise the printing
+ * thread reports it per file.
+ */
+static
+void
+aux_hash_queue_job(void* arg)
+{
+  st_aux_hash_queue* p_queue = (st_aux_hash_queue*) arg;
+  st_aux_hash_slot* p_slot;
+  st_logging_data logging_data;
+
+  memset((void*) &logging_data, 0, sizeof(logging_data) / sizeof(char));
+  attach_progress_worker(&logging_data, &p_queue->p_opts->common.logging_data);
+
+  mhlosi_mutex_lock(&p_queue->mutex);
+  for (;;)
+  {
+    while (p_queue->next_taken == p_queue->next_queued && 
+           !p_queue->is_stopped)
     {
-      fprintf(
-        stderr, 
-        "Cannot calculate MD5 hash for the file: '%s'\n"
-        "Description: %s\n",
-         filename,
-         mhl_error_code_description(res));
+      mhlosi_cond_wait(&p_queue->queued_cond, &p_queue->mutex);
+    }
 
-      free(filename);
-      return res;
+    if (p_queue->next_taken == p_queue->next_queued)
+    {
+      break;
     }
-    else 
-    {       
-      printf("MD5(%s)= %s\n", filename, hash_str);
-      
-      if (p_data->p_opts->common.logging_data.v_data.verbose_level >= VL_VERY_VERBOSE)
-      {
-        printf("%s: read %llu bytes\n", filename, total_bytes);
-      }
-      
-      free(hash_str);
+
+    p_slot = 
+      &p_queue->slots[p_queue->next_taken++ % p_queue->slots_num];
+    if (p_slot->is_done)
+    {
+      // the name of the file can't be converted
+      continue;
     }
+
+    mhlosi_mutex_unlock(&p_queue->mutex);
+    calculate_file_hashes(p_slot->wfilename, p_queue->p_opts, 
+                          &logging_data, &p_slot->hashes);
+    mhlosi_mutex_lock(&p_queue->mutex);
+
+    p_slot->is_done = 1;
+    mhlosi_cond_signal(&p_queue->done_cond);
   }
-  
-  //
-  if (p_data->p_opts->opt_sha1)
+  mhlosi_mutex_unlock(&p_queue->mutex);
+}
+
+/* Prints the first queued file, if it is hashed, or waits for it.
+ * Called with the mutex locked, unlocks it while printing.
+ */
+static
+void
+print_first_queued_file(st_aux_hash_queue* p_queue)
+{
+  st_aux_hash_slot* p_slot;
+  st_logging_data* p_logging_data;
+  unsigned long long file_sz;
+  int res;
+  int kind;
+
+  p_slot = &p_queue->slots[p_queue->next_printed % p_queue->slots_num];
+  while (!p_slot->is_done)
   {
-    res = 
-      wcalculate_sha1_hash_string(wfilename, &hash_str, &hash_str_sz,
-                                  &total_bytes, &p_data->p_opts->common.logging_data);
+    mhlosi_cond_wait(&p_queue->done_cond, &p_queue->mutex);
+  }
+
+  // the slot is not used by the jobs until it is printed
+  mhlosi_mutex_unlock(&p_queue->mutex);
 
+  if (p_queue->arg_res != 0)
+  {
+    ++p_queue->n_dropped;
+  }
+  else
+  {
+    res = print_file_hashes(&p_slot->hashes, p_queue->p_opts);
     if (res != 0)
     {
-      fprintf(
-        stderr, 
-        "Cannot calculate SHA1 hash for the file: '%s'\n"
-        "Description: %s\n",
-        filename,
-        mhl_error_code_description(res));
-
-      free(filename);
-      return res;
+      p_queue->arg_res = res;
+      ++p_queue->n_failed;
     }
-    else 
-    {       
-      printf("SHA1(%s)= %s\n", filename, hash_str);
 
-      if (p_data->p_opts->common.logging_data.v_data.verbose_level >= VL_VERY_VERBOSE)
-      {
-        printf("%s: read %llu bytes\n", filename, total_bytes);
-      }
+    file_sz = 0;
+    for (kind = 0; kind < HASH_KINDS_NUM; ++kind)
+    {
+      file_sz += p_slot->hashes.total_bytes[kind];
+    }
 
-      free((void*) hash_str);
+    p_logging_data = &p_queue->p_opts->common.logging_data;
+    p_logging_data->progress_data.processed_sz += file_sz;
+    p_queue->unlogged_sz += file_sz;
+    if (p_logging_data->progress_data.p_reporter == NULL &&
+        p_logging_data->progress_data.processed_sz >= 
+          p_logging_data->progress_data.logged_sz + PROGRESS_STEP_SZ)
+    {
+      print_progress_message(p_logging_data);
+      print_machine_progress_message(stderr, p_logging_data, 
+                                     (unsigned long) p_queue->unlogged_sz);
+      p_queue->unlogged_sz = 0;
     }
   }
+
+  free(p_slot->wfilename);
+  p_slot->wfilename = NULL;
+  free_file_hashes(&p_slot->hashes);
+
+  mhlosi_mutex_lock(&p_queue->mutex);
+  p_slot->is_done = 0;
+  ++p_queue->next_printed;
+}
+
+/* FileProcessingCallback, which queues the file for hashing. Hashed files 
+ * are printed meanwhile. Files of the argument after the failed one are 
+ * not hashed.
+ */
+static int
+queue_file_for_hash(const wchar_t* wfilename, void* data)
+{
+  st_aux_hash_queue* p_queue;
+  st_aux_hash_slot* p_slot;
+  size_t wfilename_len;
   
-  if (p_data->p_opts->opt_xxhash)
+  if (wfilename == 0 || wfilename[0] == L'\0' || data == 0)
   {
-      res =
-      wcalculate_xx_hash_string(wfilename, &hash_str, &hash_str_sz,
-                                  &total_bytes, &p_data->p_opts->common.logging_data);
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
 
-      if (res != 0)
-      {
-          fprintf(
-                  stderr,
-                  "Cannot calculate XX hash for the file: '%s'\n"
-                  "Description: %s\n",
-                  filename,
-                  mhl_error_code_description(res));
-
-          free(filename);
-          return res;
-      }
-      else
-      {
-          printf("XXHash(%s)= %s\n", filename, hash_str);
+  p_queue = (st_aux_hash_queue*) data;
 
-          if (p_data->p_opts->common.logging_data.v_data.verbose_level >= VL_VERY_VERBOSE)
-          {
-              printf("%s: read %llu bytes\n", filename, total_bytes);
-          }
+  mhlosi_mutex_lock(&p_queue->mutex);
+  while (p_queue->next_queued - p_queue->next_printed == p_queue->slots_num ||
+         (p_queue->next_printed != p_queue->next_queued &&
+          p_queue->slots[p_queue->next_printed % p_queue->slots_num].is_done))
+  {
+    print_first_queued_file(p_queue);
+  }
 
-          free((void*) hash_str);
-      }
+  if (p_queue->arg_res != 0)
+  {
+    mhlosi_mutex_unlock(&p_queue->mutex);
+    ++p_queue->n_dropped;
+    return 0;
   }
-  if (p_data->p_opts->opt_xxhash64)
+
+  p_slot = &p_queue->slots[p_queue->next_queued % p_queue->slots_num];
+  mhlosi_mutex_unlock(&p_queue->mutex);
+
+  // conversion settings can't be used by parallel jobs
+  init_file_hashes(&p_slot->hashes);
+  p_slot->hashes.filename = strdup_and_convert_from_wchar_to_locale(wfilename,
+    p_queue->p_cs, &p_slot->hashes.res);
+  if (p_slot->hashes.res != 0)
   {
-      res =
-      wcalculate_xx64_hash_string(wfilename, &hash_str, &hash_str_sz,
-                                &total_bytes, &p_data->p_opts->common.logging_data);
+    p_slot->hashes.filename = NULL;
+    p_slot->is_done = 1;
+  }
+  else
+  {
+    wfilename_len = wcslen(wfilename);
+    p_slot->wfilename = 
+      (wchar_t*) calloc(wfilename_len + 1, sizeof(wchar_t));
+    if (p_slot->wfilename == NULL)
+    {
+      free_file_hashes(&p_slot->hashes);
+      return ERRCODE_OUT_OF_MEM;
+    }
+    wcscpy(p_slot->wfilename, wfilename);
+  }
 
-      if (res != 0)
-      {
-          fprintf(
-                  stderr,
-                  "Cannot calculate XX64 hash for the file: '%s'\n"
-                  "Description: %s\n",
-                  filename,
-                  mhl_error_code_description(res));
-
-          free(filename);
-          return res;
-      }
-      else
-      {
-          printf("XXHash64(%s)= %s\n", filename, hash_str);
+  mhlosi_mutex_lock(&p_queue->mutex);
+  ++p_queue->next_queued;
+  mhlosi_cond_signal(&p_queue->queued_cond);
+  mhlosi_mutex_unlock(&p_queue->mutex);
+  return 0;
+}
 
-          if (p_data->p_opts->common.logging_data.v_data.verbose_level >= VL_VERY_VERBOSE)
-          {
-              printf("%s: read %llu bytes\n", filename, total_bytes);
-          }
+/* QueuedFilesWaitCallback, which prints all queued files of the argument.
+ */
+static int
+wait_for_queued_hashes(
+  void* data,
+  unsigned long* p_n_failed,
+  unsigned long* p_n_dropped)
+{
+  st_aux_hash_queue* p_queue;
+  int res;
 
-          free((void*) hash_str);
-      }
+  p_queue = (st_aux_hash_queue*) data;
+
+  mhlosi_mutex_lock(&p_queue->mutex);
+  while (p_queue->next_printed != p_queue->next_queued)
+  {
+    print_first_queued_file(p_queue);
+  }
+  mhlosi_mutex_unlock(&p_queue->mutex);
+
+  res = p_queue->arg_res;
+  *p_n_failed = p_queue->n_failed;
+  *p_n_dropped = p_queue->n_dropped;
+
+  p_queue->arg_res = 0;
+  p_queue->n_failed = 0;
+  p_queue->n_dropped = 0;
+  return res;
+}
+
+/* Hashes files of the arguments by parallel jobs.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ *         ERRCODE_NOT_IMPLEMENTED if the jobs can't be started,
+ *         no file is processed then.
+ */
+static
+int
+calculate_and_print_hashes_in_parallel(
+  int argc, 
+  const char * argv[], 
+  st_calculate_options* opts,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  unsigned int i;
+  unsigned int started_num;
+  unsigned long n_failed;
+  unsigned long n_dropped;
+  st_aux_hash_queue queue;
+  mhlosi_thread* threads;
+
+  memset((void*) &queue, 0, sizeof(queue) / sizeof(char));
+  queue.p_opts = opts;
+  queue.p_cs = p_cs;
+  queue.slots_num = opts->jobs * HASH_QUEUE_SLOTS_PER_JOB;
+
+  queue.slots = 
+    (st_aux_hash_slot*) calloc(queue.slots_num, sizeof(st_aux_hash_slot));
+  threads = (mhlosi_thread*) calloc(opts->jobs, sizeof(mhlosi_thread));
+  if (queue.slots == NULL || threads == NULL)
+  {
+    free(queue.slots);
+    free(threads);
+    return ERRCODE_OUT_OF_MEM;
   }
-  if (p_data->p_opts->opt_xxhash64be)
+
+  if (mhlosi_mutex_init(&queue.mutex) != 0)
+  {
+    free(queue.slots);
+    free(threads);
+    return ERRCODE_INTERNAL_ERROR;
+  }
+  if (mhlosi_cond_init(&queue.queued_cond) != 0)
   {
-      res =
-            wcalculate_xx64be_hash_string(wfilename, &hash_str, &hash_str_sz,
-                                          &total_bytes, &p_data->p_opts->common.logging_data);
+    mhlosi_mutex_destroy(&queue.mutex);
+    free(queue.slots);
+    free(threads);
+    return ERRCODE_INTERNAL_ERROR;
+  }
+  if (mhlosi_cond_init(&queue.done_cond) != 0)
+  {
+    mhlosi_cond_destroy(&queue.queued_cond);
+    mhlosi_mutex_destroy(&queue.mutex);
+    free(queue.slots);
+    free(threads);
+    return ERRCODE_INTERNAL_ERROR;
+  }
 
-      if (res != 0)
-      {
-            fprintf(
-                    stderr,
-                    "Cannot calculate XX64BE hash for the file: '%s'\n"
-                    "Description: %s\n",
-                    filename,
-                    mhl_error_code_description(res));
-
-            free(filename);
-            return res;
-      }
-      else
-      {
-          printf("XXHash64BE(%s)= %s\n", filename, hash_str);
+  started_num = 0;
+  for (i = 0; i < opts->jobs; ++i)
+  {
+    if (mhlosi_thread_create(&threads[i], aux_hash_queue_job, &queue) != 0)
+    {
+      break;
+    }
+    ++started_num;
+  }
 
-          if (p_data->p_opts->common.logging_data.v_data.verbose_level >= VL_VERY_VERBOSE)
-          {
-              printf("%s: read %llu bytes\n", filename, total_bytes);
-          }
+  if (started_num == 0)
+  {
+    res = ERRCODE_NOT_IMPLEMENTED;
+  }
+  else
+  {
+    res = run_queued_func_on_args(argc, argv,
+      &opts->common,
+      p_cs,
+      (void*) &queue, // pass callback data
+      queue_file_for_hash, // pass callback function
+      wait_for_queued_hashes);
+
+    // files queued before a failure are printed anyway
+    wait_for_queued_hashes((void*) &queue, &n_failed, &n_dropped);
+  }
 
-          free((void*) hash_str);
-      }
+  mhlosi_mutex_lock(&queue.mutex);
+  queue.is_stopped = 1;
+  mhlosi_cond_broadcast(&queue.queued_cond);
+  mhlosi_mutex_unlock(&queue.mutex);
+
+  for (i = 0; i < started_num; ++i)
+  {
+    mhlosi_thread_join(threads[i]);
   }
 
-  free(filename);
-  return 0;
+  mhlosi_cond_destroy(&queue.done_cond);
+  mhlosi_cond_destroy(&queue.queued_cond);
+  mhlosi_mutex_destroy(&queue.mutex);
+  free(queue.slots);
+  free(threads);
+  return res;
 }
 
 static 
@@ -320,11 +691,24 @@ process_calculate_hash(
   cph_data.p_cs = p_cs;
   cph_data.p_opts = opts;
   
-  res = run_func_on_args(argc, argv,
-    &opts->common,
-    p_cs,
-    (void*) &cph_data, // pass callback data
-    calculate_and_print_hash); // pass callback function
+  start_progress_reporter(&opts->common.logging_data);
+
+  res = ERRCODE_NOT_IMPLEMENTED;
+  if (opts->jobs > 1)
+  {
+    res = calculate_and_print_hashes_in_parallel(argc, argv, opts, p_cs);
+  }
+
+  if (res == ERRCODE_NOT_IMPLEMENTED)
+  {
+    res = run_func_on_args(argc, argv,
+      &opts->common,
+      p_cs,
+      (void*) &cph_data, // pass callback data
+      calculate_and_print_hash); // pass callback function
+  }
+
+  stop_progress_reporter(&opts->common.logging_data);
 
   // Print finish message
   if (opts->common.logging_data.v_data.verbose_level >= VL_VERBOSE)
@@ -335,6 +719,28 @@ process_calculate_hash(
   return res;
 }
 
+static
+int
+parse_jobs_number(const char* jobs_str, unsigned int* p_jobs)
+{
+  char* end;
+  unsigned long jobs;
+
+  if (jobs_str[0] < '0' || jobs_str[0] > '9')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  jobs = strtoul(jobs_str, &end, 10);
+  if (*end != '\0' || jobs == 0 || jobs > MAX_HASH_JOBS)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  *p_jobs = (unsigned int) jobs;
+  return 0;
+}
+
 static
 int parse_hash_calculate_params(int argc, const char* argv[],
   st_calculate_options* opts,
@@ -394,6 +800,17 @@ int parse_hash_calculate_params(int argc, const char* argv[],
       opts->common.use_sequences = 1;
       break;
 
+    case OPT_JOBS:
+      if (i + 1 >= argc || parse_jobs_number(argv[i + 1], &opts->jobs) != 0)
+      {
+        print_error(
+          "Arguments error: "
+          "A positive number of jobs must follow the '--jobs' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      ++i;
+      break;
+
 
     case OPT_T:
       if ( i + 1 >= argc)
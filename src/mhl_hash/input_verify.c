@@ -22,17 +22,531 @@
  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  SOFTWARE.
  */
+
+/*
+ * @file: input_verify.c
+ *
+ * Batch checking of files against hash values, read line by line in the
+ * format of 'mhl hash' output (see help topic 'hash_syntax') from a file
+ * or stdin. Lines are checked in batches by parallel jobs, results are
+ * printed in machine readable form in the order of lines.
+ */
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 
 #include <facade_info/error_codes.h>
 #include <generics/char_conversions.h>
+#include <generics/os_threads.h>
+#include <generics/std_funcs_os_anonymizer.h>
+#include <generics/filesystem_handlers/public_interface.h>
 #include <mhltools_common/logging.h>
+#include <mhltools_common/hashing.h>
+#include <mhltools_common/files_data.h>
+#include <mhltools_common/options.h>
+#include <mhltools_common/usage_printing.h>
 
 #include <mhl_hash/input_verify.h>
 
+// lines read and checked at once
+#define INPUT_VERIFY_BATCH_SZ 1024
+#define INPUT_VERIFY_MAX_JOBS 256
+
+typedef struct _st_input_verify_options
+{
+  // common options for all applications
+  st_logging_data logging_data;
+
+  unsigned int jobs; // 0: number of processors
+  const char* list_filename; // NULL: lines are read from stdin
+} st_input_verify_options;
+
+typedef struct _st_input_verify_item
+{
+  unsigned long line_no;
+  int res; // result of parsing of the line or of the check
+  st_file_data_ext file_data;
+  unsigned long long file_sz;
+} st_input_verify_item;
+
+typedef struct _st_input_verify_batch
+{
+  mhlosi_mutex mutex;
+  st_input_verify_item* items;
+  size_t items_num;
+  size_t next_item_no; // the first item, which is not taken by a job yet
+} st_input_verify_batch;
+
+static
+int
+parse_input_verify_params(
+  int argc, 
+  const char * argv[], 
+  st_input_verify_options* opts)
+{
+  int i;
+  en_opts res;
+  char* end;
+  unsigned long jobs;
+
+  for (i = 1; i < argc; ++i)
+  {
+    res = recognise_option(argv[i]); 
+    switch (res)
+    {
+    case OPT_V:
+      if (opts->logging_data.v_data.verbose_level == VL_VERY_VERBOSE)
+      {
+        print_error(
+          "Arguments error: "
+          "Only one verbose option of '-v' or '-vv' "
+          "may be specified.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      opts->logging_data.v_data.verbose_level = VL_VERBOSE;
+      break;
+
+    case OPT_VV:
+      if (opts->logging_data.v_data.verbose_level == VL_VERBOSE)
+      {
+        print_error(
+          "Arguments error: "
+          "Only one verbose option of '-v' or '-vv' "
+          "may be specified.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      opts->logging_data.v_data.verbose_level = VL_VERY_VERBOSE;
+      break;
+
+    case OPT_Y:
+    case OPT_S:
+      // results are printed in machine readable form anyway
+      break;
+
+    case OPT_JOBS:
+      jobs = 0;
+      if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9')
+      {
+        jobs = strtoul(argv[++i], &end, 10);
+        if (*end != '\0' || jobs > INPUT_VERIFY_MAX_JOBS)
+        {
+          jobs = 0;
+        }
+      }
+      if (jobs == 0)
+      {
+        print_error(
+          "Arguments error: "
+          "A positive number of jobs must follow the '--jobs' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      opts->jobs = (unsigned int) jobs;
+      break;
+
+    case NOT_OPT:
+      if (i + 1 != argc)
+      {
+        print_error(
+          "Arguments error: "
+          "Only one file with hash values may follow the options.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      // "-" stands for stdin
+      opts->list_filename = strcmp(argv[i], "-") != 0 ? argv[i] : NULL;
+      break;
+
+    default:
+      print_error(
+        "Arguments error: "
+        "Incorrect parameters order or number\n");
+      return ERRCODE_WRONG_ARGUMENTS;
+    }
+  }
+
+  return 0; 
+}
+
+static
+void
+free_input_verify_item(st_input_verify_item* p_item)
+{
+  free(p_item->file_data.orig_wfilename);
+  free_fs_wpath(&p_item->file_data.file_wpath);
+  free(p_item->file_data.lastmodificationdate_str);
+  free(p_item->file_data.major_hash.hash_sum);
+  free(p_item->file_data.aux_hash.hash_sum);
+  memset((void*) p_item, 0, sizeof(*p_item) / sizeof(char));
+}
+
+/* Checks the file of the item against its hash value, and against 
+ * its size, if the size is given in the line.
+ * Files with NULL hash are checked for existence only.
+ */
+static
+int
+check_input_verify_item(
+  st_input_verify_item* p_item, 
+  st_logging_data* p_logging_data)
+{
+  int res;
+  char* hash_str;
+  size_t hash_str_sz;
+  st_hash_data* p_hash = &p_item->file_data.major_hash;
+  const wchar_t* wfilename = p_item->file_data.orig_wfilename;
+
+  if (p_hash->hash_type == MHL_HT_NULL)
+  {
+    res = get_wfile_size(wfilename, &p_item->file_sz);
+    if (res == 0 && p_item->file_data.lastmodificationdate_str != NULL &&
+        p_item->file_sz != p_item->file_data.file_sz)
+    {
+      res = ERRCODE_MHL_CHECK_FILE_SIZE_FAILED;
+    }
+    return res;
+  }
+
+  switch (p_hash->hash_type)
+  {
+  case MHL_HT_MD5:
+    res = wcalculate_md5_hash_string(wfilename, &hash_str, &hash_str_sz, 
+                                     &p_item->file_sz, p_logging_data);
+    break;
+  case MHL_HT_SHA1:
+    res = wcalculate_sha1_hash_string(wfilename, &hash_str, &hash_str_sz, 
+                                      &p_item->file_sz, p_logging_data);
+    break;
+  case MHL_HT_XXHASH:
+    res = wcalculate_xx_hash_string(wfilename, &hash_str, &hash_str_sz, 
+                                    &p_item->file_sz, p_logging_data);
+    break;
+  case MHL_HT_XXHASH64:
+    res = wcalculate_xx64_hash_string(wfilename, &hash_str, &hash_str_sz, 
+                                      &p_item->file_sz, p_logging_data);
+    break;
+  case MHL_HT_XXHASH64BE:
+    res = wcalculate_xx64be_hash_string(wfilename, &hash_str, &hash_str_sz, 
+                                        &p_item->file_sz, p_logging_data);
+    break;
+  default:
+    return ERRCODE_INTERNAL_ERROR;
+  }
+
+  if (res != 0)
+  {
+    return res;
+  }
+
+  if (p_item->file_data.lastmodificationdate_str != NULL &&
+      p_item->file_sz != p_item->file_data.file_sz)
+  {
+    res = ERRCODE_MHL_CHECK_FILE_SIZE_FAILED;
+  }
+  else if (hash_str_sz != strlen(p_hash->hash_sum) ||
+           mhlosi_strncasecmp(hash_str, p_hash->hash_sum, hash_str_sz) != 0)
+  {
+    res = ERRCODE_MHL_CHECK_HASH_FAILED;
+  }
+
+  free(hash_str);
+  return res;
+}
+
+/* Checks items of the batch until all of them are taken. 
+ * Progress is not reported from the jobs.
+ */
+static
+void
+aux_input_verify_job(void* arg)
+{
+  size_t i;
+  st_input_verify_batch* p_batch = (st_input_verify_batch*) arg;
+  st_logging_data logging_data;
+
+  memset((void*) &logging_data, 0, sizeof(logging_data) / sizeof(char));
+
+  for (;;)
+  {
+    mhlosi_mutex_lock(&p_batch->mutex);
+    i = p_batch->next_item_no;
+    if (i < p_batch->items_num)
+    {
+      ++p_batch->next_item_no;
+    }
+    mhlosi_mutex_unlock(&p_batch->mutex);
+
+    if (i == p_batch->items_num)
+    {
+      break;
+    }
+
+    // each job writes only the items it has taken
+    if (p_batch->items[i].res == 0)
+    {
+      p_batch->items[i].res = 
+        check_input_verify_item(&p_batch->items[i], &logging_data);
+    }
+  }
+}
+
+/* Checks the batch by parallel jobs, the calling thread is one of them.
+ */
+static
+void
+check_input_verify_batch(
+  st_input_verify_batch* p_batch, 
+  mhlosi_thread* threads,
+  unsigned int jobs)
+{
+  unsigned int i;
+  unsigned int started_num = 0;
+
+  p_batch->next_item_no = 0;
+  if (jobs > p_batch->items_num)
+  {
+    jobs = (unsigned int) p_batch->items_num;
+  }
+
+  for (i = 1; i < jobs; ++i)
+  {
+    if (mhlosi_thread_create(&threads[started_num], aux_input_verify_job, 
+                             p_batch) != 0)
+    {
+      break;
+    }
+    ++started_num;
+  }
+
+  aux_input_verify_job(p_batch);
+
+  for (i = 0; i < started_num; ++i)
+  {
+    mhlosi_thread_join(threads[i]);
+  }
+}
+
+static
+void
+print_input_verify_item(
+  const st_input_verify_item* p_item,
+  st_logging_data* p_logging_data)
+{
+  st_progress_data* p_progress = &p_logging_data->progress_data;
+
+  ++p_progress->n_files;
+  ++p_progress->n_files_processed;
+  p_progress->total_sz += p_item->file_sz;
+  p_progress->processed_sz += p_item->file_sz;
+
+  if (p_item->file_data.orig_wfilename == NULL)
+  {
+    // the line can't be parsed
+    fprintf(stdout, "%s|error|%d|line %lu|%s\n", p_logging_data->tool_name, 
+            p_item->res, p_item->line_no, 
+            mhl_error_code_description(p_item->res));
+    ++p_progress->n_files_failed;
+  }
+  else if (p_item->res != 0)
+  {
+    print_output_verify_failure(stdout, p_item->file_data.orig_wfilename, 
+                                NULL, p_item->res, p_logging_data);
+    ++p_progress->n_files_failed;
+  }
+  else
+  {
+    print_output_verify_success(stdout, p_logging_data, 
+                                p_item->file_data.orig_wfilename);
+    ++p_progress->n_files_ok;
+  }
+}
+
+/* Reads the next batch of lines. Empty lines are skipped.
+ * @return In case of success: 0, the batch is empty at the end of input.
+ *         In case of failure: non zero value with error code.
+ */
+static
+int
+read_input_verify_batch(
+  FILE* input_fl, 
+  char* input_buf,
+  unsigned long* p_line_no,
+  st_input_verify_batch* p_batch,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  st_input_verify_item* p_item;
+  size_t line_sz;
+
+  p_batch->items_num = 0;
+  while (p_batch->items_num < INPUT_VERIFY_BATCH_SZ &&
+         fgets(input_buf, BUFF_SZ, input_fl) != NULL)
+  {
+    ++*p_line_no;
+
+    line_sz = strlen(input_buf);
+    if (line_sz == BUFF_SZ - 1 && input_buf[line_sz - 1] != '\n')
+    {
+      fprintf(stderr, "Line %lu is too long.\n", *p_line_no);
+      return ERRCODE_WRONG_INPUT_FORMAT;
+    }
+
+    while (line_sz > 0 && 
+           (input_buf[line_sz - 1] == '\n' || input_buf[line_sz - 1] == '\r'))
+    {
+      input_buf[--line_sz] = '\0';
+    }
+    if (line_sz == 0)
+    {
+      continue;
+    }
+
+    p_item = &p_batch->items[p_batch->items_num++];
+    p_item->line_no = *p_line_no;
+    p_item->res = fill_data_from_input(input_buf, &p_item->file_data, p_cs);
+    if (p_item->res != 0)
+    {
+      res = p_item->res;
+      if (res == ERRCODE_WRONG_INPUT_FORMAT)
+      {
+        fprintf(stderr, "Line %lu is skipped.\n", *p_line_no);
+      }
+
+      // the file is not checked then
+      free_input_verify_item(p_item);
+      p_item->line_no = *p_line_no;
+      p_item->res = res;
+    }
+  }
+
+  if (ferror(input_fl))
+  {
+    fprintf(stderr, "Cannot read hash values: %s\n", strerror(errno));
+    return ERRCODE_IO_ERROR;
+  }
+
+  return 0;
+}
+
+static
+int
+process_input_verify(
+  FILE* input_fl, 
+  st_input_verify_options* opts,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  int full_res = 0;
+  size_t i;
+  unsigned long line_no = 0;
+  char input_buf[BUFF_SZ];
+  st_input_verify_batch batch;
+  mhlosi_thread* threads;
+
+  memset((void*) &batch, 0, sizeof(batch) / sizeof(char));
+  batch.items = 
+    (st_input_verify_item*) calloc(INPUT_VERIFY_BATCH_SZ, 
+                                   sizeof(st_input_verify_item));
+  threads = (mhlosi_thread*) calloc(opts->jobs, sizeof(mhlosi_thread));
+  if (batch.items == NULL || threads == NULL)
+  {
+    free(batch.items);
+    free(threads);
+    fprintf(stderr, "Out of memory.\n");
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  res = mhlosi_mutex_init(&batch.mutex);
+  if (res != 0)
+  {
+    free(batch.items);
+    free(threads);
+    return res;
+  }
+
+  if (opts->logging_data.v_data.verbose_level >= VL_VERBOSE)
+  {
+    printf("Started checking of hash values from %s\n", 
+           opts->list_filename != NULL ? opts->list_filename : "stdin");
+  }
+
+  do
+  {
+    res = read_input_verify_batch(input_fl, input_buf, &line_no, &batch, p_cs);
+
+    check_input_verify_batch(&batch, threads, opts->jobs);
+    for (i = 0; i < batch.items_num; ++i)
+    {
+      print_input_verify_item(&batch.items[i], &opts->logging_data);
+      if (batch.items[i].res != 0)
+      {
+        full_res = batch.items[i].res;
+      }
+      free_input_verify_item(&batch.items[i]);
+    }
+    fflush(stdout);
+  } while (res == 0 && batch.items_num != 0);
+
+  if (res != 0)
+  {
+    full_res = res;
+  }
+
+  if (opts->logging_data.v_data.verbose_level >= VL_VERBOSE)
+  {
+    print_finish_message("Finished checking of hash values", 
+                         &opts->logging_data);
+  }
+
+  mhlosi_mutex_destroy(&batch.mutex);
+  free(batch.items);
+  free(threads);
+  return full_res;
+}
+
 int run_input_verify(int argc, const char* argv[],
   st_conversion_settings* p_cs)
 {
-  print_error("Hashes from input verification is not implemented yet.\n");
-  return ERRCODE_NOT_IMPLEMENTED;
-}
\ No newline at end of file
+  int res;
+  FILE* input_fl;
+  st_input_verify_options opts;
+
+  memset((void*) &opts, 0, sizeof(opts) / sizeof(char));
+  opts.logging_data.tool_name = "mhl hash";
+  opts.logging_data.v_data.machine_output = 1;
+
+  res = parse_input_verify_params(argc, argv, &opts);
+  if (res != 0)
+  {
+    mhlhash_usage();
+    return res;
+  }
+
+  if (opts.jobs == 0)
+  {
+    opts.jobs = mhlosi_cpu_count();
+  }
+
+  if (opts.list_filename != NULL)
+  {
+    input_fl = fopen(opts.list_filename, "r");
+    if (input_fl == NULL)
+    {
+      fprintf(stderr, "Cannot open file for reading: %s. Errno=%d. Error:%s\n",
+              opts.list_filename, errno, strerror(errno));
+      return ERRCODE_IO_ERROR;
+    }
+  }
+  else
+  {
+    input_fl = stdin;
+  }
+
+  res = process_input_verify(input_fl, &opts, p_cs);
+
+  if (input_fl != stdin)
+  {
+    fclose(input_fl);
+  }
+  return res;
+}
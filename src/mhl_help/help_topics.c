@@ -91,10 +91,40 @@ int print_mhlseal_help()
       "MHL_FOLDER(S), an error is thrown.\n"
       "   -#, --file-sequence\n"
       "      Looks for a file sequence as described in \"FILE SEQUENCE FORMAT\".\n"
+      "   -z, --gzip\n"
+      "      Writes the MHL file(s) gzip-compressed, with the '.mhl.gz' "
+      "extension. 'mhl verify' reads such files transparently.\n"
+      "   --slow-read MBPS\n"
+      "      Reports files of at least 16 MB, which are read slower than MBPS "
+      "megabytes per second. Files read 4 times slower than the files "
+      "before are reported also without this option.\n"
+      "   --slow-read-ms MS\n"
+      "      Reports files, a read of which took MS milliseconds or longer, "
+      "1000 by default. Slow files are reported as warnings, with '-y' "
+      "as 'meta' messages with SLOWREAD flags.\n"
+      "   --report FILE\n"
+      "      Writes the result of each file into FILE: path relative to "
+      "the folder of the MHL file, the folder as root, size, hash "
+      "type, expected and calculated hash, status and read time. The "
+      "report is written through a large buffer, separately from the "
+      "progress and machine readable output.\n"
+      "   --report-format jsonl|csv\n"
+      "      Format of the report: one JSON object per line (default) or "
+      "CSV with a header line.\n"
+      "   --log-limit MB\n"
+      "      With '-v' or '-vv' the printed messages are also written into "
+      "the '<log>' element of MHL files. Messages above MB megabytes "
+      "(64 by default) are kept in a temporary file instead of memory.\n"
+      "   --log-summary\n"
+      "      Leaves messages on single files out of the '<log>' element of "
+      "MHL files, they are still printed.\n"
       "   -v, --verbose\n"
       "      Prints status and result.\n"
       "   -vv, --very-verbose\n"
-      "      Same as -v, additionally prints progress.\n"
+      "      Same as -v, additionally prints progress once a second: processed "
+      "size, current and average throughput, estimated remaining time and, "
+      "with several jobs, the state of each job. On SIGUSR1 the progress is "
+      "printed to stderr, also without this option.\n"
 //      "   -y\n"
 //      "      Produce an output in a machine readable format. See help on output.\n\n"
       "\n"
@@ -106,14 +136,89 @@ int print_mhlseal_help()
       "   Part of the mhl suite\n\n");
 }
 
+int print_mhlcopy_help()
+{
+  return printf("NAME\n"
+      "   mhl-copy -- Copy folders or files and seal the copies\n\n"
+      "SYNOPSIS\n"
+      "   mhl copy [-vv] [-t HASH_TYPE]... [-z] [--verify] -d DESTINATION "
+      "[-d DESTINATION]... FOLDER|FILE...\n\n"
+      "DESCRIPTION\n"
+      "   'mhl copy' copies folders and files into one or several "
+      "DESTINATION folders and creates an MHL file in each DESTINATION "
+      "folder for the copied files. Each source file is read only once: "
+      "the same data is written to all destinations in parallel and is "
+      "used for calculation of hashes.\n"
+      "   Folders are copied recursively together with their names and "
+      "empty subfolders, files are copied into the DESTINATION folders "
+      "directly. The copies "
+      "keep modification dates of source files. Existing files are not "
+      "overwritten, they are reported as errors.\n\n"
+      "EXAMPLES\n"
+      "   Copy a camera card to two drives:\n"
+      "      $ mhl copy -v -d /Volumes/Backup1 -d /Volumes/Backup2 "
+      "/Volumes/A001\n"
+      "   Copy with xxHash64 and read the copies back afterwards:\n"
+      "      $ mhl copy -v -t xxhash64 --verify -d /path/to/backup "
+      "/path/to/folder\n"
+      "\n"
+      "ARGUMENTS\n"
+      "   FOLDER\n"
+      "      Folder to copy, recursively.\n"
+      "   FILE\n"
+      "      File to copy. Symbolic links are not followed. Sockets, FIFOs, "
+      "etc. are ignored.\n"
+      "   DESTINATION\n"
+      "      Folder to copy into. It is created if it doesn't exist. It can't "
+      "be located inside of a copied folder.\n\n"
+      "OPTIONS\n"
+      "   -d, --destination\n"
+      "      Copies into the given DESTINATION folder. At least one option "
+      "must be given, multiple options copy into multiple folders.\n"
+      "   -t, --types\n"
+      "      Type of hashes to write into MHL files: 'md5', 'sha1', "
+      "'xxhash', 'xxhash64' or 'xxhash64be'. Can be given several times, "
+      "'md5' is used by default.\n"
+      "   --verify\n"
+      "      Flushes the copies to the storage and reads them back after "
+      "copying, hashes of the copies are compared with hashes of the "
+      "source files. Destinations are verified in parallel.\n"
+      "   -z, --gzip\n"
+      "      Writes the MHL file(s) gzip-compressed, with the '.mhl.gz' "
+      "extension.\n"
+      "   --log-limit MB\n"
+      "      With '-v' or '-vv' the printed messages are also written into "
+      "the '<log>' element of MHL files. Messages above MB megabytes "
+      "(64 by default) are kept in a temporary file instead of memory.\n"
+      "   --log-summary\n"
+      "      Leaves messages on single files out of the '<log>' element of "
+      "MHL files, they are still printed.\n"
+      "   -v, --verbose\n"
+      "      Prints status and result.\n"
+      "   -vv, --very-verbose\n"
+      "      Same as -v, additionally prints progress once a second: processed "
+      "size, current and average throughput, estimated remaining time and, "
+      "with several jobs, the state of each job. On SIGUSR1 the progress is "
+      "printed to stderr, also without this option.\n"
+      "\n"
+      "DIAGNOSTICS\n"
+      "   The 'mhl copy' command exits 0 on success, and >0 if an error "
+      "occurs. Files copied before an error are sealed anyway.\n\n"
+      "SEE ALSO\n"
+      "   mhl-seal, mhl-verify\n\n"
+      "MHL\n"
+      "   Part of the mhl suite\n\n");
+}
+
 int print_mhlverify_help()
 {
   return printf("NAME\n"
       "   mhl-verify -- Verify folders and Media Hash List (MHL) files\n\n"
       "SYNOPSIS\n"
 //      "   1. mhl verify [-vv] [-an] FOLDER\n"
-      "   1. mhl verify [-vv] -f "/*[-anc] */"MHL_FILE\n"
-      "   2. mhl verify [-vv] -e -f "/*[-ac] */"MHL_FILE\n\n"
+      "   1. mhl verify [-vv] [--all-hashes] [-i | --index-dir DIR] [--cache FILE [--max-cache-age AGE] | --root DIR...] -f "/*[-anc] */"MHL_FILE\n"
+      "   2. mhl verify [-vv] [-i | --index-dir DIR] -e -f "/*[-ac] */"MHL_FILE\n"
+      "   3. mhl verify [-vv] [-e | --all-hashes] [-i | --index-dir DIR] [--cache FILE [--max-cache-age AGE]] --discover-all FOLDER\n\n"
       "DESCRIPTION\n"
 /*      "   In the first synopsis form 'mhl verify' ensures the completeness "
       "and the consistency of the given FOLDER. This is the preferred way to "
@@ -131,11 +236,18 @@ int print_mhlverify_help()
       "found MHL mfiles and therefore reseals the folder.\n"
 */
       "   In the first synopsis form 'mhl verify' verifies the hashes stored "
-      "in the MHL_FILE against the referenced files on disk.\n"/* A new MHL file is "
+      "in the MHL_FILE against the referenced files on disk. If several "
+      "hashes are stored for a file, only the fastest one to calculate is "
+      "verified, e.g. xxHash64 rather than MD5.\n"/* A new MHL file is "
       "created which references the MHL_FILE.\n" */
       "   In the second synopsis form 'mhl verify' only checks if the files "
       "referenced by MHL_FILE are existent on disk.\n" /* No new MHL file is "
       "created.\n\n"*/
+      "   In the third synopsis form 'mhl verify' searches for all MHL files "
+      "in the FOLDER and its subfolders and verifies each of them as in the "
+      "first form, or as in the second form if '-e' is given. It fails if no "
+      "MHL files are found, if any of them fails, or if any subfolder can't "
+      "be read.\n"
       "\n"
       "EXAMPLES\n"
  /*     "   Verify the completeness and consistency of a folder:\n"
@@ -147,6 +259,12 @@ int print_mhlverify_help()
       "   Verifies the contents of a MHL file:\n"
       "      $ mhl verify -f /path/to/file.mhl\n"
 /*      "      > Checking of MHL file content successful.\n" */
+      "   Verify all MHL files in a folder and its subfolders:\n"
+      "      $ mhl verify -v --discover-all /path/to/folder\n"
+      "   Verify a MHL file again, skipping files verified during the last week:\n"
+      "      $ mhl verify --cache ~/.mhl_verify_cache --max-cache-age 7d -f /path/to/file.mhl\n"
+      "   Verify three copies of a sealed folder against its MHL file:\n"
+      "      $ mhl verify -f /path/to/folder/file.mhl --root /Volumes/A/folder --root /Volumes/B/folder --root /Volumes/C/folder\n"
       "   Verify the existence of all files references by a MHL file.\n" /* and "
       "checks if there are unreferenced files in the folder containing the "
       "MHL file:\n"*/
@@ -159,7 +277,9 @@ int print_mhlverify_help()
 //      "      Folder to verify\n"
       "   MHL_FILE\n"
       "      A path to a MHL file. The MHL file must adhere to the MHL format "
-      "(see help topic 'mhl_format')\n\n"
+      "(see help topic 'mhl_format')\n"
+      "   FOLDER\n"
+      "      A path to a folder. Symbolic links in it are not followed.\n\n"
       "OPTIONS\n"
 /*      "   -c, --completeness\n"
       "      Checks if there are unreferenced files in the folder containing "
@@ -178,10 +298,66 @@ int print_mhlverify_help()
       "      Checks if the files referenced by MHL_FILE are existent on disk "
       "but does not compare hashes. Resealing is not possible if this option "
       "is passed.\n"
+      "   -i, --index\n"
+      "      Reads the content of MHL_FILE from its binary index "
+      "instead of parsing MHL_FILE. The index is created, or recreated if "
+      "MHL_FILE has been changed since, when MHL_FILE is parsed. Indexes are "
+      "kept in the folder 'mhl/index' of the user's cache folder "
+      "(~/Library/Caches on OS X, $XDG_CACHE_HOME or ~/.cache on Linux, "
+      "%%LOCALAPPDATA%% on Windows), so the media is not changed.\n"
+      "   --index-dir DIR\n"
+      "      Same as -i, but the index is kept in the existing folder DIR "
+      "instead of the user's cache folder.\n"
+      "   --discover-all FOLDER\n"
+      "      Verifies all MHL files found in FOLDER and its subfolders. "
+      "Subfolders are searched in parallel.\n"
+      "   --root DIR\n"
+      "      Verifies the copy DIR of the folder containing MHL_FILE instead "
+      "of the folder itself. May be given several times. MHL_FILE is parsed "
+      "once, copies on different devices are verified in parallel, copies "
+      "on the same device one by one. The result is printed for each copy, "
+      "'mhl verify' fails if any copy fails. Can't be used together with "
+      "'--cache' or with files.\n"
+      "   --all-hashes\n"
+      "      Verifies all hashes stored for a file instead of the fastest "
+      "one. The file is still read only once.\n"
+      "   --cache FILE\n"
+      "      Keeps results of successful hash checks in the cache FILE. A file "
+      "is not hashed again if it has been verified against the same hash "
+      "and neither its size nor its modification and status change times "
+      "have changed since. Files changed while they were hashed are not "
+      "cached. The cache FILE is created if it doesn't exist. Can't be used "
+      "together with '-e'.\n"
+      "   --max-cache-age AGE\n"
+      "      Hashes files again if they were verified AGE or longer ago. "
+      "AGE is a number of seconds, or a number followed by 's', 'm', 'h' "
+      "or 'd', e.g. '7d'. With '0' the cache is not used for checks, but "
+      "is still filled. By default results are used regardless of "
+      "their age.\n"
+      "   --slow-read MBPS\n"
+      "      Reports files of at least 16 MB, which are read slower than MBPS "
+      "megabytes per second. Files read 4 times slower than the files "
+      "before are reported also without this option.\n"
+      "   --slow-read-ms MS\n"
+      "      Reports files, a read of which took MS milliseconds or longer, "
+      "1000 by default. Slow files are reported as warnings, with '-y' "
+      "as 'meta' messages with SLOWREAD flags.\n"
+      "   --report FILE\n"
+      "      Writes the result of each file into FILE: path relative to "
+      "the folder of the MHL file, the folder as root, size, hash "
+      "type, expected and calculated hash, status and read time. The "
+      "report is written through a large buffer, separately from the "
+      "progress and machine readable output.\n"
+      "   --report-format jsonl|csv\n"
+      "      Format of the report: one JSON object per line (default) or "
+      "CSV with a header line.\n"
       "   -v, --verbose\n"
       "      Prints status and result.\n"
       "   -vv, --very-verbose\n"
-      "      Same as -v, additionally prints progress.\n"
+      "      Same as -v, additionally prints progress once a second: processed "
+      "size, current and average throughput, estimated remaining time and, "
+      "with several jobs, the state of each job. On SIGUSR1 the progress is "
+      "printed to stderr, also without this option.\n"
 //      "   -y\n"
 //      "      Produce an output in a machine readable format. See help on output.\n"
       "DIAGNOSTICS\n"
@@ -197,9 +373,9 @@ int print_mhlhash_help()
   return printf("NAME\n"
       "   mhl-hash -- Creates and verifies files against hash values.\n\n"
       "SYNOPSIS\n"
-      "   1. mhl hash [-vvm] [-#] [-t TYPES] FILEPATTERN\n"
+      "   1. mhl hash [-vvm] [-#] [-t TYPES] [--jobs N] FILEPATTERN\n"
       "   2. mhl hash [-vvm] -f FILE -h HASH\n"
-      "   3. mhl hash [-vvm] "/*[-a] */"-s\n\n"
+      "   3. mhl hash [-vvm] "/*[-a] */"-s [--jobs N] [LIST_FILE]\n\n"
       "DESCRIPTION\n"
       "   In the first synopsis form 'mhl hash' creates and prints hash "
       "values from the given files. If no explicit hash format is given, "
@@ -207,8 +383,10 @@ int print_mhlhash_help()
       "   In the second synopsis form 'mhl hash' compares the hash value "
       "of the FILE with the given HASH.\n"
       "   In the third synopsis form 'mhl hash' reads hash values "
-      "as described in help topic 'hash_syntax' from stdin and compares "
-      "them to the corresponding files.\n\n"
+      "as described in help topic 'hash_syntax' from stdin or from the "
+      "LIST_FILE and compares them to the corresponding files. The result "
+      "of each line is printed in machine readable form, in the order of "
+      "lines.\n\n"
       "EXAMPLES\n"
       "   Create MD5 hashes for all movie files in a folder:\n"
       "      $ mhl hash -s -t md5 /path/to/files/*.mov\n"
@@ -220,7 +398,11 @@ int print_mhlhash_help()
       "      > ...\n"
       "   Verify single movie file with a given hash value:\n"
       "      $ mhl hash -v -c /path/to/file.mov -h SHA1:a79302bfa825e1a57af2695177fe50c57984ec10\n"
-      "      > Summary: SUCCEEDED\n\n"
+      "      > Summary: SUCCEEDED\n"
+      "   Verify files against hash values from a list, 4 files at a time:\n"
+      "      $ mhl hash -s --jobs 4 /path/to/list.txt\n"
+      "      > mhl hash|output|compare|/path/to/file1.mov|OK\n"
+      "      > mhl hash|error|16|/path/to/file2.mov|Calculated hash of file ...\n\n"
       "ARGUMENTS\n"
       "   FILEPATTERN\n"
       "      Files to create MHL files for. Fileglobs (e.g. *.mov) can be "
@@ -238,12 +420,16 @@ int print_mhlhash_help()
       "   HASH\n"
       "      A hash string in either MD5, SHA1, xxHash, xxHash64 or xxHash64BE format.\n"
       "   TYPES\n"
-      "      A list of hash types. Possible types are \"md5\", \"sha1\", \"xxHash\", \"xxHash64\" and \"xxHash64BE\".\n\n"
+      "      A list of hash types. Possible types are \"md5\", \"sha1\", \"xxHash\", \"xxHash64\" and \"xxHash64BE\".\n"
+      "   LIST_FILE\n"
+      "      A file with hash values, one per line, as printed by 'mhl hash'. "
+      "If it is omitted or \"-\", hash values are read from stdin.\n\n"
       "OPTIONS\n"
       "   -s, --stdin\n"
       "      Causes 'mhl hash' to read hash values from stdin and compare \n"
       "them to the corresponding files. This is especially useful for \n"
-      "comparing the hash values of file sequences\n"
+      "comparing the hash values of file sequences. Lines which can't be "
+      "parsed are reported as errors with their line numbers.\n"
 /*      "   -a, --abort-on-error\n"
       "      By default, if 'mhl hash' is reading hashes via stdin (-s) it "
       "continues running if the verification of individual files fails. "
@@ -258,12 +444,20 @@ int print_mhlhash_help()
       "   -v, --verbose\n"
       "      Prints status and result.\n"
       "   -vv, --very-verbose\n"
-      "      Same as -v, additionally prints progress.\n"
+      "      Same as -v, additionally prints progress once a second: processed "
+      "size, current and average throughput, estimated remaining time and, "
+      "with several jobs, the state of each job. On SIGUSR1 the progress is "
+      "printed to stderr, also without this option.\n"
 //      "   -m, --machine-readable\n"
 //      "      Outputs machine readable log messages. A detailed description "
 //      "of output format can be found in help topic 'machine_output'.\n"
       "   -#, --file-sequence\n"
       "      Looks for a file sequence as described in \"FILE SEQUENCE FORMAT\".\n"
+      "   --jobs N\n"
+      "      Hashes up to N files at the same time. In the first synopsis form "
+      "the results are printed in the same order and format as without "
+      "the option. In the third synopsis form N defaults to the number "
+      "of processors.\n"
 //      "   -p, --print-all\n"
 //      "      Prints all output to stdout. By default, only output messages are "
 //      "logged to stdout, error and status messages are not.\n"
@@ -284,16 +478,21 @@ int print_mhlfile_help()
       "SYNOPSIS\n"
       "   1. mhl file [-vv] -s [-o MHL_FOLDER]\n"
       "   2. mhl file [-vv] -f FILE [-o MHL_FOLDER]\n"
- //     "   3. mhl file [-vv] -p MHL_FILE\n\n"
+      "   3. mhl file -p MHL_FILE [-0]\n\n"
       "DESCRIPTION\n"
       "   In the first synopsis form 'mhl file' takes input through stdin. "
       "The input syntax is described in help topic 'hash_syntax'\n"
       "   In the second synopsis form 'mhl file' reads input from the FILE. "
       "The file must contain hash values as described in the help topic "
-      "\"hash_syntax\", separated by newlines.\n\n"
-//      "   In the third synopsis form 'mhl file' reads the MHL_FILE and outputs the hash values "
-//      "of the corresponding files in the format described in help topic "
-//      "\"hash_syntax\", separated by newlines.\n"
+      "\"hash_syntax\", separated by newlines. Lines may be of any length. "
+      "If a line carries size and mtime of the file, the file is not "
+      "accessed, so MHL files can be created from hash values kept "
+      "elsewhere.\n"
+      "   In the third synopsis form 'mhl file' reads the MHL_FILE and outputs the hash values "
+      "of the corresponding files in the format described in help topic "
+      "\"hash_syntax\", separated by newlines. Paths of the files are absolute. "
+      "The MHL file is read item by item, so the output starts at once "
+      "and memory usage doesn't depend on the size of the MHL file.\n\n"
       "EXAMPLES\n"
       "   Create a MHL file for media files in a folder with use of "
       "'mhl hash':\n"
@@ -304,13 +503,16 @@ int print_mhlfile_help()
       "      $ openssl dgst -md5 /path/to/files/ -name \"*.mov\" | "
       "mhl file -s -v -o /path/to/folder\n"
       "      > MHL file path(s):\n"
-      "      > /path/to/folder/<folderName>_<date>_<time>.mhl\n\n"
+      "      > /path/to/folder/<folderName>_<date>_<time>.mhl\n"
+      "   Recreate a MHL file in another folder from the hash values of "
+      "an existing one:\n"
+      "      $ mhl file -p /path/to/folder/folder.mhl | mhl file -s -o /path/to\n\n"
       "ARGUMENTS\n"
       "   FILE\n"
       "      A path to a file. Symbolic links are not followed. Sockets, FIFOs, etc. are ignored.\n"
-//      "   MHL_FILE\n"
-//      "      A path to a MHL file. The MHL file must adhere to the MHL format "
-//      "(see help topic 'mhl_format')\n"
+      "   MHL_FILE\n"
+      "      A path to a MHL file. The MHL file must adhere to the MHL format "
+      "(see help topic 'mhl_format')\n"
       "   MHL_FOLDER\n"
       "      A path to a folder. 'mhl file' will store the MHL file in the "
       "given folder. This folder has to be above all files that will be given "
@@ -327,15 +529,23 @@ int print_mhlfile_help()
       "are located in the corresponding MHL_FOLDER or one of its subfolders. "
       "If relative paths are given which are located outside of all "
       "MHL_FOLDER(S), an error is thrown.\n"
+      "   -z, --gzip\n"
+      "      Writes the MHL file(s) gzip-compressed, with the '.mhl.gz' "
+      "extension.\n"
       "   -v, --verbose\n"
       "      Prints status and result\n"
       "   -vv, --very-verbose\n"
-      "      Same as -v, additionally prints progress\n\n"
+      "      Same as -v, additionally prints progress\n"
 //      "   -y\n"
 //      "      Produce an output in a machine readable format. See help on output.\n"
-//      "   -p, --parse\n"
-//      "      Parses the given MHL_FILE and outputs the hash values of the "
-//      "corresponding files in the syntax described in help topic 'hash_syntax'.\n\n"
+      "   -p, --parse\n"
+      "      Parses the given MHL_FILE and outputs the hash values of the "
+      "corresponding files in the syntax described in help topic 'hash_syntax'. "
+      "Files with several hash values get one line for each of them, in the "
+      "order of MHL_FILE.\n"
+      "   -0, --null\n"
+      "      Separates the output hash values with NUL characters instead of "
+      "newlines, for paths which contain newlines.\n\n"
       "DIAGNOSTICS\n"
       "   The 'mhl file' utility exits 0 on success, and >0 if an error occurs.\n\n"
       "SEE ALSO\n"
@@ -352,6 +562,13 @@ int print_hash_syntax_help()
     "For example:\n"
     "MD5(/Users/csr/Desktop/Test/a_01.tif)= 95711be5982521a645ddf51c87b511a8\n"
     "This holds true for both input via stdin, file input, as well as output.\n"
+    "Input may also carry size and last modification date of the file:\n"
+    "HASH_TYPE(PATH)=HASH_VALUE size=SIZE mtime=YYYY-MM-DDThh:mm:ssZ\n"
+    "For example:\n"
+    "MD5(/Users/csr/Desktop/Test/a_01.tif)= 95711be5982521a645ddf51c87b511a8 "
+    "size=1048576 mtime=2016-01-01T12:00:00Z\n"
+    "'mhl file' writes them to the MHL file as given, without accessing the "
+    "file, 'mhl hash -s' checks the size of the file.\n"
     "Hash input with this syntax is generated by both the 'mhl hash' or "
     "openssl command.\n\n");
 }
@@ -402,7 +619,9 @@ int print_mhl_files_help()
   "   - 'complete' if the MHL file was created with the first synopsis "
   "form of 'mhl seal'\n"
   "   - 'partial' if the MHL file was created with any other synopsis "
-  "form of 'mhl seal'\n\n"
+  "form of 'mhl seal'\n"
+  "If the '-z' option is given, the MHL file is gzip-compressed and gets "
+  "the '.mhl.gz' extension instead.\n\n"
   "MHL FILE LOCATION\n"
   "The MHL tool requires the MHL file to be placed along the path of the "
   "referenced file. This allows for an easy discovery when looking for an MHL "
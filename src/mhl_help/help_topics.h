@@ -26,6 +26,7 @@
 #define _MHL_TOOLS_MHL_HELP_HELP_TOPICS_H_
 
 int print_mhlseal_help();
+int print_mhlcopy_help();
 int print_mhlverify_help();
 int print_mhlhash_help();
 int print_mhlfile_help();
@@ -58,6 +58,10 @@ int run_mhl_help(int argc, const char* argv[])
   {
     res = print_mhlseal_help();
   }
+  else if (strcmp(argv[i], "copy") == 0)
+  {
+    res = print_mhlcopy_help();
+  }
   else if (strcmp(argv[i], "verify") == 0)
   {
     res = print_mhlverify_help();
@@ -30,6 +30,7 @@
 #include <generics/memory_management.h>
 #include <generics/char_conversions.h>
 #include <mhltools_common/logging.h>
+#include <mhltools_common/progress_reporter.h>
 #include <mhltools_common/usage_printing.h>
 
 #include <mhltools_common/controlling_data.h>
@@ -59,6 +60,11 @@ typedef struct _st_aux_calculate_and_print_hash_data
   st_seal_control_options* p_opts;
   st_mhlcreate_data* p_mhlcreate_data;
   st_conversion_settings* p_cs;
+
+  // absolute folders of MHL files, paths in the report are relative to
+  // the first one, which contains the file
+  wchar_t** report_root_wpaths;
+  unsigned int report_roots_num;
 } st_aux_calculate_and_fill_hash_data;
 
 static
@@ -83,89 +89,102 @@ void free_st_seal_control_options(st_seal_control_options* p_opt)
   }
 
   clean_log_str(&p_opt->common.logging_data.v_data);
+  close_file_report(&p_opt->common.logging_data);
 
   memset((void*) p_opt, 0, sizeof(*p_opt) / sizeof(char));  
   return;
 }
 
-static
-int
-prepare_data_for_mhl_create(const wchar_t* wfilename, const char* md5_hash_str,
-  const char* sha1_hash_str, const char* xx_hash_str, const char* xx64_hash_str, const char* xx64be_hash_str, st_mhlcreate_data* p_mhlcreate_data,
-  st_conversion_settings* p_cs)
+/* Makes absolute paths of the folders of MHL files for the report.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+static int
+aux_make_report_roots(st_aux_calculate_and_fill_hash_data* p_data)
 {
   int res;
-  st_files_data* p_files_data;
-  size_t idx;
+  unsigned int i;
+  st_mhl_dirs_data* p_mhl_paths = &p_data->p_mhlcreate_data->mhl_paths;
 
-  if (p_mhlcreate_data == NULL)
+  p_data->report_root_wpaths = 
+    (wchar_t**) calloc(p_mhl_paths->mhl_files_data_cnt, sizeof(wchar_t*));
+  if (p_data->report_root_wpaths == NULL)
   {
-    fprintf(
-      stderr, 
-      "prepare_data_for_mhl_create: internal error - some data has been lost\n");
-
-    return ERRCODE_INTERNAL_ERROR;
-  }
-
-  p_files_data = &p_mhlcreate_data->input_data;
-
-  if (p_files_data == NULL ||
-      p_files_data->files_data_array == NULL ||
-      p_files_data->files_data_capacity == 0)
-  {
-    fprintf(
-      stderr, 
-      "prepare_data_for_mhl_create: internal error - some data has been lost\n");
-
-    return ERRCODE_INTERNAL_ERROR;
+    return ERRCODE_OUT_OF_MEM;
   }
 
-  if ( p_files_data->files_data_cnt == p_files_data->files_data_capacity)
+  for (i = 0; i < p_mhl_paths->mhl_files_data_cnt; ++i)
   {
-    // increase allocated memory twice
-    res = increase_allocated_memory(
-      (void**)&p_files_data->files_data_array,
-        &p_files_data->files_data_capacity,
-        p_files_data->files_data_capacity * 2,
-        sizeof(st_file_data_ext));
-
+    res = 
+      convert_to_absolute_normalized_wpath(
+        p_mhl_paths->mhl_files_data[i].mhl_wdirname,
+        &p_data->report_root_wpaths[i],
+        p_data->p_cs);
     if (res != 0)
     {
-      fprintf(stderr, "Out of memory.\n");
       return res;
     }
+    ++p_data->report_roots_num;
   }
+  return 0;
+}
 
-  idx = p_files_data->files_data_cnt;
-
-  res = fill_data_directly(wfilename, md5_hash_str, sha1_hash_str, xx_hash_str, xx64_hash_str, xx64be_hash_str,
-    p_files_data->files_data_array + idx);
+static void
+aux_free_report_roots(st_aux_calculate_and_fill_hash_data* p_data)
+{
+  unsigned int i;
 
-  ++p_files_data->files_data_cnt;
-  if (res != 0)
+  for (i = 0; i < p_data->report_roots_num; ++i)
   {
-    return res;
+    free(p_data->report_root_wpaths[i]);
   }
+  free(p_data->report_root_wpaths);
+  p_data->report_root_wpaths = NULL;
+  p_data->report_roots_num = 0;
+}
 
-  res = process_file(
-    p_files_data->files_data_array + idx, 
-    &(p_mhlcreate_data->workdir_wpath),
-    p_cs);
+/* Adds result of hashing of the file to the report.
+ */
+static void
+aux_report_hash(const wchar_t* wfilename, MHL_HASH_TYPE hash_type, 
+                const char* hash_str, unsigned long long file_sz, int res,
+                st_aux_calculate_and_fill_hash_data* p_data)
+{
+  st_logging_data* logging_data = &p_data->p_opts->common.logging_data;
+  st_report_record record;
+  wchar_t* abs_wpath = NULL;
+  unsigned int i;
 
-  if (res != 0)
+  if (logging_data->p_report == NULL)
   {
-    return res;
+    return;
   }
 
-  res = add_data_to_containing_folders(&(p_mhlcreate_data->mhl_paths),
-    p_files_data->files_data_array + idx, idx);
-
-  if (res != 0)
+  memset((void*) &record, 0, sizeof(record) / sizeof(char));
+  record.abs_wpath = wfilename;
+  if (convert_to_absolute_normalized_wpath(wfilename, &abs_wpath, 
+                                           p_data->p_cs) == 0)
   {
-    return res;
+    record.abs_wpath = abs_wpath;
+    for (i = 0; i < p_data->report_roots_num; ++i)
+    {
+      if (get_report_rel_wpath(p_data->report_root_wpaths[i], 
+                               abs_wpath) != NULL)
+      {
+        record.root_wpath = p_data->report_root_wpaths[i];
+        break;
+      }
+    }
   }
-
-  return 0;
+  record.file_sz = file_sz;
+  record.hash_type = hash_type;
+  if (res == 0 && hash_str != NULL)
+  {
+    strncpy(record.u8str_actual_hash, hash_str, REPORT_HASH_STR_SZ - 1);
+    record.read_us = logging_data->read_monitor.file_read_us;
+  }
+  report_file_result(logging_data, &record, res, 0);
+  free(abs_wpath);
 }
 
 static int
@@ -215,12 +234,13 @@ calculate_and_fill_hash(const wchar_t* wfilename, void* data)
   {
     if (filename == NULL)
     {
-      logit(p_data->p_mhlcreate_data->p_v_data,
+      logit_item(p_data->p_mhlcreate_data->p_v_data,
         "Processing file with unconvertible to locale encoding file name\n");
     }
     else
     {
-      logit(p_data->p_mhlcreate_data->p_v_data, "Processing '%s'\n", filename);
+      logit_item(p_data->p_mhlcreate_data->p_v_data, "Processing '%s'\n", 
+                 filename);
     }
   }
 
@@ -229,6 +249,8 @@ calculate_and_fill_hash(const wchar_t* wfilename, void* data)
     res =
       wcalculate_md5_hash_string(wfilename, &md5_hash_str, &hash_str_sz,
                                  &total_bytes, &p_data->p_opts->common.logging_data);
+    aux_report_hash(wfilename, MHL_HT_MD5, md5_hash_str, total_bytes, res,
+                    p_data);
 
     if (res != 0)
     {
@@ -257,6 +279,8 @@ calculate_and_fill_hash(const wchar_t* wfilename, void* data)
     res = 
       wcalculate_sha1_hash_string(wfilename, &sha1_hash_str, &hash_str_sz,
                                   &total_bytes, &p_data->p_opts->common.logging_data);
+    aux_report_hash(wfilename, MHL_HT_SHA1, sha1_hash_str, total_bytes, res,
+                    p_data);
 
     if (res != 0)
     {
@@ -284,6 +308,8 @@ calculate_and_fill_hash(const wchar_t* wfilename, void* data)
       res =
         wcalculate_xx_hash_string(wfilename, &xx_hash_str, &hash_str_sz,
                                   &total_bytes, &p_data->p_opts->common.logging_data);
+      aux_report_hash(wfilename, MHL_HT_XXHASH, xx_hash_str, total_bytes, res,
+                      p_data);
       
       if (res != 0)
       {
@@ -311,6 +337,8 @@ calculate_and_fill_hash(const wchar_t* wfilename, void* data)
       res =
         wcalculate_xx64_hash_string(wfilename, &xx64_hash_str, &hash_str_sz,
                                     &total_bytes, &p_data->p_opts->common.logging_data);
+      aux_report_hash(wfilename, MHL_HT_XXHASH64, xx64_hash_str, total_bytes, res,
+                      p_data);
 
       if (res != 0)
       {
@@ -338,6 +366,8 @@ calculate_and_fill_hash(const wchar_t* wfilename, void* data)
     res =
       wcalculate_xx64be_hash_string(wfilename, &xx64be_hash_str, &hash_str_sz,
                                     &total_bytes, &p_data->p_opts->common.logging_data);
+    aux_report_hash(wfilename, MHL_HT_XXHASH64BE, xx64be_hash_str, total_bytes, res,
+                    p_data);
 
     if (res != 0)
     {
@@ -361,23 +391,33 @@ calculate_and_fill_hash(const wchar_t* wfilename, void* data)
 
   }
 
-  res = prepare_data_for_mhl_create(wfilename, md5_hash_str, sha1_hash_str, xx_hash_str, xx64_hash_str, xx64be_hash_str,
-    p_data->p_mhlcreate_data, p_data->p_cs);
+  res = add_file_to_mhlcreate_data(p_data->p_mhlcreate_data, wfilename, 
+    md5_hash_str, sha1_hash_str, xx_hash_str, xx64_hash_str, xx64be_hash_str,
+    p_data->p_cs);
 
   free(md5_hash_str);
   free(sha1_hash_str);
   free(xx_hash_str);
   free(xx64_hash_str);
 
+  if (res == ERRCODE_WRONG_FILE_LOCATION)
+  {
+    fprintf(stderr, "The folders of MHL files are specified with '-o' or "
+            "'--output-folder' option.\n");
+  }
+
   if (res != 0)
   {
     free(filename);
     return res;
   }
 
+  print_output_slow_read(stderr, wfilename, 
+                         &p_data->p_opts->common.logging_data);
+
   if (p_data->p_mhlcreate_data->p_v_data->verbose_level)
   {
-    logit(p_data->p_mhlcreate_data->p_v_data, "Done '%s'\n",
+    logit_item(p_data->p_mhlcreate_data->p_v_data, "Done '%s'\n",
       filename == NULL ? "unconvertible to locale encoding file name" : filename);
   }
 
@@ -456,12 +496,28 @@ process_calculate_and_fill_hash(
   cph_data.p_cs = p_cs;
   cph_data.p_opts = opts;
   cph_data.p_mhlcreate_data = p_mhlcreate_data;
+  cph_data.report_root_wpaths = NULL;
+  cph_data.report_roots_num = 0;
+  if (opts->common.logging_data.p_report != NULL)
+  {
+    res = aux_make_report_roots(&cph_data);
+    if (res != 0)
+    {
+      fprintf(stderr, "Cannot make paths of MHL folders for the report: "
+              "%s\n", mhl_error_code_description(res));
+      aux_free_report_roots(&cph_data);
+      return res;
+    }
+  }
   
+  start_progress_reporter(&opts->common.logging_data);
   res = run_func_on_args(argc, argv,
     &opts->common,
     p_cs,
     (void*) &cph_data, // pass callback data
     calculate_and_fill_hash); // pass callback function
+  stop_progress_reporter(&opts->common.logging_data);
+  aux_free_report_roots(&cph_data);
 
   // Print finish message
   if (opts->common.logging_data.v_data.verbose_level >= VL_VERBOSE)
@@ -491,6 +547,7 @@ int parse_seal_params(int argc, const char* argv[],
       "Incorrect number of arguments.\n");
     return ERRCODE_WRONG_ARGUMENTS;
   }
+  opts->common.logging_data.tool_name = "mhl seal";
 
   // traverse through arguments
   i = 1;
@@ -531,6 +588,77 @@ int parse_seal_params(int argc, const char* argv[],
       opts->common.use_sequences = 1;
       break;
 
+    case OPT_LOG_LIMIT:
+      if (i + 1 >= argc || 
+          parse_log_limit(argv[i + 1], 
+                          &opts->common.logging_data.v_data.log_mem_limit) != 0)
+      {
+        print_error(
+          "Arguments error: "
+          "A positive size in MB must follow the '--log-limit' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      ++i;
+      break;
+
+    case OPT_LOG_SUMMARY:
+      opts->common.logging_data.v_data.log_summary = 1;
+      break;
+
+    case OPT_SLOW_READ:
+      if (i + 1 >= argc || 
+          parse_slow_read_speed(argv[i + 1], 
+                                &opts->common.logging_data.read_monitor) != 0)
+      {
+        print_error(
+          "Arguments error: "
+          "A positive speed in MB/s must follow the '--slow-read' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      ++i;
+      break;
+
+    case OPT_SLOW_READ_MS:
+      if (i + 1 >= argc || 
+          parse_slow_read_ms(argv[i + 1], 
+                             &opts->common.logging_data.read_monitor) != 0)
+      {
+        print_error(
+          "Arguments error: "
+          "A positive number of milliseconds must follow the "
+          "'--slow-read-ms' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      ++i;
+      break;
+
+    case OPT_REPORT:
+      if (i + 1 >= argc || opts->common.report_path != NULL)
+      {
+        print_error(
+          "Arguments error: "
+          "There must be one file name after the '--report' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      opts->common.report_path = argv[++i];
+      break;
+
+    case OPT_REPORT_FORMAT:
+      if (i + 1 >= argc || 
+          parse_report_format(argv[i + 1], &opts->common.report_format) != 0)
+      {
+        print_error(
+          "Arguments error: "
+          "'jsonl' or 'csv' must follow the '--report-format' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      ++i;
+      break;
+
+    case OPT_Z:
+      data->mhl_paths.gzip_output = 1;
+      break;
+
     case OPT_T:
       if ( i + 1 >= argc)
       {
@@ -651,6 +779,7 @@ int parse_seal_params(int argc, const char* argv[],
 int run_mhl_seal(int argc, const char* argv[])
 {
   int res;
+  int report_res;
   st_seal_control_options seal_opts;
   st_mhlcreate_data mhlcreate_data;
   st_conversion_settings css;
@@ -713,6 +842,33 @@ int run_mhl_seal(int argc, const char* argv[])
     return res;
   }
 
+  if (seal_opts.common.report_path != NULL)
+  {
+    res = open_file_report(&seal_opts.common.logging_data, 
+                           seal_opts.common.report_path,
+                           seal_opts.common.report_format);
+    if (res != 0)
+    {
+      free_st_seal_control_options(&seal_opts);
+      free_st_conversion_settings(&css);
+      finalize_mhlcreate_data(&mhlcreate_data);
+      return res;
+    }
+  }
+
+  if (mhlcreate_data.p_v_data->verbose_level)
+  {
+    res = open_log_str(mhlcreate_data.p_v_data);
+    if (res != 0)
+    {
+      close_file_report(&seal_opts.common.logging_data);
+      free_st_seal_control_options(&seal_opts);
+      free_st_conversion_settings(&css);
+      finalize_mhlcreate_data(&mhlcreate_data);
+      return res;
+    }
+  }
+
   // This call shall be done after parameters parsing and before
   // any further work with mhlcreate_data
   res = preprocess_mhlcreate_data(&mhlcreate_data, &start_gmtm, &css);
@@ -770,6 +926,11 @@ int run_mhl_seal(int argc, const char* argv[])
   }
 
   res = create_mhl_files(&mhlcreate_data, &css);
+  report_res = close_file_report(&seal_opts.common.logging_data);
+  if (res == 0)
+  {
+    res = report_res;
+  }
   finalize_mhlcreate_data(&mhlcreate_data);
   free_st_conversion_settings(&css);
   free_st_seal_control_options(&seal_opts);
@@ -41,304 +41,196 @@
 #include <mhl_verify/verify_options.h>
 
 #include "check_file.h"
+#include "verify_cache.h"
 
 //---------------------------------------------------------
 //
 // Set of functions for checking against MHL file content
 //
 //---------------------------------------------------------
+/* @return Relative cost of calculation of hash of given type,
+ *         the fastest hash has the lowest cost
+ */
 static int
-aux_check_md5_hash(st_mhl_file_check_wdata* p_check_wdata,
-                   st_controlling_data* p_common)
+aux_hash_cost(MHL_HASH_TYPE hash_type)
 {
-  int res;
-  unsigned char* hash_data;
-  unsigned long long total_bytes_read;
-  char* hash_str;
-  size_t hash_str_sz;
-  size_t mhl_hash_sz;
-
-  //
-  if (p_check_wdata->u8str_hash_sum == NULL)
-  {
-    return ERRCODE_WRONG_MHL_FORMAT;
-  }
-
-  //
-  res = 
-    wcalculate_md5_hash(
-      p_check_wdata->abs_item_wfilename, 
-      &hash_data,
-      &total_bytes_read,
-      &p_common->logging_data);
-  
-  if (res != 0)
+  switch (hash_type)
   {
-    return res;
-  }
-  
-  res = 
-    md5_hash_data_to_string(
-      hash_data, 
-      &hash_str,
-      &hash_str_sz);
-
-  free(hash_data);
-  
-  if (res != 0)
-  {
-    return res;
-  }
-      
-  mhl_hash_sz = strlen(p_check_wdata->u8str_hash_sum);
-  if (mhl_hash_sz != hash_str_sz)
-  {
-    free(hash_str);    
-    return ERRCODE_MHL_CHECK_HASH_FAILED;
+    case MHL_HT_XXHASH64:
+    case MHL_HT_XXHASH64BE:
+      return 1;
+    case MHL_HT_XXHASH:
+      return 2;
+    case MHL_HT_MD5:
+      return 3;
+    case MHL_HT_SHA1:
+      return 4;
+    default:
+      return 5;
   }
-  
-  res = 
-    mhlosi_strcasecmp(p_check_wdata->u8str_hash_sum, hash_str) == 0 ? 
-    0 : ERRCODE_MHL_CHECK_HASH_FAILED;
-  
-  free(hash_str);
-  
-  return res;
 }
 
-//
-static int
-aux_check_sha1_hash(st_mhl_file_check_wdata* p_check_wdata,
-                    st_controlling_data* p_common)
+/* Gets digest of item by number, the primary digest has number 0, 
+ * other digests follow it.
+ */
+static void
+aux_get_item_hash(
+  const st_mhl_file_check_wdata* p_check_wdata,
+  unsigned int hash_no,
+  MHL_HASH_TYPE* p_hash_type,
+  const char** p_u8str_hash_sum)
 {
-  int res;
-  unsigned char* hash_data;
-  unsigned long long total_bytes_read;
-  char* hash_str;
-  size_t hash_str_sz;
-  size_t mhl_hash_sz;
-  
-  //
-  if (p_check_wdata->u8str_hash_sum == NULL)
+  if (hash_no == 0)
   {
-    return ERRCODE_WRONG_MHL_FORMAT;
+    *p_hash_type = p_check_wdata->hash_type;
+    *p_u8str_hash_sum = p_check_wdata->u8str_hash_sum;
   }
-  
-  //
-  res = 
-    wcalculate_sha1_hash(
-      p_check_wdata->abs_item_wfilename, 
-      &hash_data,
-      &total_bytes_read,
-      &p_common->logging_data);
-  
-  if (res != 0)
+  else
   {
-    return res;
+    *p_hash_type = p_check_wdata->other_hashes[hash_no - 1].hash_type;
+    *p_u8str_hash_sum = 
+      p_check_wdata->other_hashes[hash_no - 1].u8str_hash_sum;
   }
-  
-  res = 
-    sha1_hash_data_to_string(
-      hash_data, 
-      &hash_str,
-      &hash_str_sz);
-  
-  free(hash_data);
-  
-  if (res != 0)
-  {
-    return res;
-  }
-  
-  mhl_hash_sz = strlen(p_check_wdata->u8str_hash_sum);
-  if (mhl_hash_sz != hash_str_sz)
-  {
-    free(hash_str);    
-    return ERRCODE_MHL_CHECK_HASH_FAILED;
-  }
-  
-  res = 
-    mhlosi_strcasecmp(p_check_wdata->u8str_hash_sum, hash_str) == 0 ? 
-    0 : ERRCODE_MHL_CHECK_HASH_FAILED;
-  
-  free(hash_str);
-  
-  return res;
 }
 
-
-//
+/* Selects digest of item, which is the fastest to check.
+ * @return In case of success: 0,
+ *         ERRCODE_WRONG_MHL_FORMAT if item has no digests to check
+ */
 static int
-aux_check_xx_hash(st_mhl_file_check_wdata* p_check_wdata,
-                    st_controlling_data* p_common)
+aux_select_fastest_hash(
+  const st_mhl_file_check_wdata* p_check_wdata,
+  MHL_HASH_TYPE* p_hash_type,
+  const char** p_u8str_hash_sum)
 {
-    int res;
-    uint32_t hash_data;
-    unsigned long long total_bytes_read;
-    char* hash_str;
-    size_t hash_str_sz;
-    size_t mhl_hash_sz;
-    
-    //
-    if (p_check_wdata->u8str_hash_sum == NULL)
-    {
-        return ERRCODE_WRONG_MHL_FORMAT;
-    }
-    
-    //
-    res =
-    wcalculate_xx_hash(
-                         p_check_wdata->abs_item_wfilename,
-                         &hash_data,
-                         &total_bytes_read,
-                         &p_common->logging_data);
-    
-    if (res != 0)
-    {
-        return res;
-    }
-    
-    res =
-    xx_hash_data_to_string(
-                             hash_data,
-                             &hash_str,
-                             &hash_str_sz);
-    
-    if (res != 0)
-    {
-        return res;
-    }
-    
-    mhl_hash_sz = strlen(p_check_wdata->u8str_hash_sum);
-    if (mhl_hash_sz != hash_str_sz)
+  unsigned int i;
+  MHL_HASH_TYPE hash_type;
+  const char* u8str_hash_sum;
+
+  *p_hash_type = MHL_HT_UNRECOGNIZED;
+  *p_u8str_hash_sum = NULL;
+  for (i = 0; i <= p_check_wdata->other_hashes_num; ++i)
+  {
+    aux_get_item_hash(p_check_wdata, i, &hash_type, &u8str_hash_sum);
+    if (u8str_hash_sum != NULL && 
+        (*p_u8str_hash_sum == NULL || 
+         aux_hash_cost(hash_type) < aux_hash_cost(*p_hash_type)))
     {
-        free(hash_str);
-        return ERRCODE_MHL_CHECK_HASH_FAILED;
+      *p_hash_type = hash_type;
+      *p_u8str_hash_sum = u8str_hash_sum;
     }
-    
-    res = 
-    mhlosi_strcasecmp(p_check_wdata->u8str_hash_sum, hash_str) == 0 ? 
-    0 : ERRCODE_MHL_CHECK_HASH_FAILED;
-    
-    free(hash_str);
-    
-    return res;
+  }
+
+  return *p_u8str_hash_sum != NULL ? 0 : ERRCODE_WRONG_MHL_FORMAT;
 }
 
-//
+/* Calculates hashes of file in one read and compares them with digests
+ * of item. Only the fastest hash is calculated, unless check_all_hashes 
+ * is set.
+ */
 static int
-aux_check_xx64_hash(st_mhl_file_check_wdata* p_check_wdata,
-                  st_controlling_data* p_common)
+aux_check_hashes(
+  st_mhl_file_check_wdata* p_check_wdata,
+  unsigned char check_all_hashes,
+  st_report_record* p_record,
+  st_controlling_data* p_common)
 {
-    int res;
-    uint64_t hash_data;
-    unsigned long long total_bytes_read;
-    char* hash_str;
-    size_t hash_str_sz;
-    size_t mhl_hash_sz;
-
-    //
-    if (p_check_wdata->u8str_hash_sum == NULL)
-    {
-        return ERRCODE_WRONG_MHL_FORMAT;
-    }
-
-    //
-    res =
-    wcalculate_xx64_hash(
-                       p_check_wdata->abs_item_wfilename,
-                       &hash_data,
-                       &total_bytes_read,
-                       &p_common->logging_data);
+  int res;
+  unsigned int i;
+  size_t j;
+  MHL_HASH_TYPE hash_types[MHL_HT_NULL];
+  char* hash_strs[MHL_HT_NULL];
+  size_t hash_types_num;
+  MHL_HASH_TYPE hash_type;
+  const char* u8str_hash_sum;
+  unsigned long long total_bytes_read;
 
+  hash_types_num = 0;
+  if (check_all_hashes == 0)
+  {
+    res = aux_select_fastest_hash(p_check_wdata, &hash_type, &u8str_hash_sum);
     if (res != 0)
     {
-        return res;
+      return res;
     }
-
-    res =
-    xx64_hash_data_to_string(
-                           hash_data,
-                           &hash_str,
-                           &hash_str_sz);
-
-    if (res != 0)
+    hash_types[hash_types_num++] = hash_type;
+  }
+  else
+  {
+    for (i = 0; i <= p_check_wdata->other_hashes_num; ++i)
     {
-        return res;
+      aux_get_item_hash(p_check_wdata, i, &hash_type, &u8str_hash_sum);
+      if (u8str_hash_sum == NULL)
+      {
+        continue;
+      }
+      for (j = 0; j < hash_types_num && hash_types[j] != hash_type; ++j)
+        ;
+      if (j == hash_types_num && hash_types_num < MHL_HT_NULL)
+      {
+        hash_types[hash_types_num++] = hash_type;
+      }
     }
 
-    mhl_hash_sz = strlen(p_check_wdata->u8str_hash_sum);
-    if (mhl_hash_sz != hash_str_sz)
+    if (hash_types_num == 0)
     {
-        free(hash_str);
-        return ERRCODE_MHL_CHECK_HASH_FAILED;
+      return ERRCODE_WRONG_MHL_FORMAT;
     }
+  }
 
-    res =
-    mhlosi_strcasecmp(p_check_wdata->u8str_hash_sum, hash_str) == 0 ?
-    0 : ERRCODE_MHL_CHECK_HASH_FAILED;
-
-    free(hash_str);
-
+  res = 
+    wcalculate_hash_strings(
+      p_check_wdata->abs_item_wfilename,
+      hash_types,
+      hash_strs,
+      hash_types_num,
+      &total_bytes_read,
+      &p_common->logging_data);
+  if (p_record != 0)
+  {
+    p_record->read_us = 
+      p_common->logging_data.read_monitor.file_read_us;
+  }
+  if (res != 0)
+  {
     return res;
-}
-
-//
-static int
-aux_check_xx64be_hash(st_mhl_file_check_wdata* p_check_wdata,
-                    st_controlling_data* p_common)
-{
-    int res;
-    uint64_t hash_data;
-    unsigned long long total_bytes_read;
-    char* hash_str;
-    size_t hash_str_sz;
-    size_t mhl_hash_sz;
-
-    //
-    if (p_check_wdata->u8str_hash_sum == NULL)
-    {
-        return ERRCODE_WRONG_MHL_FORMAT;
-    }
-
-    //
-    res =
-    wcalculate_xx64be_hash(
-                         p_check_wdata->abs_item_wfilename,
-                         &hash_data,
-                         &total_bytes_read,
-                         &p_common->logging_data);
+  }
 
-    if (res != 0)
+  // all digests of calculated types must match
+  for (i = 0; i <= p_check_wdata->other_hashes_num && res == 0; ++i)
+  {
+    aux_get_item_hash(p_check_wdata, i, &hash_type, &u8str_hash_sum);
+    for (j = 0; j < hash_types_num && hash_types[j] != hash_type; ++j)
+      ;
+    if (u8str_hash_sum == NULL || j == hash_types_num)
     {
-        return res;
+      continue;
     }
 
-    res =
-    xx64be_hash_data_to_string(
-                             hash_data,
-                             &hash_str,
-                             &hash_str_sz);
-
-    if (res != 0)
+    if (strlen(u8str_hash_sum) != strlen(hash_strs[j]) ||
+        mhlosi_strcasecmp(u8str_hash_sum, hash_strs[j]) != 0)
     {
-        return res;
+      res = ERRCODE_MHL_CHECK_HASH_FAILED;
     }
 
-    mhl_hash_sz = strlen(p_check_wdata->u8str_hash_sum);
-    if (mhl_hash_sz != hash_str_sz)
+    // the first checked digest is reported, or the mismatching one
+    if (p_record != 0 && 
+        (res != 0 || p_record->u8str_actual_hash[0] == '\0'))
     {
-        free(hash_str);
-        return ERRCODE_MHL_CHECK_HASH_FAILED;
+      p_record->hash_type = hash_type;
+      p_record->u8str_expected_hash = u8str_hash_sum;
+      strncpy(p_record->u8str_actual_hash, hash_strs[j], 
+              REPORT_HASH_STR_SZ - 1);
+      p_record->u8str_actual_hash[REPORT_HASH_STR_SZ - 1] = '\0';
     }
+  }
 
-    res =
-    mhlosi_strcasecmp(p_check_wdata->u8str_hash_sum, hash_str) == 0 ?
-    0 : ERRCODE_MHL_CHECK_HASH_FAILED;
-
-    free(hash_str);
+  for (j = 0; j < hash_types_num; ++j)
+  {
+    free(hash_strs[j]);
+  }
 
-    return res;
+  return res;
 }
 
 //
@@ -348,25 +240,65 @@ aux_check_xx64be_hash(st_mhl_file_check_wdata* p_check_wdata,
 int check_file_against_mhl_file_witem(
   st_mhl_file_check_wdata* p_check_wdata, 
   unsigned char check_existence,
+  unsigned char check_all_hashes,
+  const st_verify_cache_file_id* p_file_id,
+  st_verify_cache* p_cache,
+  unsigned char* p_from_cache,
+  st_report_record* p_record,
   st_controlling_data* p_common)
 {
   int res;
-  unsigned long long ull_fsz;
+  st_mhlosi_stat wfl_stat;
+  st_verify_cache_file_id file_id;
+  MHL_HASH_TYPE cache_hash_type = MHL_HT_UNRECOGNIZED;
+  const char* cache_u8str_hash_sum = NULL;
   
   if (p_check_wdata == 0)
   {
     return ERRCODE_WRONG_ARGUMENTS;
   }
+
+  if (p_from_cache != 0)
+  {
+    *p_from_cache = 0;
+  }
+
+  if (check_existence != 0 || p_check_wdata->hash_type == MHL_HT_NULL ||
+      aux_select_fastest_hash(p_check_wdata, &cache_hash_type, 
+                              &cache_u8str_hash_sum) != 0)
+  {
+    // nothing to cache
+    p_cache = 0;
+  }
   
-  // Check file sizes
-  ull_fsz = 0;
-  res = get_wfile_size(p_check_wdata->abs_item_wfilename, &ull_fsz);
-  if (res != 0)
+  // identity is taken before the file is read
+  if (p_file_id != 0)
   {
-    return res;
+    file_id = *p_file_id;
+  }
+  else
+  {
+    res = get_wfile_stat_data(p_check_wdata->abs_item_wfilename, &wfl_stat);
+    if (res != 0)
+    {
+      return res;
+    }
+    make_verify_cache_file_id(p_check_wdata->abs_item_wfilename, &wfl_stat, 
+                              &file_id);
   }
   
-  if (ull_fsz != p_check_wdata->file_sz)
+  if (p_record != 0)
+  {
+    p_record->file_sz = file_id.file_sz;
+    if (cache_u8str_hash_sum != NULL && check_existence == 0)
+    {
+      p_record->hash_type = cache_hash_type;
+      p_record->u8str_expected_hash = cache_u8str_hash_sum;
+    }
+  }
+
+  // Check file sizes
+  if (file_id.file_sz != p_check_wdata->file_sz)
   {
     return ERRCODE_MHL_CHECK_FILE_SIZE_FAILED;
   }
@@ -376,38 +308,40 @@ int check_file_against_mhl_file_witem(
     // Checks only file existence and filesize equality.
     return 0;
   }
+
+  // results are kept for the fastest hash, so they can't replace 
+  // check of all hashes
+  if (p_cache != 0 && check_all_hashes == 0 &&
+      is_verified_in_cache(p_cache, &file_id, cache_hash_type, 
+                           cache_u8str_hash_sum))
+  {
+    if (p_from_cache != 0)
+    {
+      *p_from_cache = 1;
+    }
+    return 0;
+  }
   
   // Check file's hashusm
-  switch (p_check_wdata->hash_type) 
+  res = 
+    p_check_wdata->hash_type != MHL_HT_NULL ?
+      aux_check_hashes(p_check_wdata, check_all_hashes, p_record, 
+                       p_common) : 0;
+  
+  if (p_cache != 0)
   {
-    case MHL_HT_MD5:
-      res = aux_check_md5_hash(p_check_wdata, p_common);      
-      break;
-
-    case MHL_HT_SHA1:
-      res = aux_check_sha1_hash(p_check_wdata, p_common); 
-      break;
-
-    case MHL_HT_XXHASH:
-      res = aux_check_xx_hash(p_check_wdata, p_common);
-      break;
-
-    case MHL_HT_XXHASH64:
-      res = aux_check_xx64_hash(p_check_wdata, p_common);
-      break;
-
-    case MHL_HT_XXHASH64BE:
-      res = aux_check_xx64be_hash(p_check_wdata, p_common);
-      break;
-    case MHL_HT_NULL:
-      res = 0;
-      break;
-
-    default:
-      res = ERRCODE_NOT_IMPLEMENTED;
-      break;
+    if (res == 0)
+    {
+      // failure to remember the file doesn't fail the check
+      put_verified_to_cache(p_cache, &file_id, cache_hash_type, 
+                            cache_u8str_hash_sum);
+    }
+    else if (res == ERRCODE_MHL_CHECK_HASH_FAILED)
+    {
+      remove_from_verify_cache(p_cache, &file_id);
+    }
   }
-  
+
   // TODO: May be some code result processing should be added here. 
   //       Think about it 
   return res;
@@ -420,6 +354,10 @@ int check_file_against_mhl_wcontent(
       const wchar_t* abs_wfilename, 
       st_mhl_file_wcontent* p_wcontent, 
       unsigned char check_existence,
+      unsigned char check_all_hashes,
+      st_verify_cache* p_cache,
+      unsigned char* p_from_cache,
+      st_report_record* p_record,
       st_controlling_data* p_common)
 {
   int res;
@@ -433,12 +371,15 @@ int check_file_against_mhl_wcontent(
   }
   
   p_switem = 
-    search_for_mhl_file_check_wdata(p_wcontent->check_witems, abs_wfilename);
+    search_for_mhl_file_check_wdata(p_wcontent, abs_wfilename);
   if (p_switem == 0)
   {
     return ERRCODE_MHL_CHECK_NO_MHL_ENTRY;
   }
 
-  res = check_file_against_mhl_file_witem(p_switem, check_existence, p_common);    
+  res = 
+    check_file_against_mhl_file_witem(p_switem, check_existence, 
+                                      check_all_hashes, NULL, p_cache, 
+                                      p_from_cache, p_record, p_common);
   return res;
 }
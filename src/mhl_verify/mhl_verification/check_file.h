@@ -26,6 +26,8 @@
 #define _MHL_TOOLS_MHL_VERIFY_MHL_VERIFICATION_CHECK_FILE_H_
 
 #include <parsemhl/mhl_file_handlers.h>
+#include <mhltools_common/report_writer.h>
+#include <mhl_verify/mhl_verification/verify_cache.h>
 
 //---------------------------------------------------------
 //
@@ -36,10 +38,25 @@
 //
 // Check is real file "fingerprints" are equal to 
 // "fingerprints" from "hash" tag of MHL file.
+// If the tag has several digests, only the fastest to calculate one is
+// checked, unless check_all_hashes is set; the file is read once anyway.
+// p_file_id is identity of the file taken before, e.g. by the plan of
+// verification; the file is stat'ed if it is NULL.
+// With p_cache files, which passed verification before and are not 
+// changed since, are not read; *p_from_cache is set to 1 for them.
+// p_cache and p_from_cache may be NULL.
+// p_record receives size, checked digest and calculated one, and read 
+// time of the file; fields, which are not known, are not changed. 
+// May be NULL.
 //
-int check_file_against_mhl_wfile_item(
+int check_file_against_mhl_file_witem(
   st_mhl_file_check_wdata* p_mhl_file_witem, 
   unsigned char check_existence,
+  unsigned char check_all_hashes,
+  const st_verify_cache_file_id* p_file_id,
+  st_verify_cache* p_cache,
+  unsigned char* p_from_cache,
+  st_report_record* p_record,
   st_controlling_data* p_common);
 
 
@@ -47,6 +64,10 @@ int check_file_against_mhl_wcontent(
   const wchar_t* abs_filename, 
   st_mhl_file_wcontent* p_mhl_file_wcontent, 
   unsigned char check_existence,
+  unsigned char check_all_hashes,
+  st_verify_cache* p_cache,
+  unsigned char* p_from_cache,
+  st_report_record* p_record,
   st_controlling_data* p_common);
 
 #endif //_MHL_TOOLS_MHL_VERIFY_MHL_VERIFICATION_CHECK_FILE_H_
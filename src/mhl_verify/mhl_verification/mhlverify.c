@@ -24,17 +24,24 @@
  */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 
 #include <facade_info/error_codes.h>
 #include <generics/std_funcs_os_anonymizer.h>
 #include <generics/filesystem_handlers/public_interface.h>
+#include <generics/os_threads.h>
 
 #include <mhltools_common/controlling_data.h>
+#include <mhltools_common/progress_reporter.h>
 #include <args_fileslist_support/aux_funcs.h>
 #include <parsemhl/mhl_file_handlers.h>
+#include <parsemhl/mhl_index.h>
+#include <parsemhl/mhl_discovery.h>
 #include <mhl_verify/verify_options.h>
 #include <mhl_verify/mhl_verification/check_file.h>
+#include <mhl_verify/mhl_verification/verify_cache.h>
+#include <mhl_verify/mhl_verification/verify_plan.h>
 
 #include "mhlverify.h"
 
@@ -51,6 +58,9 @@ typedef struct _st_file_verify_data
   // MHL file's data
   st_mhl_file_wcontent* p_mhl_file_wcontent;
   wchar_t* abs_mhl_wpath;
+
+  // cache of verification results, may be NULL
+  st_verify_cache* p_cache;
 } st_file_verify_data;
 
 static
@@ -63,6 +73,8 @@ check_passed_file(const wchar_t* wargv, void* p_data)
   st_conversion_settings* p_cs;
   int res;
   wchar_t* abs_mhl_entity_wpath;
+  unsigned char from_cache = 0;
+  st_report_record record;
 
   p_verify_data = (st_file_verify_data*)p_data;
 
@@ -92,12 +104,22 @@ check_passed_file(const wchar_t* wargv, void* p_data)
   }
   else
   {
+    memset((void*) &record, 0, sizeof(record) / sizeof(char));
+    record.root_wpath = p_verify_data->p_mhl_file_wcontent->base_wdir;
+    record.abs_wpath = abs_mhl_entity_wpath;
     res = 
       check_file_against_mhl_wcontent(
                                       abs_mhl_entity_wpath,
                                       p_verify_data->p_mhl_file_wcontent,
                                       p_mvo->existence,
+                                      p_mvo->all_hashes,
+                                      p_verify_data->p_cache,
+                                      &from_cache,
+                                      &record,
                                       p_mco);
+    print_output_slow_read(stderr, abs_mhl_entity_wpath, 
+                           &p_mco->logging_data);
+    report_file_result(&p_mco->logging_data, &record, res, from_cache);
 
     if (res != 0)
     {
@@ -111,6 +133,16 @@ check_passed_file(const wchar_t* wargv, void* p_data)
         printf("\tChecking failed.\n");
       }
     }
+    else if (from_cache)
+    {
+      print_output_verify_cached(stderr,
+                                 &p_verify_data->p_common->logging_data,
+                                 abs_mhl_entity_wpath);
+      if (p_mco->logging_data.v_data.verbose_level >= VL_VERY_VERBOSE)
+      {
+        printf("\tFile %ls is verified from cache.\n", abs_mhl_entity_wpath);
+      }
+    }
   }
 
   free(abs_mhl_entity_wpath);
@@ -156,6 +188,7 @@ check_passed_files(
                         p_logging);
   }
 
+  start_progress_reporter(p_logging);
   res = run_func_on_args(
     argc,
     argv,
@@ -163,6 +196,7 @@ check_passed_files(
     p_verify_data->p_cs,
     (void*)p_verify_data, // this data will be passed to check_passed_file
     check_passed_file);
+  stop_progress_reporter(p_logging);
 
   // Print finish message
   if (p_logging->v_data.verbose_level >= VL_VERBOSE)
@@ -174,36 +208,23 @@ check_passed_files(
   return res;
 }
 
-static
-int
-compare_lastmodification(st_mhl_file_check_wdata* data1,
-                         st_mhl_file_check_wdata* data2)
-{
-  if (data1->lastmodification_seconds < data2->lastmodification_seconds)
-  {
-    return -1;
-  }
-  else if (data1->lastmodification_seconds == data2->lastmodification_seconds)
-  {
-    return 0;
-  }
-  return 1;
-}
-
 static
 int
 check_files_from_mhl(st_file_verify_data* p_verify_data)
 {
   int res;
   int full_res;
+  size_t i;
   st_mhl_file_check_wdata* el;
-  st_mhl_file_check_wdata* tmp;
   st_mhl_file_wcontent* p_mhl_file_wcontent;
   st_controlling_data* p_common;
   st_progress_data* p_progress;
   st_verbose_data* p_verbose;
   st_mhl_verify_options* p_verify;
-  st_mhlosi_stat wfl_stat;
+  st_verify_plan plan;
+  st_verify_plan_item* p_plan_item;
+  unsigned char from_cache;
+  st_report_record record;
 
 
   p_common = p_verify_data->p_common;
@@ -212,57 +233,55 @@ check_files_from_mhl(st_file_verify_data* p_verify_data)
   p_verify = p_verify_data->p_verify;
   p_mhl_file_wcontent = p_verify_data->p_mhl_file_wcontent;
 
-  p_progress->total_sz = 0;
-  p_progress->n_seqs = 0;
-  p_progress->n_files = 0;
-  p_progress->n_files_processed = 0;
+  // every file is stat'ed once, the results are used for sizes, 
+  // order of verification and checks
+  res = make_verify_plan(p_mhl_file_wcontent, 0, &plan);
+  if (res != 0)
+  {
+    return res;
+  }
+
   full_res = 0;
-  HASH_ITER(hh, p_mhl_file_wcontent->check_witems, el, tmp)
+  for (i = 0; i < plan.items_num; ++i)
   {
-    res = get_wfile_stat_data(el->abs_item_wfilename, &wfl_stat);
-    if (res != 0)
+    p_plan_item = &plan.items[i];
+    if (p_plan_item->stat_res == 0)
     {
-      if (res == ERRCODE_NO_SUCH_FILE)
-      {
-        if (p_verify->continue_on_error == 0) { // avoid diuble logging when continuing later
-          print_error_missing_file(stderr, el->abs_item_wfilename, &p_verify_data->p_common->logging_data);
-        }
-        fprintf(stderr,
-                "Error: File does not exist: '%ls'.\n",
-                el->abs_item_wfilename);
-      }
-      else
-      {
-        fprintf(stderr,
-                "Error: Cannot get file's data, stat() failed for file: %ls. "
-                "Errno=%d. Error:%s\n",
-                el->abs_item_wfilename, errno, strerror(errno));
-      }
-      full_res = res;
+      continue;
     }
-    else
+
+    el = &p_mhl_file_wcontent->check_witems[p_plan_item->item_no];
+    if (p_plan_item->stat_res == ERRCODE_NO_SUCH_FILE)
     {
-      el->lastmodification_seconds = wfl_stat.st_data.st_mtime;
+      if (p_verify->continue_on_error == 0) { // avoid diuble logging when continuing later
+        print_error_missing_file(stderr, el->abs_item_wfilename, &p_verify_data->p_common->logging_data);
+      }
+      fprintf(stderr,
+              "Error: File does not exist: '%ls'.\n",
+              el->abs_item_wfilename);
     }
-
-    res = calculate_total_sz(el->abs_item_wfilename,
-                             (void*)&p_progress->total_sz);
-    
-    if (res != 0)
+    else
     {
-      full_res = res;
+      fprintf(stderr,
+              "Error: Cannot get file's data, stat() failed for file: %ls. "
+              "Error:%s\n",
+              el->abs_item_wfilename, 
+              mhl_error_code_description(p_plan_item->stat_res));
     }
-    ++p_progress->n_files_processed;
+    full_res = p_plan_item->stat_res;
   }
-  p_progress->n_files = p_progress->n_files_processed;
+
+  p_progress->total_sz = plan.total_sz;
+  p_progress->n_seqs = 0;
+  p_progress->n_files = plan.items_num;
+  p_progress->n_files_processed = plan.items_num;
 
   if (full_res != 0 && p_verify->continue_on_error == 0)
   {
-      return full_res;
+    free_verify_plan(&plan);
+    return full_res;
   }
 
-  HASH_SORT(p_mhl_file_wcontent->check_witems, compare_lastmodification); 
-
   // Print start message
   if (p_verbose->verbose_level >= VL_VERBOSE)
   {
@@ -276,8 +295,11 @@ check_files_from_mhl(st_file_verify_data* p_verify_data)
   p_progress->processed_sz = 0;
   p_progress->logged_sz = 0;
 
-  HASH_ITER(hh, p_mhl_file_wcontent->check_witems, el, tmp)
+  start_progress_reporter(&p_common->logging_data);
+  for (i = 0; i < plan.items_num; ++i)
   {
+    p_plan_item = &plan.items[i];
+    el = &p_mhl_file_wcontent->check_witems[p_plan_item->item_no];
     if (p_verbose->verbose_level >= VL_VERY_VERBOSE)
     {
       printf("\tFile %ls\n", el->abs_item_wfilename);
@@ -288,12 +310,26 @@ check_files_from_mhl(st_file_verify_data* p_verify_data)
                            el->hash_type,
                            el->u8str_hash_sum,
                            el->file_sz);
+    from_cache = 0;
+    memset((void*) &record, 0, sizeof(record) / sizeof(char));
+    record.root_wpath = p_mhl_file_wcontent->base_wdir;
+    record.abs_wpath = el->abs_item_wfilename;
+    record.file_sz = el->file_sz;
     res = 
-      check_file_against_mhl_wcontent(
-        el->abs_item_wfilename,
-        p_mhl_file_wcontent,
-        p_verify->existence,
-        p_common);
+      p_plan_item->stat_res != 0 ? 
+        p_plan_item->stat_res :
+        check_file_against_mhl_file_witem(
+          el,
+          p_verify->existence,
+          p_verify->all_hashes,
+          &p_plan_item->file_id,
+          p_verify_data->p_cache,
+          &from_cache,
+          &record,
+          p_common);
+    print_output_slow_read(stderr, el->abs_item_wfilename, 
+                           &p_common->logging_data);
+    report_file_result(&p_common->logging_data, &record, res, from_cache);
 
     ++p_progress->n_files_processed;
 
@@ -319,13 +355,25 @@ check_files_from_mhl(st_file_verify_data* p_verify_data)
       ++p_progress->n_files_ok;
       if (p_verbose->verbose_level >= VL_VERY_VERBOSE)
       {
-        printf("\tCheck passed.\n");
+        printf(from_cache ? 
+                 "\tCheck passed (verified from cache).\n" : 
+                 "\tCheck passed.\n");
+      }
+      if (from_cache)
+      {
+        print_output_verify_cached(stderr,
+                                   &p_verify_data->p_common->logging_data,
+                                   el->abs_item_wfilename);
+      }
+      else
+      {
+        print_output_verify_success(stderr,
+                                    &p_verify_data->p_common->logging_data,
+                                    el->abs_item_wfilename);
       }
-      print_output_verify_success(stderr,
-                                  &p_verify_data->p_common->logging_data,
-                                  el->abs_item_wfilename);
     }
   }
+  stop_progress_reporter(&p_common->logging_data);
 
   // Print finish message
   if (p_verbose->verbose_level >= VL_VERBOSE)
@@ -334,25 +382,491 @@ check_files_from_mhl(st_file_verify_data* p_verify_data)
       &p_common->logging_data);
   }
 
+  free_verify_plan(&plan);
   return full_res;
 }
 
 
+//
+// Copy of the MHL file's folder, verified against the MHL file
+//
+typedef struct _st_root_verify_data
+{
+  wchar_t* abs_root_wdir;
+  size_t job_no; // copies on the same device are verified by the same job
+  int res;
+  unsigned long n_files;
+  unsigned long n_files_failed;
+} st_root_verify_data;
+
+typedef struct _st_roots_verify_job
+{
+  size_t job_no;
+  st_root_verify_data* roots;
+  size_t roots_num;
+  const wchar_t* abs_mhl_wdir;
+  size_t abs_mhl_wdir_len;
+  st_file_verify_data* p_verify_data; // shared by all jobs, not changed
+} st_roots_verify_job;
+
+/* Makes MHL content with items of the copy: paths under the MHL file's
+ * folder are moved to the root folder of the copy, other paths are kept.
+ * The items share digests and keys with the original content, only
+ * their absolute paths are allocated.
+ */
+static
 int
-verify_mhl(
+aux_make_root_wcontent(
+  const st_mhl_file_wcontent* p_wcontent,
+  const wchar_t* abs_mhl_wdir,
+  size_t abs_mhl_wdir_len,
+  const wchar_t* abs_root_wdir,
+  st_mhl_file_wcontent* p_root_wcontent)
+{
+  size_t i;
+  size_t root_wdir_len;
+  size_t item_wpath_len;
+  const wchar_t* item_wpath;
+  wchar_t* root_item_wpath;
+  st_mhl_file_check_wdata* root_witems;
+
+  root_witems = 
+    (st_mhl_file_check_wdata*) calloc(p_wcontent->check_witems_num + 1, 
+                                      sizeof(st_mhl_file_check_wdata));
+  if (root_witems == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  root_wdir_len = wcslen(abs_root_wdir);
+  for (i = 0; i < p_wcontent->check_witems_num; ++i)
+  {
+    root_witems[i] = p_wcontent->check_witems[i];
+    item_wpath = p_wcontent->check_witems[i].abs_item_wfilename;
+    item_wpath_len = wcslen(item_wpath);
+
+    if (item_wpath_len > abs_mhl_wdir_len &&
+        wcsncmp(item_wpath, abs_mhl_wdir, abs_mhl_wdir_len) == 0 &&
+        item_wpath[abs_mhl_wdir_len] == WPATH_SEPARATOR)
+    {
+      item_wpath += abs_mhl_wdir_len;
+      item_wpath_len -= abs_mhl_wdir_len;
+      root_item_wpath = 
+        (wchar_t*) calloc(root_wdir_len + item_wpath_len + 1, 
+                          sizeof(wchar_t));
+      if (root_item_wpath != NULL)
+      {
+        wcscpy(root_item_wpath, abs_root_wdir);
+        wcscpy(root_item_wpath + root_wdir_len, item_wpath);
+      }
+    }
+    else
+    {
+      root_item_wpath = 
+        (wchar_t*) calloc(item_wpath_len + 1, sizeof(wchar_t));
+      if (root_item_wpath != NULL)
+      {
+        wcscpy(root_item_wpath, item_wpath);
+      }
+    }
+
+    root_witems[i].abs_item_wfilename = root_item_wpath;
+    if (root_item_wpath == NULL)
+    {
+      while (i > 0)
+      {
+        free(root_witems[--i].abs_item_wfilename);
+      }
+      free(root_witems);
+      return ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  // the path table and the keys arena belong to the original content
+  *p_root_wcontent = *p_wcontent;
+  p_root_wcontent->check_witems = root_witems;
+  p_root_wcontent->check_witems_capacity = p_wcontent->check_witems_num + 1;
+  p_root_wcontent->base_wdir = NULL;
+  p_root_wcontent->base_wdir_len = 0;
+  return 0;
+}
+
+static
+void
+aux_free_root_wcontent(st_mhl_file_wcontent* p_root_wcontent)
+{
+  size_t i;
+
+  for (i = 0; i < p_root_wcontent->check_witems_num; ++i)
+  {
+    free(p_root_wcontent->check_witems[i].abs_item_wfilename);
+  }
+  free(p_root_wcontent->check_witems);
+  memset(p_root_wcontent, 0, sizeof(*p_root_wcontent) / sizeof(char));
+}
+
+/* Verifies copies of the job one by one. Every job has its own 
+ * progress and log data, the output is written line by line. 
+ * Processed bytes are counted by the progress reporter of the calling 
+ * thread, the first job uses the counters of the calling thread.
+ */
+static
+void
+aux_verify_roots_job(void* arg)
+{
+  st_roots_verify_job* p_job = (st_roots_verify_job*) arg;
+  st_root_verify_data* p_root;
+  st_file_verify_data verify_data;
+  st_controlling_data common;
+  st_mhl_file_wcontent root_wcontent;
+  st_logging_data job_logging_data;
+  st_logging_data* p_main_logging_data;
+  size_t i;
+
+  p_main_logging_data = &p_job->p_verify_data->p_common->logging_data;
+  memset((void*) &job_logging_data, 0, sizeof(job_logging_data) / sizeof(char));
+  if (p_job->job_no == 0)
+  {
+    job_logging_data.progress_data.p_worker = 
+      p_main_logging_data->progress_data.p_worker;
+  }
+  else
+  {
+    attach_progress_worker(&job_logging_data, p_main_logging_data);
+  }
+
+  for (i = 0; i < p_job->roots_num; ++i)
+  {
+    p_root = &p_job->roots[i];
+    if (p_root->job_no != p_job->job_no || p_root->res != 0)
+    {
+      continue;
+    }
+
+    p_root->res = 
+      aux_make_root_wcontent(p_job->p_verify_data->p_mhl_file_wcontent,
+                             p_job->abs_mhl_wdir, p_job->abs_mhl_wdir_len,
+                             p_root->abs_root_wdir, &root_wcontent);
+    if (p_root->res != 0)
+    {
+      continue;
+    }
+
+    common = *p_job->p_verify_data->p_common;
+    common.logging_data.v_data.p_log = NULL;
+    memset((void*) &common.logging_data.progress_data, 0, 
+           sizeof(common.logging_data.progress_data) / sizeof(char));
+    common.logging_data.progress_data.p_worker = 
+      job_logging_data.progress_data.p_worker;
+
+    verify_data = *p_job->p_verify_data;
+    verify_data.p_common = &common;
+    verify_data.p_mhl_file_wcontent = &root_wcontent;
+
+    p_root->res = check_files_from_mhl(&verify_data);
+    p_root->n_files = common.logging_data.progress_data.n_files;
+    p_root->n_files_failed = common.logging_data.progress_data.n_files_failed;
+
+    clean_log_str(&common.logging_data.v_data);
+    aux_free_root_wcontent(&root_wcontent);
+  }
+}
+
+/* Verifies copies of the MHL file's folder, passed via '--root', instead 
+ * of the folder itself. MHL content is parsed once. Copies on different 
+ * devices are verified in parallel, one job per device, so that the 
+ * verification takes the time of the slowest device; copies on the same 
+ * device are verified one by one to avoid seeking between them. 
+ * The calling thread is one of the jobs.
+ */
+static
+int
+check_roots_from_mhl(st_file_verify_data* p_verify_data)
+{
+  int res;
+  int full_res;
+  size_t i;
+  size_t j;
+  size_t jobs_num;
+  size_t started_num;
+  size_t roots_num;
+  wchar_t* abs_mhl_wdir;
+  wchar_t* wsep;
+  uint64_t* root_devs;
+  st_mhlosi_stat stat_data;
+  st_root_verify_data* roots;
+  st_roots_verify_job* jobs;
+  mhlosi_thread* threads;
+  st_mhl_verify_options* p_mvo;
+  st_progress_data* p_progress;
+
+  p_mvo = p_verify_data->p_verify;
+  roots_num = p_mvo->root_wdirs_cnt;
+
+  abs_mhl_wdir = 
+    (wchar_t*) calloc(wcslen(p_verify_data->abs_mhl_wpath) + 1, 
+                      sizeof(wchar_t));
+  roots = 
+    (st_root_verify_data*) calloc(roots_num, sizeof(st_root_verify_data));
+  root_devs = (uint64_t*) calloc(roots_num, sizeof(uint64_t));
+  jobs = 
+    (st_roots_verify_job*) calloc(roots_num, sizeof(st_roots_verify_job));
+  threads = (mhlosi_thread*) calloc(roots_num, sizeof(mhlosi_thread));
+  if (abs_mhl_wdir == NULL || roots == NULL || root_devs == NULL || 
+      jobs == NULL || threads == NULL)
+  {
+    free(abs_mhl_wdir);
+    free(roots);
+    free(root_devs);
+    free(jobs);
+    free(threads);
+    fprintf(stderr, "Out of memory.\n");
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  wcscpy(abs_mhl_wdir, p_verify_data->abs_mhl_wpath);
+  wsep = wcsrchr(abs_mhl_wdir, WPATH_SEPARATOR);
+  if (wsep != NULL)
+  {
+    *wsep = L'\0';
+  }
+
+  // every device gets its own job
+  jobs_num = 0;
+  for (i = 0; i < roots_num; ++i)
+  {
+    res = 
+      convert_to_absolute_normalized_wpath(p_mvo->root_wdirs[i], 
+                                           &roots[i].abs_root_wdir, 
+                                           p_verify_data->p_cs);
+    if (res != 0)
+    {
+      fprintf(
+              stderr, 
+              "Cannot convert path to folder ('%ls') to absolute path.\n"
+              "Description: %s\n",
+              p_mvo->root_wdirs[i],      
+              mhl_error_code_description(res));
+      roots[i].res = res;
+      continue;
+    }
+
+    res = get_wfile_stat_data(roots[i].abs_root_wdir, &stat_data);
+    if (res != 0)
+    {
+      fprintf(
+              stderr, 
+              "Error: Cannot read folder '%ls'.\n"
+              "Description: %s\n",
+              roots[i].abs_root_wdir,      
+              mhl_error_code_description(res));
+      roots[i].res = res;
+      continue;
+    }
+
+    root_devs[i] = (uint64_t) stat_data.st_data.st_dev;
+    for (j = 0; j < i; ++j)
+    {
+      if (roots[j].res == 0 && root_devs[j] == root_devs[i])
+      {
+        break;
+      }
+    }
+    roots[i].job_no = j < i ? roots[j].job_no : jobs_num++;
+  }
+
+  for (i = 0; i < jobs_num; ++i)
+  {
+    jobs[i].job_no = i;
+    jobs[i].roots = roots;
+    jobs[i].roots_num = roots_num;
+    jobs[i].abs_mhl_wdir = abs_mhl_wdir;
+    jobs[i].abs_mhl_wdir_len = wcslen(abs_mhl_wdir);
+    jobs[i].p_verify_data = p_verify_data;
+  }
+
+  if (p_verify_data->p_common->logging_data.v_data.verbose_level >= VL_VERBOSE)
+  {
+    printf("Verifying %lu copies on %lu device(s).\n", 
+           (unsigned long) roots_num, (unsigned long) jobs_num);
+  }
+
+  p_progress = &p_verify_data->p_common->logging_data.progress_data;
+  p_progress->total_sz = 0;
+  for (i = 0; i < p_verify_data->p_mhl_file_wcontent->check_witems_num; ++i)
+  {
+    p_progress->total_sz += 
+      p_verify_data->p_mhl_file_wcontent->check_witems[i].file_sz;
+  }
+  p_progress->total_sz *= roots_num;
+  p_progress->processed_sz = 0;
+  p_progress->logged_sz = 0;
+  start_progress_reporter(&p_verify_data->p_common->logging_data);
+
+  started_num = 0;
+  for (i = 1; i < jobs_num; ++i)
+  {
+    if (mhlosi_thread_create(&threads[i], aux_verify_roots_job, &jobs[i]) != 0)
+    {
+      break;
+    }
+    ++started_num;
+  }
+
+  if (jobs_num != 0)
+  {
+    aux_verify_roots_job(&jobs[0]);
+  }
+  // devices without a thread are verified here one by one
+  for (i = started_num + 1; i < jobs_num; ++i)
+  {
+    aux_verify_roots_job(&jobs[i]);
+  }
+
+  for (i = 1; i <= started_num; ++i)
+  {
+    mhlosi_thread_join(threads[i]);
+  }
+
+  stop_progress_reporter(&p_verify_data->p_common->logging_data);
+
+  full_res = 0;
+  for (i = 0; i < roots_num; ++i)
+  {
+    if (roots[i].res == 0)
+    {
+      printf("Copy '%ls': %lu file(s) verified successfully.\n",
+             roots[i].abs_root_wdir != NULL ? 
+               roots[i].abs_root_wdir : p_mvo->root_wdirs[i],
+             roots[i].n_files);
+      continue;
+    }
+
+    full_res = roots[i].res;
+    if (roots[i].n_files_failed != 0)
+    {
+      printf("Copy '%ls': %lu of %lu file(s) failed verification.\n",
+             roots[i].abs_root_wdir, roots[i].n_files_failed, 
+             roots[i].n_files);
+    }
+    else
+    {
+      printf("Copy '%ls': verification failed: %s\n",
+             roots[i].abs_root_wdir != NULL ? 
+               roots[i].abs_root_wdir : p_mvo->root_wdirs[i],
+             mhl_error_code_description(roots[i].res));
+    }
+  }
+
+  for (i = 0; i < roots_num; ++i)
+  {
+    free(roots[i].abs_root_wdir);
+  }
+  free(abs_mhl_wdir);
+  free(roots);
+  free(root_devs);
+  free(jobs);
+  free(threads);
+  return full_res;
+}
+
+
+/* Loads MHL content from the index of MHL file if the index is up to date.
+ * Otherwise parses MHL file and writes a new index for it. Failure to make
+ * or write the index is not an error, the content is verified anyway.
+ */
+static
+int
+parse_indexed_mhl_wfile(
+  const wchar_t* abs_mhl_wpath,
+  st_mhl_file_wcontent* p_mhl_file_wcontent,
+  st_mhl_verify_options* p_mvo,
+  st_controlling_data* p_mco,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  wchar_t* index_wpath;
+  st_mhl_index_key index_key;
+
+  res = get_mhl_index_key(abs_mhl_wpath, &index_key);
+  if (res != 0)
+  {
+    // parsing reports the problem
+    return parse_mhl_wfile(abs_mhl_wpath, p_mhl_file_wcontent, p_cs);
+  }
+
+  res = 
+    make_mhl_index_wpath(abs_mhl_wpath, p_mvo->index_wdir, &index_wpath, p_cs);
+  if (res != 0)
+  {
+    fprintf(
+            stderr, 
+            "Warning: Cannot make path to index of MHL file '%ls'.\n"
+            "Description: %s\n",
+            abs_mhl_wpath,
+            mhl_error_code_description(res));
+    
+    return parse_mhl_wfile(abs_mhl_wpath, p_mhl_file_wcontent, p_cs);
+  }
+
+  res = 
+    load_mhl_index(index_wpath, abs_mhl_wpath, &index_key, 
+                   p_mhl_file_wcontent);
+  if (res != ERRCODE_MHL_INDEX_OUTDATED)
+  {
+    if (res == 0 && 
+        p_mco->logging_data.v_data.verbose_level >= VL_VERY_VERBOSE)
+    {
+      printf("MHL file content is loaded from index '%ls'.\n", index_wpath);
+    }
+
+    free(index_wpath);
+    return res;
+  }
+
+  res = parse_mhl_wfile(abs_mhl_wpath, p_mhl_file_wcontent, p_cs);
+  if (res != 0)
+  {
+    free(index_wpath);
+    return res;
+  }
+
+  res = 
+    write_mhl_index(index_wpath, abs_mhl_wpath, &index_key, 
+                    p_mhl_file_wcontent);
+  if (res != 0)
+  {
+    fprintf(
+            stderr, 
+            "Warning: Cannot write index of MHL file to '%ls'.\n"
+            "Description: %s\n",
+            index_wpath,
+            mhl_error_code_description(res));
+  }
+  else if (p_mco->logging_data.v_data.verbose_level >= VL_VERY_VERBOSE)
+  {
+    printf("Index of MHL file is written to '%ls'.\n", index_wpath);
+  }
+
+  free(index_wpath);
+  return 0;
+}
+
+/* Parses MHL file and checks the passed files or all files from it.
+ */
+static
+int
+verify_mhl_wfile(
+  const wchar_t* abs_mhl_wpath,
   int argc, 
   const char * argv[], 
   st_controlling_data* p_mco,
   st_mhl_verify_options* p_mvo, 
+  st_verify_cache* p_cache,
   st_conversion_settings* p_cs)
 {
-  int i, res;
+  int res;
   st_mhl_file_wcontent mhl_file_wcontent;
-  wchar_t* abs_mhl_wpath;
-  wchar_t* abs_arg_wpath;
-  wchar_t* wargv;
-  size_t wargv_sz;
-  unsigned char mhl_not_found = 1;
 
   // This structure doesn't store any information itself,
   // it is used only to simplify passing the pointers to data structures
@@ -360,10 +874,182 @@ verify_mhl(
   // it is not responsible for any memory management
   st_file_verify_data verify_data;
   
+  res = init_mhl_file_wcontent(&mhl_file_wcontent);
+  if (res != 0)
+  {
+    fprintf(
+            stderr, 
+            "Internal error. Cannot init structures for MHL checking.\n"
+            "Description: %s\n",
+            mhl_error_code_description(res));
+    
+    return res;
+  }
+  
+  //
+  if (p_mvo->use_index)
+  {
+    res = 
+      parse_indexed_mhl_wfile(abs_mhl_wpath, &mhl_file_wcontent, p_mvo, p_mco, 
+                              p_cs);
+  }
+  else
+  {
+    res = parse_mhl_wfile(abs_mhl_wpath, &mhl_file_wcontent, p_cs);
+  }
+  if (res != 0)
+  {
+    fprintf(
+            stderr, 
+            "Error occured during parsing of MHL file '%ls'.\n"
+            "Description: %s\n",
+            abs_mhl_wpath,
+            mhl_error_code_description(res));
+    
+    free_mhl_file_wcontent(&mhl_file_wcontent);
+    return res;
+  }
+  
+  //
+  // check files 
+  //
+  verify_data.abs_mhl_wpath = (wchar_t*) abs_mhl_wpath;
+  verify_data.p_common = p_mco;
+  verify_data.p_verify = p_mvo;
+  verify_data.p_cs = p_cs;
+  verify_data.p_mhl_file_wcontent = &mhl_file_wcontent;
+  verify_data.p_cache = p_cache;
+
+  if (p_mco->files_argv_index != 0)
+  {
+    // files for checking are passed via args
+    res =  
+      check_passed_files(argc, argv, &verify_data);
+  }
+  else if (p_mvo->root_wdirs_cnt != 0)
+  {
+    res =
+      check_roots_from_mhl(&verify_data);
+  }
+  else 
+  {
+    res =
+      check_files_from_mhl(&verify_data);
+  }
+  
+  free_mhl_file_wcontent(&mhl_file_wcontent);
+  
+  if (p_mco->logging_data.v_data.verbose_level >= VL_VERBOSE)
+  {
+    if (res == 0)
+    {
+      printf("Checking of MHL file content successful.\n");
+    }
+    else 
+    {
+      printf("Checking of MHL file content failed.\n");
+    }
+  }              
+  
+  return res;
+}
+
+/* Loads cache of verification results, if it is requested.
+ * *pp_cache is set to p_cache then, to NULL otherwise.
+ */
+static
+int
+open_verify_cache(
+  st_mhl_verify_options* p_mvo,
+  st_verify_cache* p_cache,
+  st_verify_cache** pp_cache)
+{
+  int res;
+
+  *pp_cache = NULL;
+  if (p_mvo->cache_wpath == NULL)
+  {
+    return 0;
+  }
+
+  res = load_verify_cache(p_cache, p_mvo->cache_wpath, p_mvo->max_cache_age);
+  if (res != 0)
+  {
+    fprintf(
+            stderr, 
+            "Cannot read verification cache '%ls'.\n"
+            "Description: %s\n",
+            p_mvo->cache_wpath,
+            mhl_error_code_description(res));
+    
+    return res;
+  }
+
+  *pp_cache = p_cache;
+  return 0;
+}
+
+/* Writes and frees cache of verification results. Failure to write 
+ * the cache is not an error, the files are verified anyway.
+ */
+static
+void
+close_verify_cache(
+  st_verify_cache* p_cache,
+  st_controlling_data* p_mco)
+{
+  int res;
+
+  if (p_cache == NULL)
+  {
+    return;
+  }
+
+  if (p_mco->logging_data.v_data.verbose_level >= VL_VERBOSE)
+  {
+    printf("%lu file(s) verified from cache '%ls'.\n", 
+           (unsigned long) p_cache->hits_num, p_cache->cache_wpath);
+  }
+
+  res = save_verify_cache(p_cache);
+  if (res != 0)
+  {
+    fprintf(
+            stderr, 
+            "Warning: Cannot write verification cache to '%ls'.\n"
+            "Description: %s\n",
+            p_cache->cache_wpath,
+            mhl_error_code_description(res));
+  }
+
+  free_verify_cache(p_cache);
+}
+
+int
+verify_mhl(
+  int argc, 
+  const char * argv[], 
+  st_controlling_data* p_mco,
+  st_mhl_verify_options* p_mvo, 
+  st_conversion_settings* p_cs)
+{
+  int i, res;
+  wchar_t* abs_mhl_wpath;
+  wchar_t* abs_arg_wpath;
+  wchar_t* arg_mhl_wpath;
+  wchar_t* wargv;
+  size_t wargv_sz;
+  st_mhl_discovery_cache discovery_cache;
+  st_verify_cache verify_cache;
+  st_verify_cache* p_cache;
+
   if (p_mvo->f_option == 0)
   {
-    // search for mhl file 
-    for (i = p_mco->files_argv_index; i < argc && mhl_not_found; ++i)
+    // Search for mhl file of the first file, the rest files are 
+    // checked to be located under the same MHL file. 
+    // Folders are listed once, the results are cached.
+    init_mhl_discovery_cache(&discovery_cache);
+    for (i = p_mco->files_argv_index; i < argc; ++i)
     { 
       res = 
         convert_composed_from_locale_to_wchar(
@@ -375,6 +1061,7 @@ verify_mhl(
     
       if (res != 0)
       {
+        free_mhl_discovery_cache(&discovery_cache);
         return res;
       }
       
@@ -391,26 +1078,42 @@ verify_mhl(
             mhl_error_code_description(res));
     
         free(wargv);
+        free_mhl_discovery_cache(&discovery_cache);
         return res;    
       }
       free(wargv);
 
-      res = search_mhl_wfile(abs_arg_wpath, &p_mvo->f_wmhl, p_cs);
+      res = 
+        search_mhl_wfile_cached(&discovery_cache, abs_arg_wpath, 
+                                &arg_mhl_wpath, p_cs);
       
-      if (res != 0)
+      if (p_mvo->f_wmhl == NULL)
       {
-        fprintf(stderr, "MHL file is not found for the source file: %s ('%ls')\n",
-                argv[i], abs_arg_wpath);
-        free(abs_arg_wpath);
-        return res;
+        if (res != 0)
+        {
+          fprintf(stderr, "MHL file is not found for the source file: %s ('%ls')\n",
+                  argv[i], abs_arg_wpath);
+          free(abs_arg_wpath);
+          free_mhl_discovery_cache(&discovery_cache);
+          return res;
+        }
+        
+        p_mvo->f_wmhl = arg_mhl_wpath;
+      }
+      else if (res == 0)
+      {
+        if (wcscmp(arg_mhl_wpath, p_mvo->f_wmhl) != 0)
+        {
+          fprintf(stderr, 
+                  "Warning: The file %s ('%ls') is located under another "
+                  "MHL file '%ls'.\n",
+                  argv[i], abs_arg_wpath, arg_mhl_wpath);
+        }
+        free(arg_mhl_wpath);
       }
       free(abs_arg_wpath);
-
-      // TODO: check for all the rest files, 
-      // that the found MHL is correctly located!
-
-      mhl_not_found = 0;
     }
+    free_mhl_discovery_cache(&discovery_cache);
   }
   
   res = convert_to_absolute_normalized_wpath(p_mvo->f_wmhl, &abs_mhl_wpath, p_cs);
@@ -426,70 +1129,130 @@ verify_mhl(
     return res;    
   }
   
-  res = init_mhl_file_wcontent(&mhl_file_wcontent);
+  res = open_verify_cache(p_mvo, &verify_cache, &p_cache);
+  if (res != 0)
+  {
+    free(abs_mhl_wpath);
+    return res;
+  }
+
+  res = 
+    verify_mhl_wfile(abs_mhl_wpath, argc, argv, p_mco, p_mvo, p_cache, p_cs);
+  close_verify_cache(p_cache, p_mco);
+  free(abs_mhl_wpath);
+  return res;
+}
+
+int
+verify_discovered_mhls(
+  st_controlling_data* p_mco,
+  st_mhl_verify_options* p_mvo, 
+  st_conversion_settings* p_cs)
+{
+  int res;
+  int full_res;
+  size_t i;
+  size_t failed_mhls_num;
+  size_t failed_wdirs_num;
+  wchar_t* abs_root_wdir;
+  wchar_t** mhl_wpaths;
+  size_t mhl_wpaths_num;
+  st_verify_cache verify_cache;
+  st_verify_cache* p_cache;
+  
+  res = 
+    convert_to_absolute_normalized_wpath(p_mvo->discover_root_wdir, 
+                                         &abs_root_wdir, p_cs);
   if (res != 0)
   {
     fprintf(
             stderr, 
-            "Internal error. Cannot init structures for MHL checking.\n"
+            "Cannot convert path to folder ('%ls') to absolute path.\n"
             "Description: %s\n",
+            p_mvo->discover_root_wdir,      
             mhl_error_code_description(res));
     
-    free(abs_mhl_wpath);
-    return res;
+    return res;    
   }
   
-  //
-  res = parse_mhl_wfile(abs_mhl_wpath, &mhl_file_wcontent, p_cs);
+  res = 
+    discover_mhl_wfiles(abs_root_wdir, 0, &mhl_wpaths, &mhl_wpaths_num, 
+                        &failed_wdirs_num);
   if (res != 0)
   {
     fprintf(
             stderr, 
-            "Error occured during parsing of MHL file '%ls'.\n"
+            "Cannot search for MHL files in folder '%ls'.\n"
             "Description: %s\n",
-            abs_mhl_wpath,
+            abs_root_wdir,      
             mhl_error_code_description(res));
     
-    free(abs_mhl_wpath);
-    free_mhl_file_wcontent(&mhl_file_wcontent);
-    return res;
+    free(abs_root_wdir);
+    return res;    
   }
   
-  //
-  // check files 
-  //
-  verify_data.abs_mhl_wpath = abs_mhl_wpath;
-  verify_data.p_common = p_mco;
-  verify_data.p_verify = p_mvo;
-  verify_data.p_cs = p_cs;
-  verify_data.p_mhl_file_wcontent = &mhl_file_wcontent;
+  if (mhl_wpaths_num == 0)
+  {
+    fprintf(stderr, "No MHL files are found in folder '%ls'.\n", 
+            abs_root_wdir);
+    free(abs_root_wdir);
+    free_discovered_mhl_wfiles(mhl_wpaths, mhl_wpaths_num);
+    return ERRCODE_MHL_NOT_FOUND;
+  }
+  
+  if (p_mco->logging_data.v_data.verbose_level >= VL_VERBOSE)
+  {
+    printf("%lu MHL file(s) found in folder '%ls'.\n", 
+           (unsigned long) mhl_wpaths_num, abs_root_wdir);
+  }
 
-  if (p_mco->files_argv_index != 0)
+  res = open_verify_cache(p_mvo, &verify_cache, &p_cache);
+  if (res != 0)
   {
-    // files for checking are passed via args
-    res =  
-      check_passed_files(argc, argv, &verify_data);
+    free(abs_root_wdir);
+    free_discovered_mhl_wfiles(mhl_wpaths, mhl_wpaths_num);
+    return res;
   }
-  else 
+  
+  full_res = 0;
+  failed_mhls_num = 0;
+  for (i = 0; i < mhl_wpaths_num; ++i)
   {
-    res =
-      check_files_from_mhl(&verify_data);
+    if (p_mco->logging_data.v_data.verbose_level >= VL_VERBOSE)
+    {
+      printf("\nVerifying MHL file '%ls'.\n", mhl_wpaths[i]);
+    }
+    
+    res = 
+      verify_mhl_wfile(mhl_wpaths[i], 0, NULL, p_mco, p_mvo, p_cache, p_cs);
+    if (res != 0)
+    {
+      full_res = res;
+      ++failed_mhls_num;
+    }
   }
   
-  free(abs_mhl_wpath);
-  free_mhl_file_wcontent(&mhl_file_wcontent);
+  if (full_res == 0 && failed_wdirs_num != 0)
+  {
+    // some MHL files may be not found
+    full_res = ERRCODE_IO_ERROR;
+  }
   
   if (p_mco->logging_data.v_data.verbose_level >= VL_VERBOSE)
   {
-    if (res == 0)
-    {
-      printf("Checking of MHL file content successful.\n");
-    }
-    else 
+    printf("\n%lu of %lu MHL file(s) verified successfully",
+           (unsigned long) (mhl_wpaths_num - failed_mhls_num), 
+           (unsigned long) mhl_wpaths_num);
+    if (failed_wdirs_num != 0)
     {
-      printf("Checking of MHL file content failed.\n");
+      printf(", %lu folder(s) can't be read", 
+             (unsigned long) failed_wdirs_num);
     }
-  }              
+    printf(".\n");
+  }
   
-  return res;
+  close_verify_cache(p_cache, p_mco);
+  free(abs_root_wdir);
+  free_discovered_mhl_wfiles(mhl_wpaths, mhl_wpaths_num);
+  return full_res;
 }
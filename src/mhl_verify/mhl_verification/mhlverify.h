@@ -37,4 +37,12 @@ verify_mhl(
   st_mhl_verify_options* p_mvo, 
   st_conversion_settings* p_cs);
 
+/* Verifies all MHL files found in the folder and its subfolders.
+ */
+int
+verify_discovered_mhls(
+  st_controlling_data* p_mco,
+  st_mhl_verify_options* p_mvo, 
+  st_conversion_settings* p_cs);
+
 #endif //_MHL_TOOLS_MHL_VERIFY_MHL_VERIFICATION_MHLVERIFY_H_
@@ -0,0 +1,552 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: verify_cache.c
+ *
+ * Cache of verification results.
+ *
+ * Layout of the cache file (host byte order):
+ *   header
+ *   entries - st_verify_cache_entry, in no particular order
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/os_check.h>
+#include <generics/memory_management.h>
+#include <mhltools_common/xxhash.h>
+
+#include "verify_cache.h"
+
+#define VERIFY_CACHE_MAGIC "MHLVCACH"
+#define VERIFY_CACHE_MAGIC_SZ 8
+#define VERIFY_CACHE_VERSION 1
+#define VERIFY_CACHE_BYTE_ORDER 0x01020304
+#define VERIFY_CACHE_TMP_WEXT L".tmp"
+#define VERIFY_CACHE_SLOTS_MIN_NUM 64
+
+typedef struct _st_verify_cache_header
+{
+  char magic[VERIFY_CACHE_MAGIC_SZ];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t entry_sz;
+  uint32_t reserved;
+  uint64_t entries_num;
+} st_verify_cache_header;
+
+//---------------------------------------------------------
+//
+// Table of entries
+//
+//---------------------------------------------------------
+
+static uint32_t
+aux_hash_file_id(const st_verify_cache_file_id* p_file_id)
+{
+  uint64_t key[3];
+
+  key[0] = p_file_id->dev;
+  key[1] = p_file_id->ino;
+  key[2] = p_file_id->path_hash;
+  return XXH32(key, sizeof(key), 0);
+}
+
+static unsigned char
+aux_is_same_file(
+  const st_verify_cache_file_id* p_file_id1,
+  const st_verify_cache_file_id* p_file_id2)
+{
+  return p_file_id1->dev == p_file_id2->dev && 
+    p_file_id1->ino == p_file_id2->ino && 
+    p_file_id1->path_hash == p_file_id2->path_hash;
+}
+
+/* @return Slot of entry for the file, or empty slot where it should be put.
+ */
+static uint32_t*
+aux_find_slot(
+  const st_verify_cache* p_cache,
+  const st_verify_cache_file_id* p_file_id)
+{
+  size_t mask = p_cache->slots_num - 1;
+  size_t i = aux_hash_file_id(p_file_id) & mask;
+  uint32_t* p_slot;
+
+  for (;; i = (i + 1) & mask)
+  {
+    p_slot = &p_cache->slots[i];
+    if (*p_slot == 0 || 
+        aux_is_same_file(&p_cache->entries[*p_slot - 1].file_id, p_file_id))
+    {
+      return p_slot;
+    }
+  }
+}
+
+static int
+aux_rebuild_slots(st_verify_cache* p_cache, size_t slots_num)
+{
+  size_t i;
+  uint32_t* slots;
+
+  slots = (uint32_t*) calloc(slots_num, sizeof(uint32_t));
+  if (slots == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  free(p_cache->slots);
+  p_cache->slots = slots;
+  p_cache->slots_num = slots_num;
+
+  for (i = 0; i < p_cache->entries_num; ++i)
+  {
+    *aux_find_slot(p_cache, &p_cache->entries[i].file_id) = (uint32_t) i + 1;
+  }
+
+  return 0;
+}
+
+/* Adds entry, the cache must not have entry for the same file.
+ */
+static int
+aux_add_entry(st_verify_cache* p_cache, const st_verify_cache_entry* p_entry)
+{
+  int res;
+  size_t slots_num;
+
+  if (p_cache->entries_num == p_cache->entries_capacity)
+  {
+    res = 
+      increase_allocated_memory(
+        (void**) &p_cache->entries,
+        &p_cache->entries_capacity,
+        p_cache->entries_capacity ? p_cache->entries_capacity * 2 : 64,
+        sizeof(st_verify_cache_entry));
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  // load factor is kept below 3/4
+  slots_num = p_cache->slots_num;
+  while ((p_cache->entries_num + 1) * 4 > slots_num * 3)
+  {
+    slots_num = slots_num ? slots_num * 2 : VERIFY_CACHE_SLOTS_MIN_NUM;
+  }
+
+  if (slots_num != p_cache->slots_num)
+  {
+    res = aux_rebuild_slots(p_cache, slots_num);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  p_cache->entries[p_cache->entries_num] = *p_entry;
+  ++p_cache->entries_num;
+  *aux_find_slot(p_cache, &p_entry->file_id) = 
+    (uint32_t) p_cache->entries_num;
+  return 0;
+}
+
+static st_verify_cache_entry*
+aux_find_entry(
+  const st_verify_cache* p_cache,
+  const st_verify_cache_file_id* p_file_id)
+{
+  uint32_t* p_slot;
+
+  if (p_cache->slots_num == 0)
+  {
+    return 0;
+  }
+
+  p_slot = aux_find_slot(p_cache, p_file_id);
+  return *p_slot != 0 ? &p_cache->entries[*p_slot - 1] : 0;
+}
+
+/* Entries older than max_age are dropped when the cache is saved.
+ */
+static unsigned char
+aux_is_entry_expired(
+  const st_verify_cache* p_cache, 
+  const st_verify_cache_entry* p_entry)
+{
+  return p_cache->max_age >= 0 && 
+    p_cache->start_time - p_entry->verified_at > p_cache->max_age;
+}
+
+/* Entries are used only while they are younger than max_age, so with 
+ * zero max_age no entry is used, not even one of the same second.
+ */
+static unsigned char
+aux_is_entry_usable(
+  const st_verify_cache* p_cache, 
+  const st_verify_cache_entry* p_entry)
+{
+  return p_cache->max_age < 0 || 
+    p_cache->start_time - p_entry->verified_at < p_cache->max_age;
+}
+
+/* Converts digest into the form it is stored in the cache.
+ * @return 1 in case of success, 0 if digest can't be cached
+ */
+static unsigned char
+aux_make_cache_digest(
+  const char* u8str_hash_sum, 
+  char* digest, 
+  uint8_t* p_digest_sz)
+{
+  size_t i;
+  size_t digest_sz;
+
+  digest_sz = strlen(u8str_hash_sum);
+  if (digest_sz == 0 || digest_sz > VERIFY_CACHE_DIGEST_MAX_SZ)
+  {
+    return 0;
+  }
+
+  for (i = 0; i < digest_sz; ++i)
+  {
+    digest[i] = (char) tolower((unsigned char) u8str_hash_sum[i]);
+  }
+
+  *p_digest_sz = (uint8_t) digest_sz;
+  return 1;
+}
+
+//---------------------------------------------------------
+//
+// Public functions
+//
+//---------------------------------------------------------
+
+int load_verify_cache(
+  st_verify_cache* p_cache,
+  const wchar_t* cache_wpath,
+  long long max_age)
+{
+  int res;
+  uint64_t i;
+  const char* cache_data;
+  size_t cache_sz;
+  const st_verify_cache_header* p_header;
+  const st_verify_cache_entry* entries;
+
+  if (p_cache == 0 || cache_wpath == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  memset(p_cache, 0, sizeof(*p_cache));
+  p_cache->max_age = max_age;
+  p_cache->start_time = (long long) time(NULL);
+  p_cache->cache_wpath = 
+    (wchar_t*) calloc(wcslen(cache_wpath) + 1, sizeof(wchar_t));
+  if (p_cache->cache_wpath == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  wcscpy(p_cache->cache_wpath, cache_wpath);
+
+  if (does_wpath_exist(cache_wpath) == 0)
+  {
+    // the cache is created on save
+    return 0;
+  }
+
+  res = wmap_file_for_read(cache_wpath, &cache_data, &cache_sz);
+  if (res != 0)
+  {
+    // e.g. empty file left after crash
+    p_cache->is_changed = 1;
+    return 0;
+  }
+
+  p_header = (const st_verify_cache_header*) cache_data;
+  if (cache_sz < sizeof(*p_header) ||
+      memcmp(p_header->magic, VERIFY_CACHE_MAGIC, VERIFY_CACHE_MAGIC_SZ) != 0 ||
+      p_header->version != VERIFY_CACHE_VERSION ||
+      p_header->byte_order != VERIFY_CACHE_BYTE_ORDER ||
+      p_header->entry_sz != sizeof(st_verify_cache_entry) ||
+      p_header->entries_num != 
+        (cache_sz - sizeof(*p_header)) / sizeof(st_verify_cache_entry) ||
+      (cache_sz - sizeof(*p_header)) % sizeof(st_verify_cache_entry) != 0)
+  {
+    fprintf(stderr, 
+            "Warning: Verification cache '%ls' is damaged or of other "
+            "version, it is recreated.\n", 
+            cache_wpath);
+    unmap_file(cache_data, cache_sz);
+    p_cache->is_changed = 1;
+    return 0;
+  }
+
+  entries = (const st_verify_cache_entry*) (cache_data + sizeof(*p_header));
+  res = 0;
+  for (i = 0; i < p_header->entries_num && res == 0; ++i)
+  {
+    if (entries[i].hash_type == MHL_HT_UNRECOGNIZED ||
+        entries[i].digest_sz > VERIFY_CACHE_DIGEST_MAX_SZ ||
+        aux_find_entry(p_cache, &entries[i].file_id) != 0)
+    {
+      p_cache->is_changed = 1;
+      continue;
+    }
+
+    res = aux_add_entry(p_cache, &entries[i]);
+  }
+
+  unmap_file(cache_data, cache_sz);
+  if (res != 0)
+  {
+    free_verify_cache(p_cache);
+  }
+  return res;
+}
+
+int save_verify_cache(st_verify_cache* p_cache)
+{
+  int res = 0;
+  FILE* f;
+  size_t i;
+  size_t tmp_wpath_len;
+  wchar_t* tmp_wpath;
+  st_verify_cache_header header;
+  const st_verify_cache_entry* p_entry;
+
+  if (p_cache == 0 || p_cache->cache_wpath == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (!p_cache->is_changed)
+  {
+    return 0;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, VERIFY_CACHE_MAGIC, VERIFY_CACHE_MAGIC_SZ);
+  header.version = VERIFY_CACHE_VERSION;
+  header.byte_order = VERIFY_CACHE_BYTE_ORDER;
+  header.entry_sz = sizeof(st_verify_cache_entry);
+  for (i = 0; i < p_cache->entries_num; ++i)
+  {
+    p_entry = &p_cache->entries[i];
+    if (p_entry->hash_type != MHL_HT_UNRECOGNIZED && 
+        !aux_is_entry_expired(p_cache, p_entry))
+    {
+      ++header.entries_num;
+    }
+  }
+
+  tmp_wpath_len = wcslen(p_cache->cache_wpath) + wcslen(VERIFY_CACHE_TMP_WEXT);
+  tmp_wpath = (wchar_t*) calloc(tmp_wpath_len + 1, sizeof(wchar_t));
+  if (tmp_wpath == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  wcscpy(tmp_wpath, p_cache->cache_wpath);
+  wcscat(tmp_wpath, VERIFY_CACHE_TMP_WEXT);
+
+  f = fwopen_for_binary_create(tmp_wpath);
+  if (f == 0)
+  {
+    free(tmp_wpath);
+    return ERRCODE_IO_ERROR;
+  }
+
+  if (fwrite(&header, sizeof(header), 1, f) != 1)
+  {
+    res = ERRCODE_IO_ERROR;
+  }
+
+  for (i = 0; i < p_cache->entries_num && res == 0; ++i)
+  {
+    p_entry = &p_cache->entries[i];
+    if (p_entry->hash_type != MHL_HT_UNRECOGNIZED && 
+        !aux_is_entry_expired(p_cache, p_entry) &&
+        fwrite(p_entry, sizeof(*p_entry), 1, f) != 1)
+    {
+      res = ERRCODE_IO_ERROR;
+    }
+  }
+
+  if (fclose(f) != 0 && res == 0)
+  {
+    res = ERRCODE_IO_ERROR;
+  }
+
+  if (res == 0)
+  {
+    res = wrename_file(tmp_wpath, p_cache->cache_wpath);
+  }
+
+  if (res != 0)
+  {
+    wremove_file(tmp_wpath);
+  }
+  else
+  {
+    p_cache->is_changed = 0;
+  }
+
+  free(tmp_wpath);
+  return res;
+}
+
+void free_verify_cache(st_verify_cache* p_cache)
+{
+  if (p_cache == 0)
+  {
+    return;
+  }
+
+  free(p_cache->cache_wpath);
+  free(p_cache->entries);
+  free(p_cache->slots);
+  memset(p_cache, 0, sizeof(*p_cache));
+}
+
+void make_verify_cache_file_id(
+  const wchar_t* abs_wpath,
+  const st_mhlosi_stat* p_stat,
+  st_verify_cache_file_id* p_file_id)
+{
+  memset(p_file_id, 0, sizeof(*p_file_id));
+  p_file_id->dev = (uint64_t) p_stat->st_data.st_dev;
+  p_file_id->file_sz = (uint64_t) p_stat->st_data.st_size;
+  p_file_id->mtime = (int64_t) p_stat->st_data.st_mtime;
+  p_file_id->ctime = (int64_t) p_stat->st_data.st_ctime;
+
+#ifdef WIN
+  // there are no inode numbers, and ctime is creation time
+  p_file_id->path_hash = 
+    XXH64(abs_wpath, wcslen(abs_wpath) * sizeof(wchar_t), 0);
+#elif defined MAC_OS_X
+  p_file_id->ino = (uint64_t) p_stat->st_data.st_ino;
+  p_file_id->mtime_nsec = (int64_t) p_stat->st_data.st_mtimespec.tv_nsec;
+  p_file_id->ctime_nsec = (int64_t) p_stat->st_data.st_ctimespec.tv_nsec;
+#else
+  p_file_id->ino = (uint64_t) p_stat->st_data.st_ino;
+  p_file_id->mtime_nsec = (int64_t) p_stat->st_data.st_mtim.tv_nsec;
+  p_file_id->ctime_nsec = (int64_t) p_stat->st_data.st_ctim.tv_nsec;
+#endif
+}
+
+unsigned char is_verified_in_cache(
+  st_verify_cache* p_cache,
+  const st_verify_cache_file_id* p_file_id,
+  MHL_HASH_TYPE hash_type,
+  const char* u8str_hash_sum)
+{
+  char digest[VERIFY_CACHE_DIGEST_MAX_SZ];
+  uint8_t digest_sz;
+  const st_verify_cache_entry* p_entry;
+
+  if (u8str_hash_sum == 0 ||
+      !aux_make_cache_digest(u8str_hash_sum, digest, &digest_sz))
+  {
+    return 0;
+  }
+
+  p_entry = aux_find_entry(p_cache, p_file_id);
+  if (p_entry == 0 || p_entry->hash_type != hash_type ||
+      memcmp(&p_entry->file_id, p_file_id, sizeof(*p_file_id)) != 0 ||
+      p_entry->digest_sz != digest_sz ||
+      memcmp(p_entry->digest, digest, digest_sz) != 0 ||
+      !aux_is_entry_usable(p_cache, p_entry))
+  {
+    return 0;
+  }
+
+  ++p_cache->hits_num;
+  return 1;
+}
+
+int put_verified_to_cache(
+  st_verify_cache* p_cache,
+  const st_verify_cache_file_id* p_file_id,
+  MHL_HASH_TYPE hash_type,
+  const char* u8str_hash_sum)
+{
+  st_verify_cache_entry entry;
+  st_verify_cache_entry* p_entry;
+
+  if (p_file_id->mtime >= p_cache->start_time ||
+      p_file_id->ctime >= p_cache->start_time)
+  {
+    // the file may be changed again within the same second 
+    remove_from_verify_cache(p_cache, p_file_id);
+    return 0;
+  }
+
+  memset(&entry, 0, sizeof(entry));
+  if (u8str_hash_sum == 0 ||
+      !aux_make_cache_digest(u8str_hash_sum, entry.digest, &entry.digest_sz))
+  {
+    remove_from_verify_cache(p_cache, p_file_id);
+    return 0;
+  }
+
+  entry.file_id = *p_file_id;
+  entry.verified_at = p_cache->start_time;
+  entry.hash_type = (uint8_t) hash_type;
+
+  p_cache->is_changed = 1;
+  p_entry = aux_find_entry(p_cache, p_file_id);
+  if (p_entry != 0)
+  {
+    *p_entry = entry;
+    return 0;
+  }
+
+  return aux_add_entry(p_cache, &entry);
+}
+
+void remove_from_verify_cache(
+  st_verify_cache* p_cache,
+  const st_verify_cache_file_id* p_file_id)
+{
+  st_verify_cache_entry* p_entry;
+
+  p_entry = aux_find_entry(p_cache, p_file_id);
+  if (p_entry != 0 && p_entry->hash_type != MHL_HT_UNRECOGNIZED)
+  {
+    // the slot is kept, the entry is dropped on save
+    p_entry->hash_type = MHL_HT_UNRECOGNIZED;
+    p_cache->is_changed = 1;
+  }
+}
@@ -0,0 +1,153 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: verify_cache.h
+ *
+ * Cache of verification results.
+ * A file, which passed verification, is remembered by its identity:
+ * device, inode, size, modification and status change times. While the
+ * identity is not changed and the expected digest is the same, the file
+ * is not read again. The cache is a local file, it is not portable 
+ * between hosts.
+ */
+
+#ifndef _MHL_TOOLS_MHL_VERIFY_MHL_VERIFICATION_VERIFY_CACHE_H_
+#define _MHL_TOOLS_MHL_VERIFY_MHL_VERIFICATION_VERIFY_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+#include <generics/filesystem_handlers/public_interface.h>
+#include <mhltools_common/mhl_types.h>
+
+// digests longer than this are not cached
+#define VERIFY_CACHE_DIGEST_MAX_SZ 64
+
+//
+// Identity of file, the cache is keyed by device, inode and path hash
+//
+typedef struct _st_verify_cache_file_id
+{
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t path_hash; // XXH64 of the absolute path where inodes are not stable
+  uint64_t file_sz;
+  int64_t mtime;
+  int64_t mtime_nsec;
+  int64_t ctime;
+  int64_t ctime_nsec;
+} st_verify_cache_file_id;
+
+//
+// Entry of the cache, it is stored in the cache file as is
+//
+typedef struct _st_verify_cache_entry
+{
+  st_verify_cache_file_id file_id;
+  int64_t verified_at; // seconds since epoch
+  uint8_t hash_type;   // MHL_HT_UNRECOGNIZED in removed entries
+  uint8_t digest_sz;
+  uint8_t reserved[6];
+  char digest[VERIFY_CACHE_DIGEST_MAX_SZ]; // lowercase, not zero-terminated
+} st_verify_cache_entry;
+
+typedef struct _st_verify_cache
+{
+  wchar_t* cache_wpath;
+
+  st_verify_cache_entry* entries;
+  size_t entries_num;
+  size_t entries_capacity;
+
+  // open-addressing table, slot keeps index of entry + 1, 0 if empty;
+  // number of slots is a power of 2
+  uint32_t* slots;
+  size_t slots_num;
+
+  // entries verified max_age or more seconds ago are not used, 
+  // negative value: not limited
+  long long max_age;
+  long long start_time;
+
+  unsigned char is_changed;
+  size_t hits_num;
+} st_verify_cache;
+
+/* Loads cache from the file. Missing file means empty cache, 
+ * damaged or foreign file is reported and replaced on save.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int load_verify_cache(
+  st_verify_cache* p_cache,
+  const wchar_t* cache_wpath,
+  long long max_age);
+
+/* Writes the cache into its file if it is changed. The file is 
+ * replaced atomically. Expired entries are dropped.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int save_verify_cache(st_verify_cache* p_cache);
+
+void free_verify_cache(st_verify_cache* p_cache);
+
+/* Fills identity of file from its stat data.
+ */
+void make_verify_cache_file_id(
+  const wchar_t* abs_wpath,
+  const st_mhlosi_stat* p_stat,
+  st_verify_cache_file_id* p_file_id);
+
+/* @return 1 if the file with this identity passed verification against 
+ *         the same digest and the entry is not expired, 0 otherwise.
+ */
+unsigned char is_verified_in_cache(
+  st_verify_cache* p_cache,
+  const st_verify_cache_file_id* p_file_id,
+  MHL_HASH_TYPE hash_type,
+  const char* u8str_hash_sum);
+
+/* Remembers file, which passed verification. Identity must be taken 
+ * before the file is read. Files changed during the current second are 
+ * not remembered, since next change may leave their identity the same.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int put_verified_to_cache(
+  st_verify_cache* p_cache,
+  const st_verify_cache_file_id* p_file_id,
+  MHL_HASH_TYPE hash_type,
+  const char* u8str_hash_sum);
+
+/* Forgets file, e.g. after failed verification.
+ */
+void remove_from_verify_cache(
+  st_verify_cache* p_cache,
+  const st_verify_cache_file_id* p_file_id);
+
+#endif //_MHL_TOOLS_MHL_VERIFY_MHL_VERIFICATION_VERIFY_CACHE_H_
@@ -0,0 +1,235 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: verify_plan.c
+ *
+ * Stat-once plan of verification of MHL content.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/os_threads.h>
+#include <generics/filesystem_handlers/public_interface.h>
+
+#include "verify_plan.h"
+
+// stat is bound by latency of the file system rather than by CPU,
+// especially on network volumes, so more jobs than processors are used
+#define VERIFY_PLAN_DEFAULT_JOBS 16
+#define VERIFY_PLAN_MAX_JOBS 64
+// items taken by a job at once
+#define VERIFY_PLAN_CHUNK_SZ 64
+
+typedef struct _st_verify_plan_prefetch
+{
+  mhlosi_mutex mutex;
+  const st_mhl_file_wcontent* p_wcontent;
+  st_verify_plan_item* items;
+  size_t items_num;
+  size_t next_item_no; // the first item, which is not taken by a job yet
+} st_verify_plan_prefetch;
+
+static void
+aux_stat_plan_item(
+  const st_mhl_file_check_wdata* p_check_witem,
+  st_verify_plan_item* p_plan_item)
+{
+  st_mhlosi_stat wfl_stat;
+
+  p_plan_item->stat_res = 
+    get_wfile_stat_data(p_check_witem->abs_item_wfilename, &wfl_stat);
+  if (p_plan_item->stat_res == 0)
+  {
+    make_verify_cache_file_id(p_check_witem->abs_item_wfilename, &wfl_stat,
+                              &p_plan_item->file_id);
+  }
+  else
+  {
+    // missing files come first, in the order of MHL file
+    memset(&p_plan_item->file_id, 0, sizeof(p_plan_item->file_id));
+  }
+}
+
+static void
+aux_prefetch_job(void* arg)
+{
+  size_t i;
+  size_t beg;
+  size_t end;
+  st_verify_plan_prefetch* p_prefetch = (st_verify_plan_prefetch*) arg;
+
+  for (;;)
+  {
+    mhlosi_mutex_lock(&p_prefetch->mutex);
+    beg = p_prefetch->next_item_no;
+    end = 
+      p_prefetch->items_num - beg > VERIFY_PLAN_CHUNK_SZ ? 
+        beg + VERIFY_PLAN_CHUNK_SZ : p_prefetch->items_num;
+    p_prefetch->next_item_no = end;
+    mhlosi_mutex_unlock(&p_prefetch->mutex);
+
+    if (beg == end)
+    {
+      break;
+    }
+
+    // each job writes only the items it has taken
+    for (i = beg; i < end; ++i)
+    {
+      p_prefetch->items[i].item_no = i;
+      aux_stat_plan_item(&p_prefetch->p_wcontent->check_witems[i], 
+                         &p_prefetch->items[i]);
+    }
+  }
+}
+
+static int
+aux_compare_plan_items(const void* p1, const void* p2)
+{
+  const st_verify_plan_item* p_item1 = (const st_verify_plan_item*) p1;
+  const st_verify_plan_item* p_item2 = (const st_verify_plan_item*) p2;
+
+  if (p_item1->file_id.mtime != p_item2->file_id.mtime)
+  {
+    return p_item1->file_id.mtime < p_item2->file_id.mtime ? -1 : 1;
+  }
+
+  // order of MHL file for equal times
+  return 
+    p_item1->item_no < p_item2->item_no ? -1 : 
+      (p_item1->item_no > p_item2->item_no ? 1 : 0);
+}
+
+int make_verify_plan(
+  const st_mhl_file_wcontent* p_wcontent,
+  unsigned int jobs,
+  st_verify_plan* p_plan)
+{
+  int res;
+  size_t i;
+  unsigned int started_jobs = 0;
+  mhlosi_thread* threads = NULL;
+  st_verify_plan_prefetch prefetch;
+
+  if (p_wcontent == 0 || p_plan == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  memset(p_plan, 0, sizeof(*p_plan));
+  p_plan->items = 
+    (st_verify_plan_item*) calloc(p_wcontent->check_witems_num + 1, 
+                                  sizeof(st_verify_plan_item));
+  if (p_plan->items == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  p_plan->items_num = p_wcontent->check_witems_num;
+
+  if (jobs == 0)
+  {
+    jobs = VERIFY_PLAN_DEFAULT_JOBS;
+  }
+  if (jobs > VERIFY_PLAN_MAX_JOBS)
+  {
+    jobs = VERIFY_PLAN_MAX_JOBS;
+  }
+  if (jobs > (p_plan->items_num + VERIFY_PLAN_CHUNK_SZ - 1) / 
+               VERIFY_PLAN_CHUNK_SZ)
+  {
+    // threads are not worth starting for a few chunks
+    jobs = 
+      (unsigned int) ((p_plan->items_num + VERIFY_PLAN_CHUNK_SZ - 1) / 
+                        VERIFY_PLAN_CHUNK_SZ);
+  }
+
+  memset(&prefetch, 0, sizeof(prefetch));
+  prefetch.p_wcontent = p_wcontent;
+  prefetch.items = p_plan->items;
+  prefetch.items_num = p_plan->items_num;
+
+  res = mhlosi_mutex_init(&prefetch.mutex);
+  if (res != 0)
+  {
+    free_verify_plan(p_plan);
+    return res;
+  }
+
+  if (jobs > 1)
+  {
+    // failure to allocate threads only makes the prefetch serial
+    threads = (mhlosi_thread*) calloc(jobs, sizeof(mhlosi_thread));
+  }
+
+  // the calling thread is one of the jobs
+  for (i = 1; i < jobs && threads != NULL; ++i)
+  {
+    if (mhlosi_thread_create(&threads[started_jobs], aux_prefetch_job, 
+                             &prefetch) == 0)
+    {
+      ++started_jobs;
+    }
+  }
+
+  aux_prefetch_job(&prefetch);
+
+  for (i = 0; i < started_jobs; ++i)
+  {
+    mhlosi_thread_join(threads[i]);
+  }
+
+  free(threads);
+  mhlosi_mutex_destroy(&prefetch.mutex);
+
+  for (i = 0; i < p_plan->items_num; ++i)
+  {
+    if (p_plan->items[i].stat_res == 0)
+    {
+      p_plan->total_sz += p_plan->items[i].file_id.file_sz;
+    }
+    else
+    {
+      ++p_plan->failed_num;
+    }
+  }
+
+  qsort(p_plan->items, p_plan->items_num, sizeof(st_verify_plan_item),
+        aux_compare_plan_items);
+  return 0;
+}
+
+void free_verify_plan(st_verify_plan* p_plan)
+{
+  if (p_plan == 0)
+  {
+    return;
+  }
+
+  free(p_plan->items);
+  memset(p_plan, 0, sizeof(*p_plan));
+}
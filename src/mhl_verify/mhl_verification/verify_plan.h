@@ -0,0 +1,74 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: verify_plan.h
+ *
+ * Plan of verification of MHL content: every file is stat'ed once, 
+ * by several jobs in parallel, before any file is read. The results are
+ * used for progress totals, for the order of verification, for checks 
+ * of file sizes and existence, and as identities for the verification 
+ * cache.
+ */
+
+#ifndef _MHL_TOOLS_MHL_VERIFY_MHL_VERIFICATION_VERIFY_PLAN_H_
+#define _MHL_TOOLS_MHL_VERIFY_MHL_VERIFICATION_VERIFY_PLAN_H_
+
+#include <stddef.h>
+
+#include <parsemhl/mhl_file_handlers.h>
+#include <mhl_verify/mhl_verification/verify_cache.h>
+
+typedef struct _st_verify_plan_item
+{
+  size_t item_no;  // index of item in MHL content
+  int stat_res;    // result of stat of the file, 0 in case of success
+  st_verify_cache_file_id file_id; // valid if stat_res is 0
+} st_verify_plan_item;
+
+typedef struct _st_verify_plan
+{
+  // items in the order of verification: by modification time of files
+  st_verify_plan_item* items;
+  size_t items_num;
+
+  unsigned long long total_sz; // total size of existing files
+  size_t failed_num;           // number of files, which can't be stat'ed
+} st_verify_plan;
+
+/* Stats all files of MHL content and sorts them by modification time.
+ * Files, which can't be stat'ed, are kept in the plan with stat_res set.
+ * @param jobs - number of parallel jobs, 0 means default
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int make_verify_plan(
+  const st_mhl_file_wcontent* p_wcontent,
+  unsigned int jobs,
+  st_verify_plan* p_plan);
+
+void free_verify_plan(st_verify_plan* p_plan);
+
+#endif //_MHL_TOOLS_MHL_VERIFY_MHL_VERIFICATION_VERIFY_PLAN_H_
@@ -23,7 +23,9 @@
  SOFTWARE.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <errno.h>
 
 #include <facade_info/error_codes.h>
@@ -31,6 +33,7 @@
 #include <generics/char_conversions.h>
 #include <generics/std_funcs_os_anonymizer.h>
 #include <generics/filesystem_handlers/public_interface.h>
+#include <generics/memory_management.h>
 
 #include <mhltools_common/hashing.h>
 
@@ -46,7 +49,8 @@
 typedef enum _en_verify_modes
 {
   MD_NOT_SET = 0,
-  MD_1_CHECK_MHL = 1
+  MD_1_CHECK_MHL = 1,
+  MD_2_DISCOVER_ALL = 2
 } en_verify_modes;
 
 typedef struct _st_options
@@ -96,6 +100,55 @@ void free_st_options(st_options* p_opt)
   return;
 }
 
+// Parses age as number of seconds, optionally followed by 
+// 's', 'm', 'h' or 'd' suffix.
+// returns in case of success: 0
+//         in case of failure: error code
+static
+int parse_age(const char* age_str, long long* p_age)
+{
+  long long age;
+  char* end;
+
+  if (age_str == NULL || !isdigit((unsigned char) age_str[0]))
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  errno = 0;
+  age = strtoll(age_str, &end, 10);
+  if (errno != 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  switch (*end)
+  {
+  case '\0':
+  case 's':
+    break;
+  case 'm':
+    age *= 60;
+    break;
+  case 'h':
+    age *= 60 * 60;
+    break;
+  case 'd':
+    age *= 24 * 60 * 60;
+    break;
+  default:
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (*end != '\0' && end[1] != '\0')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  *p_age = age;
+  return 0;
+}
+
 // returns in case of success: 0
 //         in case of failure: error code, and print error message to stderr
 int parse_mhlverify_params(
@@ -172,6 +225,10 @@ int parse_mhlverify_params(
         opts->verify.existence = 1;
         opts->mode = MD_1_CHECK_MHL;
       }
+      else if (opts->mode == MD_2_DISCOVER_ALL)
+      {
+        opts->verify.existence = 1;
+      }
       else
       {
         print_error(
@@ -222,6 +279,13 @@ int parse_mhlverify_params(
     case NOT_OPT:
        // (opts->mode == MD_NOT_SET) and NOT_OPT, which means mode 1,
        // or opts->mode == MD_1_CHECK_MHL
+      if (opts->mode == MD_2_DISCOVER_ALL)
+      {
+        print_error(
+          "Arguments error: "
+          "Files can't be passed together with the '--discover-all' option\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
 
       // files name specification is started"
       // stop params parsing
@@ -233,6 +297,192 @@ int parse_mhlverify_params(
       opts->verify.continue_on_error = 1;
       break;
 
+    case OPT_I:
+      opts->verify.use_index = 1;
+      break;
+
+    case OPT_INDEX_DIR:
+      res1 = recognise_option(argv[++i]);
+      if (res1 != NOT_OPT || opts->verify.index_wdir != NULL) 
+      {
+        print_error(
+          "Arguments error: "
+          "There must be one folder name after the '--index-dir' option\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+
+      opts->verify.index_wdir = 
+        strdup_and_convert_composed_from_locale_to_wchar(
+          argv[i], p_cs, &ires);
+
+      if (opts->verify.index_wdir == NULL)
+      {
+        return ires == 0 ? ERRCODE_OUT_OF_MEM : ires;
+      }          
+
+      make_wpath_os_specific(opts->verify.index_wdir);
+      opts->verify.use_index = 1;
+      break;
+
+    case OPT_DISCOVER_ALL:
+      if (opts->verify.f_option || opts->mode == MD_2_DISCOVER_ALL)
+      {
+        print_error(
+          "Arguments error: "
+          "The '--discover-all' option can't be used together with "
+          "the '-f' option or repeated\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+
+      res1 = recognise_option(argv[++i]);
+      if (res1 != NOT_OPT) 
+      {
+        print_error(
+          "Arguments error: "
+          "There must be folder name after the '--discover-all' option\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+
+      opts->verify.discover_root_wdir = 
+        strdup_and_convert_composed_from_locale_to_wchar(
+          argv[i], p_cs, &ires);
+
+      if (opts->verify.discover_root_wdir == NULL)
+      {
+        return ires == 0 ? ERRCODE_OUT_OF_MEM : ires;
+      }          
+
+      make_wpath_os_specific(opts->verify.discover_root_wdir);
+      opts->mode = MD_2_DISCOVER_ALL;
+      break;
+
+    case OPT_CACHE:
+      res1 = recognise_option(argv[++i]);
+      if (res1 != NOT_OPT || opts->verify.cache_wpath != NULL) 
+      {
+        print_error(
+          "Arguments error: "
+          "There must be one file name after the '--cache' option\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+
+      opts->verify.cache_wpath = 
+        strdup_and_convert_composed_from_locale_to_wchar(
+          argv[i], p_cs, &ires);
+
+      if (opts->verify.cache_wpath == NULL)
+      {
+        return ires == 0 ? ERRCODE_OUT_OF_MEM : ires;
+      }          
+
+      make_wpath_os_specific(opts->verify.cache_wpath);
+      break;
+
+    case OPT_MAX_CACHE_AGE:
+      if (opts->verify.max_cache_age >= 0 ||
+          parse_age(argv[++i], &opts->verify.max_cache_age) != 0) 
+      {
+        print_error(
+          "Arguments error: "
+          "There must be one age, e.g. '7d', after the '--max-cache-age' "
+          "option\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      break;
+
+    case OPT_ALL_HASHES:
+      opts->verify.all_hashes = 1;
+      break;
+
+    case OPT_SLOW_READ:
+      if (i + 1 >= argc || 
+          parse_slow_read_speed(argv[i + 1], 
+                                &opts->common.logging_data.read_monitor) != 0)
+      {
+        print_error(
+          "Arguments error: "
+          "A positive speed in MB/s must follow the '--slow-read' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      ++i;
+      break;
+
+    case OPT_SLOW_READ_MS:
+      if (i + 1 >= argc || 
+          parse_slow_read_ms(argv[i + 1], 
+                             &opts->common.logging_data.read_monitor) != 0)
+      {
+        print_error(
+          "Arguments error: "
+          "A positive number of milliseconds must follow the "
+          "'--slow-read-ms' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      ++i;
+      break;
+
+    case OPT_REPORT:
+      if (i + 1 >= argc || opts->common.report_path != NULL)
+      {
+        print_error(
+          "Arguments error: "
+          "There must be one file name after the '--report' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      opts->common.report_path = argv[++i];
+      break;
+
+    case OPT_REPORT_FORMAT:
+      if (i + 1 >= argc || 
+          parse_report_format(argv[i + 1], &opts->common.report_format) != 0)
+      {
+        print_error(
+          "Arguments error: "
+          "'jsonl' or 'csv' must follow the '--report-format' option.\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+      ++i;
+      break;
+
+    case OPT_ROOT:
+      res1 = recognise_option(argv[++i]);
+      if (res1 != NOT_OPT) 
+      {
+        print_error(
+          "Arguments error: "
+          "There must be folder name after the '--root' option\n");
+        return ERRCODE_WRONG_ARGUMENTS;
+      }
+
+      if (opts->verify.root_wdirs_cnt == opts->verify.root_wdirs_capacity)
+      {
+        ires = increase_allocated_memory(
+          (void**)&opts->verify.root_wdirs,
+          &opts->verify.root_wdirs_capacity,
+          opts->verify.root_wdirs_capacity ? 
+            opts->verify.root_wdirs_capacity * 2 : 2,
+          sizeof(wchar_t*));
+
+        if (ires != 0)
+        {
+          return ires;
+        }
+      }
+
+      opts->verify.root_wdirs[opts->verify.root_wdirs_cnt] = 
+        strdup_and_convert_composed_from_locale_to_wchar(
+          argv[i], p_cs, &ires);
+
+      if (opts->verify.root_wdirs[opts->verify.root_wdirs_cnt] == NULL)
+      {
+        return ires == 0 ? ERRCODE_OUT_OF_MEM : ires;
+      }          
+
+      make_wpath_os_specific(
+        opts->verify.root_wdirs[opts->verify.root_wdirs_cnt]);
+      ++opts->verify.root_wdirs_cnt;
+      break;
+
     case NULL_OPT:
     default:
       print_error(
@@ -244,6 +494,51 @@ int parse_mhlverify_params(
     ++i;
   } while (i < argc && (res != NULL_OPT));
 
+  if (opts->verify.max_cache_age >= 0 && opts->verify.cache_wpath == NULL)
+  {
+    print_error(
+      "Arguments error: "
+      "The '--max-cache-age' option can be used only with "
+      "the '--cache' option\n");
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (opts->verify.cache_wpath != NULL && opts->verify.existence)
+  {
+    print_error(
+      "Arguments error: "
+      "The '--cache' option can't be used together with the '-e' option\n");
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (opts->verify.all_hashes && opts->verify.existence)
+  {
+    print_error(
+      "Arguments error: "
+      "The '--all-hashes' option can't be used together with "
+      "the '-e' option\n");
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (opts->verify.root_wdirs_cnt != 0 &&
+      (opts->verify.f_option == 0 || opts->common.files_argv_index != 0))
+  {
+    print_error(
+      "Arguments error: "
+      "The '--root' option can be used only with the '-f' option "
+      "and without files\n");
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (opts->verify.root_wdirs_cnt != 0 && opts->verify.cache_wpath != NULL)
+  {
+    print_error(
+      "Arguments error: "
+      "The '--cache' option can't be used together with "
+      "the '--root' option\n");
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
   return 0; 
 }
 
@@ -251,6 +546,7 @@ int run_mhl_verify(int argc, const char * argv[])
 {
   st_options opts;
   int res;
+  int report_res;
   st_conversion_settings css;
 
   mhlosi_setlocale();
@@ -288,10 +584,26 @@ int run_mhl_verify(int argc, const char * argv[])
     return res;
   }
 
+  if (opts.common.report_path != NULL)
+  {
+    res = open_file_report(&opts.common.logging_data, opts.common.report_path,
+                           opts.common.report_format);
+    if (res != 0)
+    {
+      free_st_options(&opts);
+      free_st_conversion_settings(&css);
+      return res;
+    }
+  }
+
   if (opts.mode == MD_1_CHECK_MHL)
   {
     res = verify_mhl(argc, argv, &opts.common, &opts.verify, &css);
   }
+  else if (opts.mode == MD_2_DISCOVER_ALL)
+  {
+    res = verify_discovered_mhls(&opts.common, &opts.verify, &css);
+  }
   else // opts->mode == MD_NOT_SET
   {
     // Really we should not come here after parameters parsing
@@ -299,6 +611,12 @@ int run_mhl_verify(int argc, const char * argv[])
     mhlverify_usage();
     res = ERRCODE_UNKNOWN_MODE;
   }
+
+  report_res = close_file_report(&opts.common.logging_data);
+  if (res == 0)
+  {
+    res = report_res;
+  }
   
   free_st_options(&opts);
   free_st_conversion_settings(&css);
@@ -40,17 +40,28 @@ init_mhl_verify_options(st_mhl_verify_options* p_mvo)
   }
   
   memset(p_mvo, 0, sizeof(*p_mvo) / sizeof(char));
+  p_mvo->max_cache_age = -1;
   return 0;
 }
 
 void
 fini_mhl_verify_options(st_mhl_verify_options* p_mvo)
 {
+  size_t i;
+
   if (p_mvo == 0)
   {
     return;
   }
   
   free(p_mvo->f_wmhl);
+  free(p_mvo->index_wdir);
+  free(p_mvo->discover_root_wdir);
+  free(p_mvo->cache_wpath);
+  for (i = 0; i < p_mvo->root_wdirs_cnt; ++i)
+  {
+    free(p_mvo->root_wdirs[i]);
+  }
+  free(p_mvo->root_wdirs);
   memset(p_mvo, 0, sizeof(*p_mvo) / sizeof(char));
 }
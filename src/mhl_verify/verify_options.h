@@ -33,6 +33,16 @@ typedef struct _st_mhl_verify_options
   unsigned char f_option;
   unsigned char continue_on_error;
   wchar_t* f_wmhl;  
+  unsigned char use_index;
+  wchar_t* index_wdir; // NULL: index is placed next to MHL file
+  wchar_t* discover_root_wdir; // verify all MHL files in this folder
+  wchar_t* cache_wpath; // NULL: verification results are not cached
+  long long max_cache_age; // in seconds, negative: not limited
+  unsigned char all_hashes; // check all digests, not only the fastest one
+  // copies of the MHL file's folder, verified instead of it in parallel
+  wchar_t** root_wdirs;
+  size_t root_wdirs_cnt;
+  size_t root_wdirs_capacity;
 } st_mhl_verify_options;
 
 int
@@ -34,6 +34,10 @@ typedef struct _st_controlling_data
   int files_argv_index;
   unsigned char stop_on_error;
   unsigned char use_sequences;
+
+  // report of results, see report_writer.h
+  const char* report_path; // NULL - no report
+  REPORT_FORMAT report_format;
 } st_controlling_data;
 
 #endif // _MHL_TOOLS_MHLTOOLS_COMMON_CONTROLLING_DATA_H_
@@ -24,66 +24,172 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <wchar.h>
 #include <ctype.h>
 
 #include <facade_info/error_codes.h>
 #include <generics/std_funcs_os_anonymizer.h>
+#include <generics/error_output.h>
 #include <mhltools_common/logging.h>
 
 #include <mhltools_common/files_data.h>
 
+// file names from input, which are shorter, are not copied to the heap
+#define INPUT_FILENAME_BUF_SZ 1024
+
+/* Allocates zeroed memory in the arena, or on the heap if arena is NULL
+ */
+static
+void*
+aux_alloc_data(st_memory_arena* p_arena, size_t sz)
+{
+  void* data;
+
+  // empty string for NULL hash
+  if (sz == 0)
+  {
+    sz = 1;
+  }
+
+  if (p_arena == NULL)
+  {
+    return calloc(sz, sizeof(char));
+  }
+
+  data = memory_arena_alloc(p_arena, sz);
+  if (data != NULL)
+  {
+    memset(data, 0, sz);
+  }
+  return data;
+}
+
+/* Parses size and last modification date of file, which may follow
+ * the hash value: " size=SIZE mtime=YYYY-MM-DDThh:mm:ssZ"
+ */
+static
 int
-fill_data_from_input(
+aux_fill_stat_data_from_input(
+  const char* input_data_pointer, 
+  st_file_data_ext* file_data,
+  st_memory_arena* p_arena)
+{
+  const char* date_format = "dddd-dd-ddTdd:dd:ddZ";
+  char* end;
+  unsigned int i;
+
+  if (*input_data_pointer == '\0' || *input_data_pointer == '\n' ||
+      *input_data_pointer == '\r')
+  {
+    return 0;
+  }
+
+  if (strncmp(input_data_pointer, " size=", 6) != 0 || 
+      isdigit((unsigned char)input_data_pointer[6]) == 0)
+  {
+    print_error("Wrong input format: unexpected symbol after message-digest");
+    return ERRCODE_WRONG_INPUT_FORMAT;
+  }
+
+  file_data->file_sz = mhlosi_strtoull(input_data_pointer + 6, &end, 10);
+  if (strncmp(end, " mtime=", 7) != 0)
+  {
+    print_error("Wrong input format: must be ' mtime=' after size");
+    return ERRCODE_WRONG_INPUT_FORMAT;
+  }
+  input_data_pointer = end + 7;
+
+  for (i = 0; i < MHL_DATE_LENGTH; ++i)
+  {
+    if (date_format[i] == 'd' ? 
+          isdigit((unsigned char)input_data_pointer[i]) == 0 :
+          input_data_pointer[i] != date_format[i])
+    {
+      print_error("Wrong input format: mtime must be a date in format "
+                  "YYYY-MM-DDThh:mm:ssZ");
+      return ERRCODE_WRONG_INPUT_FORMAT;
+    }
+  }
+
+  if (input_data_pointer[MHL_DATE_LENGTH] != '\0' &&
+      input_data_pointer[MHL_DATE_LENGTH] != '\n' &&
+      input_data_pointer[MHL_DATE_LENGTH] != '\r')
+  {
+    print_error("Wrong input format: unexpected symbol after mtime");
+    return ERRCODE_WRONG_INPUT_FORMAT;
+  }
+
+  file_data->lastmodificationdate_str = 
+    (char*) aux_alloc_data(p_arena, MHL_DATE_LENGTH + 1);
+  if (file_data->lastmodificationdate_str == NULL)
+  {
+    error_printf("Out of memory.\n");
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  // We have already '\0' at the end of string due to zeroed memory
+  memcpy(file_data->lastmodificationdate_str, input_data_pointer, 
+         MHL_DATE_LENGTH);
+  return 0;
+}
+
+static
+int
+aux_fill_data_from_input(
   const char* input_buf, 
   st_file_data_ext* file_data,
+  st_memory_arena* p_arena,
   st_conversion_settings* p_cs)
 {
   const char* input_data_pointer;
   const char* input_data_pointer2;
   unsigned int i=0;
+  char loc_orig_fn_buf[INPUT_FILENAME_BUF_SZ];
   char* loc_orig_fn;
+  wchar_t* orig_wfilename;
   size_t worig_fn_sz;
   int res;
 
   input_data_pointer = input_buf;
 
-  if (strncmp((const char*)MD5_HASH_SIGN, input_data_pointer,
+  if (mhlosi_strncasecmp((const char*)MD5_HASH_SIGN, input_data_pointer,
               MD5_HASH_SIGN_SZ) == 0)
   {
     file_data->major_hash.hash_type = MHL_HT_MD5;
     file_data->major_hash.hash_type_str = MD5_HASH_SIGN_SMALL;
     input_data_pointer += MD5_HASH_SIGN_SZ;
   }
-  else if (strncmp((const char*)SHA1_HASH_SIGN, input_data_pointer,
+  else if (mhlosi_strncasecmp((const char*)SHA1_HASH_SIGN, input_data_pointer,
            SHA1_HASH_SIGN_SZ) == 0)
   {
     file_data->major_hash.hash_type = MHL_HT_SHA1;
     file_data->major_hash.hash_type_str = SHA1_HASH_SIGN_SMALL;
     input_data_pointer += SHA1_HASH_SIGN_SZ;
   }
-  else if (strncmp((const char*)XXHASH64BE_HASH_SIGN, input_data_pointer,
+  else if (mhlosi_strncasecmp((const char*)XXHASH64BE_HASH_SIGN, input_data_pointer,
                    XXHASH64BE_HASH_SIGN_SZ) == 0)
   {
       file_data->major_hash.hash_type = MHL_HT_XXHASH64BE;
       file_data->major_hash.hash_type_str = XXHASH64BE_HASH_SIGN_SMALL;
       input_data_pointer += XXHASH64BE_HASH_SIGN_SZ;
   }
-  else if (strncmp((const char*)XXHASH64_HASH_SIGN, input_data_pointer,
+  else if (mhlosi_strncasecmp((const char*)XXHASH64_HASH_SIGN, input_data_pointer,
                    XXHASH64_HASH_SIGN_SZ) == 0)
   {
       file_data->major_hash.hash_type = MHL_HT_XXHASH64;
       file_data->major_hash.hash_type_str = XXHASH64_HASH_SIGN_SMALL;
       input_data_pointer += XXHASH64_HASH_SIGN_SZ;
   }
-  else if (strncmp((const char*)XXHASH_HASH_SIGN, input_data_pointer,
+  else if (mhlosi_strncasecmp((const char*)XXHASH_HASH_SIGN, input_data_pointer,
                    XXHASH_HASH_SIGN_SZ) == 0)
   {
       file_data->major_hash.hash_type = MHL_HT_XXHASH;
       file_data->major_hash.hash_type_str = XXHASH_HASH_SIGN_SMALL;
       input_data_pointer += XXHASH_HASH_SIGN_SZ;
   }
-  else if (strncmp((const char*)NULL_HASH_SIGN, input_data_pointer,
+  else if (mhlosi_strncasecmp((const char*)NULL_HASH_SIGN, input_data_pointer,
                    NULL_HASH_SIGN_SZ) == 0)
   {
     file_data->major_hash.hash_type = MHL_HT_NULL;
@@ -117,17 +223,24 @@ fill_data_from_input(
     return ERRCODE_WRONG_INPUT_FORMAT;
   }
 
-  loc_orig_fn = (char*)calloc(
-    input_data_pointer2 - input_data_pointer +1, sizeof(char));
-  if (loc_orig_fn == NULL)
+  if (input_data_pointer2 - input_data_pointer < INPUT_FILENAME_BUF_SZ)
   {
-    fprintf(stderr, "Out of memory.\n");
-    return ERRCODE_OUT_OF_MEM;
+    loc_orig_fn = loc_orig_fn_buf;
+  }
+  else
+  {
+    loc_orig_fn = (char*)malloc(
+      input_data_pointer2 - input_data_pointer + 1);
+    if (loc_orig_fn == NULL)
+    {
+      error_printf("Out of memory.\n");
+      return ERRCODE_OUT_OF_MEM;
+    }
   }
 
-  // We have already '\0' at the end of string due to calloc
-  strncpy(loc_orig_fn, input_data_pointer,
-          input_data_pointer2 - input_data_pointer);
+  memcpy(loc_orig_fn, input_data_pointer,
+         input_data_pointer2 - input_data_pointer);
+  loc_orig_fn[input_data_pointer2 - input_data_pointer] = '\0';
 
   //printf("Orig filename in locale: %s\n", loc_orig_fn);
   
@@ -141,12 +254,38 @@ fill_data_from_input(
 
   if (res != 0)
   {
-    fprintf(stderr, "Cannot convert filename '%s' from locale to wchar.\n", 
-            loc_orig_fn);
-    free(loc_orig_fn);
+    error_printf("Cannot convert filename '%s' from locale to wchar.\n", 
+                 loc_orig_fn);
+    if (loc_orig_fn != loc_orig_fn_buf)
+    {
+      free(loc_orig_fn);
+    }
     return res;
   }
 
+  if (p_arena != NULL)
+  {
+    orig_wfilename = file_data->orig_wfilename;
+    file_data->orig_wfilename = 
+      (wchar_t*) memory_arena_alloc(p_arena, 
+                                    (worig_fn_sz + 1) * sizeof(wchar_t));
+    if (file_data->orig_wfilename != NULL)
+    {
+      wmemcpy(file_data->orig_wfilename, orig_wfilename, worig_fn_sz + 1);
+    }
+    free(orig_wfilename);
+
+    if (file_data->orig_wfilename == NULL)
+    {
+      if (loc_orig_fn != loc_orig_fn_buf)
+      {
+        free(loc_orig_fn);
+      }
+      error_printf("Out of memory.\n");
+      return ERRCODE_OUT_OF_MEM;
+    }
+  }
+
   //printf("Orig filename in wchar_t: %ls\n", file_data->orig_wfilename);
   
   make_wpath_os_specific(file_data->orig_wfilename);
@@ -154,7 +293,10 @@ fill_data_from_input(
   //printf("Orig filename in wchar_t after os_specific: %ls\n", 
   //       file_data->orig_wfilename);
   
-  free(loc_orig_fn);
+  if (loc_orig_fn != loc_orig_fn_buf)
+  {
+    free(loc_orig_fn);
+  }
 
   input_data_pointer = input_data_pointer2 + 1;
   if (*input_data_pointer != '=')
@@ -197,12 +339,12 @@ fill_data_from_input(
   }
 
   file_data->major_hash.hash_sum =
-    (char*)calloc(file_data->major_hash.hash_sum_sz, sizeof(char));
+    (char*)aux_alloc_data(p_arena, file_data->major_hash.hash_sum_sz);
 
   if (file_data->major_hash.hash_sum == NULL)
   {
     file_data->major_hash.hash_sum_sz = 0;
-    fprintf(stderr, "Out of memory.\n");
+    error_printf("Out of memory.\n");
     return ERRCODE_OUT_OF_MEM;
   }
   if (file_data->major_hash.hash_sum_sz) {
@@ -214,21 +356,46 @@ fill_data_from_input(
         return ERRCODE_WRONG_INPUT_FORMAT;
       }
     }
-    if (input_data_pointer[file_data->major_hash.hash_sum_sz - 1] != '\0' &&
-        input_data_pointer[file_data->major_hash.hash_sum_sz - 1] != '\n' &&
-        input_data_pointer[file_data->major_hash.hash_sum_sz - 1] != '\r')
-    {
-      print_error("Wrong input format: unexpected symbol after message-digest");
-      return ERRCODE_WRONG_INPUT_FORMAT;
-    }
-    // We have already '\0' at the end of string due to calloc
+    // We have already '\0' at the end of string due to zeroed memory
     strncpy(file_data->major_hash.hash_sum, input_data_pointer,
             file_data->major_hash.hash_sum_sz - 1);
+
+    return 
+      aux_fill_stat_data_from_input(
+        input_data_pointer + file_data->major_hash.hash_sum_sz - 1,
+        file_data, p_arena);
+  }
+
+  // NULL hash: anything after '=' is ignored, except of size and mtime 
+  if (strncmp(input_data_pointer, "size=", 5) == 0)
+  {
+    return 
+      aux_fill_stat_data_from_input(input_data_pointer - 1, file_data, p_arena);
   }
 
   return 0;
 }
 
+int
+fill_data_from_input(
+  const char* input_buf, 
+  st_file_data_ext* file_data,
+  st_conversion_settings* p_cs)
+{
+  return aux_fill_data_from_input(input_buf, file_data, NULL, p_cs);
+}
+
+int
+fill_data_from_input_in_arena(
+  const char* input_buf, 
+  st_file_data_ext* file_data,
+  st_memory_arena* p_arena,
+  st_conversion_settings* p_cs)
+{
+  return aux_fill_data_from_input(input_buf, file_data, p_arena, p_cs);
+}
+
+
 static
 int
 fill_hash_data(st_hash_data* p_data, const char* hash_str,
@@ -245,7 +412,7 @@ fill_hash_data(st_hash_data* p_data, const char* hash_str,
   if (p_data->hash_sum == NULL)
   {
     p_data->hash_sum_sz = 0;
-    fprintf(stderr, "Out of memory.\n");
+    error_printf("Out of memory.\n");
     return ERRCODE_OUT_OF_MEM;
   }
 
@@ -262,90 +429,115 @@ fill_hash_data(st_hash_data* p_data, const char* hash_str,
   return 0;
 }
 
+static int
+aux_hash_type_props(
+  MHL_HASH_TYPE hash_type,
+  unsigned int* p_hash_length,
+  const char** p_hash_sign_small)
+{
+  switch (hash_type)
+  {
+    case MHL_HT_MD5:
+      *p_hash_length = MD5_HASH_LENGTH;
+      *p_hash_sign_small = MD5_HASH_SIGN_SMALL;
+      return 0;
+
+    case MHL_HT_SHA1:
+      *p_hash_length = SHA1_HASH_LENGTH;
+      *p_hash_sign_small = SHA1_HASH_SIGN_SMALL;
+      return 0;
+
+    case MHL_HT_XXHASH:
+      *p_hash_length = XXHASH_HASH_LENGTH;
+      *p_hash_sign_small = XXHASH_HASH_SIGN_SMALL;
+      return 0;
+
+    case MHL_HT_XXHASH64:
+      *p_hash_length = XXHASH64_HASH_LENGTH;
+      *p_hash_sign_small = XXHASH64_HASH_SIGN_SMALL;
+      return 0;
+
+    case MHL_HT_XXHASH64BE:
+      *p_hash_length = XXHASH64BE_HASH_LENGTH;
+      *p_hash_sign_small = XXHASH64BE_HASH_SIGN_SMALL;
+      return 0;
+
+    default:
+      return ERRCODE_WRONG_ARGUMENTS;
+  }
+}
+
 int
-fill_data_directly(
+fill_data_with_hashes(
   const wchar_t* wfilename,
-  const char* md5_hash_str,
-  const char* sha1_hash_str,
-  const char* xx_hash_str,
-  const char* xx64_hash_str,
-  const char* xx64be_hash_str,
+  const MHL_HASH_TYPE* hash_types,
+  const char* const* hash_strs,
+  size_t hashes_num,
   st_file_data_ext* file_data)
-{    
-    int res;
-    const char* hashes[] = {
-        sha1_hash_str,
-        md5_hash_str,
-        xx_hash_str,
-        xx64_hash_str,
-        xx64be_hash_str,
-    };
-    const MHL_HASH_TYPE hash_types[] = {
-        MHL_HT_SHA1,
-        MHL_HT_MD5,
-        MHL_HT_XXHASH,
-        MHL_HT_XXHASH64,
-        MHL_HT_XXHASH64BE,
-    };
-    const unsigned int hash_lengths[] = {
-        SHA1_HASH_LENGTH,
-        MD5_HASH_LENGTH,
-        XXHASH_HASH_LENGTH,
-        XXHASH64_HASH_LENGTH,
-        XXHASH64BE_HASH_LENGTH,
-    };
-    const char* hash_sign_small[] = {
-        SHA1_HASH_SIGN_SMALL,
-        MD5_HASH_SIGN_SMALL,
-        XXHASH_HASH_SIGN_SMALL,
-        XXHASH64_HASH_SIGN_SMALL,
-        XXHASH64BE_HASH_SIGN_SMALL,
-    };
-    
-    size_t count_hashes = sizeof(hashes)/sizeof(hashes[0]);
-    size_t i;
+{
+  int res;
+  size_t i;
+  unsigned int hash_length;
+  const char* hash_sign_small;
+  st_hash_data* p_hash_data;
 
-    if (md5_hash_str == NULL && sha1_hash_str == NULL && xx_hash_str == NULL && xx64_hash_str == NULL && xx64be_hash_str == NULL)
+  if (hashes_num == 0)
+  {
+    print_error("Internal error: fill_data_with_hashes(): no hashes");
+    return ERRCODE_INTERNAL_ERROR;
+  }
+
+  if (hashes_num > 2)
+  {
+    file_data->more_hashes = 
+      (st_hash_data*) calloc(hashes_num - 2, sizeof(st_hash_data));
+    if (file_data->more_hashes == NULL)
     {
-        print_error("Internal error: fill_data_directly(): all hash strings are empty");
-        return ERRCODE_INTERNAL_ERROR;
+      error_printf("Out of memory.\n");
+      return ERRCODE_OUT_OF_MEM;
     }
+    file_data->more_hashes_num = (unsigned int) (hashes_num - 2);
+  }
 
-    //set the first hash that is not NULL
-    //as major hash and the second hash that
-    //is not null as aux hash (if available)
-    for(i = 0; i < count_hashes; ++i) {
-        if(hashes[i] != NULL) {
-            res = fill_hash_data(&file_data->major_hash, hashes[i], hash_types[i],
-                                 hash_lengths[i], hash_sign_small[i]);
-            if (res != 0)
-            {
-                return res;
-            }
-            break;
-        }
+  for (i = 0; i < hashes_num; ++i)
+  {
+    if (i == 0)
+    {
+      p_hash_data = &file_data->major_hash;
     }
-    //set the next non-null hash as aux hash
-    for(i = i+1; i < count_hashes; ++i) {
-        if(hashes[i] != NULL) {
-            res = fill_hash_data(&file_data->aux_hash, hashes[i], hash_types[i],
-                                 hash_lengths[i], hash_sign_small[i]);
-            if (res != 0)
-            {
-                return res;
-            }
-            break;
-        }
+    else if (i == 1)
+    {
+      p_hash_data = &file_data->aux_hash;
     }
-    
-    file_data->orig_wfilename = mhlosi_wstrdup(wfilename);
-    if (file_data->orig_wfilename == NULL)
+    else
     {
-        fprintf(stderr, "Out of memory.\n");
-        return ERRCODE_OUT_OF_MEM;
+      p_hash_data = file_data->more_hashes + (i - 2);
     }
 
-    make_wpath_os_specific(file_data->orig_wfilename);
+    res = aux_hash_type_props(hash_types[i], &hash_length, &hash_sign_small);
+    if (res != 0)
+    {
+      print_error("Internal error: fill_data_with_hashes(): "
+                  "unsupported hash type");
+      return ERRCODE_INTERNAL_ERROR;
+    }
 
-    return 0;
-}
\ No newline at end of file
+    res = fill_hash_data(p_hash_data, hash_strs[i], hash_types[i],
+                         hash_length, hash_sign_small);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+    
+  file_data->orig_wfilename = mhlosi_wstrdup(wfilename);
+  if (file_data->orig_wfilename == NULL)
+  {
+    error_printf("Out of memory.\n");
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  make_wpath_os_specific(file_data->orig_wfilename);
+
+  return 0;
+}
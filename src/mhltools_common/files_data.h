@@ -27,6 +27,7 @@
 #define _MHL_TOOLS_MHLTOOLS_COMMON_FILES_DATA_H_
 
 #include <generics/char_conversions.h>
+#include <generics/memory_management.h>
 #include <generics/filesystem_handlers/public_interface.h>
 #include <mhltools_common/mhl_types.h>
 
@@ -60,6 +61,9 @@
 #define NULL_HASH_SIGN_SMALL "null"
 #define NULL_HASH_SIGN_SZ 4
 
+// date in MHL files: 2011-03-10T07:49:21Z
+#define MHL_DATE_LENGTH 20
+
 /*
 This structure is not used currently, 
 it is a prototype for future to make 
@@ -95,6 +99,9 @@ typedef struct _st_file_data_ext
   char* hashdate_str;
   st_hash_data major_hash;
   st_hash_data aux_hash;
+  // hashes written after the major and aux ones, NULL if there are none
+  st_hash_data* more_hashes;
+  unsigned int more_hashes_num;
 } st_file_data_ext;
 
 typedef struct _st_files_data
@@ -102,24 +109,49 @@ typedef struct _st_files_data
   st_file_data_ext* files_data_array;
   size_t files_data_capacity;
   unsigned int files_data_cnt;
+
+  // strings of files data are allocated in the arena instead of the heap,
+  // files may share date strings then
+  unsigned char is_data_in_arena;
+  st_memory_arena data_arena;
 } st_files_data;
 
 #define INITIAL_FILES_CAPACITY 10
 
+/* Fills file data from line of input: "HASH_TYPE(PATH)= HASH_VALUE",
+ * optionally followed by " size=SIZE mtime=YYYY-MM-DDThh:mm:ssZ". 
+ * If size and mtime are given, lastmodificationdate_str is set.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
 int
 fill_data_from_input(
   const char* input_buf, 
   st_file_data_ext* file_data,
   st_conversion_settings* p_cs);
 
+/* The same as fill_data_from_input(), strings of file data 
+ * are allocated in the arena.
+ */
+int
+fill_data_from_input_in_arena(
+  const char* input_buf, 
+  st_file_data_ext* file_data,
+  st_memory_arena* p_arena,
+  st_conversion_settings* p_cs);
+
+/* Fills file data with the given hashes, they are written into MHL file 
+ * in the order of hash_types: the first one as major hash, the second 
+ * one as aux hash, the rest as more hashes. Types must be different.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
 int
-fill_data_directly(
+fill_data_with_hashes(
   const wchar_t* wfilename,
-  const char* md5_hash_str,
-  const char* sha1_hash_str,
-  const char* xx_hash_str,
-  const char* xx64_hash_str,
-  const char* xx64be_hash_str,
+  const MHL_HASH_TYPE* hash_types,
+  const char* const* hash_strs,
+  size_t hashes_num,
   st_file_data_ext* file_data);
 
 #endif // _MHL_TOOLS_MHLTOOLS_COMMON_FILES_DATA_H_
\ No newline at end of file
@@ -29,6 +29,8 @@
 
 #include <facade_info/error_codes.h>
 #include <generics/os_check.h>
+#include <generics/os_threads.h>
+#include <generics/perf_stats.h>
 #include <generics/std_funcs_os_anonymizer.h>
 #include <generics/filesystem_handlers/public_interface.h>
 
@@ -39,11 +41,44 @@
 
 #define FILE_DATA_BUFF_SZ (10 * 1024)
 
-//
-// The progress shall be printed every 2Mb
-// that is why the corresponding byte value is useful
-//
-#define TWO_MB 2097152 // 2 * 1024 * 1024
+/* Opens file for hashing, the call is counted in statistics.
+ * Reads of the file are checked by the read monitor of logging data.
+ */
+static FILE*
+aux_open_for_hash(const wchar_t* wfname, st_logging_data* logging_data)
+{
+  FILE* fd;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  fd = fwopen_for_hash_check(wfname);
+  perf_stats_end(PP_OPEN, beg_us, 0);
+  if (fd != NULL)
+  {
+    begin_read_monitor_file(&logging_data->read_monitor);
+  }
+  return fd;
+}
+
+/* Reads next chunk of file, the call is counted in statistics and
+ * checked by the read monitor.
+ */
+static size_t
+aux_read_chunk(unsigned char* data_buff, FILE* fd, 
+               st_logging_data* logging_data)
+{
+  size_t bytes_read;
+  unsigned long long beg_us;
+  unsigned long long read_beg_us;
+
+  beg_us = perf_stats_begin();
+  read_beg_us = beg_us != 0 ? beg_us : mhlosi_time_us();
+  bytes_read = fread(data_buff, sizeof(unsigned char), FILE_DATA_BUFF_SZ, fd);
+  monitor_read(&logging_data->read_monitor, bytes_read, 
+               mhlosi_time_us() - read_beg_us);
+  perf_stats_end(PP_READ, beg_us, bytes_read);
+  return bytes_read;
+}
 
 //
 // MD5 functions
@@ -66,10 +101,11 @@ int wcalculate_md5_hash(
   int res;
   FILE* fd;
   size_t bytes_read;
+  unsigned long long hash_beg_us;
   MD5_CTX md5_ctx; 
   //unsigned char md5_hash[MD5_DIGEST_LENGTH];
   unsigned char data_buff[FILE_DATA_BUFF_SZ];
-  size_t bytesReadForLogging;
+  unsigned long long bytesReadForLogging;
   
   // check params
   if (wfname == 0 || wfname[0] == L'\0' || hash_data == 0)
@@ -78,7 +114,7 @@ int wcalculate_md5_hash(
   }
   
   //
-  fd = fwopen_for_hash_check(wfname);
+  fd = aux_open_for_hash(wfname, logging_data);
   if (fd == NULL)
   {
     return ERRCODE_NO_SUCH_FILE;
@@ -103,7 +139,7 @@ int wcalculate_md5_hash(
   while (!feof(fd))
   { 
     bytes_read = 
-      fread(data_buff, sizeof(unsigned char), FILE_DATA_BUFF_SZ, fd);
+      aux_read_chunk(data_buff, fd, logging_data);
     bytesReadForLogging += bytes_read;
     if (total_bytes_read)
     {
@@ -122,20 +158,16 @@ int wcalculate_md5_hash(
       break;
     }
     
+    hash_beg_us = perf_stats_begin();
     res = MD5_Update(&md5_ctx, data_buff, bytes_read);
+    perf_stats_end(PP_HASH, hash_beg_us, bytes_read);
     if (res != 1)
     {
       fclose(fd);
       return ERRCODE_OPENSSL_ERROR;
     }
 
-    logging_data->progress_data.processed_sz += bytes_read;
-    if (logging_data->progress_data.processed_sz >= logging_data->progress_data.logged_sz + (TWO_MB))
-    {
-      print_progress_message(logging_data);
-      print_machine_progress_message(stderr, logging_data, bytesReadForLogging);
-      bytesReadForLogging = 0;
-    }
+    report_processed_sz(logging_data, bytes_read, &bytesReadForLogging);
     
   }
   
@@ -293,9 +325,10 @@ int wcalculate_sha1_hash(
   int res;
   FILE* fd;
   size_t bytes_read;
+  unsigned long long hash_beg_us;
   SHA_CTX sha1_ctx; 
   unsigned char data_buff[FILE_DATA_BUFF_SZ];
-  size_t bytesReadForLogging;
+  unsigned long long bytesReadForLogging;
   
     // check params
   if (wfname == 0 || wfname[0] == L'\0' || hash_data == 0)
@@ -304,7 +337,7 @@ int wcalculate_sha1_hash(
   }
   
   //
-  fd = fwopen_for_hash_check(wfname);
+  fd = aux_open_for_hash(wfname, logging_data);
   if (fd == NULL)
   {
     return ERRCODE_NO_SUCH_FILE;
@@ -328,7 +361,7 @@ int wcalculate_sha1_hash(
   while (!feof(fd))
   { 
     bytes_read = 
-    fread(data_buff, sizeof(unsigned char), FILE_DATA_BUFF_SZ, fd);
+    aux_read_chunk(data_buff, fd, logging_data);
     
     bytesReadForLogging += bytes_read;
     if (total_bytes_read)
@@ -348,20 +381,16 @@ int wcalculate_sha1_hash(
       break;
     }
     
+    hash_beg_us = perf_stats_begin();
     res = SHA1_Update(&sha1_ctx, data_buff, bytes_read);
+    perf_stats_end(PP_HASH, hash_beg_us, bytes_read);
     if (res != 1)
     {
       fclose(fd);
       return ERRCODE_OPENSSL_ERROR;
     }
 
-    logging_data->progress_data.processed_sz += bytes_read;
-    if (logging_data->progress_data.processed_sz >= logging_data->progress_data.logged_sz + (TWO_MB))
-    {
-      print_progress_message(logging_data);
-      print_machine_progress_message(stderr, logging_data, bytesReadForLogging);
-      bytesReadForLogging = 0;
-    }
+    report_processed_sz(logging_data, bytes_read, &bytesReadForLogging);
   }
   
   fclose(fd);
@@ -444,10 +473,11 @@ int wcalculate_xx_hash(
     int res;
     FILE* fd;
     size_t bytes_read;
+    unsigned long long hash_beg_us;
     //SHA_CTX sha1_ctx;
     XXH32_state_t* xxhash_state = NULL;
     unsigned char data_buff[FILE_DATA_BUFF_SZ];
-    size_t bytesReadForLogging;
+    unsigned long long bytesReadForLogging;
     
     // check params
     if (wfname == 0 || wfname[0] == L'\0' || hash_data == 0)
@@ -456,7 +486,7 @@ int wcalculate_xx_hash(
     }
     
     //
-    fd = fwopen_for_hash_check(wfname);
+    fd = aux_open_for_hash(wfname, logging_data);
     if (fd == NULL)
     {
         return ERRCODE_NO_SUCH_FILE;
@@ -481,7 +511,7 @@ int wcalculate_xx_hash(
     while (!feof(fd))
     {
         bytes_read =
-        fread(data_buff, sizeof(unsigned char), FILE_DATA_BUFF_SZ, fd);
+        aux_read_chunk(data_buff, fd, logging_data);
         bytesReadForLogging += bytes_read;
         if (total_bytes_read)
         {
@@ -501,20 +531,16 @@ int wcalculate_xx_hash(
         }
         
         //res = SHA1_Update(&sha1_ctx, data_buff, bytes_read);
+        hash_beg_us = perf_stats_begin();
         res = XXH32_update(xxhash_state, data_buff, (unsigned int)bytes_read);
+        perf_stats_end(PP_HASH, hash_beg_us, bytes_read);
         if (res != XXH_OK)
         {
             fclose(fd);
             return ERRCODE_OPENSSL_ERROR;
         }
         
-      logging_data->progress_data.processed_sz += bytes_read;
-      if (logging_data->progress_data.processed_sz >= logging_data->progress_data.logged_sz + (TWO_MB))
-      {
-        print_progress_message(logging_data);
-        print_machine_progress_message(stderr, logging_data, bytesReadForLogging);
-        bytesReadForLogging = 0;
-      }
+      report_processed_sz(logging_data, bytes_read, &bytesReadForLogging);
     }
     
     fclose(fd);
@@ -603,10 +629,11 @@ int wcalculate_xx64_hash(
     int res;
     FILE* fd;
     size_t bytes_read;
+    unsigned long long hash_beg_us;
     //SHA_CTX sha1_ctx;
     XXH64_state_t* xxhash_state = NULL;
     unsigned char data_buff[FILE_DATA_BUFF_SZ];
-    size_t bytesReadForLogging;
+    unsigned long long bytesReadForLogging;
 
     // check params
     if (wfname == 0 || wfname[0] == L'\0' || hash_data == 0)
@@ -615,7 +642,7 @@ int wcalculate_xx64_hash(
     }
 
     //
-    fd = fwopen_for_hash_check(wfname);
+    fd = aux_open_for_hash(wfname, logging_data);
     if (fd == NULL)
     {
         return ERRCODE_NO_SUCH_FILE;
@@ -640,7 +667,7 @@ int wcalculate_xx64_hash(
     while (!feof(fd))
     {
         bytes_read =
-        fread(data_buff, sizeof(unsigned char), FILE_DATA_BUFF_SZ, fd);
+        aux_read_chunk(data_buff, fd, logging_data);
         bytesReadForLogging += bytes_read;
         if (total_bytes_read)
         {
@@ -659,20 +686,16 @@ int wcalculate_xx64_hash(
             break;
         }
 
+        hash_beg_us = perf_stats_begin();
         res = XXH64_update(xxhash_state, data_buff, (unsigned int)bytes_read);
+        perf_stats_end(PP_HASH, hash_beg_us, bytes_read);
         if (res != XXH_OK)
         {
             fclose(fd);
             return ERRCODE_OPENSSL_ERROR;
         }
 
-      logging_data->progress_data.processed_sz += bytes_read;
-      if (logging_data->progress_data.processed_sz >= logging_data->progress_data.logged_sz + (TWO_MB))
-      {
-        print_progress_message(logging_data);
-        print_machine_progress_message(stderr, logging_data, bytesReadForLogging);
-        bytesReadForLogging = 0;
-      }
+      report_processed_sz(logging_data, bytes_read, &bytesReadForLogging);
     }
 
     fclose(fd);
@@ -751,6 +774,8 @@ int wcalculate_xx64be_hash(
     int res;
     FILE* fd;
     size_t bytes_read;
+    unsigned long long hash_beg_us;
+    unsigned long long bytesReadForLogging = 0;
     //SHA_CTX sha1_ctx;
     XXH64_state_t* xxhash_state = NULL;
     unsigned char data_buff[FILE_DATA_BUFF_SZ];
@@ -762,7 +787,7 @@ int wcalculate_xx64be_hash(
     }
 
     //
-    fd = fwopen_for_hash_check(wfname);
+    fd = aux_open_for_hash(wfname, logging_data);
     if (fd == NULL)
     {
         return ERRCODE_NO_SUCH_FILE;
@@ -784,7 +809,7 @@ int wcalculate_xx64be_hash(
     while (!feof(fd))
     {
         bytes_read =
-        fread(data_buff, sizeof(unsigned char), FILE_DATA_BUFF_SZ, fd);
+        aux_read_chunk(data_buff, fd, logging_data);
         if (total_bytes_read)
         {
             *total_bytes_read += bytes_read;
@@ -802,21 +827,17 @@ int wcalculate_xx64be_hash(
             break;
         }
 
+        hash_beg_us = perf_stats_begin();
         res = XXH64_update(xxhash_state, data_buff, (unsigned int)bytes_read);
+        perf_stats_end(PP_HASH, hash_beg_us, bytes_read);
         if (res != XXH_OK)
         {
             fclose(fd);
             return ERRCODE_OPENSSL_ERROR;
         }
 
-        if (logging_data->v_data.verbose_level >= VL_VERY_VERBOSE)
-        {
-            logging_data->progress_data.processed_sz += bytes_read;
-            if (logging_data->progress_data.processed_sz >= logging_data->progress_data.logged_sz + TWO_MB)
-            {
-                print_progress_message(logging_data);
-            }
-        }
+        bytesReadForLogging += bytes_read;
+        report_processed_sz(logging_data, bytes_read, &bytesReadForLogging);
     }
 
     fclose(fd);
@@ -897,3 +918,356 @@ int wcalculate_xx64be_hash_string(
 
     return res;
 }
+
+//
+// Several hashes at once
+//
+
+typedef struct _st_aux_hash_state
+{
+  MHL_HASH_TYPE hash_type;
+  MD5_CTX md5_ctx;
+  SHA_CTX sha1_ctx;
+  XXH32_state_t* xx_state;
+  XXH64_state_t* xx64_state;
+} st_aux_hash_state;
+
+static int
+aux_init_hash_state(st_aux_hash_state* p_state, MHL_HASH_TYPE hash_type)
+{
+  p_state->hash_type = hash_type;
+  switch (hash_type)
+  {
+    case MHL_HT_MD5:
+      return MD5_Init(&p_state->md5_ctx) == 1 ? 0 : ERRCODE_OPENSSL_ERROR;
+
+    case MHL_HT_SHA1:
+      return SHA1_Init(&p_state->sha1_ctx) == 1 ? 0 : ERRCODE_OPENSSL_ERROR;
+
+    case MHL_HT_XXHASH:
+      p_state->xx_state = XXH32_createState();
+      if (p_state->xx_state == NULL)
+      {
+        return ERRCODE_INITXXHASH_ERROR;
+      }
+      XXH32_reset(p_state->xx_state, 0);
+      return 0;
+
+    case MHL_HT_XXHASH64:
+    case MHL_HT_XXHASH64BE:
+      p_state->xx64_state = XXH64_createState();
+      if (p_state->xx64_state == NULL)
+      {
+        return ERRCODE_INITXXHASH_ERROR;
+      }
+      XXH64_reset(p_state->xx64_state, 0);
+      return 0;
+
+    default:
+      return ERRCODE_WRONG_ARGUMENTS;
+  }
+}
+
+static int
+aux_update_hash_state_data(
+  st_aux_hash_state* p_state, 
+  const unsigned char* data, 
+  size_t data_sz)
+{
+  switch (p_state->hash_type)
+  {
+    case MHL_HT_MD5:
+      return 
+        MD5_Update(&p_state->md5_ctx, data, data_sz) == 1 ? 
+          0 : ERRCODE_OPENSSL_ERROR;
+
+    case MHL_HT_SHA1:
+      return 
+        SHA1_Update(&p_state->sha1_ctx, data, data_sz) == 1 ? 
+          0 : ERRCODE_OPENSSL_ERROR;
+
+    case MHL_HT_XXHASH:
+      return 
+        XXH32_update(p_state->xx_state, data, data_sz) == XXH_OK ? 
+          0 : ERRCODE_OPENSSL_ERROR;
+
+    case MHL_HT_XXHASH64:
+    case MHL_HT_XXHASH64BE:
+      return 
+        XXH64_update(p_state->xx64_state, data, data_sz) == XXH_OK ? 
+          0 : ERRCODE_OPENSSL_ERROR;
+
+    default:
+      return ERRCODE_WRONG_ARGUMENTS;
+  }
+}
+
+static int
+aux_update_hash_state(
+  st_aux_hash_state* p_state, 
+  const unsigned char* data, 
+  size_t data_sz)
+{
+  int res;
+  unsigned long long beg_us;
+
+  beg_us = perf_stats_begin();
+  res = aux_update_hash_state_data(p_state, data, data_sz);
+  perf_stats_end(PP_HASH, beg_us, data_sz);
+  return res;
+}
+
+static int
+aux_finish_hash_state(st_aux_hash_state* p_state, char** hash_str)
+{
+  int res;
+  size_t hash_str_sz;
+  unsigned char md5_data[MD5_DIGEST_LENGTH];
+  unsigned char sha1_data[SHA_DIGEST_LENGTH];
+
+  switch (p_state->hash_type)
+  {
+    case MHL_HT_MD5:
+      if (MD5_Final(md5_data, &p_state->md5_ctx) != 1)
+      {
+        return ERRCODE_OPENSSL_ERROR;
+      }
+      return md5_hash_data_to_string(md5_data, hash_str, &hash_str_sz);
+
+    case MHL_HT_SHA1:
+      if (SHA1_Final(sha1_data, &p_state->sha1_ctx) != 1)
+      {
+        return ERRCODE_OPENSSL_ERROR;
+      }
+      return sha1_hash_data_to_string(sha1_data, hash_str, &hash_str_sz);
+
+    case MHL_HT_XXHASH:
+      res = 
+        xx_hash_data_to_string(XXH32_digest(p_state->xx_state), 
+                               hash_str, &hash_str_sz);
+      return res;
+
+    case MHL_HT_XXHASH64:
+      res = 
+        xx64_hash_data_to_string(XXH64_digest(p_state->xx64_state), 
+                                 hash_str, &hash_str_sz);
+      return res;
+
+    case MHL_HT_XXHASH64BE:
+      res = 
+        xx64be_hash_data_to_string(XXH64_digest(p_state->xx64_state), 
+                                   hash_str, &hash_str_sz);
+      return res;
+
+    default:
+      return ERRCODE_WRONG_ARGUMENTS;
+  }
+}
+
+static void
+aux_free_hash_state(st_aux_hash_state* p_state)
+{
+  if (p_state->xx_state != NULL)
+  {
+    XXH32_freeState(p_state->xx_state);
+  }
+  if (p_state->xx64_state != NULL)
+  {
+    XXH64_freeState(p_state->xx64_state);
+  }
+}
+
+struct _st_hash_strings_state
+{
+  st_aux_hash_state* states;
+  size_t hashes_num;
+};
+
+int create_hash_strings_state(
+  const MHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  st_hash_strings_state** pp_state)
+{
+  int res;
+  size_t i;
+  st_hash_strings_state* p_state;
+
+  if (hash_types == 0 || hashes_num == 0 || pp_state == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  *pp_state = NULL;
+  p_state = 
+    (st_hash_strings_state*) calloc(1, sizeof(st_hash_strings_state));
+  if (p_state == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  p_state->states = 
+    (st_aux_hash_state*) calloc(hashes_num, sizeof(st_aux_hash_state));
+  if (p_state->states == 0)
+  {
+    free(p_state);
+    return ERRCODE_OUT_OF_MEM;
+  }
+  p_state->hashes_num = hashes_num;
+
+  res = 0;
+  for (i = 0; i < hashes_num && res == 0; ++i)
+  {
+    res = aux_init_hash_state(&p_state->states[i], hash_types[i]);
+  }
+
+  if (res != 0)
+  {
+    free_hash_strings_state(p_state);
+    return res;
+  }
+
+  *pp_state = p_state;
+  return 0;
+}
+
+int update_hash_strings_state(
+  st_hash_strings_state* p_state,
+  const unsigned char* data,
+  size_t data_sz)
+{
+  int res = 0;
+  size_t i;
+
+  for (i = 0; i < p_state->hashes_num && res == 0; ++i)
+  {
+    res = aux_update_hash_state(&p_state->states[i], data, data_sz);
+  }
+
+  return res;
+}
+
+int finish_hash_strings_state(
+  st_hash_strings_state* p_state,
+  char** hash_strs)
+{
+  int res = 0;
+  size_t i;
+
+  for (i = 0; i < p_state->hashes_num; ++i)
+  {
+    hash_strs[i] = NULL;
+  }
+
+  for (i = 0; i < p_state->hashes_num && res == 0; ++i)
+  {
+    res = aux_finish_hash_state(&p_state->states[i], &hash_strs[i]);
+  }
+
+  if (res != 0)
+  {
+    for (i = 0; i < p_state->hashes_num; ++i)
+    {
+      free(hash_strs[i]);
+      hash_strs[i] = NULL;
+    }
+  }
+
+  return res;
+}
+
+void free_hash_strings_state(st_hash_strings_state* p_state)
+{
+  size_t i;
+
+  if (p_state == NULL)
+  {
+    return;
+  }
+
+  for (i = 0; i < p_state->hashes_num; ++i)
+  {
+    aux_free_hash_state(&p_state->states[i]);
+  }
+
+  free(p_state->states);
+  free(p_state);
+}
+
+int wcalculate_hash_strings(
+  const wchar_t* wfname,
+  const MHL_HASH_TYPE* hash_types,
+  char** hash_strs,
+  size_t hashes_num,
+  unsigned long long* total_bytes,
+  st_logging_data* logging_data)
+{
+  int res;
+  FILE* fd;
+  size_t i;
+  size_t bytes_read;
+  unsigned long long bytesReadForLogging;
+  st_hash_strings_state* p_state;
+  unsigned char data_buff[FILE_DATA_BUFF_SZ];
+
+  if (wfname == 0 || wfname[0] == L'\0' || hash_types == 0 || 
+      hash_strs == 0 || hashes_num == 0 || total_bytes == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  for (i = 0; i < hashes_num; ++i)
+  {
+    hash_strs[i] = NULL;
+  }
+
+  res = create_hash_strings_state(hash_types, hashes_num, &p_state);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  fd = aux_open_for_hash(wfname, logging_data);
+  if (fd == NULL)
+  {
+    res = ERRCODE_NO_SUCH_FILE;
+  }
+
+  // read content file by chunks and pass each chunk to all the hashes
+  *total_bytes = 0;
+  bytesReadForLogging = 0;
+  while (res == 0)
+  {
+    bytes_read = 
+      aux_read_chunk(data_buff, fd, logging_data);
+    bytesReadForLogging += bytes_read;
+    *total_bytes += bytes_read;
+
+    if (bytes_read == 0)
+    {
+      if (!feof(fd))
+      {
+        res = ERRCODE_IO_ERROR;
+      }
+
+      // eof
+      break;
+    }
+
+    res = update_hash_strings_state(p_state, data_buff, bytes_read);
+
+    report_processed_sz(logging_data, bytes_read, &bytesReadForLogging);
+  }
+
+  if (fd != NULL)
+  {
+    fclose(fd);
+  }
+
+  if (res == 0)
+  {
+    res = finish_hash_strings_state(p_state, hash_strs);
+  }
+
+  free_hash_strings_state(p_state);
+  return res;
+}
@@ -28,6 +28,7 @@
 
 #include <wchar.h>
 #include <mhltools_common/logging.h>
+#include <mhltools_common/mhl_types.h>
 #include <stdint.h>
 
 #define MHL_MD5_HASH_BYTES_SZ  16 
@@ -194,5 +195,62 @@ int wcalculate_xx64be_hash_string(
                                 unsigned long long* total_bytes,
                                 st_logging_data* log_data);
 
+//
+// Several hashes at once
+//
+/* Calculates hashes of several types for given file, the file is 
+ * read only once.
+ *
+ * @param wfname     - Name of file, which hashes need to be calculated
+ * @param hash_types - types of hashes, MHL_HT_NULL is not supported
+ * @param hash_strs  - out string representations of hash values, in the
+ *                     order of hash_types. Caller is responsible for 
+ *                     free pointers returned in hash_strs.
+ * @param hashes_num - number of items in hash_types and hash_strs
+ *
+ * @return in case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int wcalculate_hash_strings(
+  const wchar_t* wfname,
+  const MHL_HASH_TYPE* hash_types,
+  char** hash_strs,
+  size_t hashes_num,
+  unsigned long long* total_bytes,
+  st_logging_data* log_data);
+
+/* State of several hashes, which are calculated over the same data 
+ * passed by parts, e.g. while the data is copied.
+ */
+typedef struct _st_hash_strings_state st_hash_strings_state;
+
+/* Creates state for hashes of given types, MHL_HT_NULL is not supported.
+ * The state must be released via free_hash_strings_state().
+ *
+ * @return in case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int create_hash_strings_state(
+  const MHL_HASH_TYPE* hash_types,
+  size_t hashes_num,
+  st_hash_strings_state** pp_state);
+
+/* Passes next part of data to all the hashes of the state.
+ */
+int update_hash_strings_state(
+  st_hash_strings_state* p_state,
+  const unsigned char* data,
+  size_t data_sz);
+
+/* Finishes calculation, string representations of hash values are 
+ * returned in the order of hash types passed on creation of the state.
+ * Caller is responsible for free pointers returned in hash_strs.
+ * The state can't be updated after this call.
+ */
+int finish_hash_strings_state(
+  st_hash_strings_state* p_state,
+  char** hash_strs);
+
+void free_hash_strings_state(st_hash_strings_state* p_state);
 
 #endif // _MHL_TOOLS_MHLTOOLS_COMMON_HELP_PRINTING_H_
\ No newline at end of file
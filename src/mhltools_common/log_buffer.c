@@ -0,0 +1,481 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: log_buffer.c
+ *
+ * Messages are kept in chunks as entries: header with sequence number
+ * and length, followed by the zero-terminated text.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/os_check.h>
+#include <generics/std_funcs_os_anonymizer.h>
+#include <generics/error_output.h>
+#include <mhltools_common/log_buffer.h>
+
+typedef struct _st_log_entry_header
+{
+  unsigned long long seq;
+  size_t len;
+  unsigned int section;
+} st_log_entry_header;
+
+// position of the merge in messages of a thread
+typedef struct _st_log_cursor
+{
+  st_log_chunk* chunk;
+  size_t pos;
+  const char* data;
+  char* loaded_data; // spilled chunk read back
+  size_t loaded_capacity;
+  st_log_entry_header header;
+} st_log_cursor;
+
+static volatile unsigned long long g_log_generations = 0;
+static unsigned char g_log_keys_created = 0;
+// generation of the buffer, thread buffer of the thread belongs to
+static mhlosi_tls_key g_log_generation_key;
+static mhlosi_tls_key g_log_thread_buffer_key;
+
+static int
+aux_seek(FILE* f, unsigned long long offset)
+{
+#ifdef WIN
+  return _fseeki64(f, (__int64) offset, SEEK_SET);
+#else
+  return fseeko(f, (off_t) offset, SEEK_SET);
+#endif
+}
+
+int open_log_buffer(size_t mem_limit, unsigned char is_summary, 
+                    st_log_buffer** pp_log)
+{
+  st_log_buffer* p_log;
+
+  if (!g_log_keys_created)
+  {
+    if (mhlosi_tls_create(&g_log_generation_key) != 0 ||
+        mhlosi_tls_create(&g_log_thread_buffer_key) != 0)
+    {
+      return ERRCODE_INTERNAL_ERROR;
+    }
+    g_log_keys_created = 1;
+  }
+
+  p_log = (st_log_buffer*) calloc(1, sizeof(st_log_buffer));
+  if (p_log == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  if (mhlosi_mutex_init(&p_log->mutex) != 0)
+  {
+    free(p_log);
+    return ERRCODE_INTERNAL_ERROR;
+  }
+
+  p_log->generation = mhlosi_atomic_fetch_add(&g_log_generations, 1) + 1;
+  p_log->mem_limit = mem_limit != 0 ? mem_limit : LOG_BUFFER_DEFAULT_MEM_LIMIT;
+  p_log->is_summary = is_summary;
+
+  *pp_log = p_log;
+  return 0;
+}
+
+/* @return Chunks of the calling thread, registers them at the first call
+ *         from the thread. NULL if out of memory.
+ */
+static st_log_thread_buffer*
+aux_get_thread_buffer(st_log_buffer* p_log)
+{
+  st_log_thread_buffer* p_thread_buffer;
+
+  if ((size_t) mhlosi_tls_get(g_log_generation_key) == 
+      (size_t) p_log->generation)
+  {
+    return (st_log_thread_buffer*) mhlosi_tls_get(g_log_thread_buffer_key);
+  }
+
+  p_thread_buffer = 
+    (st_log_thread_buffer*) calloc(1, sizeof(st_log_thread_buffer));
+  if (p_thread_buffer == NULL)
+  {
+    return NULL;
+  }
+
+  mhlosi_mutex_lock(&p_log->mutex);
+  p_thread_buffer->next = p_log->threads;
+  p_log->threads = p_thread_buffer;
+  mhlosi_mutex_unlock(&p_log->mutex);
+
+  mhlosi_tls_set(g_log_thread_buffer_key, p_thread_buffer);
+  mhlosi_tls_set(g_log_generation_key, (void*) (size_t) p_log->generation);
+  return p_thread_buffer;
+}
+
+/* Moves filled chunks of the thread into the spill file. On failure 
+ * chunks stay in memory and spilling is not tried any more.
+ */
+static void
+aux_spill_chunks(st_log_buffer* p_log, st_log_thread_buffer* p_thread_buffer)
+{
+  st_log_chunk* p_chunk;
+
+  mhlosi_mutex_lock(&p_log->mutex);
+  if (p_log->spill_file == NULL && !p_log->is_spill_failed)
+  {
+    p_log->spill_file = tmpfile();
+    if (p_log->spill_file == NULL)
+    {
+      error_printf("WARNING: failed to create temporary file for the log, "
+                   "it is kept in memory.\n");
+      p_log->is_spill_failed = 1;
+    }
+  }
+
+  for (p_chunk = p_thread_buffer->first_chunk; 
+       p_chunk != NULL && !p_log->is_spill_failed; 
+       p_chunk = p_chunk->next)
+  {
+    if (p_chunk->data == NULL)
+    {
+      continue;
+    }
+
+    if (aux_seek(p_log->spill_file, p_log->spill_file_sz) != 0 ||
+        fwrite(p_chunk->data, 1, p_chunk->len, p_log->spill_file) != 
+          p_chunk->len)
+    {
+      error_printf("WARNING: failed to write temporary file of the log, "
+                   "it is kept in memory.\n");
+      p_log->is_spill_failed = 1;
+      break;
+    }
+
+    p_chunk->spill_offset = p_log->spill_file_sz;
+    p_log->spill_file_sz += p_chunk->len;
+    free(p_chunk->data);
+    p_chunk->data = NULL;
+    mhlosi_atomic_add(&p_log->spilled_sz, p_chunk->capacity);
+  }
+  mhlosi_mutex_unlock(&p_log->mutex);
+}
+
+int append_log_buffer(st_log_buffer* p_log, const char* str, size_t str_len,
+                      unsigned char is_item)
+{
+  st_log_thread_buffer* p_thread_buffer;
+  st_log_chunk* p_chunk;
+  st_log_entry_header header;
+  size_t entry_sz;
+  size_t capacity;
+
+  if (is_item && p_log->is_summary)
+  {
+    mhlosi_atomic_add(&p_log->skipped_num, 1);
+    return 0;
+  }
+
+  p_thread_buffer = aux_get_thread_buffer(p_log);
+  if (p_thread_buffer == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  entry_sz = sizeof(header) + str_len + 1;
+  p_chunk = p_thread_buffer->last_chunk;
+  if (p_chunk == NULL || p_chunk->capacity - p_chunk->len < entry_sz)
+  {
+    if (mhlosi_atomic_load(&p_log->allocated_sz) - 
+        mhlosi_atomic_load(&p_log->spilled_sz) >= p_log->mem_limit)
+    {
+      aux_spill_chunks(p_log, p_thread_buffer);
+    }
+
+    capacity = entry_sz > LOG_BUFFER_CHUNK_SZ ? entry_sz : LOG_BUFFER_CHUNK_SZ;
+    p_chunk = (st_log_chunk*) calloc(1, sizeof(st_log_chunk));
+    if (p_chunk == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+    p_chunk->data = (char*) malloc(capacity);
+    if (p_chunk->data == NULL)
+    {
+      free(p_chunk);
+      return ERRCODE_OUT_OF_MEM;
+    }
+    p_chunk->capacity = capacity;
+    mhlosi_atomic_add(&p_log->allocated_sz, capacity);
+
+    if (p_thread_buffer->last_chunk == NULL)
+    {
+      p_thread_buffer->first_chunk = p_chunk;
+    }
+    else
+    {
+      p_thread_buffer->last_chunk->next = p_chunk;
+    }
+    p_thread_buffer->last_chunk = p_chunk;
+  }
+
+  memset(&header, 0, sizeof(header));
+  header.seq = mhlosi_atomic_fetch_add(&p_log->next_seq, 1);
+  header.len = str_len;
+  header.section = p_log->section;
+  memcpy(p_chunk->data + p_chunk->len, &header, sizeof(header));
+  memcpy(p_chunk->data + p_chunk->len + sizeof(header), str, str_len);
+  p_chunk->data[p_chunk->len + sizeof(header) + str_len] = '\0';
+  p_chunk->len += entry_sz;
+  return 0;
+}
+
+void set_log_buffer_section(st_log_buffer* p_log, unsigned int section)
+{
+  if (p_log != NULL)
+  {
+    p_log->section = section;
+  }
+}
+
+int is_log_buffer_empty(st_log_buffer* p_log)
+{
+  return p_log == NULL || 
+    (mhlosi_atomic_load(&p_log->next_seq) == 0 && 
+     mhlosi_atomic_load(&p_log->skipped_num) == 0);
+}
+
+/* Moves cursor to the next chunk with messages, reading it back from 
+ * the spill file if needed.
+ * @return In case of success: 0, data of cursor is NULL at the end,
+ *         in case of failure: non zero value with error code
+ */
+static int
+aux_load_chunk(st_log_buffer* p_log, st_log_cursor* p_cursor)
+{
+  char* new_data;
+
+  while (p_cursor->chunk != NULL && p_cursor->chunk->len == 0)
+  {
+    p_cursor->chunk = p_cursor->chunk->next;
+  }
+
+  p_cursor->pos = 0;
+  if (p_cursor->chunk == NULL)
+  {
+    p_cursor->data = NULL;
+    return 0;
+  }
+
+  if (p_cursor->chunk->data != NULL)
+  {
+    p_cursor->data = p_cursor->chunk->data;
+  }
+  else
+  {
+    if (p_cursor->loaded_capacity < p_cursor->chunk->len)
+    {
+      new_data = (char*) realloc(p_cursor->loaded_data, p_cursor->chunk->len);
+      if (new_data == NULL)
+      {
+        return ERRCODE_OUT_OF_MEM;
+      }
+      p_cursor->loaded_data = new_data;
+      p_cursor->loaded_capacity = p_cursor->chunk->len;
+    }
+
+    if (aux_seek(p_log->spill_file, p_cursor->chunk->spill_offset) != 0 ||
+        fread(p_cursor->loaded_data, 1, p_cursor->chunk->len, 
+              p_log->spill_file) != p_cursor->chunk->len)
+    {
+      error_printf("Failed to read temporary file of the log.\n");
+      return ERRCODE_IO_ERROR;
+    }
+    p_cursor->data = p_cursor->loaded_data;
+  }
+
+  memcpy(&p_cursor->header, p_cursor->data, sizeof(p_cursor->header));
+  return 0;
+}
+
+/* Moves cursor to the next message.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+static int
+aux_advance_cursor(st_log_buffer* p_log, st_log_cursor* p_cursor)
+{
+  p_cursor->pos += sizeof(p_cursor->header) + p_cursor->header.len + 1;
+  if (p_cursor->pos < p_cursor->chunk->len)
+  {
+    memcpy(&p_cursor->header, p_cursor->data + p_cursor->pos, 
+           sizeof(p_cursor->header));
+    return 0;
+  }
+
+  p_cursor->chunk = p_cursor->chunk->next;
+  return aux_load_chunk(p_log, p_cursor);
+}
+
+int write_log_buffer(st_log_buffer* p_log, LogBufferWriter writer, 
+                     void* data)
+{
+  st_log_thread_buffer* p_thread_buffer;
+  st_log_cursor* cursors;
+  st_log_cursor* p_next;
+  size_t cursors_num = 0;
+  size_t i;
+  char note[128];
+  unsigned long long skipped_num;
+  int res = 0;
+
+  if (p_log == NULL)
+  {
+    return 0;
+  }
+
+  for (p_thread_buffer = p_log->threads; p_thread_buffer != NULL; 
+       p_thread_buffer = p_thread_buffer->next)
+  {
+    ++cursors_num;
+  }
+
+  cursors = (st_log_cursor*) calloc(cursors_num + 1, sizeof(st_log_cursor));
+  if (cursors == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  i = 0;
+  for (p_thread_buffer = p_log->threads; p_thread_buffer != NULL && res == 0; 
+       p_thread_buffer = p_thread_buffer->next)
+  {
+    cursors[i].chunk = p_thread_buffer->first_chunk;
+    res = aux_load_chunk(p_log, &cursors[i]);
+    ++i;
+  }
+
+  // messages of each thread are ordered, the one logged first is taken
+  // among the current messages of the threads
+  while (res == 0)
+  {
+    p_next = NULL;
+    for (i = 0; i < cursors_num; ++i)
+    {
+      if (cursors[i].data != NULL && 
+          (p_next == NULL || cursors[i].header.seq < p_next->header.seq))
+      {
+        p_next = &cursors[i];
+      }
+    }
+
+    if (p_next == NULL)
+    {
+      break;
+    }
+
+    if (p_next->header.section == 0 || 
+        p_next->header.section == p_log->section)
+    {
+      res = writer(p_next->data + p_next->pos + sizeof(p_next->header), 
+                   p_next->header.len, data);
+    }
+    if (res == 0)
+    {
+      res = aux_advance_cursor(p_log, p_next);
+    }
+  }
+
+  skipped_num = mhlosi_atomic_load(&p_log->skipped_num);
+  if (res == 0 && skipped_num != 0)
+  {
+    mhlosi_snprintf(note, sizeof(note), 
+                    "Summary log: %llu messages on single files are left out.\n", 
+                    skipped_num);
+    res = writer(note, strlen(note), data);
+  }
+
+  for (i = 0; i < cursors_num; ++i)
+  {
+    free(cursors[i].loaded_data);
+  }
+  free(cursors);
+  return res;
+}
+
+void close_log_buffer(st_log_buffer* p_log)
+{
+  st_log_thread_buffer* p_thread_buffer;
+  st_log_chunk* p_chunk;
+
+  if (p_log == NULL)
+  {
+    return;
+  }
+
+  while (p_log->threads != NULL)
+  {
+    p_thread_buffer = p_log->threads;
+    p_log->threads = p_thread_buffer->next;
+    while (p_thread_buffer->first_chunk != NULL)
+    {
+      p_chunk = p_thread_buffer->first_chunk;
+      p_thread_buffer->first_chunk = p_chunk->next;
+      free(p_chunk->data);
+      free(p_chunk);
+    }
+    free(p_thread_buffer);
+  }
+
+  if (p_log->spill_file != NULL)
+  {
+    fclose(p_log->spill_file);
+  }
+  mhlosi_mutex_destroy(&p_log->mutex);
+  free(p_log);
+}
+
+int parse_log_limit(const char* str, size_t* p_mem_limit)
+{
+  char* end;
+  unsigned long long mb;
+
+  if (str == NULL || str[0] < '0' || str[0] > '9')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  mb = strtoull(str, &end, 10);
+  if (*end != '\0' || mb == 0 || mb > ((size_t) -1) / (1024 * 1024))
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  *p_mem_limit = (size_t) mb * 1024 * 1024;
+  return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: log_buffer.h
+ *
+ * Log of verbose messages, which goes into '<log>' of MHL files.
+ * Each thread appends messages into its own chunks without locking,
+ * messages are merged in the order they were logged when the log is
+ * written. Chunks above the memory limit are spilled into a temporary
+ * file.
+ */
+#ifndef _MHL_TOOLS_MHLTOOLS_COMMON_LOG_BUFFER_H_
+#define _MHL_TOOLS_MHLTOOLS_COMMON_LOG_BUFFER_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <generics/os_threads.h>
+
+// size of a chunk, bigger messages get a chunk of their own
+#define LOG_BUFFER_CHUNK_SZ (64 * 1024)
+// memory for messages if '--log-limit' is not given
+#define LOG_BUFFER_DEFAULT_MEM_LIMIT (64 * 1024 * 1024)
+
+typedef struct _st_log_chunk
+{
+  struct _st_log_chunk* next;
+  char* data;    // NULL when the chunk is spilled
+  size_t len;
+  size_t capacity;
+  unsigned long long spill_offset;
+} st_log_chunk;
+
+// chunks of one thread, appended only by the thread itself
+typedef struct _st_log_thread_buffer
+{
+  struct _st_log_thread_buffer* next;
+  st_log_chunk* first_chunk;
+  st_log_chunk* last_chunk;
+} st_log_thread_buffer;
+
+typedef struct _st_log_buffer
+{
+  // distinguishes buffers in thread local data
+  unsigned long long generation;
+
+  size_t mem_limit;
+  // messages of files are counted only, not kept
+  unsigned char is_summary;
+
+  volatile unsigned long long next_seq;
+  volatile unsigned long long allocated_sz;
+  volatile unsigned long long spilled_sz;
+  volatile unsigned long long skipped_num;
+
+  // guards the list of threads and the spill file
+  mhlosi_mutex mutex;
+  st_log_thread_buffer* threads;
+  FILE* spill_file;
+  unsigned long long spill_file_sz;
+  unsigned char is_spill_failed;
+
+  // messages are tagged with the current section, the ones of other 
+  // sections than the current one are left out when the log is written
+  unsigned int section;
+} st_log_buffer;
+
+/* Callback of write_log_buffer(), called for each message. The message
+ * is zero-terminated, str_len doesn't include the zero.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code, which
+ *         stops writing.
+ */
+typedef int (*LogBufferWriter)(const char* str, size_t str_len, void* data);
+
+/* Creates log buffer. It has to be created before the threads, which
+ * log into it, are started.
+ * @param mem_limit - bytes of messages kept in memory, 0 for default
+ * @param is_summary - if not 0, messages added with is_item flag are 
+ *                     counted, but not kept
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int open_log_buffer(size_t mem_limit, unsigned char is_summary, 
+                    st_log_buffer** pp_log);
+
+/* Appends message to the log, may be called from any thread.
+ * @param is_item - message is about a single file
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int append_log_buffer(st_log_buffer* p_log, const char* str, size_t str_len,
+                      unsigned char is_item);
+
+/* Sets section of the following messages, 0 for messages, which are 
+ * written in all sections. Messages of other sections than the current one 
+ * are left out by write_log_buffer(), e.g. header of another MHL file, 
+ * which shares the log. Must be called when no other thread logs.
+ */
+void set_log_buffer_section(st_log_buffer* p_log, unsigned int section);
+
+/* @return Not 0 if nothing is logged.
+ */
+int is_log_buffer_empty(st_log_buffer* p_log);
+
+/* Passes messages of all the threads to the writer in the order they were 
+ * logged, except the ones of other sections than the current one, 
+ * followed by a note on skipped messages in summary mode. 
+ * May be called several times, when no other thread logs.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int write_log_buffer(st_log_buffer* p_log, LogBufferWriter writer, 
+                     void* data);
+
+/* Frees the log buffer and removes its spill file. Does nothing for NULL.
+ */
+void close_log_buffer(st_log_buffer* p_log);
+
+/* Parses value of the '--log-limit' option: memory limit in MB.
+ * @return In case of success: 0,
+ *         in case of failure: ERRCODE_WRONG_ARGUMENTS
+ */
+int parse_log_limit(const char* str, size_t* p_mem_limit);
+
+#endif //_MHL_TOOLS_MHLTOOLS_COMMON_LOG_BUFFER_H_
@@ -26,113 +26,150 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <facade_info/error_codes.h>
 #include <generics/memory_management.h>
+#include <generics/os_threads.h>
+#include <generics/error_output.h>
 #include <mhltools_common/logging.h>
+#include <mhltools_common/progress_reporter.h>
 
 void print_error(const char* err_msg)
 {
   if (err_msg)
   {
-    fprintf(stderr, "%s", err_msg);
+    error_printf("%s", err_msg);
   }
   else
   {
-    fprintf(stderr, "Unknown run-time error, possibly out of memory");
+    error_printf("Unknown run-time error, possibly out of memory");
   }
-  fprintf(stderr, "\n");
+  error_printf("\n");
 }
 
-// Do nothing if v_data is NULL, or log_str is NULL.
-// Otherwise, free log_str, set log_str_capacity and log_str_len to 0,
-// assign NULL to log_str
+// Do nothing if v_data is NULL, or the log is not opened.
+// Otherwise, free the log and assign NULL to p_log
 void clean_log_str(st_verbose_data* v_data)
 {
-  if (v_data == NULL || v_data->log_str == NULL)
+  if (v_data == NULL || v_data->p_log == NULL)
   {
     return;
   }
 
-  if (v_data->log_str_capacity == 0)
-  {
-    v_data->log_str = NULL;
-    v_data->log_str_len = 0;
-  }
-  else
+  close_log_buffer(v_data->p_log);
+  v_data->p_log = NULL;
+}
+
+int open_log_str(st_verbose_data* v_data)
+{
+  int res;
+
+  clean_log_str(v_data);
+  res = open_log_buffer(v_data->log_mem_limit, v_data->log_summary, 
+                        &v_data->p_log);
+  if (res != 0)
   {
-    free(v_data->log_str);
-    v_data->log_str_capacity = 0;
-    v_data->log_str = NULL;
-    v_data->log_str_len = 0;
+    v_data->p_log = NULL;
+    error_printf("Failed to open log: %s\n", 
+                 mhl_error_code_description(res));
   }
+  return res;
 }
 
-int logit(st_verbose_data* v_data, const char* format_str, ...)
+/* Prints formatted message and appends it to the log.
+ */
+static int
+aux_log_str(st_verbose_data* v_data, const char* str, int str_len, 
+            unsigned char is_item)
 {
-  int str_len;
-  va_list argptr;
-  size_t min_required_capacity;
-  size_t new_str_capacity;
   int res;
- 
-  va_start(argptr, format_str);
 
-  str_len = vprintf(format_str, argptr);
   if (str_len < 0)
   {
-    fprintf(stderr, "WARNING: vprintf failed. Further logging may be broken.\n");
+    error_printf("WARNING: vsnprintf failed. Further logging may be broken.\n");
     return ERRCODE_UNKNOWN_ERROR;
   }
 
-  if (v_data->log_str == NULL)
+  fwrite(str, 1, (size_t) str_len, stdout);
+  if (v_data->p_log == NULL)
   {
-    v_data->log_str_capacity = 0;
+    return 0;
   }
 
-  min_required_capacity = v_data->log_str_len + str_len + 1;
-
-  // increase allocated memory
-  if (v_data->log_str_capacity < min_required_capacity)
+  res = append_log_buffer(v_data->p_log, str, (size_t) str_len, is_item);
+  if (res != 0)
   {
-    new_str_capacity = v_data->log_str_capacity ? v_data->log_str_capacity * 2 : BUFF_SZ;
-    while (new_str_capacity < min_required_capacity)
-    {
-      new_str_capacity *= 2;
-    }
+    error_printf("WARNING: failed to append to the log: %s\n", 
+                 mhl_error_code_description(res));
+  }
+  return res;
+}
 
-    res = increase_allocated_memory(
-      (void**)&v_data->log_str,
-      &v_data->log_str_capacity,
-      new_str_capacity,
-      sizeof(char));
+int logit(st_verbose_data* v_data, const char* format_str, ...)
+{
+  char buf[BUFF_SZ];
+  char* str = buf;
+  int str_len;
+  int res;
+  va_list argptr;
+
+  va_start(argptr, format_str);
+  str_len = vsnprintf(buf, BUFF_SZ, format_str, argptr);
+  va_end(argptr);
 
-    if (res != 0)
+  if (str_len >= BUFF_SZ)
+  {
+    str = (char*) malloc(str_len + 1);
+    if (str == NULL)
     {
-      fprintf(stderr, "Out of memory.\n");
-      fprintf(stderr, 
-        "Failed to allocate buffer of size %lu bytes for log string.",
-        (long unsigned int)new_str_capacity * sizeof(char));
-      return res;
+      error_printf("Out of memory.\n");
+      return ERRCODE_OUT_OF_MEM;
     }
+    va_start(argptr, format_str);
+    str_len = vsnprintf(str, str_len + 1, format_str, argptr);
+    va_end(argptr);
   }
 
-  va_end(argptr);
-  va_start(argptr, format_str);
-  
-  str_len = vsprintf(v_data->log_str + v_data->log_str_len, format_str, argptr);
-  if (str_len < 0)
+  res = aux_log_str(v_data, str, str_len, 0);
+  if (str != buf)
   {
-    fprintf(stderr, "WARNING: vsprintf failed. Further logging may be broken.\n");
-    free(v_data->log_str);
-    v_data->log_str = NULL;
-    return ERRCODE_UNKNOWN_ERROR;
+    free(str);
   }
+  return res;
+}
 
-  v_data->log_str_len += str_len;
+int logit_item(st_verbose_data* v_data, const char* format_str, ...)
+{
+  char buf[BUFF_SZ];
+  char* str = buf;
+  int str_len;
+  int res;
+  va_list argptr;
 
+  va_start(argptr, format_str);
+  str_len = vsnprintf(buf, BUFF_SZ, format_str, argptr);
   va_end(argptr);
-  return 0;
+
+  if (str_len >= BUFF_SZ)
+  {
+    str = (char*) malloc(str_len + 1);
+    if (str == NULL)
+    {
+      error_printf("Out of memory.\n");
+      return ERRCODE_OUT_OF_MEM;
+    }
+    va_start(argptr, format_str);
+    str_len = vsnprintf(str, str_len + 1, format_str, argptr);
+    va_end(argptr);
+  }
+
+  res = aux_log_str(v_data, str, str_len, 1);
+  if (str != buf)
+  {
+    free(str);
+  }
+  return res;
 }
 
 void
@@ -269,6 +306,29 @@ print_machine_progress_message(FILE* file, const st_logging_data* logging_data,
   }
 }
 
+void
+report_processed_sz(st_logging_data* logging_data, unsigned long long sz, 
+                    unsigned long long* p_unlogged_sz)
+{
+  st_progress_data* p_progress = &logging_data->progress_data;
+
+  p_progress->processed_sz += sz;
+  if (p_progress->p_worker != NULL)
+  {
+    mhlosi_atomic_add(&p_progress->p_worker->processed_sz, sz);
+    *p_unlogged_sz = 0;
+    return;
+  }
+
+  if (p_progress->processed_sz >= p_progress->logged_sz + PROGRESS_STEP_SZ)
+  {
+    print_progress_message(logging_data);
+    print_machine_progress_message(stderr, logging_data, 
+                                   (unsigned long) *p_unlogged_sz);
+    *p_unlogged_sz = 0;
+  }
+}
+
 void
 print_output_meta_info(FILE* file,
                        const wchar_t* abs_file_name,
@@ -283,6 +343,121 @@ print_output_meta_info(FILE* file,
   }
 }
 
+void
+print_output_slow_read(FILE* file,
+                       const wchar_t* abs_file_name,
+                       st_logging_data* logging_data)
+{
+  st_read_monitor* p_monitor = &logging_data->read_monitor;
+  unsigned int flags;
+  char flag_names[64];
+
+  flags = finish_read_monitor_file(p_monitor);
+  if (flags == 0)
+  {
+    return;
+  }
+
+  flag_names[0] = '\0';
+  if (flags & SLOW_READ_THROUGHPUT)
+  {
+    strcat(flag_names, "+THROUGHPUT");
+  }
+  if (flags & SLOW_READ_BASELINE)
+  {
+    strcat(flag_names, "+BASELINE");
+  }
+  if (flags & SLOW_READ_LATENCY)
+  {
+    strcat(flag_names, "+LATENCY");
+  }
+
+  if (logging_data->v_data.machine_output) {
+    fprintf(file, "%s|meta|%ls|SLOWREAD=%s", logging_data->tool_name, 
+            abs_file_name, flag_names + 1);
+    if (flags & (SLOW_READ_THROUGHPUT | SLOW_READ_BASELINE))
+    {
+      fprintf(file, ",READSPEED=%.1f", p_monitor->mb_per_s);
+    }
+    if (p_monitor->flagged_baseline_mb_per_s != 0)
+    {
+      fprintf(file, ",BASELINESPEED=%.1f", 
+              p_monitor->flagged_baseline_mb_per_s);
+    }
+    fprintf(file, ",SLOWREADS=%lu,MAXREADMS=%llu,MAXREADOFFSET=%llu\n",
+            p_monitor->slow_reads_num, p_monitor->worst_read_us / 1000,
+            p_monitor->worst_read_offset);
+    fflush(file);
+  }
+  else
+  {
+    fprintf(file, "WARNING: slow reading of file %ls:", abs_file_name);
+    if (flags & (SLOW_READ_THROUGHPUT | SLOW_READ_BASELINE))
+    {
+      fprintf(file, " %.1f MB/s", p_monitor->mb_per_s);
+      if (p_monitor->flagged_baseline_mb_per_s != 0)
+      {
+        fprintf(file, " (usually %.1f MB/s)", 
+                p_monitor->flagged_baseline_mb_per_s);
+      }
+      fprintf(file, ",");
+    }
+    fprintf(file, " %lu slow reads, the slowest read took %llu ms "
+            "at offset %llu\n", 
+            p_monitor->slow_reads_num, p_monitor->worst_read_us / 1000,
+            p_monitor->worst_read_offset);
+  }
+
+  reset_read_monitor_flags(p_monitor);
+}
+
+int
+open_file_report(st_logging_data* logging_data, const char* path, 
+                 REPORT_FORMAT format)
+{
+  int res;
+
+  res = open_report_writer(path, format, &logging_data->p_report);
+  if (res != 0)
+  {
+    error_printf("Error: Cannot create report file '%s': %s\n", path,
+                 mhl_error_code_description(res));
+    logging_data->p_report = NULL;
+  }
+  return res;
+}
+
+int
+close_file_report(st_logging_data* logging_data)
+{
+  int res;
+
+  res = close_report_writer(logging_data->p_report);
+  logging_data->p_report = NULL;
+  if (res != 0)
+  {
+    error_printf("Error: Cannot write report file: %s\n",
+                 mhl_error_code_description(res));
+  }
+  return res;
+}
+
+void
+report_file_result(st_logging_data* logging_data,
+                   st_report_record* p_record,
+                   int err_code,
+                   unsigned char is_from_cache)
+{
+  if (logging_data->p_report == NULL)
+  {
+    return;
+  }
+
+  p_record->err_code = err_code;
+  p_record->is_from_cache = is_from_cache;
+  write_report_record(logging_data->p_report, p_record);
+}
+
 void
 print_error_missing_file(FILE* file, const wchar_t* file_name, const st_logging_data* logging_data)
 {
@@ -301,14 +476,22 @@ print_output_verify_success(FILE* file, const st_logging_data* logging_data, con
   }
 }
 
+void
+print_output_verify_cached(FILE* file, const st_logging_data* logging_data, const wchar_t* file_name)
+{
+  if (logging_data->v_data.machine_output) {
+    fprintf(file, "%s|output|compare|%ls|CACHED\n", logging_data->tool_name, file_name);
+    fflush(file);
+  }
+}
+
 void
 print_output_verify_failure(FILE* file, const wchar_t* file_name, const wchar_t* mhl_file_name, int err_code, const st_logging_data* logging_data)
 {
   if (logging_data->v_data.machine_output) {
     fprintf(file, "%s|error|%d|%ls|%s\n", logging_data->tool_name, err_code, file_name, mhl_error_code_description(err_code));
   } else {
-    fprintf(
-            stderr,
+    error_printf(
             "File: '%ls' has not passed check for MHL file '%ls'.\n"
             "Description: '%s'\n",
             file_name,
@@ -28,7 +28,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <mhltools_common/log_buffer.h>
 #include <mhltools_common/mhl_types.h>
+#include <mhltools_common/read_monitor.h>
+#include <mhltools_common/report_writer.h>
 
 #define BUFF_SZ (10 *1024)
 
@@ -48,16 +51,32 @@ typedef struct _st_verbose_data
   // is used to flag if the output shall be in a machine-readable form
   unsigned char machine_output;
 
-  char* log_str;
-  size_t log_str_capacity;
-  size_t log_str_len;
+  // log for MHL files, NULL if messages are only printed
+  st_log_buffer* p_log;
+  // '--log-limit' and '--log-summary' options
+  size_t log_mem_limit;
+  unsigned char log_summary;
 } st_verbose_data;
 
+/* Prints message to stdout and appends it to the log, if it is opened.
+ * May be called from several threads.
+ */
 int logit(st_verbose_data* v_data, const char* format_str, ...);
 
-// Do nothing if v_data is NULL, or log_str is NULL.
-// Otherwise, free log_str, set log_str_capacity and log_str_len to 0,
-// assign NULL to log_str
+/* The same as logit(), for messages on single files. They are left out 
+ * from the log with '--log-summary'.
+ */
+int logit_item(st_verbose_data* v_data, const char* format_str, ...);
+
+/* Opens the log for MHL files, according to log options of v_data.
+ * Has to be called before threads, which log, are started.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int open_log_str(st_verbose_data* v_data);
+
+// Do nothing if v_data is NULL, or the log is not opened.
+// Otherwise, free the log and assign NULL to p_log
 void clean_log_str(st_verbose_data* v_data);
 
 // statistical data, needed only for logging
@@ -76,13 +95,26 @@ typedef struct _st_progress_data
   unsigned long n_files_processed;
   unsigned long n_seqs_processed;
   unsigned long n_files_in_seq_processed;
+
+  // set while progress is printed by the reporter thread, 
+  // see progress_reporter.h
+  struct _st_progress_reporter* p_reporter;
+  // counters of the thread in the reporter, NULL if the thread's 
+  // progress is not reported
+  struct _st_progress_worker* p_worker;
 } st_progress_data;
 
+// progress is printed each time this number of bytes is processed,
+// if there is no reporter thread
+#define PROGRESS_STEP_SZ (2 * 1024 * 1024)
+
 // common options for all modes
 typedef struct _st_logging_data
 {
   st_verbose_data v_data;
   st_progress_data progress_data;
+  st_read_monitor read_monitor; // reads of hashed files
+  st_report_writer* p_report; // NULL if results are not reported
   const char* tool_name;
 } st_logging_data;
 
@@ -98,6 +130,16 @@ print_progress_message(st_logging_data* logging_data);
 void
 print_machine_progress_message(FILE* file, const st_logging_data* logging_data, unsigned long num_bytes);
 
+/* Adds bytes processed by the calling thread. They are counted for the 
+ * reporter thread if it runs, otherwise progress is printed at once 
+ * each PROGRESS_STEP_SZ bytes.
+ * @param p_unlogged_sz - bytes not printed in machine progress yet,
+ *                        zeroed when they are printed
+ */
+void
+report_processed_sz(st_logging_data* logging_data, unsigned long long sz, 
+                    unsigned long long* p_unlogged_sz);
+
 void
 print_minor_separator(FILE * file);
 
@@ -110,6 +152,9 @@ print_error_missing_file(FILE* file, const wchar_t* file_name, const st_logging_
 void
 print_output_verify_success(FILE* file, const st_logging_data* logging_data, const wchar_t* file_name);
 
+void
+print_output_verify_cached(FILE* file, const st_logging_data* logging_data, const wchar_t* file_name);
+
 void
 print_output_meta_info(FILE* file,
                        const wchar_t* abs_file_name,
@@ -119,6 +164,39 @@ print_output_meta_info(FILE* file,
                        unsigned long long file_sz
                        );
 
+/* Reports slow reads of the file, which was hashed last: in machine 
+ * output as "meta" message with SLOWREAD flags, otherwise as warning.
+ * Nothing is printed if the reads are not slow.
+ */
+void
+print_output_slow_read(FILE* file,
+                       const wchar_t* abs_file_name,
+                       st_logging_data* logging_data);
+
+/* Creates report of results of files, the error is printed.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int
+open_file_report(st_logging_data* logging_data, const char* path, 
+                 REPORT_FORMAT format);
+
+/* Finishes report of results of files, if there is one, 
+ * the error is printed.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int
+close_file_report(st_logging_data* logging_data);
+
+/* Adds result of the file to the report, if there is one.
+ */
+void
+report_file_result(st_logging_data* logging_data,
+                   st_report_record* p_record,
+                   int err_code,
+                   unsigned char is_from_cache);
+
 void
 print_output_verify_failure(FILE* file, const wchar_t* file_name, const wchar_t* mhl_file_name, int err_code, const st_logging_data* logging_data);
 
@@ -106,6 +106,74 @@ recognise_option(const char* option_nm)
   {
     return OPT_C;
   }
+  else if (strcmp(option_nm, "-z") == 0 || strcmp(option_nm, "--gzip") == 0)
+  {
+    return OPT_Z;
+  }
+  else if (strcmp(option_nm, "-i") == 0 || strcmp(option_nm, "--index") == 0)
+  {
+    return OPT_I;
+  }
+  else if (strcmp(option_nm, "--index-dir") == 0)
+  {
+    return OPT_INDEX_DIR;
+  }
+  else if (strcmp(option_nm, "--discover-all") == 0)
+  {
+    return OPT_DISCOVER_ALL;
+  }
+  else if (strcmp(option_nm, "--cache") == 0)
+  {
+    return OPT_CACHE;
+  }
+  else if (strcmp(option_nm, "--max-cache-age") == 0)
+  {
+    return OPT_MAX_CACHE_AGE;
+  }
+  else if (strcmp(option_nm, "--all-hashes") == 0)
+  {
+    return OPT_ALL_HASHES;
+  }
+  else if (strcmp(option_nm, "-d") == 0 || strcmp(option_nm, "--destination") == 0)
+  {
+    return OPT_D;
+  }
+  else if (strcmp(option_nm, "--verify") == 0)
+  {
+    return OPT_VERIFY;
+  }
+  else if (strcmp(option_nm, "--root") == 0)
+  {
+    return OPT_ROOT;
+  }
+  else if (strcmp(option_nm, "--jobs") == 0)
+  {
+    return OPT_JOBS;
+  }
+  else if (strcmp(option_nm, "--slow-read") == 0)
+  {
+    return OPT_SLOW_READ;
+  }
+  else if (strcmp(option_nm, "--slow-read-ms") == 0)
+  {
+    return OPT_SLOW_READ_MS;
+  }
+  else if (strcmp(option_nm, "--report") == 0)
+  {
+    return OPT_REPORT;
+  }
+  else if (strcmp(option_nm, "--report-format") == 0)
+  {
+    return OPT_REPORT_FORMAT;
+  }
+  else if (strcmp(option_nm, "--log-limit") == 0)
+  {
+    return OPT_LOG_LIMIT;
+  }
+  else if (strcmp(option_nm, "--log-summary") == 0)
+  {
+    return OPT_LOG_SUMMARY;
+  }
 #ifdef WIN
   else if (strcmp(option_nm, "/?") == 0)
   {
@@ -50,6 +50,23 @@ typedef enum _en_opts
   OPT_VER,
   OPT_M,
   OPT_C,
+  OPT_Z,
+  OPT_I,
+  OPT_INDEX_DIR,
+  OPT_DISCOVER_ALL,
+  OPT_CACHE,
+  OPT_MAX_CACHE_AGE,
+  OPT_ALL_HASHES,
+  OPT_D,
+  OPT_VERIFY,
+  OPT_ROOT,
+  OPT_JOBS,
+  OPT_SLOW_READ,
+  OPT_SLOW_READ_MS,
+  OPT_REPORT,
+  OPT_REPORT_FORMAT,
+  OPT_LOG_LIMIT,
+  OPT_LOG_SUMMARY,
   NOT_OPT
 } en_opts;
 
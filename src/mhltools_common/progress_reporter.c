@@ -0,0 +1,435 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: progress_reporter.c
+ *
+ * Thread, which prints progress of long operations at a fixed rate.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <generics/os_check.h>
+#ifndef WIN
+#include <signal.h>
+#endif
+
+#include <facade_info/error_codes.h>
+#include <generics/os_threads.h>
+#include <mhltools_common/logging.h>
+#include <mhltools_common/progress_reporter.h>
+
+// machine readable progress and snapshot requests are checked each tick
+#define PROGRESS_TICK_MS 250
+#define PROGRESS_INTERVAL_MS 1000
+// workers without progress for this time are shown as waiting
+#define PROGRESS_STALL_MS 2000
+
+#define MB (1024 * 1024)
+
+#ifndef WIN
+static volatile sig_atomic_t g_is_snapshot_requested = 0;
+static struct sigaction g_prev_sigusr1_action;
+
+static
+void
+aux_sigusr1_handler(int signum)
+{
+  g_is_snapshot_requested = 1;
+}
+#endif
+
+static
+unsigned long long
+aux_sum_processed_sz(st_progress_reporter* p_reporter)
+{
+  unsigned long long sum = 0;
+  unsigned int workers_num;
+  unsigned int i;
+
+  mhlosi_mutex_lock(&p_reporter->mutex);
+  workers_num = p_reporter->workers_num;
+  mhlosi_mutex_unlock(&p_reporter->mutex);
+
+  for (i = 0; i < workers_num; ++i)
+  {
+    sum += mhlosi_atomic_load(&p_reporter->workers[i].processed_sz);
+  }
+  return sum;
+}
+
+/* Takes rates of the last interval, for all workers and in total.
+ */
+static
+void
+aux_sample_rates(st_progress_reporter* p_reporter, unsigned long long now_ms)
+{
+  unsigned long long interval_ms;
+  unsigned long long processed_sz;
+  unsigned long long sum = 0;
+  unsigned int workers_num;
+  unsigned int i;
+  st_progress_worker* p_worker;
+
+  interval_ms = now_ms - p_reporter->sample_ms;
+  if (interval_ms == 0)
+  {
+    return;
+  }
+
+  mhlosi_mutex_lock(&p_reporter->mutex);
+  workers_num = p_reporter->workers_num;
+  mhlosi_mutex_unlock(&p_reporter->mutex);
+
+  for (i = 0; i < workers_num; ++i)
+  {
+    p_worker = &p_reporter->workers[i];
+    processed_sz = mhlosi_atomic_load(&p_worker->processed_sz);
+    p_worker->rate = 
+      (processed_sz - p_worker->sampled_sz) * 1000 / interval_ms;
+    if (processed_sz == p_worker->sampled_sz)
+    {
+      p_worker->stalled_ms += interval_ms;
+    }
+    else
+    {
+      p_worker->stalled_ms = 0;
+    }
+    p_worker->sampled_sz = processed_sz;
+    sum += processed_sz;
+  }
+
+  p_reporter->rate = (sum - p_reporter->sampled_sz) * 1000 / interval_ms;
+  p_reporter->sampled_sz = sum;
+  p_reporter->sample_ms = now_ms;
+}
+
+static
+void
+aux_append_text(st_progress_reporter* p_reporter, const char* format, ...)
+{
+  va_list args;
+  size_t free_sz;
+  int len;
+
+  free_sz = sizeof(p_reporter->text) - p_reporter->text_len;
+  va_start(args, format);
+  len = vsnprintf(p_reporter->text + p_reporter->text_len, free_sz, 
+                  format, args);
+  va_end(args);
+
+  if (len > 0)
+  {
+    p_reporter->text_len += (size_t) len < free_sz ? (size_t) len : free_sz - 1;
+  }
+}
+
+/* Prints progress line and, with several workers, the state of each.
+ * The text is printed at once, so it is not mixed with other output.
+ */
+static
+void
+aux_print_progress(
+  FILE* file, 
+  st_progress_reporter* p_reporter, 
+  unsigned long long now_ms)
+{
+  st_progress_data* p_progress = &p_reporter->p_logging_data->progress_data;
+  unsigned long long processed_sz = p_reporter->sampled_sz;
+  unsigned long long total_sz = p_progress->total_sz;
+  unsigned long long elapsed_ms = now_ms - p_reporter->start_ms;
+  unsigned long long avg_rate;
+  unsigned long long eta_s;
+  unsigned long n_files_processed = p_progress->n_files_processed;
+  unsigned int workers_num;
+  unsigned int i;
+  st_progress_worker* p_worker;
+
+  avg_rate = elapsed_ms ? processed_sz * 1000 / elapsed_ms : 0;
+
+  p_reporter->text_len = 0;
+  aux_append_text(p_reporter, "Processed ");
+  if (p_progress->n_seqs)
+  {
+    aux_append_text(p_reporter, "%lu of %lu sequences, ",
+                    p_progress->n_seqs_processed, p_progress->n_seqs);
+  }
+  if (p_progress->n_files)
+  {
+    aux_append_text(p_reporter, "%lu of %lu files, ",
+                    n_files_processed, p_progress->n_files);
+  }
+  if (total_sz)
+  {
+    aux_append_text(p_reporter, "%llu of %llu MB ", 
+                    processed_sz / MB, total_sz / MB);
+  }
+  else
+  {
+    aux_append_text(p_reporter, "%llu MB ", processed_sz / MB);
+  }
+  aux_append_text(p_reporter, 
+                  "(%llu bytes), %.1f MB/s, average %.1f MB/s, %.1f files/s",
+                  processed_sz, 
+                  (double) p_reporter->rate / MB, (double) avg_rate / MB,
+                  elapsed_ms ? n_files_processed * 1000.0 / elapsed_ms : 0.0);
+  if (avg_rate != 0 && total_sz > processed_sz)
+  {
+    // rounded up, the last second of work is not shown as 0:00:00
+    eta_s = (total_sz - processed_sz + avg_rate - 1) / avg_rate;
+    aux_append_text(p_reporter, ", ETA %llu:%02llu:%02llu",
+                    eta_s / 3600, eta_s / 60 % 60, eta_s % 60);
+  }
+  aux_append_text(p_reporter, "\n");
+
+  mhlosi_mutex_lock(&p_reporter->mutex);
+  workers_num = p_reporter->workers_num;
+  mhlosi_mutex_unlock(&p_reporter->mutex);
+
+  for (i = 0; i < workers_num && workers_num > 1; ++i)
+  {
+    p_worker = &p_reporter->workers[i];
+    if (i == 0 && p_worker->sampled_sz == 0)
+    {
+      // the calling thread only waits for the jobs
+      continue;
+    }
+    if (p_worker->stalled_ms >= PROGRESS_STALL_MS)
+    {
+      aux_append_text(p_reporter, "   worker %u: %llu MB, no data for %llu s\n", 
+                      i, p_worker->sampled_sz / MB, 
+                      p_worker->stalled_ms / 1000);
+    }
+    else
+    {
+      aux_append_text(p_reporter, "   worker %u: %llu MB, %.1f MB/s\n", i,
+                      p_worker->sampled_sz / MB, (double) p_worker->rate / MB);
+    }
+  }
+
+  fputs(p_reporter->text, file);
+  fflush(file);
+}
+
+static
+void
+aux_print_machine_progress(st_progress_reporter* p_reporter)
+{
+  unsigned long long processed_sz;
+
+  processed_sz = aux_sum_processed_sz(p_reporter);
+  if (processed_sz > p_reporter->machine_logged_sz)
+  {
+    print_machine_progress_message(stderr, p_reporter->p_logging_data,
+      (unsigned long) (processed_sz - p_reporter->machine_logged_sz));
+    p_reporter->machine_logged_sz = processed_sz;
+  }
+}
+
+static
+void
+aux_reporter_thread(void* arg)
+{
+  st_progress_reporter* p_reporter = (st_progress_reporter*) arg;
+  st_logging_data* p_logging_data = p_reporter->p_logging_data;
+  unsigned long long now_ms;
+
+  mhlosi_mutex_lock(&p_reporter->mutex);
+  while (!p_reporter->is_stopped)
+  {
+    mhlosi_cond_timedwait(&p_reporter->cond, &p_reporter->mutex, 
+                          PROGRESS_TICK_MS);
+    if (p_reporter->is_stopped)
+    {
+      break;
+    }
+    mhlosi_mutex_unlock(&p_reporter->mutex);
+
+    if (p_logging_data->v_data.machine_output)
+    {
+      aux_print_machine_progress(p_reporter);
+    }
+
+    now_ms = mhlosi_time_ms();
+    if (now_ms - p_reporter->sample_ms >= PROGRESS_INTERVAL_MS)
+    {
+      aux_sample_rates(p_reporter, now_ms);
+      if (p_logging_data->v_data.verbose_level >= VL_VERY_VERBOSE)
+      {
+        aux_print_progress(stdout, p_reporter, now_ms);
+      }
+    }
+
+#ifndef WIN
+    if (g_is_snapshot_requested)
+    {
+      g_is_snapshot_requested = 0;
+      aux_sample_rates(p_reporter, now_ms);
+      aux_print_progress(stderr, p_reporter, now_ms);
+    }
+#endif
+
+    mhlosi_mutex_lock(&p_reporter->mutex);
+  }
+  mhlosi_mutex_unlock(&p_reporter->mutex);
+}
+
+int start_progress_reporter(st_logging_data* p_logging_data)
+{
+  int res;
+  st_progress_reporter* p_reporter;
+#ifndef WIN
+  struct sigaction action;
+#else
+  // there is nothing to report without the options
+  if (p_logging_data->v_data.verbose_level < VL_VERY_VERBOSE &&
+      !p_logging_data->v_data.machine_output)
+  {
+    return 0;
+  }
+#endif
+
+  // progress is already counted by a reporter
+  if (p_logging_data->progress_data.p_reporter != NULL ||
+      p_logging_data->progress_data.p_worker != NULL)
+  {
+    return 0;
+  }
+
+  p_reporter = (st_progress_reporter*) calloc(1, sizeof(st_progress_reporter));
+  if (p_reporter == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  p_reporter->p_logging_data = p_logging_data;
+  p_reporter->start_ms = mhlosi_time_ms();
+  p_reporter->sample_ms = p_reporter->start_ms;
+
+  // the calling thread is the first worker, bytes it has processed 
+  // before are not printed again
+  p_reporter->workers_num = 1;
+  p_reporter->workers[0].processed_sz = 
+    p_logging_data->progress_data.processed_sz;
+  p_reporter->workers[0].sampled_sz = p_reporter->workers[0].processed_sz;
+  p_reporter->sampled_sz = p_reporter->workers[0].processed_sz;
+  p_reporter->machine_logged_sz = p_reporter->workers[0].processed_sz;
+
+  res = mhlosi_mutex_init(&p_reporter->mutex);
+  if (res != 0)
+  {
+    free(p_reporter);
+    return res;
+  }
+
+  res = mhlosi_cond_init(&p_reporter->cond);
+  if (res != 0)
+  {
+    mhlosi_mutex_destroy(&p_reporter->mutex);
+    free(p_reporter);
+    return res;
+  }
+
+  res = mhlosi_thread_create(&p_reporter->thread, aux_reporter_thread, 
+                             p_reporter);
+  if (res != 0)
+  {
+    mhlosi_cond_destroy(&p_reporter->cond);
+    mhlosi_mutex_destroy(&p_reporter->mutex);
+    free(p_reporter);
+    return res;
+  }
+
+#ifndef WIN
+  memset((void*) &action, 0, sizeof(action) / sizeof(char));
+  action.sa_handler = aux_sigusr1_handler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGUSR1, &action, &g_prev_sigusr1_action);
+#endif
+
+  p_logging_data->progress_data.p_reporter = p_reporter;
+  p_logging_data->progress_data.p_worker = &p_reporter->workers[0];
+  return 0;
+}
+
+void stop_progress_reporter(st_logging_data* p_logging_data)
+{
+  st_progress_reporter* p_reporter = p_logging_data->progress_data.p_reporter;
+
+  if (p_reporter == NULL)
+  {
+    return;
+  }
+
+#ifndef WIN
+  sigaction(SIGUSR1, &g_prev_sigusr1_action, NULL);
+#endif
+
+  mhlosi_mutex_lock(&p_reporter->mutex);
+  p_reporter->is_stopped = 1;
+  mhlosi_cond_signal(&p_reporter->cond);
+  mhlosi_mutex_unlock(&p_reporter->mutex);
+  mhlosi_thread_join(p_reporter->thread);
+
+  if (p_logging_data->v_data.machine_output)
+  {
+    aux_print_machine_progress(p_reporter);
+  }
+
+  p_logging_data->progress_data.p_reporter = NULL;
+  p_logging_data->progress_data.p_worker = NULL;
+  p_logging_data->progress_data.logged_sz = 
+    p_logging_data->progress_data.processed_sz;
+
+  mhlosi_cond_destroy(&p_reporter->cond);
+  mhlosi_mutex_destroy(&p_reporter->mutex);
+  free(p_reporter);
+}
+
+void attach_progress_worker(
+  st_logging_data* p_job_logging_data,
+  const st_logging_data* p_main_logging_data)
+{
+  st_progress_reporter* p_reporter = 
+    p_main_logging_data->progress_data.p_reporter;
+
+  p_job_logging_data->progress_data.p_worker = NULL;
+  if (p_reporter == NULL)
+  {
+    return;
+  }
+
+  mhlosi_mutex_lock(&p_reporter->mutex);
+  if (p_reporter->workers_num < PROGRESS_MAX_WORKERS)
+  {
+    p_job_logging_data->progress_data.p_worker = 
+      &p_reporter->workers[p_reporter->workers_num++];
+  }
+  mhlosi_mutex_unlock(&p_reporter->mutex);
+}
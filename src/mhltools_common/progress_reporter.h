@@ -0,0 +1,99 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: progress_reporter.h
+ *
+ * Thread, which prints progress of long operations at a fixed rate, so 
+ * hashing and copying threads only add to counters. Besides progress 
+ * messages of '-vv' and '-y' it prints throughput, ETA and state of 
+ * each worker thread; on SIGUSR1 a snapshot is printed to stderr.
+ */
+#ifndef _MHL_TOOLS_MHLTOOLS_COMMON_PROGRESS_REPORTER_H_
+#define _MHL_TOOLS_MHLTOOLS_COMMON_PROGRESS_REPORTER_H_
+
+#include <generics/os_threads.h>
+#include <mhltools_common/logging.h>
+
+// the calling thread and up to 256 jobs
+#define PROGRESS_MAX_WORKERS 257
+// progress line and a line for each worker
+#define PROGRESS_TEXT_SZ (512 + PROGRESS_MAX_WORKERS * 80)
+
+typedef struct _st_progress_worker
+{
+  // written by the worker thread only
+  volatile unsigned long long processed_sz;
+
+  // data of the reporter thread
+  unsigned long long sampled_sz;
+  unsigned long long rate; // bytes per second in the last interval
+  unsigned long long stalled_ms;
+} st_progress_worker;
+
+typedef struct _st_progress_reporter
+{
+  st_logging_data* p_logging_data;
+
+  st_progress_worker workers[PROGRESS_MAX_WORKERS];
+  unsigned int workers_num;
+
+  mhlosi_thread thread;
+  mhlosi_mutex mutex;
+  mhlosi_cond cond;
+  unsigned char is_stopped;
+
+  unsigned long long start_ms;
+  unsigned long long sample_ms;
+  unsigned long long sampled_sz;
+  unsigned long long rate; // bytes per second in the last interval
+  unsigned long long machine_logged_sz;
+
+  char text[PROGRESS_TEXT_SZ];
+  size_t text_len;
+} st_progress_reporter;
+
+/* Starts the reporter thread for the logging data, progress of the 
+ * calling thread is reported then. Nothing is done if progress of the 
+ * logging data is already reported. If the thread can't be started, 
+ * progress is printed by the working threads as before.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int start_progress_reporter(st_logging_data* p_logging_data);
+
+/* Stops the reporter thread, if it runs, and prints the rest of machine 
+ * readable progress.
+ */
+void stop_progress_reporter(st_logging_data* p_logging_data);
+
+/* Makes progress of a job, which runs with its own logging data, 
+ * reported together with the progress of the main logging data.
+ */
+void attach_progress_worker(
+  st_logging_data* p_job_logging_data,
+  const st_logging_data* p_main_logging_data);
+
+#endif // _MHL_TOOLS_MHLTOOLS_COMMON_PROGRESS_REPORTER_H_
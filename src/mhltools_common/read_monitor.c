@@ -0,0 +1,189 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: read_monitor.c
+ *
+ * Detection of slowly read media.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <facade_info/error_codes.h>
+#include <mhltools_common/read_monitor.h>
+
+int parse_slow_read_speed(const char* str, st_read_monitor* p_monitor)
+{
+  char* end;
+  double mb_per_s;
+
+  if (str == NULL || str[0] < '0' || str[0] > '9')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  mb_per_s = strtod(str, &end);
+  if (*end != '\0' || mb_per_s <= 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  p_monitor->min_mb_per_s = mb_per_s;
+  return 0;
+}
+
+int parse_slow_read_ms(const char* str, st_read_monitor* p_monitor)
+{
+  char* end;
+  unsigned long long ms;
+
+  if (str == NULL || str[0] < '0' || str[0] > '9')
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  ms = strtoull(str, &end, 10);
+  if (*end != '\0' || ms == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  p_monitor->max_read_ms = ms;
+  return 0;
+}
+
+void begin_read_monitor_file(st_read_monitor* p_monitor)
+{
+  finish_read_monitor_file(p_monitor);
+
+  p_monitor->is_file_pending = 1;
+  p_monitor->file_sz = 0;
+  p_monitor->file_read_us = 0;
+  p_monitor->file_worst_read_us = 0;
+  p_monitor->file_worst_read_offset = 0;
+  p_monitor->file_slow_reads_num = 0;
+}
+
+void monitor_read(st_read_monitor* p_monitor, size_t sz, 
+                  unsigned long long read_us)
+{
+  unsigned long long max_read_ms;
+
+  max_read_ms = p_monitor->max_read_ms != 0 ? 
+    p_monitor->max_read_ms : READ_MONITOR_DEFAULT_READ_MS;
+  if (read_us >= max_read_ms * 1000)
+  {
+    ++p_monitor->file_slow_reads_num;
+  }
+  if (read_us > p_monitor->file_worst_read_us)
+  {
+    p_monitor->file_worst_read_us = read_us;
+    p_monitor->file_worst_read_offset = p_monitor->file_sz;
+  }
+
+  p_monitor->file_sz += sz;
+  p_monitor->file_read_us += read_us;
+}
+
+unsigned int finish_read_monitor_file(st_read_monitor* p_monitor)
+{
+  unsigned int flags = 0;
+  double mb_per_s = 0;
+  double baseline_mb_per_s = 0;
+
+  if (!p_monitor->is_file_pending)
+  {
+    return p_monitor->flags;
+  }
+  p_monitor->is_file_pending = 0;
+
+  if (p_monitor->file_slow_reads_num != 0)
+  {
+    flags |= SLOW_READ_LATENCY;
+  }
+
+  if (p_monitor->file_sz >= READ_MONITOR_MIN_FILE_SZ)
+  {
+    mb_per_s = p_monitor->file_read_us == 0 ? 0 :
+      p_monitor->file_sz / (1024.0 * 1024) / 
+      (p_monitor->file_read_us / 1e6);
+    if (p_monitor->file_read_us != 0 && mb_per_s < p_monitor->min_mb_per_s)
+    {
+      flags |= SLOW_READ_THROUGHPUT;
+    }
+
+    if (p_monitor->baseline_files_num >= READ_MONITOR_BASELINE_FILES)
+    {
+      baseline_mb_per_s = p_monitor->baseline_mb_per_s;
+    }
+
+    if (baseline_mb_per_s != 0 &&
+        mb_per_s * READ_MONITOR_BASELINE_FACTOR < baseline_mb_per_s)
+    {
+      flags |= SLOW_READ_BASELINE;
+    }
+    else if (p_monitor->file_read_us != 0)
+    {
+      // average of the first files, moving average with weight 1/8 then
+      ++p_monitor->baseline_files_num;
+      p_monitor->baseline_mb_per_s += 
+        (mb_per_s - p_monitor->baseline_mb_per_s) / 
+        (p_monitor->baseline_files_num < 8 ? 
+           p_monitor->baseline_files_num : 8);
+    }
+  }
+
+  if (flags == 0)
+  {
+    return p_monitor->flags;
+  }
+
+  if ((flags & (SLOW_READ_THROUGHPUT | SLOW_READ_BASELINE)) != 0 &&
+      ((p_monitor->flags & (SLOW_READ_THROUGHPUT | SLOW_READ_BASELINE)) == 0 ||
+       mb_per_s < p_monitor->mb_per_s))
+  {
+    p_monitor->mb_per_s = mb_per_s;
+    p_monitor->flagged_baseline_mb_per_s = baseline_mb_per_s;
+  }
+  if (p_monitor->file_worst_read_us > p_monitor->worst_read_us)
+  {
+    p_monitor->worst_read_us = p_monitor->file_worst_read_us;
+    p_monitor->worst_read_offset = p_monitor->file_worst_read_offset;
+  }
+  p_monitor->slow_reads_num += p_monitor->file_slow_reads_num;
+  p_monitor->flags |= flags;
+  return p_monitor->flags;
+}
+
+void reset_read_monitor_flags(st_read_monitor* p_monitor)
+{
+  p_monitor->flags = 0;
+  p_monitor->mb_per_s = 0;
+  p_monitor->flagged_baseline_mb_per_s = 0;
+  p_monitor->worst_read_us = 0;
+  p_monitor->worst_read_offset = 0;
+  p_monitor->slow_reads_num = 0;
+}
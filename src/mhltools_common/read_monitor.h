@@ -0,0 +1,114 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: read_monitor.h
+ *
+ * Detection of slowly read media: throughput of each hashed file and
+ * latency of each read are checked against thresholds and against 
+ * the throughput of the files read before.
+ */
+#ifndef _MHL_TOOLS_MHLTOOLS_COMMON_READ_MONITOR_H_
+#define _MHL_TOOLS_MHLTOOLS_COMMON_READ_MONITOR_H_
+
+#include <stddef.h>
+
+// flags of slowly read file
+#define SLOW_READ_THROUGHPUT 1 // read slower than the '--slow-read' speed
+#define SLOW_READ_BASELINE 2   // read much slower than the previous files
+#define SLOW_READ_LATENCY 4    // a read took longer than '--slow-read-ms'
+
+// throughput of smaller files depends on opening and caching more than 
+// on the media, it is not checked
+#define READ_MONITOR_MIN_FILE_SZ (16 * 1024 * 1024)
+// file is flagged if it is read this number of times slower than baseline
+#define READ_MONITOR_BASELINE_FACTOR 4
+// baseline is used when that number of files is read
+#define READ_MONITOR_BASELINE_FILES 3
+// latency of a read, which is flagged if '--slow-read-ms' is not given
+#define READ_MONITOR_DEFAULT_READ_MS 1000
+
+typedef struct _st_read_monitor
+{
+  // thresholds, 0 - throughput is not checked, default latency is used
+  double min_mb_per_s;
+  unsigned long long max_read_ms;
+
+  // moving average of throughput of the previous files not flagged 
+  // as slow ones
+  double baseline_mb_per_s;
+  unsigned long baseline_files_num;
+
+  // the file being read
+  unsigned char is_file_pending;
+  unsigned long long file_sz;
+  unsigned long long file_read_us;
+  unsigned long long file_worst_read_us;
+  unsigned long long file_worst_read_offset;
+  unsigned long file_slow_reads_num;
+
+  // flagged reads of the files, which are not reported yet
+  unsigned int flags;
+  double mb_per_s; // the lowest throughput
+  double flagged_baseline_mb_per_s; // 0 if there was no baseline yet
+  unsigned long long worst_read_us;
+  unsigned long long worst_read_offset;
+  unsigned long slow_reads_num;
+} st_read_monitor;
+
+/* Parses value of the '--slow-read' option: throughput in MB/s.
+ * @return In case of success: 0.
+ *         In case of failure: ERRCODE_WRONG_ARGUMENTS.
+ */
+int parse_slow_read_speed(const char* str, st_read_monitor* p_monitor);
+
+/* Parses value of the '--slow-read-ms' option: latency in milliseconds.
+ * @return In case of success: 0.
+ *         In case of failure: ERRCODE_WRONG_ARGUMENTS.
+ */
+int parse_slow_read_ms(const char* str, st_read_monitor* p_monitor);
+
+/* Starts checking of the next file, the previous one is finished.
+ */
+void begin_read_monitor_file(st_read_monitor* p_monitor);
+
+/* Checks a read of the current file.
+ */
+void monitor_read(st_read_monitor* p_monitor, size_t sz, 
+                  unsigned long long read_us);
+
+/* Checks throughput of the current file and updates baseline.
+ * Flagged reads of the file are added to the not reported ones,
+ * nothing is done if there is no current file.
+ * @return SLOW_READ_* flags of the not reported reads, 0 if they are 
+ *         not slow.
+ */
+unsigned int finish_read_monitor_file(st_read_monitor* p_monitor);
+
+/* Forgets flagged reads after they are reported.
+ */
+void reset_read_monitor_flags(st_read_monitor* p_monitor);
+
+#endif //_MHL_TOOLS_MHLTOOLS_COMMON_READ_MONITOR_H_
@@ -0,0 +1,418 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: report_writer.c
+ *
+ * Report of results of hashed and verified files.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/memory_management.h>
+#include <generics/filesystem_handlers/public_interface.h>
+#include <mhltools_common/report_writer.h>
+
+static const char g_csv_header[] = 
+  "path,root,size,algorithm,expected,actual,status,error_code,error,"
+  "read_ms\n";
+
+int parse_report_format(const char* str, REPORT_FORMAT* p_format)
+{
+  if (str == NULL)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (strcmp(str, "jsonl") == 0)
+  {
+    *p_format = RF_JSONL;
+  }
+  else if (strcmp(str, "csv") == 0)
+  {
+    *p_format = RF_CSV;
+  }
+  else
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+  return 0;
+}
+
+static
+void
+aux_flush_report(st_report_writer* p_writer)
+{
+  if (p_writer->buff_len != 0 && p_writer->res == 0 &&
+      fwrite(p_writer->buff, 1, p_writer->buff_len, p_writer->file) != 
+        p_writer->buff_len)
+  {
+    p_writer->res = ERRCODE_IO_ERROR;
+  }
+  p_writer->buff_len = 0;
+}
+
+/* Makes space for sz bytes in the buffer, writing out the collected 
+ * records if needed. The buffer grows only for a record larger than it.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+static
+int
+aux_reserve_report_space(st_report_writer* p_writer, size_t sz)
+{
+  if (p_writer->buff_len + sz <= p_writer->buff_capacity)
+  {
+    return 0;
+  }
+
+  aux_flush_report(p_writer);
+  if (sz <= p_writer->buff_capacity)
+  {
+    return 0;
+  }
+
+  return increase_allocated_memory((void**) &p_writer->buff,
+                                   &p_writer->buff_capacity, sz, 
+                                   sizeof(char));
+}
+
+static
+void
+aux_append_char(st_report_writer* p_writer, char c)
+{
+  p_writer->buff[p_writer->buff_len++] = c;
+}
+
+/* Appends character as escaped in JSON string or CSV field.
+ */
+static
+void
+aux_append_escaped_char(st_report_writer* p_writer, unsigned char c)
+{
+  if (p_writer->format == RF_CSV)
+  {
+    if (c == '"')
+    {
+      aux_append_char(p_writer, '"');
+    }
+    aux_append_char(p_writer, (char) c);
+    return;
+  }
+
+  if (c < 0x20)
+  {
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, "\\u%04x", c);
+    return;
+  }
+  if (c == '"' || c == '\\')
+  {
+    aux_append_char(p_writer, '\\');
+  }
+  aux_append_char(p_writer, (char) c);
+}
+
+/* Appends quoted string, or null in JSON and empty field in CSV for NULL.
+ */
+static
+void
+aux_append_string(st_report_writer* p_writer, const char* str)
+{
+  if (str == NULL)
+  {
+    if (p_writer->format == RF_JSONL)
+    {
+      memcpy(p_writer->buff + p_writer->buff_len, "null", 4);
+      p_writer->buff_len += 4;
+    }
+    return;
+  }
+
+  aux_append_char(p_writer, '"');
+  for (; *str != '\0'; ++str)
+  {
+    aux_append_escaped_char(p_writer, (unsigned char) *str);
+  }
+  aux_append_char(p_writer, '"');
+}
+
+/* Appends quoted path encoded in UTF-8, or the same as 
+ * aux_append_string() for NULL.
+ */
+static
+void
+aux_append_wpath(st_report_writer* p_writer, const wchar_t* wpath)
+{
+  size_t i;
+  size_t wpath_len;
+  unsigned long c;
+
+  if (wpath == NULL)
+  {
+    aux_append_string(p_writer, NULL);
+    return;
+  }
+
+  wpath_len = wcslen(wpath);
+  aux_append_char(p_writer, '"');
+  for (i = 0; i < wpath_len; ++i)
+  {
+    c = (unsigned long) wpath[i];
+#ifdef WIN
+    // UTF-16 surrogate pair
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < wpath_len &&
+        wpath[i + 1] >= 0xDC00 && wpath[i + 1] <= 0xDFFF)
+    {
+      c = 0x10000 + ((c - 0xD800) << 10) + (wpath[i + 1] - 0xDC00);
+      ++i;
+    }
+#endif
+    if (c < 0x80)
+    {
+      aux_append_escaped_char(p_writer, (unsigned char) c);
+    }
+    else if (c < 0x800)
+    {
+      aux_append_char(p_writer, (char) (0xC0 | (c >> 6)));
+      aux_append_char(p_writer, (char) (0x80 | (c & 0x3F)));
+    }
+    else if (c < 0x10000)
+    {
+      aux_append_char(p_writer, (char) (0xE0 | (c >> 12)));
+      aux_append_char(p_writer, (char) (0x80 | ((c >> 6) & 0x3F)));
+      aux_append_char(p_writer, (char) (0x80 | (c & 0x3F)));
+    }
+    else
+    {
+      aux_append_char(p_writer, (char) (0xF0 | ((c >> 18) & 0x07)));
+      aux_append_char(p_writer, (char) (0x80 | ((c >> 12) & 0x3F)));
+      aux_append_char(p_writer, (char) (0x80 | ((c >> 6) & 0x3F)));
+      aux_append_char(p_writer, (char) (0x80 | (c & 0x3F)));
+    }
+  }
+  aux_append_char(p_writer, '"');
+}
+
+const wchar_t*
+get_report_rel_wpath(const wchar_t* root_wpath, const wchar_t* abs_wpath)
+{
+  size_t len;
+
+  if (root_wpath == NULL)
+  {
+    return NULL;
+  }
+
+  len = wcslen(root_wpath);
+  while (len != 0 && root_wpath[len - 1] == WPATH_SEPARATOR)
+  {
+    --len;
+  }
+  if (wcsncmp(root_wpath, abs_wpath, len) != 0 || 
+      abs_wpath[len] != WPATH_SEPARATOR)
+  {
+    return NULL;
+  }
+
+  return abs_wpath + len + 1;
+}
+
+int open_report_writer(const char* path, REPORT_FORMAT format,
+                       st_report_writer** pp_writer)
+{
+  int res;
+  st_report_writer* p_writer;
+
+  p_writer = (st_report_writer*) calloc(1, sizeof(st_report_writer));
+  if (p_writer == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  p_writer->buff = (char*) malloc(REPORT_BUFF_SZ);
+  if (p_writer->buff == NULL)
+  {
+    free(p_writer);
+    return ERRCODE_OUT_OF_MEM;
+  }
+  p_writer->buff_capacity = REPORT_BUFF_SZ;
+  p_writer->format = format;
+
+  res = mhlosi_mutex_init(&p_writer->mutex);
+  if (res != 0)
+  {
+    free(p_writer->buff);
+    free(p_writer);
+    return res;
+  }
+
+  p_writer->file = fopen(path, "wb");
+  if (p_writer->file == NULL)
+  {
+    mhlosi_mutex_destroy(&p_writer->mutex);
+    free(p_writer->buff);
+    free(p_writer);
+    return ERRCODE_IO_ERROR;
+  }
+  // records are collected in the own buffer
+  setvbuf(p_writer->file, NULL, _IONBF, 0);
+
+  if (format == RF_CSV)
+  {
+    memcpy(p_writer->buff, g_csv_header, sizeof(g_csv_header) - 1);
+    p_writer->buff_len = sizeof(g_csv_header) - 1;
+  }
+
+  *pp_writer = p_writer;
+  return 0;
+}
+
+void write_report_record(st_report_writer* p_writer,
+                         const st_report_record* p_record)
+{
+  const char* status;
+  const char* algorithm;
+  const char* actual_hash;
+  const char* error;
+  const wchar_t* rel_wpath;
+  const wchar_t* root_wpath;
+  size_t max_sz;
+
+  if (p_record->err_code != 0)
+  {
+    status = "FAILED";
+    error = mhl_error_code_description(p_record->err_code);
+  }
+  else
+  {
+    status = p_record->is_from_cache ? "CACHED" : "OK";
+    error = NULL;
+  }
+  algorithm = p_record->hash_type != MHL_HT_UNRECOGNIZED ? 
+    mhl_hash_type_name(p_record->hash_type) : NULL;
+  actual_hash = p_record->u8str_actual_hash[0] != '\0' ? 
+    p_record->u8str_actual_hash : NULL;
+
+  rel_wpath = get_report_rel_wpath(p_record->root_wpath, p_record->abs_wpath);
+  root_wpath = p_record->root_wpath;
+  if (rel_wpath == NULL)
+  {
+    rel_wpath = p_record->abs_wpath;
+    root_wpath = NULL;
+  }
+
+  // each byte of strings may be escaped with up to 6 bytes
+  max_sz = 256 + 6 * (4 * wcslen(p_record->abs_wpath) + 
+    (root_wpath != NULL ? 4 * wcslen(root_wpath) : 0) +
+    (error != NULL ? strlen(error) : 0) +
+    (p_record->u8str_expected_hash != NULL ? 
+       strlen(p_record->u8str_expected_hash) : 0) +
+    REPORT_HASH_STR_SZ);
+
+  mhlosi_mutex_lock(&p_writer->mutex);
+  if (aux_reserve_report_space(p_writer, max_sz) != 0)
+  {
+    p_writer->res = ERRCODE_OUT_OF_MEM;
+    mhlosi_mutex_unlock(&p_writer->mutex);
+    return;
+  }
+
+  if (p_writer->format == RF_JSONL)
+  {
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, "{\"path\": ");
+    aux_append_wpath(p_writer, rel_wpath);
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, ", \"root\": ");
+    aux_append_wpath(p_writer, root_wpath);
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, 
+              ", \"size\": %llu, \"algorithm\": ", p_record->file_sz);
+    aux_append_string(p_writer, algorithm);
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, ", \"expected\": ");
+    aux_append_string(p_writer, p_record->u8str_expected_hash);
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, ", \"actual\": ");
+    aux_append_string(p_writer, actual_hash);
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, 
+              ", \"status\": \"%s\", \"error_code\": %d, \"error\": ", 
+              status, p_record->err_code);
+    aux_append_string(p_writer, error);
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, 
+              ", \"read_ms\": %.3f}\n", p_record->read_us / 1000.0);
+  }
+  else
+  {
+    aux_append_wpath(p_writer, rel_wpath);
+    aux_append_char(p_writer, ',');
+    aux_append_wpath(p_writer, root_wpath);
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, ",%llu,", 
+              p_record->file_sz);
+    aux_append_string(p_writer, algorithm);
+    aux_append_char(p_writer, ',');
+    aux_append_string(p_writer, p_record->u8str_expected_hash);
+    aux_append_char(p_writer, ',');
+    aux_append_string(p_writer, actual_hash);
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, ",%s,%d,", 
+              status, p_record->err_code);
+    aux_append_string(p_writer, error);
+    p_writer->buff_len += 
+      sprintf(p_writer->buff + p_writer->buff_len, ",%.3f\n", 
+              p_record->read_us / 1000.0);
+  }
+  mhlosi_mutex_unlock(&p_writer->mutex);
+}
+
+int close_report_writer(st_report_writer* p_writer)
+{
+  int res;
+
+  if (p_writer == NULL)
+  {
+    return 0;
+  }
+
+  aux_flush_report(p_writer);
+  res = p_writer->res;
+  if (fclose(p_writer->file) != 0 && res == 0)
+  {
+    res = ERRCODE_IO_ERROR;
+  }
+
+  mhlosi_mutex_destroy(&p_writer->mutex);
+  free(p_writer->buff);
+  free(p_writer);
+  return res;
+}
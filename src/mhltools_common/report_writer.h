@@ -0,0 +1,113 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: report_writer.h
+ *
+ * Report of results of hashed and verified files: one record per file
+ * in JSON Lines or CSV format. Records are collected in a large buffer
+ * of the report, so they are written in a few calls, and may be added
+ * from several threads.
+ */
+#ifndef _MHL_TOOLS_MHLTOOLS_COMMON_REPORT_WRITER_H_
+#define _MHL_TOOLS_MHLTOOLS_COMMON_REPORT_WRITER_H_
+
+#include <stdio.h>
+#include <wchar.h>
+#include <generics/os_threads.h>
+#include <mhltools_common/mhl_types.h>
+
+// size of buffer, records are written when it is filled
+#define REPORT_BUFF_SZ (1024 * 1024)
+// size of digest string, including terminating zero
+#define REPORT_HASH_STR_SZ 64
+
+typedef enum _REPORT_FORMAT
+{
+  RF_JSONL = 0,
+  RF_CSV
+} REPORT_FORMAT;
+
+typedef struct _st_report_record
+{
+  // the path is reported relative to the folder of its MHL file, which
+  // is reported as root; NULL root if the file is outside of it
+  const wchar_t* root_wpath;
+  const wchar_t* abs_wpath;
+  unsigned long long file_sz;
+  MHL_HASH_TYPE hash_type; // MHL_HT_UNRECOGNIZED if file is not hashed
+  const char* u8str_expected_hash; // NULL if there is nothing to compare
+  char u8str_actual_hash[REPORT_HASH_STR_SZ]; // empty if not calculated
+  int err_code; // 0 if file is processed successfully
+  unsigned char is_from_cache;
+  unsigned long long read_us;
+} st_report_record;
+
+typedef struct _st_report_writer
+{
+  FILE* file;
+  REPORT_FORMAT format;
+  mhlosi_mutex mutex;
+
+  char* buff;
+  size_t buff_len;
+  size_t buff_capacity;
+
+  int res; // the first error of writing, reported on close
+} st_report_writer;
+
+/* Parses value of the '--report-format' option: "jsonl" or "csv".
+ * @return In case of success: 0.
+ *         In case of failure: ERRCODE_WRONG_ARGUMENTS.
+ */
+int parse_report_format(const char* str, REPORT_FORMAT* p_format);
+
+/* @return Part of abs_wpath after root_wpath, or NULL if abs_wpath is not 
+ * inside of root_wpath. Both paths must be absolute and normalized.
+ */
+const wchar_t*
+get_report_rel_wpath(const wchar_t* root_wpath, const wchar_t* abs_wpath);
+
+/* Creates report file, CSV report starts with the line of column names.
+ * @return In case of success: 0, *pp_writer is set.
+ *         In case of failure: non zero value with error code.
+ */
+int open_report_writer(const char* path, REPORT_FORMAT format,
+                       st_report_writer** pp_writer);
+
+/* Adds record to the report, may be called from several threads.
+ * Errors of writing are kept until the report is closed.
+ */
+void write_report_record(st_report_writer* p_writer,
+                         const st_report_record* p_record);
+
+/* Writes the rest of records, closes the report and releases the writer.
+ * Nothing is done for NULL.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int close_report_writer(st_report_writer* p_writer);
+
+#endif //_MHL_TOOLS_MHLTOOLS_COMMON_REPORT_WRITER_H_
@@ -37,36 +37,46 @@ void print_version()
 void mhlfile_usage()
 {
   printf("Usage: \n"
-         "mhl file [-v | -vv] "/*[-y]*/" -s [-o <path>]...\n"
-         "mhl file [-v | -vv] "/*[-y]*/" -f FILE [-o <path>]...\n\n");
-//         "mhl file [-v | -vv] "/*[-y]*/" -p MHL_FILE\n"
+         "mhl file [-v | -vv] "/*[-y]*/" -s [-z] [-o <path>]...\n"
+         "mhl file [-v | -vv] "/*[-y]*/" -f FILE [-z] [-o <path>]...\n"
+         "mhl file -p MHL_FILE [-0]\n\n");
 }
 
 void mhlhash_usage()
 {
   printf("Usage: \n"
          "mhl hash [-v | -vv] "/*[-y]*/" -f FILE -h [md5|sha1] HASH\n"
-         "mhl hash [-v | -vv] "/*[-y]*/" [-m] [-#] [-t] [md5|sha1] FILEPATTERNS...\n\n");
+         "mhl hash [-v | -vv] "/*[-y]*/" [-m] [-#] [-t] [md5|sha1] [--jobs N] FILEPATTERNS...\n"
+         "mhl hash [-v | -vv] -s [--jobs N] [LIST_FILE]\n\n");
 }
 
 void mhlseal_usage()
 {
   printf("Usage: \n"
-         "mhl seal [-v | -vv] "/*[-y] [-m] */"[-#] [-t] [md5|sha1] [-o <path>]... FILEPATTERNS... \n\n");
+         "mhl seal [-v | -vv] "/*[-y] [-m] */"[-#] [-t] [md5|sha1] [-z] [--slow-read MBPS] [--slow-read-ms MS] [--report FILE [--report-format jsonl|csv]] [--log-limit MB] [--log-summary] [-o <path>]... FILEPATTERNS... \n\n");
+}
+
+void mhlcopy_usage()
+{
+  printf("Usage: \n"
+         "mhl copy [-v | -vv] [-t] [md5|sha1] [-z] [--verify] [--log-limit MB] [--log-summary] -d <path> [-d <path>]... FILES|FOLDERS... \n\n");
 }
 
 void mhlverify_usage()
 {
   printf("Usage: \n"
-         "mhl verify [-v | -vv] "/*[-y]*/" [-e] [-f MHL_FILE[.mhl|.md5|.sha1]] [FILE...]\n\n");
+         "mhl verify [-v | -vv] "/*[-y]*/" [-e | --all-hashes] [-i | --index-dir DIR] [--cache FILE [--max-cache-age AGE]] [--slow-read MBPS] [--slow-read-ms MS] [--report FILE [--report-format jsonl|csv]] [-f MHL_FILE[.mhl|.mhl.gz|.md5|.sha1]] [FILE...]\n"
+         "mhl verify [-v | -vv] [-e | --all-hashes] [-i | --index-dir DIR] -f MHL_FILE[.mhl|.mhl.gz|.md5|.sha1] --root DIR [--root DIR...]\n"
+         "mhl verify [-v | -vv] [-e | --all-hashes] [-i | --index-dir DIR] [--cache FILE [--max-cache-age AGE]] --discover-all FOLDER\n\n");
 }
 
 void mhl_usage()
 {
   printf("Usage: \n\n"
-    "1. mhl [--version] <command> [<args>]\n"
+    "1. mhl [--version] [--stats FILE] [--trace FILE] <command> [<args>]\n"
     "The available commands are:\n"
     "   seal - Seal folders and files\n"
+    "   copy - Copy folders and files and seal the copies\n"
     "   verify - Verify folders and MHL files\n"
 /*    "   hash - Create and verify hashes (via stdin/stdout)\n" */
 /*    "   file - Create and parse MHL files (via stdin/stdout)\n\n" */
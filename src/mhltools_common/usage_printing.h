@@ -34,6 +34,7 @@ void mhlhash_usage();
 void mhlverify_usage();
 
 void mhlseal_usage();
+void mhlcopy_usage();
 
 void mhl_usage();
 
@@ -0,0 +1,739 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/os_check.h>
+#include <generics/os_threads.h>
+#include <generics/std_funcs_os_anonymizer.h>
+#include <generics/error_output.h>
+#include <generics/filesystem_handlers/public_interface.h>
+#include <mhltools_common/xxhash.h>
+
+#include "mhl_discovery.h"
+
+#define MHL_DISCOVERY_WDIRS_MIN_NUM 64
+#define MHL_DISCOVERY_MAX_JOBS 8
+
+static int
+aux_is_mhl_wname(const wchar_t* wname, const wchar_t* wext)
+{
+  size_t i;
+  size_t wname_len = wcslen(wname);
+  size_t wext_len = wcslen(wext);
+  
+  if (wext_len > wname_len)
+  {
+    return 0;
+  }
+  
+  wname += wname_len - wext_len;
+  for (i = 0; i < wext_len; ++i)
+  {
+#ifdef WIN
+    if (towlower(wname[i]) != towlower(wext[i]))
+#else
+    if (wname[i] != wext[i])
+#endif
+    {
+      return 0;
+    }
+  }
+  
+  return 1;
+}
+
+static int
+aux_push_wpath(
+  wchar_t*** p_wpaths, 
+  size_t* p_wpaths_num, 
+  size_t* p_wpaths_capacity,
+  wchar_t* wpath)
+{
+  int res;
+  
+  if (*p_wpaths_num == *p_wpaths_capacity)
+  {
+    res = 
+      increase_allocated_memory((void**) p_wpaths, p_wpaths_capacity, 
+                                *p_wpaths_capacity ? 
+                                  *p_wpaths_capacity * 2 : 16,
+                                sizeof(wchar_t*));
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+  
+  (*p_wpaths)[(*p_wpaths_num)++] = wpath;
+  return 0;
+}
+
+static void
+aux_free_wpaths(wchar_t** wpaths, size_t wpaths_num)
+{
+  size_t i;
+  
+  for (i = 0; i < wpaths_num; ++i)
+  {
+    free(wpaths[i]);
+  }
+  free(wpaths);
+}
+
+//---------------------------------------------------------
+//
+// Search for MHL file of a file
+//
+//---------------------------------------------------------
+
+typedef struct _st_mhl_wdir_listing
+{
+  wchar_t* mhl_wname;    // first plain MHL file
+  wchar_t* mhl_gz_wname; // first gzip-compressed MHL file
+} st_mhl_wdir_listing;
+
+static int
+aux_receive_mhl_wname(
+  const wchar_t* entry_wname, 
+  DIR_ENTRY_TYPE_FLAGS entry_type,
+  void* data)
+{
+  st_mhl_wdir_listing* p_listing = (st_mhl_wdir_listing*) data;
+  
+  if (entry_type != DETF_FILE)
+  {
+    return 0;
+  }
+  
+  if (aux_is_mhl_wname(entry_wname, MHL_FILE_WPATTERN))
+  {
+    p_listing->mhl_wname = mhlosi_wstrdup(entry_wname);
+    if (p_listing->mhl_wname == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+    
+    // First mhl file found. It will be parsed. No need other mhl files.
+    return ERRCODE_STOP_SEARCH;
+  }
+  
+  if (p_listing->mhl_gz_wname == NULL && 
+      aux_is_mhl_wname(entry_wname, MHL_GZ_FILE_WPATTERN))
+  {
+    // it is used if there is no plain MHL file
+    p_listing->mhl_gz_wname = mhlosi_wstrdup(entry_wname);
+    if (p_listing->mhl_gz_wname == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+  }
+  
+  return 0;
+}
+
+/* Looks for MHL file in the folder, one listing of the folder is done. 
+ * @param mhl_file_wpath - [out] path to MHL file, NULL if there is no one.
+ */
+static int
+aux_search_mhl_wfile_in_wdir(
+  const wchar_t* wdir,
+  wchar_t** mhl_file_wpath,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  st_mhl_wdir_listing listing;
+  
+  *mhl_file_wpath = NULL;
+  listing.mhl_wname = NULL;
+  listing.mhl_gz_wname = NULL;
+  
+  res = list_entries_in_wdir(wdir, p_cs, &listing, aux_receive_mhl_wname);
+  if (res == 0 && 
+      (listing.mhl_wname != NULL || listing.mhl_gz_wname != NULL))
+  {
+    res = 
+      concat_wpath_parts(wdir, 
+                         listing.mhl_wname != NULL ? 
+                           listing.mhl_wname : listing.mhl_gz_wname,
+                         mhl_file_wpath);
+  }
+  
+  free(listing.mhl_wname);
+  free(listing.mhl_gz_wname);
+  return res;
+}
+
+void init_mhl_discovery_cache(st_mhl_discovery_cache* p_cache)
+{
+  p_cache->wdirs = NULL;
+  p_cache->wdirs_capacity = 0;
+  p_cache->wdirs_num = 0;
+  init_memory_arena(&p_cache->wstrings_arena, 0);
+}
+
+void free_mhl_discovery_cache(st_mhl_discovery_cache* p_cache)
+{
+  free(p_cache->wdirs);
+  free_memory_arena(&p_cache->wstrings_arena);
+  p_cache->wdirs = NULL;
+  p_cache->wdirs_capacity = 0;
+  p_cache->wdirs_num = 0;
+}
+
+static unsigned int
+aux_wdir_hash(const wchar_t* wdir)
+{
+  return XXH32(wdir, wcslen(wdir) * sizeof(wchar_t), 0);
+}
+
+static const st_mhl_discovery_wdir*
+aux_find_wdir(
+  const st_mhl_discovery_cache* p_cache, 
+  const wchar_t* wdir, 
+  unsigned int wdir_hash)
+{
+  size_t i;
+  size_t mask;
+  
+  if (p_cache->wdirs_capacity == 0)
+  {
+    return NULL;
+  }
+  
+  mask = p_cache->wdirs_capacity - 1;
+  for (i = wdir_hash & mask; p_cache->wdirs[i].wdir != NULL; 
+       i = (i + 1) & mask)
+  {
+    if (p_cache->wdirs[i].wdir_hash == wdir_hash && 
+        wcscmp(p_cache->wdirs[i].wdir, wdir) == 0)
+    {
+      return &p_cache->wdirs[i];
+    }
+  }
+  
+  return NULL;
+}
+
+static void
+aux_put_wdir(
+  st_mhl_discovery_wdir* wdirs, 
+  size_t wdirs_capacity,
+  const st_mhl_discovery_wdir* p_wdir)
+{
+  size_t i;
+  size_t mask = wdirs_capacity - 1;
+  
+  for (i = p_wdir->wdir_hash & mask; wdirs[i].wdir != NULL; 
+       i = (i + 1) & mask)
+  {
+  }
+  
+  wdirs[i] = *p_wdir;
+}
+
+static const wchar_t*
+aux_arena_wstrdup(st_memory_arena* p_arena, const wchar_t* ws)
+{
+  size_t ws_sz = (wcslen(ws) + 1) * sizeof(wchar_t);
+  wchar_t* dst;
+  
+  dst = (wchar_t*) memory_arena_alloc(p_arena, ws_sz);
+  if (dst != NULL)
+  {
+    memcpy(dst, ws, ws_sz);
+  }
+  
+  return dst;
+}
+
+static int
+aux_add_wdir(
+  st_mhl_discovery_cache* p_cache, 
+  const wchar_t* wdir, 
+  const wchar_t* mhl_wpath) // already in the arena
+{
+  size_t i;
+  size_t new_capacity;
+  st_mhl_discovery_wdir* new_wdirs;
+  st_mhl_discovery_wdir wdir_data;
+  
+  // keep load factor not more than 3/4
+  if ((p_cache->wdirs_num + 1) * 4 > p_cache->wdirs_capacity * 3)
+  {
+    new_capacity = 
+      p_cache->wdirs_capacity ? 
+        p_cache->wdirs_capacity * 2 : MHL_DISCOVERY_WDIRS_MIN_NUM;
+    new_wdirs = 
+      (st_mhl_discovery_wdir*) calloc(new_capacity, 
+                                      sizeof(st_mhl_discovery_wdir));
+    if (new_wdirs == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+    
+    for (i = 0; i < p_cache->wdirs_capacity; ++i)
+    {
+      if (p_cache->wdirs[i].wdir != NULL)
+      {
+        aux_put_wdir(new_wdirs, new_capacity, &p_cache->wdirs[i]);
+      }
+    }
+    
+    free(p_cache->wdirs);
+    p_cache->wdirs = new_wdirs;
+    p_cache->wdirs_capacity = new_capacity;
+  }
+  
+  wdir_data.wdir = aux_arena_wstrdup(&p_cache->wstrings_arena, wdir);
+  if (wdir_data.wdir == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  wdir_data.mhl_wpath = mhl_wpath;
+  wdir_data.wdir_hash = aux_wdir_hash(wdir);
+  
+  aux_put_wdir(p_cache->wdirs, p_cache->wdirs_capacity, &wdir_data);
+  ++p_cache->wdirs_num;
+  return 0;
+}
+
+int search_mhl_wfile_cached(
+  st_mhl_discovery_cache* p_cache,
+  const wchar_t* file_wpath, 
+  wchar_t** mhl_file_wpath,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  size_t i;
+  const wchar_t* inner_wpath;
+  wchar_t* outer_wpath = NULL;
+  wchar_t* found_wpath = NULL;
+  const wchar_t* mhl_wpath = NULL;
+  const st_mhl_discovery_wdir* p_wdir;
+  // folders looked through by this call, they get the same MHL file
+  wchar_t** new_wdirs = NULL;
+  size_t new_wdirs_num = 0;
+  size_t new_wdirs_capacity = 0;
+  
+  *mhl_file_wpath = NULL;
+  inner_wpath = file_wpath;
+  
+  for (;;)
+  {
+    res = extract_wdir_from_wpath(inner_wpath, &outer_wpath);
+    if (res != 0 || outer_wpath == NULL)
+    {
+      // error or root reached
+      free(outer_wpath);
+      break;
+    }
+    
+    p_wdir = aux_find_wdir(p_cache, outer_wpath, aux_wdir_hash(outer_wpath));
+    if (p_wdir != NULL)
+    {
+      mhl_wpath = p_wdir->mhl_wpath;
+      free(outer_wpath);
+      break;
+    }
+    
+    res = 
+      aux_push_wpath(&new_wdirs, &new_wdirs_num, &new_wdirs_capacity, 
+                     outer_wpath);
+    if (res != 0)
+    {
+      free(outer_wpath);
+      break;
+    }
+    
+    res = aux_search_mhl_wfile_in_wdir(outer_wpath, &found_wpath, p_cs);
+    if (res != 0)
+    {
+      break;
+    }
+    
+    if (found_wpath != NULL)
+    {
+      mhl_wpath = aux_arena_wstrdup(&p_cache->wstrings_arena, found_wpath);
+      free(found_wpath);
+      if (mhl_wpath == NULL)
+      {
+        res = ERRCODE_OUT_OF_MEM;
+      }
+      break;
+    }
+    
+    inner_wpath = outer_wpath;
+  }
+  
+  for (i = 0; i < new_wdirs_num && res == 0; ++i)
+  {
+    res = aux_add_wdir(p_cache, new_wdirs[i], mhl_wpath);
+  }
+  aux_free_wpaths(new_wdirs, new_wdirs_num);
+  
+  if (res != 0)
+  {
+    return res;
+  }
+  
+  if (mhl_wpath == NULL)
+  {
+    return ERRCODE_MHL_NOT_FOUND;
+  }
+  
+  *mhl_file_wpath = mhlosi_wstrdup(mhl_wpath);
+  return *mhl_file_wpath == NULL ? ERRCODE_OUT_OF_MEM : 0;
+}
+
+int search_mhl_wfile( 
+  const wchar_t* file_wpath, 
+  wchar_t** mhl_file_wpath,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  st_mhl_discovery_cache cache;
+  
+  init_mhl_discovery_cache(&cache);
+  res = search_mhl_wfile_cached(&cache, file_wpath, mhl_file_wpath, p_cs);
+  free_mhl_discovery_cache(&cache);
+  
+  return res;
+}
+
+//---------------------------------------------------------
+//
+// Search for all MHL files in a tree
+//
+//---------------------------------------------------------
+
+typedef struct _st_mhl_discovery_walk
+{
+  mhlosi_mutex mutex;
+  mhlosi_cond cond; // signaled when folders are queued or the walk is over
+  
+  // folders to be listed
+  wchar_t** pending_wdirs;
+  size_t pending_wdirs_num;
+  size_t pending_wdirs_capacity;
+  unsigned int busy_jobs;
+  
+  wchar_t** mhl_wpaths;
+  size_t mhl_wpaths_num;
+  size_t mhl_wpaths_capacity;
+  size_t failed_wdirs_num;
+  int res;
+} st_mhl_discovery_walk;
+
+// Entries of one folder, collected by one job without locking
+typedef struct _st_mhl_walk_listing
+{
+  const wchar_t* wdir;
+  wchar_t** wdirs;
+  size_t wdirs_num;
+  size_t wdirs_capacity;
+  wchar_t** mhl_wpaths;
+  size_t mhl_wpaths_num;
+  size_t mhl_wpaths_capacity;
+} st_mhl_walk_listing;
+
+static int
+aux_receive_walk_entry(
+  const wchar_t* entry_wname, 
+  DIR_ENTRY_TYPE_FLAGS entry_type,
+  void* data)
+{
+  int res;
+  wchar_t* entry_wpath;
+  st_mhl_walk_listing* p_listing = (st_mhl_walk_listing*) data;
+  
+  if (entry_type != DETF_DIR && 
+      (entry_type != DETF_FILE || 
+       (!aux_is_mhl_wname(entry_wname, MHL_FILE_WPATTERN) &&
+        !aux_is_mhl_wname(entry_wname, MHL_GZ_FILE_WPATTERN))))
+  {
+    return 0;
+  }
+  
+  res = concat_wpath_parts(p_listing->wdir, entry_wname, &entry_wpath);
+  if (res != 0)
+  {
+    return res;
+  }
+  
+  if (entry_type == DETF_DIR)
+  {
+    res = 
+      aux_push_wpath(&p_listing->wdirs, &p_listing->wdirs_num, 
+                     &p_listing->wdirs_capacity, entry_wpath);
+  }
+  else
+  {
+    res = 
+      aux_push_wpath(&p_listing->mhl_wpaths, &p_listing->mhl_wpaths_num, 
+                     &p_listing->mhl_wpaths_capacity, entry_wpath);
+  }
+  
+  if (res != 0)
+  {
+    free(entry_wpath);
+  }
+  
+  return res;
+}
+
+/* Moves collected paths from the listing. Must be called under the lock.
+ */
+static int
+aux_move_wpaths(
+  wchar_t** src_wpaths,
+  size_t* p_src_wpaths_num,
+  wchar_t*** p_dst_wpaths, 
+  size_t* p_dst_wpaths_num, 
+  size_t* p_dst_wpaths_capacity)
+{
+  int res;
+  
+  while (*p_src_wpaths_num > 0)
+  {
+    res = 
+      aux_push_wpath(p_dst_wpaths, p_dst_wpaths_num, p_dst_wpaths_capacity,
+                     src_wpaths[*p_src_wpaths_num - 1]);
+    if (res != 0)
+    {
+      return res;
+    }
+    --*p_src_wpaths_num;
+  }
+  
+  return 0;
+}
+
+static void
+aux_walk_job(void* arg)
+{
+  int res;
+  int cs_res;
+  wchar_t* wdir;
+  st_conversion_settings cs;
+  st_mhl_walk_listing listing;
+  st_mhl_discovery_walk* p_walk = (st_mhl_discovery_walk*) arg;
+  
+  memset(&listing, 0, sizeof(listing));
+  
+  // conversion settings can't be shared between threads
+  cs_res = init_st_conversion_settings(&cs);
+  
+  mhlosi_mutex_lock(&p_walk->mutex);
+  if (cs_res != 0 && p_walk->res == 0)
+  {
+    p_walk->res = cs_res;
+  }
+  
+  for (;;)
+  {
+    while (p_walk->pending_wdirs_num == 0 && p_walk->busy_jobs > 0 && 
+           p_walk->res == 0)
+    {
+      mhlosi_cond_wait(&p_walk->cond, &p_walk->mutex);
+    }
+    
+    if (p_walk->pending_wdirs_num == 0 || p_walk->res != 0)
+    {
+      // nothing to do and nobody will queue more folders, or failure
+      break;
+    }
+    
+    wdir = p_walk->pending_wdirs[--p_walk->pending_wdirs_num];
+    ++p_walk->busy_jobs;
+    mhlosi_mutex_unlock(&p_walk->mutex);
+    
+    listing.wdir = wdir;
+    res = list_entries_in_wdir(wdir, &cs, &listing, aux_receive_walk_entry);
+    
+    mhlosi_mutex_lock(&p_walk->mutex);
+    --p_walk->busy_jobs;
+    if (res == ERRCODE_OUT_OF_MEM)
+    {
+      p_walk->res = res;
+    }
+    else if (res != 0)
+    {
+      error_printf(
+        "Warning: Cannot read folder '%ls': %s. Skipping...\n", 
+        wdir, mhl_error_code_description(res));
+      ++p_walk->failed_wdirs_num;
+    }
+    free(wdir);
+    
+    res = 
+      aux_move_wpaths(listing.wdirs, &listing.wdirs_num,
+                      &p_walk->pending_wdirs, &p_walk->pending_wdirs_num, 
+                      &p_walk->pending_wdirs_capacity);
+    if (res == 0)
+    {
+      res = 
+        aux_move_wpaths(listing.mhl_wpaths, &listing.mhl_wpaths_num,
+                        &p_walk->mhl_wpaths, &p_walk->mhl_wpaths_num, 
+                        &p_walk->mhl_wpaths_capacity);
+    }
+    if (res != 0 && p_walk->res == 0)
+    {
+      p_walk->res = res;
+    }
+    
+    mhlosi_cond_broadcast(&p_walk->cond);
+  }
+  
+  mhlosi_cond_broadcast(&p_walk->cond);
+  mhlosi_mutex_unlock(&p_walk->mutex);
+  
+  // the rest is left after failure only
+  aux_free_wpaths(listing.wdirs, listing.wdirs_num);
+  aux_free_wpaths(listing.mhl_wpaths, listing.mhl_wpaths_num);
+  if (cs_res == 0)
+  {
+    free_st_conversion_settings(&cs);
+  }
+}
+
+static int
+aux_compare_wpaths(const void* p1, const void* p2)
+{
+  return wcscmp(*(const wchar_t* const*) p1, *(const wchar_t* const*) p2);
+}
+
+int discover_mhl_wfiles(
+  const wchar_t* root_wdir, 
+  unsigned int jobs,
+  wchar_t*** p_mhl_wpaths,
+  size_t* p_mhl_wpaths_num,
+  size_t* p_failed_wdirs_num)
+{
+  int res;
+  unsigned int i;
+  unsigned int started_jobs = 0;
+  mhlosi_thread* threads;
+  wchar_t* wdir;
+  st_mhl_discovery_walk walk;
+  
+  *p_mhl_wpaths = NULL;
+  *p_mhl_wpaths_num = 0;
+  *p_failed_wdirs_num = 0;
+  
+  if (!is_directory(root_wdir))
+  {
+    return ERRCODE_NO_SUCH_FILE;
+  }
+  
+  if (jobs == 0)
+  {
+    jobs = mhlosi_cpu_count();
+  }
+  if (jobs > MHL_DISCOVERY_MAX_JOBS)
+  {
+    jobs = MHL_DISCOVERY_MAX_JOBS;
+  }
+  
+  memset(&walk, 0, sizeof(walk));
+  wdir = mhlosi_wstrdup(root_wdir);
+  if (wdir == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  
+  res = 
+    aux_push_wpath(&walk.pending_wdirs, &walk.pending_wdirs_num, 
+                   &walk.pending_wdirs_capacity, wdir);
+  if (res != 0)
+  {
+    free(wdir);
+    return res;
+  }
+  
+  threads = (mhlosi_thread*) calloc(jobs, sizeof(mhlosi_thread));
+  res = threads == NULL ? ERRCODE_OUT_OF_MEM : mhlosi_mutex_init(&walk.mutex);
+  if (res != 0)
+  {
+    free(threads);
+    aux_free_wpaths(walk.pending_wdirs, walk.pending_wdirs_num);
+    return res;
+  }
+  
+  res = mhlosi_cond_init(&walk.cond);
+  if (res != 0)
+  {
+    mhlosi_mutex_destroy(&walk.mutex);
+    free(threads);
+    aux_free_wpaths(walk.pending_wdirs, walk.pending_wdirs_num);
+    return res;
+  }
+  
+  // the calling thread is one of the jobs
+  for (i = 1; i < jobs; ++i)
+  {
+    if (mhlosi_thread_create(&threads[started_jobs], aux_walk_job, 
+                             &walk) == 0)
+    {
+      ++started_jobs;
+    }
+  }
+  
+  aux_walk_job(&walk);
+  
+  for (i = 0; i < started_jobs; ++i)
+  {
+    mhlosi_thread_join(threads[i]);
+  }
+  
+  free(threads);
+  mhlosi_cond_destroy(&walk.cond);
+  mhlosi_mutex_destroy(&walk.mutex);
+  aux_free_wpaths(walk.pending_wdirs, walk.pending_wdirs_num);
+  
+  if (walk.res != 0)
+  {
+    aux_free_wpaths(walk.mhl_wpaths, walk.mhl_wpaths_num);
+    return walk.res;
+  }
+  
+  qsort(walk.mhl_wpaths, walk.mhl_wpaths_num, sizeof(wchar_t*), 
+        aux_compare_wpaths);
+  
+  *p_mhl_wpaths = walk.mhl_wpaths;
+  *p_mhl_wpaths_num = walk.mhl_wpaths_num;
+  *p_failed_wdirs_num = walk.failed_wdirs_num;
+  return 0;
+}
+
+void free_discovered_mhl_wfiles(wchar_t** mhl_wpaths, size_t mhl_wpaths_num)
+{
+  aux_free_wpaths(mhl_wpaths, mhl_wpaths_num);
+}
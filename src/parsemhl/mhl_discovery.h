@@ -0,0 +1,104 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: mhl_discovery.h
+ *
+ * Search for MHL files. The MHL file of a file is the first MHL file 
+ * found in the folder of the file or in the nearest parent folder.
+ * Results are cached per folder, so resolving of many files costs one
+ * listing per folder instead of one listing per folder and file.
+ */
+
+#ifndef _MHL_TOOLS_PARSEMHL_MHL_DISCOVERY_H_
+#define _MHL_TOOLS_PARSEMHL_MHL_DISCOVERY_H_
+
+#include <wchar.h>
+
+#include <generics/char_conversions.h>
+#include <generics/memory_management.h>
+
+typedef struct _st_mhl_discovery_wdir
+{
+  const wchar_t* wdir;      // NULL for an empty slot
+  const wchar_t* mhl_wpath; // NULL if there is no MHL file up to the root
+  unsigned int wdir_hash;
+} st_mhl_discovery_wdir;
+
+//
+// Folder -> MHL file cache, it is not thread safe
+//
+typedef struct _st_mhl_discovery_cache
+{
+  st_mhl_discovery_wdir* wdirs; // open addressing table
+  size_t wdirs_capacity;        // power of 2 
+  size_t wdirs_num;
+  st_memory_arena wstrings_arena;
+} st_mhl_discovery_cache;
+
+void init_mhl_discovery_cache(st_mhl_discovery_cache* p_cache);
+void free_mhl_discovery_cache(st_mhl_discovery_cache* p_cache);
+
+/* Searches for the MHL file of the file, folders already looked through 
+ * are taken from the cache.
+ * @param mhl_file_wpath - [out] path to MHL file, caller frees it
+ * @return In case of success: 0.
+ *         ERRCODE_MHL_NOT_FOUND if there is no MHL file up to the root.
+ *         In case of failure: non zero value with error code.
+ */
+int search_mhl_wfile_cached(
+  st_mhl_discovery_cache* p_cache,
+  const wchar_t* file_wpath, 
+  wchar_t** mhl_file_wpath,
+  st_conversion_settings* p_cs);
+
+/* The same as search_mhl_wfile_cached() without the cache.
+ */
+int search_mhl_wfile(
+  const wchar_t* file_wpath, 
+  wchar_t** mhl_file_wpath,
+  st_conversion_settings* p_cs);
+
+/* Finds all MHL files (plain and gzip-compressed) in the folder 
+ * and its subfolders. The tree is walked by several threads, 
+ * symbolic links are not followed. Folders, which can't be read, 
+ * are reported to stderr and skipped.
+ * @param jobs - number of threads, 0 means number of processors
+ * @param p_mhl_wpaths - [out] sorted array of paths to MHL files, 
+ *                       caller frees it with free_discovered_mhl_wfiles()
+ * @param p_failed_wdirs_num - [out] number of skipped folders
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int discover_mhl_wfiles(
+  const wchar_t* root_wdir, 
+  unsigned int jobs,
+  wchar_t*** p_mhl_wpaths,
+  size_t* p_mhl_wpaths_num,
+  size_t* p_failed_wdirs_num);
+
+void free_discovered_mhl_wfiles(wchar_t** mhl_wpaths, size_t mhl_wpaths_num);
+
+#endif //_MHL_TOOLS_PARSEMHL_MHL_DISCOVERY_H_
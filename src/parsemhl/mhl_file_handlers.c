@@ -35,16 +35,28 @@
  */
 
 #include <libxml/parserInternals.h>
+#include <libxml/xmlreader.h>
+#include <zlib.h>
 
 #include <facade_info/error_codes.h>
 #include <generics/os_check.h>
 #include <generics/std_funcs_os_anonymizer.h>
+#include <generics/error_output.h>
+#include <generics/os_threads.h>
 #include <generics/filesystem_handlers/public_interface.h>
 
 #include <mhltools_common/controlling_data.h>
 #include <mhltools_common/hashing.h>
+#include <mhltools_common/xxhash.h>
 
 #include "mhl_file_handlers.h"
+#include "mhl_scanner.h"
+
+#define MHL_GZ_READ_BUFF_SZ (128*1024)
+#define MHL_SIZE_BUFF_SZ 64
+#define MHL_KEY_BUFF_SZ 1024
+#define MHL_PATH_SLOTS_MIN_NUM 64
+#define MHL_STREAM_HASHES_BUFF_NUM 8
 
 //
 //
@@ -52,10 +64,11 @@
 /* TODO: Use iconv here, in order to skip sprcific spaces (like &nbsp)
  *
  * NOTE! Caller is responsible for freeing returned pointer.
- * converts string from xmlChar to char and ƒ
+ * copies string of given size into zero-terminated one and
  * skips leading and trailing whitespaces
  *
- * @param src - source xmlChar* string
+ * @param src - source UTF-8 string, not necessarily zero-terminated
+ * @param src_sz - size of source string in bytes
  * @param dst - destination char* string.
  *              It is converted string without
  *              leading and trailing whitespaces.
@@ -65,19 +78,17 @@
  *         In case of error: NON zero value indicating error
  */
 static int
-aux_strdup_trimmed(const xmlChar* src, char** u8dst)
+aux_strdup_trimmed(const char* src, size_t src_sz, char** u8dst)
 {
-  int src_sz = 0;
   int dst_sz = 0;
   int li = 0, ri = 0;
-  const xmlChar* beg;
+  const char* beg;
   
-  src_sz = xmlStrlen(src);
   if (src_sz)
   {
     for (li = 0; li < src_sz; ++li) 
     {
-      if (!isspace(src[li]))
+      if (!isspace((unsigned char) src[li]))
       {
         break;
       }
@@ -85,7 +96,7 @@ aux_strdup_trimmed(const xmlChar* src, char** u8dst)
 
     for (ri = src_sz - 1; ri >= li; --ri) 
     {
-      if (!isspace(src[ri]))
+      if (!isspace((unsigned char) src[ri]))
       {
         break;
       }
@@ -104,7 +115,7 @@ aux_strdup_trimmed(const xmlChar* src, char** u8dst)
   }
   
   beg = src + li;
-  strncpy(*u8dst, (const char*)	beg, dst_sz);
+  memcpy(*u8dst, beg, dst_sz);
   
   return 0;
 }
@@ -115,10 +126,11 @@ aux_strdup_trimmed(const xmlChar* src, char** u8dst)
 /* TODO: Use iconv here, in order to skip sprcific spaces (like &nbsp)
  *
  * NOTE! Caller is responsible for freeing returned pointer.
- * converts string from xmlChar to char and ƒ
+ * copies string of given size into zero-terminated one and
  * skips leading and trailing whitespaces
  *
- * @param src - source xmlChar* string
+ * @param src - source UTF-8 string, not necessarily zero-terminated
+ * @param src_sz - size of source string in bytes
  * @param dst - destination char* string.
  *              It is converted string without
  *              leading and trailing whitespaces.
@@ -129,26 +141,25 @@ aux_strdup_trimmed(const xmlChar* src, char** u8dst)
  */
 static int
 aux_wstrdup_trimmed(
-  const xmlChar* src, 
+  const char* src, 
+  size_t src_sz,
   wchar_t** wdst, 
   st_conversion_settings* p_cs)
 {
   int res;
-  int src_sz = 0;
   int dst_sz = 0;
   int li = 0, ri = 0;
-  const xmlChar* beg;
+  const char* beg;
   char* u8dst = 0;
   size_t wdst_chars_sz = 0;
   st_conversion_settings tmp_cs;
   unsigned char tmp_cs_inited = 0;
   
-  src_sz = xmlStrlen(src);
   if (src_sz)
   {
     for (li = 0; li < src_sz; ++li) 
     {
-      if (!isspace(src[li]))
+      if (!isspace((unsigned char) src[li]))
       {
         break;
       }
@@ -156,7 +167,7 @@ aux_wstrdup_trimmed(
 
     for (ri = src_sz - 1; ri >= li; --ri) 
     {
-      if (!isspace(src[ri]))
+      if (!isspace((unsigned char) src[ri]))
       {
         break;
       }
@@ -175,7 +186,7 @@ aux_wstrdup_trimmed(
   }
   
   beg = src + li;
-  strncpy(u8dst, (const char*)	beg, dst_sz);
+  memcpy(u8dst, beg, dst_sz);
 
   if (p_cs == 0)
   {
@@ -224,6 +235,8 @@ init_mhl_file_check_wdata(st_mhl_file_check_wdata* p_witem)
 
 void free_mhl_file_check_wdata(st_mhl_file_check_wdata* p_witem)
 {
+  unsigned int i;
+
   if (p_witem == 0)
   {
     return;
@@ -233,39 +246,354 @@ void free_mhl_file_check_wdata(st_mhl_file_check_wdata* p_witem)
   free(p_witem->abs_item_wfilename);
   free(p_witem->u8str_hash_sum);
   free(p_witem->parent_mhl_wfilename);
+
+  for (i = 0; i < p_witem->other_hashes_num; ++i)
+  {
+    free(p_witem->other_hashes[i].u8str_hash_sum);
+  }
+  free(p_witem->other_hashes);
   
   memset((void*)p_witem, 0, sizeof(*p_witem) / sizeof(char));
 }
 
+//---------------------------------------------------------
+//
+// Path table of MHL content
+//
+//---------------------------------------------------------
+
+/* Encodes path as UTF-8 key. dst must have space for 
+ * 4 bytes per wchar_t.
+ * @return size of the key in bytes
+ */
+static size_t
+aux_encode_u8key(const wchar_t* wsrc, size_t wsrc_len, char* dst)
+{
+  size_t i;
+  size_t sz = 0;
+  unsigned long c;
+
+  for (i = 0; i < wsrc_len; ++i)
+  {
+    c = (unsigned long) wsrc[i];
+#ifdef WIN
+    // UTF-16 surrogate pair
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < wsrc_len &&
+        wsrc[i + 1] >= 0xDC00 && wsrc[i + 1] <= 0xDFFF)
+    {
+      c = 0x10000 + ((c - 0xD800) << 10) + (wsrc[i + 1] - 0xDC00);
+      ++i;
+    }
+#endif
+    if (c < 0x80)
+    {
+      dst[sz++] = (char) c;
+    }
+    else if (c < 0x800)
+    {
+      dst[sz++] = (char) (0xC0 | (c >> 6));
+      dst[sz++] = (char) (0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000)
+    {
+      dst[sz++] = (char) (0xE0 | (c >> 12));
+      dst[sz++] = (char) (0x80 | ((c >> 6) & 0x3F));
+      dst[sz++] = (char) (0x80 | (c & 0x3F));
+    }
+    else
+    {
+      dst[sz++] = (char) (0xF0 | ((c >> 18) & 0x07));
+      dst[sz++] = (char) (0x80 | ((c >> 12) & 0x3F));
+      dst[sz++] = (char) (0x80 | ((c >> 6) & 0x3F));
+      dst[sz++] = (char) (0x80 | (c & 0x3F));
+    }
+  }
+
+  return sz;
+}
+
+/* Makes key for absolute path: UTF-8 path relative to the base folder.
+ * Keys of paths outside of the base folder start with '\0' followed by
+ * the absolute path, so they never match relative ones.
+ * Key is written into buf, if it fits, or into allocated memory, 
+ * which should be freed by the caller then (*p_key != buf).
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error
+ */
+static int
+aux_make_u8key(
+  const st_mhl_file_wcontent* wcontent,
+  const wchar_t* abs_wpath,
+  char* buf,
+  size_t buf_sz,
+  char** p_key,
+  size_t* p_key_sz)
+{
+  const wchar_t* rel_wpath;
+  size_t rel_wpath_len;
+  size_t prefix_sz;
+  char* key;
+
+  prefix_sz = 1;
+  rel_wpath = abs_wpath;
+  if (wcontent->base_wdir != 0 &&
+      wcsncmp(abs_wpath, wcontent->base_wdir, wcontent->base_wdir_len) == 0 &&
+      abs_wpath[wcontent->base_wdir_len] == WPATH_SEPARATOR)
+  {
+    rel_wpath = abs_wpath + wcontent->base_wdir_len + 1;
+    prefix_sz = 0;
+  }
+
+  rel_wpath_len = wcslen(rel_wpath);
+  key = buf;
+  if (prefix_sz + rel_wpath_len * 4 > buf_sz)
+  {
+    key = (char*) malloc(prefix_sz + rel_wpath_len * 4);
+    if (key == 0)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  key[0] = '\0';
+  *p_key_sz = prefix_sz + aux_encode_u8key(rel_wpath, rel_wpath_len, 
+                                           key + prefix_sz);
+  *p_key = key;
+  return 0;
+}
+
+static st_mhl_file_check_wdata* 
+aux_find_u8key(
+  const st_mhl_file_wcontent* wcontent,
+  const char* key,
+  size_t key_sz,
+  unsigned int key_hash)
+{
+  size_t i;
+  size_t mask;
+  const st_mhl_path_slot* slot;
+  st_mhl_file_check_wdata* p_witem;
+
+  if (wcontent->path_slots_num == 0)
+  {
+    return 0;
+  }
+
+  mask = wcontent->path_slots_num - 1;
+  for (i = key_hash & mask; ; i = (i + 1) & mask)
+  {
+    slot = &wcontent->path_slots[i];
+    if (slot->item_no == 0)
+    {
+      return 0;
+    }
+
+    if (slot->key_hash == key_hash)
+    {
+      p_witem = &wcontent->check_witems[slot->item_no - 1];
+      if (p_witem->u8key_sz == key_sz && 
+          memcmp(p_witem->u8key, key, key_sz) == 0)
+      {
+        return p_witem;
+      }
+    }
+  }
+}
+
+static void
+aux_put_path_slot(
+  st_mhl_file_wcontent* wcontent, 
+  unsigned int key_hash, 
+  size_t item_idx)
+{
+  size_t i;
+  size_t mask;
+
+  mask = wcontent->path_slots_num - 1;
+  for (i = key_hash & mask; 
+       wcontent->path_slots[i].item_no != 0; 
+       i = (i + 1) & mask)
+  {
+  }
+
+  wcontent->path_slots[i].key_hash = key_hash;
+  wcontent->path_slots[i].item_no = (unsigned int) (item_idx + 1);
+}
+
+/* Rebuilds path table with given number of slots.
+ * Hashes are not recalculated, they are kept in items.
+ */
+static int
+aux_rebuild_path_slots(st_mhl_file_wcontent* wcontent, size_t slots_num)
+{
+  size_t i;
+  st_mhl_path_slot* slots;
+
+  if (slots_num != wcontent->path_slots_num)
+  {
+    slots = (st_mhl_path_slot*) calloc(slots_num, sizeof(st_mhl_path_slot));
+    if (slots == 0)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+
+    free(wcontent->path_slots);
+    wcontent->path_slots = slots;
+    wcontent->path_slots_num = slots_num;
+  }
+  else
+  {
+    memset(wcontent->path_slots, 0, slots_num * sizeof(st_mhl_path_slot));
+  }
+
+  for (i = 0; i < wcontent->check_witems_num; ++i)
+  {
+    aux_put_path_slot(wcontent, wcontent->check_witems[i].u8key_hash, i);
+  }
+
+  return 0;
+}
+
+/* Makes room for one more item in the items array and in the path table.
+ */
+static int
+aux_reserve_witem(st_mhl_file_wcontent* wcontent)
+{
+  int res;
+  size_t slots_num;
+
+  if (wcontent->check_witems_num >= 0xFFFFFFFEu)
+  {
+    // item numbers are kept in 32 bits
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  // keep at most 3/4 of slots used
+  if ((wcontent->check_witems_num + 1) * 4 > wcontent->path_slots_num * 3)
+  {
+    slots_num = wcontent->path_slots_num != 0 ? 
+      wcontent->path_slots_num * 2 : MHL_PATH_SLOTS_MIN_NUM;
+    res = aux_rebuild_path_slots(wcontent, slots_num);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  if (wcontent->check_witems_num == wcontent->check_witems_capacity)
+  {
+    res = 
+      increase_allocated_memory(
+        (void**) &wcontent->check_witems,
+        &wcontent->check_witems_capacity,
+        wcontent->check_witems_capacity != 0 ? 
+          wcontent->check_witems_capacity * 2 : MHL_PATH_SLOTS_MIN_NUM,
+        sizeof(st_mhl_file_check_wdata));
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  return 0;
+}
+
 int 
-add_to_mhl_file_check_wdata(
-  st_mhl_file_check_wdata** p_hash_wroot,
-  st_mhl_file_check_wdata* p_check_wdata)
+add_to_mhl_file_wcontent(
+  st_mhl_file_wcontent* wcontent,
+  st_mhl_file_check_wdata* p_check_wdata,
+  st_mhl_file_check_wdata** pp_found_wdata)
 {
-  if (p_hash_wroot == 0 || p_check_wdata == 0)
+  int res;
+  char key_buf[MHL_KEY_BUFF_SZ];
+  char* key;
+  size_t key_sz;
+  unsigned int key_hash;
+  const char* interned_key;
+  st_mhl_file_check_wdata* p_found_wdata;
+
+  if (wcontent == 0 || p_check_wdata == 0 || 
+      p_check_wdata->abs_item_wfilename == 0)
   {
     return ERRCODE_WRONG_ARGUMENTS;
   }
 
-  //HASH_ADD_STR(*p_hash_root, abs_item_filename, p_check_data);
-  HASH_ADD_KEYPTR(
-    hh,
-    *p_hash_wroot, 
-    p_check_wdata->abs_item_wfilename, 
-    wcslen(p_check_wdata->abs_item_wfilename) * sizeof(wchar_t), 
-    p_check_wdata);
+  res = 
+    aux_make_u8key(wcontent, p_check_wdata->abs_item_wfilename, 
+                   key_buf, sizeof(key_buf), &key, &key_sz);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  key_hash = XXH32(key, key_sz, 0);
+  p_found_wdata = aux_find_u8key(wcontent, key, key_sz, key_hash);
+  if (pp_found_wdata != 0)
+  {
+    *pp_found_wdata = p_found_wdata;
+  }
+
+  res = 0;
+  interned_key = 0;
+  if (p_found_wdata == 0)
+  {
+    res = aux_reserve_witem(wcontent);
+    if (res == 0)
+    {
+      interned_key = memory_arena_strndup(&wcontent->keys_arena, key, key_sz);
+      res = interned_key != 0 ? 0 : ERRCODE_OUT_OF_MEM;
+    }
+  }
+
+  if (key != key_buf)
+  {
+    free(key);
+  }
+
+  if (res != 0 || p_found_wdata != 0)
+  {
+    return res;
+  }
+
+  p_check_wdata->u8key = interned_key;
+  p_check_wdata->u8key_sz = key_sz;
+  p_check_wdata->u8key_hash = key_hash;
+
+  wcontent->check_witems[wcontent->check_witems_num] = *p_check_wdata;
+  aux_put_path_slot(wcontent, key_hash, wcontent->check_witems_num);
+  ++wcontent->check_witems_num;
 
+  // the content owns data of item now
+  memset(p_check_wdata, 0, sizeof(*p_check_wdata));
   return 0;
 }
 
 st_mhl_file_check_wdata* 
 search_for_mhl_file_check_wdata(
-  st_mhl_file_check_wdata* p_hash_wroot,
+  const st_mhl_file_wcontent* wcontent,
   const wchar_t* wkey)
 {
+  char key_buf[MHL_KEY_BUFF_SZ];
+  char* key;
+  size_t key_sz;
   st_mhl_file_check_wdata* ps_witem;
-  HASH_FIND(hh, p_hash_wroot, wkey, (wcslen(wkey) * sizeof(wchar_t)), ps_witem);
-  //HASH_FIND_STR(p_hash_wroot, wkey, s_witem);
+
+  if (wcontent == 0 || wkey == 0 || wcontent->check_witems_num == 0)
+  {
+    return 0;
+  }
+
+  if (aux_make_u8key(wcontent, wkey, key_buf, sizeof(key_buf), 
+                     &key, &key_sz) != 0)
+  {
+    return 0;
+  }
+
+  ps_witem = aux_find_u8key(wcontent, key, key_sz, XXH32(key, key_sz, 0));
+  if (key != key_buf)
+  {
+    free(key);
+  }
   return ps_witem;
 }
 
@@ -280,14 +608,14 @@ int init_mhl_file_wcontent(st_mhl_file_wcontent* wcontent)
   }
   
   memset((void*)wcontent, 0, sizeof(*wcontent) / sizeof(char));
+  init_memory_arena(&wcontent->keys_arena, 0);
   return 0;
 }
 
 
 void free_mhl_file_wcontent(st_mhl_file_wcontent* wcontent)
 {
-  st_mhl_file_check_wdata* current_check_wdata;
-  st_mhl_file_check_wdata* tmp_check_wdata;
+  size_t i;
   
   if (wcontent == 0)
   {
@@ -295,153 +623,172 @@ void free_mhl_file_wcontent(st_mhl_file_wcontent* wcontent)
   }
 
   // remove items
-  HASH_ITER(hh, wcontent->check_witems, current_check_wdata, tmp_check_wdata) 
+  for (i = 0; i < wcontent->check_witems_num; ++i)
   {
-    HASH_DEL(wcontent->check_witems, current_check_wdata); //release content
-    free_mhl_file_check_wdata(current_check_wdata);
-    free(current_check_wdata); //release memory occuped by check data item
+    free_mhl_file_check_wdata(&wcontent->check_witems[i]);
   }
 
+  free(wcontent->check_witems);
+  free(wcontent->path_slots);
+  free(wcontent->base_wdir);
+  free_memory_arena(&wcontent->keys_arena);
+
   memset((void*)wcontent, 0, sizeof(*wcontent) / sizeof(char));
 }
 
-//---------------------------------------------------------
-//
-// Set of functions for search for and parsing of MHL files 
-//
-//---------------------------------------------------------
-static
-int 
-receive_filename(const wchar_t* file_wname, void* data)
+int set_mhl_file_wcontent_base_wdir(
+  st_mhl_file_wcontent* wcontent, 
+  const wchar_t* base_wdir)
 {
-  wchar_t** mhl_file_wpath;
-  
-  if (file_wname == 0 || file_wname[0] == '\0' || data == 0)
+  wchar_t* new_base_wdir;
+  size_t len;
+
+  if (wcontent == 0 || base_wdir == 0 || wcontent->check_witems_num != 0)
   {
     return ERRCODE_WRONG_ARGUMENTS;
   }
-  
-  mhl_file_wpath = (wchar_t**) data;
-  *mhl_file_wpath = mhlosi_wstrdup(file_wname);
-  if (*mhl_file_wpath == 0)
+
+  len = wcslen(base_wdir);
+  // root folder ends with separator
+  if (len > 0 && base_wdir[len - 1] == WPATH_SEPARATOR)
+  {
+    --len;
+  }
+
+  new_base_wdir = (wchar_t*) calloc(len + 1, sizeof(wchar_t));
+  if (new_base_wdir == 0)
   {
     return ERRCODE_OUT_OF_MEM;
   }
-  
-  // First mhl file found. It will be parsed. No need other mhl files anymore. 
-  return ERRCODE_STOP_SEARCH;
+  wcsncpy(new_base_wdir, base_wdir, len);
+
+  free(wcontent->base_wdir);
+  wcontent->base_wdir = new_base_wdir;
+  wcontent->base_wdir_len = len;
+  return 0;
 }
 
-int search_mhl_wfile( 
-  const wchar_t* file_wpath, 
-  wchar_t** mhl_file_wpath,
-  st_conversion_settings* p_cs)
+/* Stable merge sort of item numbers.
+ */
+static void
+aux_merge_sort_items(
+  const st_mhl_file_check_wdata* items,
+  unsigned int* order,
+  unsigned int* tmp,
+  size_t num,
+  MhlCheckWDataCompare compare)
 {
-  int res;
-  const wchar_t* inner_wpath;
-  wchar_t* outer_wpath;
-  wchar_t* mhl_file_wname;
-  wchar_t* tmp_wpath = NULL;
-  unsigned char root_reached = 0;
-  PATTERN_MATCHING_FLAGS mflags;
-  DIR_ENTRY_TYPE_FLAGS entry_type;
-  //char* path_to_dir;  
-  
-  inner_wpath = file_wpath;
-  outer_wpath = NULL;
-  mhl_file_wname = 0;
-  *mhl_file_wpath = 0;
-  
-  while (!root_reached)
+  size_t half;
+  size_t i, l, r;
+
+  if (num < 2)
   {
-    res = extract_wdir_from_wpath(inner_wpath, &outer_wpath);
-    
-    if (res != 0)
+    return;
+  }
+
+  half = num / 2;
+  aux_merge_sort_items(items, order, tmp, half, compare);
+  aux_merge_sort_items(items, order + half, tmp, num - half, compare);
+
+  memcpy(tmp, order, half * sizeof(unsigned int));
+  for (i = 0, l = 0, r = half; l < half; ++i)
+  {
+    if (r < num && compare(&items[order[r]], &items[tmp[l]]) < 0)
     {
-      free(outer_wpath);
-      return res;
+      order[i] = order[r++];
     }
-    
-    if (outer_wpath != NULL)
+    else
     {
-#ifdef WIN
-      mflags = PMF_CASE_INSENSITIVE;
-#else
-      mflags = PMF_CASE_SENSITIVE;
-#endif
-      entry_type = DETF_FILE;
-      
-      res = 
-        search_entries_in_wdir(
-          outer_wpath, 
-          MHL_FILE_WPATTERN, 
-          PMP_MATCH_AT_THE_END,
-          mflags, 
-          entry_type, 
-          p_cs,
-          (void*) &mhl_file_wname,                     
-          receive_filename);
-      
-      if (res || mhl_file_wname != 0)
-      {
-        // error or mhl found
+      order[i] = tmp[l++];
+    }
+  }
+}
 
-        if (mhl_file_wname != 0)
-        {
-          if (res == 0)
-          {
-            res = concat_wpath_parts(outer_wpath, mhl_file_wname,
-                                     mhl_file_wpath);
-          }
+int sort_mhl_file_wcontent(
+  st_mhl_file_wcontent* wcontent, 
+  MhlCheckWDataCompare compare)
+{
+  size_t i, j, k;
+  unsigned int* order;
+  st_mhl_file_check_wdata tmp_witem;
 
-          free(mhl_file_wname);
-        }
+  if (wcontent == 0 || compare == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
 
-        free(outer_wpath);
-        break;
-      }      
-      
-      free(tmp_wpath);
-      tmp_wpath = outer_wpath;
-      inner_wpath = outer_wpath;
+  if (wcontent->check_witems_num < 2)
+  {
+    return 0;
+  }
+
+  order = 
+    (unsigned int*) calloc(wcontent->check_witems_num * 3 / 2 + 1, 
+                           sizeof(unsigned int));
+  if (order == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  for (i = 0; i < wcontent->check_witems_num; ++i)
+  {
+    order[i] = (unsigned int) i;
+  }
+
+  aux_merge_sort_items(wcontent->check_witems, order, 
+                       order + wcontent->check_witems_num,
+                       wcontent->check_witems_num, compare);
+
+  // move items into sorted positions following the permutation cycles,
+  // positions already done are marked with the value of their index
+  for (i = 0; i < wcontent->check_witems_num; ++i)
+  {
+    if (order[i] == i)
+    {
+      continue;
     }
-    else 
+
+    tmp_witem = wcontent->check_witems[i];
+    for (j = i; order[j] != i; j = k)
     {
-      root_reached = 1;
+      k = order[j];
+      wcontent->check_witems[j] = wcontent->check_witems[k];
+      order[j] = (unsigned int) j;
     }
-  } // while (!root_reached)
- 
-  free(tmp_wpath);
-  
-  if (res != 0 && res != ERRCODE_STOP_SEARCH)
-  {
-    return res;
+    wcontent->check_witems[j] = tmp_witem;
+    order[j] = (unsigned int) j;
   }
 
-  return *mhl_file_wpath == 0 ? ERRCODE_MHL_NOT_FOUND : 0;
+  free(order);
+  return aux_rebuild_path_slots(wcontent, wcontent->path_slots_num);
 }
 
+//---------------------------------------------------------
+//
+// Set of functions for parsing of MHL files 
+//
+//---------------------------------------------------------
 static int
 aux_parse_name_wfile(
-  xmlDocPtr doc, 
-  xmlNodePtr cur, 
+  const char* data, 
+  size_t data_sz,
   const wchar_t* mhl_base_wdir, 
   st_mhl_file_check_wdata* p_witem,
   st_conversion_settings* p_cs)
 {
   int res;
-  xmlChar* data = 0;
   
-  // get filename from mhl file
-  data = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
-  if (data == 0) 
+  if (p_witem->item_wfilename != 0)
   {
-    return ERRCODE_OUT_OF_MEM;
+    // several <file> tags inside of one <hash> tag, the last one is used
+    free(p_witem->item_wfilename);
+    free(p_witem->abs_item_wfilename);
+    p_witem->item_wfilename = 0;
+    p_witem->abs_item_wfilename = 0;
   }
-  
-  // convert filename from xmlChar* to wchar_t*
-  res = aux_wstrdup_trimmed(data, &p_witem->item_wfilename, p_cs);
-  xmlFree(data);
+
+  // convert filename from UTF-8 to wchar_t*
+  res = aux_wstrdup_trimmed(data, data_sz, &p_witem->item_wfilename, p_cs);
   if (res != 0)
   {
     return res;
@@ -467,22 +814,31 @@ aux_parse_name_wfile(
 
 static int
 aux_parse_file_size(
-  xmlDocPtr doc, 
-  xmlNodePtr cur, 
+  const char* data, 
+  size_t data_sz,
   st_mhl_file_check_wdata* p_witem)
 {
   int res = 0;
-  xmlChar* data = 0;
+  char sz_buf[MHL_SIZE_BUFF_SZ];
+  char* sz_str = sz_buf;
   
-  // get filename from mhl file
-  data = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
-  if (data == 0) 
+  // size value is not zero-terminated
+  if (data_sz < sizeof(sz_buf))
   {
-    return ERRCODE_OUT_OF_MEM;
+    memcpy(sz_buf, data, data_sz);
+    sz_buf[data_sz] = '\0';
   }
-  
+  else 
+  {
+    res = aux_strdup_trimmed(data, data_sz, &sz_str);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
   errno = 0;
-  p_witem->file_sz = mhlosi_strtoull((const char*) data, 0, 10);
+  p_witem->file_sz = mhlosi_strtoull(sz_str, 0, 10);
   if (errno != 0)
   {
     // filesize conversion error, wrong number format
@@ -496,381 +852,1481 @@ aux_parse_file_size(
     res = 0;
   }
   
-  xmlFree(data);
+  if (sz_str != sz_buf)
+  {
+    free(sz_str);
+  }
   return res;
 }
 
 
-static int
-aux_parse_hash_type(
-  xmlDocPtr doc, 
-  xmlNodePtr cur, 
-  st_mhl_file_check_wdata* p_witem)
+/* Reads number of exactly digits_num digits.
+ * @return pointer after the number, NULL if there is no such number
+ */
+static const char*
+aux_read_date_number(
+  const char* p, 
+  const char* end, 
+  int digits_num, 
+  int* p_value)
 {
-  int res = 0;
-  xmlChar* data = 0;
+  int value = 0;
 
-    
-  if (p_witem->hash_type == MHL_HT_SHA1)
+  if (end - p < digits_num)
   {
-    // hash data is already filled with primary hash
-    return 0;
+    return NULL;
   }
 
-  if (!xmlStrcmp(cur->name, (const xmlChar *)"md5"))
-  {
-    p_witem->hash_type = MHL_HT_MD5;
-    p_witem->hash_bytes_sz = MHL_MD5_HASH_BYTES_SZ;
-  }
-  else if (!xmlStrcmp(cur->name, (const xmlChar *)"sha1"))
+  for (; digits_num > 0; --digits_num, ++p)
   {
-    p_witem->hash_type = MHL_HT_SHA1;
-    p_witem->hash_bytes_sz = MHL_SHA1_HASH_BYTES_SZ;    
-  }
-  else if (!xmlStrcmp(cur->name, (const xmlChar *)"xxhash"))
-  {
-      p_witem->hash_type = MHL_HT_XXHASH;
-      p_witem->hash_bytes_sz = MHL_XXHASH_HASH_BYTES_SZ;
+    if (*p < '0' || *p > '9')
+    {
+      return NULL;
+    }
+    value = value * 10 + (*p - '0');
   }
-  else if (!xmlStrcmp(cur->name, (const xmlChar *)"xxhash64"))
+
+  *p_value = value;
+  return p;
+}
+
+/* Parses value of "<lastmodificationdate>" tag: UTC time 
+ * "2011-03-10T07:49:21Z" as written by mhl, or any other separators 
+ * between the numbers, e.g. "2011-03-10 07-49-21" of early versions. 
+ * Dates in other formats are not an error, the item keeps zero time then.
+ * @param data - text content of the tag, not zero-terminated
+ */
+static void
+aux_parse_file_mtime(
+  const char* data,
+  size_t data_sz,
+  st_mhl_file_check_wdata* p_witem)
+{
+  // number of digits and upper bound of each date part
+  static const int digits[6] = {4, 2, 2, 2, 2, 2};
+  static const int bounds[6] = {9999, 12, 31, 23, 59, 60};
+  const char* p = data;
+  const char* end = data + data_sz;
+  int parts[6];
+  int i;
+  long long y;
+  long long m;
+  long long days;
+
+  while (p < end && isspace((unsigned char) *p))
+  {
+    ++p;
+  }
+  while (end > p && isspace((unsigned char) end[-1]))
+  {
+    --end;
+  }
+  if (end > p && end[-1] == 'Z')
+  {
+    --end;
+  }
+
+  for (i = 0; i < 6; ++i)
+  {
+    if (i != 0)
+    {
+      if (p == end || (*p >= '0' && *p <= '9'))
+      {
+        return;
+      }
+      ++p;
+    }
+
+    p = aux_read_date_number(p, end, digits[i], &parts[i]);
+    if (p == NULL || parts[i] > bounds[i] || (i < 3 && parts[i] == 0))
+    {
+      return;
+    }
+  }
+
+  if (p != end)
+  {
+    return;
+  }
+
+  // days since 1970-01-01 of the proleptic Gregorian calendar, 
+  // timegm() is not available on all platforms
+  y = parts[0];
+  m = parts[1];
+  if (m <= 2)
+  {
+    y -= 1;
+    m += 12;
+  }
+  days = 
+    365 * y + y / 4 - y / 100 + y / 400 + (153 * (m - 3) + 2) / 5 + 
+    parts[2] - 719469;
+
+  p_witem->lastmodification_seconds = 
+    (time_t) (days * 86400 + parts[3] * 3600 + parts[4] * 60 + parts[5]);
+}
+
+/* Adds digest to the item. The primary digest of the item is SHA1,
+ * or the last one, if there is no SHA1 digest. Other digests are kept
+ * in other_hashes. MHL_HT_NULL is kept only if there are no other digests.
+ * Takes ownership of u8str_hash_sum.
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error
+ */
+static int
+aux_add_hash(
+  st_mhl_file_check_wdata* p_witem,
+  MHL_HASH_TYPE hash_type,
+  unsigned int hash_bytes_sz,
+  char* u8str_hash_sum)
+{
+  st_mhl_file_hash* other_hashes;
+  st_mhl_file_hash* p_other_hash;
+
+  if (p_witem->hash_type == MHL_HT_UNRECOGNIZED || 
+      p_witem->hash_type == MHL_HT_NULL)
+  {
+    // the first digest, or the real one after null
+    free(p_witem->u8str_hash_sum);
+    p_witem->hash_type = hash_type;
+    p_witem->hash_bytes_sz = hash_bytes_sz;
+    p_witem->u8str_hash_sum = u8str_hash_sum;
+    p_witem->primary_hash_pos = p_witem->other_hashes_num;
+    return 0;
+  }
+
+  if (hash_type == MHL_HT_NULL)
+  {
+    return 0;
+  }
+
+  other_hashes = 
+    (st_mhl_file_hash*) realloc(p_witem->other_hashes, 
+                                (p_witem->other_hashes_num + 1) * 
+                                  sizeof(st_mhl_file_hash));
+  if (other_hashes == 0)
+  {
+    free(u8str_hash_sum);
+    return ERRCODE_OUT_OF_MEM;
+  }
+  p_witem->other_hashes = other_hashes;
+  p_other_hash = &other_hashes[p_witem->other_hashes_num++];
+
+  if (p_witem->hash_type == MHL_HT_SHA1)
+  {
+    // primary hash is already filled
+    p_other_hash->hash_type = hash_type;
+    p_other_hash->u8str_hash_sum = u8str_hash_sum;
+    return 0;
+  }
+
+  p_other_hash->hash_type = p_witem->hash_type;
+  p_other_hash->u8str_hash_sum = p_witem->u8str_hash_sum;
+  p_witem->hash_type = hash_type;
+  p_witem->hash_bytes_sz = hash_bytes_sz;
+  p_witem->u8str_hash_sum = u8str_hash_sum;
+  p_witem->primary_hash_pos = p_witem->other_hashes_num;
+  return 0;
+}
+
+static int
+aux_parse_hash_type(
+  const char* name, 
+  const char* data, 
+  size_t data_sz,
+  st_mhl_file_check_wdata* p_witem)
+{
+  int res = 0;
+  MHL_HASH_TYPE hash_type;
+  unsigned int hash_bytes_sz;
+  char* u8str_hash_sum = NULL;
+    
+  if (!strcmp(name, "md5"))
+  {
+    hash_type = MHL_HT_MD5;
+    hash_bytes_sz = MHL_MD5_HASH_BYTES_SZ;
+  }
+  else if (!strcmp(name, "sha1"))
+  {
+    hash_type = MHL_HT_SHA1;
+    hash_bytes_sz = MHL_SHA1_HASH_BYTES_SZ;    
+  }
+  else if (!strcmp(name, "xxhash"))
+  {
+    hash_type = MHL_HT_XXHASH;
+    hash_bytes_sz = MHL_XXHASH_HASH_BYTES_SZ;
+  }
+  else if (!strcmp(name, "xxhash64"))
+  {
+    hash_type = MHL_HT_XXHASH64;
+    hash_bytes_sz = MHL_XXHASH64_HASH_BYTES_SZ;
+  }
+  else if (!strcmp(name, "xxhash64be"))
+  {
+    hash_type = MHL_HT_XXHASH64BE;
+    hash_bytes_sz = MHL_XXHASH64BE_HASH_BYTES_SZ;
+  }
+  else if (!strcmp(name, "null"))
+  {
+    hash_type = MHL_HT_NULL;
+    hash_bytes_sz = 0;
+  }
+  else
+  {
+    // unsupported hash type
+    return ERRCODE_WRONG_MHL_FORMAT;
+  }
+
+  if (MHL_HT_NULL != hash_type) 
+  {
+    // hash value
+    if (data == 0) 
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+  
+    //
+    // TODO: may be need to trim data string
+    //
+    if ((data_sz / 2) != hash_bytes_sz)
+    {
+      // read size of hash sum is not equal to
+      // size of hash sum for given hash algorithm
+      return ERRCODE_WRONG_MHL_FORMAT;
+    }
+
+    // copy hash value into zero-terminated string
+    res = aux_strdup_trimmed(data, data_sz, &u8str_hash_sum);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  return aux_add_hash(p_witem, hash_type, hash_bytes_sz, u8str_hash_sum);
+}
+
+/* @return Type of the "<hash>" item by value of its "referencehhashlist"
+ *         attribute, NULL if there is no such attribute
+ */
+static MHL_ITEM_TYPE
+aux_parse_hash_reference(const char* ref_value, size_t ref_value_sz)
+{
+  //
+  // check is MHL item is reference
+  //
+  // TODO: Need to clarify: is "referencehhashlist" correct name?
+  //
+  if (ref_value != NULL)
+  {
+    if (ref_value_sz != 3 || memcmp(ref_value, "yes", 3))
+    {
+      return MHL_IT_MHL_FILE;
+    }
+  }
+
+  return MHL_IT_REGULAR_FILE;
+}
+
+/* Creates new item for the "<hash>" tag.
+ * @param ref_value - value of "referencehhashlist" attribute,
+ *                    NULL if there is no such attribute
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error
+ */
+static int
+aux_start_hash(
+  const char* ref_value,
+  size_t ref_value_sz,
+  st_mhl_file_check_wdata** pp_check_witem)
+{
+  int res;
+  st_mhl_file_check_wdata* p_check_witem;
+  
+  p_check_witem = 
+    (st_mhl_file_check_wdata*) calloc(1, sizeof(st_mhl_file_check_wdata));
+
+  if (p_check_witem == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  res = init_mhl_file_check_wdata(p_check_witem);
+  if (res != 0)
+  {
+    free(p_check_witem);
+    return res;
+  }
+
+  p_check_witem->data_type = aux_parse_hash_reference(ref_value, ref_value_sz);
+  *pp_check_witem = p_check_witem;
+  return 0;
+}
+
+/* Parses value of the child tag of "<hash>" tag.
+ * Tags, which are not used for check, are skipped.
+ * @param data - text content of the tag, not zero-terminated
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error
+ */
+static int
+aux_parse_hash_child(
+  const wchar_t* mhl_base_wdir, 
+  const char* name,
+  const char* data,
+  size_t data_sz,
+  st_mhl_file_check_wdata* p_check_witem,
+  st_conversion_settings* p_cs)
+{
+  if (!strcmp(name, "file"))
+  {
+    //UTF8 - normalized (lowercased)
+    return 
+      aux_parse_name_wfile(data, data_sz, mhl_base_wdir, p_check_witem, p_cs);
+  }
+  
+  if (!strcmp(name, "size"))
+  {
+    return aux_parse_file_size(data, data_sz, p_check_witem);
+  }
+
+  if (!strcmp(name, "lastmodificationdate"))
+  {
+    aux_parse_file_mtime(data, data_sz, p_check_witem);
+    return 0;
+  }
+
+  return aux_parse_hash_type(name, data, data_sz, p_check_witem);
+}
+
+/* Parses child tag of the "<hash>" tag the reader is positioned on.
+ * Only text content of the tag is read, so memory usage doesn't 
+ * depend on the size of MHL file.
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error
+ */
+static int
+aux_read_hash_child(
+  const wchar_t* mhl_base_wdir, 
+  xmlTextReaderPtr reader,
+  st_mhl_file_check_wdata* p_check_witem,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  const char* name;
+  xmlChar* data;
+
+  name = (const char*) xmlTextReaderConstLocalName(reader);
+  if (name == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  if (strcmp(name, "file") && 
+      strcmp(name, "size") && 
+      strcmp(name, "lastmodificationdate") && 
+      strcmp(name, "md5") && 
+      strcmp(name, "sha1") && 
+      strcmp(name, "xxhash") && 
+      strcmp(name, "xxhash64") && 
+      strcmp(name, "xxhash64be") && 
+      strcmp(name, "null"))
+  {
+    // creationdate, hashdate and other tags are not used for check
+    return 0;
+  }
+
+  if (!strcmp(name, "null"))
+  {
+    return aux_parse_hash_type(name, NULL, 0, p_check_witem);
+  }
+
+  data = 
+    xmlTextReaderIsEmptyElement(reader) ? 
+      NULL : 
+      xmlTextReaderReadString(reader);
+  if (data == 0) 
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  res = 
+    aux_parse_hash_child(
+      mhl_base_wdir, 
+      name, 
+      (const char*) data, 
+      xmlStrlen(data), 
+      p_check_witem, 
+      p_cs);
+
+  xmlFree(data);
+  return res;
+}
+
+/* Checks that all the values needed for check of the file are read.
+ * @return In case of success: 0
+ *         In case of error: ERRCODE_WRONG_MHL_FORMAT
+ */
+static int
+aux_check_hash_values(const st_mhl_file_check_wdata* p_check_witem)
+{
+  // check parsed values corectness
+  if (p_check_witem->is_file_sz_set == 0 || 
+      p_check_witem->hash_type == MHL_HT_UNRECOGNIZED || 
+      (p_check_witem->u8str_hash_sum == 0 && MHL_HT_NULL != p_check_witem->hash_type))
+  {
+    return ERRCODE_WRONG_MHL_FORMAT;    
+  }
+
+  return 0;
+}
+
+/* Receives item created from the "<hash>" tag, takes ownership of it.
+ */
+typedef int (*MhlCheckWDataSink)(
+  st_mhl_file_check_wdata* p_check_witem, 
+  void* data);
+
+/* Checks item created from the "<hash>" tag and adds it into MHL content,
+ * passed as data. Item is freed, if it is not added.
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error
+ */
+static int
+aux_finish_hash(
+  st_mhl_file_check_wdata* p_check_witem,
+  void* data)
+{
+  int res;
+  st_mhl_file_wcontent* p_mhl_wcontent = (st_mhl_file_wcontent*) data;
+  st_mhl_file_check_wdata* p_search_witem = NULL;
+
+  if (p_check_witem->item_wfilename == 0 ||
+      p_check_witem->abs_item_wfilename == 0 ||
+      aux_check_hash_values(p_check_witem) != 0)
+  {
+    free_mhl_file_check_wdata(p_check_witem);
+    free(p_check_witem);
+    return ERRCODE_WRONG_MHL_FORMAT;    
+  }
+  
+  // Add item, unless it is already in list
+  res = 
+    add_to_mhl_file_wcontent(p_mhl_wcontent, p_check_witem, &p_search_witem);
+
+  if (res == 0 && p_search_witem != NULL && 
+      p_check_witem->data_type == MHL_IT_MHL_FILE)
+  {
+    // oops! cyclic reference
+    res = ERRCODE_WRONG_MHL_FORMAT;
+  }
+
+  //TODO: clarify if file really need to be checked the same file several times?
+  //      currently duplicates are skipped
+
+  // item data is cleared, if it is moved into the content
+  free_mhl_file_check_wdata(p_check_witem);
+  free(p_check_witem);
+
+  if (res != 0)
+  {
+    return res;
+  }
+
+  // NOTE: items of referenced MHL files are not loaded here,
+  // the reference itself is kept as an item of MHL_IT_MHL_FILE type
+
+  return 0;
+}
+
+// libxml2 input callbacks for reading of (possibly compressed) MHL file
+static int
+aux_gz_read(void* context, char* buffer, int len)
+{
+  return gzread((gzFile) context, buffer, (unsigned int) len);
+}
+
+// stream is closed by the caller of xmlReaderForIO()
+static int
+aux_gz_noclose(void* context)
+{
+  return 0;
+}
+
+// passes libxml2 errors of the reader to the error output of the thread
+static void
+aux_xml_reader_error(
+  void* arg, 
+  const char* msg, 
+  xmlParserSeverities severity,
+  xmlTextReaderLocatorPtr locator)
+{
+  error_printf("%s", msg);
+}
+
+/* Checks version of MHL file, given as value of the "version"
+ * attribute of the root tag (NULL if there is no such attribute).
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error, 
+ *                           and print error message to stderr
+ */
+static int
+aux_check_version(const char* version)
+{
+  double v;
+
+  v = version != NULL ? atof(version) : 0;
+  if (v > 1.1) {
+    error_printf(
+            "MHL file version %s is not compatible with this tool. Please use a newer version.\n",
+            version);
+    return ERRCODE_WRONG_MHL_FORMAT;
+  }
+
+  return 0;
+}
+
+/* Checks the root "<hashlist>" tag the reader is positioned on.
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error, 
+ *                           and print error message to stderr
+ */
+static int
+aux_check_hashlist(
+  const wchar_t* mhl_file_wpath, 
+  xmlTextReaderPtr reader)
+{
+  int res;
+  xmlChar* version;
+
+  if (xmlStrcmp(xmlTextReaderConstLocalName(reader), 
+                (const xmlChar *) "hashlist")) 
+  {
+    error_printf(
+      "MHL file %ls of the wrong type, root node is not hashlist\n",
+      mhl_file_wpath);
+    
+	  return ERRCODE_WRONG_MHL_FORMAT;
+  }
+
+  version = xmlTextReaderGetAttribute(reader, (const xmlChar *) "version");
+  res = aux_check_version((const char*) version);
+  xmlFree(version);
+  return res;
+}
+
+static mhlosi_once_flag g_xml_parser_once = MHLOSI_ONCE_INIT;
+
+static void
+aux_init_xml_parser(void)
+{
+  // add debug info for libxml 
+  LIBXML_TEST_VERSION
+  xmlInitParser();
+}
+
+void cleanup_mhl_parser(void)
+{
+  xmlCleanupParser(); // Cleanup function for the XML library
+}
+
+/* Reads MHL file via libxml2 pull parser, without building of 
+ * a document tree: each "<hash>" item is passed to the sink, 
+ * as soon as its closing tag is read. Both plain and gzip-compressed 
+ * files are read.
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error, 
+ *                           and print error message to stderr
+ */
+static int
+aux_read_mhl_wfile(
+  const wchar_t* mhl_file_wpath, 
+  const wchar_t* mhl_base_wdir,
+  MhlCheckWDataSink sink,
+  void* sink_data,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  int read_res;
+  int depth;
+  int node_type;
+  unsigned char root_found = 0;
+  xmlTextReaderPtr reader;
+  xmlChar* attr_value;
+  st_mhl_file_check_wdata* p_check_witem = NULL;
+  int mhl_fd;
+  gzFile mhl_gz;
+
+  // libxml2 global state is shared by all the threads, so it is 
+  // initialized once and is not cleaned up after parsing
+  mhlosi_once(&g_xml_parser_once, aux_init_xml_parser);
+
+  res = wopen_for_read(mhl_file_wpath, &mhl_fd);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  // zlib reads not compressed files as is, so both plain and 
+  // gzip-compressed MHL files are read via the same stream
+  mhl_gz = gzdopen(mhl_fd, "rb");
+  if (mhl_gz == NULL)
+  {
+    mhlosi_close(mhl_fd);
+    return ERRCODE_OUT_OF_MEM;
+  }
+  gzbuffer(mhl_gz, MHL_GZ_READ_BUFF_SZ);
+
+  reader = 
+    xmlReaderForIO(
+      aux_gz_read, 
+      aux_gz_noclose, 
+      (void*) mhl_gz, 
+      "", 
+      NULL, 
+      XML_PARSE_HUGE);
+  if (reader == NULL) 
+  {
+    error_printf("Failed to parse %ls\n", mhl_file_wpath);
+
+    gzclose(mhl_gz);
+	  return ERRCODE_WRONG_MHL_FORMAT;
+  }
+
+  // libxml2 prints errors to stderr, unless the thread has own output
+  if (get_thread_error_output() != NULL)
+  {
+    xmlTextReaderSetErrorHandler(reader, aux_xml_reader_error, NULL);
+  }
+
+  res = 0;
+  while ((read_res = xmlTextReaderRead(reader)) == 1)
+  {
+    node_type = xmlTextReaderNodeType(reader);
+    depth = xmlTextReaderDepth(reader);
+
+    if (node_type == XML_READER_TYPE_ELEMENT)
+    {
+      if (depth == 0)
+      {
+        root_found = 1;
+        res = aux_check_hashlist(mhl_file_wpath, reader);
+      }
+      else if (depth == 1 && 
+               !xmlStrcmp(xmlTextReaderConstLocalName(reader), 
+                          (const xmlChar *)"hash"))
+      {
+        attr_value = 
+          xmlTextReaderGetAttribute(
+            reader, 
+            (const xmlChar*)"referencehhashlist");
+        res = 
+          aux_start_hash(
+            (const char*) attr_value, 
+            attr_value != NULL ? xmlStrlen(attr_value) : 0,
+            &p_check_witem);
+        xmlFree(attr_value);
+
+        if (res == 0 && xmlTextReaderIsEmptyElement(reader))
+        {
+          // no closing tag is reported for <hash/>
+          res = sink(p_check_witem, sink_data);
+          p_check_witem = NULL;
+        }
+      }
+      else if (depth == 2 && p_check_witem != NULL)
+      {
+        res = 
+          aux_read_hash_child(mhl_base_wdir, reader, p_check_witem, p_cs);
+      }
+    }
+    else if (node_type == XML_READER_TYPE_END_ELEMENT &&
+             depth == 1 && p_check_witem != NULL)
+    {
+      res = sink(p_check_witem, sink_data);
+      p_check_witem = NULL;
+    }
+
+    if (res != 0)
+    {
+      if (depth > 0)
+      {
+        error_printf("Failed to parse <hash> item of MHL file %ls\n", 
+                     mhl_file_wpath);
+        res = ERRCODE_WRONG_MHL_FORMAT;
+      }
+      break;
+    }
+  }
+
+  if (res == 0 && read_res != 0)
+  {
+    error_printf("Failed to parse %ls\n", mhl_file_wpath);
+    res = ERRCODE_WRONG_MHL_FORMAT;
+  }
+  else if (res == 0 && !root_found)
+  {
+    error_printf("MHL file %ls is empty\n", mhl_file_wpath);
+    res = ERRCODE_WRONG_MHL_FORMAT;
+  }
+
+  if (p_check_witem != NULL)
+  {
+    free_mhl_file_check_wdata(p_check_witem);
+    free(p_check_witem);
+  }
+
+  xmlFreeTextReader(reader);
+  gzclose(mhl_gz);
+
+  return res;
+}
+
+//
+// Data passed to the MHL scanner callback
+//
+typedef struct _st_mhl_scan_wdata
+{
+  const wchar_t* mhl_file_wpath;
+  const wchar_t* mhl_base_wdir;
+  st_mhl_file_wcontent* mhl_wcontent;
+  st_mhl_file_check_wdata* p_check_witem;
+  st_conversion_settings* p_cs;
+} st_mhl_scan_wdata;
+
+/* The same as aux_check_version() for not zero-terminated value.
+ */
+static int
+aux_check_scanned_version(const char* value, size_t value_sz)
+{
+  int res;
+  char* version;
+
+  if (value == NULL)
+  {
+    return aux_check_version(NULL);
+  }
+
+  version = (char*) calloc(value_sz + 1, sizeof(char));
+  if (version == NULL)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  memcpy(version, value, value_sz);
+
+  res = aux_check_version(version);
+  free(version);
+  return res;
+}
+
+static int
+aux_receive_scanned_element(
+  MHL_SCAN_EVENT event,
+  const char* name,
+  const char* value,
+  size_t value_sz,
+  void* data)
+{
+  int res = 0;
+  st_mhl_scan_wdata* p_scan_wdata = (st_mhl_scan_wdata*) data;
+
+  switch (event)
+  {
+    case MHL_SE_ROOT:
+      return aux_check_scanned_version(value, value_sz);
+
+    case MHL_SE_HASH_START:
+      res = aux_start_hash(value, value_sz, &p_scan_wdata->p_check_witem);
+      break;
+
+    case MHL_SE_HASH_CHILD:
+      res = 
+        aux_parse_hash_child(
+          p_scan_wdata->mhl_base_wdir, 
+          name, 
+          value, 
+          value_sz, 
+          p_scan_wdata->p_check_witem, 
+          p_scan_wdata->p_cs);
+      break;
+
+    case MHL_SE_HASH_END:
+      res = 
+        aux_finish_hash(
+          p_scan_wdata->p_check_witem, 
+          p_scan_wdata->mhl_wcontent);
+      p_scan_wdata->p_check_witem = NULL;
+      break;
+  }
+
+  if (res != 0)
+  {
+    error_printf("Failed to parse <hash> item of MHL file %ls\n", 
+                 p_scan_wdata->mhl_file_wpath);
+    res = ERRCODE_WRONG_MHL_FORMAT;
+  }
+
+  return res;
+}
+
+/* Maps MHL file into memory for the MHL scanner.
+ * @return In case of success: 0
+ *         ERRCODE_NOT_IMPLEMENTED if MHL file should be read via libxml2
+ */
+static int
+aux_map_mhl_wfile_for_scan(
+  const wchar_t* mhl_file_wpath, 
+  const char** p_mhl_data,
+  size_t* p_mhl_data_sz)
+{
+  int res;
+
+  res = wmap_file_for_read(mhl_file_wpath, p_mhl_data, p_mhl_data_sz);
+  if (res != 0)
+  {
+    // e.g. empty file, libxml2 reports it
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  if (*p_mhl_data_sz >= 2 && 
+      (unsigned char) (*p_mhl_data)[0] == 0x1f && 
+      (unsigned char) (*p_mhl_data)[1] == 0x8b)
+  {
+    // gzip-compressed file
+    unmap_file(*p_mhl_data, *p_mhl_data_sz);
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  return 0;
+}
+
+/* Reads MHL file via the specialised MHL scanner (see mhl_scanner.h).
+ * Items are collected separately and moved into the MHL content only
+ * when the whole file is scanned successfully.
+ * @return In case of success: 0
+ *         ERRCODE_NOT_IMPLEMENTED if MHL file should be read via libxml2
+ *         In case of error: NON zero value indicating error, 
+ *                           and print error message to stderr
+ */
+static int
+aux_scan_mhl_wfile(
+  const wchar_t* mhl_file_wpath, 
+  const wchar_t* mhl_base_wdir,
+  st_mhl_file_wcontent* mhl_wcontent,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  const char* mhl_data;
+  size_t mhl_data_sz;
+  st_mhl_file_wcontent scanned_wcontent;
+  st_mhl_scan_wdata scan_wdata;
+  st_mhl_file_check_wdata* p_check_witem;
+  st_mhl_file_check_wdata* p_found_witem;
+  size_t i;
+
+  res = aux_map_mhl_wfile_for_scan(mhl_file_wpath, &mhl_data, &mhl_data_sz);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  init_mhl_file_wcontent(&scanned_wcontent);
+  res = set_mhl_file_wcontent_base_wdir(&scanned_wcontent, mhl_base_wdir);
+  if (res != 0)
+  {
+    unmap_file(mhl_data, mhl_data_sz);
+    return res;
+  }
+
+  scan_wdata.mhl_file_wpath = mhl_file_wpath;
+  scan_wdata.mhl_base_wdir = mhl_base_wdir;
+  scan_wdata.mhl_wcontent = &scanned_wcontent;
+  scan_wdata.p_check_witem = NULL;
+  scan_wdata.p_cs = p_cs;
+
+  res = 
+    scan_mhl_buffer(
+      mhl_data, 
+      mhl_data_sz, 
+      aux_receive_scanned_element, 
+      (void*) &scan_wdata);
+
+  unmap_file(mhl_data, mhl_data_sz);
+  if (scan_wdata.p_check_witem != NULL)
+  {
+    free_mhl_file_check_wdata(scan_wdata.p_check_witem);
+    free(scan_wdata.p_check_witem);
+  }
+
+  if (res != 0)
+  {
+    free_mhl_file_wcontent(&scanned_wcontent);
+    return res;
+  }
+
+  if (mhl_wcontent->check_witems_num == 0)
+  {
+    // base folders of both contents are the same
+    free_mhl_file_wcontent(mhl_wcontent);
+    *mhl_wcontent = scanned_wcontent;
+    return 0;
+  }
+
+  for (i = 0; i < scanned_wcontent.check_witems_num && res == 0; ++i)
+  {
+    p_check_witem = &scanned_wcontent.check_witems[i];
+    res = 
+      add_to_mhl_file_wcontent(mhl_wcontent, p_check_witem, &p_found_witem);
+
+    if (res == 0 && p_found_witem != NULL && 
+        p_check_witem->data_type == MHL_IT_MHL_FILE)
+    {
+      // cyclic reference
+      res = ERRCODE_WRONG_MHL_FORMAT;
+    }
+  }
+
+  // items, which are not moved, are freed here
+  free_mhl_file_wcontent(&scanned_wcontent);
+  return res;
+}
+
+int parse_mhl_wfile(
+  const wchar_t* mhl_file_wpath, 
+  st_mhl_file_wcontent* mhl_wcontent,
+  st_conversion_settings* p_cs)
+{
+  return 
+    parse_mhl_wfile_with_parser(
+      mhl_file_wpath, 
+      mhl_wcontent, 
+      p_cs, 
+      MHL_PARSER_AUTO);
+}
+
+int parse_mhl_wfile_with_parser(
+  const wchar_t* mhl_file_wpath, 
+  st_mhl_file_wcontent* mhl_wcontent,
+  st_conversion_settings* p_cs,
+  MHL_PARSER_TYPE parser)
+{
+  int res;
+  wchar_t* mhl_base_wdir = 0;
+
+  if (does_wpath_exist(mhl_file_wpath) == 0)
   {
-      p_witem->hash_type = MHL_HT_XXHASH64;
-      p_witem->hash_bytes_sz = MHL_XXHASH64_HASH_BYTES_SZ;
+    return ERRCODE_MHL_NOT_FOUND;
   }
-  else if (!xmlStrcmp(cur->name, (const xmlChar *)"xxhash64be"))
+  
+  res = extract_wdir_from_wpath(mhl_file_wpath, &mhl_base_wdir);
+  if (res != 0 || mhl_base_wdir == 0)
   {
-      p_witem->hash_type = MHL_HT_XXHASH64BE;
-      p_witem->hash_bytes_sz = MHL_XXHASH64BE_HASH_BYTES_SZ;
+    error_printf(
+      "Cannot extract path from MHL file %ls\n",
+      mhl_file_wpath);
+    
+    return res != 0 ? res : ERRCODE_WRONG_FILE_LOCATION;
   }
-  else if (!xmlStrcmp(cur->name, (const xmlChar *) "null"))
+
+  if (mhl_wcontent->check_witems_num == 0)
   {
-    p_witem->hash_type = MHL_HT_NULL;
-    p_witem->hash_bytes_sz = 0;
+    // keys of items are relative to folder of the first MHL file
+    res = set_mhl_file_wcontent_base_wdir(mhl_wcontent, mhl_base_wdir);
+    if (res != 0)
+    {
+      free(mhl_base_wdir);
+      return res;
+    }
   }
-  else
+
+  res = ERRCODE_NOT_IMPLEMENTED;
+  if (parser != MHL_PARSER_LIBXML)
   {
-    // unsupported hash type
-    return ERRCODE_WRONG_MHL_FORMAT;
+    // usual MHL files are read by the scanner, libxml2 is 
+    // used for all the documents the scanner can't handle strictly
+    res = 
+      aux_scan_mhl_wfile(mhl_file_wpath, mhl_base_wdir, mhl_wcontent, p_cs);
   }
 
-  if (MHL_HT_NULL == p_witem->hash_type) {
-    return 0;
-  }
-  // read hash value
-  data = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
-  if (data == 0) 
+  if (res == ERRCODE_NOT_IMPLEMENTED && parser != MHL_PARSER_SCANNER)
   {
-    return ERRCODE_OUT_OF_MEM;
+    res = 
+      aux_read_mhl_wfile(mhl_file_wpath, mhl_base_wdir, aux_finish_hash, 
+                         mhl_wcontent, p_cs);
   }
+
+  free(mhl_base_wdir);
+  return res;
+}
+
+//---------------------------------------------------------
+//
+// Streaming of MHL files
+//
+//---------------------------------------------------------
+
+//
+// Data passed to the MHL scanner callback and to the libxml2 sink 
+// in streaming mode
+//
+typedef struct _st_mhl_stream_wdata
+{
+  const wchar_t* mhl_file_wpath;
+  const wchar_t* mhl_base_wdir;
+  MhlFileU8ItemCallback callback;
+  void* callback_data;
+  st_conversion_settings* p_cs;
+
+  // item, which is being scanned
+  st_mhl_file_check_wdata check_witem;
   
-  //
-  // TODO: may be need to trim data string
-  //
-  res = xmlStrlen(data);
-  if ((res / 2) != p_witem->hash_bytes_sz)
+  // absolute UTF-8 path of the item, it starts with path of 
+  // the base folder. Used for plain relative names of files only.
+  char* u8path;
+  size_t u8path_capacity;
+  size_t u8prefix_sz;
+  size_t u8path_sz;
+  unsigned char is_u8path_set;
+
+  // number of items passed to the callback
+  size_t items_num;
+  // number of items read via libxml2 after fallback from the scanner
+  size_t read_items_num;
+  // result of the callback, it is returned as is
+  int callback_res;
+} st_mhl_stream_wdata;
+
+/* @return 1 if the name of file from MHL file can be appended to 
+ *         the path of the base folder as is: it is ASCII relative path 
+ *         without empty, "." and ".." components, 0 otherwise.
+ */
+static int
+aux_is_plain_u8name(const char* name, size_t name_sz)
+{
+#ifdef WIN
+  // separators and drive letters are to be handled
+  return 0;
+#else
+  size_t i;
+  size_t comp_beg = 0;
+  size_t comp_sz;
+
+  if (name_sz == 0 || name[0] == '/')
   {
-    // read size of hash sum is not equal to
-    // size of hash sum for given hash algorithm
-    xmlFree(data);
-    return ERRCODE_WRONG_MHL_FORMAT;
+    return 0;
   }
-  
-  if (p_witem->u8str_hash_sum != NULL)
+
+  for (i = 0; i <= name_sz; ++i)
   {
-    // hash string is already filled with previous hash sum
-    // May be not primary hash md5 is written there
-    free(p_witem->u8str_hash_sum);
-    p_witem->u8str_hash_sum = NULL;
+    if (i < name_sz)
+    {
+      if ((unsigned char) name[i] >= 0x80 || name[i] == '\0')
+      {
+        // non-ASCII names are checked via conversion into wchar_t
+        return 0;
+      }
+
+      if (name[i] != '/')
+      {
+        continue;
+      }
+    }
+
+    comp_sz = i - comp_beg;
+    if (comp_sz == 0 ||
+        (comp_sz == 1 && name[comp_beg] == '.') ||
+        (comp_sz == 2 && name[comp_beg] == '.' && name[comp_beg + 1] == '.'))
+    {
+      return 0;
+    }
+    comp_beg = i + 1;
   }
 
-  // convert hash value from xmlChar* to char*
-  res = aux_strdup_trimmed(data, &p_witem->u8str_hash_sum);
-  xmlFree(data);
-  return res;  
+  return 1;
+#endif
 }
 
+/* Sets name of file of the streamed item.
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error
+ */
 static int
-aux_parse_hash(
-  const wchar_t* mhl_base_dir, 
-  xmlDocPtr doc, 
-  xmlNodePtr cur, 
-  st_mhl_file_wcontent* p_mhl_wcontent,
-  st_conversion_settings* p_cs)
+aux_stream_name_file(
+  const char* data, 
+  size_t data_sz,
+  st_mhl_stream_wdata* p_stream_wdata)
 {
   int res;
-  unsigned char push_to_list;
-  st_mhl_file_check_wdata* p_check_witem = NULL;
-  st_mhl_file_check_wdata* p_search_witem = NULL;
-  xmlChar* attr_value;
-  wchar_t* parent_dir_wpath;
-  
-  //
-  p_check_witem = 
-    (st_mhl_file_check_wdata*) calloc(1, sizeof(st_mhl_file_check_wdata));
 
-  if (p_check_witem == 0)
+  // the same trimming as in aux_wstrdup_trimmed()
+  while (data_sz > 0 && isspace((unsigned char) data[0]))
   {
-    return ERRCODE_OUT_OF_MEM;
+    ++data;
+    --data_sz;
   }
-  res = init_mhl_file_check_wdata(p_check_witem);
+  while (data_sz > 0 && isspace((unsigned char) data[data_sz - 1]))
+  {
+    --data_sz;
+  }
+
+  if (!aux_is_plain_u8name(data, data_sz))
+  {
+    p_stream_wdata->is_u8path_set = 0;
+    return 
+      aux_parse_name_wfile(
+        data, 
+        data_sz, 
+        p_stream_wdata->mhl_base_wdir, 
+        &p_stream_wdata->check_witem, 
+        p_stream_wdata->p_cs);
+  }
+
+  if (p_stream_wdata->u8prefix_sz + data_sz + 1 > 
+      p_stream_wdata->u8path_capacity)
+  {
+    res = 
+      increase_allocated_memory(
+        (void**) &p_stream_wdata->u8path, 
+        &p_stream_wdata->u8path_capacity, 
+        (p_stream_wdata->u8prefix_sz + data_sz + 1) * 2, 
+        sizeof(char));
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  memcpy(p_stream_wdata->u8path + p_stream_wdata->u8prefix_sz, data, data_sz);
+  p_stream_wdata->u8path_sz = p_stream_wdata->u8prefix_sz + data_sz;
+  p_stream_wdata->u8path[p_stream_wdata->u8path_sz] = '\0';
+  p_stream_wdata->is_u8path_set = 1;
+  return 0;
+}
+
+static void
+aux_fill_u8hash(
+  MHL_HASH_TYPE hash_type, 
+  const char* u8str_hash_sum, 
+  st_mhl_file_u8hash* p_u8hash)
+{
+  p_u8hash->hash_type = hash_type;
+  p_u8hash->u8str_hash_sum = u8str_hash_sum != NULL ? u8str_hash_sum : "";
+  p_u8hash->u8str_hash_sum_sz = strlen(p_u8hash->u8str_hash_sum);
+}
+
+/* Checks values of the item and passes it to the callback.
+ * Error of the callback is saved in the streaming data.
+ * @param u8path - absolute UTF-8 path of the item, 
+ *                 NULL if it should be taken from the item
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error
+ */
+static int
+aux_report_streamed_item(
+  const st_mhl_file_check_wdata* p_check_witem,
+  const char* u8path,
+  size_t u8path_sz,
+  st_mhl_stream_wdata* p_stream_wdata)
+{
+  int res;
+  char* u8converted_path = NULL;
+  size_t u8converted_path_sz = 0;
+  st_mhl_file_u8item u8item;
+  st_mhl_file_u8hash u8hashes_buf[MHL_STREAM_HASHES_BUFF_NUM];
+  st_mhl_file_u8hash* u8hashes = u8hashes_buf;
+  unsigned int hashes_num;
+  unsigned int i;
+  unsigned int j;
+
+  res = aux_check_hash_values(p_check_witem);
   if (res != 0)
   {
-    free(p_check_witem);
+    return res;
   }
 
-  p_check_witem->data_type = MHL_IT_REGULAR_FILE;
-  //
-  // check is MHL item is reference
-  //
-  // TODO: Need to clarify: is "referencehhashlist" correct name?
-  //
-  attr_value = xmlGetProp(cur, (const xmlChar*)"referencehhashlist");
-  if (attr_value != NULL)
+  hashes_num = p_check_witem->other_hashes_num + 1;
+  if (hashes_num > MHL_STREAM_HASHES_BUFF_NUM)
   {
-    if (xmlStrcmp(attr_value, (const xmlChar*)"yes"))
+    u8hashes = 
+      (st_mhl_file_u8hash*) malloc(hashes_num * sizeof(st_mhl_file_u8hash));
+    if (u8hashes == NULL)
     {
-      p_check_witem->data_type = MHL_IT_MHL_FILE;
+      return ERRCODE_OUT_OF_MEM;
     }
-    
-    xmlFree(attr_value);
   }
-  
-  cur = cur->xmlChildrenNode;
-  while (cur != NULL) 
+
+  // the primary digest back at its place in MHL file
+  for (i = 0, j = 0; i < hashes_num; ++i)
   {
-    if ((!xmlStrcmp(cur->name, (const xmlChar *)"file"))) 
+    if (i == p_check_witem->primary_hash_pos)
     {
-      //UTF8 - normalized (lowercased)
-      res = aux_parse_name_wfile(doc, cur, mhl_base_dir, p_check_witem, p_cs);
-      if (res != 0)
-      {
-        free_mhl_file_check_wdata(p_check_witem);
-        free(p_check_witem);
-        return res;
-      }
+      aux_fill_u8hash(p_check_witem->hash_type, 
+                      p_check_witem->u8str_hash_sum, &u8hashes[i]);
     }
-    else if ((!xmlStrcmp(cur->name, (const xmlChar *)"size"))) 
+    else
     {
-      res = aux_parse_file_size(doc, cur, p_check_witem);
-      if (res != 0)
-      {
-        free_mhl_file_check_wdata(p_check_witem);
-        free(p_check_witem);
-        return res;
-      }
+      aux_fill_u8hash(p_check_witem->other_hashes[j].hash_type, 
+                      p_check_witem->other_hashes[j].u8str_hash_sum, 
+                      &u8hashes[i]);
+      ++j;
+    }
+  }
+
+  if (u8path == NULL)
+  {
+    if (p_check_witem->abs_item_wfilename == NULL)
+    {
+      return ERRCODE_WRONG_MHL_FORMAT;
     }
-    else if ((!xmlStrcmp(cur->name, (const xmlChar *)"md5")) ||
-             (!xmlStrcmp(cur->name, (const xmlChar *)"sha1")) ||
-             (!xmlStrcmp(cur->name, (const xmlChar *)"xxhash")) ||
-             (!xmlStrcmp(cur->name, (const xmlChar *)"xxhash64")) ||
-             (!xmlStrcmp(cur->name, (const xmlChar *)"xxhash64be")) ||
-             (!xmlStrcmp(cur->name, (const xmlChar *)"null")))
+
+    res = 
+      convert_from_wchar_to_utf8(
+        p_check_witem->abs_item_wfilename, 
+        wcslen(p_check_witem->abs_item_wfilename), 
+        &u8converted_path, 
+        &u8converted_path_sz, 
+        p_stream_wdata->p_cs);
+    if (res != 0)
     {
-      res = aux_parse_hash_type(doc, cur, p_check_witem);
-      if (res != 0)
+      if (u8hashes != u8hashes_buf)
       {
-        free_mhl_file_check_wdata(p_check_witem);
-        free(p_check_witem);
-        return res;
+        free(u8hashes);
       }
+      return res;
     }
+    u8path = u8converted_path;
+    u8path_sz = strlen(u8converted_path);
+  }
+
+  u8item.abs_u8path = u8path;
+  u8item.abs_u8path_sz = u8path_sz;
+  u8item.hash_type = p_check_witem->hash_type;
+  u8item.u8str_hash_sum = 
+    u8hashes[p_check_witem->primary_hash_pos].u8str_hash_sum;
+  u8item.u8str_hash_sum_sz = 
+    u8hashes[p_check_witem->primary_hash_pos].u8str_hash_sum_sz;
+  u8item.hashes = u8hashes;
+  u8item.hashes_num = hashes_num;
+  u8item.file_sz = p_check_witem->file_sz;
+  u8item.data_type = p_check_witem->data_type;
 
-    cur = cur->next;
+  res = p_stream_wdata->callback(&u8item, p_stream_wdata->callback_data);
+  free(u8converted_path);
+  if (u8hashes != u8hashes_buf)
+  {
+    free(u8hashes);
   }
-  
-  // check parsed values corectness
-  if (p_check_witem->is_file_sz_set == 0 || p_check_witem->item_wfilename == 0 ||
-      p_check_witem->abs_item_wfilename == 0 ||
-      p_check_witem->hash_type == MHL_HT_UNRECOGNIZED || 
-      (p_check_witem->u8str_hash_sum == 0 && MHL_HT_NULL != p_check_witem->hash_type))
+  if (res != 0)
   {
-    free_mhl_file_check_wdata(p_check_witem);
-    free(p_check_witem);
-    return ERRCODE_WRONG_MHL_FORMAT;    
+    p_stream_wdata->callback_res = res;
+    return res;
   }
-  
-  // Check existence
-  p_search_witem = 
-    search_for_mhl_file_check_wdata(
-      p_mhl_wcontent->check_witems, 
-      p_check_witem->abs_item_wfilename);
 
-  res = 0;
-  push_to_list = 1;
-  if (p_search_witem)
+  ++p_stream_wdata->items_num;
+  return 0;
+}
+
+static int
+aux_receive_streamed_element(
+  MHL_SCAN_EVENT event,
+  const char* name,
+  const char* value,
+  size_t value_sz,
+  void* data)
+{
+  int res = 0;
+  st_mhl_stream_wdata* p_stream_wdata = (st_mhl_stream_wdata*) data;
+  st_mhl_file_check_wdata* p_check_witem = &p_stream_wdata->check_witem;
+
+  switch (event)
   {
-    // Already in list check it
-    if (p_check_witem->data_type == MHL_IT_MHL_FILE)
-    {
-        // oops! cyclic reference
-        res = ERRCODE_WRONG_MHL_FORMAT;
-    }
+    case MHL_SE_ROOT:
+      return aux_check_scanned_version(value, value_sz);
+
+    case MHL_SE_HASH_START:
+      free_mhl_file_check_wdata(p_check_witem);
+      p_check_witem->data_type = aux_parse_hash_reference(value, value_sz);
+      p_stream_wdata->is_u8path_set = 0;
+      break;
+
+    case MHL_SE_HASH_CHILD:
+      if (!strcmp(name, "file"))
+      {
+        res = aux_stream_name_file(value, value_sz, p_stream_wdata);
+      }
+      else if (!strcmp(name, "size"))
+      {
+        res = aux_parse_file_size(value, value_sz, p_check_witem);
+      }
+      else if (!strcmp(name, "lastmodificationdate"))
+      {
+        aux_parse_file_mtime(value, value_sz, p_check_witem);
+      }
+      else
+      {
+        res = aux_parse_hash_type(name, value, value_sz, p_check_witem);
+      }
+      break;
 
-    //TODO: clarify if file really need to be checked the same file several times?
-    //      currently duplicates are skipped
-    push_to_list = 0;
+    case MHL_SE_HASH_END:
+      res = 
+        aux_report_streamed_item(
+          p_check_witem, 
+          p_stream_wdata->is_u8path_set ? p_stream_wdata->u8path : NULL,
+          p_stream_wdata->u8path_sz,
+          p_stream_wdata);
+      break;
   }
 
-  if (res != 0 || push_to_list == 0)
+  if (p_stream_wdata->callback_res != 0)
   {
-    free_mhl_file_check_wdata(p_check_witem);
-    free(p_check_witem);
+    return p_stream_wdata->callback_res;
+  }
 
-    return res;
+  if (res != 0)
+  {
+    error_printf("Failed to parse <hash> item of MHL file %ls\n", 
+                 p_stream_wdata->mhl_file_wpath);
+    res = ERRCODE_WRONG_MHL_FORMAT;
   }
 
-  res = 
-    add_to_mhl_file_check_wdata(
-      &(p_mhl_wcontent->check_witems),
-      p_check_witem);
+  return res;
+}
 
-  if (res != 0)
+/* Sink of the libxml2 reader in streaming mode. Items, already 
+ * passed to the callback by the scanner, are skipped.
+ */
+static int
+aux_stream_hash(
+  st_mhl_file_check_wdata* p_check_witem,
+  void* data)
+{
+  int res = 0;
+  st_mhl_stream_wdata* p_stream_wdata = (st_mhl_stream_wdata*) data;
+
+  ++p_stream_wdata->read_items_num;
+  if (p_stream_wdata->read_items_num > p_stream_wdata->items_num)
   {
-    free_mhl_file_check_wdata(p_check_witem);
-    free(p_check_witem);
+    res = 
+      aux_report_streamed_item(p_check_witem, NULL, 0, p_stream_wdata);
+  }
+
+  free_mhl_file_check_wdata(p_check_witem);
+  free(p_check_witem);
+  return res;
+}
+
+/* Sets path of the base folder as prefix of UTF-8 paths of items.
+ * @return In case of success: 0
+ *         In case of error: NON zero value indicating error
+ */
+static int
+aux_init_stream_u8prefix(st_mhl_stream_wdata* p_stream_wdata)
+{
+  int res;
+  wchar_t* sample_wpath = NULL;
+  size_t u8path_sz = 0;
 
+  // the same normalization, as for names of files, is applied
+  res = 
+    create_absolute_normalized_wpath(
+      p_stream_wdata->mhl_base_wdir, 
+      L"_", 
+      &sample_wpath);
+  if (res != 0)
+  {
     return res;
   }
 
-  if (p_check_witem->data_type == MHL_IT_MHL_FILE)
+  res = 
+    convert_from_wchar_to_utf8(
+      sample_wpath, 
+      wcslen(sample_wpath), 
+      &p_stream_wdata->u8path, 
+      &u8path_sz, 
+      p_stream_wdata->p_cs);
+  free(sample_wpath);
+  if (res != 0)
   {
-    //
-    // load hash reference
-    //
-
-    // get base dir for hashreference
-    res = 
-      extract_wdir_from_wpath(
-        p_check_witem->abs_item_wfilename, 
-        &parent_dir_wpath);
-
-    if (res == 0)
-    {
-      // load items from hash reference
-      res = aux_parse_hash(parent_dir_wpath, doc, cur, p_mhl_wcontent, p_cs);
-      free(parent_dir_wpath);
-    }
+    p_stream_wdata->u8path = NULL;
+    return res;
   }
 
-  return res;
+  u8path_sz = strlen(p_stream_wdata->u8path);
+  p_stream_wdata->u8path_capacity = u8path_sz + 1;
+  p_stream_wdata->u8prefix_sz = u8path_sz - 1;
+  p_stream_wdata->u8path_sz = 0;
+  return 0;
 }
 
-int parse_mhl_wfile(
+int stream_mhl_wfile(
   const wchar_t* mhl_file_wpath, 
-  st_mhl_file_wcontent* mhl_wcontent,
+  MhlFileU8ItemCallback callback,
+  void* data,
   st_conversion_settings* p_cs)
 {
   int res;
-  xmlDocPtr doc;
-  xmlNodePtr cur;
+  const char* mhl_data;
+  size_t mhl_data_sz;
   wchar_t* mhl_base_wdir = 0;
-  int mhl_fd;
+  st_mhl_stream_wdata stream_wdata;
 
-  // add debug info for libxml 
-  LIBXML_TEST_VERSION
-  
   if (does_wpath_exist(mhl_file_wpath) == 0)
   {
     return ERRCODE_MHL_NOT_FOUND;
   }
   
-  // parse XML
-  /*
-  doc = xmlParseFile(mhl_file_path);
-  if (doc == NULL) 
+  res = extract_wdir_from_wpath(mhl_file_wpath, &mhl_base_wdir);
+  if (res != 0 || mhl_base_wdir == 0)
   {
-    fprintf(stderr, "Failed to parse %s\n", mhl_file_path);
-	  return ERRCODE_WRONG_MHL_FORMAT;
+    error_printf(
+      "Cannot extract path from MHL file %ls\n",
+      mhl_file_wpath);
+    
+    return res != 0 ? res : ERRCODE_WRONG_FILE_LOCATION;
   }
-  */
-  res = wopen_for_read(mhl_file_wpath, &mhl_fd);
+
+  memset((void*) &stream_wdata, 0, sizeof(stream_wdata));
+  stream_wdata.mhl_file_wpath = mhl_file_wpath;
+  stream_wdata.mhl_base_wdir = mhl_base_wdir;
+  stream_wdata.callback = callback;
+  stream_wdata.callback_data = data;
+  stream_wdata.p_cs = p_cs;
+
+  res = aux_init_stream_u8prefix(&stream_wdata);
   if (res != 0)
   {
+    free(mhl_base_wdir);
     return res;
   }
 
-  doc = xmlReadFd(mhl_fd, "", NULL, XML_PARSE_HUGE);
-  if (doc == NULL) 
+  res = aux_map_mhl_wfile_for_scan(mhl_file_wpath, &mhl_data, &mhl_data_sz);
+  if (res == 0)
   {
-    fwprintf(stderr, L"Failed to parse %s\n", mhl_file_wpath);
-
-    mhlosi_close(mhl_fd);
-	  return ERRCODE_WRONG_MHL_FORMAT;
+    res = 
+      scan_mhl_buffer(
+        mhl_data, 
+        mhl_data_sz, 
+        aux_receive_streamed_element, 
+        (void*) &stream_wdata);
+    unmap_file(mhl_data, mhl_data_sz);
   }
 
-  cur = xmlDocGetRootElement(doc);
-  if (cur == NULL)
-  {
-    fwprintf(stderr, L"MHL file %s is empty\n", mhl_file_wpath);
-	  
-    xmlFreeDoc(doc);
-    xmlCleanupParser(); // Cleanup function for the XML library
-    mhlosi_close(mhl_fd);
-	  return ERRCODE_WRONG_MHL_FORMAT;
-  }
-  
-  if (xmlStrcmp(cur->name, (const xmlChar *) "hashlist")) 
+  if (res == ERRCODE_NOT_IMPLEMENTED && stream_wdata.callback_res == 0)
   {
-    fwprintf(
-      stderr,
-      L"MHL file %s of the wrong type, root node is not hashlist\n",
-      mhl_file_wpath);
-    
-	  xmlFreeDoc(doc);
-    xmlCleanupParser(); // Cleanup function for the XML library
-    mhlosi_close(mhl_fd);
-	  return ERRCODE_WRONG_MHL_FORMAT;
-  } else {
-    xmlChar* version = xmlGetProp(cur, (const xmlChar *) "version");
-
-    double v = atof((const char *) version);
-    if (v > 1.1) {
-      fwprintf(
-               stderr,
-               L"MHL file version %s is not compatible with this tool. Please use a newer version.\n",
-               version);
-      return ERRCODE_WRONG_MHL_FORMAT;
-    }
+    // the scanner may give up in the middle of file, libxml2 continues 
+    // from the first item, which is not passed to the callback yet
+    res = 
+      aux_read_mhl_wfile(mhl_file_wpath, mhl_base_wdir, aux_stream_hash, 
+                         (void*) &stream_wdata, p_cs);
   }
-  
-  res = extract_wdir_from_wpath(mhl_file_wpath, &mhl_base_wdir);
-  if (res != 0 && mhl_base_wdir == 0)
-  {
-    fwprintf(
-      stderr,
-      L"Cannot extract path from MHL file %s\n",
-      mhl_file_wpath);
-    
-	  xmlFreeDoc(doc);
-    xmlCleanupParser(); // Cleanup function for the XML library
-    mhlosi_close(mhl_fd);
 
-    return res != 0 ? res : ERRCODE_WRONG_FILE_LOCATION;
-  }
-  
-  cur = cur->xmlChildrenNode; 
-  while (cur != NULL) 
+  if (stream_wdata.callback_res != 0)
   {
-    if ((!xmlStrcmp(cur->name, (const xmlChar *)"hash")))
-    {
-      res = aux_parse_hash(mhl_base_wdir, doc, cur, mhl_wcontent, p_cs);
-      if (res != 0)
-      {
-        fwprintf(stderr, L"MHL file %s is empty\n", mhl_file_wpath);
-        
-        xmlFreeDoc(doc);
-        xmlCleanupParser(); // Cleanup function for the XML library
-        mhlosi_close(mhl_fd);
-        return ERRCODE_WRONG_MHL_FORMAT;        
-      }
-    }
-     
-    cur = cur->next;
+    res = stream_wdata.callback_res;
   }
-  
-  xmlFreeDoc(doc);
-  xmlCleanupParser(); // Cleanup function for the XML library
-  mhlosi_close(mhl_fd);
 
-  return 0;
+  free_mhl_file_check_wdata(&stream_wdata.check_witem);
+  free(stream_wdata.u8path);
+  free(mhl_base_wdir);
+  return res;
 }
@@ -26,8 +26,10 @@
 #ifndef _MHL_TOOLS_PARSEMHL_MHL_FILE_HANDLERS_H_
 #define _MHL_TOOLS_PARSEMHL_MHL_FILE_HANDLERS_H_
 
-#include <third_party/uthash.h>
+#include <time.h>
 #include <generics/char_conversions.h>
+#include <generics/memory_management.h>
+#include <mhltools_common/mhl_types.h>
 
 typedef enum MHL_ITEM_TYPE
 {
@@ -35,6 +37,15 @@ typedef enum MHL_ITEM_TYPE
   MHL_IT_MHL_FILE
 } MHL_ITEM_TYPE;
 
+//
+// Digest of "<hash>" tag
+//
+typedef struct _st_mhl_file_hash
+{
+  MHL_HASH_TYPE hash_type;
+  char* u8str_hash_sum; // NULL for MHL_HT_NULL hash type
+} st_mhl_file_hash;
+
 //
 // This structure contains data according to "<hash>" tag from 
 // MHL file, plus some helper data
@@ -43,16 +54,23 @@ typedef struct _st_mhl_file_check_wdata
 {
   MHL_ITEM_TYPE data_type;
   //
-  wchar_t* abs_item_wfilename; //key in the hash table
+  wchar_t* abs_item_wfilename;
   wchar_t* item_wfilename; //filename from <hash> tag of mhl file
 
   //
   wchar_t* parent_mhl_wfilename;
 
   //
+  // primary digest: SHA1 if the tag has it, the last one otherwise
   MHL_HASH_TYPE hash_type;
   unsigned int hash_bytes_sz;
   char* u8str_hash_sum;
+
+  // other digests of the tag, in the order of MHL file
+  st_mhl_file_hash* other_hashes;
+  unsigned int other_hashes_num;
+  // number of other digests before the primary one in MHL file
+  unsigned int primary_hash_pos;
     
   //
   unsigned long long file_sz;
@@ -60,17 +78,39 @@ typedef struct _st_mhl_file_check_wdata
 
   time_t lastmodification_seconds;
 
-  //
-  UT_hash_handle hh; // structutre is hashable now
+  // key in the path table of MHL content: UTF-8 path relative to 
+  // the base folder of the content, kept in the content's arena
+  const char* u8key;
+  size_t u8key_sz;
+  unsigned int u8key_hash;
 } st_mhl_file_check_wdata;
 
+typedef struct _st_mhl_path_slot
+{
+  unsigned int key_hash;
+  unsigned int item_no; // index of item + 1, 0 in empty slot
+} st_mhl_path_slot;
+
 //
 // List of st_mhl_file_item_data, according to list of "<hash>"
-// tags from MHL file.
+// tags from MHL file, with open-addressing table for search by path.
 //
 typedef struct _st_mhl_file_wcontent
 {
-  st_mhl_file_check_wdata* check_witems;     /* important! initialize to NULL */
+  // items in the order of MHL file
+  st_mhl_file_check_wdata* check_witems;
+  size_t check_witems_num;
+  size_t check_witems_capacity;
+
+  // path table, number of slots is a power of 2
+  st_mhl_path_slot* path_slots;
+  size_t path_slots_num;
+
+  // folder the keys are relative to, usually folder of MHL file
+  wchar_t* base_wdir;
+  size_t base_wdir_len;
+
+  st_memory_arena keys_arena;
 } st_mhl_file_wcontent;
 
 //------------------------------------------------------------------------
@@ -96,39 +136,42 @@ int init_mhl_file_check_wdata(st_mhl_file_check_wdata* p_check_witem);
 void free_mhl_file_check_wdata(st_mhl_file_check_wdata* p_check_witem);
 
 /*
- * Adds item to st_mhl_file_check_data hash
+ * Adds item to MHL content, unless the content has item with the same path
  *
- * Note: Memory for item MUST BE ALLOCATED, dont use stack memory here
- * Note: after call to this function, ownership over "p_check_data" will be 
- *       passed to "hashtale" 
- *       Plesase do not free 'p_check_data" after successfull call to this 
- *       function.
+ * Note: data of added item is moved into the content, the passed 
+ *       structure is cleared then. Memory occupied by the structure 
+ *       itself is not released.
+ * Note: pointers to items of the content may become invalid after
+ *       call to this function
  *
- * @param p_hash_root pointer to root of st_mhl_file_check_data hashtable
- * @param p_check_data pointer to new instance of 
- *                     st_mhl_file_check_data structure
+ * @param wcontent pointer to MHL content
+ * @param p_check_wdata pointer to item with absolute path
+ * @param pp_found_wdata receives item with the same path, NULL if there 
+ *                       is no such item and the new one is added. 
+ *                       May be NULL.
  *
  * @return In case of success: 0, 
  *         in case of failure: non zero value with error code
  */
-int add_to_mhl_file_check_wdata(
-      st_mhl_file_check_wdata** p_hash_wroot,
-      st_mhl_file_check_wdata* p_check_wdata);    
+int add_to_mhl_file_wcontent(
+      st_mhl_file_wcontent* wcontent,
+      st_mhl_file_check_wdata* p_check_wdata,
+      st_mhl_file_check_wdata** pp_found_wdata);    
 
 
 /*
- * Search item in st_mhl_file_check_data hash
+ * Search item in MHL content
  *
  * Note: Don free memory, pointed to returned pointer from tis function
  *
- * @param p_hash_root pointer to root of st_mhl_file_check_data hashtable
- * @param key hash item key
+ * @param wcontent pointer to MHL content
+ * @param wkey absolute path of item
  *
  * @return In case of success: pointer to st_mhl_file_check_data with this key 
  *         in case of failure: NULL
  */
 st_mhl_file_check_wdata* search_for_mhl_file_check_wdata(
-      st_mhl_file_check_wdata* p_hash_wroot,
+      const st_mhl_file_wcontent* wcontent,
       const wchar_t* wkey);    
 
 //---------------------------------------------------------
@@ -152,21 +195,120 @@ int init_mhl_file_wcontent(st_mhl_file_wcontent* wcontent);
  */
 void free_mhl_file_wcontent(st_mhl_file_wcontent* wcontent);
 
+/* Sets folder, keys of items are relative to. 
+ * Keys of items outside of the folder contain their absolute paths.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code,
+ *         the folder can not be changed if content is not empty.
+ */
+int set_mhl_file_wcontent_base_wdir(
+  st_mhl_file_wcontent* wcontent, 
+  const wchar_t* base_wdir);
+
+typedef int (*MhlCheckWDataCompare)(
+  const st_mhl_file_check_wdata* p_check_wdata1,
+  const st_mhl_file_check_wdata* p_check_wdata2);
+
+/* Sorts items of MHL content, order of equal items is kept.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int sort_mhl_file_wcontent(
+  st_mhl_file_wcontent* wcontent, 
+  MhlCheckWDataCompare compare);
+
 
 //---------------------------------------------------------
 //
-// Set of functions for search for and parsing of MHL files 
+// Set of functions for parsing of MHL files 
 //
 //---------------------------------------------------------
 
-int search_mhl_wfile(
-  const wchar_t* file_wpath, 
-  wchar_t** mhl_file_wpath,
-  st_conversion_settings* p_cs);
+typedef enum _MHL_PARSER_TYPE
+{
+  MHL_PARSER_AUTO = 0,  // MHL scanner, libxml2 if the scanner can't handle file
+  MHL_PARSER_SCANNER,   // MHL scanner only
+  MHL_PARSER_LIBXML     // libxml2 only
+} MHL_PARSER_TYPE;
 
+/* Parses MHL file and adds its items into the MHL content.
+ * Plain MHL files are read via the specialised MHL scanner, 
+ * libxml2 is used for gzip-compressed files and for documents
+ * the scanner can't handle strictly.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
 int parse_mhl_wfile(
   const wchar_t* mhl_file_wpath, 
   st_mhl_file_wcontent* mhl_wcontent, 
   st_conversion_settings* p_cs);
 
+/* The same as parse_mhl_wfile(), with explicitly selected parser.
+ * With MHL_PARSER_SCANNER ERRCODE_NOT_IMPLEMENTED is returned for 
+ * files the scanner can't handle.
+ */
+int parse_mhl_wfile_with_parser(
+  const wchar_t* mhl_file_wpath, 
+  st_mhl_file_wcontent* mhl_wcontent, 
+  st_conversion_settings* p_cs,
+  MHL_PARSER_TYPE parser);
+
+//
+// Digest of "<hash>" tag passed to the streaming callback
+//
+typedef struct _st_mhl_file_u8hash
+{
+  MHL_HASH_TYPE hash_type;
+  const char* u8str_hash_sum; // empty for MHL_HT_NULL hash type
+  size_t u8str_hash_sum_sz;
+} st_mhl_file_u8hash;
+
+//
+// Item of MHL file passed to the streaming callback.
+// All the pointers are valid only during the call.
+//
+typedef struct _st_mhl_file_u8item
+{
+  const char* abs_u8path; // absolute normalized UTF-8 path, zero-terminated
+  size_t abs_u8path_sz;
+  // primary digest: SHA1 if the tag has it, the last one otherwise
+  MHL_HASH_TYPE hash_type;
+  const char* u8str_hash_sum; // empty for MHL_HT_NULL hash type
+  size_t u8str_hash_sum_sz;
+  // all digests of the tag, including the primary one, in the order 
+  // of MHL file
+  const st_mhl_file_u8hash* hashes;
+  unsigned int hashes_num;
+  unsigned long long file_sz;
+  MHL_ITEM_TYPE data_type;
+} st_mhl_file_u8item;
+
+/* Callback, called for each "<hash>" item of MHL file.
+ * @return 0 in order to continue reading,
+ *         not null error code in order to stop it.
+ */
+typedef int (*MhlFileU8ItemCallback)(
+  const st_mhl_file_u8item* p_u8item,
+  void* data);
+
+/* Reads MHL file and passes its items to the callback in the order
+ * of MHL file, without collecting of them in memory. Items with the
+ * same path are passed as is. Files are read the same way, as by
+ * parse_mhl_wfile(), the scanner may pass some items before libxml2
+ * takes over, each item is passed only once.
+ * @return In case of success: 0.
+ *         Error code returned by the callback.
+ *         In case of failure: non zero value with error code.
+ */
+int stream_mhl_wfile(
+  const wchar_t* mhl_file_wpath,
+  MhlFileU8ItemCallback callback,
+  void* data,
+  st_conversion_settings* p_cs);
+
+/* Releases global state of libxml2, used by the parsers. Must be called
+ * at most once, at exit of the program, when no MHL files are parsed.
+ */
+void cleanup_mhl_parser(void);
+
 #endif //_MHL_TOOLS_PARSEMHL_MHL_FILE_HANDLERS_H_
@@ -0,0 +1,1109 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: mhl_index.c
+ *
+ * Binary index of parsed MHL file.
+ *
+ * Layout of the index file (host byte order, all sections are 
+ * 8-bytes aligned except of the last one):
+ *   header
+ *   entries          - one per item, sorted by absolute path of the item
+ *   order            - uint32 entry numbers in the order of MHL file
+ *   wide strings     - zero-terminated paths, the MHL file path is first
+ *   digests          - binary digests, or digest text if it can't be 
+ *                      converted to binary and back without changes.
+ *                      The primary digest of entry is followed by its
+ *                      other digests, each of them is prefixed with 
+ *                      3 bytes: hash type, digest format and size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/filesystem_handlers/public_interface.h>
+#include <mhltools_common/mhl_types.h>
+#include <mhltools_common/xxhash.h>
+#include <parsemhl/mhl_index.h>
+
+#define MHL_INDEX_MAGIC "MHLINDEX"
+#define MHL_INDEX_MAGIC_SZ 8
+#define MHL_INDEX_VERSION 3
+#define MHL_INDEX_BYTE_ORDER 0x01020304
+#define MHL_INDEX_TMP_WEXT L".tmp"
+#define MHL_INDEX_OTHER_DIGEST_PREFIX_SZ 3
+
+typedef enum _MHL_INDEX_DIGEST_FORMAT
+{
+  MHL_IDF_NONE = 0,
+  MHL_IDF_BINARY,    // lowercase hex digest stored as bytes
+  MHL_IDF_TEXT       // digest stored as is
+} MHL_INDEX_DIGEST_FORMAT;
+
+typedef struct _st_mhl_index_header
+{
+  char magic[MHL_INDEX_MAGIC_SZ];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t wchar_sz;
+  uint32_t entries_num;
+  // key
+  uint64_t mhl_sz;
+  int64_t mhl_mtime;
+  uint64_t mhl_hash;
+  // sections
+  uint64_t index_sz;
+  uint64_t entries_off;
+  uint64_t order_off;
+  uint64_t wstrings_off;
+  uint64_t wstrings_sz;   // in wchar_t
+  uint64_t digests_off;
+  uint64_t digests_sz;
+  uint64_t mhl_wpath_len; // MHL path is the first string
+} st_mhl_index_header;
+
+typedef struct _st_mhl_index_entry
+{
+  uint64_t file_sz;
+  int64_t lastmodification_seconds;
+  uint64_t abs_wpath_off;  // in wchar_t
+  uint64_t item_wpath_off; // in wchar_t, usually points into absolute path
+  uint64_t digest_off;
+  uint32_t abs_wpath_len;
+  uint32_t item_wpath_len;
+  uint32_t hash_bytes_sz;
+  uint16_t digest_sz;
+  uint8_t data_type;
+  uint8_t hash_type;
+  uint8_t digest_format;
+  uint8_t is_file_sz_set;
+  uint8_t other_hashes_num;
+  uint8_t reserved[5];
+} st_mhl_index_entry;
+
+//---------------------------------------------------------
+//
+// Index key
+//
+//---------------------------------------------------------
+
+int get_mhl_index_key(
+  const wchar_t* mhl_file_wpath, 
+  st_mhl_index_key* p_key)
+{
+  int res;
+  const char* mhl_data;
+  size_t mhl_data_sz;
+  st_mhlosi_stat mhl_stat;
+
+  if (mhl_file_wpath == 0 || p_key == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  res = get_wfile_stat_data(mhl_file_wpath, &mhl_stat);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = wmap_file_for_read(mhl_file_wpath, &mhl_data, &mhl_data_sz);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  memset(p_key, 0, sizeof(*p_key));
+  p_key->mhl_sz = mhl_data_sz;
+  p_key->mhl_mtime = (long long) mhl_stat.st_data.st_mtime;
+  p_key->mhl_hash = XXH64(mhl_data, mhl_data_sz, 0);
+
+  unmap_file(mhl_data, mhl_data_sz);
+
+  if (p_key->mhl_sz != (unsigned long long) mhl_stat.st_data.st_size)
+  {
+    // file is changed while it is read
+    return ERRCODE_IO_ERROR;
+  }
+
+  return 0;
+}
+
+static int
+aux_wcsdup_with_ext(
+  const wchar_t* wpath, 
+  const wchar_t* wext, 
+  wchar_t** p_dst_wpath)
+{
+  *p_dst_wpath = 
+    (wchar_t*) calloc(wcslen(wpath) + wcslen(wext) + 1, sizeof(wchar_t));
+  if (*p_dst_wpath == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  wcscpy(*p_dst_wpath, wpath);
+  wcscat(*p_dst_wpath, wext);
+  return 0;
+}
+
+/* Makes <user cache folder>/mhl/index and the missing folders of it.
+ */
+static int
+aux_make_default_index_wdir(
+  wchar_t** p_index_wdir,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  wchar_t* cache_wdir;
+  wchar_t* mhl_cache_wdir;
+
+  res = get_user_cache_wdir(&cache_wdir, p_cs);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = concat_wpath_parts(cache_wdir, L"mhl", &mhl_cache_wdir);
+  free(cache_wdir);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = concat_wpath_parts(mhl_cache_wdir, L"index", p_index_wdir);
+  free(mhl_cache_wdir);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = wmake_dirs(*p_index_wdir);
+  if (res != 0)
+  {
+    free(*p_index_wdir);
+    *p_index_wdir = 0;
+  }
+  return res;
+}
+
+int make_mhl_index_wpath(
+  const wchar_t* abs_mhl_wpath, 
+  const wchar_t* index_wdir, 
+  wchar_t** p_index_wpath,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  size_t wpath_len;
+  const wchar_t* mhl_wname;
+  wchar_t* index_wname;
+  wchar_t* abs_index_wdir;
+  unsigned long long wpath_hash;
+
+  if (abs_mhl_wpath == 0 || p_index_wpath == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (index_wdir == 0)
+  {
+    // not next to MHL file, the index would become part of the media
+    res = aux_make_default_index_wdir(&abs_index_wdir, p_cs);
+  }
+  else
+  {
+    res = 
+      convert_to_absolute_normalized_wpath(index_wdir, &abs_index_wdir, p_cs);
+  }
+  if (res != 0)
+  {
+    return res;
+  }
+
+  wpath_len = wcslen(abs_mhl_wpath);
+  mhl_wname = wcsrchr(abs_mhl_wpath, WPATH_SEPARATOR);
+  mhl_wname = mhl_wname != 0 ? mhl_wname + 1 : abs_mhl_wpath;
+
+  // MHL files with the same name in different folders get different indexes
+  wpath_hash = XXH64(abs_mhl_wpath, wpath_len * sizeof(wchar_t), 0);
+
+  // <name>.<16 hex digits><ext>
+  wpath_len = wcslen(mhl_wname) + 1 + 16 + wcslen(MHL_INDEX_WEXT) + 1;
+  index_wname = (wchar_t*) calloc(wpath_len, sizeof(wchar_t));
+  if (index_wname == 0)
+  {
+    free(abs_index_wdir);
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  swprintf(index_wname, wpath_len, L"%ls.%016llx%ls", 
+           mhl_wname, wpath_hash, MHL_INDEX_WEXT);
+
+  res = concat_wpath_parts(abs_index_wdir, index_wname, p_index_wpath);
+  free(index_wname);
+  free(abs_index_wdir);
+  return res;
+}
+
+//---------------------------------------------------------
+//
+// Writing of index
+//
+//---------------------------------------------------------
+
+typedef struct _st_mhl_index_witem
+{
+  st_mhl_file_check_wdata* p_check_witem;
+  uint32_t mhl_pos;
+} st_mhl_index_witem;
+
+static int
+aux_compare_witems(const void* a, const void* b)
+{
+  return 
+    wcscmp(((const st_mhl_index_witem*) a)->p_check_witem->abs_item_wfilename,
+           ((const st_mhl_index_witem*) b)->p_check_witem->abs_item_wfilename);
+}
+
+static size_t 
+aux_align8(size_t sz)
+{
+  return (sz + 7) & ~((size_t) 7);
+}
+
+/* Checks whether item path is the end of its absolute path, 
+ * it doesn't need to be stored separately then.
+ */
+static unsigned char
+aux_is_item_wpath_shared(const st_mhl_file_check_wdata* p_check_witem)
+{
+  size_t abs_len;
+  size_t item_len;
+
+  abs_len = wcslen(p_check_witem->abs_item_wfilename);
+  item_len = wcslen(p_check_witem->item_wfilename);
+
+  return item_len <= abs_len &&
+    wcscmp(p_check_witem->abs_item_wfilename + abs_len - item_len, 
+           p_check_witem->item_wfilename) == 0;
+}
+
+static MHL_INDEX_DIGEST_FORMAT
+aux_get_digest_format(const char* u8str_hash_sum)
+{
+  size_t i;
+
+  if (u8str_hash_sum == 0)
+  {
+    return MHL_IDF_NONE;
+  }
+
+  for (i = 0; u8str_hash_sum[i] != '\0'; ++i)
+  {
+    if (!((u8str_hash_sum[i] >= '0' && u8str_hash_sum[i] <= '9') ||
+          (u8str_hash_sum[i] >= 'a' && u8str_hash_sum[i] <= 'f')))
+    {
+      return MHL_IDF_TEXT;
+    }
+  }
+
+  return i % 2 == 0 ? MHL_IDF_BINARY : MHL_IDF_TEXT;
+}
+
+static size_t
+aux_get_digest_sz(const char* u8str_hash_sum, MHL_INDEX_DIGEST_FORMAT format)
+{
+  switch (format)
+  {
+    case MHL_IDF_BINARY:
+      return strlen(u8str_hash_sum) / 2;
+    case MHL_IDF_TEXT:
+      return strlen(u8str_hash_sum);
+    default:
+      return 0;
+  }
+}
+
+/* @return Size of the other digests of item in the digests section
+ */
+static size_t
+aux_get_other_digests_sz(const st_mhl_file_check_wdata* p_check_witem)
+{
+  unsigned int i;
+  size_t sz = 0;
+  const char* hash_sum;
+
+  for (i = 0; i < p_check_witem->other_hashes_num; ++i)
+  {
+    hash_sum = p_check_witem->other_hashes[i].u8str_hash_sum;
+    sz += 
+      MHL_INDEX_OTHER_DIGEST_PREFIX_SZ + 
+      aux_get_digest_sz(hash_sum, aux_get_digest_format(hash_sum));
+  }
+
+  return sz;
+}
+
+static int
+aux_hex_value(char c)
+{
+  return c <= '9' ? c - '0' : c - 'a' + 10;
+}
+
+static int
+aux_write_padding(FILE* f, size_t sz)
+{
+  static const char zeros[8] = {0};
+
+  if (sz == aux_align8(sz))
+  {
+    return 0;
+  }
+
+  return 
+    fwrite(zeros, aux_align8(sz) - sz, 1, f) == 1 ? 0 : ERRCODE_IO_ERROR;
+}
+
+static int
+aux_write_digest(FILE* f, const char* hash_sum)
+{
+  int res = 0;
+  unsigned char buf[2];
+
+  switch (aux_get_digest_format(hash_sum))
+  {
+    case MHL_IDF_BINARY:
+      for (; *hash_sum != '\0' && res == 0; hash_sum += 2)
+      {
+        buf[0] = 
+          (unsigned char) (aux_hex_value(hash_sum[0]) << 4 | 
+                           aux_hex_value(hash_sum[1]));
+        res = fwrite(buf, 1, 1, f) == 1 ? 0 : ERRCODE_IO_ERROR;
+      }
+      break;
+
+    case MHL_IDF_TEXT:
+      if (fwrite(hash_sum, strlen(hash_sum), 1, f) != 1)
+      {
+        res = ERRCODE_IO_ERROR;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  return res;
+}
+
+static int
+aux_write_other_digests(FILE* f, const st_mhl_file_check_wdata* p_check_witem)
+{
+  int res = 0;
+  unsigned int i;
+  size_t digest_sz;
+  unsigned char prefix[MHL_INDEX_OTHER_DIGEST_PREFIX_SZ];
+  const char* hash_sum;
+
+  for (i = 0; i < p_check_witem->other_hashes_num && res == 0; ++i)
+  {
+    hash_sum = p_check_witem->other_hashes[i].u8str_hash_sum;
+    prefix[0] = (unsigned char) p_check_witem->other_hashes[i].hash_type;
+    prefix[1] = (unsigned char) aux_get_digest_format(hash_sum);
+    digest_sz = 
+      aux_get_digest_sz(hash_sum, (MHL_INDEX_DIGEST_FORMAT) prefix[1]);
+    if (digest_sz > 0xff)
+    {
+      return ERRCODE_INTERNAL_ERROR;
+    }
+    prefix[2] = (unsigned char) digest_sz;
+
+    res = fwrite(prefix, sizeof(prefix), 1, f) == 1 ? 0 : ERRCODE_IO_ERROR;
+    if (res == 0)
+    {
+      res = aux_write_digest(f, hash_sum);
+    }
+  }
+
+  return res;
+}
+
+static int
+aux_write_wstring(FILE* f, const wchar_t* wstr, size_t wstr_len)
+{
+  return 
+    fwrite(wstr, sizeof(wchar_t), wstr_len + 1, f) == wstr_len + 1 ? 
+      0 : ERRCODE_IO_ERROR;
+}
+
+/* Writes all sections of index in the order of the layout.
+ * Offsets in entries are calculated the same way as strings and 
+ * digests are written later.
+ */
+static int
+aux_write_index_sections(
+  FILE* f,
+  st_mhl_index_header* p_header,
+  st_mhl_index_witem* witems,
+  const wchar_t* abs_mhl_wpath)
+{
+  int res;
+  uint32_t i;
+  uint32_t* order;
+  size_t wstr_off;
+  size_t digest_off;
+  st_mhl_index_entry entry;
+  st_mhl_file_check_wdata* p_check_witem;
+
+  if (fwrite(p_header, sizeof(*p_header), 1, f) != 1)
+  {
+    return ERRCODE_IO_ERROR;
+  }
+
+  // entries
+  wstr_off = p_header->mhl_wpath_len + 1;
+  digest_off = 0;
+  for (i = 0; i < p_header->entries_num; ++i)
+  {
+    p_check_witem = witems[i].p_check_witem;
+    memset(&entry, 0, sizeof(entry));
+
+    entry.file_sz = p_check_witem->file_sz;
+    entry.lastmodification_seconds = p_check_witem->lastmodification_seconds;
+    entry.is_file_sz_set = p_check_witem->is_file_sz_set;
+    entry.data_type = (uint8_t) p_check_witem->data_type;
+    entry.hash_type = (uint8_t) p_check_witem->hash_type;
+    entry.hash_bytes_sz = p_check_witem->hash_bytes_sz;
+
+    entry.abs_wpath_off = wstr_off;
+    entry.abs_wpath_len = wcslen(p_check_witem->abs_item_wfilename);
+    entry.item_wpath_len = wcslen(p_check_witem->item_wfilename);
+    wstr_off += entry.abs_wpath_len + 1;
+    if (aux_is_item_wpath_shared(p_check_witem))
+    {
+      entry.item_wpath_off = 
+        entry.abs_wpath_off + entry.abs_wpath_len - entry.item_wpath_len;
+    }
+    else
+    {
+      entry.item_wpath_off = wstr_off;
+      wstr_off += entry.item_wpath_len + 1;
+    }
+
+    entry.digest_format = 
+      (uint8_t) aux_get_digest_format(p_check_witem->u8str_hash_sum);
+    entry.digest_sz = 
+      aux_get_digest_sz(p_check_witem->u8str_hash_sum, entry.digest_format);
+    entry.digest_off = digest_off;
+    entry.other_hashes_num = (uint8_t) p_check_witem->other_hashes_num;
+    if (entry.other_hashes_num != p_check_witem->other_hashes_num)
+    {
+      return ERRCODE_INTERNAL_ERROR;
+    }
+    digest_off += entry.digest_sz + aux_get_other_digests_sz(p_check_witem);
+
+    if (fwrite(&entry, sizeof(entry), 1, f) != 1)
+    {
+      return ERRCODE_IO_ERROR;
+    }
+  }
+
+  // order of MHL file
+  order = (uint32_t*) calloc(p_header->entries_num + 1, sizeof(uint32_t));
+  if (order == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  for (i = 0; i < p_header->entries_num; ++i)
+  {
+    order[witems[i].mhl_pos] = i;
+  }
+
+  res = 0;
+  if (fwrite(order, sizeof(uint32_t), p_header->entries_num, f) != 
+        p_header->entries_num)
+  {
+    res = ERRCODE_IO_ERROR;
+  }
+  free(order);
+
+  if (res == 0)
+  {
+    res = aux_write_padding(f, p_header->entries_num * sizeof(uint32_t));
+  }
+
+  // wide strings
+  if (res == 0)
+  {
+    res = aux_write_wstring(f, abs_mhl_wpath, p_header->mhl_wpath_len);
+  }
+
+  for (i = 0; i < p_header->entries_num && res == 0; ++i)
+  {
+    p_check_witem = witems[i].p_check_witem;
+    res = 
+      aux_write_wstring(f, 
+                        p_check_witem->abs_item_wfilename,
+                        wcslen(p_check_witem->abs_item_wfilename));
+
+    if (res == 0 && !aux_is_item_wpath_shared(p_check_witem))
+    {
+      res = 
+        aux_write_wstring(f, 
+                          p_check_witem->item_wfilename,
+                          wcslen(p_check_witem->item_wfilename));
+    }
+  }
+
+  if (res == 0)
+  {
+    res = aux_write_padding(f, p_header->wstrings_sz * sizeof(wchar_t));
+  }
+
+  // digests
+  for (i = 0; i < p_header->entries_num && res == 0; ++i)
+  {
+    p_check_witem = witems[i].p_check_witem;
+    res = aux_write_digest(f, p_check_witem->u8str_hash_sum);
+    if (res == 0)
+    {
+      res = aux_write_other_digests(f, p_check_witem);
+    }
+  }
+
+  return res;
+}
+
+/* Fills index header, calculates sizes of the sections.
+ */
+static void
+aux_make_index_header(
+  st_mhl_index_header* p_header,
+  st_mhl_index_witem* witems,
+  uint32_t witems_num,
+  const wchar_t* abs_mhl_wpath,
+  const st_mhl_index_key* p_key)
+{
+  uint32_t i;
+  const char* hash_sum;
+  st_mhl_file_check_wdata* p_check_witem;
+
+  memset(p_header, 0, sizeof(*p_header));
+  memcpy(p_header->magic, MHL_INDEX_MAGIC, MHL_INDEX_MAGIC_SZ);
+  p_header->version = MHL_INDEX_VERSION;
+  p_header->byte_order = MHL_INDEX_BYTE_ORDER;
+  p_header->wchar_sz = sizeof(wchar_t);
+  p_header->entries_num = witems_num;
+  p_header->mhl_sz = p_key->mhl_sz;
+  p_header->mhl_mtime = p_key->mhl_mtime;
+  p_header->mhl_hash = p_key->mhl_hash;
+  p_header->mhl_wpath_len = wcslen(abs_mhl_wpath);
+
+  p_header->wstrings_sz = p_header->mhl_wpath_len + 1;
+  for (i = 0; i < witems_num; ++i)
+  {
+    p_check_witem = witems[i].p_check_witem;
+    p_header->wstrings_sz += wcslen(p_check_witem->abs_item_wfilename) + 1;
+    if (!aux_is_item_wpath_shared(p_check_witem))
+    {
+      p_header->wstrings_sz += wcslen(p_check_witem->item_wfilename) + 1;
+    }
+
+    hash_sum = p_check_witem->u8str_hash_sum;
+    p_header->digests_sz += 
+      aux_get_digest_sz(hash_sum, aux_get_digest_format(hash_sum)) +
+      aux_get_other_digests_sz(p_check_witem);
+  }
+
+  p_header->entries_off = sizeof(*p_header);
+  p_header->order_off = 
+    p_header->entries_off + witems_num * sizeof(st_mhl_index_entry);
+  p_header->wstrings_off = 
+    p_header->order_off + aux_align8(witems_num * sizeof(uint32_t));
+  p_header->digests_off = 
+    p_header->wstrings_off + 
+    aux_align8(p_header->wstrings_sz * sizeof(wchar_t));
+  p_header->index_sz = p_header->digests_off + p_header->digests_sz;
+}
+
+int write_mhl_index(
+  const wchar_t* index_wpath,
+  const wchar_t* abs_mhl_wpath,
+  const st_mhl_index_key* p_key,
+  st_mhl_file_wcontent* mhl_wcontent)
+{
+  int res;
+  FILE* f;
+  uint32_t i;
+  unsigned int witems_num;
+  wchar_t* tmp_wpath;
+  st_mhl_index_header header;
+  st_mhl_index_witem* witems;
+
+  if (index_wpath == 0 || abs_mhl_wpath == 0 || p_key == 0 || 
+      mhl_wcontent == 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  witems_num = (unsigned int) mhl_wcontent->check_witems_num;
+  witems = 
+    (st_mhl_index_witem*) calloc(witems_num + 1, sizeof(st_mhl_index_witem));
+  if (witems == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  for (i = 0; i < witems_num; ++i)
+  {
+    witems[i].p_check_witem = &mhl_wcontent->check_witems[i];
+    witems[i].mhl_pos = i;
+  }
+
+  qsort(witems, witems_num, sizeof(st_mhl_index_witem), aux_compare_witems);
+  aux_make_index_header(&header, witems, witems_num, abs_mhl_wpath, p_key);
+
+  res = aux_wcsdup_with_ext(index_wpath, MHL_INDEX_TMP_WEXT, &tmp_wpath);
+  if (res != 0)
+  {
+    free(witems);
+    return res;
+  }
+
+  f = fwopen_for_binary_create(tmp_wpath);
+  if (f == 0)
+  {
+    free(tmp_wpath);
+    free(witems);
+    return ERRCODE_IO_ERROR;
+  }
+
+  res = aux_write_index_sections(f, &header, witems, abs_mhl_wpath);
+  free(witems);
+
+  if (fclose(f) != 0 && res == 0)
+  {
+    res = ERRCODE_IO_ERROR;
+  }
+
+  if (res == 0)
+  {
+    res = wrename_file(tmp_wpath, index_wpath);
+  }
+
+  if (res != 0)
+  {
+    wremove_file(tmp_wpath);
+  }
+
+  free(tmp_wpath);
+  return res;
+}
+
+//---------------------------------------------------------
+//
+// Loading of index
+//
+//---------------------------------------------------------
+
+/* Checks that section of the index is inside of it.
+ */
+static unsigned char
+aux_is_section_valid(
+  uint64_t off, 
+  uint64_t items_num, 
+  uint64_t item_sz, 
+  size_t index_sz)
+{
+  return off <= index_sz && off % 8 == 0 &&
+    items_num <= (index_sz - off) / item_sz;
+}
+
+static int
+aux_check_index_header(
+  const st_mhl_index_header* p_header,
+  size_t index_sz,
+  const wchar_t* abs_mhl_wpath,
+  const st_mhl_index_key* p_key)
+{
+  const wchar_t* wstrings;
+
+  if (index_sz < sizeof(*p_header) ||
+      memcmp(p_header->magic, MHL_INDEX_MAGIC, MHL_INDEX_MAGIC_SZ) != 0 ||
+      p_header->version != MHL_INDEX_VERSION ||
+      p_header->byte_order != MHL_INDEX_BYTE_ORDER ||
+      p_header->wchar_sz != sizeof(wchar_t) ||
+      p_header->index_sz != index_sz)
+  {
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  if (p_header->mhl_sz != p_key->mhl_sz ||
+      p_header->mhl_mtime != p_key->mhl_mtime ||
+      p_header->mhl_hash != p_key->mhl_hash)
+  {
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  if (!aux_is_section_valid(p_header->entries_off, p_header->entries_num,
+                            sizeof(st_mhl_index_entry), index_sz) ||
+      !aux_is_section_valid(p_header->order_off, p_header->entries_num,
+                            sizeof(uint32_t), index_sz) ||
+      !aux_is_section_valid(p_header->wstrings_off, p_header->wstrings_sz,
+                            sizeof(wchar_t), index_sz) ||
+      p_header->digests_off > index_sz ||
+      p_header->digests_sz != index_sz - p_header->digests_off ||
+      p_header->mhl_wpath_len >= p_header->wstrings_sz)
+  {
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  // MHL file can be replaced by its copy from other location
+  wstrings = 
+    (const wchar_t*) ((const char*) p_header + p_header->wstrings_off);
+  if (wstrings[p_header->mhl_wpath_len] != L'\0' ||
+      wcscmp(wstrings, abs_mhl_wpath) != 0)
+  {
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  return 0;
+}
+
+static int
+aux_wstrdup_from_index(
+  const wchar_t* wstrings,
+  uint64_t wstrings_sz,
+  uint64_t wstr_off,
+  uint32_t wstr_len,
+  wchar_t** p_wdst)
+{
+  if (wstr_off >= wstrings_sz || wstr_len >= wstrings_sz - wstr_off ||
+      wstrings[wstr_off + wstr_len] != L'\0')
+  {
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  *p_wdst = (wchar_t*) malloc((wstr_len + 1) * sizeof(wchar_t));
+  if (*p_wdst == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  memcpy(*p_wdst, wstrings + wstr_off, (wstr_len + 1) * sizeof(wchar_t));
+  return 0;
+}
+
+static int
+aux_load_digest(
+  uint8_t digest_format,
+  uint64_t digest_off,
+  uint32_t digest_sz,
+  const unsigned char* digests,
+  uint64_t digests_sz,
+  char** p_u8str_hash_sum)
+{
+  static const char hex_digits[] = "0123456789abcdef";
+  uint32_t i;
+
+  if (digest_format == MHL_IDF_NONE)
+  {
+    return digest_sz == 0 ? 0 : ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  if (digest_off > digests_sz || digest_sz > digests_sz - digest_off)
+  {
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  digests += digest_off;
+  if (digest_format == MHL_IDF_TEXT)
+  {
+    *p_u8str_hash_sum = (char*) calloc(digest_sz + 1, sizeof(char));
+    if (*p_u8str_hash_sum == 0)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+    memcpy(*p_u8str_hash_sum, digests, digest_sz);
+    return 0;
+  }
+
+  if (digest_format != MHL_IDF_BINARY)
+  {
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  *p_u8str_hash_sum = (char*) calloc(digest_sz * 2 + 1, sizeof(char));
+  if (*p_u8str_hash_sum == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  for (i = 0; i < digest_sz; ++i)
+  {
+    (*p_u8str_hash_sum)[i * 2] = hex_digits[digests[i] >> 4];
+    (*p_u8str_hash_sum)[i * 2 + 1] = hex_digits[digests[i] & 0x0f];
+  }
+
+  return 0;
+}
+
+static int
+aux_load_other_digests(
+  const st_mhl_index_entry* p_entry,
+  const unsigned char* digests,
+  uint64_t digests_sz,
+  st_mhl_file_check_wdata* p_check_witem)
+{
+  int res;
+  uint64_t off;
+  const unsigned char* prefix;
+  st_mhl_file_hash* p_other_hash;
+
+  if (p_entry->other_hashes_num == 0)
+  {
+    return 0;
+  }
+
+  p_check_witem->other_hashes = 
+    (st_mhl_file_hash*) calloc(p_entry->other_hashes_num, 
+                               sizeof(st_mhl_file_hash));
+  if (p_check_witem->other_hashes == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+
+  off = p_entry->digest_off + p_entry->digest_sz;
+  while (p_check_witem->other_hashes_num < p_entry->other_hashes_num)
+  {
+    if (off > digests_sz || 
+        MHL_INDEX_OTHER_DIGEST_PREFIX_SZ > digests_sz - off)
+    {
+      return ERRCODE_MHL_INDEX_OUTDATED;
+    }
+
+    prefix = digests + off;
+    off += MHL_INDEX_OTHER_DIGEST_PREFIX_SZ;
+    if (prefix[0] == MHL_HT_UNRECOGNIZED || prefix[0] >= MHL_HT_NULL)
+    {
+      return ERRCODE_MHL_INDEX_OUTDATED;
+    }
+
+    p_other_hash = 
+      &p_check_witem->other_hashes[p_check_witem->other_hashes_num++];
+    p_other_hash->hash_type = (MHL_HASH_TYPE) prefix[0];
+    res = 
+      aux_load_digest(prefix[1], off, prefix[2], digests, digests_sz, 
+                      &p_other_hash->u8str_hash_sum);
+    if (res != 0)
+    {
+      return res;
+    }
+    off += prefix[2];
+  }
+
+  return 0;
+}
+
+static int
+aux_load_index_entry(
+  const st_mhl_index_header* p_header,
+  const st_mhl_index_entry* p_entry,
+  st_mhl_file_check_wdata** pp_check_witem)
+{
+  int res;
+  const wchar_t* wstrings;
+  const unsigned char* digests;
+  st_mhl_file_check_wdata* p_check_witem;
+
+  if (p_entry->hash_type == MHL_HT_UNRECOGNIZED || 
+      p_entry->hash_type > MHL_HT_NULL ||
+      p_entry->data_type > MHL_IT_MHL_FILE)
+  {
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  p_check_witem = 
+    (st_mhl_file_check_wdata*) calloc(1, sizeof(st_mhl_file_check_wdata));
+  if (p_check_witem == 0)
+  {
+    return ERRCODE_OUT_OF_MEM;
+  }
+  init_mhl_file_check_wdata(p_check_witem);
+
+  p_check_witem->data_type = (MHL_ITEM_TYPE) p_entry->data_type;
+  p_check_witem->hash_type = (MHL_HASH_TYPE) p_entry->hash_type;
+  p_check_witem->hash_bytes_sz = p_entry->hash_bytes_sz;
+  p_check_witem->file_sz = p_entry->file_sz;
+  p_check_witem->is_file_sz_set = p_entry->is_file_sz_set;
+  p_check_witem->lastmodification_seconds = 
+    (time_t) p_entry->lastmodification_seconds;
+
+  wstrings = 
+    (const wchar_t*) ((const char*) p_header + p_header->wstrings_off);
+  digests = (const unsigned char*) p_header + p_header->digests_off;
+
+  res = 
+    aux_wstrdup_from_index(wstrings, p_header->wstrings_sz,
+                           p_entry->abs_wpath_off, p_entry->abs_wpath_len,
+                           &p_check_witem->abs_item_wfilename);
+  if (res == 0)
+  {
+    res = 
+      aux_wstrdup_from_index(wstrings, p_header->wstrings_sz,
+                             p_entry->item_wpath_off, p_entry->item_wpath_len,
+                             &p_check_witem->item_wfilename);
+  }
+
+  if (res == 0)
+  {
+    res = 
+      aux_load_digest(p_entry->digest_format, p_entry->digest_off, 
+                      p_entry->digest_sz, digests, p_header->digests_sz, 
+                      &p_check_witem->u8str_hash_sum);
+  }
+
+  if (res == 0)
+  {
+    res = 
+      aux_load_other_digests(p_entry, digests, p_header->digests_sz, 
+                             p_check_witem);
+  }
+
+  if (res != 0)
+  {
+    free_mhl_file_check_wdata(p_check_witem);
+    free(p_check_witem);
+    return res;
+  }
+
+  *pp_check_witem = p_check_witem;
+  return 0;
+}
+
+int load_mhl_index(
+  const wchar_t* index_wpath,
+  const wchar_t* abs_mhl_wpath,
+  const st_mhl_index_key* p_key,
+  st_mhl_file_wcontent* mhl_wcontent)
+{
+  int res;
+  uint32_t i;
+  const char* index_data;
+  size_t index_sz;
+  const st_mhl_index_header* p_header;
+  const st_mhl_index_entry* entries;
+  const uint32_t* order;
+  wchar_t* mhl_base_wdir;
+  st_mhl_file_check_wdata* p_check_witem;
+  st_mhl_file_check_wdata* p_found_witem;
+
+  if (index_wpath == 0 || abs_mhl_wpath == 0 || p_key == 0 || 
+      mhl_wcontent == 0 || mhl_wcontent->check_witems_num != 0)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  if (does_wpath_exist(index_wpath) == 0)
+  {
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  res = wmap_file_for_read(index_wpath, &index_data, &index_sz);
+  if (res != 0)
+  {
+    // e.g. empty file left after crash
+    return ERRCODE_MHL_INDEX_OUTDATED;
+  }
+
+  p_header = (const st_mhl_index_header*) index_data;
+  res = aux_check_index_header(p_header, index_sz, abs_mhl_wpath, p_key);
+  if (res == 0)
+  {
+    res = extract_wdir_from_wpath(abs_mhl_wpath, &mhl_base_wdir);
+  }
+
+  if (res == 0)
+  {
+    // the same keys as for parsed MHL file
+    res = set_mhl_file_wcontent_base_wdir(mhl_wcontent, mhl_base_wdir);
+    free(mhl_base_wdir);
+  }
+
+  if (res != 0)
+  {
+    unmap_file(index_data, index_sz);
+    return res;
+  }
+
+  entries = 
+    (const st_mhl_index_entry*) (index_data + p_header->entries_off);
+  order = (const uint32_t*) (index_data + p_header->order_off);
+  for (i = 0; i < p_header->entries_num; ++i)
+  {
+    if (order[i] >= p_header->entries_num)
+    {
+      res = ERRCODE_MHL_INDEX_OUTDATED;
+      break;
+    }
+
+    res = aux_load_index_entry(p_header, &entries[order[i]], &p_check_witem);
+    if (res != 0)
+    {
+      break;
+    }
+
+    res = 
+      add_to_mhl_file_wcontent(mhl_wcontent, p_check_witem, &p_found_witem);
+    if (res == 0 && p_found_witem != 0)
+    {
+      // paths are unique in the index
+      res = ERRCODE_MHL_INDEX_OUTDATED;
+    }
+
+    // item data is cleared, if it is moved into the content
+    free_mhl_file_check_wdata(p_check_witem);
+    free(p_check_witem);
+    if (res != 0)
+    {
+      break;
+    }
+  }
+
+  unmap_file(index_data, index_sz);
+
+  if (res != 0)
+  {
+    free_mhl_file_wcontent(mhl_wcontent);
+    init_mhl_file_wcontent(mhl_wcontent);
+  }
+
+  return res;
+}
@@ -0,0 +1,105 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: mhl_index.h
+ *
+ * Binary index of parsed MHL file. 
+ * The index keeps the items of one MHL file ready for verification, so
+ * the MHL file doesn't need to be parsed again while it is not changed.
+ * The index is bound to size, modification time and content hash of
+ * the MHL file, it is a local cache and is not portable between hosts.
+ */
+
+#ifndef _MHL_TOOLS_PARSEMHL_MHL_INDEX_H_
+#define _MHL_TOOLS_PARSEMHL_MHL_INDEX_H_
+
+#include <wchar.h>
+
+#include <generics/char_conversions.h>
+#include <parsemhl/mhl_file_handlers.h>
+
+#define MHL_INDEX_WEXT L".idx"
+
+//
+// State of MHL file the index is built from
+//
+typedef struct _st_mhl_index_key
+{
+  unsigned long long mhl_sz;
+  long long mhl_mtime;
+  unsigned long long mhl_hash; // XXH64 of the MHL file content
+} st_mhl_index_key;
+
+/* Reads size, modification time and content hash of MHL file.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int get_mhl_index_key(
+  const wchar_t* mhl_file_wpath, 
+  st_mhl_index_key* p_key);
+
+/* Makes path of the index file for MHL file.
+ * The index is placed into index_wdir, or without it into the folder
+ * "mhl/index" of the per-user cache folder, which is created then. It is
+ * named after the MHL file and hash of its absolute path.
+ * 
+ * Note! Caller is responsible for free pointer, returned in 
+ * p_index_wpath param.
+ *
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int make_mhl_index_wpath(
+  const wchar_t* abs_mhl_wpath, 
+  const wchar_t* index_wdir, 
+  wchar_t** p_index_wpath,
+  st_conversion_settings* p_cs);
+
+/* Loads items of MHL file from its index into the empty MHL content.
+ * @return In case of success: 0.
+ *         ERRCODE_MHL_INDEX_OUTDATED if the index doesn't exist, 
+ *         is damaged or is built for other state of MHL file.
+ *         In case of failure: non zero value with error code.
+ */
+int load_mhl_index(
+  const wchar_t* index_wpath,
+  const wchar_t* abs_mhl_wpath,
+  const st_mhl_index_key* p_key,
+  st_mhl_file_wcontent* mhl_wcontent);
+
+/* Writes index for items of MHL file. The MHL content should contain
+ * items of this MHL file only. The index file is replaced atomically, 
+ * readers never see partially written index.
+ * @return In case of success: 0.
+ *         In case of failure: non zero value with error code.
+ */
+int write_mhl_index(
+  const wchar_t* index_wpath,
+  const wchar_t* abs_mhl_wpath,
+  const st_mhl_index_key* p_key,
+  st_mhl_file_wcontent* mhl_wcontent);
+
+#endif //_MHL_TOOLS_PARSEMHL_MHL_INDEX_H_
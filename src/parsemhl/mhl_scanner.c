@@ -0,0 +1,1184 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: mhl_scanner.c
+ *
+ * Scanner of MHL files, specialised for the MHL v1 element set.
+ *
+ * Markup is searched with memchr(), which is vectorized in the common
+ * C libraries, values are passed to the caller as slices of the scanned
+ * buffer. Only values containing entity references or carriage returns
+ * are decoded into a separate buffer.
+ *
+ * Each construct the scanner doesn't check as strictly as libxml2 does
+ * (DTD, CDATA, namespace prefixes, other encodings, etc.) makes it give
+ * up with ERRCODE_NOT_IMPLEMENTED, so documents are either scanned with
+ * the same result as libxml2 gives, or left to libxml2.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <facade_info/error_codes.h>
+
+#include "mhl_scanner.h"
+
+#define MHL_SCAN_MAX_DEPTH 256
+#define MHL_SCAN_MAX_ATTRS 16
+
+#define ONES_64  0x0101010101010101ULL
+#define HIGHS_64 0x8080808080808080ULL
+
+#define IS_XML_SPACE(c) \
+  ((c) == ' ' || (c) == '\n' || (c) == '\t' || (c) == '\r')
+
+typedef struct _st_scan_slice
+{
+  const char* ptr;
+  size_t sz;
+} st_scan_slice;
+
+typedef struct _st_scan_tag
+{
+  st_scan_slice name;
+  st_scan_slice attr_names[MHL_SCAN_MAX_ATTRS];
+  st_scan_slice attr_values[MHL_SCAN_MAX_ATTRS]; // not decoded
+  int attrs_num;
+  unsigned char is_empty;
+} st_scan_tag;
+
+typedef struct _st_scanner
+{
+  const char* end;
+  char* decode_buf;
+  size_t decode_buf_sz;
+  MhlScanCallback callback;
+  void* data;
+} st_scanner;
+
+// children of "<hash>" tag, which values are passed to the callback
+static const char* const HASH_CHILD_TAGS[] =
+{
+  "file",
+  "size",
+  "lastmodificationdate",
+  "md5",
+  "sha1",
+  "xxhash",
+  "xxhash64",
+  "xxhash64be",
+  "null",
+  NULL
+};
+
+//---------------------------------------------------------
+//
+// Characters and text checks
+//
+//---------------------------------------------------------
+
+static int
+aux_is_xml_char(unsigned long cp)
+{
+  return cp == 0x9 || cp == 0xA || cp == 0xD ||
+    (cp >= 0x20 && cp <= 0xD7FF) ||
+    (cp >= 0xE000 && cp <= 0xFFFD) ||
+    (cp >= 0x10000 && cp <= 0x10FFFF);
+}
+
+/* Checks that buffer is valid UTF-8 text, which contains only
+ * characters allowed in XML documents.
+ * @return In case of success: 0
+ *         ERRCODE_NOT_IMPLEMENTED otherwise
+ */
+static int
+aux_check_xml_chars(const unsigned char* p, const unsigned char* end)
+{
+  unsigned long long w;
+  unsigned long cp;
+  int len;
+  int i;
+
+  while (p < end)
+  {
+    // fast path: 8 ASCII characters without control ones
+    if (end - p >= 8)
+    {
+      memcpy(&w, p, sizeof(w));
+      if (((w | (w - ONES_64 * 0x20)) & HIGHS_64) == 0)
+      {
+        p += 8;
+        continue;
+      }
+    }
+
+    if (*p < 0x80)
+    {
+      if (*p < 0x20 && !IS_XML_SPACE(*p))
+      {
+        return ERRCODE_NOT_IMPLEMENTED;
+      }
+      ++p;
+      continue;
+    }
+
+    if ((*p & 0xE0) == 0xC0)
+    {
+      len = 2;
+      cp = *p & 0x1F;
+    }
+    else if ((*p & 0xF0) == 0xE0)
+    {
+      len = 3;
+      cp = *p & 0x0F;
+    }
+    else if ((*p & 0xF8) == 0xF0)
+    {
+      len = 4;
+      cp = *p & 0x07;
+    }
+    else
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    if (end - p < len)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    for (i = 1; i < len; ++i)
+    {
+      if ((p[i] & 0xC0) != 0x80)
+      {
+        return ERRCODE_NOT_IMPLEMENTED;
+      }
+      cp = (cp << 6) | (p[i] & 0x3F);
+    }
+
+    // overlong sequences
+    if ((len == 2 && cp < 0x80) ||
+        (len == 3 && cp < 0x800) ||
+        (len == 4 && cp < 0x10000))
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    if (!aux_is_xml_char(cp))
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    p += len;
+  }
+
+  return 0;
+}
+
+/* Decodes entity references and normalizes line ends in text
+ * or attribute value. Decoded text is never longer than the source one.
+ *
+ * @param dst - destination buffer, NULL in order to check the text only
+ * @return In case of success: 0
+ *         ERRCODE_NOT_IMPLEMENTED for unknown or malformed references
+ */
+static int
+aux_decode_text(
+  const char* src,
+  size_t src_sz,
+  unsigned char is_attr,
+  char* dst,
+  size_t* p_dst_sz)
+{
+  const char* end = src + src_sz;
+  const char* ref;
+  const char* semi;
+  size_t ref_sz;
+  size_t dst_sz = 0;
+  unsigned long cp;
+  int digit;
+  int base;
+  char c;
+
+  while (src < end)
+  {
+    c = *src;
+    if (c == '&')
+    {
+      ref = src + 1;
+      semi = memchr(ref, ';', end - ref);
+      if (semi == NULL)
+      {
+        return ERRCODE_NOT_IMPLEMENTED;
+      }
+      ref_sz = semi - ref;
+      src = semi + 1;
+
+      if (ref_sz == 2 && !memcmp(ref, "lt", 2))
+      {
+        cp = '<';
+      }
+      else if (ref_sz == 2 && !memcmp(ref, "gt", 2))
+      {
+        cp = '>';
+      }
+      else if (ref_sz == 3 && !memcmp(ref, "amp", 3))
+      {
+        cp = '&';
+      }
+      else if (ref_sz == 4 && !memcmp(ref, "quot", 4))
+      {
+        cp = '"';
+      }
+      else if (ref_sz == 4 && !memcmp(ref, "apos", 4))
+      {
+        cp = '\'';
+      }
+      else if (ref_sz >= 2 && ref[0] == '#')
+      {
+        // character reference
+        base = 10;
+        ++ref;
+        --ref_sz;
+        if (*ref == 'x')
+        {
+          base = 16;
+          ++ref;
+          --ref_sz;
+        }
+
+        if (ref_sz == 0)
+        {
+          return ERRCODE_NOT_IMPLEMENTED;
+        }
+
+        for (cp = 0; ref < semi; ++ref)
+        {
+          if (*ref >= '0' && *ref <= '9')
+          {
+            digit = *ref - '0';
+          }
+          else if (base == 16 && *ref >= 'a' && *ref <= 'f')
+          {
+            digit = *ref - 'a' + 10;
+          }
+          else if (base == 16 && *ref >= 'A' && *ref <= 'F')
+          {
+            digit = *ref - 'A' + 10;
+          }
+          else
+          {
+            return ERRCODE_NOT_IMPLEMENTED;
+          }
+
+          cp = cp * base + digit;
+          if (cp > 0x10FFFF)
+          {
+            return ERRCODE_NOT_IMPLEMENTED;
+          }
+        }
+
+        if (!aux_is_xml_char(cp))
+        {
+          return ERRCODE_NOT_IMPLEMENTED;
+        }
+      }
+      else
+      {
+        // entities defined in DTD are not supported
+        return ERRCODE_NOT_IMPLEMENTED;
+      }
+
+      // write UTF-8 sequence of the character
+      if (dst != NULL)
+      {
+        if (cp < 0x80)
+        {
+          dst[dst_sz] = (char) cp;
+        }
+        else if (cp < 0x800)
+        {
+          dst[dst_sz] = (char) (0xC0 | (cp >> 6));
+          dst[dst_sz + 1] = (char) (0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+          dst[dst_sz] = (char) (0xE0 | (cp >> 12));
+          dst[dst_sz + 1] = (char) (0x80 | ((cp >> 6) & 0x3F));
+          dst[dst_sz + 2] = (char) (0x80 | (cp & 0x3F));
+        }
+        else
+        {
+          dst[dst_sz] = (char) (0xF0 | (cp >> 18));
+          dst[dst_sz + 1] = (char) (0x80 | ((cp >> 12) & 0x3F));
+          dst[dst_sz + 2] = (char) (0x80 | ((cp >> 6) & 0x3F));
+          dst[dst_sz + 3] = (char) (0x80 | (cp & 0x3F));
+        }
+      }
+      dst_sz +=
+        cp < 0x80 ? 1 : (cp < 0x800 ? 2 : (cp < 0x10000 ? 3 : 4));
+      continue;
+    }
+
+    if (c == '\r')
+    {
+      // "\r\n" and single "\r" are read as "\n"
+      c = '\n';
+      if (src + 1 < end && src[1] == '\n')
+      {
+        ++src;
+      }
+    }
+
+    if (is_attr && IS_XML_SPACE(c))
+    {
+      // attribute value normalization
+      c = ' ';
+    }
+
+    if (dst != NULL)
+    {
+      dst[dst_sz] = c;
+    }
+    ++dst_sz;
+    ++src;
+  }
+
+  if (p_dst_sz != NULL)
+  {
+    *p_dst_sz = dst_sz;
+  }
+  return 0;
+}
+
+/* Checks character data between tags.
+ * @return In case of success: 0
+ *         ERRCODE_NOT_IMPLEMENTED otherwise
+ */
+static int
+aux_check_text(const char* src, size_t src_sz)
+{
+  const char* end = src + src_sz;
+  const char* p;
+
+  if (memchr(src, '&', src_sz) != NULL)
+  {
+    if (aux_decode_text(src, src_sz, 0, NULL, NULL) != 0)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+  }
+
+  // "]]>" is not allowed in character data
+  for (p = src; (p = memchr(p, ']', end - p)) != NULL; ++p)
+  {
+    if (end - p >= 3 && p[1] == ']' && p[2] == '>')
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+  }
+
+  return 0;
+}
+
+/* Returns value of text or attribute. If there is nothing to decode,
+ * the source slice is returned as is, otherwise it is decoded into
+ * the scanner buffer.
+ */
+static int
+aux_get_value(
+  st_scanner* sc,
+  const char* src,
+  size_t src_sz,
+  unsigned char is_attr,
+  const char** p_value,
+  size_t* p_value_sz)
+{
+  char* buf;
+
+  if (!is_attr &&
+      memchr(src, '&', src_sz) == NULL &&
+      memchr(src, '\r', src_sz) == NULL)
+  {
+    *p_value = src;
+    *p_value_sz = src_sz;
+    return 0;
+  }
+
+  if (sc->decode_buf_sz < src_sz)
+  {
+    buf = (char*) realloc(sc->decode_buf, src_sz);
+    if (buf == NULL)
+    {
+      return ERRCODE_OUT_OF_MEM;
+    }
+    sc->decode_buf = buf;
+    sc->decode_buf_sz = src_sz;
+  }
+
+  *p_value = sc->decode_buf;
+  return aux_decode_text(src, src_sz, is_attr, sc->decode_buf, p_value_sz);
+}
+
+//---------------------------------------------------------
+//
+// Markup
+//
+//---------------------------------------------------------
+
+static int
+aux_is_name_start_char(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static int
+aux_is_name_char(char c)
+{
+  return aux_is_name_start_char(c) || (c >= '0' && c <= '9') ||
+    c == '-' || c == '.';
+}
+
+static int
+aux_slice_equals(const st_scan_slice* slice, const char* str)
+{
+  size_t sz = strlen(str);
+  return slice->sz == sz && !memcmp(slice->ptr, str, sz);
+}
+
+/* Reads ASCII name. Names with namespace prefixes are not accepted,
+ * except of namespace declarations in attributes.
+ * @return Position after the name, or NULL if there is no valid name
+ */
+static const char*
+aux_scan_name(
+  const char* p,
+  const char* end,
+  unsigned char is_attr,
+  st_scan_slice* name)
+{
+  const char* beg = p;
+
+  if (p >= end || !aux_is_name_start_char(*p))
+  {
+    return NULL;
+  }
+
+  for (++p; p < end && aux_is_name_char(*p); ++p);
+
+  if (p < end && *p == ':')
+  {
+    if (!is_attr || p - beg != 5 || memcmp(beg, "xmlns", 5))
+    {
+      return NULL;
+    }
+
+    ++p;
+    if (p >= end || !aux_is_name_start_char(*p))
+    {
+      return NULL;
+    }
+    for (++p; p < end && aux_is_name_char(*p); ++p);
+  }
+
+  name->ptr = beg;
+  name->sz = p - beg;
+  return p;
+}
+
+static const char*
+aux_skip_spaces(const char* p, const char* end)
+{
+  while (p < end && IS_XML_SPACE(*p))
+  {
+    ++p;
+  }
+  return p;
+}
+
+/* Reads attribute: name, "=" and quoted value.
+ * @return Position after the attribute, or NULL if attribute is malformed
+ */
+static const char*
+aux_scan_attr(
+  const char* p,
+  const char* end,
+  st_scan_slice* name,
+  st_scan_slice* value)
+{
+  const char* q;
+  char quote;
+
+  p = aux_scan_name(p, end, 1, name);
+  if (p == NULL)
+  {
+    return NULL;
+  }
+
+  p = aux_skip_spaces(p, end);
+  if (p >= end || *p != '=')
+  {
+    return NULL;
+  }
+
+  p = aux_skip_spaces(p + 1, end);
+  if (p >= end || (*p != '"' && *p != '\''))
+  {
+    return NULL;
+  }
+
+  quote = *p++;
+  q = memchr(p, quote, end - p);
+  if (q == NULL || memchr(p, '<', q - p) != NULL)
+  {
+    return NULL;
+  }
+
+  if (memchr(p, '&', q - p) != NULL &&
+      aux_decode_text(p, q - p, 1, NULL, NULL) != 0)
+  {
+    return NULL;
+  }
+
+  value->ptr = p;
+  value->sz = q - p;
+  return q + 1;
+}
+
+/* Reads start tag, *pp points to '<'
+ * @return In case of success: 0
+ *         ERRCODE_NOT_IMPLEMENTED otherwise
+ */
+static int
+aux_scan_start_tag(st_scanner* sc, const char** pp, st_scan_tag* tag)
+{
+  const char* end = sc->end;
+  const char* p;
+  const char* attr_beg;
+  int i;
+
+  p = aux_scan_name(*pp + 1, end, 0, &tag->name);
+  if (p == NULL)
+  {
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  tag->attrs_num = 0;
+  tag->is_empty = 0;
+  for (;;)
+  {
+    attr_beg = p;
+    p = aux_skip_spaces(p, end);
+    if (p >= end)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    if (*p == '>')
+    {
+      ++p;
+      break;
+    }
+
+    if (*p == '/')
+    {
+      if (p + 1 >= end || p[1] != '>')
+      {
+        return ERRCODE_NOT_IMPLEMENTED;
+      }
+      tag->is_empty = 1;
+      p += 2;
+      break;
+    }
+
+    // attributes must be separated by spaces
+    if (p == attr_beg || tag->attrs_num == MHL_SCAN_MAX_ATTRS)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    p =
+      aux_scan_attr(
+        p,
+        end,
+        &tag->attr_names[tag->attrs_num],
+        &tag->attr_values[tag->attrs_num]);
+    if (p == NULL)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    for (i = 0; i < tag->attrs_num; ++i)
+    {
+      if (tag->attr_names[i].sz == tag->attr_names[tag->attrs_num].sz &&
+          !memcmp(tag->attr_names[i].ptr,
+                  tag->attr_names[tag->attrs_num].ptr,
+                  tag->attr_names[i].sz))
+      {
+        // duplicated attribute
+        return ERRCODE_NOT_IMPLEMENTED;
+      }
+    }
+    ++tag->attrs_num;
+  }
+
+  *pp = p;
+  return 0;
+}
+
+/* Reads end tag of the element with given name, *pp points to "</"
+ * @return In case of success: 0
+ *         ERRCODE_NOT_IMPLEMENTED otherwise
+ */
+static int
+aux_scan_end_tag(st_scanner* sc, const char** pp, const st_scan_slice* name)
+{
+  const char* p = *pp + 2;
+
+  if ((size_t) (sc->end - p) < name->sz || memcmp(p, name->ptr, name->sz))
+  {
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  p = aux_skip_spaces(p + name->sz, sc->end);
+  if (p >= sc->end || *p != '>')
+  {
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  *pp = p + 1;
+  return 0;
+}
+
+/* Skips comment, *pp points to "<!--"
+ */
+static int
+aux_skip_comment(st_scanner* sc, const char** pp)
+{
+  const char* p = *pp + 4;
+
+  for (;;)
+  {
+    p = memchr(p, '-', sc->end - p);
+    if (p == NULL || sc->end - p < 3)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    if (p[1] == '-')
+    {
+      // "--" is allowed at the end of comment only
+      if (p[2] != '>')
+      {
+        return ERRCODE_NOT_IMPLEMENTED;
+      }
+
+      *pp = p + 3;
+      return 0;
+    }
+    ++p;
+  }
+}
+
+/* Skips processing instruction, *pp points to "<?"
+ */
+static int
+aux_skip_pi(st_scanner* sc, const char** pp)
+{
+  st_scan_slice target;
+  const char* p;
+
+  p = aux_scan_name(*pp + 2, sc->end, 0, &target);
+  if (p == NULL || (target.sz == 3 &&
+                    (target.ptr[0] == 'x' || target.ptr[0] == 'X') &&
+                    (target.ptr[1] == 'm' || target.ptr[1] == 'M') &&
+                    (target.ptr[2] == 'l' || target.ptr[2] == 'L')))
+  {
+    // XML declaration is allowed only at the beginning of document
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  if (p < sc->end && !IS_XML_SPACE(*p) && *p != '?')
+  {
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  for (;;)
+  {
+    p = memchr(p, '?', sc->end - p);
+    if (p == NULL || sc->end - p < 2)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    if (p[1] == '>')
+    {
+      *pp = p + 2;
+      return 0;
+    }
+    ++p;
+  }
+}
+
+/* Skips spaces, comments and processing instructions
+ */
+static int
+aux_skip_misc(st_scanner* sc, const char** pp)
+{
+  int res;
+  const char* p = *pp;
+
+  for (;;)
+  {
+    p = aux_skip_spaces(p, sc->end);
+    if (sc->end - p >= 4 && !memcmp(p, "<!--", 4))
+    {
+      res = aux_skip_comment(sc, &p);
+    }
+    else if (sc->end - p >= 2 && p[0] == '<' && p[1] == '?')
+    {
+      res = aux_skip_pi(sc, &p);
+    }
+    else
+    {
+      break;
+    }
+
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  *pp = p;
+  return 0;
+}
+
+/* Reads XML declaration, *pp points to "<?xml"
+ * Only version 1.0 and UTF-8 encoding are accepted.
+ */
+static int
+aux_scan_xml_decl(st_scanner* sc, const char** pp)
+{
+  static const char* const DECL_ATTRS[] =
+  {
+    "version",
+    "encoding",
+    "standalone",
+    NULL
+  };
+  const char* p = *pp + 5;
+  const char* attr_beg;
+  st_scan_slice name;
+  st_scan_slice value;
+  int attr_i = 0;
+  int found_attrs = 0;
+
+  for (;;)
+  {
+    attr_beg = p;
+    p = aux_skip_spaces(p, sc->end);
+    if (sc->end - p >= 2 && p[0] == '?' && p[1] == '>')
+    {
+      p += 2;
+      break;
+    }
+
+    if (p == attr_beg)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    p = aux_scan_attr(p, sc->end, &name, &value);
+    if (p == NULL)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    // pseudo attributes are allowed in fixed order only
+    while (DECL_ATTRS[attr_i] != NULL &&
+           !aux_slice_equals(&name, DECL_ATTRS[attr_i]))
+    {
+      ++attr_i;
+    }
+
+    if (DECL_ATTRS[attr_i] == NULL || (found_attrs == 0 && attr_i != 0))
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    if ((attr_i == 0 && !aux_slice_equals(&value, "1.0")) ||
+        (attr_i == 1 && !aux_slice_equals(&value, "UTF-8") &&
+                        !aux_slice_equals(&value, "utf-8")) ||
+        (attr_i == 2 && !aux_slice_equals(&value, "yes") &&
+                        !aux_slice_equals(&value, "no")))
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    ++attr_i;
+    ++found_attrs;
+  }
+
+  if (found_attrs == 0)
+  {
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  *pp = p;
+  return 0;
+}
+
+/* Returns decoded value of the attribute, or NULL value, if tag
+ * has no such attribute.
+ */
+static int
+aux_get_attr_value(
+  st_scanner* sc,
+  const st_scan_tag* tag,
+  const char* attr_name,
+  const char** p_value,
+  size_t* p_value_sz)
+{
+  int i;
+
+  for (i = 0; i < tag->attrs_num; ++i)
+  {
+    if (aux_slice_equals(&tag->attr_names[i], attr_name))
+    {
+      return
+        aux_get_value(
+          sc,
+          tag->attr_values[i].ptr,
+          tag->attr_values[i].sz,
+          1,
+          p_value,
+          p_value_sz);
+    }
+  }
+
+  *p_value = NULL;
+  *p_value_sz = 0;
+  return 0;
+}
+
+//---------------------------------------------------------
+//
+// MHL elements
+//
+//---------------------------------------------------------
+
+static const char*
+aux_known_hash_child(const st_scan_slice* name)
+{
+  int i;
+
+  for (i = 0; HASH_CHILD_TAGS[i] != NULL; ++i)
+  {
+    if (aux_slice_equals(name, HASH_CHILD_TAGS[i]))
+    {
+      return HASH_CHILD_TAGS[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Reads content and end tag of known child of the "<hash>" tag,
+ * *pp points after its start tag.
+ */
+static int
+aux_scan_hash_child(
+  st_scanner* sc,
+  const char** pp,
+  const char* child_name,
+  const st_scan_tag* tag)
+{
+  int res;
+  unsigned char is_null;
+  const char* text;
+  const char* lt;
+  const char* value;
+  size_t value_sz;
+
+  is_null = !strcmp(child_name, "null");
+  if (tag->is_empty)
+  {
+    if (!is_null)
+    {
+      // libxml2 returns no text for such tags, leave it to libxml2
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    return sc->callback(MHL_SE_HASH_CHILD, child_name, NULL, 0, sc->data);
+  }
+
+  text = *pp;
+  lt = memchr(text, '<', sc->end - text);
+  if (lt == NULL || sc->end - lt < 2 || lt[1] != '/' ||
+      (lt == text && !is_null))
+  {
+    // nested tags, comments or no text at all
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  res = aux_check_text(text, lt - text);
+  if (res == 0)
+  {
+    *pp = lt;
+    res = aux_scan_end_tag(sc, pp, &tag->name);
+  }
+  if (res != 0)
+  {
+    return res;
+  }
+
+  if (is_null)
+  {
+    return sc->callback(MHL_SE_HASH_CHILD, child_name, NULL, 0, sc->data);
+  }
+
+  res = aux_get_value(sc, text, lt - text, 0, &value, &value_sz);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  return sc->callback(MHL_SE_HASH_CHILD, child_name, value, value_sz, sc->data);
+}
+
+/* Reads content of the root tag, *pp points after its start tag.
+ */
+static int
+aux_scan_hashlist(st_scanner* sc, const char** pp, const st_scan_slice* root)
+{
+  int res;
+  int level;
+  unsigned char in_hash = 0;
+  const char* p = *pp;
+  const char* lt;
+  const char* child_name;
+  const char* value;
+  size_t value_sz;
+  st_scan_tag tag;
+  st_scan_slice open_tags[MHL_SCAN_MAX_DEPTH];
+
+  open_tags[0] = *root;
+  level = 1;
+  while (level > 0)
+  {
+    lt = memchr(p, '<', sc->end - p);
+    if (lt == NULL || sc->end - lt < 2)
+    {
+      return ERRCODE_NOT_IMPLEMENTED;
+    }
+
+    res = aux_check_text(p, lt - p);
+    if (res != 0)
+    {
+      return res;
+    }
+    p = lt;
+
+    if (p[1] == '/')
+    {
+      res = aux_scan_end_tag(sc, &p, &open_tags[level - 1]);
+      if (res != 0)
+      {
+        return res;
+      }
+
+      --level;
+      if (in_hash && level == 1)
+      {
+        in_hash = 0;
+        res = sc->callback(MHL_SE_HASH_END, "hash", NULL, 0, sc->data);
+      }
+    }
+    else if (p[1] == '!')
+    {
+      if (sc->end - p < 4 || memcmp(p, "<!--", 4))
+      {
+        // CDATA or DTD declarations
+        return ERRCODE_NOT_IMPLEMENTED;
+      }
+      res = aux_skip_comment(sc, &p);
+    }
+    else if (p[1] == '?')
+    {
+      res = aux_skip_pi(sc, &p);
+    }
+    else
+    {
+      res = aux_scan_start_tag(sc, &p, &tag);
+      if (res != 0)
+      {
+        return res;
+      }
+
+      if (level == 1 && aux_slice_equals(&tag.name, "hash"))
+      {
+        res = aux_get_attr_value(sc, &tag, "referencehhashlist",
+                                 &value, &value_sz);
+        if (res == 0)
+        {
+          res =
+            sc->callback(MHL_SE_HASH_START, "hash", value, value_sz, sc->data);
+        }
+        if (res == 0 && tag.is_empty)
+        {
+          res = sc->callback(MHL_SE_HASH_END, "hash", NULL, 0, sc->data);
+        }
+        in_hash = !tag.is_empty;
+      }
+      else if (in_hash && level == 2 &&
+               (child_name = aux_known_hash_child(&tag.name)) != NULL)
+      {
+        // end tag is read together with the content
+        res = aux_scan_hash_child(sc, &p, child_name, &tag);
+        tag.is_empty = 1;
+      }
+
+      if (res == 0 && !tag.is_empty)
+      {
+        if (level == MHL_SCAN_MAX_DEPTH)
+        {
+          return ERRCODE_NOT_IMPLEMENTED;
+        }
+        open_tags[level++] = tag.name;
+      }
+    }
+
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  *pp = p;
+  return 0;
+}
+
+static int
+aux_scan_document(st_scanner* sc, const char* p)
+{
+  int res;
+  const char* value;
+  size_t value_sz;
+  st_scan_tag tag;
+
+  // UTF-8 BOM
+  if (sc->end - p >= 3 && !memcmp(p, "\xEF\xBB\xBF", 3))
+  {
+    p += 3;
+  }
+
+  res =
+    aux_check_xml_chars((const unsigned char*) p,
+                        (const unsigned char*) sc->end);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  if (sc->end - p >= 6 && !memcmp(p, "<?xml", 5) && IS_XML_SPACE(p[5]))
+  {
+    res = aux_scan_xml_decl(sc, &p);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  res = aux_skip_misc(sc, &p);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  // the root tag, libxml2 reports all other cases
+  if (sc->end - p < 2 || p[0] != '<' ||
+      aux_scan_start_tag(sc, &p, &tag) != 0 ||
+      !aux_slice_equals(&tag.name, "hashlist"))
+  {
+    return ERRCODE_NOT_IMPLEMENTED;
+  }
+
+  res = aux_get_attr_value(sc, &tag, "version", &value, &value_sz);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = sc->callback(MHL_SE_ROOT, "hashlist", value, value_sz, sc->data);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  if (!tag.is_empty)
+  {
+    res = aux_scan_hashlist(sc, &p, &tag.name);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  res = aux_skip_misc(sc, &p);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  return p == sc->end ? 0 : ERRCODE_NOT_IMPLEMENTED;
+}
+
+int scan_mhl_buffer(
+  const char* buf,
+  size_t buf_sz,
+  MhlScanCallback callback,
+  void* data)
+{
+  int res;
+  st_scanner sc;
+
+  if (buf == NULL || callback == NULL)
+  {
+    return ERRCODE_WRONG_ARGUMENTS;
+  }
+
+  sc.end = buf + buf_sz;
+  sc.decode_buf = NULL;
+  sc.decode_buf_sz = 0;
+  sc.callback = callback;
+  sc.data = data;
+
+  res = aux_scan_document(&sc, buf);
+
+  free(sc.decode_buf);
+  return res;
+}
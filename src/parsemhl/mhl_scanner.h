@@ -0,0 +1,85 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: mhl_scanner.h
+ *
+ * Scanner of MHL files, specialised for the MHL v1 element set.
+ * It works on the whole MHL file content in memory (usually mmap'ed)
+ * and reports values of "<hash>" items without copying of them.
+ *
+ * Only UTF-8 documents with plain structure are handled: the scanner
+ * gives up on DTDs, CDATA sections, namespace prefixes, unknown entities
+ * and on any markup it can not check strictly. Such documents should be
+ * parsed by libxml2 instead.
+ */
+
+#ifndef _MHL_TOOLS_PARSEMHL_MHL_SCANNER_H_
+#define _MHL_TOOLS_PARSEMHL_MHL_SCANNER_H_
+
+#include <stddef.h>
+
+typedef enum _MHL_SCAN_EVENT
+{
+  MHL_SE_ROOT = 0,     // "<hashlist>" tag, value: "version" attribute
+  MHL_SE_HASH_START,   // "<hash>" tag, value: "referencehhashlist" attribute
+  MHL_SE_HASH_CHILD,   // known child tag of "<hash>", value: text content
+  MHL_SE_HASH_END      // end of "<hash>" tag, no value
+} MHL_SCAN_EVENT;
+
+/*
+ * Callback, called for each MHL element found by the scanner.
+ *
+ * @param name - tag name, zero-terminated
+ * @param value - value of the tag (see MHL_SCAN_EVENT) with decoded
+ *                entities, NOT zero-terminated. NULL if there is no value.
+ *                The pointer is valid only during the call.
+ * @param value_sz - size of the value in bytes
+ * @return 0 in order to continue scanning,
+ *         not null error code in order to stop it.
+ */
+typedef int (*MhlScanCallback)(
+  MHL_SCAN_EVENT event,
+  const char* name,
+  const char* value,
+  size_t value_sz,
+  void* data);
+
+/*
+ * Scans content of MHL file.
+ *
+ * @return In case of success: 0
+ *         ERRCODE_NOT_IMPLEMENTED if document can not be handled
+ *         by the scanner strictly, it should be parsed by a generic
+ *         XML parser then.
+ *         Error code returned by the callback otherwise.
+ */
+int scan_mhl_buffer(
+  const char* buf,
+  size_t buf_sz,
+  MhlScanCallback callback,
+  void* data);
+
+#endif //_MHL_TOOLS_PARSEMHL_MHL_SCANNER_H_
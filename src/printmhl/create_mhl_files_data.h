@@ -26,6 +26,8 @@
 #ifndef _MHL_TOOLS_PRINTMHL_CREATE_MHL_FILES_DATA_H_
 #define _MHL_TOOLS_PRINTMHL_CREATE_MHL_FILES_DATA_H_
 
+#include <zlib.h>
+
 typedef struct _st_creator_data
 {
   char* login_name_str;
@@ -53,6 +55,8 @@ typedef struct _st_mhl_file_data
   st_fs_wpath mhl_dir_wpath;
   wchar_t* mhl_wpath;
   FILE* fl_descr;
+  // used instead of fl_descr, when MHL file is written gzip-compressed
+  gzFile gz_descr;
 
   // The list of references to files in this directory or it's subdirectories
   st_files_refs* files_inside_dir;
@@ -64,6 +68,9 @@ typedef struct _st_mhl_dirs_data
   st_mhl_file_data* mhl_files_data;
   size_t mhl_files_data_capacity;
   unsigned int mhl_files_data_cnt;
+
+  // write MHL files gzip-compressed (as .mhl.gz)
+  unsigned char gzip_output;
 } st_mhl_dirs_data;
 
 #define MHLCREATE_NAME "mhl"
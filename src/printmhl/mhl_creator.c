@@ -39,6 +39,7 @@
 #include <generics/os_check.h>
 #include <generics/char_conversions.h>
 #include <generics/std_funcs_os_anonymizer.h>
+#include <generics/error_output.h>
 #include <generics/memory_management.h>
 #include <generics/filesystem_handlers/public_interface.h>
 
@@ -55,6 +56,8 @@
 #define MHLNAME_TIME_SUBSTR_LEN 17
 #define MHLNAME_END_STR ".mhl"
 #define MHLNAME_END_WSTR L".mhl"
+#define MHLNAME_GZ_END_STR ".mhl.gz"
+#define MHLNAME_GZ_END_WSTR L".mhl.gz"
 
 #define DEFAULT_MHL_FILE_NAME "media-hash-list-file.mhl"
 
@@ -66,6 +69,7 @@
 void finalize_mhlcreate_data(st_mhlcreate_data* data)
 {
   unsigned int i;
+  unsigned int j;
   st_file_data_ext* fl_data; 
   st_mhl_file_data* mhl_data;
   st_files_refs* tmp_ref;
@@ -83,6 +87,11 @@ void finalize_mhlcreate_data(st_mhlcreate_data* data)
       fclose(mhl_data->fl_descr);
     }
 
+    if (mhl_data->gz_descr != NULL)
+    {
+      gzclose(mhl_data->gz_descr);
+    }
+
     // iterate through a list of files references, and clear it
     while (mhl_data->last != NULL)
     {
@@ -115,8 +124,13 @@ void finalize_mhlcreate_data(st_mhlcreate_data* data)
   for (i=0; i< data->input_data.files_data_cnt; ++i)
   {
     fl_data = data->input_data.files_data_array + i;
-    free(fl_data->orig_wfilename);
     free_fs_wpath(&(fl_data->file_wpath));
+    if (data->input_data.is_data_in_arena)
+    {
+      continue;
+    }
+
+    free(fl_data->orig_wfilename);
     free(fl_data->lastmodificationdate_str);
 
 #ifdef WIN
@@ -126,14 +140,21 @@ void finalize_mhlcreate_data(st_mhlcreate_data* data)
     free(fl_data->hashdate_str);
     free(fl_data->major_hash.hash_sum);
     free(fl_data->aux_hash.hash_sum);
+    for (j = 0; j < fl_data->more_hashes_num; ++j)
+    {
+      free(fl_data->more_hashes[j].hash_sum);
+    }
+    free(fl_data->more_hashes);
   }
 
   free(data->input_data.files_data_array);
+  free_memory_arena(&data->input_data.data_arena);
 }
 
 int fill_mhl_path( 
   st_mhl_file_data* data, 
   const wchar_t* mhl_wdirname,
+  const wchar_t* mhl_wname_end,
   const struct tm* start_gmtm,
   st_conversion_settings* p_cs)
 {
@@ -169,7 +190,7 @@ int fill_mhl_path(
 #endif
   }
  
-  wend_len = wcslen(MHLNAME_END_WSTR);
+  wend_len = wcslen(mhl_wname_end);
 
   if (containing_wdirname != NULL)
   {
@@ -179,8 +200,8 @@ int fill_mhl_path(
     mhl_wfile_name = (wchar_t*)calloc(wmhlfile_len, sizeof(wchar_t));
     if (mhl_wfile_name == NULL)
     {
-      fprintf(stderr, "Failed to allocate %lu bytes for MHL file name. "
-              "Out of memory.\n", (long unsigned int)wmhlfile_len * sizeof(wchar_t));
+      error_printf("Failed to allocate %lu bytes for MHL file name. "
+                   "Out of memory.\n", (long unsigned int)wmhlfile_len * sizeof(wchar_t));
       return ERRCODE_OUT_OF_MEM;
     }
 
@@ -195,8 +216,7 @@ int fill_mhl_path(
     mhl_wfile_name = (wchar_t*)calloc(wmhlfile_len, sizeof(wchar_t));
     if (mhl_wfile_name == NULL)
     {
-      fprintf(
-        stderr, 
+      error_printf(
         "Failed to allocate %lu bytes for MHL file name. "
         "Out of memory.\n", 
         (long unsigned int)wmhlfile_len * sizeof(wchar_t));
@@ -233,7 +253,7 @@ int fill_mhl_path(
   if (wend_len != 0)
   {
     // We have already '\0' at the end of string due to calloc
-    wcsncpy(wname_shift_pointer, MHLNAME_END_WSTR, wend_len);
+    wcsncpy(wname_shift_pointer, mhl_wname_end, wend_len);
   }
 
   // Now mhl_file_name contains created file name. 
@@ -241,7 +261,7 @@ int fill_mhl_path(
   wdir_len = wcslen(mhl_wdirname);
   if (wdir_len == 0)
   {
-    fprintf(stderr, "Empty MHL directory.\n");
+    error_printf("Empty MHL directory.\n");
     return ERRCODE_INTERNAL_ERROR;
   }
 
@@ -253,9 +273,9 @@ int fill_mhl_path(
   
   if (data->mhl_wpath == NULL)
   {
-    fprintf(stderr, "Failed to allocate %lu bytes for MHL file name. "
-            "Out of memory.\n",
-            (long unsigned int)full_wmhlfile_len * sizeof(wchar_t));
+    error_printf("Failed to allocate %lu bytes for MHL file name. "
+                 "Out of memory.\n",
+                 (long unsigned int)full_wmhlfile_len * sizeof(wchar_t));
     return ERRCODE_OUT_OF_MEM;
   }
 
@@ -287,8 +307,8 @@ init_mhlcreate_data(st_mhlcreate_data* data,
   
   if (p_v_data == NULL)
   {
-    fprintf(stderr, "init_mhlcreate_data(): Internal error - "
-            "pointer to verbose data is null\n");
+    error_printf("init_mhlcreate_data(): Internal error - "
+                 "pointer to verbose data is null\n");
     return ERRCODE_INTERNAL_ERROR;
   }
   data->p_v_data = p_v_data;
@@ -335,7 +355,7 @@ int preprocess_mhlcreate_data(
 
       if (res != 0)
       {
-        fprintf(stderr, "Out of memory.\n");
+        error_printf("Out of memory.\n");
         return res;
       }
     }
@@ -345,7 +365,7 @@ int preprocess_mhlcreate_data(
     if (data->mhl_paths.mhl_files_data->mhl_wdirname == NULL)
     {
       data->mhl_paths.mhl_files_data_cnt = 0;
-      fprintf(stderr, "Out of memory.\n");
+      error_printf("Out of memory.\n");
       return ERRCODE_OUT_OF_MEM;
     }
   }
@@ -400,7 +420,12 @@ int preprocess_mhlcreate_data(
       }
     }
 
-    res = fill_mhl_path(mhl_f_data, mhl_f_data->mhl_wdirname, start_gmtm, p_cs);
+    res = fill_mhl_path(
+      mhl_f_data, 
+      mhl_f_data->mhl_wdirname,
+      data->mhl_paths.gzip_output ? MHLNAME_GZ_END_WSTR : MHLNAME_END_WSTR,
+      start_gmtm, 
+      p_cs);
     if (res != 0)
     {
       return res;
@@ -422,8 +447,34 @@ open_wfile(const wchar_t* file_wpath, FILE** fl_descr)
 
   if (*fl_descr == NULL)
   {
-    fprintf(stderr, "Cannot open file for writing: %ls. Errno=%d. Error:%s\n",
-            file_wpath, errno, strerror(errno));
+    error_printf("Cannot open file for writing: %ls. Errno=%d. Error:%s\n",
+                 file_wpath, errno, strerror(errno));
+    return ERRCODE_IO_ERROR;
+  }
+
+  return 0;
+}
+
+int
+open_gz_wfile(const wchar_t* file_wpath, gzFile* gz_descr)
+{
+  int fd;
+  int res;
+
+  res = wopen_for_create(file_wpath, &fd);
+  if (res != 0)
+  {
+    error_printf("Cannot open file for writing: %ls. Errno=%d. Error:%s\n",
+                 file_wpath, errno, strerror(errno));
+    return res;
+  }
+
+  *gz_descr = gzdopen(fd, "wb");
+  if (*gz_descr == NULL)
+  {
+    error_printf("Cannot open gzip stream for writing: %ls.\n",
+                 file_wpath);
+    mhlosi_close(fd);
     return ERRCODE_IO_ERROR;
   }
 
@@ -466,13 +517,17 @@ timetostr(char** time_str, time_t seconds_since_epoche_start,
   *time_str = (char*)calloc(TIME_STR_SZ, sizeof(char));
   if (*time_str == NULL)
   {
-    fprintf(stderr, "Out of memory.\n");
+    error_printf("Out of memory.\n");
     return ERRCODE_OUT_OF_MEM;
   }
 
+  return format_xml_date(*time_str, cur_gmtm);
+}
+
+int format_xml_date(char* date_str, const struct tm* gmtm)
+{
   // 2011-03-10T07:49:21Z
-  res = strftime(*time_str, TIME_STR_SZ, "%Y-%m-%dT%H:%M:%SZ", cur_gmtm);
-  if (res == 0)
+  if (strftime(date_str, MHL_DATE_LENGTH + 1, "%Y-%m-%dT%H:%M:%SZ", gmtm) == 0)
   {
     return ERRCODE_UNRECOGNIZED_TIME;
   }
@@ -488,9 +543,9 @@ int get_xml_date(char** date_str, struct tm* cur_gmtm)
   cur_tm = time(NULL);
   if (cur_tm < 0)
   {
-    fprintf(stderr, "Unknown error, time() call failed. " 
-            "Errno=%d. Error:%s\n",
-            errno, strerror(errno));
+    error_printf("Unknown error, time() call failed. " 
+                 "Errno=%d. Error:%s\n",
+                 errno, strerror(errno));
     return ERRCODE_UNKNOWN_ERROR;
   }
 
@@ -510,7 +565,7 @@ int date_to_log_str(char** date_str, const struct tm* gmtm)
   *date_str = (char*)calloc(TIME_STR_SZ, sizeof(char));
   if (*date_str == NULL)
   {
-    fprintf(stderr, "Out of memory.\n");
+    error_printf("Out of memory.\n");
     return ERRCODE_OUT_OF_MEM;
   }
 
@@ -525,22 +580,12 @@ int date_to_log_str(char** date_str, const struct tm* gmtm)
 }
 
 int
-process_file(
+init_file_data_wpath(
   st_file_data_ext* file_data, 
-  st_fs_wpath* work_wpath,
-  st_conversion_settings* p_cs)
+  st_fs_wpath* work_wpath)
 {
-  struct tm gm_date;
-  st_mhlosi_stat wfl_stat;
   int res;
 
-  res = get_xml_date(&(file_data->hashdate_str), &gm_date);
-  if (res != 0)
-  {
-    fprintf(stderr, "Getting or processing of hashdate failed.\n");
-    return res;
-  }
-
   // fill fs_path structures
   res = init_fs_wpath(file_data->orig_wfilename, &(file_data->file_wpath));
   if (res != 0)
@@ -566,20 +611,46 @@ process_file(
       return res;
     }
   }
+
+  return 0;
+}
+
+int
+process_file(
+  st_file_data_ext* file_data, 
+  st_fs_wpath* work_wpath,
+  st_conversion_settings* p_cs)
+{
+  struct tm gm_date;
+  st_mhlosi_stat wfl_stat;
+  int res;
+
+  res = get_xml_date(&(file_data->hashdate_str), &gm_date);
+  if (res != 0)
+  {
+    error_printf("Getting or processing of hashdate failed.\n");
+    return res;
+  }
+
+  res = init_file_data_wpath(file_data, work_wpath);
+  if (res != 0)
+  {
+    return res;
+  }
  
   res = get_wfile_stat_data(file_data->orig_wfilename, &wfl_stat);
   if (res != 0)
   {
     if (res == ERRCODE_NO_SUCH_FILE)
     {
-      fprintf(stderr, "Error: File does not exist: '%ls'.\n",
-              file_data->orig_wfilename);
+      error_printf("Error: File does not exist: '%ls'.\n",
+                   file_data->orig_wfilename);
     }
     else
     {
-      fprintf(stderr, "Error: Cannot get file's data, stat() failed for file: " 
-              "%ls. Errno=%d. Error:%s\n",
-              file_data->orig_wfilename, errno, strerror(errno));
+      error_printf("Error: Cannot get file's data, stat() failed for file: " 
+                   "%ls. Errno=%d. Error:%s\n",
+                   file_data->orig_wfilename, errno, strerror(errno));
     }
     return res;
   }
@@ -591,8 +662,8 @@ process_file(
   {
     if (res == ERRCODE_UNRECOGNIZED_TIME)
     {
-      fprintf(stderr, "Processing of lastmodificationdate failed for file: %ls.\n",
-              file_data->orig_wfilename);
+      error_printf("Processing of lastmodificationdate failed for file: %ls.\n",
+                   file_data->orig_wfilename);
     }
     return res;
   }
@@ -604,8 +675,8 @@ process_file(
   {
     if (res == ERRCODE_UNRECOGNIZED_TIME)
     {
-      fprintf(stderr, "Processing of creationdate failed for file: %s.\n",
-              file_data->orig_wfilename);
+      error_printf("Processing of creationdate failed for file: %s.\n",
+                   file_data->orig_wfilename);
     }
     return res;
   }
@@ -654,7 +725,7 @@ add_data_to_containing_folders(st_mhl_dirs_data* mhl_paths_ref,
       *file_in_dir = (st_files_refs*)calloc(1, sizeof(st_files_refs));
       if (*file_in_dir == NULL)
       {
-        fprintf(stderr, "Out of memory.\n");
+        error_printf("Out of memory.\n");
         free(relative_wfilename);
         return ERRCODE_OUT_OF_MEM;
       }
@@ -672,8 +743,8 @@ add_data_to_containing_folders(st_mhl_dirs_data* mhl_paths_ref,
 
   if (!folder_found)
   {
-    fprintf(stderr, "File %ls is not in any of the specified with '-o' or '--output-folder' directory or "
-            "it's subdirectory.\n", file_data->orig_wfilename);
+    error_printf("File %ls is not in the folder of any MHL file or its "
+                 "subfolders.\n", file_data->orig_wfilename);
 
     return ERRCODE_WRONG_FILE_LOCATION;
   }
@@ -681,6 +752,149 @@ add_data_to_containing_folders(st_mhl_dirs_data* mhl_paths_ref,
   return 0;
 }
 
+/* Adds new item to files data, fills it with fill_data_with_hashes(),
+ * gets file's size and dates, and adds it to MHL files of containing
+ * folders.
+ */
+static int
+aux_add_file_to_mhlcreate_data(
+  st_mhlcreate_data* p_mhlcreate_data,
+  const wchar_t* wfilename, 
+  const MHL_HASH_TYPE* hash_types,
+  const char* const* hash_strs,
+  size_t hashes_num,
+  st_conversion_settings* p_cs)
+{
+  int res;
+  st_files_data* p_files_data;
+  size_t idx;
+
+  if (p_mhlcreate_data == NULL)
+  {
+    error_printf(
+      "add_file_to_mhlcreate_data: internal error - some data has been lost\n");
+
+    return ERRCODE_INTERNAL_ERROR;
+  }
+
+  p_files_data = &p_mhlcreate_data->input_data;
+
+  if ( p_files_data->files_data_cnt == p_files_data->files_data_capacity)
+  {
+    // increase allocated memory twice
+    res = increase_allocated_memory(
+      (void**)&p_files_data->files_data_array,
+        &p_files_data->files_data_capacity,
+        p_files_data->files_data_capacity ? 
+          p_files_data->files_data_capacity * 2 : INITIAL_FILES_CAPACITY,
+        sizeof(st_file_data_ext));
+
+    if (res != 0)
+    {
+      error_printf("Out of memory.\n");
+      return res;
+    }
+  }
+
+  idx = p_files_data->files_data_cnt;
+
+  res = fill_data_with_hashes(wfilename, hash_types, hash_strs, hashes_num,
+    p_files_data->files_data_array + idx);
+
+  ++p_files_data->files_data_cnt;
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = process_file(
+    p_files_data->files_data_array + idx, 
+    &(p_mhlcreate_data->workdir_wpath),
+    p_cs);
+
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = add_data_to_containing_folders(&(p_mhlcreate_data->mhl_paths),
+    p_files_data->files_data_array + idx, idx);
+
+  if (res != 0)
+  {
+    return res;
+  }
+
+  return 0;
+}
+
+int
+add_file_to_mhlcreate_data(
+  st_mhlcreate_data* p_mhlcreate_data,
+  const wchar_t* wfilename, 
+  const char* md5_hash_str,
+  const char* sha1_hash_str, 
+  const char* xx_hash_str, 
+  const char* xx64_hash_str, 
+  const char* xx64be_hash_str, 
+  st_conversion_settings* p_cs)
+{
+  const char* hashes[] = {
+    sha1_hash_str,
+    md5_hash_str,
+    xx_hash_str,
+    xx64_hash_str,
+    xx64be_hash_str,
+  };
+  const MHL_HASH_TYPE hash_types[] = {
+    MHL_HT_SHA1,
+    MHL_HT_MD5,
+    MHL_HT_XXHASH,
+    MHL_HT_XXHASH64,
+    MHL_HT_XXHASH64BE,
+  };
+  const char* set_hashes[2];
+  MHL_HASH_TYPE set_hash_types[2];
+  size_t set_hashes_num = 0;
+  size_t i;
+
+  // the first set hash is major one, the second set hash is aux one
+  for (i = 0; 
+       i < sizeof(hashes) / sizeof(hashes[0]) && set_hashes_num < 2; ++i)
+  {
+    if (hashes[i] != NULL)
+    {
+      set_hashes[set_hashes_num] = hashes[i];
+      set_hash_types[set_hashes_num++] = hash_types[i];
+    }
+  }
+
+  if (set_hashes_num == 0)
+  {
+    error_printf(
+      "add_file_to_mhlcreate_data: internal error - no hashes\n");
+    return ERRCODE_INTERNAL_ERROR;
+  }
+
+  return aux_add_file_to_mhlcreate_data(p_mhlcreate_data, wfilename, 
+                                        set_hash_types, set_hashes, 
+                                        set_hashes_num, p_cs);
+}
+
+int
+add_file_hashes_to_mhlcreate_data(
+  st_mhlcreate_data* p_mhlcreate_data,
+  const wchar_t* wfilename, 
+  const MHL_HASH_TYPE* hash_types,
+  const char* const* hash_strs,
+  size_t hashes_num,
+  st_conversion_settings* p_cs)
+{
+  return aux_add_file_to_mhlcreate_data(p_mhlcreate_data, wfilename, 
+                                        hash_types, hash_strs, hashes_num, 
+                                        p_cs);
+}
+
 int create_mhl_files(st_mhlcreate_data* data, st_conversion_settings* p_cs)
 {
   unsigned int i;
@@ -712,13 +926,20 @@ int create_mhl_files(st_mhlcreate_data* data, st_conversion_settings* p_cs)
 
     if (does_wpath_exist(mhl_f_data->mhl_wpath))
     {
-      fprintf(stderr,
-              "Error, while writing MHL file: %ls\nFile already exist.\n",
-              mhl_f_data->mhl_wpath);
+      error_printf(
+        "Error, while writing MHL file: %ls\nFile already exist.\n",
+        mhl_f_data->mhl_wpath);
       return ERRCODE_IO_ERROR;
     }
 
-    res = open_wfile(mhl_f_data->mhl_wpath, &mhl_f_data->fl_descr);
+    if (data->mhl_paths.gzip_output)
+    {
+      res = open_gz_wfile(mhl_f_data->mhl_wpath, &mhl_f_data->gz_descr);
+    }
+    else
+    {
+      res = open_wfile(mhl_f_data->mhl_wpath, &mhl_f_data->fl_descr);
+    }
     if (res != 0)
     {
       return res;
@@ -726,12 +947,23 @@ int create_mhl_files(st_mhlcreate_data* data, st_conversion_settings* p_cs)
 
     res = create_mhl(&data->creator_data, data->p_v_data, mhl_f_data, 
                      &data->input_data, p_cs);
+    if (res == 0 && mhl_f_data->gz_descr != NULL)
+    {
+      // compressed stream is finished on close, check it here
+      if (gzclose(mhl_f_data->gz_descr) != Z_OK)
+      {
+        error_printf("IO error: failed to finish writing of compressed "
+                     "MHL file: %ls\n", mhl_f_data->mhl_wpath);
+        res = ERRCODE_IO_ERROR;
+      }
+      mhl_f_data->gz_descr = NULL;
+    }
     if (0 == res && data->p_v_data->machine_output) {
-      fprintf(stderr, "%ls|OK\n", mhl_f_data->mhl_wpath);
+      error_printf("%ls|OK\n", mhl_f_data->mhl_wpath);
     }
     if (res != 0)
     {
-      fprintf(stderr, "Error, while writing MHL file: %ls\n", mhl_f_data->mhl_wpath);
+      error_printf("Error, while writing MHL file: %ls\n", mhl_f_data->mhl_wpath);
       return res;
     }
   }
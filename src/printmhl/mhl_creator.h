@@ -70,8 +70,24 @@ int preprocess_mhlcreate_data(
 
 int get_xml_date(char** date_str, struct tm* cur_gmtm);
 
+int convert_time_to_gmtime(time_t seconds_since_epoche_start, struct tm* gmtm);
+
+/* Formats date as in MHL files, date_str must have place for 
+ * MHL_DATE_LENGTH characters and terminating '\0'.
+ */
+int format_xml_date(char* date_str, const struct tm* gmtm);
+
 int date_to_log_str(char** date_str, const struct tm* gmtm);
 
+/* Fills absolute normalized path of file from its original name.
+ * @return In case of success: 0,
+ *         in case of failure: error code
+ */
+int
+init_file_data_wpath(
+  st_file_data_ext* file_data, 
+  st_fs_wpath* work_wpath);
+
 int
 process_file(
   st_file_data_ext* file_data, 
@@ -82,6 +98,36 @@ int
 add_data_to_containing_folders(st_mhl_dirs_data* mhl_paths_ref,
   st_file_data_ext* file_data, unsigned int file_data_idx);
 
+/* Adds file with given hashes to the data of MHL files: gets file's 
+ * size and dates, and adds it to MHL files of containing folders.
+ * Not needed hash strings are NULL, at least one must be set.
+ * @return In case of success: 0,
+ *         in case of failure: error code, and print error message to stderr
+ */
+int
+add_file_to_mhlcreate_data(
+  st_mhlcreate_data* p_mhlcreate_data,
+  const wchar_t* wfilename, 
+  const char* md5_hash_str,
+  const char* sha1_hash_str, 
+  const char* xx_hash_str, 
+  const char* xx64_hash_str, 
+  const char* xx64be_hash_str, 
+  st_conversion_settings* p_cs);
+
+/* The same as add_file_to_mhlcreate_data(), but all the given hashes are
+ * written for the file, in the order of hash_types. Types must be 
+ * different, MHL_HT_NULL and MHL_HT_UNRECOGNIZED are not supported.
+ */
+int
+add_file_hashes_to_mhlcreate_data(
+  st_mhlcreate_data* p_mhlcreate_data,
+  const wchar_t* wfilename, 
+  const MHL_HASH_TYPE* hash_types,
+  const char* const* hash_strs,
+  size_t hashes_num,
+  st_conversion_settings* p_cs);
+
 int create_mhl_files(st_mhlcreate_data* data, st_conversion_settings* p_cs);
 
 #endif // _MHL_TOOLS_PRINTMHL_MHL_CREATOR_H_
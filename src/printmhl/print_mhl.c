@@ -48,10 +48,14 @@
 
 #include <errno.h>
 #include <string.h>
+#include <stdarg.h>
+#include <zlib.h>
 
 #include <facade_info/version.h>
 #include <facade_info/error_codes.h>
 #include <generics/std_funcs_os_anonymizer.h>
+#include <generics/error_output.h>
+#include <generics/perf_stats.h>
 #include <mhltools_common/logging.h>
 #include <mhltools_common/files_data.h>
 #include "create_mhl_files_data.h"
@@ -63,28 +67,116 @@
 #endif
 #define MAX_HOST_NAME_LEN 4096
 
-static int xml_puts(const char *string, FILE *stream)
+//
+// Output into MHL file: plain, or gzip-compressed if gz_descr is opened
+//
+
+static int mhl_putc(int c, st_mhl_file_data* mhl_file)
+{
+  if (mhl_file->gz_descr != NULL)
+  {
+    return gzputc(mhl_file->gz_descr, c) == -1 ? EOF : c;
+  }
+
+  return putc(c, mhl_file->fl_descr);
+}
+
+static int mhl_puts(const char* str, st_mhl_file_data* mhl_file)
+{
+  if (mhl_file->gz_descr != NULL)
+  {
+    return gzputs(mhl_file->gz_descr, str) == -1 ? EOF : 1;
+  }
+
+  return fputs(str, mhl_file->fl_descr);
+}
+
+// returns 0 in case of failure
+static int mhl_write(const char* str, size_t str_len, 
+                     st_mhl_file_data* mhl_file)
+{
+  if (mhl_file->gz_descr != NULL)
+  {
+    return gzwrite(mhl_file->gz_descr, str, (unsigned) str_len) == 
+      (int) str_len;
+  }
+
+  return fwrite(str, 1, str_len, mhl_file->fl_descr) == str_len;
+}
+
+// returns number of printed characters, or 0 in case of failure
+static int mhl_printf(st_mhl_file_data* mhl_file, const char* format_str, ...)
+{
+  va_list argptr;
+  char buf[BUFF_SZ];
+  char* str;
+  int str_len;
+  int res;
+
+  va_start(argptr, format_str);
+
+  if (mhl_file->gz_descr == NULL)
+  {
+    res = vfprintf(mhl_file->fl_descr, format_str, argptr);
+    va_end(argptr);
+    return res < 0 ? 0 : res;
+  }
+
+  // gzprintf() has a limited internal buffer, format the string by itself
+  str = buf;
+  str_len = vsnprintf(buf, BUFF_SZ, format_str, argptr);
+  va_end(argptr);
+  if (str_len <= 0)
+  {
+    return 0;
+  }
+
+  if (str_len >= BUFF_SZ)
+  {
+    // long strings, like the log, don't fit into the buffer
+    str = (char*)malloc(str_len + 1);
+    if (str == NULL)
+    {
+      return 0;
+    }
+
+    va_start(argptr, format_str);
+    vsnprintf(str, str_len + 1, format_str, argptr);
+    va_end(argptr);
+  }
+
+  res = gzwrite(mhl_file->gz_descr, str, str_len);
+
+  if (str != buf)
+  {
+    free(str);
+  }
+
+  return res;
+}
+
+static int xml_puts(const char *string, st_mhl_file_data* mhl_file)
 {
   int i = 0, c, status;
   while ((c = string[i++])) {
     switch (c) {
       case '"':
-        status = fputs("&quot;", stream);
+        status = mhl_puts("&quot;", mhl_file);
         break;
       case '\'':
-        status = fputs("&apos;", stream);
+        status = mhl_puts("&apos;", mhl_file);
         break;
       case '<':
-        status = fputs("&lt;", stream);
+        status = mhl_puts("&lt;", mhl_file);
         break;
       case '>':
-        status = fputs("&gt;", stream);
+        status = mhl_puts("&gt;", mhl_file);
         break;
       case '&':
-        status = fputs("&amp;", stream);
+        status = mhl_puts("&amp;", mhl_file);
         break;
       default:
-        status = putc(c, stream);
+        status = mhl_putc(c, mhl_file);
         break;
     }
     if (EOF == status) {
@@ -94,19 +186,19 @@ static int xml_puts(const char *string, FILE *stream)
   return 1;
 }
 
-static int xml_puts_node(const char* data, const char* node, FILE *stream) {
+static int xml_puts_node(const char* data, const char* node, st_mhl_file_data* mhl_file) {
   int r;
-  fprintf(stream, "<%s>", node);
-  r = xml_puts(data, stream);
-  fprintf(stream, "</%s>\n", node);
+  mhl_printf(mhl_file, "<%s>", node);
+  r = xml_puts(data, mhl_file);
+  mhl_printf(mhl_file, "</%s>\n", node);
   return r;
 }
 
 int
-print_xml_and_hashlist_header(FILE* fl_descr)
+print_xml_and_hashlist_header(st_mhl_file_data* mhl_file)
 {
   int res;
-  res = fprintf(fl_descr, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  res = mhl_printf(mhl_file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
                           "<hashlist version=\"1.1\">\n\n");
   if (res == 0)
   {
@@ -239,7 +331,7 @@ int fill_user_and_host_info(st_creator_data* creator_data,
 
      if (creator_data->login_name_str == NULL)
      {
-       fprintf(stderr, "Failed to get any available user name.\n");
+       error_printf("Failed to get any available user name.\n");
        return ERRCODE_UNKNOWN_ERROR;
      }
   }
@@ -331,7 +423,7 @@ int fill_user_and_host_info(st_creator_data* creator_data,
 
     if (creator_data->host_name_str == NULL)
     {
-      fprintf(stderr, "Failed to get any available host name.\n");
+      error_printf("Failed to get any available host name.\n");
       return ERRCODE_UNKNOWN_ERROR;
     }
   }
@@ -370,10 +462,10 @@ int fill_user_and_host_info(
   buf = malloc(bufsize);
   if (buf == NULL)
   {
-    fprintf(stderr,
-            "fill_user_and_host_info: Failed to allocate memory of "
-            "size %lu bytes. Errno=%d. Error:%s\n",
-            (long unsigned int)bufsize, errno, strerror(errno));
+    error_printf(
+      "fill_user_and_host_info: Failed to allocate memory of "
+      "size %lu bytes. Errno=%d. Error:%s\n",
+      (long unsigned int)bufsize, errno, strerror(errno));
     return ERRCODE_OUT_OF_MEM;
   }
 
@@ -383,15 +475,15 @@ int fill_user_and_host_info(
   {
     if (res == 0)
     {
-      fprintf(stderr, "Information record for user with id = %d is not "
+      error_printf("Information record for user with id = %d is not "
                       "found in the system.\n", uid);
     }
     else
     {
-      fprintf(stderr,
-              "fill_user_and_host_info: Failed to get user info for user with "
-              "id = %d. Errno=%d. Error:%s\n",
-              uid, errno, strerror(errno));
+      error_printf(
+        "fill_user_and_host_info: Failed to get user info for user with "
+        "id = %d. Errno=%d. Error:%s\n",
+        uid, errno, strerror(errno));
     }
 
     free(buf);
@@ -404,7 +496,7 @@ int fill_user_and_host_info(
     creator_data->full_name_str = (char*)calloc(name_len + 1, sizeof(char));
     if (creator_data->full_name_str == NULL)
     {
-      fprintf(stderr, "Failed to allocate memory for user name string. "
+      error_printf("Failed to allocate memory for user name string. "
                   "Out of memory.\n");
       return ERRCODE_OUT_OF_MEM;
     }
@@ -414,8 +506,8 @@ int fill_user_and_host_info(
   login_len = strlen(pwd.pw_name);
   if (login_len == 0)
   {
-    fprintf(stderr, "WARNING: User with id = %d doesn't has a login name. "
-            "username tag will not be printed into .mhl file\n", uid);
+    error_printf("WARNING: User with id = %d doesn't has a login name. "
+                 "username tag will not be printed into .mhl file\n", uid);
     if (v_data->verbose_level)
     {
       logit(v_data, "WARNING: User with id = %d doesn't has a login name. "
@@ -427,7 +519,7 @@ int fill_user_and_host_info(
     creator_data->login_name_str = (char*)calloc(login_len + 1, sizeof(char));
     if (creator_data->login_name_str == NULL)
     {
-      fprintf(stderr, "Failed to allocate memory for user login string. "
+      error_printf("Failed to allocate memory for user login string. "
                  "Out of memory.\n");
       return ERRCODE_OUT_OF_MEM;
     }
@@ -444,21 +536,21 @@ int fill_user_and_host_info(
   buf = (char*)calloc(host_len+1, sizeof(char));
   if (buf == NULL)
   {
-    fprintf(stderr,
-            "fill_user_and_host_info: Failed to allocate memory of "
-            "size %lu bytes. Errno=%d. Error:%s\n",
-            (long unsigned int)(host_len+1)*sizeof(char),
-            errno, strerror(errno));
+    error_printf(
+      "fill_user_and_host_info: Failed to allocate memory of "
+      "size %lu bytes. Errno=%d. Error:%s\n",
+      (long unsigned int)(host_len+1)*sizeof(char),
+      errno, strerror(errno));
     return ERRCODE_OUT_OF_MEM;
   }
   
   res = gethostname(buf, host_len +1);
   if (res != 0)
   {
-    fprintf(stderr,
-            "fill_user_and_host_info: Failed to get host name. "
-            "Errno=%d. Error:%s\n",
-            errno, strerror(errno));
+    error_printf(
+      "fill_user_and_host_info: Failed to get host name. "
+      "Errno=%d. Error:%s\n",
+      errno, strerror(errno));
         
     free(buf);
     return ERRCODE_UNKNOWN_ERROR;
@@ -470,8 +562,8 @@ int fill_user_and_host_info(
     creator_data->host_name_str = (char*)calloc(host_len + 1, sizeof(char));
     if (creator_data->host_name_str == NULL)
     {
-      fprintf(stderr, "Failed to allocate memory for host name string. "
-              "Out of memory.\n");
+      error_printf("Failed to allocate memory for host name string. "
+                   "Out of memory.\n");
       return ERRCODE_OUT_OF_MEM;
     }
     strncpy(creator_data->host_name_str, buf, host_len);
@@ -484,24 +576,70 @@ int fill_user_and_host_info(
 
 #endif // ifdef WIN else
 
+typedef struct _st_log_writer_data
+{
+  st_mhl_file_data* mhl_file;
+  st_conversion_settings* p_cs;
+  unsigned char is_conversion_failed;
+} st_log_writer_data;
+
+/* Writes message of the log into '<log>' of MHL file, in UTF-8.
+ */
+static int
+aux_write_log_message(const char* str, size_t str_len, void* data)
+{
+  st_log_writer_data* p_log_data = (st_log_writer_data*) data;
+  char* u8str;
+  size_t u8str_sz;
+  int res;
+
+  if (str_len == 0)
+  {
+    return 0;
+  }
+
+  res = convert_from_locale_to_utf8(str, str_len, &u8str, &u8str_sz, 
+                                    p_log_data->p_cs);
+  if (res != 0)
+  {
+    if (!p_log_data->is_conversion_failed)
+    {
+      error_printf("Failed to convert log string from locale to UTF-8, "
+                   "left it as is\n");
+      p_log_data->is_conversion_failed = 1;
+    }
+    return mhl_write(str, str_len, p_log_data->mhl_file) ? 0 : 
+      ERRCODE_IO_ERROR;
+  }
+
+  res = mhl_write(u8str, strlen(u8str), p_log_data->mhl_file) ? 0 : 
+    ERRCODE_IO_ERROR;
+  free(u8str);
+  return res;
+}
+
 int
 print_creator_info(
-  FILE* fl_descr, 
+  st_mhl_file_data* mhl_file, 
   st_creator_data* creator_data,
   st_verbose_data* v_data,
   st_conversion_settings* p_cs)
 {
   int res;
-  char* u8str;
-  size_t u8str_sz;
+  st_log_writer_data log_data;
 
-  res = fill_user_and_host_info(creator_data, v_data, p_cs);
-  if (res != 0)
+  // user and host are looked up once for all MHL files
+  if (creator_data->login_name_str == NULL && 
+      creator_data->host_name_str == NULL)
   {
-    return res;
+    res = fill_user_and_host_info(creator_data, v_data, p_cs);
+    if (res != 0)
+    {
+      return res;
+    }
   }
 
-  res = fprintf(fl_descr,
+  res = mhl_printf(mhl_file,
     "  <creatorinfo>\n");
   if (res == 0)
   {
@@ -511,8 +649,8 @@ print_creator_info(
 
   if (creator_data->full_name_str != NULL)
   {
-    fprintf(fl_descr, "    ");
-    res = xml_puts_node(creator_data->full_name_str, "name", fl_descr);
+    mhl_printf(mhl_file, "    ");
+    res = xml_puts_node(creator_data->full_name_str, "name", mhl_file);
     if (res == 0)
     {
       print_error("IO error: failed to print information into .mhl file");
@@ -522,8 +660,8 @@ print_creator_info(
   
   if (creator_data->login_name_str != NULL)
   {
-    fprintf(fl_descr, "    ");
-    res = xml_puts_node(creator_data->login_name_str, "username", fl_descr);
+    mhl_printf(mhl_file, "    ");
+    res = xml_puts_node(creator_data->login_name_str, "username", mhl_file);
     if (res == 0)
     {
       print_error("IO error: failed to print information into .mhl file");
@@ -531,9 +669,9 @@ print_creator_info(
     }
   }  
 
-  res = xml_puts_node(creator_data->host_name_str, "hostname", fl_descr);
+  res = xml_puts_node(creator_data->host_name_str, "hostname", mhl_file);
   
-  res = fprintf(fl_descr,
+  res = mhl_printf(mhl_file,
     "    <tool>%s ver. %s</tool>\n"
     "    <startdate>%s</startdate>\n"
     "    <finishdate>%s</finishdate>\n",
@@ -546,32 +684,37 @@ print_creator_info(
     return ERRCODE_IO_ERROR;
   }
 
-  if (v_data->verbose_level && v_data->log_str_len != 0)
+  if (v_data->verbose_level && 
+      (creator_data->log_str != NULL || !is_log_buffer_empty(v_data->p_log)))
   {
-    
-    res = 
-      convert_from_locale_to_utf8(
-        v_data->log_str, 
-        v_data->log_str_len,
-        &u8str,
-        &u8str_sz,
-        p_cs);
-    
+    res = mhl_printf(mhl_file, "    <log><![CDATA[");
     if (res != 0)
     {
-      fprintf(stderr, "Failed to convert log string from locale to UTF-8, "
-              "left it as is\n");
-    }
-    else
-    {
-      free(v_data->log_str);
-      v_data->log_str = u8str;
+      if (creator_data->log_str != NULL)
+      {
+        res = mhl_puts(creator_data->log_str, mhl_file) != EOF ? 0 : 
+          ERRCODE_IO_ERROR;
+      }
+      else
+      {
+        log_data.mhl_file = mhl_file;
+        log_data.p_cs = p_cs;
+        log_data.is_conversion_failed = 0;
+        res = write_log_buffer(v_data->p_log, aux_write_log_message, 
+                               &log_data);
+      }
+
+      if (res == 0)
+      {
+        res = mhl_printf(mhl_file,
+          "]]>\n"
+          "    </log>\n");
+      }
+      else
+      {
+        res = 0;
+      }
     }
-    
-    res = fprintf(fl_descr,
-      "    <log><![CDATA[%s]]>\n"
-      "    </log>\n",
-      creator_data->log_str ? creator_data->log_str : v_data->log_str);
 
     if (res == 0)
     {
@@ -580,7 +723,7 @@ print_creator_info(
     }
   }
 
-  res = fprintf(fl_descr,
+  res = mhl_printf(mhl_file,
     "  </creatorinfo>\n\n");
   if (res == 0)
   {
@@ -593,12 +736,13 @@ print_creator_info(
 
 int
 print_file_hash_info(
-  FILE* fl_descr, 
+  st_mhl_file_data* mhl_file, 
   st_file_data_ext* file_data,
   const wchar_t* relative_wfilename,
   st_conversion_settings* p_cs)
 {
   int res;
+  unsigned int i;
   char* u8_fname;
   size_t u8_fname_sz;
   wchar_t* w_fname;
@@ -640,12 +784,12 @@ print_file_hash_info(
     return ERRCODE_IO_ERROR;
   }
   
-  res = fprintf(fl_descr,
+  res = mhl_printf(mhl_file,
                 "  <hash>\n");
-  fprintf(fl_descr, "    ");
-  res = xml_puts_node(u8_fname, "file", fl_descr);
+  mhl_printf(mhl_file, "    ");
+  res = xml_puts_node(u8_fname, "file", mhl_file);
 
-  res = fprintf(fl_descr,
+  res = mhl_printf(mhl_file,
     "    <size>%llu</size>\n"
 #ifdef WIN
     "    <creationdate>%s</creationdate>\n"
@@ -670,7 +814,7 @@ print_file_hash_info(
 
   if (file_data->aux_hash.hash_sum != NULL)
   {
-    res = fprintf(fl_descr,
+    res = mhl_printf(mhl_file,
       "    <%s>%s</%s>\n",
     file_data->aux_hash.hash_type_str,
     file_data->aux_hash.hash_sum, file_data->aux_hash.hash_type_str);
@@ -682,7 +826,22 @@ print_file_hash_info(
     } 
   }
 
-  res = fprintf(fl_descr,
+  for (i = 0; i < file_data->more_hashes_num; ++i)
+  {
+    res = mhl_printf(mhl_file,
+      "    <%s>%s</%s>\n",
+    file_data->more_hashes[i].hash_type_str,
+    file_data->more_hashes[i].hash_sum, 
+    file_data->more_hashes[i].hash_type_str);
+
+    if (res == 0)
+    {
+      print_error("IO error: failed to print information into .mhl file");
+      return ERRCODE_IO_ERROR;
+    } 
+  }
+
+  res = mhl_printf(mhl_file,
     "    <hashdate>%s</hashdate>\n"
     "  </hash>\n\n",
     file_data->hashdate_str);
@@ -697,11 +856,11 @@ print_file_hash_info(
 }
 
 int 
-print_hashlist_footer(FILE* fl_descr)
+print_hashlist_footer(st_mhl_file_data* mhl_file)
 {
   int res;
 
-  res = fprintf(fl_descr, "</hashlist>\n");
+  res = mhl_printf(mhl_file, "</hashlist>\n");
   if (res == 0)
   {
     print_error("IO error: failed to print information into .mhl file");
@@ -711,22 +870,22 @@ print_hashlist_footer(FILE* fl_descr)
   return 0;
 }
 
-int
-create_mhl(st_creator_data* creator_data, st_verbose_data* v_data,
-           st_mhl_file_data* mhl_file, st_files_data* files_data,
-           st_conversion_settings* p_cs)
+static int
+aux_print_mhl_content(st_creator_data* creator_data, st_verbose_data* v_data,
+                      st_mhl_file_data* mhl_file, st_files_data* files_data,
+                      st_conversion_settings* p_cs)
 {
   int res;
   st_files_refs* fl_data_ptr;
 
-  res = print_xml_and_hashlist_header(mhl_file->fl_descr);
+  res = print_xml_and_hashlist_header(mhl_file);
   if (res != 0)
   {
     return res;
   }
 
   res = print_creator_info(
-    mhl_file->fl_descr,
+    mhl_file,
     creator_data, 
     v_data,
     p_cs);
@@ -740,7 +899,7 @@ create_mhl(st_creator_data* creator_data, st_verbose_data* v_data,
   while (fl_data_ptr != NULL)
   {
     res = print_file_hash_info(
-      mhl_file->fl_descr,
+      mhl_file,
       files_data->files_data_array + fl_data_ptr->file_data_idx,
       fl_data_ptr->relative_wfilename,
       p_cs);
@@ -753,7 +912,47 @@ create_mhl(st_creator_data* creator_data, st_verbose_data* v_data,
     fl_data_ptr = fl_data_ptr->next;
   } 
 
-  res = print_hashlist_footer(mhl_file->fl_descr);
+  res = print_hashlist_footer(mhl_file);
   
   return 0;
 }
+
+/* @return Number of bytes written into MHL file, before compression.
+ */
+static unsigned long long
+aux_mhl_file_pos(st_mhl_file_data* mhl_file)
+{
+  long pos;
+
+  pos = 
+    mhl_file->gz_descr != NULL ? 
+      (long) gztell(mhl_file->gz_descr) : ftell(mhl_file->fl_descr);
+  return pos > 0 ? (unsigned long long) pos : 0;
+}
+
+int
+create_mhl(st_creator_data* creator_data, st_verbose_data* v_data,
+           st_mhl_file_data* mhl_file, st_files_data* files_data,
+           st_conversion_settings* p_cs)
+{
+  int res;
+  unsigned long long beg_us;
+  unsigned long long beg_pos = 0;
+  unsigned long long end_pos;
+
+  beg_us = perf_stats_begin();
+  if (beg_us != 0)
+  {
+    beg_pos = aux_mhl_file_pos(mhl_file);
+  }
+
+  res = aux_print_mhl_content(creator_data, v_data, mhl_file, files_data, p_cs);
+
+  if (beg_us != 0)
+  {
+    end_pos = aux_mhl_file_pos(mhl_file);
+    perf_stats_end(PP_XML_WRITE, beg_us, 
+                   end_pos > beg_pos ? end_pos - beg_pos : 0);
+  }
+  return res;
+}
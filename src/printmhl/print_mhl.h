@@ -29,6 +29,17 @@
 #include <mhltools_common/files_data.h>
 #include "create_mhl_files_data.h"
 
+/* Fills user and host info of creator data, it is printed into 
+ * '<creatorinfo>' of MHL files. Creator data with the info filled is 
+ * printed as is.
+ * @return In case of success: 0,
+ *         in case of failure: non zero value with error code
+ */
+int fill_user_and_host_info(
+  st_creator_data* creator_data,
+  st_verbose_data* v_data,
+  st_conversion_settings* p_cs);
+
 int
 create_mhl(st_creator_data* creator_data, st_verbose_data* v_data,
            st_mhl_file_data* mhl_file, st_files_data* files_data,
@@ -0,0 +1,391 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+End-to-end benchmark of 'mhl seal', 'mhl verify', 'mhl hash' and 'mhl file'
+on synthetic media trees.
+
+Trees are generated reproducibly from a seed into the work folder and are
+kept there between runs. Each command is run with cold and with warm page
+cache, wall time, CPU time and peak RSS are recorded, with '--syscalls'
+also numbers of system calls, counted by an extra run under strace.
+
+Usage:
+  python bench_e2e.py --work-dir /mnt/bench [--preset quick|full]
+                      [--trees tiny,clips,large,sequences,unicode]
+                      [--runs N] [--syscalls] [--output results.json]
+"""
+
+from __future__ import print_function
+
+import argparse
+import binascii
+import glob
+import json
+import os
+import random
+import shutil
+import subprocess
+import sys
+import time
+
+MHL_DEFAULT = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                           "..", "..", "bin", "Ubuntu_12.04_x64", "Release", "mhl")
+
+KB = 1024
+MB = 1024 * KB
+GB = 1024 * MB
+
+# Sizes of the trees. 'full' is the scale the tool is run at,
+# 'quick' is for checking the harness and for rough comparisons.
+PRESETS = {
+    "full": {
+        "tiny_files": 2000000,
+        "clips": 500,
+        "clip_size": 256 * MB,
+        "large_files": 1,
+        "large_size": 100 * GB,
+        "sequences": 10,
+        "frames": 1000,
+        "frame_size": 12 * MB,
+        "unicode_files": 100000,
+    },
+    "quick": {
+        "tiny_files": 20000,
+        "clips": 40,
+        "clip_size": 4 * MB,
+        "large_files": 1,
+        "large_size": 1 * GB,
+        "sequences": 4,
+        "frames": 500,
+        "frame_size": 64 * KB,
+        "unicode_files": 2000,
+    },
+}
+
+TREES = ["tiny", "clips", "large", "sequences", "unicode"]
+
+# tiny files per folder
+TINY_FILES_PER_DIR = 1000
+BLOCK_SZ = 4 * MB
+
+UNICODE_WORDS = [
+    u"café",                 # precomposed
+    u"café",                # decomposed
+    u"Москва",
+    u"東京",
+    u"über_Ärger",
+    u"Σελήνη",
+    u"שלום",
+    u"\U0001f3ac_take",
+    u"naïve & <co>",
+    u"'quoted' \"name\"",
+]
+
+
+def random_bytes(rnd, size):
+    if size == 0:
+        return b""
+    return binascii.unhexlify("%0*x" % (2 * size, rnd.getrandbits(8 * size)))
+
+
+def write_block_file(path, size, rnd):
+    """Writes file of the given size with pseudo-random, not sparse,
+    not repeating content."""
+    block = bytearray(random_bytes(rnd, min(size, BLOCK_SZ)))
+    written = 0
+    counter = 0
+    with open(path, "wb") as f:
+        while written < size:
+            # every block differs, so storage can't deduplicate them
+            block[0:8] = bytearray((counter >> (8 * i)) & 0xff for i in range(8))
+            part = min(size - written, len(block))
+            f.write(block[:part])
+            written += part
+            counter += 1
+
+
+def write_small_file(path, size, rnd):
+    with open(path, "wb") as f:
+        f.write(random_bytes(rnd, size))
+
+
+def generate_tiny(root, p, rnd):
+    """Millions of tiny files, TINY_FILES_PER_DIR per folder."""
+    for i in range(p["tiny_files"]):
+        folder = os.path.join(root, "d%05d" % (i // TINY_FILES_PER_DIR))
+        if i % TINY_FILES_PER_DIR == 0:
+            os.makedirs(folder)
+        write_small_file(os.path.join(folder, "f%07d.txt" % i), rnd.randint(0, 512), rnd)
+
+
+def generate_clips(root, p, rnd):
+    """Camera cards with deep per-clip folders and sidecar files."""
+    for i in range(p["clips"]):
+        card = "A%03d" % (i // 100 + 1)
+        clip = "%sC%03d_160101_R%03X" % (card, i % 100 + 1, rnd.randint(0, 0xfff))
+        folder = os.path.join(root, card + "_CARD", "CONTENTS", "CLIPS", clip)
+        os.makedirs(folder)
+        write_block_file(os.path.join(folder, clip + ".mov"), p["clip_size"], rnd)
+        write_small_file(os.path.join(folder, clip + ".xml"), rnd.randint(2 * KB, 8 * KB), rnd)
+        write_small_file(os.path.join(folder, clip + "_thumb.jpg"), rnd.randint(16 * KB, 64 * KB), rnd)
+
+
+def generate_large(root, p, rnd):
+    """Huge files with real data on disk."""
+    os.makedirs(root)
+    for i in range(p["large_files"]):
+        write_block_file(os.path.join(root, "large%02d.bin" % i), p["large_size"], rnd)
+
+
+def generate_sequences(root, p, rnd):
+    """Frame sequences, one folder per shot."""
+    for s in range(p["sequences"]):
+        shot = "SHOT_%03d0" % (s + 1)
+        folder = os.path.join(root, shot)
+        os.makedirs(folder)
+        for frame in range(p["frames"]):
+            write_block_file(os.path.join(folder, "%s.%07d.dpx" % (shot, 86400 + frame)),
+                             p["frame_size"], rnd)
+
+
+def generate_unicode(root, p, rnd):
+    """Names in several scripts and normalization forms, long names."""
+    for i in range(p["unicode_files"]):
+        folder = os.path.join(root, UNICODE_WORDS[(i // 100) % len(UNICODE_WORDS)] + u"_%03d" % (i // 1000))
+        if not os.path.isdir(folder):
+            os.makedirs(folder)
+        name = u"%s_%06d" % (rnd.choice(UNICODE_WORDS), i)
+        if i % 50 == 0:
+            # long names, close to the limit of 255 bytes
+            name = (name + u"_" + u"é" * 120)[:120]
+        write_small_file(os.path.join(folder, name + u".txt"), rnd.randint(0, 4 * KB), rnd)
+
+
+GENERATORS = {
+    "tiny": generate_tiny,
+    "clips": generate_clips,
+    "large": generate_large,
+    "sequences": generate_sequences,
+    "unicode": generate_unicode,
+}
+
+
+def prepare_tree(work_dir, tree, preset, seed):
+    """Generates the tree unless it exists with the same parameters."""
+    root = os.path.join(work_dir, tree)
+    params = {"tree": tree, "preset": preset, "seed": seed, "sizes": PRESETS[preset]}
+    marker = os.path.join(work_dir, tree + ".json")
+    if os.path.isdir(root) and os.path.isfile(marker):
+        with open(marker) as f:
+            if json.load(f) == params:
+                return root
+        shutil.rmtree(root)
+    elif os.path.isdir(root):
+        shutil.rmtree(root)
+
+    print("Generating '%s' tree..." % tree)
+    beg = time.time()
+    # keep the generated folder separate from MHL files and outputs
+    GENERATORS[tree](os.path.join(root, "data"), PRESETS[preset], random.Random("%s-%d" % (tree, seed)))
+    with open(marker, "w") as f:
+        json.dump(params, f)
+    print("  done in %.1f s" % (time.time() - beg))
+    return root
+
+
+def drop_caches(root):
+    """Evicts the tree from page cache.
+    @return method used, None if there is no way to do it."""
+    subprocess.call(["sync"])
+    try:
+        with open("/proc/sys/vm/drop_caches", "w") as f:
+            f.write("3\n")
+        return "drop_caches"
+    except (IOError, OSError):
+        pass
+
+    if not hasattr(os, "posix_fadvise"):
+        return None
+    for folder, _, files in os.walk(root):
+        for name in files:
+            try:
+                fd = os.open(os.path.join(folder, name), os.O_RDONLY)
+            except OSError:
+                continue
+            try:
+                os.posix_fadvise(fd, 0, 0, os.POSIX_FADV_DONTNEED)
+            finally:
+                os.close(fd)
+    return "fadvise"
+
+
+def run_measured(args, cwd, stdout_path):
+    """Runs mhl command, @return exit code, wall time, user and system time
+    and peak RSS in KB of the process.
+    Peak RSS is taken from the report of 'mhl --stats': ru_maxrss of the
+    child includes the image of this script, which the child had before
+    exec()."""
+    stats_path = stdout_path + ".stats.json"
+    if os.path.exists(stats_path):
+        os.remove(stats_path)
+    with open(stdout_path, "wb") as out, open(stdout_path + ".err", "wb") as err:
+        beg = time.time()
+        proc = subprocess.Popen(args[:1] + ["--stats", stats_path] + args[1:],
+                                cwd=cwd, stdout=out, stderr=err)
+        _, status, usage = os.wait4(proc.pid, 0)
+        wall = time.time() - beg
+    code = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+    rss = usage.ru_maxrss
+    try:
+        with open(stats_path) as f:
+            rss = json.load(f).get("peak_rss_kb", rss)
+    except (IOError, ValueError):
+        pass
+    return code, wall, usage.ru_utime, usage.ru_stime, rss
+
+
+def has_strace():
+    with open(os.devnull, "wb") as devnull:
+        try:
+            subprocess.call(["strace", "-V"], stdout=devnull, stderr=devnull)
+        except OSError:
+            return False
+    return True
+
+
+def count_syscalls(args, cwd, out_dir):
+    """Runs command under 'strace -c'.
+    @return total number of calls and calls of the most frequent ones."""
+    summary_path = os.path.join(out_dir, "strace.txt")
+    with open(os.devnull, "wb") as devnull:
+        subprocess.call(["strace", "-f", "-c", "-o", summary_path] + args,
+                        cwd=cwd, stdout=devnull, stderr=devnull)
+    calls = {}
+    total = 0
+    with open(summary_path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) < 5 or not fields[3].isdigit():
+                continue
+            if fields[-1] == "total":
+                total = int(fields[3])
+            else:
+                calls[fields[-1]] = int(fields[3])
+    top = dict(sorted(calls.items(), key=lambda item: -item[1])[:10])
+    return total, top
+
+
+def remove_mhl_files(folder):
+    for path in glob.glob(os.path.join(folder, "*.mhl")):
+        os.remove(path)
+
+
+def bench_tree(mhl, root, tree, args, results):
+    data = os.path.join(root, "data")
+    out_dir = os.path.join(root, "out")
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    os.makedirs(out_dir)
+    hashes_path = os.path.join(out_dir, "hashes.txt")
+    stdout_path = os.path.join(out_dir, "stdout.txt")
+
+    # commands in the order they depend on each other, MHL files of 
+    # 'seal' are written into the tree's folder, of 'file' into the data
+    # folder, they are removed before each run
+    steps = [
+        ("seal", lambda: remove_mhl_files(root),
+         lambda: [mhl, "seal", "-t", "xxhash64", "-o", root, data], stdout_path),
+        ("verify", None,
+         lambda: [mhl, "verify", "-f"] + glob.glob(os.path.join(root, "*.mhl")), stdout_path),
+        ("hash", None,
+         lambda: [mhl, "hash", "-t", "md5", data], hashes_path),
+        ("hash -s", None,
+         lambda: [mhl, "hash", "-s", hashes_path], stdout_path),
+        ("file", lambda: remove_mhl_files(data),
+         lambda: [mhl, "file", "-f", hashes_path, "-o", data], stdout_path),
+    ]
+
+    for name, setup, make_args, out_path in steps:
+        for cache in ("cold", "warm"):
+            for run in range(args.runs):
+                syscalls = None
+                if args.syscalls and cache == "warm" and run == 0:
+                    if setup is not None:
+                        setup()
+                    syscalls = count_syscalls(make_args(), root, out_dir)
+
+                if setup is not None:
+                    setup()
+                method = None
+                if cache == "cold":
+                    method = drop_caches(data)
+                    if method is None:
+                        print("  can't drop page cache, cold runs are skipped")
+                        break
+                code, wall, utime, stime, rss = run_measured(make_args(), root, out_path)
+                result = {
+                    "tree": tree,
+                    "command": name,
+                    "cache": cache,
+                    "cache_drop": method,
+                    "run": run,
+                    "exit_code": code,
+                    "wall_s": round(wall, 3),
+                    "user_s": round(utime, 3),
+                    "sys_s": round(stime, 3),
+                    "peak_rss_kb": rss,
+                }
+                if syscalls is not None:
+                    result["syscalls"], result["top_syscalls"] = syscalls
+                results.append(result)
+                print("  %-8s %-4s %7.2f s  user %7.2f s  sys %7.2f s  %8d KB  exit %d" %
+                      (name, cache, wall, utime, stime, rss, code))
+    remove_mhl_files(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="End-to-end benchmark of the mhl tool")
+    parser.add_argument("--mhl", default=MHL_DEFAULT, help="mhl binary")
+    parser.add_argument("--work-dir", required=True,
+                        help="folder on the disk under test, trees are kept there")
+    parser.add_argument("--preset", choices=sorted(PRESETS.keys()), default="quick")
+    parser.add_argument("--trees", default=",".join(TREES),
+                        help="comma separated trees: " + ", ".join(TREES))
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--runs", type=int, default=1, help="runs of each command")
+    parser.add_argument("--syscalls", action="store_true",
+                        help="count system calls with strace, in an extra run")
+    parser.add_argument("--output", help="JSON file for results, stdout by default")
+    args = parser.parse_args()
+
+    if args.syscalls and not has_strace():
+        print("strace is not found, system calls are not counted")
+        args.syscalls = False
+
+    mhl = os.path.abspath(args.mhl)
+    trees = [tree for tree in args.trees.split(",") if tree]
+    for tree in trees:
+        if tree not in GENERATORS:
+            parser.error("unknown tree '%s'" % tree)
+    if not os.path.isdir(args.work_dir):
+        os.makedirs(args.work_dir)
+
+    results = []
+    for tree in trees:
+        root = prepare_tree(os.path.abspath(args.work_dir), tree, args.preset, args.seed)
+        print("Tree '%s':" % tree)
+        bench_tree(mhl, root, tree, args, results)
+
+    report = {"tool": "bench_e2e", "mhl": mhl, "preset": args.preset,
+              "seed": args.seed, "results": results}
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(report, f, indent=2)
+    else:
+        json.dump(report, sys.stdout, indent=2)
+        print()
+    return 1 if any(r["exit_code"] != 0 for r in results) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
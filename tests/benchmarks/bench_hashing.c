@@ -0,0 +1,607 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+/*
+ * @file: bench_hashing.c
+ *
+ * Throughput of the hash functions over in-memory buffers.
+ *
+ * Usage: mhl_bench_hash [-j threads] [-m ms] [-r runs] [-o report.json]
+ *                       [-b baselines.txt [-T percent] [-s]] 
+ *                       [-u baselines.txt]
+ *
+ * Each digest is calculated over buffers from 4 KB to 64 MB by one
+ * thread and by several threads at once, a buffer per call, the same 
+ * way files are hashed. GB/s and cycles per byte are printed as JSON.
+ * Baselines are throughputs relative to MD5 of the same buffer size 
+ * and number of threads in the same run, so they don't depend on speed
+ * of the machine. With '-b' the results are compared with baselines, 
+ * results slower than their baselines by more than the tolerance are 
+ * reported as warnings, with '-s' the benchmark fails on them. '-u' 
+ * writes the results as new baselines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+#include <facade_info/error_codes.h>
+#include <generics/os_threads.h>
+#include <mhltools_common/hashing.h>
+
+#define BENCH_MIN_BUFFER_SZ (4 * 1024)
+#define BENCH_MAX_BUFFER_SZ (64 * 1024 * 1024)
+#define BENCH_DEFAULT_MIN_MS 100
+#define BENCH_DEFAULT_RUNS 3
+#define BENCH_DEFAULT_TOLERANCE 25
+#define BENCH_MAX_THREADS 64
+#define BENCH_MAX_BASELINES 256
+// buffer sizes from BENCH_MIN_BUFFER_SZ to BENCH_MAX_BUFFER_SZ, by 4 times
+#define BENCH_BUFFER_SIZES_NUM 8
+// exit code with '-s' if results are slower than baselines
+#define BENCH_EXIT_REGRESSION 1
+
+typedef struct _st_bench_digest
+{
+  const char* name;
+  MHL_HASH_TYPE hash_type;
+} st_bench_digest;
+
+static const st_bench_digest g_digests[] = 
+{
+  // reference of baselines, must be the first one
+  { "md5", MHL_HT_MD5 },
+  { "sha1", MHL_HT_SHA1 },
+  { "xxhash", MHL_HT_XXHASH },
+  { "xxhash64", MHL_HT_XXHASH64 },
+  { "xxhash64be", MHL_HT_XXHASH64BE }
+};
+
+#define BENCH_DIGESTS_NUM (sizeof(g_digests) / sizeof(g_digests[0]))
+
+typedef struct _st_bench_baseline
+{
+  char name[32];
+  unsigned long buffer_sz;
+  char mode[4];
+  double md5_ratio; // throughput relative to MD5
+} st_bench_baseline;
+
+// job of one thread: hashes the buffer until the time is over
+typedef struct _st_bench_job
+{
+  const unsigned char* buffer;
+  size_t buffer_sz;
+  MHL_HASH_TYPE hash_type;
+  double end_time;
+  const char* expected_hash; // NULL to skip the check
+  unsigned long long bytes;
+  int res;
+} st_bench_job;
+
+static double
+aux_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long long
+aux_cycles(void)
+{
+#ifdef BENCH_HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/* Calculates hash of the buffer the same way, as of a file: new state, 
+ * a single update and the string representation.
+ */
+static int
+aux_hash_buffer(
+  const unsigned char* buffer, 
+  size_t buffer_sz, 
+  MHL_HASH_TYPE hash_type,
+  char** hash_str)
+{
+  int res;
+  st_hash_strings_state* p_state;
+
+  res = create_hash_strings_state(&hash_type, 1, &p_state);
+  if (res != 0)
+  {
+    return res;
+  }
+
+  res = update_hash_strings_state(p_state, buffer, buffer_sz);
+  if (res == 0)
+  {
+    res = finish_hash_strings_state(p_state, hash_str);
+  }
+  free_hash_strings_state(p_state);
+  return res;
+}
+
+static void
+aux_bench_job(void* arg)
+{
+  st_bench_job* p_job = (st_bench_job*) arg;
+  char* hash_str;
+
+  p_job->bytes = 0;
+  p_job->res = 0;
+  do
+  {
+    p_job->res = 
+      aux_hash_buffer(p_job->buffer, p_job->buffer_sz, p_job->hash_type, 
+                      &hash_str);
+    if (p_job->res != 0)
+    {
+      return;
+    }
+
+    if (p_job->expected_hash != NULL && 
+        strcmp(hash_str, p_job->expected_hash) != 0)
+    {
+      free(hash_str);
+      p_job->res = ERRCODE_INTERNAL_ERROR;
+      return;
+    }
+    free(hash_str);
+
+    p_job->bytes += p_job->buffer_sz;
+  }
+  while (aux_now() < p_job->end_time);
+}
+
+/* Runs the digest by given number of threads several times.
+ * @return In case of success: 0, the best run is returned,
+ *         in case of failure: non zero value with error code
+ */
+static int
+aux_bench_digest(
+  const unsigned char* buffer,
+  size_t buffer_sz,
+  MHL_HASH_TYPE hash_type,
+  const char* expected_hash,
+  unsigned int threads_num,
+  unsigned int min_ms,
+  int runs,
+  double* p_gb_per_s,
+  double* p_cycles_per_byte)
+{
+  st_bench_job jobs[BENCH_MAX_THREADS];
+  mhlosi_thread threads[BENCH_MAX_THREADS];
+  unsigned int started_num;
+  unsigned int i;
+  int run;
+  double beg;
+  double t;
+  unsigned long long beg_cycles;
+  unsigned long long cycles;
+  unsigned long long bytes;
+  double gb_per_s;
+
+  *p_gb_per_s = 0;
+  *p_cycles_per_byte = 0;
+  for (run = 0; run < runs; ++run)
+  {
+    beg = aux_now();
+    beg_cycles = aux_cycles();
+    for (i = 0; i < threads_num; ++i)
+    {
+      jobs[i].buffer = buffer;
+      jobs[i].buffer_sz = buffer_sz;
+      jobs[i].hash_type = hash_type;
+      jobs[i].end_time = beg + min_ms / 1000.0;
+      jobs[i].expected_hash = expected_hash;
+    }
+
+    started_num = 0;
+    for (i = 1; i < threads_num; ++i)
+    {
+      if (mhlosi_thread_create(&threads[i], aux_bench_job, &jobs[i]) != 0)
+      {
+        break;
+      }
+      ++started_num;
+    }
+    aux_bench_job(&jobs[0]);
+    for (i = 1; i <= started_num; ++i)
+    {
+      mhlosi_thread_join(threads[i]);
+    }
+
+    t = aux_now() - beg;
+    cycles = aux_cycles() - beg_cycles;
+
+    if (started_num + 1 != threads_num)
+    {
+      fprintf(stderr, "Cannot start %u threads\n", threads_num);
+      return ERRCODE_INTERNAL_ERROR;
+    }
+
+    bytes = 0;
+    for (i = 0; i < threads_num; ++i)
+    {
+      if (jobs[i].res != 0)
+      {
+        return jobs[i].res;
+      }
+      bytes += jobs[i].bytes;
+    }
+
+    gb_per_s = t > 0 ? bytes / t / 1e9 : 0;
+    if (gb_per_s > *p_gb_per_s)
+    {
+      *p_gb_per_s = gb_per_s;
+      // cycles of all the threads
+      *p_cycles_per_byte = bytes != 0 ? 
+        (double) cycles * threads_num / bytes : 0;
+    }
+  }
+
+  return 0;
+}
+
+static int
+aux_read_baselines(
+  const char* path, 
+  st_bench_baseline* baselines, 
+  size_t* p_baselines_num)
+{
+  FILE* f;
+  char line[256];
+  st_bench_baseline* p_baseline;
+
+  f = fopen(path, "r");
+  if (f == NULL)
+  {
+    fprintf(stderr, "Cannot open baselines %s\n", path);
+    return ERRCODE_NO_SUCH_FILE;
+  }
+
+  *p_baselines_num = 0;
+  while (fgets(line, sizeof(line), f) != NULL && 
+         *p_baselines_num < BENCH_MAX_BASELINES)
+  {
+    p_baseline = baselines + *p_baselines_num;
+    if (line[0] == '#' || 
+        sscanf(line, "%31s %lu %3s %lf", p_baseline->name, 
+               &p_baseline->buffer_sz, p_baseline->mode, 
+               &p_baseline->md5_ratio) != 4)
+    {
+      continue;
+    }
+    ++*p_baselines_num;
+  }
+
+  fclose(f);
+  return 0;
+}
+
+static const st_bench_baseline*
+aux_find_baseline(
+  const st_bench_baseline* baselines, 
+  size_t baselines_num,
+  const char* name,
+  size_t buffer_sz,
+  const char* mode)
+{
+  size_t i;
+
+  for (i = 0; i < baselines_num; ++i)
+  {
+    if (strcmp(baselines[i].name, name) == 0 && 
+        baselines[i].buffer_sz == buffer_sz &&
+        strcmp(baselines[i].mode, mode) == 0)
+    {
+      return baselines + i;
+    }
+  }
+  return NULL;
+}
+
+static unsigned char*
+aux_make_buffer(size_t buffer_sz)
+{
+  unsigned char* buffer;
+  unsigned long long x = 0x9E3779B97F4A7C15ULL;
+  size_t i;
+
+  buffer = (unsigned char*) malloc(buffer_sz);
+  if (buffer == NULL)
+  {
+    return NULL;
+  }
+
+  // the same pseudo-random content in each run
+  for (i = 0; i < buffer_sz; ++i)
+  {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    buffer[i] = (unsigned char) x;
+  }
+  return buffer;
+}
+
+int main(int argc, char* argv[])
+{
+  int res = 0;
+  int opt;
+  int runs = BENCH_DEFAULT_RUNS;
+  unsigned int min_ms = BENCH_DEFAULT_MIN_MS;
+  unsigned int threads_num;
+  double tolerance = BENCH_DEFAULT_TOLERANCE;
+  int is_strict = 0;
+  const char* report_path = NULL;
+  const char* baselines_path = NULL;
+  const char* new_baselines_path = NULL;
+  FILE* report;
+  FILE* new_baselines = NULL;
+  st_bench_baseline baselines[BENCH_MAX_BASELINES];
+  size_t baselines_num = 0;
+  const st_bench_baseline* p_baseline;
+  unsigned char* buffer;
+  size_t buffer_sz;
+  size_t buffer_sz_idx;
+  size_t d;
+  int m;
+  char* expected_hash;
+  unsigned int mode_threads;
+  const char* mode;
+  double gb_per_s;
+  double cycles_per_byte;
+  // MD5 throughput per thread by buffer size and mode, reference of ratios
+  double md5_gb_per_s[BENCH_BUFFER_SIZES_NUM][2];
+  double md5_ratio;
+  unsigned int regressions_num = 0;
+  int is_first = 1;
+
+  memset(md5_gb_per_s, 0, sizeof(md5_gb_per_s));
+  threads_num = mhlosi_cpu_count();
+  while ((opt = getopt(argc, argv, "j:m:r:o:b:T:su:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'j':
+        threads_num = (unsigned int) atoi(optarg);
+        break;
+      case 'm':
+        min_ms = (unsigned int) atoi(optarg);
+        break;
+      case 'r':
+        runs = atoi(optarg);
+        break;
+      case 'o':
+        report_path = optarg;
+        break;
+      case 'b':
+        baselines_path = optarg;
+        break;
+      case 'T':
+        tolerance = atof(optarg);
+        break;
+      case 's':
+        is_strict = 1;
+        break;
+      case 'u':
+        new_baselines_path = optarg;
+        break;
+      default:
+        fprintf(stderr,
+                "Usage: %s [-j threads] [-m ms] [-r runs] [-o report.json] "
+                "[-b baselines.txt [-T percent] [-s]] [-u baselines.txt]\n", 
+                argv[0]);
+        return ERRCODE_WRONG_ARGUMENTS;
+    }
+  }
+
+  if (runs < 1)
+  {
+    runs = 1;
+  }
+  if (threads_num < 2)
+  {
+    threads_num = 2;
+  }
+  if (threads_num > BENCH_MAX_THREADS)
+  {
+    threads_num = BENCH_MAX_THREADS;
+  }
+
+  if (baselines_path != NULL)
+  {
+    res = aux_read_baselines(baselines_path, baselines, &baselines_num);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+
+  report = stdout;
+  if (report_path != NULL)
+  {
+    report = fopen(report_path, "w");
+    if (report == NULL)
+    {
+      fprintf(stderr, "Cannot write %s\n", report_path);
+      return ERRCODE_IO_ERROR;
+    }
+  }
+
+  if (new_baselines_path != NULL)
+  {
+    new_baselines = fopen(new_baselines_path, "w");
+    if (new_baselines == NULL)
+    {
+      fprintf(stderr, "Cannot write %s\n", new_baselines_path);
+      if (report != stdout)
+      {
+        fclose(report);
+      }
+      return ERRCODE_IO_ERROR;
+    }
+    fprintf(new_baselines, 
+            "# digest, buffer size, 'st' - one thread or 'mt' - several "
+            "threads,\n# throughput relative to MD5 of the same buffer size "
+            "and threads\n");
+  }
+
+  buffer = aux_make_buffer(BENCH_MAX_BUFFER_SZ);
+  if (buffer == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    res = ERRCODE_OUT_OF_MEM;
+  }
+
+  fprintf(report, 
+          "{\n"
+          "  \"tool\": \"mhl_bench_hash\",\n"
+          "  \"threads\": %u,\n"
+          "  \"cycles\": \"%s\",\n"
+          "  \"results\": [",
+          threads_num,
+#ifdef BENCH_HAVE_TSC
+          "tsc"
+#else
+          "none"
+#endif
+          );
+
+  for (d = 0; d < BENCH_DIGESTS_NUM && res == 0; ++d)
+  {
+    for (buffer_sz = BENCH_MIN_BUFFER_SZ, buffer_sz_idx = 0; 
+         buffer_sz <= BENCH_MAX_BUFFER_SZ && res == 0; 
+         buffer_sz *= 4, ++buffer_sz_idx)
+    {
+      // threads check their hashes against the one of a single call
+      res = aux_hash_buffer(buffer, buffer_sz, g_digests[d].hash_type, 
+                            &expected_hash);
+      if (res != 0)
+      {
+        break;
+      }
+
+      for (m = 0; m < 2 && res == 0; ++m)
+      {
+        mode = m == 0 ? "st" : "mt";
+        mode_threads = m == 0 ? 1 : threads_num;
+        res = aux_bench_digest(buffer, buffer_sz, g_digests[d].hash_type, 
+                               expected_hash, mode_threads, min_ms, runs, 
+                               &gb_per_s, &cycles_per_byte);
+        if (res != 0)
+        {
+          fprintf(stderr, "%s of %lu bytes failed: %s\n", g_digests[d].name,
+                  (unsigned long) buffer_sz, mhl_error_code_description(res));
+          break;
+        }
+
+        // threads share memory bandwidth and cores, several threads are
+        // compared by throughput per thread
+        if (g_digests[d].hash_type == MHL_HT_MD5)
+        {
+          md5_gb_per_s[buffer_sz_idx][m] = gb_per_s / mode_threads;
+        }
+        md5_ratio = md5_gb_per_s[buffer_sz_idx][m] > 0 ? 
+          gb_per_s / mode_threads / md5_gb_per_s[buffer_sz_idx][m] : 0;
+
+        fprintf(report, 
+                "%s\n    {\"algorithm\": \"%s\", \"buffer_size\": %lu, "
+                "\"threads\": %u, \"gb_per_s\": %.3f, "
+                "\"gb_per_s_per_thread\": %.3f, \"md5_ratio\": %.3f, "
+                "\"cycles_per_byte\": %.2f}",
+                is_first ? "" : ",", g_digests[d].name, 
+                (unsigned long) buffer_sz, mode_threads, gb_per_s, 
+                gb_per_s / mode_threads, md5_ratio, cycles_per_byte);
+        is_first = 0;
+
+        if (g_digests[d].hash_type == MHL_HT_MD5)
+        {
+          // the reference itself
+          continue;
+        }
+
+        if (new_baselines != NULL)
+        {
+          fprintf(new_baselines, "%s %lu %s %.3f\n", g_digests[d].name,
+                  (unsigned long) buffer_sz, mode, md5_ratio);
+        }
+
+        p_baseline = 
+          aux_find_baseline(baselines, baselines_num, g_digests[d].name,
+                            buffer_sz, mode);
+        if (p_baseline != NULL && 
+            md5_ratio < p_baseline->md5_ratio * (1 - tolerance / 100))
+        {
+          fprintf(stderr, 
+                  "%s: %s, %lu bytes, %s: %.3f of MD5 throughput, "
+                  "baseline %.3f\n", 
+                  is_strict ? "REGRESSION" : "WARNING",
+                  g_digests[d].name, (unsigned long) buffer_sz, mode, 
+                  md5_ratio, p_baseline->md5_ratio);
+          ++regressions_num;
+        }
+      }
+
+      free(expected_hash);
+    }
+  }
+
+  fprintf(report, "\n  ],\n  \"regressions\": %u\n}\n", regressions_num);
+
+  free(buffer);
+  if (new_baselines != NULL && fclose(new_baselines) != 0 && res == 0)
+  {
+    res = ERRCODE_IO_ERROR;
+  }
+  if (report != stdout && fclose(report) != 0 && res == 0)
+  {
+    res = ERRCODE_IO_ERROR;
+  }
+
+  if (res == 0 && regressions_num != 0)
+  {
+    fprintf(stderr, "%u results are more than %.0f%% below baselines\n", 
+            regressions_num, tolerance);
+    if (is_strict)
+    {
+      res = BENCH_EXIT_REGRESSION;
+    }
+  }
+  return res;
+}
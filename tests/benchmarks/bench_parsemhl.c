@@ -0,0 +1,271 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+/*
+ * @file: bench_parsemhl.c
+ *
+ * Compares the MHL scanner with libxml2 on MHL files.
+ *
+ * Usage: mhl_bench_parse [-n entries] [-r runs] [file.mhl ...]
+ *
+ * Without files a manifest with given number of entries (1M by default)
+ * is generated in the temporary directory and removed afterwards.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <facade_info/error_codes.h>
+#include <generics/char_conversions.h>
+#include <mhltools_common/controlling_data.h>
+#include <parsemhl/mhl_file_handlers.h>
+
+#define BENCH_DEFAULT_ENTRIES 1000000
+#define BENCH_DEFAULT_RUNS 3
+
+static double
+aux_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Writes MHL file similar to ones created by "mhl seal":
+ * clips in per-clip folders, some names need entity references.
+ */
+static int
+aux_generate_mhl(const char* path, unsigned long entries)
+{
+  FILE* f;
+  unsigned long i;
+
+  f = fopen(path, "w");
+  if (f == NULL)
+  {
+    return ERRCODE_IO_ERROR;
+  }
+
+  fprintf(f,
+          "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+          "<hashlist version=\"1.1\">\n\n"
+          "  <creatorinfo>\n"
+          "    <name>Bench</name>\n"
+          "    <username>bench</username>\n"
+          "    <hostname>localhost</hostname>\n"
+          "    <tool>mhl_bench_parse</tool>\n"
+          "    <startdate>2016-01-01T00:00:00Z</startdate>\n"
+          "    <finishdate>2016-01-01T00:00:00Z</finishdate>\n"
+          "  </creatorinfo>\n\n");
+
+  for (i = 0; i < entries; ++i)
+  {
+    fprintf(f,
+            "  <hash>\n"
+            "    <file>A%03lu_C%03lu%s/A%03luC%03lu_%07lu.ari</file>\n"
+            "    <size>%lu</size>\n"
+            "    <lastmodificationdate>2016-01-01T00:00:00Z"
+            "</lastmodificationdate>\n"
+            "    <md5>%016llx%016llx</md5>\n"
+            "    <hashdate>2016-01-01T00:00:00Z</hashdate>\n"
+            "  </hash>\n",
+            i / 100000, (i / 1000) % 100,
+            (i / 1000) % 10 == 0 ? "_R&amp;D" : "",
+            i / 100000, (i / 1000) % 100, i,
+            12345678UL + i * 7,
+            i * 0x9E3779B97F4A7C15ULL, ~(unsigned long long) i);
+  }
+
+  fprintf(f, "</hashlist>\n");
+  return fclose(f) == 0 ? 0 : ERRCODE_IO_ERROR;
+}
+
+/* Parses file several times with given parser and prints the best time.
+ */
+static int
+aux_bench_parser(
+  const wchar_t* mhl_wpath,
+  const char* parser_name,
+  MHL_PARSER_TYPE parser,
+  int runs,
+  st_conversion_settings* p_cs,
+  unsigned int* p_items)
+{
+  int res;
+  int run;
+  double beg;
+  double t;
+  double best = 0;
+  st_mhl_file_wcontent wcontent;
+
+  for (run = 0; run < runs; ++run)
+  {
+    init_mhl_file_wcontent(&wcontent);
+
+    beg = aux_now();
+    res = parse_mhl_wfile_with_parser(mhl_wpath, &wcontent, p_cs, parser);
+    t = aux_now() - beg;
+
+    *p_items = (unsigned int) wcontent.check_witems_num;
+    free_mhl_file_wcontent(&wcontent);
+
+    if (res != 0)
+    {
+      printf("  %-8s %s\n", parser_name,
+             res == ERRCODE_NOT_IMPLEMENTED ?
+               "not applicable, file is left to libxml2" :
+               mhl_error_code_description(res));
+      return res;
+    }
+
+    if (run == 0 || t < best)
+    {
+      best = t;
+    }
+  }
+
+  printf("  %-8s %9u items  %8.3f s  %10.0f items/s\n",
+         parser_name, *p_items, best, best > 0 ? *p_items / best : 0);
+  return 0;
+}
+
+static int
+aux_bench_file(const char* path, int runs, st_conversion_settings* p_cs)
+{
+  int res;
+  int res_libxml;
+  char abs_path[PATH_MAX];
+  wchar_t* mhl_wpath;
+  unsigned int scanner_items = 0;
+  unsigned int libxml_items = 0;
+
+  if (realpath(path, abs_path) == NULL)
+  {
+    fprintf(stderr, "Cannot find %s\n", path);
+    return ERRCODE_NO_SUCH_FILE;
+  }
+
+  mhl_wpath = strdup_and_convert_from_locale_to_wchar(abs_path, p_cs, &res);
+  if (mhl_wpath == NULL)
+  {
+    fprintf(stderr, "Cannot convert path %s: %s\n", abs_path,
+            mhl_error_code_description(res));
+    return res;
+  }
+
+  printf("%s\n", abs_path);
+  res =
+    aux_bench_parser(mhl_wpath, "scanner", MHL_PARSER_SCANNER, runs, p_cs,
+                     &scanner_items);
+  res_libxml =
+    aux_bench_parser(mhl_wpath, "libxml2", MHL_PARSER_LIBXML, runs, p_cs,
+                     &libxml_items);
+  free(mhl_wpath);
+
+  if (res == 0 && res_libxml == 0 && scanner_items != libxml_items)
+  {
+    fprintf(stderr, "Parsers return different number of items\n");
+    return ERRCODE_INTERNAL_ERROR;
+  }
+
+  return res == ERRCODE_NOT_IMPLEMENTED ? res_libxml : res;
+}
+
+int main(int argc, char* argv[])
+{
+  int res = 0;
+  int opt;
+  int i;
+  int runs = BENCH_DEFAULT_RUNS;
+  unsigned long entries = BENCH_DEFAULT_ENTRIES;
+  const char* tmp_dir;
+  char tmp_path[PATH_MAX];
+  st_conversion_settings cs;
+
+  while ((opt = getopt(argc, argv, "n:r:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        entries = strtoul(optarg, NULL, 10);
+        break;
+      case 'r':
+        runs = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr,
+                "Usage: %s [-n entries] [-r runs] [file.mhl ...]\n", argv[0]);
+        return ERRCODE_WRONG_ARGUMENTS;
+    }
+  }
+
+  if (runs < 1)
+  {
+    runs = 1;
+  }
+
+  mhlosi_setlocale();
+  res = init_st_conversion_settings(&cs);
+  if (res != 0)
+  {
+    fprintf(stderr, "Cannot init conversion settings: %s\n",
+            mhl_error_code_description(res));
+    return res;
+  }
+
+  if (optind < argc)
+  {
+    for (i = optind; i < argc && res == 0; ++i)
+    {
+      res = aux_bench_file(argv[i], runs, &cs);
+    }
+  }
+  else
+  {
+    tmp_dir = getenv("TMPDIR");
+    snprintf(tmp_path, sizeof(tmp_path), "%s/mhl_bench_parse_%d.mhl",
+             tmp_dir != NULL ? tmp_dir : "/tmp", (int) getpid());
+
+    printf("Generating %lu entries...\n", entries);
+    res = aux_generate_mhl(tmp_path, entries);
+    if (res == 0)
+    {
+      res = aux_bench_file(tmp_path, runs, &cs);
+    }
+    else
+    {
+      fprintf(stderr, "Cannot write %s\n", tmp_path);
+    }
+    unlink(tmp_path);
+  }
+
+  free_st_conversion_settings(&cs);
+  return res;
+}
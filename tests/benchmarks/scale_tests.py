@@ -0,0 +1,194 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+Scale tests of the mhl tool on manifests with millions of entries.
+
+A tree of empty files is generated into the work folder and kept there
+between runs, its hash list is written by the script. 'mhl file' creates
+the MHL file from the list, which is then parsed by 'mhl file -p' and
+checked by 'mhl verify -e'; 'mhl seal' and 'mhl verify' run on the tree.
+Each command must finish within budgets of peak RSS and wall time, which
+grow linearly with the number of entries. The script fails when a
+command fails or exceeds its budget.
+
+Usage:
+  python scale_tests.py --work-dir /mnt/scale [--entries N]
+                        [--time-factor F] [--output results.json]
+"""
+
+from __future__ import print_function
+
+import argparse
+import glob
+import json
+import os
+import shutil
+import sys
+import time
+
+from bench_e2e import MHL_DEFAULT, run_measured
+
+# empty files in each folder, 100 folders in each top folder
+FILES_PER_DIR = 1000
+DIRS_PER_TOP_DIR = 100
+
+MD5_EMPTY = "d41d8cd98f00b204e9800998ecf8427e"
+
+# Budgets of each command: fixed part plus part per entry.
+# RSS is in KB and in bytes per entry, time is in seconds and in
+# microseconds per entry; times are multiplied by --time-factor.
+# Commands, which collect entries in memory, take about 0.9-1.1 KB per
+# entry; 'file -p' streams them, its RSS grows only by pages of the
+# mapped MHL file, about 250 bytes per entry.
+BUDGETS = {
+    "file":      {"rss_kb": 32 * 1024, "rss_b": 1280, "time_s": 10, "time_us": 60},
+    "file -p":   {"rss_kb": 32 * 1024, "rss_b": 384,  "time_s": 10, "time_us": 20},
+    "verify -e": {"rss_kb": 32 * 1024, "rss_b": 1152, "time_s": 10, "time_us": 60},
+    "seal":      {"rss_kb": 32 * 1024, "rss_b": 1408, "time_s": 10, "time_us": 150},
+    "verify":    {"rss_kb": 32 * 1024, "rss_b": 1152, "time_s": 10, "time_us": 150},
+}
+
+
+def entry_path(i):
+    top = i // (FILES_PER_DIR * DIRS_PER_TOP_DIR)
+    folder = (i // FILES_PER_DIR) % DIRS_PER_TOP_DIR
+    return os.path.join("A%04d_CARD" % top, "CLIP_%02d" % folder, "C%08d.dpx" % i)
+
+
+def prepare_tree(work_dir, entries):
+    """Generates tree of empty files and its list of MD5 hashes,
+    unless they exist for the same number of entries.
+    @return folder of the tree, path of the hash list"""
+    root = os.path.join(work_dir, "tree")
+    hashes_path = os.path.join(work_dir, "hashes.txt")
+    params = {"entries": entries, "files_per_dir": FILES_PER_DIR,
+              "dirs_per_top_dir": DIRS_PER_TOP_DIR}
+    marker = os.path.join(work_dir, "tree.json")
+    if os.path.isdir(root) and os.path.isfile(marker):
+        with open(marker) as f:
+            if json.load(f) == params:
+                return root, hashes_path
+    if os.path.isdir(root):
+        shutil.rmtree(root)
+    if os.path.isfile(marker):
+        os.remove(marker)
+
+    print("Generating tree of %d files..." % entries)
+    beg = time.time()
+    with open(hashes_path, "w") as hashes:
+        for i in range(entries):
+            path = entry_path(i)
+            if i % FILES_PER_DIR == 0:
+                os.makedirs(os.path.join(root, os.path.dirname(path)))
+            os.close(os.open(os.path.join(root, path), os.O_CREAT | os.O_WRONLY, 0o644))
+            hashes.write("MD5(tree/%s)= %s\n" % (path, MD5_EMPTY))
+    with open(marker, "w") as f:
+        json.dump(params, f)
+    print("  done in %.1f s" % (time.time() - beg))
+    return root, hashes_path
+
+
+def remove_mhl_files(folder):
+    for path in glob.glob(os.path.join(folder, "*.mhl")):
+        os.remove(path)
+
+
+def count_entries(path):
+    """@return number of zero-terminated entries printed by 'mhl file -p -0'."""
+    count = 0
+    with open(path, "rb") as f:
+        while True:
+            block = f.read(1024 * 1024)
+            if not block:
+                break
+            count += block.count(b"\0")
+    return count
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Scale tests of the mhl tool")
+    parser.add_argument("--mhl", default=MHL_DEFAULT, help="mhl binary")
+    parser.add_argument("--work-dir", required=True,
+                        help="folder for the tree, it is kept there")
+    parser.add_argument("--entries", type=int, default=10000000,
+                        help="number of files and MHL entries")
+    parser.add_argument("--time-factor", type=float, default=1.0,
+                        help="multiplier of time budgets for slow machines")
+    parser.add_argument("--output", help="JSON file for results")
+    args = parser.parse_args()
+
+    mhl = os.path.abspath(args.mhl)
+    work_dir = os.path.abspath(args.work_dir)
+    if not os.path.isdir(work_dir):
+        os.makedirs(work_dir)
+    root, hashes_path = prepare_tree(work_dir, args.entries)
+    out_dir = os.path.join(work_dir, "out")
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    os.makedirs(out_dir)
+    stdout_path = os.path.join(out_dir, "stdout.txt")
+    entries_path = os.path.join(out_dir, "entries.txt")
+
+    remove_mhl_files(root)
+    mhl_file = lambda: glob.glob(os.path.join(root, "*.mhl"))
+
+    # commands in the order they depend on each other, MHL file of
+    # 'file' is replaced by the one of 'seal' in the tree's folder
+    steps = [
+        ("file", None, lambda: ["file", "-f", hashes_path, "-o", root], stdout_path),
+        ("file -p", None, lambda: ["file", "-p"] + mhl_file() + ["-0"], entries_path),
+        ("verify -e", None, lambda: ["verify", "-e", "-f"] + mhl_file(), stdout_path),
+        ("seal", lambda: remove_mhl_files(root),
+         lambda: ["seal", "-t", "md5", "-o", root, root], stdout_path),
+        ("verify", None, lambda: ["verify", "-f"] + mhl_file(), stdout_path),
+    ]
+
+    results = []
+    failed = False
+    for name, setup, make_args, out_path in steps:
+        if setup is not None:
+            setup()
+        budget = BUDGETS[name]
+        rss_budget = budget["rss_kb"] + budget["rss_b"] * args.entries // 1024
+        time_budget = (budget["time_s"] + budget["time_us"] * args.entries / 1e6) * args.time_factor
+        code, wall, utime, stime, rss = run_measured([mhl] + make_args(), work_dir, out_path)
+        errors = []
+        if code != 0:
+            errors.append("exit code %d" % code)
+        if rss > rss_budget:
+            errors.append("peak RSS %d KB exceeds budget %d KB" % (rss, rss_budget))
+        if wall > time_budget:
+            errors.append("wall time %.1f s exceeds budget %.1f s" % (wall, time_budget))
+        if name == "file -p" and code == 0:
+            printed = count_entries(out_path)
+            if printed != args.entries:
+                errors.append("%d entries printed instead of %d" % (printed, args.entries))
+        failed = failed or bool(errors)
+        results.append({
+            "command": name,
+            "exit_code": code,
+            "wall_s": round(wall, 3),
+            "user_s": round(utime, 3),
+            "sys_s": round(stime, 3),
+            "peak_rss_kb": rss,
+            "time_budget_s": round(time_budget, 3),
+            "rss_budget_kb": rss_budget,
+            "rss_b_per_entry": round((rss * 1024.0) / args.entries, 1),
+            "errors": errors,
+        })
+        print("%-9s %8.2f s (budget %8.1f s)  %9d KB (budget %9d KB)  %s" %
+              (name, wall, time_budget, rss, rss_budget,
+               "; ".join(errors) if errors else "ok"))
+    os.remove(entries_path)
+    remove_mhl_files(root)
+
+    if args.output:
+        report = {"tool": "scale_tests", "mhl": mhl, "entries": args.entries,
+                  "time_factor": args.time_factor, "results": results}
+        with open(args.output, "w") as f:
+            json.dump(report, f, indent=2)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
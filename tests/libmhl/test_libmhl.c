@@ -0,0 +1,680 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Pomfort GmbH
+ https://github.com/pomfort/mhl-tool
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+/*
+ * @file: test_libmhl.c
+ *
+ * Checks the C API of libmhl.
+ *
+ * Usage: mhl_test_libmhl WORK_DIR
+ *
+ * Each thread writes files into its own folder in WORK_DIR, hashes them
+ * by files and by streams, builds MHL file of them, parses it back and
+ * verifies its entries, then damages files and checks, that they are 
+ * reported. Then all the threads parse gzip-compressed MHL files of their
+ * files many times, via libxml2. Threads use their own contexts at the 
+ * same time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <generics/os_threads.h>
+#include <libmhl/libmhl.h>
+
+#define TEST_THREADS_NUM 4
+#define TEST_FILES_NUM 8
+#define TEST_PATH_SZ 4096
+// the first file of each thread is big enough to report progress
+#define TEST_BIG_FILE_SZ (3 * LIBMHL_PROGRESS_STEP_SZ + 12345)
+#define TEST_PART_SZ 1000
+// gzip-compressed MHL file is parsed by libxml2, each thread parses
+// it many times, in parallel with the other threads
+#define TEST_GZIP_PARSES_NUM 300
+// returned by progress callback in order to stop hashing, 
+// above LIBMHL_ERR_MAX
+#define TEST_STOP_CODE 1000
+
+static const LIBMHL_HASH_TYPE g_hash_types[] = 
+{
+  LIBMHL_HT_MD5, LIBMHL_HT_SHA1, LIBMHL_HT_XXHASH, LIBMHL_HT_XXHASH64, 
+  LIBMHL_HT_XXHASH64BE
+};
+#define TEST_HASHES_NUM (sizeof(g_hash_types) / sizeof(g_hash_types[0]))
+
+typedef struct _st_test_job
+{
+  const char* work_dir;
+  unsigned int no;
+  unsigned int failures;
+  char* gzip_mhl_path;
+} st_test_job;
+
+typedef struct _st_test_progress
+{
+  unsigned int calls;
+  unsigned long long last_sz;
+  unsigned long long total_sz;
+  unsigned char is_stop_requested;
+} st_test_progress;
+
+typedef struct _st_test_entries
+{
+  st_libmhl_context* p_ctx;
+  st_test_job* p_job;
+  unsigned int entries_num;
+  unsigned int verified_num;
+  // digests of the first file in the order of g_hash_types
+  char** first_hash_strs;
+  const char* first_name;
+  unsigned int first_hashes_found;
+} st_test_entries;
+
+#define TEST_CHECK(p_job, cond)                                       \
+  do                                                                  \
+  {                                                                   \
+    if (!(cond))                                                      \
+    {                                                                 \
+      fprintf(stderr, "thread %u, line %d: check failed: %s\n",       \
+              (p_job)->no, __LINE__, #cond);                          \
+      ++(p_job)->failures;                                            \
+    }                                                                 \
+  } while (0)
+
+// collects error messages of the context
+typedef struct _st_test_errors
+{
+  char text[TEST_PATH_SZ];
+  unsigned int calls;
+} st_test_errors;
+
+static void
+aux_collect_error(const char* msg, void* data)
+{
+  st_test_errors* p_errors = (st_test_errors*) data;
+  size_t len = strlen(p_errors->text);
+
+  ++p_errors->calls;
+  strncat(p_errors->text, msg, sizeof(p_errors->text) - len - 1);
+}
+
+static int
+aux_write_file(const char* path, size_t sz, unsigned int seed)
+{
+  FILE* file;
+  size_t i;
+  unsigned int state = seed * 2654435761u + 1;
+
+  file = fopen(path, "wb");
+  if (file == NULL)
+  {
+    return -1;
+  }
+
+  for (i = 0; i < sz; ++i)
+  {
+    state = state * 1103515245u + 12345u;
+    fputc((int) (state >> 16) & 0xff, file);
+  }
+
+  return fclose(file);
+}
+
+static unsigned char*
+aux_read_file(const char* path, size_t* p_sz)
+{
+  FILE* file;
+  unsigned char* data;
+  long sz;
+
+  file = fopen(path, "rb");
+  if (file == NULL)
+  {
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  sz = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  // terminated by '\0' for text files
+  data = (unsigned char*) malloc(sz + 1);
+  if (data != NULL && fread(data, 1, sz, file) != (size_t) sz)
+  {
+    free(data);
+    data = NULL;
+  }
+  if (data != NULL)
+  {
+    data[sz] = '\0';
+  }
+  fclose(file);
+  *p_sz = sz;
+  return data;
+}
+
+static int
+aux_count_progress(
+  unsigned long long processed_sz,
+  unsigned long long total_sz,
+  void* data)
+{
+  st_test_progress* p_progress = (st_test_progress*) data;
+
+  ++p_progress->calls;
+  p_progress->last_sz = processed_sz;
+  p_progress->total_sz = total_sz;
+  if (p_progress->is_stop_requested && processed_sz > 0)
+  {
+    return TEST_STOP_CODE;
+  }
+  return 0;
+}
+
+static const char*
+aux_file_name(const char* path)
+{
+  const char* name = strrchr(path, '/');
+
+  return name != NULL ? name + 1 : path;
+}
+
+/* Checks, that all the digests of the first file are passed with
+ * the entry, the primary digest among them.
+ */
+static void
+aux_check_first_entry_hashes(st_test_entries* p_entries, 
+                             const st_libmhl_entry* p_entry)
+{
+  size_t i;
+  size_t j;
+  unsigned char is_primary_found = 0;
+
+  TEST_CHECK(p_entries->p_job, p_entry->hashes_num == TEST_HASHES_NUM);
+  TEST_CHECK(p_entries->p_job, p_entry->hash_type == LIBMHL_HT_SHA1);
+  for (i = 0; i < p_entry->hashes_num; ++i)
+  {
+    for (j = 0; j < TEST_HASHES_NUM; ++j)
+    {
+      if (p_entry->hashes[i].hash_type == g_hash_types[j] &&
+          strcmp(p_entry->hashes[i].u8str_hash_sum, 
+                 p_entries->first_hash_strs[j]) == 0)
+      {
+        ++p_entries->first_hashes_found;
+      }
+    }
+    if (p_entry->hashes[i].hash_type == p_entry->hash_type &&
+        strcmp(p_entry->hashes[i].u8str_hash_sum, 
+               p_entry->u8str_hash_sum) == 0)
+    {
+      is_primary_found = 1;
+    }
+  }
+  TEST_CHECK(p_entries->p_job, is_primary_found);
+}
+
+static int
+aux_verify_parsed_entry(const st_libmhl_entry* p_entry, void* data)
+{
+  st_test_entries* p_entries = (st_test_entries*) data;
+
+  ++p_entries->entries_num;
+  if (libmhl_verify_entry(p_entries->p_ctx, p_entry, NULL, NULL) == 0)
+  {
+    ++p_entries->verified_num;
+  }
+
+  if (p_entries->first_hash_strs != NULL && 
+      strcmp(aux_file_name(p_entry->abs_u8path), 
+             p_entries->first_name) == 0)
+  {
+    aux_check_first_entry_hashes(p_entries, p_entry);
+  }
+  return 0;
+}
+
+// counts entries with both the digests, written by aux_build_gzip_mhl()
+static int
+aux_count_entry(const st_libmhl_entry* p_entry, void* data)
+{
+  unsigned int* p_entries_num = (unsigned int*) data;
+
+  if (p_entry->hashes_num == 2 && 
+      p_entry->hashes[0].hash_type == g_hash_types[0] &&
+      p_entry->hashes[1].hash_type == g_hash_types[1])
+  {
+    ++*p_entries_num;
+  }
+  return 0;
+}
+
+/* Builds gzip-compressed MHL file of the files, it is parsed later by 
+ * aux_parse_gzip_job().
+ */
+static void
+aux_build_gzip_mhl(st_test_job* p_job, st_libmhl_context* p_ctx, 
+                   const char* dir, char paths[][TEST_PATH_SZ])
+{
+  int res;
+  unsigned int i;
+  st_libmhl_builder* p_builder;
+
+  res = libmhl_create_builder(p_ctx, dir, 1, &p_builder);
+  TEST_CHECK(p_job, res == 0);
+  if (res != 0)
+  {
+    return;
+  }
+
+  for (i = 0; res == 0 && i < TEST_FILES_NUM; ++i)
+  {
+    res = libmhl_add_file_to_builder(p_builder, paths[i], g_hash_types, 2,
+                                     NULL, NULL);
+  }
+  if (res == 0)
+  {
+    res = libmhl_write_builder(p_builder, &p_job->gzip_mhl_path);
+  }
+  libmhl_free_builder(p_builder);
+  TEST_CHECK(p_job, res == 0 && p_job->gzip_mhl_path != NULL && 
+                    strstr(p_job->gzip_mhl_path, ".mhl.gz") != NULL);
+}
+
+/* Parses gzip-compressed MHL file of the job repeatedly, all the entries
+ * must be read each time. The file is read via libxml2, all the threads 
+ * do it at the same time.
+ */
+static void
+aux_parse_gzip_job(void* arg)
+{
+  st_test_job* p_job = (st_test_job*) arg;
+  st_libmhl_context* p_ctx;
+  unsigned int i;
+  unsigned int entries_num;
+  int res;
+
+  if (p_job->gzip_mhl_path == NULL)
+  {
+    return;
+  }
+
+  res = libmhl_create_context(&p_ctx);
+  TEST_CHECK(p_job, res == 0);
+  for (i = 0; res == 0 && i < TEST_GZIP_PARSES_NUM; ++i)
+  {
+    entries_num = 0;
+    res = libmhl_parse_mhl_file(p_ctx, p_job->gzip_mhl_path, 
+                                aux_count_entry, &entries_num);
+    TEST_CHECK(p_job, res == 0 && entries_num == TEST_FILES_NUM);
+  }
+
+  if (p_ctx != NULL)
+  {
+    libmhl_free_context(p_ctx);
+  }
+}
+
+typedef struct _st_test_damage
+{
+  st_libmhl_context* p_ctx;
+  const char* changed_name;
+  const char* truncated_name;
+  const char* removed_name;
+  int changed_res;
+  int truncated_res;
+  int removed_res;
+  unsigned int others_failed;
+} st_test_damage;
+
+static int
+aux_verify_damaged_entry(const st_libmhl_entry* p_entry, void* data)
+{
+  st_test_damage* p_damage = (st_test_damage*) data;
+  const char* name = aux_file_name(p_entry->abs_u8path);
+  int res;
+
+  res = libmhl_verify_entry(p_damage->p_ctx, p_entry, NULL, NULL);
+  if (strcmp(name, p_damage->changed_name) == 0)
+  {
+    p_damage->changed_res = res;
+  }
+  else if (strcmp(name, p_damage->truncated_name) == 0)
+  {
+    p_damage->truncated_res = res;
+  }
+  else if (strcmp(name, p_damage->removed_name) == 0)
+  {
+    p_damage->removed_res = res;
+  }
+  else if (res != 0)
+  {
+    ++p_damage->others_failed;
+  }
+  return 0;
+}
+
+/* Hashes the file via libmhl_hash_file() and via hasher, which gets 
+ * the file's data by small parts, the results must be equal.
+ */
+static void
+aux_check_hashes(st_test_job* p_job, st_libmhl_context* p_ctx, 
+                 const char* path, unsigned char is_big)
+{
+  int res;
+  size_t i;
+  size_t data_sz;
+  size_t part_sz;
+  unsigned char* data;
+  unsigned long long file_sz = 0;
+  char* file_hash_strs[TEST_HASHES_NUM];
+  char* stream_hash_strs[TEST_HASHES_NUM];
+  st_libmhl_hasher* p_hasher;
+  st_test_progress progress;
+
+  memset(&progress, 0, sizeof(progress));
+  res = libmhl_hash_file(p_ctx, path, g_hash_types, TEST_HASHES_NUM, 
+                         file_hash_strs, &file_sz, aux_count_progress, 
+                         &progress);
+  TEST_CHECK(p_job, res == 0);
+  if (res != 0)
+  {
+    return;
+  }
+
+  data = aux_read_file(path, &data_sz);
+  TEST_CHECK(p_job, data != NULL && data_sz == file_sz);
+  TEST_CHECK(p_job, progress.last_sz == file_sz && 
+                    progress.total_sz == file_sz);
+  if (is_big)
+  {
+    // start, each step and the end
+    TEST_CHECK(p_job, progress.calls == 
+               2 + file_sz / LIBMHL_PROGRESS_STEP_SZ);
+  }
+
+  res = libmhl_create_hasher(g_hash_types, TEST_HASHES_NUM, &p_hasher);
+  TEST_CHECK(p_job, res == 0);
+  for (i = 0; res == 0 && data != NULL && i < data_sz; i += part_sz)
+  {
+    part_sz = data_sz - i < TEST_PART_SZ ? data_sz - i : TEST_PART_SZ;
+    res = libmhl_update_hasher(p_hasher, data + i, part_sz);
+  }
+  TEST_CHECK(p_job, res == 0);
+  if (res == 0)
+  {
+    res = libmhl_finish_hasher(p_hasher, stream_hash_strs);
+    TEST_CHECK(p_job, res == 0);
+  }
+  libmhl_free_hasher(p_hasher);
+
+  if (res == 0)
+  {
+    for (i = 0; i < TEST_HASHES_NUM; ++i)
+    {
+      TEST_CHECK(p_job, strcmp(file_hash_strs[i], stream_hash_strs[i]) == 0);
+    }
+    libmhl_free_hash_strs(stream_hash_strs, TEST_HASHES_NUM);
+  }
+
+  libmhl_free_hash_strs(file_hash_strs, TEST_HASHES_NUM);
+  free(data);
+}
+
+static void
+aux_test_job(void* arg)
+{
+  st_test_job* p_job = (st_test_job*) arg;
+  st_libmhl_context* p_ctx;
+  st_libmhl_builder* p_builder;
+  st_test_progress progress;
+  st_test_entries entries;
+  st_test_damage damage;
+  st_test_errors errors;
+  char dir[TEST_PATH_SZ / 2];
+  char outside_path[TEST_PATH_SZ];
+  char paths[TEST_FILES_NUM + 1][TEST_PATH_SZ];
+  char* hash_strs[1];
+  char* all_hash_strs[TEST_HASHES_NUM];
+  char* mhl_path = NULL;
+  char* mhl_data;
+  size_t mhl_sz;
+  const LIBMHL_HASH_TYPE md5_type = LIBMHL_HT_MD5;
+  const LIBMHL_HASH_TYPE dup_types[] = { LIBMHL_HT_SHA1, LIBMHL_HT_SHA1 };
+  const char* empty_md5 = "d41d8cd98f00b204e9800998ecf8427e";
+  unsigned int i;
+  int res;
+
+  res = libmhl_create_context(&p_ctx);
+  TEST_CHECK(p_job, res == 0);
+  if (res != 0)
+  {
+    return;
+  }
+  memset(&errors, 0, sizeof(errors));
+  libmhl_set_error_callback(p_ctx, aux_collect_error, &errors);
+
+  snprintf(dir, sizeof(dir), "%s/thread_%u", p_job->work_dir, p_job->no);
+  mkdir(dir, 0755);
+  snprintf(outside_path, sizeof(outside_path), "%s/outside_%u.bin", 
+           p_job->work_dir, p_job->no);
+  TEST_CHECK(p_job, aux_write_file(outside_path, 10, 0) == 0);
+  for (i = 0; i < TEST_FILES_NUM; ++i)
+  {
+    snprintf(paths[i], TEST_PATH_SZ, "%s/file_%u.bin", dir, i);
+    res = aux_write_file(paths[i], i == 0 ? TEST_BIG_FILE_SZ : i * 777, 
+                         p_job->no * 100 + i);
+    TEST_CHECK(p_job, res == 0);
+  }
+  // empty file, added with known hash
+  snprintf(paths[TEST_FILES_NUM], TEST_PATH_SZ, "%s/empty.bin", dir);
+  TEST_CHECK(p_job, aux_write_file(paths[TEST_FILES_NUM], 0, 0) == 0);
+
+  for (i = 0; i < TEST_FILES_NUM; ++i)
+  {
+    aux_check_hashes(p_job, p_ctx, paths[i], i == 0);
+  }
+
+  // known digest
+  res = libmhl_hash_file(p_ctx, paths[TEST_FILES_NUM], &md5_type, 1, 
+                         hash_strs, NULL, NULL, NULL);
+  TEST_CHECK(p_job, res == 0 && strcmp(hash_strs[0], empty_md5) == 0);
+  if (res == 0)
+  {
+    libmhl_free_hash_strs(hash_strs, 1);
+  }
+
+  // progress callback stops hashing
+  memset(&progress, 0, sizeof(progress));
+  progress.is_stop_requested = 1;
+  res = libmhl_hash_file(p_ctx, paths[0], &md5_type, 1, hash_strs, NULL,
+                         aux_count_progress, &progress);
+  TEST_CHECK(p_job, res == TEST_STOP_CODE && progress.calls == 2);
+
+  res = libmhl_hash_file(p_ctx, "no/such/file", &md5_type, 1, hash_strs,
+                         NULL, NULL, NULL);
+  TEST_CHECK(p_job, res == LIBMHL_ERR_NO_SUCH_FILE);
+
+  // MHL file of all the files
+  res = libmhl_create_builder(p_ctx, dir, 0, &p_builder);
+  TEST_CHECK(p_job, res == 0);
+  if (res != 0)
+  {
+    libmhl_free_context(p_ctx);
+    return;
+  }
+
+  TEST_CHECK(p_job, libmhl_write_builder(p_builder, NULL) == 
+                    LIBMHL_ERR_WRONG_ARGUMENTS);
+  // the first file gets all the digests, the others get two
+  for (i = 0; i < TEST_FILES_NUM; ++i)
+  {
+    res = libmhl_add_file_to_builder(p_builder, paths[i], g_hash_types + i % 2,
+                                     i == 0 ? TEST_HASHES_NUM : 2, NULL, NULL);
+    TEST_CHECK(p_job, res == 0);
+  }
+  TEST_CHECK(p_job, libmhl_add_file_to_builder(p_builder, paths[1], 
+                                               dup_types, 2, NULL, NULL) == 
+                    LIBMHL_ERR_WRONG_ARGUMENTS);
+  res = libmhl_add_entry_to_builder(p_builder, paths[TEST_FILES_NUM], 
+                                    &md5_type, &empty_md5, 1);
+  TEST_CHECK(p_job, res == 0);
+  TEST_CHECK(p_job, errors.calls == 0);
+  res = libmhl_add_entry_to_builder(p_builder, outside_path, 
+                                    &md5_type, &empty_md5, 1);
+  TEST_CHECK(p_job, res == LIBMHL_ERR_WRONG_FILE_LOCATION);
+  // details are passed to the callback of the context instead of stderr
+  TEST_CHECK(p_job, errors.calls > 0 && 
+                    strstr(errors.text, "outside_") != NULL);
+
+  res = libmhl_write_builder(p_builder, &mhl_path);
+  TEST_CHECK(p_job, res == 0 && mhl_path != NULL);
+  TEST_CHECK(p_job, libmhl_write_builder(p_builder, NULL) == 
+                    LIBMHL_ERR_WRONG_ARGUMENTS);
+  libmhl_free_builder(p_builder);
+  if (res != 0 || mhl_path == NULL)
+  {
+    libmhl_free_context(p_ctx);
+    return;
+  }
+
+  // all the digests of the first file are written
+  mhl_data = (char*) aux_read_file(mhl_path, &mhl_sz);
+  res = libmhl_hash_file(p_ctx, paths[0], g_hash_types, TEST_HASHES_NUM, 
+                         all_hash_strs, NULL, NULL, NULL);
+  TEST_CHECK(p_job, mhl_data != NULL && res == 0);
+  if (mhl_data != NULL && res == 0)
+  {
+    for (i = 0; i < TEST_HASHES_NUM; ++i)
+    {
+      TEST_CHECK(p_job, strstr(mhl_data, all_hash_strs[i]) != NULL);
+    }
+  }
+  free(mhl_data);
+
+  // all the entries are parsed and verified, all the digests of 
+  // the first file are passed with its entry
+  memset(&entries, 0, sizeof(entries));
+  entries.p_ctx = p_ctx;
+  entries.p_job = p_job;
+  entries.first_hash_strs = res == 0 ? all_hash_strs : NULL;
+  entries.first_name = aux_file_name(paths[0]);
+  res = libmhl_parse_mhl_file(p_ctx, mhl_path, aux_verify_parsed_entry, 
+                              &entries);
+  TEST_CHECK(p_job, res == 0);
+  TEST_CHECK(p_job, entries.entries_num == TEST_FILES_NUM + 1);
+  TEST_CHECK(p_job, entries.verified_num == TEST_FILES_NUM + 1);
+  TEST_CHECK(p_job, entries.first_hashes_found == TEST_HASHES_NUM);
+  if (entries.first_hash_strs != NULL)
+  {
+    libmhl_free_hash_strs(all_hash_strs, TEST_HASHES_NUM);
+  }
+
+  aux_build_gzip_mhl(p_job, p_ctx, dir, paths);
+
+  // damaged files are reported
+  TEST_CHECK(p_job, aux_write_file(paths[1], 777, 12345) == 0);
+  TEST_CHECK(p_job, aux_write_file(paths[2], 100, p_job->no * 100 + 2) == 0);
+  TEST_CHECK(p_job, remove(paths[3]) == 0);
+
+  memset(&damage, 0, sizeof(damage));
+  damage.p_ctx = p_ctx;
+  damage.changed_name = aux_file_name(paths[1]);
+  damage.truncated_name = aux_file_name(paths[2]);
+  damage.removed_name = aux_file_name(paths[3]);
+  res = libmhl_parse_mhl_file(p_ctx, mhl_path, aux_verify_damaged_entry, 
+                              &damage);
+  TEST_CHECK(p_job, res == 0);
+  TEST_CHECK(p_job, damage.changed_res == LIBMHL_ERR_HASH_MISMATCH);
+  TEST_CHECK(p_job, damage.truncated_res == LIBMHL_ERR_SIZE_MISMATCH);
+  TEST_CHECK(p_job, damage.removed_res == LIBMHL_ERR_NO_SUCH_FILE);
+  TEST_CHECK(p_job, damage.others_failed == 0);
+
+  free(mhl_path);
+  libmhl_free_context(p_ctx);
+}
+
+int main(int argc, const char* argv[])
+{
+  st_test_job jobs[TEST_THREADS_NUM];
+  mhlosi_thread threads[TEST_THREADS_NUM];
+  unsigned int i;
+  unsigned int failures = 0;
+
+  if (argc != 2)
+  {
+    fprintf(stderr, "Usage: mhl_test_libmhl WORK_DIR\n");
+    return 2;
+  }
+
+  setlocale(LC_CTYPE, "");
+  if (mkdir(argv[1], 0755) != 0 && errno != EEXIST)
+  {
+    fprintf(stderr, "Cannot create folder %s\n", argv[1]);
+    return 2;
+  }
+
+  for (i = 0; i < TEST_THREADS_NUM; ++i)
+  {
+    jobs[i].work_dir = argv[1];
+    jobs[i].no = i;
+    jobs[i].failures = 0;
+    jobs[i].gzip_mhl_path = NULL;
+    if (mhlosi_thread_create(&threads[i], aux_test_job, &jobs[i]) != 0)
+    {
+      fprintf(stderr, "Cannot start thread\n");
+      return 2;
+    }
+  }
+
+  for (i = 0; i < TEST_THREADS_NUM; ++i)
+  {
+    mhlosi_thread_join(threads[i]);
+  }
+
+  for (i = 0; i < TEST_THREADS_NUM; ++i)
+  {
+    if (mhlosi_thread_create(&threads[i], aux_parse_gzip_job, &jobs[i]) != 0)
+    {
+      fprintf(stderr, "Cannot start thread\n");
+      return 2;
+    }
+  }
+
+  for (i = 0; i < TEST_THREADS_NUM; ++i)
+  {
+    mhlosi_thread_join(threads[i]);
+    failures += jobs[i].failures;
+    free(jobs[i].gzip_mhl_path);
+  }
+
+  printf("libmhl %s: %u threads, %u failed checks\n", libmhl_version(), 
+         TEST_THREADS_NUM, failures);
+  return failures == 0 ? 0 : 1;
+}
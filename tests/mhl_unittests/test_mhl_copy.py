@@ -0,0 +1,88 @@
+from __future__ import print_function
+import unittest
+import os
+import filecmp
+from lxml import etree
+
+__package__ = "mhl_unittests"
+
+from .tools import mhl
+from .tools.testdirs import TestDir
+from .test_mhl_seal import expected_file_hashes
+
+
+class TestMHLCopy(unittest.TestCase):
+    def setUp(self):
+        self._testDirs = []
+
+    def tearDown(self):
+        for testDir in self._testDirs:
+            testDir.delete()
+
+    def test_mhl_copy_to_two_destinations(self):
+        testDir = TestDir("test_mhl_copy_to_two_destinations")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"])
+
+        destinations = [testDir.abspath_for("dst1"), testDir.abspath_for("dst2")]
+        mhl.mhl_copy.copy([testDir.abspath_for("mhl_seal")], destinations, hashtype="sha1", verify=True)
+
+        for destination in destinations:
+            mhl_files = [os.path.join(destination, entry) for entry in os.listdir(destination) if entry.endswith(".mhl")]
+            self.assertEquals(len(mhl_files), 1, msg="Unexpected number of mhl files in %s" % destination)
+
+            mhl_file = mhl.MHLFile(mhl_files[0])
+            for file, hashes in expected_file_hashes.iteritems():
+                copied_file = "mhl_seal/%s" % file
+                self.assertTrue(filecmp.cmp(testDir.abspath_for(copied_file), os.path.join(destination, copied_file), shallow=False),
+                                msg="Copy of '%s' differs from the source" % copied_file)
+                self.assertEquals(mhl_file.hash_for_file(copied_file, "sha1"), hashes["sha1"],
+                                  msg="Wrong sha1 hash for file %s" % copied_file)
+
+            self.assertTrue(mhl.mhl_verify.verify(mhl_files[0], cwd=destination),
+                            msg="Failed to verify copy in %s" % destination)
+
+    def test_mhl_copy_does_not_overwrite(self):
+        testDir = TestDir("test_mhl_copy_does_not_overwrite")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"])
+
+        destination = testDir.abspath_for("dst")
+        mhl.mhl_copy.copy([testDir.abspath_for("mhl_seal")], [destination])
+
+        with self.assertRaises(mhl.MHLCommandException):
+            mhl.mhl_copy.copy([testDir.abspath_for("mhl_seal")], [destination])
+
+    def test_mhl_copy_into_source_fails(self):
+        testDir = TestDir("test_mhl_copy_into_source_fails")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"])
+
+        with self.assertRaises(mhl.MHLCommandException):
+            mhl.mhl_copy.copy([testDir.abspath_for("mhl_seal")], [testDir.abspath_for("mhl_seal/dst")])
+        self.assertFalse(os.path.exists(testDir.abspath_for("mhl_seal/dst")))
+
+    def test_mhl_copy_keeps_destinations_apart(self):
+        testDir = TestDir("test_mhl_copy_keeps_destinations_apart")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"])
+        os.makedirs(testDir.abspath_for("mhl_seal/empty/deeper"))
+
+        destinations = [testDir.abspath_for("dst1"), testDir.abspath_for("dst2")]
+        mhl.mhl_copy.copy([testDir.abspath_for("mhl_seal")], destinations, hashtype="md5", verbose=True)
+
+        for destination in destinations:
+            self.assertTrue(os.path.isdir(os.path.join(destination, "mhl_seal/empty/deeper")),
+                            msg="Empty folder is not copied to %s" % destination)
+
+            mhl_files = testDir.list(destination, pattern="*.mhl")
+            self.assertEquals(len(mhl_files), 1, msg="Unexpected number of mhl files in %s" % destination)
+            log = etree.parse(mhl_files[0]).findtext("creatorinfo/log")
+
+            for other in destinations:
+                self.assertEquals("   %s\n" % other in log, other == destination,
+                                  msg="Unexpected log of destination '%s' in %s" % (other, mhl_files[0]))
@@ -1,4 +1,5 @@
 from __future__ import print_function
+import os.path
 import unittest
 
 __package__ = "mhl_unittests"
@@ -44,3 +45,80 @@ class TestMHLFile(unittest.TestCase):
         hashspec_files = set(hashspecs.files())
         for file in mhl_file.files():
             self.assertIn(file, hashspec_files, msg="MHL file has a file that does not appear in the hash spec list: %s" % file)
+
+    def test_mhl_file_parse(self):
+        testDir = TestDir("test_mhl_file_parse")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_file_generic"])
+
+        hashspecs_path = testDir.abspath_for("mhl_file_generic/hashes.txt")
+        mhl.mhl_file.convert_hashspecs_to_mhl(hashspecs_path=hashspecs_path,
+                                              output_folder=testDir.abspath_for("mhl_file_generic"),
+                                              cwd=testDir.abspath_for("mhl_file_generic"))
+        mhl_file_paths = testDir.list("mhl_file_generic", "*.mhl")
+        self.assertEquals(len(mhl_file_paths), 1, msg="Exactly one MHL file expected")
+
+        # parse the MHL file back into hash specs, paths are absolute
+        entries = mhl.mhl_file.parse_mhl(mhl_file_paths[0])
+        hashspecs = mhl.MHLHashSpecList.fromfile(hashspecs_path)
+        self.assertEqual(len(entries), len(hashspecs.entries), msg="Not all MHL file items are parsed")
+
+        for entry in entries:
+            self.assertTrue(os.path.isabs(entry.filepath), msg="Path is not absolute: %s" % entry.filepath)
+            file = os.path.relpath(entry.filepath, testDir.abspath_for("mhl_file_generic"))
+            expected = [spec.hash for spec in hashspecs.entries_for_file(file) if spec.hashtype == entry.hashtype]
+            self.assertIn(entry.hash, expected, msg="Hash of %s is not found in the hash spec list" % file)
+
+    def test_mhl_file_size_and_mtime(self):
+        testDir = TestDir("test_mhl_file_size_and_mtime")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["file0.txt"])
+
+        # the file with size and mtime in the input is not accessed,
+        # its line is longer than any fixed buffer
+        long_name = "elsewhere/" + "x" * 20000 + ".mov"
+        hashspecs_path = testDir.abspath_for("hashes.txt")
+        with open(hashspecs_path, "w") as f:
+            f.write("MD5(file0.txt)= 0123456789abcdef0123456789abcdef\n")
+            f.write("MD5(%s)= 0123456789abcdef0123456789abcdef size=123456 mtime=2016-01-01T12:00:00Z\n" % long_name)
+        mhl.mhl_file.convert_hashspecs_to_mhl(hashspecs_path=hashspecs_path,
+                                              output_folder=testDir.abspath,
+                                              cwd=testDir.abspath)
+        mhl_file_paths = testDir.list(".", "*.mhl")
+        self.assertEquals(len(mhl_file_paths), 1, msg="Exactly one MHL file expected")
+
+        mhl_file = mhl.MHLFile(mhl_file_paths[0])
+        self.assertEqual([123456], mhl_file.sizes_for_file(long_name))
+        self.assertEqual(["2016-01-01T12:00:00Z"], mhl_file.lastmodificationdates_for_file(long_name))
+        self.assertEqual([os.path.getsize(testDir.abspath_for("file0.txt"))],
+                         mhl_file.sizes_for_file("file0.txt"))
+
+    def test_mhl_file_parse_multiple_hashes(self):
+        testDir = TestDir("test_mhl_file_parse_multiple_hashes")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_verify_multiple"])
+        folder = testDir.abspath_for("mhl_verify_multiple")
+        mhl_file = mhl.MHLFile(os.path.join(folder, "multiple.mhl"))
+
+        # each digest of an item is printed, in the order of the MHL file
+        entries = mhl.mhl_file.parse_mhl(mhl_file.mhl_file_path)
+        expected = [(hashtype, os.path.join(folder, file), hash)
+                    for hashtype, file, hash in mhl_file.hash_entries()]
+        self.assertEqual(len(expected), 7, msg="Unexpected content of multiple.mhl")
+        self.assertEqual([(entry.hashtype.lower(), entry.filepath, entry.hash) for entry in entries], expected)
+
+        # the printed digests make the same MHL file content again
+        hashspecs_path = testDir.abspath_for("hashes.txt")
+        with open(hashspecs_path, "w") as f:
+            for entry in entries:
+                f.write("%s(%s)= %s\n" % (entry.hashtype, entry.filepath, entry.hash))
+        os.unlink(mhl_file.mhl_file_path)
+        mhl.mhl_file.convert_hashspecs_to_mhl(hashspecs_path=hashspecs_path,
+                                              output_folder=folder,
+                                              cwd=folder)
+        mhl_file_paths = testDir.list("mhl_verify_multiple", "*.mhl")
+        self.assertEquals(len(mhl_file_paths), 1, msg="Exactly one MHL file expected")
+        self.assertEqual(sorted(mhl.mhl_file.parse_mhl(mhl_file_paths[0])), sorted(entries))
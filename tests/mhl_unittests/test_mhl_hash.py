@@ -1,4 +1,5 @@
 from __future__ import print_function
+import os
 import unittest
 from collections import Counter
 
@@ -152,6 +153,54 @@ class TestMHLHash(unittest.TestCase):
             "file2.txt": "5a04ee7b661ee56e",
         }, cwd=testDir.abspath)
 
+    def test_mhl_hash_jobs(self):
+        testDir = TestDir("test_mhl_hash_jobs")
+        self._testDirs += [testDir]
+
+        files = ["file0.txt", "file1.txt", "file2.txt", "mhl_seal"]
+        testDir.copy_from_aux_files(files)
+
+        # parallel jobs print the same results in the same order
+        serial_results = mhl.mhl_hash.hashes_for_files(args=["-t", "md5", "-t", "sha1"],
+                                                       files=files,
+                                                       cwd=testDir.abspath)
+        parallel_results = mhl.mhl_hash.hashes_for_files(args=["--jobs", "4", "-t", "md5", "-t", "sha1"],
+                                                         files=files,
+                                                         cwd=testDir.abspath)
+        self.assertEquals(serial_results, parallel_results)
+
+    def test_mhl_hash_verify_list(self):
+        testDir = TestDir("test_mhl_hash_verify_list")
+        self._testDirs += [testDir]
+
+        files = ["file0.txt", "file1.txt", "file2.txt"]
+        testDir.copy_from_aux_files(files)
+
+        results = mhl.mhl_hash.hashes_for_files(args=["-t", "md5", "-t", "sha1"],
+                                                files=files,
+                                                cwd=testDir.abspath)
+        list_path = os.path.join(testDir.abspath, "hashes.txt")
+        with open(list_path, "w") as f:
+            for result in results:
+                f.write("%s(%s)= %s\n" % (result.hashtype, result.filepath, result.hash))
+            f.write("no hash in this line\n")
+
+        with open(os.path.join(testDir.abspath, "file1.txt"), "a") as f:
+            f.write("modified")
+
+        returncode, output = mhl.mhl_hash.verify_list("hashes.txt",
+                                                      args=["--jobs", "4"],
+                                                      cwd=testDir.abspath)
+        self.assertNotEquals(0, returncode)
+
+        # one result per line, in the order of lines
+        lines = [line for line in output.splitlines() if line.startswith("mhl hash|")]
+        self.assertEquals(len(results) + 1, len(lines))
+        for result, line in zip(results, lines):
+            status = "error|16" if result.filepath == "file1.txt" else "output|compare"
+            self.assertTrue(line.startswith("mhl hash|%s|%s|" % (status, result.filepath)), msg=line)
+        self.assertTrue(lines[-1].startswith("mhl hash|error|6|line %d|" % len(lines)), msg=lines[-1])
+
     def _assert_mhl_hashes(self, hashtype, files_to_hash_with_hashes, cwd):
         mhl_hash_args = ["-t", hashtype.lower()]
         files_to_hash = files_to_hash_with_hashes.keys()
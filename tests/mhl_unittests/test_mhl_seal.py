@@ -1,6 +1,7 @@
 from __future__ import print_function
 import unittest
 import os
+import json
 from lxml import etree
 
 __package__ = "mhl_unittests"
@@ -34,6 +35,125 @@ class TestMHLSeal(unittest.TestCase):
         self._assert_mhl_seal_hashes_match(mhl_file, hashtype, expected_results)
         self._assert_mhl_seal_file_sizes_match(mhl_file, testDir, expected_results.keys())
 
+    def test_mhl_seal_gzip(self):
+        testDir = TestDir("test_mhl_seal_gzip")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"])
+
+        mhl.mhl_seal.seal(folder=testDir.abspath_for("mhl_seal"), output_folder=testDir.abspath, hashtype="md5", gzip=True)
+        self.assertEquals(len(testDir.list(".", pattern="*.mhl")), 0, msg="Unexpected uncompressed mhl file")
+        mhl_files = testDir.list(".", pattern="*.mhl.gz")
+        self.assertEquals(len(mhl_files), 1, msg="Unexpected number of compressed mhl files")
+
+        mhl_file = mhl_files[0]
+
+        expected_results = {"mhl_seal/%s" % file: hashes["md5"] for file, hashes in expected_file_hashes.iteritems()}
+        self._assert_mhl_seal_hashes_match(mhl_file, "md5", expected_results)
+        self.assertTrue(mhl.mhl_verify.verify(mhl_file, cwd=testDir.abspath),
+                        msg="Failed to verify with compressed MHL file")
+
+    def test_mhl_seal_stats(self):
+        testDir = TestDir("test_mhl_seal_stats")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"])
+        stats_path = testDir.abspath_for("stats.json")
+
+        mhl.mhl_seal.seal(folder=testDir.abspath_for("mhl_seal"), output_folder=testDir.abspath, hashtype="md5",
+                          stats_file=stats_path)
+        with open(stats_path) as stats_file:
+            stats = json.load(stats_file)
+
+        self.assertEquals(stats["tool"], "mhl seal")
+        phases = stats["phases"]
+        for phase in ("walk", "stat", "open", "read", "hash", "conversion", "xml_write"):
+            self.assertIn(phase, phases, msg="No statistics for phase '%s'" % phase)
+            self.assertIn("p99", phases[phase]["latency_us"])
+
+        files = ["mhl_seal/%s" % file for file in expected_file_hashes.keys()]
+        total_size = sum(os.stat(testDir.abspath_for(file)).st_size for file in files)
+        self.assertEquals(phases["open"]["calls"], len(files))
+        self.assertEquals(phases["read"]["bytes"], total_size)
+        self.assertEquals(phases["hash"]["bytes"], total_size)
+        self.assertEquals(phases["xml_write"]["calls"], 1)
+        self.assertIn("histogram_us", phases["read"])
+
+    def test_mhl_seal_trace(self):
+        testDir = TestDir("test_mhl_seal_trace")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"])
+        trace_path = testDir.abspath_for("trace.json")
+
+        mhl.mhl_seal.seal(folder=testDir.abspath_for("mhl_seal"), output_folder=testDir.abspath, hashtype="md5",
+                          trace_file=trace_path)
+        with open(trace_path) as trace_file:
+            trace = json.load(trace_file)
+
+        spans = [event for event in trace["traceEvents"] if event["ph"] == "X"]
+        files = ["mhl_seal/%s" % file for file in expected_file_hashes.keys()]
+        total_size = sum(os.stat(testDir.abspath_for(file)).st_size for file in files)
+        self.assertEquals(len([span for span in spans if span["name"] == "open"]), len(files))
+        self.assertEquals(sum(span["args"]["bytes"] for span in spans if span["name"] == "read"), total_size)
+        self.assertEquals(trace["otherData"]["dropped_events"], 0)
+
+    def test_mhl_seal_report(self):
+        testDir = TestDir("test_mhl_seal_report")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"])
+        report_path = testDir.abspath_for("report.jsonl")
+
+        mhl.mhl_seal.seal(folder=testDir.abspath_for("mhl_seal"), output_folder=testDir.abspath, hashtype="md5",
+                          report_file=report_path)
+        with open(report_path) as report_file:
+            records = [json.loads(line) for line in report_file]
+
+        self.assertEquals(len(records), len(expected_file_hashes))
+        for record in records:
+            # paths are relative to the folder of the MHL file
+            self.assertEquals(record["root"], testDir.abspath)
+            file = os.path.relpath(record["path"], "mhl_seal")
+            self.assertEquals(record["algorithm"], "MD5")
+            self.assertEquals(record["actual"], expected_file_hashes[file]["md5"])
+            self.assertEquals(record["size"], os.stat(testDir.abspath_for(record["path"])).st_size)
+            self.assertEquals(record["status"], "OK")
+
+        # verify reports the same paths as seal
+        mhl_files = testDir.list(pattern="*.mhl")
+        self.assertEquals(len(mhl_files), 1, msg="Unexpected number of mhl files")
+        verify_report_path = testDir.abspath_for("verify_report.jsonl")
+        self.assertTrue(mhl.mhl_verify.verify(mhl_files[0], report_file=verify_report_path))
+        with open(verify_report_path) as report_file:
+            verify_records = [json.loads(line) for line in report_file]
+
+        self.assertEquals(sorted((record["root"], record["path"]) for record in verify_records),
+                          sorted((record["root"], record["path"]) for record in records))
+
+    def test_mhl_seal_log(self):
+        testDir = TestDir("test_mhl_seal_log")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"])
+        files = ["mhl_seal/%s" % file for file in expected_file_hashes.keys()]
+
+        for log_summary in (False, True):
+            output_dir = testDir.abspath_for("summary" if log_summary else "full")
+            os.mkdir(output_dir)
+            mhl.mhl_seal.seal(folder=testDir.abspath_for("mhl_seal"), output_folder=output_dir, hashtype="md5",
+                              verbose=True, log_summary=log_summary)
+            mhl_files = testDir.list(output_dir, pattern="*.mhl")
+            self.assertEquals(len(mhl_files), 1, msg="Unexpected number of mhl files")
+            log = etree.parse(mhl_files[0]).findtext("creatorinfo/log")
+
+            self.assertIn("Calculating hash sums", log)
+            for file in files:
+                self.assertEquals("'%s'" % testDir.abspath_for(file) in log, not log_summary,
+                                  msg="Unexpected log of file '%s'" % file)
+            if log_summary:
+                self.assertIn("Summary log: %d messages on single files are left out." % (2 * len(files)), log)
+
     def _assert_mhl_seal_hashes_match(self, mhl_file_path, hashtype, expected_file_hashes):
         mhl_file = mhl.MHLFile(mhl_file_path)
         for file, expected_hash in expected_file_hashes.iteritems():
@@ -87,4 +207,3 @@ for hashtype in ("md5", "sha1", "xxhash", "xxhash64", "xxhash64be"):
     setattr(TestMHLSeal, "test_mhl_seal_%s" % hashtype, lambda self, hashtype=hashtype, expected_results=expected_results: self._test_mhl_seal(hashtype, expected_results))
 
 del hashtype
-del expected_file_hashes
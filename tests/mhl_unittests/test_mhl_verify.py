@@ -1,6 +1,12 @@
 from __future__ import print_function
 import unittest
 import os
+import sys
+import time
+import shutil
+import glob
+import fnmatch
+from contextlib import contextmanager
 
 __package__ = "mhl_unittests"
 
@@ -8,6 +14,24 @@ from .tools import mhl
 from .tools.testdirs import TestDir
 
 
+@contextmanager
+def user_cache_home(home):
+    """Runs the mhl tool with the given home folder and without
+    XDG_CACHE_HOME, yields the folder of MHL indexes in it."""
+    saved = dict((name, os.environ.get(name)) for name in ("HOME", "XDG_CACHE_HOME"))
+    os.environ["HOME"] = home
+    os.environ.pop("XDG_CACHE_HOME", None)
+    try:
+        cache = os.path.join("Library", "Caches") if sys.platform == "darwin" else ".cache"
+        yield os.path.join(home, cache, "mhl", "index")
+    finally:
+        for name, value in saved.items():
+            if value is None:
+                os.environ.pop(name, None)
+            else:
+                os.environ[name] = value
+
+
 class TestMHLVerify(unittest.TestCase):
     def setUp(self):
         self._testDirs = []
@@ -78,6 +102,171 @@ class TestMHLVerify(unittest.TestCase):
         self.assertFalse(mhl.mhl_verify.verify("generic.mhl", only_verify_existence=True, cwd=testDir.abspath_for("mhl_verify_generic")),
                          msg="Verify with MHL file succeeded, although we expected it to fail")
 
+    def test_mhl_verify_with_index(self):
+        testDir = TestDir("test_mhl_verify_with_index")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_verify_generic"])
+        cwd = testDir.abspath_for("mhl_verify_generic")
+
+        with user_cache_home(testDir.abspath_for("home")) as index_dir:
+            # the first run creates the index, the second one reads it
+            self.assertTrue(mhl.mhl_verify.verify("generic.mhl", use_index=True, cwd=cwd),
+                            msg="Failed to verify with MHL file")
+            self.assertEqual(len(glob.glob(os.path.join(index_dir, "generic.mhl.*.idx"))), 1,
+                             msg="Index of MHL file is not created in the user cache folder")
+            self.assertTrue(mhl.mhl_verify.verify("generic.mhl", use_index=True, cwd=cwd),
+                            msg="Failed to verify with index of MHL file")
+
+            # choose one of the files and delete it
+            files = testDir.list_not("*.mhl", path="mhl_verify_generic")
+            os.unlink(files[-1])
+
+            self.assertFalse(mhl.mhl_verify.verify("generic.mhl", use_index=True, cwd=cwd),
+                             msg="Verify with index of MHL file succeeded, although we expected it to fail")
+
+    def test_mhl_verify_with_index_keeps_media_unchanged(self):
+        testDir = TestDir("test_mhl_verify_with_index_keeps_media_unchanged")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_seal"], renames={"mhl_seal": "media/mhl_seal"})
+        media = testDir.abspath_for("media")
+        clip = testDir.abspath_for("media/mhl_seal")
+        mhl.mhl_seal.seal(folder=clip, output_folder=clip, hashtype="md5")
+        mhl.mhl_seal.seal(folder=media, output_folder=media, hashtype="md5")
+        clip_mhl = testDir.list("media/mhl_seal", pattern="*.mhl")[0]
+
+        with user_cache_home(testDir.abspath_for("home")):
+            self.assertTrue(mhl.mhl_verify.verify(clip_mhl, use_index=True),
+                            msg="Failed to verify with MHL file")
+            self.assertTrue(mhl.mhl_verify.verify(clip_mhl, use_index=True),
+                            msg="Failed to verify with index of MHL file")
+
+        for folder, _, files in os.walk(media):
+            self.assertEqual(fnmatch.filter(files, "*.idx*"), [],
+                             msg="Index of MHL file is written into '%s'" % folder)
+
+        # the enclosing MHL file lists all files of the folder
+        self.assertTrue(mhl.mhl_verify.verify(media, discover_all=True),
+                        msg="Failed to verify the parent folder")
+
+    def test_mhl_verify_discover_all(self):
+        testDir = TestDir("test_mhl_verify_discover_all")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_verify_generic"])
+        cwd = testDir.abspath_for("mhl_verify_generic")
+
+        self.assertTrue(mhl.mhl_verify.verify(".", discover_all=True, cwd=cwd),
+                        msg="Failed to verify MHL files found in the folder")
+
+        # choose one of the files and delete it
+        files = testDir.list_not("*.mhl*", path="mhl_verify_generic")
+        os.unlink(files[-1])
+
+        self.assertFalse(mhl.mhl_verify.verify(".", discover_all=True, cwd=cwd),
+                         msg="Verify of found MHL files succeeded, although we expected it to fail")
+
+    def test_mhl_verify_with_cache(self):
+        testDir = TestDir("test_mhl_verify_with_cache")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_verify_generic"])
+        cwd = testDir.abspath_for("mhl_verify_generic")
+        cache = testDir.abspath_for("verify.cache")
+
+        # files changed within the current second are not cached
+        time.sleep(2)
+
+        # the first run fills the cache, the second one uses it
+        self.assertTrue(mhl.mhl_verify.verify("generic.mhl", cache=cache, cwd=cwd),
+                        msg="Failed to verify with MHL file")
+        self.assertTrue(os.path.isfile(cache),
+                        msg="Verification cache is not created")
+        self.assertTrue(mhl.mhl_verify.verify("generic.mhl", cache=cache, cwd=cwd),
+                        msg="Failed to verify with verification cache")
+
+        # choose one of the files and break it, keeping its size
+        files = testDir.list_not("*.mhl", path="mhl_verify_generic")
+        file_to_break = files[-1]
+
+        with open(file_to_break, "r") as f:
+            data = f.read()
+        data = "BROKEN" + data[len("BROKEN"):]
+        with open(file_to_break, "w") as f:
+            f.write(data)
+
+        self.assertFalse(mhl.mhl_verify.verify("generic.mhl", cache=cache, cwd=cwd),
+                         msg="Verify with verification cache succeeded, although we expected it to fail")
+
+    def test_mhl_verify_with_cache_max_age_zero(self):
+        testDir = TestDir("test_mhl_verify_with_cache_max_age_zero")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_verify_generic"])
+        cwd = testDir.abspath_for("mhl_verify_generic")
+        cache = testDir.abspath_for("verify.cache")
+
+        # files changed within the current second are not cached
+        time.sleep(2)
+
+        self.assertTrue(mhl.mhl_verify.verify("generic.mhl", cache=cache, cwd=cwd),
+                        msg="Failed to verify with MHL file")
+
+        # entries of the same second are not used with zero age
+        returncode, output = mhl.mhl_verify.verify_with_machine_readable_output(
+            "generic.mhl", cache=cache, max_cache_age="0", cwd=cwd)
+        self.assertEqual(returncode, 0, msg="Failed to verify with verification cache")
+        self.assertNotIn("|CACHED", output,
+                         msg="Verification cache is used with --max-cache-age 0")
+
+        returncode, output = mhl.mhl_verify.verify_with_machine_readable_output(
+            "generic.mhl", cache=cache, cwd=cwd)
+        self.assertEqual(returncode, 0, msg="Failed to verify with verification cache")
+        self.assertIn("|CACHED", output, msg="Verification cache is not used")
+
+    def test_mhl_verify_all_hashes(self):
+        testDir = TestDir("test_mhl_verify_all_hashes")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_verify_multiple"])
+        cwd = testDir.abspath_for("mhl_verify_multiple")
+
+        # md5 hashes of file1.txt and file2.txt in multiple.mhl are wrong,
+        # by default only the faster xxhash64be hashes are checked for them
+        self.assertTrue(mhl.mhl_verify.verify("multiple.mhl", cwd=cwd),
+                        msg="Failed to verify with MHL file")
+        self.assertFalse(mhl.mhl_verify.verify("multiple.mhl", all_hashes=True, cwd=cwd),
+                         msg="Verify of all hashes succeeded, although we expected it to fail")
+
+    def test_mhl_verify_roots(self):
+        testDir = TestDir("test_mhl_verify_roots")
+        self._testDirs += [testDir]
+
+        testDir.copy_from_aux_files(["mhl_verify_generic"])
+        cwd = testDir.abspath_for("mhl_verify_generic")
+        roots = [testDir.abspath_for("copy1"), testDir.abspath_for("copy2")]
+        for root in roots:
+            shutil.copytree(cwd, root)
+
+        self.assertTrue(mhl.mhl_verify.verify("generic.mhl", roots=roots, cwd=cwd),
+                        msg="Failed to verify copies with MHL file")
+
+        # choose one of the files of the second copy and break it
+        files = testDir.list_not("*.mhl", path="copy2")
+        file_to_break = files[-1]
+
+        with open(file_to_break, "r") as f:
+            data = f.read()
+        data = "BROKEN" + data[len("BROKEN"):]
+        with open(file_to_break, "w") as f:
+            f.write(data)
+
+        self.assertTrue(mhl.mhl_verify.verify("generic.mhl", roots=roots[:1], cwd=cwd),
+                        msg="Failed to verify the first copy with MHL file")
+        self.assertFalse(mhl.mhl_verify.verify("generic.mhl", roots=roots, cwd=cwd),
+                         msg="Verify of copies succeeded, although we expected it to fail")
+
     def test_mhl_verify_machinereadable(self):
         testDir = TestDir("test_mhl_verify_machinereadable")
         self._testDirs += [testDir]
@@ -1,4 +1,5 @@
 import os.path
+import gzip
 import sys
 import subprocess
 from collections import namedtuple
@@ -129,6 +130,17 @@ class mhl_hash(object):
             else:
                 raise e
 
+    @staticmethod
+    def verify_list(list_file, args=None, cwd=None):
+        args = args if args is not None else []
+        args += ["-s", list_file]
+
+        try:
+            output = run_mhl(["hash"] + args, cwd=cwd)
+            return (0, output)
+        except MHLCommandException as e:
+            return (e.returncode, e.output)
+
 
 class mhl_verify(object):
     @staticmethod
@@ -154,7 +166,7 @@ class mhl_verify(object):
             return (e.returncode, e.output)
 
     @staticmethod
-    def _exec(mhl_file, args=None, only_verify_existence=False, machinereadable=False, continue_on_error=False, cwd=None):
+    def _exec(mhl_file, args=None, only_verify_existence=False, machinereadable=False, continue_on_error=False, use_index=False, discover_all=False, cache=None, max_cache_age=None, all_hashes=False, roots=None, report_file=None, cwd=None):
         args = args if args is not None else []
         if only_verify_existence:
             args += ["-e"]
@@ -162,22 +174,73 @@ class mhl_verify(object):
             args += ["-y"]
         if continue_on_error:
             args += ["-c"]
-        args += ["-f", mhl_file]
+        if use_index:
+            args += ["-i"]
+        if cache is not None:
+            args += ["--cache", cache]
+        if max_cache_age is not None:
+            args += ["--max-cache-age", max_cache_age]
+        if all_hashes:
+            args += ["--all-hashes"]
+        for root in roots or []:
+            args += ["--root", root]
+        if report_file is not None:
+            args += ["--report", report_file]
+        if discover_all:
+            # mhl_file is a folder to search for MHL files in
+            args += ["--discover-all", mhl_file]
+        else:
+            args += ["-f", mhl_file]
 
         return run_mhl(["verify"] + args, cwd=cwd)
 
 
 class mhl_seal(object):
     @staticmethod
-    def seal(folder, hashtype=None, output_folder=None):
+    def seal(folder, hashtype=None, output_folder=None, gzip=False, stats_file=None,
+             trace_file=None, report_file=None, report_format=None, verbose=False,
+             log_summary=False):
         args = []
+        if verbose:
+            args += ["-v"]
+        if log_summary:
+            args += ["--log-summary"]
         if output_folder is not None:
             args += ["-o", output_folder]
         if hashtype is not None:
             args += ["-t", hashtype]
+        if gzip:
+            args += ["-z"]
+        if report_file is not None:
+            args += ["--report", report_file]
+        if report_format is not None:
+            args += ["--report-format", report_format]
         args += [folder]
 
-        run_mhl(["seal"] + args)
+        main_args = []
+        if stats_file is not None:
+            main_args += ["--stats", stats_file]
+        if trace_file is not None:
+            main_args += ["--trace", trace_file]
+
+        run_mhl(main_args + ["seal"] + args)
+
+
+class mhl_copy(object):
+    @staticmethod
+    def copy(sources, destinations, hashtype=None, verify=False, verbose=False, cwd=None):
+        args = []
+        if verbose:
+            args += ["-v"]
+        for destination in destinations:
+            args += ["-d", destination]
+        if hashtype is not None:
+            args += ["-t", hashtype]
+        if verify:
+            args += ["--verify"]
+        args += sources
+
+        return run_mhl(["copy"] + args, cwd=cwd)
 
 
 class mhl_file(object):
@@ -190,11 +253,18 @@ class mhl_file(object):
 
         run_mhl(["file"] + args, cwd=cwd)
 
+    @staticmethod
+    def parse_mhl(mhl_file_path, cwd=None):
+        output = run_mhl(["file", "-p", mhl_file_path], cwd=cwd)
+
+        return MHLHashSpecList.fromstring(output).entries
+
 
 class MHLFile(object):
     def __init__(self, mhl_file_path):
         self._mhl_file_path = mhl_file_path
-        with open(mhl_file_path) as mhl:
+        opener = gzip.open if mhl_file_path.endswith(".gz") else open
+        with opener(mhl_file_path) as mhl:
             self._root = etree.parse(mhl)
 
     @property
@@ -232,6 +302,24 @@ class MHLFile(object):
         else:
             return None
 
+    def lastmodificationdates_for_file(self, file):
+        xpath = u".//lastmodificationdate[../file[text() = \"%(file)s\"]]" % {
+            "file": file
+        }
+        date_matches = self._root.xpath(xpath)
+
+        return [date_match.text for date_match in date_matches]
+
+    def hash_entries(self):
+        """@return (hashtype, file, hash) of each digest, in the order of the MHL file"""
+        entries = []
+        for hash_element in self._root.xpath(u".//hash"):
+            file = hash_element.find("file").text
+            for child in hash_element:
+                if child.tag in ("md5", "sha1", "xxhash", "xxhash64", "xxhash64be"):
+                    entries.append((child.tag, file, child.text))
+        return entries
+
     def files(self):
         xpath = u".//file"
         file_matches = self._root.xpath(xpath)